@@ -0,0 +1,227 @@
+/* aliasbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Topic alias benchmark.
+ * Publishes messages with 60 to 90 byte topics and 20 byte payloads and
+ * counts the bytes written, without and with the outbound topic alias table
+ * (MqttClient_SetTopicAliasOut). Topics are chosen uniformly or with most
+ * messages going to a few hot topics, with more topics than the broker
+ * Topic Alias Maximum to exercise the least recently used reassignment. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_TOPIC_ALIAS
+
+#define BENCH_BUF_SIZE      512
+#define BENCH_MAX_TOPICS    256
+#define BENCH_TOPIC_LEN     96
+#define BENCH_PAYLOAD_LEN   20
+
+static char mTopics[BENCH_MAX_TOPICS][BENCH_TOPIC_LEN];
+static const byte kPayload[BENCH_PAYLOAD_LEN] = { 0 };
+
+typedef struct _AliasBenchCtx {
+    MqttClient          client;
+    MqttNet             net;
+    BenchNet            bnet;
+    MqttTopicAliasOut   alias_out;
+    byte                tx_buf[BENCH_BUF_SIZE];
+    byte                rx_buf[BENCH_BUF_SIZE];
+    byte                connack[8];
+} AliasBenchCtx;
+
+static AliasBenchCtx mCtx;
+
+/* Simple deterministic generator, so both runs publish the same topics */
+static word32 bench_rand(word32* state)
+{
+    *state = *state * 1103515245UL + 12345UL;
+    return (*state >> 8) & 0xFFFFFF;
+}
+
+static void bench_topics(int num_topics)
+{
+    int i;
+    word32 seed = 1;
+
+    for (i = 0; i < num_topics; i++) {
+        /* 60 to 90 bytes */
+        int len = 60 + (int)(bench_rand(&seed) % 31);
+        int n = XSNPRINTF(mTopics[i], BENCH_TOPIC_LEN,
+            "wolfMQTT/bench/site-%02d/building-%03d/floor-%02d/device-%05d/",
+            i % 7, i % 113, i % 17, i);
+        for (; n < len; n++) {
+            mTopics[i][n] = (char)('a' + (n % 26));
+        }
+        mTopics[i][len] = '\0';
+    }
+}
+
+/* Returns topic index: uniform, or hot (80% of messages to 1/8 of topics) */
+static int bench_pick(word32* state, int num_topics, int hot)
+{
+    word32 r = bench_rand(state);
+    int num_hot = num_topics / 8;
+
+    if (hot && num_hot > 0 && (r % 10) < 8) {
+        return (int)((r >> 4) % num_hot);
+    }
+    return (int)((r >> 4) % num_topics);
+}
+
+static int run_bench(int use_alias, int count, int num_topics, int hot,
+    word16 alias_max, word32* bytes)
+{
+    int rc, i;
+    word32 seed = 7, start_bytes;
+    AliasBenchCtx* ctx = &mCtx;
+    MqttConnect connect;
+    MqttPublish publish;
+
+    XMEMSET(ctx, 0, sizeof(AliasBenchCtx));
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, NULL,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc == MQTT_CODE_SUCCESS && use_alias) {
+        rc = MqttTopicAliasOut_Init(&ctx->alias_out, alias_max);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = MqttClient_SetTopicAliasOut(&ctx->client, &ctx->alias_out);
+        }
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    /* CONNACK with Topic Alias Maximum property */
+    ctx->connack[0] = 0x20;
+    ctx->connack[1] = 6;
+    ctx->connack[4] = 3;
+    ctx->connack[5] = MQTT_PROP_TOPIC_ALIAS_MAX;
+    ctx->connack[6] = (byte)(alias_max >> 8);
+    ctx->connack[7] = (byte)alias_max;
+    ctx->bnet.rx = ctx->connack;
+    ctx->bnet.rx_len = (int)sizeof(ctx->connack);
+
+    XMEMSET(&connect, 0, sizeof(connect));
+    connect.client_id = "aliasbench";
+    connect.keep_alive_sec = 60;
+    rc = MqttClient_Connect(&ctx->client, &connect);
+    ctx->bnet.rx = NULL;
+
+    start_bytes = ctx->bnet.tx_bytes;
+    for (i = 0; i < count && rc == MQTT_CODE_SUCCESS; i++) {
+        XMEMSET(&publish, 0, sizeof(publish));
+        publish.qos = MQTT_QOS_0;
+        publish.topic_name = mTopics[bench_pick(&seed, num_topics, hot)];
+        publish.buffer = (byte*)kPayload;
+        publish.total_len = BENCH_PAYLOAD_LEN;
+        rc = MqttClient_Publish(&ctx->client, &publish);
+    }
+    *bytes = ctx->bnet.tx_bytes - start_bytes;
+
+    MqttClient_DeInit(&ctx->client);
+    if (use_alias) {
+        MqttTopicAliasOut_Free(&ctx->alias_out);
+    }
+    return rc;
+}
+
+static int run_case(int count, int num_topics, int hot, word16 alias_max)
+{
+    int rc;
+    word32 full = 0, alias = 0;
+
+    bench_topics(num_topics);
+    rc = run_bench(0, count, num_topics, hot, alias_max, &full);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_bench(1, count, num_topics, hot, alias_max, &alias);
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("%3d topics %-7s alias max %3u: failed %d (%s)", num_topics,
+            hot ? "hot" : "uniform", alias_max, rc,
+            MqttClient_ReturnCodeToString(rc));
+        return rc;
+    }
+
+    PRINTF("%3d topics %-7s alias max %3u: %6.1f -> %6.1f bytes/msg "
+        "(%4.1f%% saved)", num_topics, hot ? "hot" : "uniform", alias_max,
+        (double)full / count, (double)alias / count,
+        100.0 * (double)(full - alias) / (double)full);
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("aliasbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Messages per test, default 100000");
+}
+#endif /* WOLFMQTT_TOPIC_ALIAS */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_TOPIC_ALIAS
+    int i, count = 100000;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("Topic alias benchmark: %d messages, %d byte payload", count,
+        BENCH_PAYLOAD_LEN);
+
+    rc = run_case(count, 8, 0, 16);
+    if (rc == 0) {
+        rc = run_case(count, 64, 0, 16);
+    }
+    if (rc == 0) {
+        rc = run_case(count, 64, 1, 16);
+    }
+    if (rc == 0) {
+        rc = run_case(count, 256, 1, 64);
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires topic aliases to be enabled
+       ./configure --enable-v5 --enable-topicalias */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
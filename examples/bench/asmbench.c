@@ -0,0 +1,262 @@
+/* asmbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Large message assembler benchmark.
+ * Receives a publish much larger than the rx buffer, so it arrives in many
+ * segments, and assembles it with MqttAssembler in memory and spilled to a
+ * mapped temporary file. Each assembled payload is compared with the one
+ * sent, so this also checks the spill path. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_ASSEMBLER
+
+#define BENCH_BUF_SIZE      4096
+#define BENCH_TOPIC         "wolfMQTT/bench/firmware"
+
+typedef struct _AsmBenchCtx {
+    MqttClient      client;
+    MqttNet         net;
+    BenchNet        bnet;
+    MqttAssembler   asmb;
+    byte            tx_buf[BENCH_BUF_SIZE];
+    byte            rx_buf[BENCH_BUF_SIZE];
+    word32          recvd;
+    word32          mismatch;
+    word32          spilled;
+} AsmBenchCtx;
+
+static AsmBenchCtx mCtx;
+static byte* mPayload;
+static word32 mPayloadLen;
+static byte* mPacket;
+static int mPacketLen;
+
+/* Simple deterministic generator, so the payload is not one repeated byte */
+static word32 bench_rand(word32* state)
+{
+    *state = *state * 1103515245UL + 12345UL;
+    return (*state >> 8) & 0xFFFFFF;
+}
+
+/* Builds a QoS 0 publish of len payload bytes */
+static int build_packet(word32 len)
+{
+    word32 i, seed = 7, remain;
+    int pos = 0, topic_len = (int)XSTRLEN(BENCH_TOPIC);
+
+    mPayload = (byte*)WOLFMQTT_MALLOC(len);
+    mPacket = (byte*)WOLFMQTT_MALLOC(len + 64);
+    if (mPayload == NULL || mPacket == NULL) {
+        return MQTT_CODE_ERROR_MEMORY;
+    }
+    for (i = 0; i < len; i++) {
+        mPayload[i] = (byte)bench_rand(&seed);
+    }
+    mPayloadLen = len;
+
+    remain = MQTT_DATA_LEN_SIZE + (word32)topic_len + len;
+#ifdef WOLFMQTT_V5
+    remain++; /* property length */
+#endif
+    mPacket[pos++] = MQTT_PACKET_TYPE_SET(MQTT_PACKET_TYPE_PUBLISH);
+    do {
+        mPacket[pos] = (byte)(remain & 0x7F);
+        remain >>= 7;
+        if (remain > 0) {
+            mPacket[pos] |= 0x80;
+        }
+        pos++;
+    } while (remain > 0);
+    mPacket[pos++] = (byte)(topic_len >> 8);
+    mPacket[pos++] = (byte)topic_len;
+    XMEMCPY(&mPacket[pos], BENCH_TOPIC, topic_len);
+    pos += topic_len;
+#ifdef WOLFMQTT_V5
+    mPacket[pos++] = 0;
+#endif
+    XMEMCPY(&mPacket[pos], mPayload, len);
+    mPacketLen = pos + (int)len;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+static int assembled_cb(MqttClient *client, MqttAssembledMsg *msg,
+    void *ctx)
+{
+    AsmBenchCtx* bctx = (AsmBenchCtx*)ctx;
+    (void)client;
+
+    if (msg->total_len != mPayloadLen ||
+            XMEMCMP(msg->buffer, mPayload, mPayloadLen) != 0) {
+        bctx->mismatch++;
+    }
+    if (msg->spilled) {
+        bctx->spilled++;
+    }
+    bctx->recvd++;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int bench_msg_cb(MqttClient *client, MqttMessage *msg,
+    byte msg_new, byte msg_done)
+{
+    AsmBenchCtx* ctx = (AsmBenchCtx*)client->ctx;
+
+    return MqttAssembler_Message(&ctx->asmb, client, msg, msg_new, msg_done);
+}
+
+/* Receives the publish count times, spilling payloads above spill_len */
+static int run_case(const char* desc, word32 spill_len, const char* dir,
+    int count)
+{
+    int rc;
+    double start, elapsed;
+    AsmBenchCtx* ctx = &mCtx;
+
+    XMEMSET(ctx, 0, sizeof(AsmBenchCtx));
+    rc = MqttAssembler_Init(&ctx->asmb, spill_len, 0, dir, assembled_cb,
+        ctx);
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("%-8s: assembler init failed %d (%s)", desc, rc,
+            MqttClient_ReturnCodeToString(rc));
+        return rc;
+    }
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, bench_msg_cb,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    ctx->client.ctx = ctx;
+    ctx->bnet.rx = mPacket;
+    ctx->bnet.rx_len = mPacketLen;
+
+    start = bench_time_sec();
+    while (ctx->recvd < (word32)count &&
+            (rc == MQTT_CODE_SUCCESS || rc == MQTT_CODE_CONTINUE)) {
+        rc = MqttClient_WaitMessage(&ctx->client, 1000);
+    }
+    elapsed = bench_time_sec() - start;
+
+    MqttClient_DeInit(&ctx->client);
+    MqttAssembler_Free(&ctx->asmb);
+
+    if (rc == MQTT_CODE_SUCCESS && ctx->mismatch != 0) {
+        PRINTF("%-8s: assembled payload mismatch", desc);
+        rc = MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+    if (rc == MQTT_CODE_SUCCESS &&
+            ctx->spilled != ((spill_len > 0) ? ctx->recvd : 0)) {
+        PRINTF("%-8s: %u of %u messages spilled", desc, ctx->spilled,
+            ctx->recvd);
+        rc = MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        PRINTF("%-8s: %8.1f MB/sec (%u messages, %.3f sec)", desc,
+            ((double)mPayloadLen * ctx->recvd) / (elapsed * 1024 * 1024),
+            ctx->recvd, elapsed);
+    }
+    else {
+        PRINTF("%-8s: failed %d (%s)", desc, rc,
+            MqttClient_ReturnCodeToString(rc));
+    }
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("asmbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-s <num>    Payload bytes, default 4194304");
+    PRINTF("-l <num>    Spill length, default 65536");
+    PRINTF("-n <num>    Messages per test, default 20");
+    PRINTF("-d <dir>    Spill file directory, default TMPDIR or %s",
+        MQTT_ASSEMBLER_TMP_DIR);
+}
+#endif /* WOLFMQTT_ASSEMBLER */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_ASSEMBLER
+    int i, count = 20;
+    word32 size = 4 * 1024 * 1024, spill_len = 64 * 1024;
+    const char* dir = NULL;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-s", 3) == 0 && i + 1 < argc) {
+            size = (word32)XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-l", 3) == 0 && i + 1 < argc) {
+            spill_len = (word32)XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-d", 3) == 0 && i + 1 < argc) {
+            dir = argv[++i];
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1 || size <= BENCH_BUF_SIZE || spill_len == 0 ||
+            spill_len >= size) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("Assembler benchmark: %u byte payload in %d byte segments, "
+        "spill above %u", size, BENCH_BUF_SIZE, spill_len);
+
+    rc = build_packet(size);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_case("memory", 0, NULL, count);
+    }
+#ifdef WOLFMQTT_ASSEMBLER_SPILL
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_case("spilled", spill_len, dir, count);
+    }
+#else
+    PRINTF("spilled : not supported on this platform");
+#endif
+
+    if (mPayload != NULL) {
+        WOLFMQTT_FREE(mPayload);
+    }
+    if (mPacket != NULL) {
+        WOLFMQTT_FREE(mPacket);
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires the assembler to be enabled
+       ./configure --enable-assembler */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
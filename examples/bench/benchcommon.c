@@ -0,0 +1,133 @@
+/* benchcommon.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "benchcommon.h"
+
+#ifndef USE_WINDOWS_API
+    #include <time.h>
+#endif
+
+double bench_time_sec(void)
+{
+#ifdef USE_WINDOWS_API
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1000000000.0);
+#endif
+}
+
+static int BenchNet_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    (void)context;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int BenchNet_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    BenchNet* ctx = (BenchNet*)context;
+    (void)timeout_ms;
+
+    if (ctx->cap != NULL && ctx->cap_len + buf_len <= ctx->cap_size) {
+        XMEMCPY(&ctx->cap[ctx->cap_len], buf, buf_len);
+        ctx->cap_len += buf_len;
+    }
+    ctx->tx_bytes += (word32)buf_len;
+    ctx->tx_count++;
+
+    return buf_len;
+}
+
+static int BenchNet_Read(void *context, byte* buf, int buf_len,
+    int timeout_ms)
+{
+    BenchNet* ctx = (BenchNet*)context;
+    int pos = 0, len;
+    (void)timeout_ms;
+
+    if (ctx->rx == NULL || ctx->rx_len <= 0) {
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+
+    while (pos < buf_len) {
+        len = ctx->rx_len - ctx->rx_pos;
+        if (len > buf_len - pos) {
+            len = buf_len - pos;
+        }
+        XMEMCPY(&buf[pos], &ctx->rx[ctx->rx_pos], len);
+        pos += len;
+        ctx->rx_pos += len;
+        if (ctx->rx_pos >= ctx->rx_len) {
+            ctx->rx_pos = 0;
+        }
+    }
+
+    return buf_len;
+}
+
+static int BenchNet_Disconnect(void *context)
+{
+    (void)context;
+    return MQTT_CODE_SUCCESS;
+}
+
+int bench_net_init(MqttNet* net, BenchNet* ctx)
+{
+    if (net == NULL || ctx == NULL) {
+        return MQTT_CODE_ERROR_BAD_ARG;
+    }
+    XMEMSET(net, 0, sizeof(MqttNet));
+    net->connect = BenchNet_Connect;
+    net->read = BenchNet_Read;
+    net->write = BenchNet_Write;
+    net->disconnect = BenchNet_Disconnect;
+    net->context = ctx;
+    return MQTT_CODE_SUCCESS;
+}
+
+int bench_client_init(MqttClient* client, MqttNet* net, BenchNet* ctx,
+    MqttMsgCb msg_cb, byte* tx_buf, int tx_buf_len, byte* rx_buf,
+    int rx_buf_len)
+{
+    int rc = bench_net_init(net, ctx);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_Init(client, net, msg_cb, tx_buf, tx_buf_len,
+            rx_buf, rx_buf_len, 1000);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_NetConnect(client, "bench", 0, 1000, 0, NULL);
+    }
+    return rc;
+}
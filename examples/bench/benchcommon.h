@@ -0,0 +1,84 @@
+/* benchcommon.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_BENCHCOMMON_H
+#define WOLFMQTT_BENCHCOMMON_H
+
+#include "wolfmqtt/mqtt_client.h"
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+/* Threading used by the benchmarks */
+#ifdef USE_WINDOWS_API
+    #include <windows.h>
+    typedef HANDLE BENCH_THREAD_T;
+    #define BENCH_THREAD_RET        DWORD WINAPI
+    #define BENCH_THREAD_RET_VAL    0
+    #define BENCH_THREAD_CREATE(h, f, c) \
+        ((*(h) = CreateThread(NULL, 0, (f), (c), 0, NULL)) == NULL)
+    #define BENCH_THREAD_JOIN(h) \
+        (void)(WaitForSingleObject((h), INFINITE), CloseHandle(h))
+    #define BENCH_YIELD()           (void)SwitchToThread()
+#else
+    #include <pthread.h>
+    #include <sched.h>
+    typedef pthread_t BENCH_THREAD_T;
+    #define BENCH_THREAD_RET        void*
+    #define BENCH_THREAD_RET_VAL    NULL
+    #define BENCH_THREAD_CREATE(h, f, c) pthread_create((h), NULL, (f), (c))
+    #define BENCH_THREAD_JOIN(h)    (void)pthread_join((h), NULL)
+    #define BENCH_YIELD()           (void)sched_yield()
+#endif
+
+/* In memory network used by the benchmarks, so results do not depend on a
+ * broker or socket. Writes are counted (and optionally captured) and reads
+ * are served from a buffer, repeating from the start once consumed. */
+typedef struct _BenchNet {
+    const byte *rx;         /* data returned by reads */
+    int         rx_len;
+    int         rx_pos;
+
+    byte       *cap;        /* optional capture of written data */
+    int         cap_size;
+    int         cap_len;
+
+    word32      tx_bytes;   /* total written */
+    word32      tx_count;   /* number of writes */
+} BenchNet;
+
+/* Returns a monotonic time in seconds */
+double bench_time_sec(void);
+
+/* Setup network callbacks using bench context */
+int bench_net_init(MqttNet* net, BenchNet* ctx);
+
+/* Initialize and "connect" a client using the bench network */
+int bench_client_init(MqttClient* client, MqttNet* net, BenchNet* ctx,
+    MqttMsgCb msg_cb, byte* tx_buf, int tx_buf_len, byte* rx_buf,
+    int rx_buf_len);
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_BENCHCOMMON_H */
@@ -0,0 +1,579 @@
+/* brokerbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* In-process broker benchmark.
+ * A publisher and a number of subscribers, all MqttClient, are connected
+ * to the in-process broker over in-memory pipes, in one thread. A client
+ * read runs the broker until it has nothing left to do, so the results
+ * depend on neither a socket nor an external broker. The time spent in the
+ * broker is measured and taken out of the client time.
+ * The run first checks the broker: a retained message is delivered to a
+ * new subscription, wildcards match (and do not match) as they should, a
+ * v5 property is forwarded and no local is honored. Then messages are
+ * published at QoS 0, 1 and 2 and the deliveries per second and the client
+ * and broker time per message are reported. Fails when a message is lost,
+ * duplicated or wrong. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_BROKER
+
+#include "wolfmqtt/mqtt_broker.h"
+
+#define BENCH_BUF_SIZE      2048
+#define BENCH_PIPE_SIZE     (64 * 1024)
+#define BENCH_MAX_SUBS      32
+#define BENCH_TIMEOUT_MS    1000
+#define BENCH_TOPIC         "bench/1/data"
+#define BENCH_CONTENT_TYPE  "bench/data"
+
+/* Bytes written to one side and not yet read by the other */
+typedef struct _BenchPipe {
+    byte        data[BENCH_PIPE_SIZE];
+    int         head;
+    int         tail;
+} BenchPipe;
+
+/* Client and its pipes to the broker */
+typedef struct _BenchPeer {
+    MqttClient  client;
+    MqttNet     net;            /* of the client */
+    MqttNet     broker_net;     /* of the broker connection */
+    BenchPipe   to_broker;
+    BenchPipe   to_client;
+    byte        tx_buf[BENCH_BUF_SIZE];
+    byte        rx_buf[BENCH_BUF_SIZE];
+    char        client_id[16];
+    word16      packet_id;
+
+    word32      received;
+    word32      retained;       /* received with the retain flag */
+    word32      bad;            /* wrong payload, QoS or property */
+    MqttQoS     expect_qos;
+    word32      expect_len;
+} BenchPeer;
+
+static MqttBroker mBroker;
+static double mBrokerSec;
+
+static int Pipe_Write(BenchPipe *pipe, const byte *buf, int len)
+{
+    if (pipe->tail + len > BENCH_PIPE_SIZE) {
+        /* Move the unread bytes to the start */
+        XMEMMOVE(pipe->data, &pipe->data[pipe->head],
+            pipe->tail - pipe->head);
+        pipe->tail -= pipe->head;
+        pipe->head = 0;
+        if (pipe->tail + len > BENCH_PIPE_SIZE) {
+            return MQTT_CODE_ERROR_NETWORK;
+        }
+    }
+    XMEMCPY(&pipe->data[pipe->tail], buf, len);
+    pipe->tail += len;
+    return len;
+}
+
+static int Pipe_Read(BenchPipe *pipe, byte *buf, int len)
+{
+    if (pipe->tail - pipe->head < len) {
+        len = pipe->tail - pipe->head;
+    }
+    XMEMCPY(buf, &pipe->data[pipe->head], len);
+    pipe->head += len;
+    if (pipe->head == pipe->tail) {
+        pipe->head = pipe->tail = 0;
+    }
+    return len;
+}
+
+/* Runs the broker until it has nothing left to do */
+static void Broker_Run(void)
+{
+    double start = bench_time_sec();
+
+    while (MqttBroker_Task(&mBroker, 0) > 0) {
+    }
+    mBrokerSec += bench_time_sec() - start;
+}
+
+static int Net_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    (void)context;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int Net_Disconnect(void *context)
+{
+    (void)context;
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Client side */
+static int Client_Read(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    BenchPeer *peer = (BenchPeer*)context;
+    (void)timeout_ms;
+
+    if (peer->to_client.tail == peer->to_client.head) {
+        Broker_Run();
+        if (peer->to_client.tail == peer->to_client.head) {
+            return MQTT_CODE_ERROR_TIMEOUT;
+        }
+    }
+    return Pipe_Read(&peer->to_client, buf, buf_len);
+}
+
+static int Client_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    BenchPeer *peer = (BenchPeer*)context;
+    (void)timeout_ms;
+    return Pipe_Write(&peer->to_broker, buf, buf_len);
+}
+
+/* Broker side */
+static int Broker_Read(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    BenchPeer *peer = (BenchPeer*)context;
+    (void)timeout_ms;
+
+    if (peer->to_broker.tail == peer->to_broker.head) {
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    return Pipe_Read(&peer->to_broker, buf, buf_len);
+}
+
+static int Broker_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    BenchPeer *peer = (BenchPeer*)context;
+    (void)timeout_ms;
+    return Pipe_Write(&peer->to_client, buf, buf_len);
+}
+
+static int msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    BenchPeer *peer = (BenchPeer*)client->ctx;
+#ifdef WOLFMQTT_V5
+    MqttProp prop;
+#endif
+
+    if (!msg_new || !msg_done) {
+        /* Messages fit the buffer */
+        peer->bad++;
+        return MQTT_CODE_SUCCESS;
+    }
+    if (msg->retain) {
+        peer->retained++;
+    }
+    else {
+        peer->received++;
+        if (msg->qos != peer->expect_qos ||
+                msg->total_len != peer->expect_len) {
+            peer->bad++;
+        }
+    #ifdef WOLFMQTT_V5
+        else if (MqttClient_PropsViewFind(&msg->props_view,
+                    MQTT_PROP_CONTENT_TYPE, &prop) <= 0 ||
+                prop.data_str.len != XSTRLEN(BENCH_CONTENT_TYPE)) {
+            peer->bad++;
+        }
+    #endif
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static word16 next_packet_id(BenchPeer *peer)
+{
+    if (++peer->packet_id == 0) {
+        peer->packet_id = 1;
+    }
+    return peer->packet_id;
+}
+
+static int peer_connect(BenchPeer *peer, int num)
+{
+    MqttConnect connect;
+    int rc;
+
+    XMEMSET(peer, 0, sizeof(BenchPeer));
+    peer->broker_net.context = peer;
+    peer->broker_net.connect = Net_Connect;
+    peer->broker_net.read = Broker_Read;
+    peer->broker_net.write = Broker_Write;
+    peer->broker_net.disconnect = Net_Disconnect;
+    rc = MqttBroker_Add(&mBroker, &peer->broker_net);
+    if (rc < 0) {
+        return rc;
+    }
+
+    peer->net.context = peer;
+    peer->net.connect = Net_Connect;
+    peer->net.read = Client_Read;
+    peer->net.write = Client_Write;
+    peer->net.disconnect = Net_Disconnect;
+    rc = MqttClient_Init(&peer->client, &peer->net, msg_cb, peer->tx_buf,
+        BENCH_BUF_SIZE, peer->rx_buf, BENCH_BUF_SIZE, BENCH_TIMEOUT_MS);
+    if (rc == MQTT_CODE_SUCCESS) {
+        peer->client.ctx = peer;
+    #ifdef WOLFMQTT_V5
+        rc = MqttClient_SetLazyProps(&peer->client, 1);
+    #endif
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_NetConnect(&peer->client, "bench", 0,
+            BENCH_TIMEOUT_MS, 0, NULL);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        XSNPRINTF(peer->client_id, sizeof(peer->client_id), "bench%d", num);
+        XMEMSET(&connect, 0, sizeof(connect));
+        connect.keep_alive_sec = 60;
+        connect.clean_session = 1;
+        connect.client_id = peer->client_id;
+        do {
+            rc = MqttClient_Connect(&peer->client, &connect);
+        } while (rc == MQTT_CODE_CONTINUE);
+        if (rc == MQTT_CODE_SUCCESS &&
+                connect.ack.return_code != MQTT_CONNECT_ACK_CODE_ACCEPTED) {
+            rc = MQTT_CODE_ERROR_SERVER_PROP;
+        }
+    }
+    return rc;
+}
+
+static int peer_subscribe(BenchPeer *peer, const char *filter, byte options)
+{
+    MqttSubscribe subscribe;
+    MqttTopic topic;
+    int rc;
+
+    XMEMSET(&topic, 0, sizeof(topic));
+    topic.topic_filter = filter;
+    topic.qos = (MqttQoS)options;
+    XMEMSET(&subscribe, 0, sizeof(subscribe));
+    subscribe.packet_id = next_packet_id(peer);
+    subscribe.topic_count = 1;
+    subscribe.topics = &topic;
+    do {
+        rc = MqttClient_Subscribe(&peer->client, &subscribe);
+    } while (rc == MQTT_CODE_CONTINUE);
+    if (rc == MQTT_CODE_SUCCESS &&
+            topic.return_code != (options & MQTT_BROKER_SUB_QOS_MASK)) {
+        rc = MQTT_CODE_ERROR_SERVER_PROP;
+    }
+    return rc;
+}
+
+static int peer_publish(BenchPeer *peer, const char *topic, byte *payload,
+    word32 len, MqttQoS qos, byte retain)
+{
+    MqttPublish publish;
+    int rc;
+#ifdef WOLFMQTT_V5
+    MqttProp prop;
+#endif
+
+    XMEMSET(&publish, 0, sizeof(publish));
+    publish.topic_name = topic;
+    publish.qos = qos;
+    publish.retain = retain;
+    publish.buffer = payload;
+    publish.total_len = len;
+    if (qos > MQTT_QOS_0) {
+        publish.packet_id = next_packet_id(peer);
+    }
+#ifdef WOLFMQTT_V5
+    XMEMSET(&prop, 0, sizeof(prop));
+    prop.type = MQTT_PROP_CONTENT_TYPE;
+    prop.data_str.str = (char*)BENCH_CONTENT_TYPE;
+    prop.data_str.len = (word16)XSTRLEN(BENCH_CONTENT_TYPE);
+    publish.props = &prop;
+#endif
+    do {
+        rc = MqttClient_Publish(&peer->client, &publish);
+    } while (rc == MQTT_CODE_CONTINUE);
+    return rc;
+}
+
+/* Reads until no packet is left for the client */
+static int peer_drain(BenchPeer *peer)
+{
+    int rc;
+
+    do {
+        rc = MqttClient_WaitMessage(&peer->client, BENCH_TIMEOUT_MS);
+    } while (rc == MQTT_CODE_SUCCESS || rc == MQTT_CODE_CONTINUE);
+    return (rc == MQTT_CODE_ERROR_TIMEOUT) ? MQTT_CODE_SUCCESS : rc;
+}
+
+static void peer_reset(BenchPeer *peer, MqttQoS qos, word32 len)
+{
+    peer->received = 0;
+    peer->retained = 0;
+    peer->bad = 0;
+    peer->expect_qos = qos;
+    peer->expect_len = len;
+}
+
+/* Checks the routing of the broker, returns 0 on success */
+static int run_checks(BenchPeer *pub, BenchPeer *subs, int sub_count)
+{
+    byte payload[8] = { 'r', 'e', 't', 'a', 'i', 'n', 'e', 'd' };
+    int rc, i;
+
+    /* Retained before the subscriptions */
+    rc = peer_publish(pub, "bench/retained", payload, sizeof(payload),
+        MQTT_QOS_1, 1);
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < sub_count; i++) {
+        peer_reset(&subs[i], MQTT_QOS_1, sizeof(payload));
+        /* Alternate the wildcards, both match BENCH_TOPIC */
+        rc = peer_subscribe(&subs[i], (i & 1) ? "bench/+/data" : "bench/#",
+            MQTT_QOS_2);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = peer_drain(&subs[i]);
+        }
+        if (rc == MQTT_CODE_SUCCESS && subs[i].retained != (word32)!(i & 1)) {
+            PRINTF("Subscriber %d: %u retained messages", i,
+                subs[i].retained);
+            return -1;
+        }
+    }
+#ifdef WOLFMQTT_V5
+    /* Publisher does not receive its own messages */
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = peer_subscribe(pub, "bench/+/data",
+            MQTT_QOS_0 | MQTT_BROKER_SUB_NO_LOCAL);
+    }
+#endif
+
+    /* Neither filter matches */
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = peer_publish(pub, "bench/1/data/more", payload,
+            sizeof(payload), MQTT_QOS_1, 0);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = peer_publish(pub, "other/1/data", payload, sizeof(payload),
+            MQTT_QOS_1, 0);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = peer_publish(pub, BENCH_TOPIC, payload, sizeof(payload),
+            MQTT_QOS_1, 0);
+    }
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < sub_count; i++) {
+        rc = peer_drain(&subs[i]);
+        if (rc == MQTT_CODE_SUCCESS) {
+            /* "bench/#" also matches "bench/1/data/more" */
+            word32 expect = (i & 1) ? 1 : 2;
+            if (subs[i].received != expect || subs[i].bad != 0) {
+                PRINTF("Subscriber %d: %u messages, %u bad, expected %u", i,
+                    subs[i].received, subs[i].bad, expect);
+                return -1;
+            }
+        }
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        peer_reset(pub, MQTT_QOS_0, 0);
+        rc = peer_drain(pub);
+        if (rc == MQTT_CODE_SUCCESS && pub->received != 0) {
+            PRINTF("Publisher received its own messages");
+            return -1;
+        }
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("Check failed: %s (%d)", MqttClient_ReturnCodeToString(rc),
+            rc);
+        return -1;
+    }
+    PRINTF("Checks passed: retained, wildcards"
+    #ifdef WOLFMQTT_V5
+        ", v5 properties, no local"
+    #endif
+        );
+    return 0;
+}
+
+static int run_qos(BenchPeer *pub, BenchPeer *subs, int sub_count,
+    byte *payload, word32 len, int count, MqttQoS qos)
+{
+    double start, total, broker;
+    word32 out_start = mBroker.stats.publish_out;
+    int rc = MQTT_CODE_SUCCESS, i, n;
+
+    for (i = 0; i < sub_count; i++) {
+        peer_reset(&subs[i], qos, len);
+    }
+    mBrokerSec = 0;
+    start = bench_time_sec();
+    for (n = 0; rc == MQTT_CODE_SUCCESS && n < count; n++) {
+        rc = peer_publish(pub, BENCH_TOPIC, payload, len, qos, 0);
+        for (i = 0; rc == MQTT_CODE_SUCCESS && i < sub_count; i++) {
+            rc = peer_drain(&subs[i]);
+        }
+    }
+    /* Last acknowledgments */
+    Broker_Run();
+    total = bench_time_sec() - start;
+    broker = mBrokerSec;
+
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("QoS %d failed: %s (%d)", qos,
+            MqttClient_ReturnCodeToString(rc), rc);
+        return -1;
+    }
+    for (i = 0; i < sub_count; i++) {
+        if (subs[i].received != (word32)count || subs[i].bad != 0) {
+            PRINTF("QoS %d subscriber %d: %u messages, %u bad, expected %d",
+                qos, i, subs[i].received, subs[i].bad, count);
+            return -1;
+        }
+    }
+    PRINTF("%3d %8d %10.0f %10.2f %10.2f %10.2f", qos, count,
+        (double)(mBroker.stats.publish_out - out_start) / total,
+        (total - broker) * 1000000.0 / count, broker * 1000000.0 / count,
+        total * 1000000.0 / count);
+    return 0;
+}
+
+static void usage(void)
+{
+    PRINTF("brokerbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Messages per QoS, default 10000");
+    PRINTF("-s <num>    Subscribers, default 4 (most %d)", BENCH_MAX_SUBS);
+    PRINTF("-p <num>    Payload bytes, default 64");
+    PRINTF("-q <num>    Only this QoS");
+}
+#endif /* WOLFMQTT_BROKER */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_BROKER
+    BenchPeer *peers = NULL;
+    byte *payload = NULL;
+    int i, count = 10000, sub_count = 4, len = 64, only = -1;
+    int connected = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-s", 3) == 0 && i + 1 < argc) {
+            sub_count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-p", 3) == 0 && i + 1 < argc) {
+            len = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-q", 3) == 0 && i + 1 < argc) {
+            only = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    /* Room for the packet and the acknowledgments in the pipes */
+    if (count < 1 || sub_count < 1 || sub_count > BENCH_MAX_SUBS ||
+            len < 1 || len > BENCH_BUF_SIZE - 64 || only < -1 || only > 2) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    rc = MqttBroker_Init(&mBroker, (word16)(sub_count + 1), BENCH_BUF_SIZE,
+        BENCH_TIMEOUT_MS);
+    if (rc == MQTT_CODE_SUCCESS) {
+        peers = (BenchPeer*)WOLFMQTT_MALLOC(sizeof(BenchPeer) *
+            (sub_count + 1));
+        payload = (byte*)WOLFMQTT_MALLOC(len);
+        if (peers == NULL || payload == NULL) {
+            rc = MQTT_CODE_ERROR_MEMORY;
+        }
+    }
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i <= sub_count; i++) {
+        rc = peer_connect(&peers[i], i);
+        connected = i + 1;
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("Setup failed: %s (%d)", MqttClient_ReturnCodeToString(rc),
+            rc);
+    }
+    else {
+        XMEMSET(payload, 0xA5, len);
+        PRINTF("In-process broker benchmark: MQTT v%s, 1 publisher, %d "
+            "subscribers, %d byte payload",
+        #ifdef WOLFMQTT_V5
+            "5",
+        #else
+            "3.1.1",
+        #endif
+            sub_count, len);
+        rc = run_checks(&peers[0], &peers[1], sub_count);
+        if (rc == 0) {
+            PRINTF("QoS   msgs  deliver/s  client us  broker us   total us");
+        }
+        for (i = 0; rc == 0 && i <= MQTT_QOS_2; i++) {
+            if (only < 0 || only == i) {
+                rc = run_qos(&peers[0], &peers[1], sub_count, payload,
+                    (word32)len, count, (MqttQoS)i);
+            }
+        }
+        if (rc == 0) {
+            PRINTF("Broker: %u connects, %u publishes in, %u out, %u "
+                "dropped", mBroker.stats.connects, mBroker.stats.publish_in,
+                mBroker.stats.publish_out, mBroker.stats.dropped);
+            if (mBroker.stats.dropped != 0) {
+                rc = -1;
+            }
+        }
+    }
+
+    for (i = 0; i < connected; i++) {
+        MqttClient_DeInit(&peers[i].client);
+    }
+    MqttBroker_Free(&mBroker);
+    if (peers != NULL) {
+        WOLFMQTT_FREE(peers);
+    }
+    if (payload != NULL) {
+        WOLFMQTT_FREE(payload);
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires the broker to be enabled
+       ./configure --enable-broker */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
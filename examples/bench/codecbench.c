@@ -0,0 +1,1069 @@
+/* codecbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Packet codec benchmark.
+ * Runs each encoder and decoder in src/mqtt_packet.c (and
+ * src/mqtt_sn_packet.c with MQTT-SN) over a fixed packet, without any
+ * network or client state, and reports the time per operation, the encoded
+ * or decoded bytes per second and the heap allocations per operation.
+ * Packets are run as v3.1.1 and, with v5 built in, again as v5 with
+ * properties. The publish encoder is also compared against the pre-encoded
+ * publish template (MqttClient_PublishTemplate_Init), which only encodes the
+ * remaining length, packet ID and payload per message.
+ *
+ * The packet encoders are internal, so this benchmark is built with the
+ * library sources instead of linking the library. The build also uses
+ * examples/bench/user_settings.h, which allocates properties with malloc
+ * and counts each allocation. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#define BENCH_BUF_SIZE      512
+#define BENCH_TOPIC         "wolfMQTT/bench/codec/sensor/temperature"
+#define BENCH_NUM_TOPICS    4
+
+/* Heap allocations made by the library (see user_settings.h) */
+unsigned long gBenchAllocs;
+
+typedef int (*BenchOp)(void);
+
+typedef struct _BenchCase {
+    const char* name;
+    BenchOp     op;
+    byte        v5_only;
+} BenchCase;
+
+typedef struct _BenchPacket {
+    byte        buf[BENCH_BUF_SIZE];
+    int         len;
+} BenchPacket;
+
+static const byte  kPayload[32] = { 0 };
+static const char* kTopics[BENCH_NUM_TOPICS] = {
+    "wolfMQTT/bench/codec/sensor/+/temperature",
+    "wolfMQTT/bench/codec/sensor/+/humidity",
+    "wolfMQTT/bench/codec/control/#",
+    "wolfMQTT/bench/codec/status"
+};
+static const word32 kVbiValues[4] = { 100, 10000, 1000000, 200000000 };
+
+static byte mLevel = MQTT_CONNECT_PROTOCOL_LEVEL_4;
+static byte mTxBuf[BENCH_BUF_SIZE];
+static byte mRefBuf[BENCH_BUF_SIZE];
+static byte mTmplBuf[BENCH_BUF_SIZE];
+static byte mVbiBuf[16];
+static int  mVbiLen;
+static volatile word32 mSink;
+
+static MqttTopic mTopics[BENCH_NUM_TOPICS];
+static MqttPublish mPublish;
+static MqttPublish mPublishTmpl;
+static MqttPublishTemplate mTmpl;
+
+/* Received packets for the decoders */
+static BenchPacket mRxConnAck;
+static BenchPacket mRxPublish;
+static BenchPacket mRxPubAck;
+static BenchPacket mRxSubAck;
+static BenchPacket mRxUnsubAck;
+static BenchPacket mRxPing;
+
+#ifdef WOLFMQTT_V5
+static const char* kContentType = "application/json";
+static const char* kPropKey = "bench-key";
+static const char* kPropVal = "bench-value";
+static const char* kReason = "bench reason string";
+
+static MqttProp mProps[4];
+static MqttProp mAckProps[2];
+static MqttProp mArenaProps[4];
+static MqttPropArena mArena;
+static BenchPacket mRxDisconnect;
+static BenchPacket mRxAuth;
+static BenchPacket mRxProps;
+
+/* Properties sent with every publish in the v5 tests */
+static MqttProp* bench_props(void)
+{
+    XMEMSET(mProps, 0, sizeof(mProps));
+    mProps[0].type = MQTT_PROP_PAYLOAD_FORMAT_IND;
+    mProps[0].data_byte = 1;
+    mProps[0].next = &mProps[1];
+    mProps[1].type = MQTT_PROP_MSG_EXPIRY_INTERVAL;
+    mProps[1].data_int = 3600;
+    mProps[1].next = &mProps[2];
+    mProps[2].type = MQTT_PROP_CONTENT_TYPE;
+    mProps[2].data_str.str = (char*)kContentType;
+    mProps[2].data_str.len = (word16)XSTRLEN(kContentType);
+    mProps[2].next = &mProps[3];
+    mProps[3].type = MQTT_PROP_USER_PROP;
+    mProps[3].data_str.str = (char*)kPropKey;
+    mProps[3].data_str.len = (word16)XSTRLEN(kPropKey);
+    mProps[3].data_str2.str = (char*)kPropVal;
+    mProps[3].data_str2.len = (word16)XSTRLEN(kPropVal);
+    return &mProps[0];
+}
+
+/* Properties sent with the v5 acknowledgments */
+static MqttProp* bench_ack_props(void)
+{
+    XMEMSET(mAckProps, 0, sizeof(mAckProps));
+    mAckProps[0].type = MQTT_PROP_REASON_STR;
+    mAckProps[0].data_str.str = (char*)kReason;
+    mAckProps[0].data_str.len = (word16)XSTRLEN(kReason);
+    mAckProps[0].next = &mAckProps[1];
+    mAckProps[1].type = MQTT_PROP_USER_PROP;
+    mAckProps[1].data_str.str = (char*)kPropKey;
+    mAckProps[1].data_str.len = (word16)XSTRLEN(kPropKey);
+    mAckProps[1].data_str2.str = (char*)kPropVal;
+    mAckProps[1].data_str2.len = (word16)XSTRLEN(kPropVal);
+    return &mAckProps[0];
+}
+#endif /* WOLFMQTT_V5 */
+
+/* Builds a received acknowledgment from its parts. With v5, the ack
+ * properties are placed after the variable header. */
+static int bench_packet(BenchPacket* pkt, byte hdr, const byte* var,
+    int var_len, const byte* payload, int payload_len)
+{
+    int remain_len = var_len + payload_len, pos = 0;
+#ifdef WOLFMQTT_V5
+    int props_len = 0;
+    MqttProp* props = bench_ack_props();
+
+    if (mLevel >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        props_len = MqttEncode_Props((MqttPacketType)(hdr >> 4), props, NULL);
+        remain_len += props_len + MqttEncode_Vbi(NULL, (word32)props_len);
+    }
+#endif
+
+    pkt->buf[pos++] = hdr;
+    pos += MqttEncode_Vbi(&pkt->buf[pos], (word32)remain_len);
+    XMEMCPY(&pkt->buf[pos], var, var_len);
+    pos += var_len;
+#ifdef WOLFMQTT_V5
+    if (mLevel >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        pos += MqttEncode_Vbi(&pkt->buf[pos], (word32)props_len);
+        if (props_len > 0) {
+            pos += MqttEncode_Props((MqttPacketType)(hdr >> 4), props,
+                &pkt->buf[pos]);
+        }
+    }
+#endif
+    if (payload_len > 0) {
+        XMEMCPY(&pkt->buf[pos], payload, payload_len);
+        pos += payload_len;
+    }
+    pkt->len = pos;
+    return pos;
+}
+
+static void bench_publish_init(MqttPublish* publish, byte protocol_level,
+    MqttQoS qos)
+{
+    XMEMSET(publish, 0, sizeof(MqttPublish));
+    publish->qos = qos;
+    publish->topic_name = BENCH_TOPIC;
+    publish->buffer = (byte*)kPayload;
+    publish->total_len = (word32)sizeof(kPayload);
+    publish->packet_id = 1;
+#ifdef WOLFMQTT_V5
+    publish->protocol_level = protocol_level;
+    if (protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        publish->props = bench_props();
+    }
+#else
+    (void)protocol_level;
+#endif
+}
+
+/* Sets up the messages and received packets for the protocol level. The
+ * template encoding is checked against the regular encoder. */
+static int bench_corpus(byte level)
+{
+    int rc, i;
+    byte var[2 + BENCH_NUM_TOPICS];
+    MqttPublishResp resp;
+
+    mLevel = level;
+    for (i = 0; i < BENCH_NUM_TOPICS; i++) {
+        XMEMSET(&mTopics[i], 0, sizeof(MqttTopic));
+        mTopics[i].topic_filter = kTopics[i];
+        mTopics[i].qos = MQTT_QOS_1;
+    }
+
+    bench_publish_init(&mPublish, level, MQTT_QOS_1);
+    rc = MqttEncode_Publish(mRxPublish.buf, BENCH_BUF_SIZE, &mPublish, 0);
+    if (rc <= 0) {
+        return (rc < 0) ? rc : MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+    mRxPublish.len = rc;
+
+    bench_publish_init(&mPublishTmpl, level, MQTT_QOS_1);
+    rc = MqttEncode_PublishTemplate(&mTmpl, &mPublishTmpl, mTmplBuf,
+        BENCH_BUF_SIZE);
+    if (rc < 0) {
+        return rc;
+    }
+    mPublishTmpl.tmpl = &mTmpl;
+#ifdef WOLFMQTT_V5
+    mPublishTmpl.props = NULL; /* encoded in the template */
+#endif
+    rc = MqttEncode_Publish(mRefBuf, BENCH_BUF_SIZE, &mPublishTmpl, 0);
+    if (rc != mRxPublish.len || XMEMCMP(mRefBuf, mRxPublish.buf, rc) != 0) {
+        PRINTF("Publish template encoding mismatch");
+        return MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+
+    XMEMSET(&resp, 0, sizeof(resp));
+    resp.packet_id = 1;
+#ifdef WOLFMQTT_V5
+    resp.protocol_level = level;
+    if (level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        resp.reason_code = MQTT_REASON_NO_MATCH_SUB;
+        resp.props = bench_ack_props();
+    }
+#endif
+    rc = MqttEncode_PublishResp(mRxPubAck.buf, BENCH_BUF_SIZE,
+        MQTT_PACKET_TYPE_PUBLISH_ACK, &resp);
+    if (rc <= 0) {
+        return (rc < 0) ? rc : MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+    mRxPubAck.len = rc;
+
+    /* Session present and accepted */
+    var[0] = 0x01;
+    var[1] = 0x00;
+    bench_packet(&mRxConnAck, MQTT_PACKET_TYPE_CONNECT_ACK << 4, var, 2,
+        NULL, 0);
+
+    /* Packet ID and granted QoS per topic */
+    var[0] = 0x00;
+    var[1] = 0x01;
+    for (i = 0; i < BENCH_NUM_TOPICS; i++) {
+        var[2 + i] = MQTT_QOS_1;
+    }
+    bench_packet(&mRxSubAck, MQTT_PACKET_TYPE_SUBSCRIBE_ACK << 4, var, 2,
+        &var[2], BENCH_NUM_TOPICS);
+
+    /* Reason codes are only in v5 */
+    if (level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        for (i = 0; i < BENCH_NUM_TOPICS; i++) {
+            var[2 + i] = 0x00;
+        }
+        bench_packet(&mRxUnsubAck, MQTT_PACKET_TYPE_UNSUBSCRIBE_ACK << 4,
+            var, 2, &var[2], BENCH_NUM_TOPICS);
+    }
+    else {
+        bench_packet(&mRxUnsubAck, MQTT_PACKET_TYPE_UNSUBSCRIBE_ACK << 4,
+            var, 2, NULL, 0);
+    }
+
+    mRxPing.buf[0] = MQTT_PACKET_TYPE_PING_RESP << 4;
+    mRxPing.buf[1] = 0;
+    mRxPing.len = 2;
+
+#ifdef WOLFMQTT_V5
+    if (level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        MqttDisconnect disc;
+        MqttAuth auth;
+
+        XMEMSET(&disc, 0, sizeof(disc));
+        disc.protocol_level = level;
+        disc.reason_code = MQTT_REASON_SERVER_SHUTTING_DOWN;
+        disc.props = bench_ack_props();
+        rc = MqttEncode_Disconnect(mRxDisconnect.buf, BENCH_BUF_SIZE, &disc);
+        if (rc <= 0) {
+            return (rc < 0) ? rc : MQTT_CODE_ERROR_MALFORMED_DATA;
+        }
+        mRxDisconnect.len = rc;
+
+        XMEMSET(&auth, 0, sizeof(auth));
+        auth.reason_code = MQTT_REASON_CONT_AUTH;
+        auth.props = bench_ack_props();
+        rc = MqttEncode_Auth(mRxAuth.buf, BENCH_BUF_SIZE, &auth);
+        if (rc <= 0) {
+            return (rc < 0) ? rc : MQTT_CODE_ERROR_MALFORMED_DATA;
+        }
+        mRxAuth.len = rc;
+
+        rc = MqttEncode_Props(MQTT_PACKET_TYPE_PUBLISH, bench_props(),
+            mRxProps.buf);
+        if (rc <= 0) {
+            return (rc < 0) ? rc : MQTT_CODE_ERROR_MALFORMED_DATA;
+        }
+        mRxProps.len = rc;
+    }
+#endif
+
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Primitive encoders and decoders */
+static int op_encode_vbi(void)
+{
+    int i, len = 0;
+
+    for (i = 0; i < 4; i++) {
+        len += MqttEncode_Vbi(&mTxBuf[len], kVbiValues[i]);
+    }
+    return len;
+}
+
+static int op_decode_vbi(void)
+{
+    int i, rc, len = 0;
+    word32 value;
+
+    for (i = 0; i < 4; i++) {
+        rc = MqttDecode_Vbi(&mVbiBuf[len], &value,
+            (word32)(mVbiLen - len));
+        if (rc < 0) {
+            return rc;
+        }
+        mSink += value;
+        len += rc;
+    }
+    return len;
+}
+
+static int op_encode_string(void)
+{
+    return MqttEncode_String(mTxBuf, BENCH_TOPIC);
+}
+
+static int op_decode_string(void)
+{
+    const char* str;
+    word16 len;
+    int rc;
+
+    rc = MqttDecode_String(mRefBuf, &str, &len);
+    mSink += len;
+    return rc;
+}
+
+#ifdef WOLFMQTT_V5
+static int op_encode_props(void)
+{
+    return MqttEncode_Props(MQTT_PACKET_TYPE_PUBLISH, mProps, mTxBuf);
+}
+
+/* Decodes into a list from the shared property allocator */
+static int op_decode_props_list(void)
+{
+    MqttProp* head = NULL;
+    int rc;
+
+    rc = MqttDecode_Props(MQTT_PACKET_TYPE_PUBLISH, NULL, &head,
+        mRxProps.buf, (word32)mRxProps.len, (word32)mRxProps.len);
+    if (head != NULL) {
+        MqttProps_Free(head);
+    }
+    return rc;
+}
+
+/* Decodes into a list from an arena */
+static int op_decode_props_arena(void)
+{
+    MqttProp* head = NULL;
+    int rc;
+
+    rc = MqttDecode_Props(MQTT_PACKET_TYPE_PUBLISH, &mArena, &head,
+        mRxProps.buf, (word32)mRxProps.len, (word32)mRxProps.len);
+    if (head != NULL) {
+        MqttProps_ArenaFree(&mArena, head);
+    }
+    return rc;
+}
+
+/* Reads each property from a view of the packet buffer */
+static int op_decode_props_view(void)
+{
+    MqttPropView view;
+    MqttProp prop;
+    int rc;
+
+    rc = MqttDecode_PropsView(MQTT_PACKET_TYPE_PUBLISH, &view, mRxProps.buf,
+        (word32)mRxProps.len, (word32)mRxProps.len);
+    if (rc < 0) {
+        return rc;
+    }
+    while ((rc = MqttProps_ViewNext(&view, &prop)) > 0) {
+        mSink += prop.type;
+    }
+    return (rc < 0) ? rc : mRxProps.len;
+}
+#endif
+
+/* Packet encoders */
+static int op_encode_connect(void)
+{
+    MqttConnect connect;
+
+    XMEMSET(&connect, 0, sizeof(connect));
+    connect.keep_alive_sec = 60;
+    connect.clean_session = 1;
+    connect.client_id = "wolfMQTT-bench-client";
+    connect.username = "bench-user";
+    connect.password = "bench-password";
+    connect.protocol_level = mLevel;
+#ifdef WOLFMQTT_V5
+    if (mLevel >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        connect.props = mAckProps;
+    }
+#endif
+    return MqttEncode_Connect(mTxBuf, BENCH_BUF_SIZE, &connect);
+}
+
+static int op_encode_publish_qos0(void)
+{
+    int rc;
+
+    mPublish.qos = MQTT_QOS_0;
+    rc = MqttEncode_Publish(mTxBuf, BENCH_BUF_SIZE, &mPublish, 0);
+    mPublish.qos = MQTT_QOS_1;
+    return rc;
+}
+
+static int op_encode_publish(void)
+{
+    mPublish.packet_id++;
+    if (mPublish.packet_id == 0) {
+        mPublish.packet_id = 1;
+    }
+    return MqttEncode_Publish(mTxBuf, BENCH_BUF_SIZE, &mPublish, 0);
+}
+
+static int op_encode_publish_tmpl(void)
+{
+    mPublishTmpl.packet_id++;
+    if (mPublishTmpl.packet_id == 0) {
+        mPublishTmpl.packet_id = 1;
+    }
+    return MqttEncode_Publish(mTxBuf, BENCH_BUF_SIZE, &mPublishTmpl, 0);
+}
+
+static int op_encode_puback(void)
+{
+    MqttPublishResp resp;
+
+    XMEMSET(&resp, 0, sizeof(resp));
+    resp.packet_id = 1;
+#ifdef WOLFMQTT_V5
+    resp.protocol_level = mLevel;
+    if (mLevel >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        resp.reason_code = MQTT_REASON_NO_MATCH_SUB;
+        resp.props = mAckProps;
+    }
+#endif
+    return MqttEncode_PublishResp(mTxBuf, BENCH_BUF_SIZE,
+        MQTT_PACKET_TYPE_PUBLISH_ACK, &resp);
+}
+
+static int op_encode_subscribe(void)
+{
+    MqttSubscribe subscribe;
+
+    XMEMSET(&subscribe, 0, sizeof(subscribe));
+    subscribe.packet_id = 1;
+    subscribe.topic_count = BENCH_NUM_TOPICS;
+    subscribe.topics = mTopics;
+#ifdef WOLFMQTT_V5
+    subscribe.protocol_level = mLevel;
+    if (mLevel >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        subscribe.props = &mAckProps[1];
+    }
+#endif
+    return MqttEncode_Subscribe(mTxBuf, BENCH_BUF_SIZE, &subscribe);
+}
+
+static int op_encode_unsubscribe(void)
+{
+    MqttUnsubscribe unsubscribe;
+
+    XMEMSET(&unsubscribe, 0, sizeof(unsubscribe));
+    unsubscribe.packet_id = 1;
+    unsubscribe.topic_count = BENCH_NUM_TOPICS;
+    unsubscribe.topics = mTopics;
+#ifdef WOLFMQTT_V5
+    unsubscribe.protocol_level = mLevel;
+    if (mLevel >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        unsubscribe.props = &mAckProps[1];
+    }
+#endif
+    return MqttEncode_Unsubscribe(mTxBuf, BENCH_BUF_SIZE, &unsubscribe);
+}
+
+static int op_encode_ping(void)
+{
+    MqttPing ping;
+
+    XMEMSET(&ping, 0, sizeof(ping));
+    return MqttEncode_Ping(mTxBuf, BENCH_BUF_SIZE, &ping);
+}
+
+static int op_encode_disconnect(void)
+{
+    MqttDisconnect disc;
+
+    XMEMSET(&disc, 0, sizeof(disc));
+#ifdef WOLFMQTT_V5
+    disc.protocol_level = mLevel;
+    if (mLevel >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        disc.reason_code = MQTT_REASON_NORMAL_DISCONNECTION;
+        disc.props = mAckProps;
+    }
+#endif
+    return MqttEncode_Disconnect(mTxBuf, BENCH_BUF_SIZE, &disc);
+}
+
+#ifdef WOLFMQTT_V5
+static int op_encode_auth(void)
+{
+    MqttAuth auth;
+
+    XMEMSET(&auth, 0, sizeof(auth));
+    auth.reason_code = MQTT_REASON_CONT_AUTH;
+    auth.props = mAckProps;
+    return MqttEncode_Auth(mTxBuf, BENCH_BUF_SIZE, &auth);
+}
+#endif
+
+/* Packet decoders */
+static int op_decode_connack(void)
+{
+    MqttConnectAck ack;
+
+    XMEMSET(&ack, 0, sizeof(ack));
+#ifdef WOLFMQTT_V5
+    ack.protocol_level = mLevel;
+#endif
+    return MqttDecode_ConnectAck(mRxConnAck.buf, mRxConnAck.len, &ack);
+}
+
+static int op_decode_publish(void)
+{
+    MqttPublish publish;
+
+    XMEMSET(&publish, 0, sizeof(publish));
+#ifdef WOLFMQTT_V5
+    publish.protocol_level = mLevel;
+#endif
+    return MqttDecode_Publish(mRxPublish.buf, mRxPublish.len, &publish);
+}
+
+static int op_decode_puback(void)
+{
+    MqttPublishResp resp;
+
+    XMEMSET(&resp, 0, sizeof(resp));
+#ifdef WOLFMQTT_V5
+    resp.protocol_level = mLevel;
+#endif
+    return MqttDecode_PublishResp(mRxPubAck.buf, mRxPubAck.len,
+        MQTT_PACKET_TYPE_PUBLISH_ACK, &resp);
+}
+
+static int op_decode_suback(void)
+{
+    MqttSubscribeAck ack;
+
+    XMEMSET(&ack, 0, sizeof(ack));
+#ifdef WOLFMQTT_V5
+    ack.protocol_level = mLevel;
+#endif
+    return MqttDecode_SubscribeAck(mRxSubAck.buf, mRxSubAck.len, &ack);
+}
+
+static int op_decode_unsuback(void)
+{
+    MqttUnsubscribeAck ack;
+
+    XMEMSET(&ack, 0, sizeof(ack));
+#ifdef WOLFMQTT_V5
+    ack.protocol_level = mLevel;
+#endif
+    return MqttDecode_UnsubscribeAck(mRxUnsubAck.buf, mRxUnsubAck.len, &ack);
+}
+
+static int op_decode_ping(void)
+{
+    MqttPing ping;
+
+    XMEMSET(&ping, 0, sizeof(ping));
+    return MqttDecode_Ping(mRxPing.buf, mRxPing.len, &ping);
+}
+
+#ifdef WOLFMQTT_V5
+static int op_decode_disconnect(void)
+{
+    MqttDisconnect disc;
+
+    XMEMSET(&disc, 0, sizeof(disc));
+    disc.protocol_level = mLevel;
+    return MqttDecode_Disconnect(mRxDisconnect.buf, mRxDisconnect.len, &disc);
+}
+
+static int op_decode_auth(void)
+{
+    MqttAuth auth;
+
+    XMEMSET(&auth, 0, sizeof(auth));
+    return MqttDecode_Auth(mRxAuth.buf, mRxAuth.len, &auth);
+}
+#endif
+
+static const BenchCase kPrimCases[] = {
+    { "encode vbi x4",              op_encode_vbi,          0 },
+    { "decode vbi x4",              op_decode_vbi,          0 },
+    { "encode string",              op_encode_string,       0 },
+    { "decode string",              op_decode_string,       0 },
+#ifdef WOLFMQTT_V5
+    { "encode props x4",            op_encode_props,        1 },
+    { "decode props x4 list",       op_decode_props_list,   1 },
+    { "decode props x4 arena",      op_decode_props_arena,  1 },
+    { "decode props x4 view",       op_decode_props_view,   1 },
+#endif
+};
+
+static const BenchCase kPacketCases[] = {
+    { "encode connect",             op_encode_connect,      0 },
+    { "encode publish QoS 0",       op_encode_publish_qos0, 0 },
+    { "encode publish QoS 1",       op_encode_publish,      0 },
+    { "encode publish QoS 1 tmpl",  op_encode_publish_tmpl, 0 },
+    { "encode puback",              op_encode_puback,       0 },
+    { "encode subscribe x4",        op_encode_subscribe,    0 },
+    { "encode unsubscribe x4",      op_encode_unsubscribe,  0 },
+    { "encode ping",                op_encode_ping,         0 },
+    { "encode disconnect",          op_encode_disconnect,   0 },
+#ifdef WOLFMQTT_V5
+    { "encode auth",                op_encode_auth,         1 },
+#endif
+    { "decode connack",             op_decode_connack,      0 },
+    { "decode publish QoS 1",       op_decode_publish,      0 },
+    { "decode puback",              op_decode_puback,       0 },
+    { "decode suback x4",           op_decode_suback,       0 },
+    { "decode unsuback",            op_decode_unsuback,     0 },
+    { "decode ping",                op_decode_ping,         0 },
+#ifdef WOLFMQTT_V5
+    { "decode disconnect",          op_decode_disconnect,   1 },
+    { "decode auth",                op_decode_auth,         1 },
+#endif
+};
+
+#ifdef WOLFMQTT_SN
+#define BENCH_SN_CLIENT_ID  "wolfMQTT-bench-sn"
+
+static word16 mSnTopicId = 1;
+
+static BenchPacket mSnAdvertise;
+static BenchPacket mSnGwInfo;
+static BenchPacket mSnConnAck;
+static BenchPacket mSnRegister;
+static BenchPacket mSnRegAck;
+static BenchPacket mSnPublish;
+static BenchPacket mSnPubAck;
+static BenchPacket mSnSubAck;
+static BenchPacket mSnUnsubAck;
+static BenchPacket mSnPing;
+static BenchPacket mSnDisconnect;
+
+static void bench_sn_packet(BenchPacket* pkt, const byte* data, int len)
+{
+    XMEMCPY(pkt->buf, data, len);
+    pkt->len = len;
+}
+
+static int op_sn_encode_searchgw(void)
+{
+    return SN_Encode_SearchGW(mTxBuf, BENCH_BUF_SIZE, 1);
+}
+
+static int op_sn_encode_connect(void)
+{
+    SN_Connect connect;
+
+    XMEMSET(&connect, 0, sizeof(connect));
+    connect.keep_alive_sec = 60;
+    connect.clean_session = 1;
+    connect.client_id = BENCH_SN_CLIENT_ID;
+    connect.protocol_level = SN_PROTOCOL_ID_1;
+    return SN_Encode_Connect(mTxBuf, BENCH_BUF_SIZE, &connect);
+}
+
+static int op_sn_encode_register(void)
+{
+    SN_Register regist;
+
+    XMEMSET(&regist, 0, sizeof(regist));
+    regist.packet_id = 1;
+    regist.topicName = BENCH_TOPIC;
+    return SN_Encode_Register(mTxBuf, BENCH_BUF_SIZE, &regist);
+}
+
+static int op_sn_encode_publish(void)
+{
+    SN_Publish publish;
+
+    XMEMSET(&publish, 0, sizeof(publish));
+    publish.qos = MQTT_QOS_1;
+    publish.topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+    publish.topic_name = (const char*)&mSnTopicId;
+    publish.packet_id = 1;
+    publish.buffer = (byte*)kPayload;
+    publish.total_len = (word32)sizeof(kPayload);
+    return SN_Encode_Publish(mTxBuf, BENCH_BUF_SIZE, &publish);
+}
+
+static int op_sn_encode_puback(void)
+{
+    SN_PublishResp resp;
+
+    XMEMSET(&resp, 0, sizeof(resp));
+    resp.packet_id = 1;
+    resp.topicId = mSnTopicId;
+    return SN_Encode_PublishResp(mTxBuf, BENCH_BUF_SIZE, SN_MSG_TYPE_PUBACK,
+        &resp);
+}
+
+static int op_sn_encode_subscribe(void)
+{
+    SN_Subscribe subscribe;
+
+    XMEMSET(&subscribe, 0, sizeof(subscribe));
+    subscribe.qos = MQTT_QOS_1;
+    subscribe.packet_id = 1;
+    subscribe.topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+    subscribe.topicNameId = kTopics[0];
+    return SN_Encode_Subscribe(mTxBuf, BENCH_BUF_SIZE, &subscribe);
+}
+
+static int op_sn_encode_unsubscribe(void)
+{
+    SN_Unsubscribe unsubscribe;
+
+    XMEMSET(&unsubscribe, 0, sizeof(unsubscribe));
+    unsubscribe.packet_id = 1;
+    unsubscribe.topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+    unsubscribe.topicNameId = kTopics[0];
+    return SN_Encode_Unsubscribe(mTxBuf, BENCH_BUF_SIZE, &unsubscribe);
+}
+
+static int op_sn_encode_ping(void)
+{
+    SN_PingReq ping;
+
+    XMEMSET(&ping, 0, sizeof(ping));
+    ping.clientId = (char*)BENCH_SN_CLIENT_ID;
+    return SN_Encode_Ping(mTxBuf, BENCH_BUF_SIZE, &ping, SN_MSG_TYPE_PING_REQ);
+}
+
+static int op_sn_encode_disconnect(void)
+{
+    SN_Disconnect disc;
+
+    XMEMSET(&disc, 0, sizeof(disc));
+    disc.sleepTmr = 600;
+    return SN_Encode_Disconnect(mTxBuf, BENCH_BUF_SIZE, &disc);
+}
+
+static int op_sn_decode_advertise(void)
+{
+    SN_Advertise adv;
+
+    return SN_Decode_Advertise(mSnAdvertise.buf, mSnAdvertise.len, &adv);
+}
+
+static int op_sn_decode_gwinfo(void)
+{
+    SN_GwInfo info;
+
+    return SN_Decode_GWInfo(mSnGwInfo.buf, mSnGwInfo.len, &info);
+}
+
+static int op_sn_decode_connack(void)
+{
+    SN_ConnectAck ack;
+
+    return SN_Decode_ConnectAck(mSnConnAck.buf, mSnConnAck.len, &ack);
+}
+
+static int op_sn_decode_register(void)
+{
+    SN_Register regist;
+
+    return SN_Decode_Register(mSnRegister.buf, mSnRegister.len, &regist);
+}
+
+static int op_sn_decode_regack(void)
+{
+    SN_RegAck ack;
+
+    return SN_Decode_RegAck(mSnRegAck.buf, mSnRegAck.len, &ack);
+}
+
+static int op_sn_decode_publish(void)
+{
+    SN_Publish publish;
+
+    return SN_Decode_Publish(mSnPublish.buf, mSnPublish.len, &publish);
+}
+
+static int op_sn_decode_puback(void)
+{
+    SN_PublishResp resp;
+
+    return SN_Decode_PublishResp(mSnPubAck.buf, mSnPubAck.len,
+        SN_MSG_TYPE_PUBACK, &resp);
+}
+
+static int op_sn_decode_suback(void)
+{
+    SN_SubAck ack;
+
+    return SN_Decode_SubscribeAck(mSnSubAck.buf, mSnSubAck.len, &ack);
+}
+
+static int op_sn_decode_unsuback(void)
+{
+    SN_UnsubscribeAck ack;
+
+    return SN_Decode_UnsubscribeAck(mSnUnsubAck.buf, mSnUnsubAck.len, &ack);
+}
+
+static int op_sn_decode_ping(void)
+{
+    return SN_Decode_Ping(mSnPing.buf, mSnPing.len);
+}
+
+static int op_sn_decode_disconnect(void)
+{
+    return SN_Decode_Disconnect(mSnDisconnect.buf, mSnDisconnect.len);
+}
+
+/* Sets up the received MQTT-SN packets */
+static int bench_sn_corpus(void)
+{
+    static const byte kAdvertise[] = { 0x05, SN_MSG_TYPE_ADVERTISE, 0x01,
+        0x03, 0x84 };
+    static const byte kGwInfo[] = { 0x03, SN_MSG_TYPE_GWINFO, 0x01 };
+    static const byte kConnAck[] = { 0x03, SN_MSG_TYPE_CONNACK, 0x00 };
+    static const byte kSubAck[] = { 0x08, SN_MSG_TYPE_SUBACK, 0x20, 0x00,
+        0x01, 0x00, 0x01, 0x00 };
+    static const byte kUnsubAck[] = { 0x04, SN_MSG_TYPE_UNSUBACK, 0x00,
+        0x01 };
+    static const byte kPing[] = { 0x02, SN_MSG_TYPE_PING_RESP };
+    static const byte kDisconnect[] = { 0x02, SN_MSG_TYPE_DISCONNECT };
+    SN_RegAck regack;
+
+    bench_sn_packet(&mSnAdvertise, kAdvertise, (int)sizeof(kAdvertise));
+    bench_sn_packet(&mSnGwInfo, kGwInfo, (int)sizeof(kGwInfo));
+    bench_sn_packet(&mSnConnAck, kConnAck, (int)sizeof(kConnAck));
+    bench_sn_packet(&mSnSubAck, kSubAck, (int)sizeof(kSubAck));
+    bench_sn_packet(&mSnUnsubAck, kUnsubAck, (int)sizeof(kUnsubAck));
+    bench_sn_packet(&mSnPing, kPing, (int)sizeof(kPing));
+    bench_sn_packet(&mSnDisconnect, kDisconnect, (int)sizeof(kDisconnect));
+
+    /* The gateway sends the same format as the client for these */
+    mSnRegister.len = op_sn_encode_register();
+    XMEMCPY(mSnRegister.buf, mTxBuf, BENCH_BUF_SIZE);
+    mSnPublish.len = op_sn_encode_publish();
+    XMEMCPY(mSnPublish.buf, mTxBuf, BENCH_BUF_SIZE);
+    mSnPubAck.len = op_sn_encode_puback();
+    XMEMCPY(mSnPubAck.buf, mTxBuf, BENCH_BUF_SIZE);
+
+    XMEMSET(&regack, 0, sizeof(regack));
+    regack.topicId = mSnTopicId;
+    regack.packet_id = 1;
+    mSnRegAck.len = SN_Encode_RegAck(mSnRegAck.buf, BENCH_BUF_SIZE, &regack);
+
+    if (mSnRegister.len <= 0 || mSnPublish.len <= 0 || mSnPubAck.len <= 0 ||
+            mSnRegAck.len <= 0) {
+        return MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static const BenchCase kSnCases[] = {
+    { "encode searchgw",            op_sn_encode_searchgw,      0 },
+    { "encode connect",             op_sn_encode_connect,       0 },
+    { "encode register",            op_sn_encode_register,      0 },
+    { "encode publish QoS 1",       op_sn_encode_publish,       0 },
+    { "encode puback",              op_sn_encode_puback,        0 },
+    { "encode subscribe",           op_sn_encode_subscribe,     0 },
+    { "encode unsubscribe",         op_sn_encode_unsubscribe,   0 },
+    { "encode ping",                op_sn_encode_ping,          0 },
+    { "encode disconnect",          op_sn_encode_disconnect,    0 },
+    { "decode advertise",           op_sn_decode_advertise,     0 },
+    { "decode gwinfo",              op_sn_decode_gwinfo,        0 },
+    { "decode connack",             op_sn_decode_connack,       0 },
+    { "decode register",            op_sn_decode_register,      0 },
+    { "decode regack",              op_sn_decode_regack,        0 },
+    { "decode publish QoS 1",       op_sn_decode_publish,       0 },
+    { "decode puback",              op_sn_decode_puback,        0 },
+    { "decode suback",              op_sn_decode_suback,        0 },
+    { "decode unsuback",            op_sn_decode_unsuback,      0 },
+    { "decode ping",                op_sn_decode_ping,          0 },
+    { "decode disconnect",          op_sn_decode_disconnect,    0 },
+};
+#endif /* WOLFMQTT_SN */
+
+/* Runs one operation count times. The bytes per operation is the value
+ * returned by the encoder or decoder. */
+static int bench_run(const char* prefix, const BenchCase* bc, int count)
+{
+    int rc, len, i;
+    unsigned long allocs;
+    double start, elapsed;
+
+    len = bc->op();
+    if (len <= 0) {
+        PRINTF("%-6s %-28s: failed %d", prefix, bc->name, len);
+        return (len < 0) ? len : MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+
+    allocs = gBenchAllocs;
+    rc = len;
+    start = bench_time_sec();
+    for (i = 0; i < count && rc > 0; i++) {
+        rc = bc->op();
+    }
+    elapsed = bench_time_sec() - start;
+    allocs = gBenchAllocs - allocs;
+    if (rc <= 0) {
+        PRINTF("%-6s %-28s: failed %d", prefix, bc->name, rc);
+        return (rc < 0) ? rc : MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+
+    PRINTF("%-6s %-28s: %7.1f ns/op %8.1f MB/sec %5.2f allocs/op "
+        "(%d bytes)", prefix, bc->name, elapsed * 1e9 / count,
+        (double)len * count / elapsed / 1e6, (double)allocs / count, len);
+    return MQTT_CODE_SUCCESS;
+}
+
+static int bench_cases(const char* prefix, const BenchCase* cases, int num,
+    int count)
+{
+    int rc = MQTT_CODE_SUCCESS, i;
+
+    for (i = 0; i < num && rc == MQTT_CODE_SUCCESS; i++) {
+        if (cases[i].v5_only && mLevel < MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+            continue;
+        }
+        rc = bench_run(prefix, &cases[i], count);
+    }
+    return rc;
+}
+
+static int bench_level(const char* prefix, byte level, int count)
+{
+    int rc;
+
+    rc = bench_corpus(level);
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("%-6s setup failed %d", prefix, rc);
+        return rc;
+    }
+    return bench_cases(prefix, kPacketCases,
+        (int)(sizeof(kPacketCases) / sizeof(kPacketCases[0])), count);
+}
+
+static void usage(void)
+{
+    PRINTF("codecbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Operations per test, default 2000000");
+}
+
+int main(int argc, char** argv)
+{
+    int rc, i, count = 2000000;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("Codec benchmark: %d operations, %d byte payload", count,
+        (int)sizeof(kPayload));
+
+    /* Primitives use the v5 publish corpus for the properties */
+#ifdef WOLFMQTT_V5
+    rc = MqttProps_Init();
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = bench_corpus(MQTT_CONNECT_PROTOCOL_LEVEL_5);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttProps_ArenaInit(&mArena, mArenaProps,
+            (int)(sizeof(mArenaProps) / sizeof(mArenaProps[0])));
+    }
+#else
+    rc = bench_corpus(MQTT_CONNECT_PROTOCOL_LEVEL_4);
+#endif
+    if (rc == MQTT_CODE_SUCCESS) {
+        mVbiLen = op_encode_vbi();
+        XMEMCPY(mVbiBuf, mTxBuf, mVbiLen);
+        (void)op_encode_string();
+        XMEMCPY(mRefBuf, mTxBuf, BENCH_BUF_SIZE);
+        rc = bench_cases("", kPrimCases,
+            (int)(sizeof(kPrimCases) / sizeof(kPrimCases[0])), count);
+    }
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = bench_level("v3.1.1", MQTT_CONNECT_PROTOCOL_LEVEL_4, count);
+    }
+#ifdef WOLFMQTT_V5
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = bench_level("v5", MQTT_CONNECT_PROTOCOL_LEVEL_5, count);
+    }
+#endif
+#ifdef WOLFMQTT_SN
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = bench_sn_corpus();
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = bench_cases("SN", kSnCases,
+                (int)(sizeof(kSnCases) / sizeof(kSnCases[0])), count);
+        }
+    }
+#endif
+
+#ifdef WOLFMQTT_V5
+    MqttProps_ShutDown();
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,311 @@
+/* compressbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Payload compression benchmark.
+ * Publishes JSON telemetry payloads of 64 bytes to 64 KB through the client
+ * without the codec, with deflate and with deflate and a preset dictionary
+ * (MqttClient_SetCompress), counting the bytes written and the time per
+ * publish. The publish written is then received by a client with the same
+ * codec, timing the time per message and checking the payload. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_COMPRESS
+
+#define BENCH_BUF_SIZE      1024
+#define BENCH_MAX_PAYLOAD   (64 * 1024)
+#define BENCH_TOPIC         "wolfMQTT/bench/telemetry"
+
+enum BenchCodec {
+    BENCH_CODEC_NONE = 0,
+    BENCH_CODEC_DEFLATE,
+    BENCH_CODEC_DICT
+};
+static const char* kCodecName[] = { "none", "deflate", "deflate+dict" };
+
+static const word32 kSizes[] = { 64, 256, 1024, 4096, 16384, 65536 };
+
+/* Keys and common values of the telemetry records */
+static const char kDict[] =
+    "\"status\":\"ok\"},{\"device\":\"sensor-\",\"ts\":17000,\"seq\":"
+    ",\"temp\":2,\"humidity\":4,\"battery\":9,\"status\":\"ok\"}";
+
+typedef struct _CompressBenchCtx {
+    MqttClient      client;
+    MqttNet         net;
+    BenchNet        bnet;
+    MqttCompress    comp;
+    byte            tx_buf[BENCH_BUF_SIZE];
+    byte            rx_buf[BENCH_BUF_SIZE];
+    word32          recvd;
+    word32          mismatch;
+} CompressBenchCtx;
+
+static CompressBenchCtx mCtx;
+static byte mPayload[BENCH_MAX_PAYLOAD];
+static word32 mPayloadLen;
+static byte mCompTx[BENCH_MAX_PAYLOAD];
+static byte mCompRx[BENCH_MAX_PAYLOAD];
+static byte mCap[BENCH_MAX_PAYLOAD + 256];
+static int mCapLen;
+static word32 mPlainWire;
+static const byte kConnAck[] = { 0x20, 3, 0, 0, 0 };
+
+/* Simple deterministic generator, so all runs publish the same payload */
+static word32 bench_rand(word32* state)
+{
+    *state = *state * 1103515245UL + 12345UL;
+    return (*state >> 8) & 0xFFFFFF;
+}
+
+/* JSON array of sensor records, cut to len */
+static void bench_payload(word32 len)
+{
+    char rec[160];
+    word32 seed = 3, pos = 1, seq = 0;
+    int n;
+
+    mPayload[0] = '[';
+    while (pos < len) {
+        word32 r = bench_rand(&seed);
+        n = XSNPRINTF(rec, sizeof(rec), "%s{\"device\":\"sensor-%04u\","
+            "\"ts\":%u,\"seq\":%u,\"temp\":%u.%02u,\"humidity\":%u.%u,"
+            "\"battery\":%u,\"status\":\"ok\"}", (seq > 0) ? "," : "",
+            (unsigned)(r % 64), (unsigned)(1700000000UL + seq * 5),
+            (unsigned)seq, (unsigned)(18 + r % 8), (unsigned)((r >> 3) % 100),
+            (unsigned)(35 + (r >> 10) % 20), (unsigned)((r >> 15) % 10),
+            (unsigned)(90 + (r >> 18) % 10));
+        if ((word32)n > len - pos) {
+            n = (int)(len - pos);
+        }
+        XMEMCPY(&mPayload[pos], rec, n);
+        pos += (word32)n;
+        seq++;
+    }
+    mPayloadLen = len;
+}
+
+static int bench_init(CompressBenchCtx* ctx, int codec, MqttMsgCb msg_cb)
+{
+    int rc;
+    MqttConnect connect;
+
+    XMEMSET(ctx, 0, sizeof(CompressBenchCtx));
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, msg_cb,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc == MQTT_CODE_SUCCESS && codec != BENCH_CODEC_NONE) {
+        rc = MqttCompress_Init(&ctx->comp, mCompTx, sizeof(mCompTx), mCompRx,
+            sizeof(mCompRx), MQTT_COMPRESS_LEVEL_DEFAULT);
+        if (rc == MQTT_CODE_SUCCESS && codec == BENCH_CODEC_DICT) {
+            rc = MqttCompress_SetDict(&ctx->comp, (const byte*)kDict,
+                (word32)XSTRLEN(kDict));
+        }
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = MqttClient_SetCompress(&ctx->client, &ctx->comp);
+        }
+    }
+    ctx->client.ctx = ctx;
+    if (rc == MQTT_CODE_SUCCESS) {
+        ctx->bnet.rx = kConnAck;
+        ctx->bnet.rx_len = (int)sizeof(kConnAck);
+        XMEMSET(&connect, 0, sizeof(connect));
+        connect.client_id = "compressbench";
+        connect.keep_alive_sec = 60;
+        do {
+            rc = MqttClient_Connect(&ctx->client, &connect);
+        } while (rc == MQTT_CODE_CONTINUE);
+        ctx->bnet.rx = NULL;
+        ctx->bnet.rx_pos = 0;
+    }
+    return rc;
+}
+
+static void bench_free(CompressBenchCtx* ctx)
+{
+    MqttClient_DeInit(&ctx->client);
+    MqttCompress_Free(&ctx->comp);
+}
+
+/* Publishes count times, capturing the last publish written */
+static int run_pub(int codec, int count, word32* wire, double* elapsed)
+{
+    int rc, i;
+    word32 start_bytes;
+    double start;
+    CompressBenchCtx* ctx = &mCtx;
+    MqttPublish publish;
+
+    rc = bench_init(ctx, codec, NULL);
+    start_bytes = ctx->bnet.tx_bytes;
+    start = bench_time_sec();
+    for (i = 0; i < count && rc == MQTT_CODE_SUCCESS; i++) {
+        if (i == count - 1) {
+            ctx->bnet.cap = mCap;
+            ctx->bnet.cap_size = (int)sizeof(mCap);
+        }
+        XMEMSET(&publish, 0, sizeof(publish));
+        publish.qos = MQTT_QOS_0;
+        publish.topic_name = BENCH_TOPIC;
+        publish.buffer = mPayload;
+        publish.total_len = mPayloadLen;
+        /* Payloads larger than the buffer are sent by calling again */
+        do {
+            rc = MqttClient_Publish(&ctx->client, &publish);
+        } while (rc == MQTT_CODE_PUB_CONTINUE || rc == MQTT_CODE_CONTINUE);
+    }
+    *elapsed = bench_time_sec() - start;
+    *wire = (ctx->bnet.tx_bytes - start_bytes) / (word32)count;
+    mCapLen = ctx->bnet.cap_len;
+
+    bench_free(ctx);
+    return rc;
+}
+
+static int bench_msg_cb(MqttClient *client, MqttMessage *msg,
+    byte msg_new, byte msg_done)
+{
+    CompressBenchCtx* ctx = (CompressBenchCtx*)client->ctx;
+    (void)msg_new;
+
+    if (msg->total_len != mPayloadLen ||
+            msg->buffer_pos + msg->buffer_len > mPayloadLen ||
+            XMEMCMP(msg->buffer, &mPayload[msg->buffer_pos],
+                msg->buffer_len) != 0) {
+        ctx->mismatch++;
+    }
+    if (msg_done) {
+        ctx->recvd++;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Receives the captured publish count times */
+static int run_recv(int codec, int count, double* elapsed)
+{
+    int rc;
+    double start;
+    CompressBenchCtx* ctx = &mCtx;
+
+    rc = bench_init(ctx, codec, bench_msg_cb);
+    ctx->bnet.rx = mCap;
+    ctx->bnet.rx_len = mCapLen;
+
+    start = bench_time_sec();
+    while (ctx->recvd < (word32)count &&
+            (rc == MQTT_CODE_SUCCESS || rc == MQTT_CODE_CONTINUE)) {
+        rc = MqttClient_WaitMessage(&ctx->client, 1000);
+    }
+    *elapsed = bench_time_sec() - start;
+    if (rc == MQTT_CODE_SUCCESS && ctx->mismatch != 0) {
+        PRINTF("Received payload mismatch");
+        rc = MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+
+    bench_free(ctx);
+    return rc;
+}
+
+static int run_case(word32 size, int codec, int count)
+{
+    int rc;
+    word32 wire = 0;
+    double pub_sec = 0, recv_sec = 0;
+
+    rc = run_pub(codec, count, &wire, &pub_sec);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_recv(codec, count, &recv_sec);
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("%6u %-12s: failed %d (%s)", size, kCodecName[codec], rc,
+            MqttClient_ReturnCodeToString(rc));
+        return rc;
+    }
+    if (codec == BENCH_CODEC_NONE) {
+        mPlainWire = wire;
+    }
+
+    PRINTF("%6u %-12s: %6u bytes/msg (%5.1f%%), publish %8.2f us, "
+        "receive %8.2f us", size, kCodecName[codec], wire,
+        100.0 * (double)wire / (double)mPlainWire,
+        pub_sec * 1000000.0 / count, recv_sec * 1000000.0 / count);
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("compressbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Payload bytes per test in MB, default 16");
+}
+#endif /* WOLFMQTT_COMPRESS */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_COMPRESS
+    int i, codec, count, mb = 16;
+    word32 s;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            mb = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (mb < 1) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("Payload compression benchmark: %d MB per test, wire size "
+        "relative to uncompressed", mb);
+
+    for (s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]) && rc == 0; s++) {
+        bench_payload(kSizes[s]);
+        count = (int)(((word32)mb * 1024 * 1024) / kSizes[s]);
+        if (count > 200000) {
+            count = 200000;
+        }
+        for (codec = BENCH_CODEC_NONE; codec <= BENCH_CODEC_DICT &&
+                rc == 0; codec++) {
+            rc = run_case(kSizes[s], codec, count);
+        }
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires payload compression to be enabled
+       ./configure --enable-v5 --enable-compress */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
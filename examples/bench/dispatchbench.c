@@ -0,0 +1,394 @@
+/* dispatchbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Dispatcher benchmark and ordering check.
+ * The client reads a stream of numbered publishes on many topics and queues
+ * them to the dispatch workers (MqttClient_SetDispatch). Slow handlers keep
+ * the small worker queues full, so the reader waits for space and the
+ * workers wait for data. Each handler checks its topic is handled in the
+ * order sent. MqttDispatch_Free is called with messages still queued, and
+ * every message must have been handled once it returns. Build with
+ * -fsanitize=thread to check the worker ring and wait handshake. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_DISPATCH
+
+#define BENCH_BUF_SIZE      1024
+#define BENCH_TOPICS        16
+#define BENCH_STREAM_MSGS   (BENCH_TOPICS * 4)
+#define BENCH_PAYLOAD_LEN   32
+#define BENCH_TOPIC         "wolfMQTT/bench/dispatch/%02d"
+#define BENCH_TOPIC_LEN     26
+#define BENCH_POOL_BUFS     128
+
+typedef struct _DispBenchCtx {
+    MqttClient      client;
+    MqttNet         net;
+    BenchNet        bnet;
+    MqttDispatch    disp;
+#ifdef WOLFMQTT_MSG_POOL
+    MqttMsgPool     pool;
+#endif
+    byte            tx_buf[BENCH_BUF_SIZE];
+    byte            rx_buf[BENCH_BUF_SIZE];
+    int             work;
+
+    /* Per topic state, only used by the worker for that topic */
+    word32          topic_count[BENCH_TOPICS];
+    word32          topic_errors[BENCH_TOPICS];
+
+    wm_Sem          lock;
+    word32          handled;
+} DispBenchCtx;
+
+static DispBenchCtx mCtx;
+static byte mStream[BENCH_STREAM_MSGS * (BENCH_PAYLOAD_LEN + 64)];
+static int mStreamLen;
+
+/* Builds BENCH_STREAM_MSGS QoS 0 publishes, replayed by the bench network.
+ * Message i of the stream is on topic i % BENCH_TOPICS and its payload is
+ * i followed by a pattern from it. */
+static void build_stream(void)
+{
+    int i, j, pos = 0;
+    word32 remain;
+    char topic[32];
+
+    for (i = 0; i < BENCH_STREAM_MSGS; i++) {
+        (void)XSNPRINTF(topic, sizeof(topic), BENCH_TOPIC, i % BENCH_TOPICS);
+        remain = MQTT_DATA_LEN_SIZE + BENCH_TOPIC_LEN + BENCH_PAYLOAD_LEN;
+    #ifdef WOLFMQTT_V5
+        remain++; /* property length */
+    #endif
+        mStream[pos++] = MQTT_PACKET_TYPE_SET(MQTT_PACKET_TYPE_PUBLISH);
+        mStream[pos++] = (byte)remain;
+        mStream[pos++] = 0;
+        mStream[pos++] = BENCH_TOPIC_LEN;
+        XMEMCPY(&mStream[pos], topic, BENCH_TOPIC_LEN);
+        pos += BENCH_TOPIC_LEN;
+    #ifdef WOLFMQTT_V5
+        mStream[pos++] = 0;
+    #endif
+        mStream[pos++] = (byte)i;
+        for (j = 1; j < BENCH_PAYLOAD_LEN; j++) {
+            mStream[pos++] = (byte)(i * 31 + j);
+        }
+    }
+    mStreamLen = pos;
+}
+
+/* Called on a worker thread. Message n of topic t is stream message
+ * t + n * BENCH_TOPICS, wrapping at the end of the stream. */
+static int dispatch_handler(MqttDispatchMsg* msg, void* ctx)
+{
+    DispBenchCtx* bctx = (DispBenchCtx*)ctx;
+    int t, j, expect, bad = 0;
+
+    t = XATOI(&msg->topic_name[BENCH_TOPIC_LEN - 2]);
+    if (t < 0 || t >= BENCH_TOPICS || msg->client != &bctx->client) {
+        MqttDispatch_MsgFree(msg);
+        return MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+
+    expect = (int)((t + bctx->topic_count[t] * BENCH_TOPICS) %
+        BENCH_STREAM_MSGS);
+    if (msg->total_len != BENCH_PAYLOAD_LEN || msg->buffer[0] != expect) {
+        bad = 1;
+    }
+    for (j = 1; j < BENCH_PAYLOAD_LEN && !bad; j++) {
+        if (msg->buffer[j] != (byte)(expect * 31 + j)) {
+            bad = 1;
+        }
+    }
+    if (bad) {
+        bctx->topic_errors[t]++;
+    }
+    bctx->topic_count[t]++;
+    MqttDispatch_MsgFree(msg);
+
+    /* Slow handler, so the worker queue fills. The time varies by message,
+       so workers run at different rates. */
+    for (j = (expect * 7) % (2 * bctx->work + 1); j > 0; j--) {
+        BENCH_YIELD();
+    }
+
+    if (wm_SemLock(&bctx->lock) == 0) {
+        bctx->handled++;
+        (void)wm_SemUnlock(&bctx->lock);
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static word32 bench_handled(DispBenchCtx* ctx)
+{
+    word32 handled = 0;
+
+    if (wm_SemLock(&ctx->lock) == 0) {
+        handled = ctx->handled;
+        (void)wm_SemUnlock(&ctx->lock);
+    }
+    return handled;
+}
+
+static int bench_msg_cb(MqttClient *client, MqttMessage *msg,
+    byte msg_new, byte msg_done)
+{
+    /* All messages go to the dispatcher */
+    (void)client;
+    (void)msg;
+    (void)msg_new;
+    (void)msg_done;
+    return MQTT_CODE_ERROR_STAT;
+}
+
+/* Queues count messages to workers with the given queue depth. A non-zero
+ * work makes each handler yield that many times on average. */
+static int run_case(const char* desc, int workers, int depth, int work,
+    int pooled, word32 count)
+{
+    int rc, t;
+    word32 sent = 0, queued = 0, backlog, max_backlog = 0, errors = 0;
+    word32 handled;
+    double start, elapsed;
+    DispBenchCtx* ctx = &mCtx;
+
+    XMEMSET(ctx, 0, sizeof(DispBenchCtx));
+    ctx->work = work;
+    rc = wm_SemInit(&ctx->lock);
+    if (rc != 0) {
+        return MQTT_CODE_ERROR_SYSTEM;
+    }
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, bench_msg_cb,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    ctx->bnet.rx = mStream;
+    ctx->bnet.rx_len = mStreamLen;
+#ifdef WOLFMQTT_MSG_POOL
+    if (rc == MQTT_CODE_SUCCESS && pooled) {
+        rc = MqttMsgPool_Init(&ctx->pool, BENCH_POOL_BUFS, BENCH_BUF_SIZE);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = MqttClient_SetMsgPool(&ctx->client, &ctx->pool);
+        }
+    }
+#else
+    (void)pooled;
+#endif
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttDispatch_Init(&ctx->disp, workers, depth, dispatch_handler,
+            ctx);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_SetDispatch(&ctx->client, &ctx->disp);
+        if (rc != MQTT_CODE_SUCCESS) {
+            MqttDispatch_Free(&ctx->disp);
+        }
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        MqttClient_DeInit(&ctx->client);
+    #ifdef WOLFMQTT_MSG_POOL
+        if (pooled) {
+            (void)MqttMsgPool_Free(&ctx->pool);
+        }
+    #endif
+        (void)wm_SemFree(&ctx->lock);
+        PRINTF("%-18s: init failed %d (%s)", desc, rc,
+            MqttClient_ReturnCodeToString(rc));
+        return rc;
+    }
+
+    start = bench_time_sec();
+    while (sent < count && rc == MQTT_CODE_SUCCESS) {
+        /* Returns once the publish is queued to its worker */
+        rc = MqttClient_WaitMessage(&ctx->client, 1000);
+        if (rc == MQTT_CODE_SUCCESS) {
+            sent++;
+            backlog = sent - bench_handled(ctx);
+            if (backlog > max_backlog) {
+                max_backlog = backlog;
+            }
+        }
+    }
+
+    /* Free must handle all the messages still queued */
+    (void)MqttClient_SetDispatch(&ctx->client, NULL);
+    queued = sent - bench_handled(ctx);
+    MqttDispatch_Free(&ctx->disp);
+    elapsed = bench_time_sec() - start;
+    handled = bench_handled(ctx);
+
+    MqttClient_DeInit(&ctx->client);
+#ifdef WOLFMQTT_MSG_POOL
+    if (pooled && MqttMsgPool_Free(&ctx->pool) != MQTT_CODE_SUCCESS) {
+        PRINTF("%-18s: pooled buffers not released", desc);
+        errors++;
+    }
+#endif
+    (void)wm_SemFree(&ctx->lock);
+
+    for (t = 0; t < BENCH_TOPICS; t++) {
+        errors += ctx->topic_errors[t];
+    }
+    if (rc == MQTT_CODE_SUCCESS && (errors != 0 || handled != sent)) {
+        PRINTF("%-18s: %u of %u messages handled, %u out of order", desc,
+            handled, sent, errors);
+        rc = MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+    if (rc == MQTT_CODE_SUCCESS && work > 0 && max_backlog <= (word32)depth) {
+        /* a full queue plus the message being handled */
+        PRINTF("%-18s: worker queue never full", desc);
+        rc = MQTT_CODE_ERROR_STAT;
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        PRINTF("%-18s: %10.0f msg/sec, max backlog %4u, %4u queued at "
+            "free (%.3f sec)", desc, (double)handled / elapsed, max_backlog,
+            queued, elapsed);
+    }
+    else {
+        PRINTF("%-18s: failed %d (%s)", desc, rc,
+            MqttClient_ReturnCodeToString(rc));
+    }
+    return rc;
+}
+
+#ifdef WOLFMQTT_SUBTRIE
+/* A dispatcher and a subscription trie can not be set together */
+static int check_subtrie(void)
+{
+    int rc;
+    DispBenchCtx* ctx = &mCtx;
+    MqttSubTrie trie;
+
+    XMEMSET(ctx, 0, sizeof(DispBenchCtx));
+    XMEMSET(&trie, 0, sizeof(trie));
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, bench_msg_cb,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttDispatch_Init(&ctx->disp, 1, 0, dispatch_handler, ctx);
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        MqttClient_DeInit(&ctx->client);
+        return rc;
+    }
+    if (MqttClient_SetDispatch(&ctx->client, &ctx->disp) !=
+                MQTT_CODE_SUCCESS ||
+            MqttClient_SetSubTrie(&ctx->client, &trie) !=
+                MQTT_CODE_ERROR_BAD_ARG ||
+            MqttClient_SetDispatch(&ctx->client, NULL) != MQTT_CODE_SUCCESS ||
+            MqttClient_SetSubTrie(&ctx->client, &trie) != MQTT_CODE_SUCCESS ||
+            MqttClient_SetDispatch(&ctx->client, &ctx->disp) !=
+                MQTT_CODE_ERROR_BAD_ARG) {
+        rc = MQTT_CODE_ERROR_STAT;
+    }
+    (void)MqttClient_SetSubTrie(&ctx->client, NULL);
+    (void)MqttClient_SetDispatch(&ctx->client, NULL);
+    MqttDispatch_Free(&ctx->disp);
+    MqttClient_DeInit(&ctx->client);
+
+    PRINTF("%-18s: %s", "with subtrie",
+        (rc == MQTT_CODE_SUCCESS) ? "rejected" : "failed");
+    return rc;
+}
+#endif
+
+static void usage(void)
+{
+    PRINTF("dispatchbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Messages per test, default 200000");
+    PRINTF("-w <num>    Worker threads, default 4 (max %d)",
+        MQTT_DISPATCH_MAX_WORKERS);
+    PRINTF("-d <num>    Queue depth of the slow tests (power of two), "
+        "default 16");
+    PRINTF("-y <num>    Average handler yields in the slow tests, default 4");
+}
+#endif /* WOLFMQTT_DISPATCH */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_DISPATCH
+    int i, count = 200000, workers = 4, depth = 16, work = 4;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-w", 3) == 0 && i + 1 < argc) {
+            workers = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-d", 3) == 0 && i + 1 < argc) {
+            depth = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-y", 3) == 0 && i + 1 < argc) {
+            work = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1 || workers < 1 || workers > MQTT_DISPATCH_MAX_WORKERS ||
+            depth < 1 || (depth & (depth - 1)) != 0 || work < 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("Dispatch benchmark: %d messages on %d topics", count,
+        BENCH_TOPICS);
+    build_stream();
+
+    /* Slow handlers with small queues, then fast handlers */
+    rc = run_case("1 worker, slow", 1, depth, work, 0, (word32)count);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_case("workers, slow", workers, depth, work, 0,
+            (word32)count);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_case("workers, fast", workers, 0, 0, 0, (word32)count);
+    }
+#ifdef WOLFMQTT_MSG_POOL
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_case("workers, pooled", workers, depth, work, 1,
+            (word32)count);
+    }
+#endif
+#ifdef WOLFMQTT_SUBTRIE
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = check_subtrie();
+    }
+#endif
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires the dispatcher to be enabled
+       ./configure --enable-mt --enable-dispatch */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,641 @@
+/* dtlscidbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* MQTT-SN over DTLS 1.3 NAT rebinding benchmark.
+ * An MQTT-SN client connects over DTLS to a minimal gateway thread on UDP
+ * loopback and publishes with QoS 1. Between publishes the client socket is
+ * replaced by one on a new port, as a NAT rebinding does. With a connection
+ * ID the gateway finds the session from the ID in the records and follows
+ * the new address, so the next publish is simply acknowledged. Without one
+ * the gateway drops records from the unknown address and the client has to
+ * handshake and CONNECT again. The time from the rebinding to the next
+ * PUBACK is reported for both. The baseline does not include the time a
+ * client takes to notice the session is lost. Fails when a connection ID is
+ * not negotiated or a publish is not acknowledged. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#if defined(WOLFMQTT_SN) && defined(ENABLE_MQTT_TLS) && \
+    defined(WOLFSSL_DTLS13) && defined(WOLFSSL_DTLS_CID) && \
+    !defined(USE_WINDOWS_API)
+
+#include "wolfmqtt/mqtt_sn_client.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define BENCH_BUF_SIZE      1500
+#define BENCH_CID_SIZE      8
+#define BENCH_TOPIC_ID      1
+#define BENCH_CERT          "./certs/client-cert.pem"
+#define BENCH_KEY           "./certs/client-key.pem"
+
+/* Gateway side of the session */
+typedef struct _Gateway {
+    int         fd;
+    word16      port;
+    int         use_cid;
+    volatile int stop;
+    WOLFSSL_CTX *ctx;
+    WOLFSSL     *ssl;
+    int         accepted;
+    byte        cid[BENCH_CID_SIZE];
+    struct sockaddr_in peer;
+
+    /* datagram given to wolfSSL by the receive callback */
+    byte        rx[BENCH_BUF_SIZE];
+    int         rx_len;
+
+    word32      handshakes;     /* sessions established */
+    word32      migrations;     /* address changes followed */
+    word32      dropped;        /* datagrams from unknown addresses */
+} Gateway;
+
+/* Client socket, replaced on rebinding */
+typedef struct _ClientSock {
+    int         fd;
+    word16      gw_port;
+} ClientSock;
+
+static Gateway mGw;
+static ClientSock mSock;
+static MqttClient mClient;
+static MqttNet mNet;
+static byte mTxBuf[BENCH_BUF_SIZE];
+static byte mRxBuf[BENCH_BUF_SIZE];
+static word16 mPacketId;
+
+
+static int sock_wait(int fd, int timeout_ms)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, timeout_ms);
+}
+
+static int addr_equal(const struct sockaddr_in* a, const struct sockaddr_in* b)
+{
+    return a->sin_port == b->sin_port &&
+        a->sin_addr.s_addr == b->sin_addr.s_addr;
+}
+
+
+/* Minimal gateway: one DTLS session, acknowledges like a gateway */
+
+static int gw_io_recv(WOLFSSL* ssl, char* buf, int sz, void* ctx)
+{
+    Gateway* gw = (Gateway*)ctx;
+    int len = gw->rx_len;
+    (void)ssl;
+
+    if (len == 0) {
+        return WOLFSSL_CBIO_ERR_WANT_READ;
+    }
+    if (len > sz) {
+        len = sz;
+    }
+    XMEMCPY(buf, gw->rx, len);
+    gw->rx_len = 0;
+    return len;
+}
+
+static int gw_io_send(WOLFSSL* ssl, char* buf, int sz, void* ctx)
+{
+    Gateway* gw = (Gateway*)ctx;
+    (void)ssl;
+
+    if (sendto(gw->fd, buf, (size_t)sz, 0, (struct sockaddr*)&gw->peer,
+            sizeof(gw->peer)) != sz) {
+        return WOLFSSL_CBIO_ERR_GENERAL;
+    }
+    return sz;
+}
+
+static void gw_session_free(Gateway* gw)
+{
+    if (gw->ssl != NULL) {
+        wolfSSL_free(gw->ssl);
+        gw->ssl = NULL;
+    }
+    gw->accepted = 0;
+}
+
+static int gw_session_new(Gateway* gw, const struct sockaddr_in* from)
+{
+    gw_session_free(gw);
+    gw->ssl = wolfSSL_new(gw->ctx);
+    if (gw->ssl == NULL) {
+        return -1;
+    }
+    wolfSSL_SetIOReadCtx(gw->ssl, gw);
+    wolfSSL_SetIOWriteCtx(gw->ssl, gw);
+    wolfSSL_dtls_set_using_nonblock(gw->ssl, 1);
+    if (gw->use_cid && (wolfSSL_dtls_cid_use(gw->ssl) != WOLFSSL_SUCCESS ||
+            wolfSSL_dtls_cid_set(gw->ssl, gw->cid, BENCH_CID_SIZE) !=
+                WOLFSSL_SUCCESS)) {
+        gw_session_free(gw);
+        return -1;
+    }
+    gw->peer = *from;
+    return 0;
+}
+
+/* A plaintext handshake record of epoch 0 starts a new session */
+static int gw_is_client_hello(const byte* p, int len)
+{
+    return len > 13 && p[0] == 22 && p[3] == 0 && p[4] == 0;
+}
+
+/* Returns 1 when a datagram from an address that is not the peer belongs to
+   the session, found by the connection ID in it. The gateway is DTLS 1.3
+   only: a protected record has a unified header, 001CSLEE, with the ID
+   right after it when C is set (RFC 9147 4). */
+static int gw_cid_match(Gateway* gw, const byte* p, int len)
+{
+    if (!gw->use_cid || !gw->accepted ||
+            !wolfSSL_dtls_cid_is_enabled(gw->ssl)) {
+        return 0;
+    }
+    return len > 1 + BENCH_CID_SIZE && (p[0] & 0xE0) == 0x20 &&
+        (p[0] & 0x10) != 0 &&
+        XMEMCMP(&p[1], gw->cid, BENCH_CID_SIZE) == 0;
+}
+
+static void gw_reply(Gateway* gw, const byte* p, int len)
+{
+    byte ack[8];
+    int ack_len = 0;
+
+    if (len < 2 || p[0] != len) {
+        return;
+    }
+    switch (p[1]) {
+        case SN_MSG_TYPE_CONNECT:
+            ack[0] = 3; ack[1] = SN_MSG_TYPE_CONNACK; ack[2] = SN_RC_ACCEPTED;
+            ack_len = 3;
+            break;
+        case SN_MSG_TYPE_PUBLISH:
+            if (len < 7 || (p[2] & 0x60) != 0x20) break;
+            ack[0] = 7; ack[1] = SN_MSG_TYPE_PUBACK;
+            ack[2] = p[3]; ack[3] = p[4];
+            ack[4] = p[5]; ack[5] = p[6];
+            ack[6] = SN_RC_ACCEPTED;
+            ack_len = 7;
+            break;
+        case SN_MSG_TYPE_DISCONNECT:
+            ack[0] = 2; ack[1] = SN_MSG_TYPE_DISCONNECT;
+            ack_len = 2;
+            break;
+        default:
+            break;
+    }
+    if (ack_len > 0) {
+        (void)wolfSSL_write(gw->ssl, ack, ack_len);
+    }
+}
+
+static void gw_datagram(Gateway* gw, const struct sockaddr_in* from)
+{
+    byte app[BENCH_BUF_SIZE];
+    int ret, err;
+    int moved = (gw->ssl != NULL && !addr_equal(from, &gw->peer));
+
+    if (gw->ssl == NULL || (moved && gw_is_client_hello(gw->rx, gw->rx_len))) {
+        if (!gw_is_client_hello(gw->rx, gw->rx_len) ||
+                gw_session_new(gw, from) != 0) {
+            gw->dropped++;
+            gw->rx_len = 0;
+            return;
+        }
+        moved = 0;
+    }
+    else if (moved && !gw_cid_match(gw, gw->rx, gw->rx_len)) {
+        gw->dropped++;
+        gw->rx_len = 0;
+        return;
+    }
+
+    if (!gw->accepted) {
+        ret = wolfSSL_accept(gw->ssl);
+        if (ret == WOLFSSL_SUCCESS) {
+            gw->accepted = 1;
+            gw->handshakes++;
+        }
+        else {
+            err = wolfSSL_get_error(gw->ssl, ret);
+            if (err != WOLFSSL_ERROR_WANT_READ &&
+                    err != WOLFSSL_ERROR_WANT_WRITE) {
+                gw_session_free(gw);
+            }
+        }
+        gw->rx_len = 0;
+        return;
+    }
+
+    ret = wolfSSL_read(gw->ssl, app, sizeof(app));
+    if (ret > 0) {
+        /* Follow the address only once a record from it is authentic */
+        if (moved) {
+            gw->peer = *from;
+            gw->migrations++;
+        }
+        gw_reply(gw, app, ret);
+    }
+    else {
+        err = wolfSSL_get_error(gw->ssl, ret);
+        if (err != WOLFSSL_ERROR_WANT_READ &&
+                err != WOLFSSL_ERROR_WANT_WRITE) {
+            gw_session_free(gw);
+        }
+    }
+    gw->rx_len = 0;
+}
+
+static BENCH_THREAD_RET gw_thread(void* arg)
+{
+    Gateway* gw = (Gateway*)arg;
+    struct sockaddr_in from;
+    socklen_t from_len;
+    ssize_t len;
+
+    while (!gw->stop) {
+        if (sock_wait(gw->fd, 20) <= 0) {
+            continue;
+        }
+        from_len = sizeof(from);
+        len = recvfrom(gw->fd, gw->rx, sizeof(gw->rx), 0,
+            (struct sockaddr*)&from, &from_len);
+        if (len > 0) {
+            gw->rx_len = (int)len;
+            gw_datagram(gw, &from);
+        }
+    }
+    gw_session_free(gw);
+    return BENCH_THREAD_RET_VAL;
+}
+
+static int gw_init(Gateway* gw, int use_cid)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int i;
+
+    XMEMSET(gw, 0, sizeof(Gateway));
+    gw->use_cid = use_cid;
+    for (i = 0; i < BENCH_CID_SIZE; i++) {
+        gw->cid[i] = (byte)(0xC0 + i);
+    }
+
+    gw->ctx = wolfSSL_CTX_new(wolfDTLSv1_3_server_method());
+    if (gw->ctx == NULL ||
+            wolfSSL_CTX_use_certificate_file(gw->ctx, BENCH_CERT,
+                WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS ||
+            wolfSSL_CTX_use_PrivateKey_file(gw->ctx, BENCH_KEY,
+                WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS) {
+        PRINTF("Gateway certificate %s or key %s not loaded, run from the "
+            "wolfMQTT root", BENCH_CERT, BENCH_KEY);
+        return MQTT_CODE_ERROR_TLS_CONNECT;
+    }
+    wolfSSL_CTX_SetIORecv(gw->ctx, gw_io_recv);
+    wolfSSL_CTX_SetIOSend(gw->ctx, gw_io_send);
+
+    gw->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    XMEMSET(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (gw->fd < 0 ||
+            bind(gw->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+            getsockname(gw->fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    gw->port = ntohs(addr.sin_port);
+    return MQTT_CODE_SUCCESS;
+}
+
+static void gw_free(Gateway* gw)
+{
+    if (gw->fd >= 0) {
+        close(gw->fd);
+    }
+    if (gw->ctx != NULL) {
+        wolfSSL_CTX_free(gw->ctx);
+    }
+}
+
+
+/* MQTT-SN client network, a connected UDP socket */
+
+static int sock_open(word16 port)
+{
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (fd < 0) {
+        return -1;
+    }
+    XMEMSET(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* The NAT gives the client a new address: later datagrams come from a new
+   port and the old one no longer receives */
+static int sock_rebind(ClientSock* sock)
+{
+    int fd = sock_open(sock->gw_port);
+
+    if (fd < 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    close(sock->fd);
+    sock->fd = fd;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int Net_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    ClientSock* sock = (ClientSock*)context;
+    (void)host;
+    (void)timeout_ms;
+
+    sock->gw_port = port;
+    sock->fd = sock_open(port);
+    return (sock->fd < 0) ? MQTT_CODE_ERROR_NETWORK : MQTT_CODE_SUCCESS;
+}
+
+static int Net_Read(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    ClientSock* sock = (ClientSock*)context;
+    ssize_t len;
+
+    if (sock_wait(sock->fd, timeout_ms) <= 0) {
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    len = recv(sock->fd, buf, (size_t)buf_len, 0);
+    return (len < 0) ? MQTT_CODE_ERROR_NETWORK : (int)len;
+}
+
+static int Net_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    ClientSock* sock = (ClientSock*)context;
+    (void)timeout_ms;
+
+    if (send(sock->fd, buf, (size_t)buf_len, 0) != buf_len) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    return buf_len;
+}
+
+static int Net_Disconnect(void *context)
+{
+    ClientSock* sock = (ClientSock*)context;
+
+    if (sock->fd >= 0) {
+        close(sock->fd);
+        sock->fd = -1;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+
+/* DTLS handshake and MQTT-SN CONNECT */
+static int client_connect(int use_cid, double* handshake_ms)
+{
+    int rc;
+    SN_Connect connect;
+    double t = bench_time_sec();
+
+    /* Disconnect clears these, set them for each connection */
+    MqttClient_Flags(&mClient, 0, MQTT_CLIENT_FLAG_IS_DTLS |
+        (use_cid ? MQTT_CLIENT_FLAG_DTLS_CID : 0));
+    do {
+        rc = MqttClient_NetConnect(&mClient, "127.0.0.1", mGw.port, 1000, 1,
+            NULL);
+    } while (rc == MQTT_CODE_CONTINUE && bench_time_sec() - t < 5.0);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    if (handshake_ms != NULL) {
+        *handshake_ms = (bench_time_sec() - t) * 1000.0;
+    }
+    if (use_cid && !wolfSSL_dtls_cid_is_enabled(mClient.tls.ssl)) {
+        PRINTF("Connection ID not negotiated");
+        return MQTT_CODE_ERROR_TLS_CONNECT;
+    }
+
+    XMEMSET(&connect, 0, sizeof(connect));
+    connect.client_id = "dtlscid";
+    connect.protocol_level = SN_PROTOCOL_ID;
+    connect.keep_alive_sec = 60;
+    connect.clean_session = 1;
+    return SN_Client_Connect(&mClient, &connect);
+}
+
+static int client_publish(void)
+{
+    SN_Publish publish;
+    word16 topic_id = BENCH_TOPIC_ID;
+    byte payload[16];
+
+    XMEMSET(payload, 'p', sizeof(payload));
+    XMEMSET(&publish, 0, sizeof(publish));
+    publish.qos = MQTT_QOS_1;
+    publish.topic_type = SN_TOPIC_ID_TYPE_PREDEF;
+    publish.topic_name = (const char*)&topic_id;
+    if (++mPacketId == 0) {
+        mPacketId = 1;
+    }
+    publish.packet_id = mPacketId;
+    publish.buffer = payload;
+    publish.total_len = (word16)sizeof(payload);
+    return SN_Client_Publish(&mClient, &publish);
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int run_case(int use_cid, int count, double* lat)
+{
+    int rc, i;
+    double handshake_ms = 0, sum = 0, t;
+    BENCH_THREAD_T gw;
+
+    rc = gw_init(&mGw, use_cid);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_Init(&mClient, &mNet, NULL, mTxBuf, BENCH_BUF_SIZE,
+            mRxBuf, BENCH_BUF_SIZE, 1000);
+    }
+    if (rc == MQTT_CODE_SUCCESS &&
+            BENCH_THREAD_CREATE(&gw, gw_thread, &mGw) != 0) {
+        rc = MQTT_CODE_ERROR_SYSTEM;
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        gw_free(&mGw);
+        return rc;
+    }
+
+    rc = client_connect(use_cid, &handshake_ms);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = client_publish();
+    }
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < count; i++) {
+        rc = sock_rebind(&mSock);
+        t = bench_time_sec();
+        if (rc == MQTT_CODE_SUCCESS && !use_cid) {
+            /* The session is bound to the old address, start over */
+            (void)MqttClient_NetDisconnect(&mClient);
+            rc = client_connect(0, NULL);
+        }
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = client_publish();
+        }
+        lat[i] = (bench_time_sec() - t) * 1000.0;
+        sum += lat[i];
+    }
+
+    /* Each rebinding is followed (cid) or handshaken again (none) */
+    if (rc == MQTT_CODE_SUCCESS && (use_cid ?
+            mGw.migrations != (word32)count || mGw.handshakes != 1 :
+            mGw.handshakes != (word32)count + 1)) {
+        PRINTF("Gateway sessions %u, address changes %u, expected %s",
+            mGw.handshakes, mGw.migrations, use_cid ? "one session" :
+            "a session per rebinding");
+        rc = MQTT_CODE_ERROR_NOT_FOUND;
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        qsort(lat, (size_t)count, sizeof(double), cmp_double);
+        PRINTF("%-9s %-8s %9.2f  %7.3f %7.3f %7.3f  %5u %5u %5u",
+            use_cid ? "cid" : "none", wolfSSL_get_version(mClient.tls.ssl),
+            handshake_ms, sum / count, lat[count / 2], lat[count - 1],
+            mGw.handshakes, mGw.migrations, mGw.dropped);
+    }
+    else {
+        PRINTF("%-9s failed %d (%s) after %d rebindings",
+            use_cid ? "cid" : "none", rc, MqttClient_ReturnCodeToString(rc),
+            i);
+    }
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        (void)SN_Client_Disconnect(&mClient);
+    }
+    (void)MqttClient_NetDisconnect(&mClient);
+    mGw.stop = 1;
+    BENCH_THREAD_JOIN(gw);
+    MqttClient_DeInit(&mClient);
+    gw_free(&mGw);
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("dtlscidbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Rebindings per case, default 100");
+}
+#endif /* WOLFMQTT_SN && ENABLE_MQTT_TLS && WOLFSSL_DTLS13 &&
+          WOLFSSL_DTLS_CID && !USE_WINDOWS_API */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#if defined(WOLFMQTT_SN) && defined(ENABLE_MQTT_TLS) && \
+    defined(WOLFSSL_DTLS13) && defined(WOLFSSL_DTLS_CID) && \
+    !defined(USE_WINDOWS_API)
+    int i, count = 100;
+    double* lat;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1 || count > 60000) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    lat = (double*)WOLFMQTT_MALLOC(sizeof(double) * count);
+    if (lat == NULL) {
+        rc = MQTT_CODE_ERROR_MEMORY;
+    }
+    /* Kept initialized while the client connects and disconnects */
+    if (rc == 0 && wolfSSL_Init() != WOLFSSL_SUCCESS) {
+        WOLFMQTT_FREE(lat);
+        rc = MQTT_CODE_ERROR_TLS_CONNECT;
+    }
+    if (rc == 0) {
+        mSock.fd = -1;
+        mNet.context = &mSock;
+        mNet.connect = Net_Connect;
+        mNet.read = Net_Read;
+        mNet.write = Net_Write;
+        mNet.disconnect = Net_Disconnect;
+
+        PRINTF("MQTT-SN DTLS NAT rebinding benchmark: %d rebindings, "
+            "QoS 1 publish after each", count);
+        PRINTF("conn id   version  handshake  recovery ms: mean     p50     "
+            "max  hshk   moved dropped");
+        rc = run_case(1, count, lat);
+        if (rc == 0) {
+            rc = run_case(0, count, lat);
+        }
+        WOLFMQTT_FREE(lat);
+        wolfSSL_Cleanup();
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires MQTT-SN and wolfSSL built with DTLS 1.3 and
+       connection IDs
+       wolfSSL: ./configure --enable-dtls --enable-dtls13 --enable-dtlscid
+       wolfMQTT: ./configure --enable-sn */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
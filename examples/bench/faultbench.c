@@ -0,0 +1,705 @@
+/* faultbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Bad network benchmark.
+ * One client, its socket wrapped by the fault injecting network, runs
+ * against a broker once for each network profile: clean, latency, jitter,
+ * a rate limit, partial reads and writes, breaks after some bytes and all
+ * of them together, or one profile given by the options. Each run measures
+ * the connect time, the ping round trip, the QoS 1 messages per second of
+ * a stream the client publishes to its own topic (reconnecting and
+ * publishing again, as a duplicate, when the connection breaks), the
+ * recovery time after the connection is closed and, with a keep alive, the
+ * time the keep alive takes to find a silent break.
+ * Fails when a connect fails or the stream cannot recover. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "examples/mqttnet.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_FAULTNET
+
+#include <stdlib.h>
+#ifndef USE_WINDOWS_API
+    #include <signal.h>
+    #include <netinet/tcp.h>
+#endif
+
+#define FAULT_BUF_SIZE      4096
+#define FAULT_MAX_PAYLOAD   (FAULT_BUF_SIZE - 128)
+#define FAULT_MAX_RETRY     5           /* reconnects of one failure */
+#define FAULT_POLL_MS       100
+#define FAULT_DRAIN_SEC     5.0         /* wait for late echoes */
+#define FAULT_TOPIC_PREFIX  "wolfMQTT/bench/fault"
+
+enum FaultFormat {
+    FAULT_FMT_TEXT = 0,
+    FAULT_FMT_JSON
+};
+
+/* Network of a run */
+typedef struct _FaultProfile {
+    const char *name;
+    word32      latency_ms;
+    word32      jitter_ms;
+    word32      rate;
+    word32      max_write;
+    word32      max_read;
+    word32      break_bytes;
+} FaultProfile;
+
+static const FaultProfile mProfiles[] = {
+    { "clean",   0,  0,     0, 0, 0,     0 },
+    { "latency", 50, 0,     0, 0, 0,     0 },
+    { "jitter",  50, 50,    0, 0, 0,     0 },
+    { "rate",    0,  0, 32768, 0, 0,     0 },
+    { "partial", 0,  0,     0, 7, 3,     0 },
+    { "breaks",  0,  0,     0, 0, 0, 32768 },
+    { "bad",     50, 50, 32768, 7, 3, 65536 }
+};
+#define FAULT_PROFILES  (int)(sizeof(mProfiles) / sizeof(mProfiles[0]))
+
+typedef struct _FaultResult {
+    double      connect_ms;
+    double      ping_ms;
+    double      msgs_sec;
+    double      recover_ms;     /* mean, from close to subscribed */
+    double      detect_ms;      /* of the silent break */
+    word32      echoed;
+    word32      dup;
+    word32      reconnects;     /* by the stream */
+    word32      delayed;
+} FaultResult;
+
+typedef struct _FaultBench {
+    MQTTCtx     ctx;            /* client, socket and TLS settings */
+    MqttNet     fault_net;
+    MqttFaultNet fault;
+    byte        tx_buf[FAULT_BUF_SIZE];
+    byte        rx_buf[FAULT_BUF_SIZE];
+    byte        payload[FAULT_MAX_PAYLOAD];
+    char        client_id[32];
+    char        topic[64];
+    byte       *seen;           /* echoes by sequence */
+    word32      rx_seq;
+    word32      echoed;
+    word32      dup;
+    word32      bad;
+    double      last_rx;
+    byte        net_init;
+    byte        inited;
+    byte        connected;
+} FaultBench;
+
+static const char* mHost = "localhost";
+static word16 mPort = 0;         /* zero for the default of the transport */
+#ifdef ENABLE_MQTT_TLS
+static const char* mCaFile = NULL;
+static int mTls = 0;
+#endif
+static int mCount = 100;
+static int mSize = 256;
+static int mPings = 10;
+static int mBreaks = 3;
+static int mKeepAlive = 2;
+static int mTimeoutMs = 1000;
+static int mFormat = FAULT_FMT_TEXT;
+static word32 mRunId;
+static FaultBench mBench;
+
+/* Calls until done, a blocking build returns at once. Non-blocking, the
+ * timeout is kept here. */
+#define FAULT_LOOP(rc, call, timeout_ms)                            \
+    do {                                                            \
+        double end_ = bench_time_sec() + (timeout_ms) / 1000.0;     \
+        while (((rc) = (call)) == MQTT_CODE_CONTINUE) {             \
+            if (bench_time_sec() >= end_) {                         \
+                (rc) = MQTT_CODE_ERROR_TIMEOUT;                     \
+                break;                                              \
+            }                                                       \
+            BENCH_YIELD();                                          \
+        }                                                           \
+    } while (0)
+
+
+static int msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    FaultBench *b = (FaultBench*)((MQTTCtx*)client->ctx)->app_ctx;
+
+    if (msg_new) {
+        b->rx_seq = (word32)mCount;
+        if (msg->buffer_len >= sizeof(word32)) {
+            XMEMCPY(&b->rx_seq, msg->buffer, sizeof(word32));
+        }
+    }
+    if (msg_done) {
+        b->last_rx = bench_time_sec();
+        if (b->rx_seq >= (word32)mCount ||
+                msg->total_len != (word32)mSize) {
+            b->bad++;
+        }
+        else if (b->seen[b->rx_seq]) {
+            b->dup++;
+        }
+        else {
+            b->seen[b->rx_seq] = 1;
+            b->echoed++;
+        }
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int client_init(FaultBench *b)
+{
+    int rc;
+
+    rc = MqttClient_Init(&b->ctx.client, &b->fault_net, msg_cb, b->tx_buf,
+        FAULT_BUF_SIZE, b->rx_buf, FAULT_BUF_SIZE, mTimeoutMs);
+    b->inited = (rc == MQTT_CODE_SUCCESS);
+    if (rc == MQTT_CODE_SUCCESS) {
+        b->ctx.client.ctx = &b->ctx;
+    }
+    return rc;
+}
+
+static int client_setup(FaultBench *b, const FaultProfile *p)
+{
+    MQTTCtx *ctx = &b->ctx;
+    MqttFaultCfg cfg;
+    int rc;
+
+    mqtt_init_ctx(ctx);
+    ctx->app_name = "faultbench";
+    ctx->app_ctx = b;
+    ctx->host = mHost;
+#ifdef ENABLE_MQTT_TLS
+    ctx->use_tls = mTls;
+    ctx->ca_file = mCaFile;
+#endif
+    ctx->port = (mPort != 0) ? mPort :
+        (ctx->use_tls ? MQTT_SECURE_PORT : MQTT_DEFAULT_PORT);
+    ctx->debug_on = 0;
+    ctx->test_mode = 1;         /* no stdin wake */
+    ctx->cmd_timeout_ms = mTimeoutMs;
+    XSNPRINTF(b->client_id, sizeof(b->client_id), "fault%08x", mRunId);
+    XSNPRINTF(b->topic, sizeof(b->topic), "%s/%08x", FAULT_TOPIC_PREFIX,
+        mRunId);
+
+    XMEMSET(&cfg, 0, sizeof(cfg));
+    cfg.latency_ms = p->latency_ms;
+    cfg.jitter_ms = p->jitter_ms;
+    cfg.rate = p->rate;
+    cfg.max_write = p->max_write;
+    cfg.max_read = p->max_read;
+    cfg.break_after_bytes = p->break_bytes;
+    cfg.seed = mRunId;
+
+    rc = MqttClientNet_Init(&ctx->net, ctx);
+    b->net_init = (rc == MQTT_CODE_SUCCESS);
+    if (rc == MQTT_CODE_SUCCESS) {
+        /* The client uses the socket through the faults */
+        rc = MqttFaultNet_Init(&b->fault_net, &b->fault, &ctx->net, &cfg);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = client_init(b);
+    }
+    return rc;
+}
+
+static int client_connect(FaultBench *b)
+{
+    MQTTCtx *ctx = &b->ctx;
+    SocketContext *sock = (SocketContext*)ctx->net.context;
+    int rc, on = 1;
+
+    FAULT_LOOP(rc, MqttClient_NetConnect(&ctx->client, ctx->host, ctx->port,
+        mTimeoutMs, ctx->use_tls, mqtt_tls_cb), mTimeoutMs);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    b->connected = 1;
+    /* Small packets are sent at once, the faults alone delay them */
+    (void)setsockopt(sock->fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&on,
+        sizeof(on));
+
+    XMEMSET(&ctx->connect, 0, sizeof(ctx->connect));
+    ctx->connect.keep_alive_sec = (word16)mKeepAlive;
+    ctx->connect.clean_session = 1;
+    ctx->connect.client_id = b->client_id;
+    FAULT_LOOP(rc, MqttClient_Connect(&ctx->client, &ctx->connect),
+        mTimeoutMs);
+    if (rc == MQTT_CODE_SUCCESS && ctx->connect.ack.return_code !=
+            MQTT_CONNECT_ACK_CODE_ACCEPTED) {
+        rc = MQTT_CODE_ERROR_SERVER_PROP;
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    XMEMSET(ctx->topics, 0, sizeof(ctx->topics));
+    ctx->topics[0].topic_filter = b->topic;
+    ctx->topics[0].qos = MQTT_QOS_1;
+    XMEMSET(&ctx->subscribe, 0, sizeof(ctx->subscribe));
+    ctx->subscribe.packet_id = 1;
+    ctx->subscribe.topic_count = 1;
+    ctx->subscribe.topics = ctx->topics;
+    FAULT_LOOP(rc, MqttClient_Subscribe(&ctx->client, &ctx->subscribe),
+        mTimeoutMs);
+    if (rc == MQTT_CODE_SUCCESS &&
+            ctx->topics[0].return_code > MQTT_QOS_2) {
+        rc = MQTT_CODE_ERROR_SERVER_PROP;
+    }
+    return rc;
+}
+
+/* Connects again on a new client, as an application would after a failure,
+ * returns MQTT_CODE_SUCCESS once subscribed */
+static int client_reconnect(FaultBench *b)
+{
+    int rc = MQTT_CODE_ERROR_NETWORK, tries;
+
+    for (tries = 0; rc != MQTT_CODE_SUCCESS && tries < FAULT_MAX_RETRY;
+            tries++) {
+        if (b->connected) {
+            (void)MqttClient_NetDisconnect(&b->ctx.client);
+            b->connected = 0;
+        }
+        if (b->inited) {
+            MqttClient_DeInit(&b->ctx.client);
+            b->inited = 0;
+        }
+        rc = client_init(b);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = client_connect(b);
+        }
+    }
+    return rc;
+}
+
+static int client_ping(FaultBench *b)
+{
+    MqttPing ping;
+    int rc;
+
+    XMEMSET(&ping, 0, sizeof(ping));
+    FAULT_LOOP(rc, MqttClient_Ping_ex(&b->ctx.client, &ping), mTimeoutMs);
+    return rc;
+}
+
+static int client_publish(FaultBench *b, word32 seq, byte dup)
+{
+    MqttPublish publish;
+    int rc;
+
+    XMEMCPY(b->payload, &seq, sizeof(word32));
+    XMEMSET(&publish, 0, sizeof(publish));
+    publish.qos = MQTT_QOS_1;
+    publish.duplicate = dup;
+    publish.topic_name = b->topic;
+    publish.packet_id = (word16)(seq % 0xFFFF + 1);
+    publish.buffer = b->payload;
+    publish.total_len = (word32)mSize;
+    FAULT_LOOP(rc, MqttClient_Publish(&b->ctx.client, &publish),
+        mTimeoutMs);
+    return rc;
+}
+
+static void client_cleanup(FaultBench *b)
+{
+    MQTTCtx *ctx = &b->ctx;
+    int rc;
+
+    if (b->connected) {
+        XMEMSET(&ctx->disconnect, 0, sizeof(ctx->disconnect));
+        FAULT_LOOP(rc, MqttClient_Disconnect_ex(&ctx->client,
+            &ctx->disconnect), mTimeoutMs);
+        (void)rc;
+        (void)MqttClient_NetDisconnect(&ctx->client);
+        b->connected = 0;
+    }
+    if (b->inited) {
+        MqttClient_DeInit(&ctx->client);
+        b->inited = 0;
+    }
+    if (b->net_init) {
+        (void)MqttClientNet_DeInit(&ctx->net);
+        b->net_init = 0;
+    }
+}
+
+/* QoS 1 stream to the own topic, reconnecting on a failure */
+static int run_stream(FaultBench *b, FaultResult *res)
+{
+    double start, end;
+    word32 seq;
+    byte dup = 0;
+    int rc = MQTT_CODE_SUCCESS;
+
+    XMEMSET(b->seen, 0, (size_t)mCount);
+    b->echoed = b->dup = b->bad = 0;
+    start = bench_time_sec();
+    b->last_rx = start;
+    for (seq = 0; seq < (word32)mCount; ) {
+        rc = client_publish(b, seq, dup);
+        if (rc == MQTT_CODE_SUCCESS) {
+            seq++;
+            dup = 0;
+            continue;
+        }
+        res->reconnects++;
+        rc = client_reconnect(b);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+        /* Maybe received, so a duplicate */
+        dup = 1;
+    }
+
+    /* Echoes still on the way */
+    end = bench_time_sec() + FAULT_DRAIN_SEC;
+    while (b->echoed < (word32)mCount && bench_time_sec() < end) {
+        FAULT_LOOP(rc, MqttClient_WaitMessage(&b->ctx.client,
+            FAULT_POLL_MS), FAULT_POLL_MS);
+        if (rc != MQTT_CODE_SUCCESS && rc != MQTT_CODE_ERROR_TIMEOUT) {
+            break;
+        }
+    }
+    res->echoed = b->echoed;
+    res->dup = b->dup;
+    if (b->echoed > 0 && b->last_rx > start) {
+        res->msgs_sec = b->echoed / (b->last_rx - start);
+    }
+    return (b->bad == 0) ? MQTT_CODE_SUCCESS : MQTT_CODE_ERROR_MALFORMED_DATA;
+}
+
+/* Closed connection: the next ping fails and the client connects again */
+static int run_recover(FaultBench *b, FaultResult *res)
+{
+    double start, total = 0;
+    int i, rc = MQTT_CODE_SUCCESS;
+
+    for (i = 0; i < mBreaks; i++) {
+        start = bench_time_sec();
+        MqttFaultNet_Break(&b->fault, 0);
+        rc = client_ping(b);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = MQTT_CODE_ERROR_NETWORK;
+            break;
+        }
+        rc = client_reconnect(b);
+        if (rc != MQTT_CODE_SUCCESS) {
+            break;
+        }
+        total += bench_time_sec() - start;
+    }
+    if (i > 0) {
+        res->recover_ms = total * 1000.0 / i;
+    }
+    return rc;
+}
+
+/* Silent break: idle until the keep alive ping goes unanswered */
+static int run_detect(FaultBench *b, FaultResult *res)
+{
+    double start, end;
+    int rc;
+
+    start = bench_time_sec();
+    end = start + 4.0 * mKeepAlive + 2.0 * mTimeoutMs / 1000.0;
+    MqttFaultNet_Break(&b->fault, 1);
+    do {
+        FAULT_LOOP(rc, MqttClient_WaitMessage(&b->ctx.client,
+            mKeepAlive * 1000), mKeepAlive * 1000);
+        if (rc == MQTT_CODE_ERROR_TIMEOUT) {
+            /* Idle for the keep alive */
+            rc = client_ping(b);
+        }
+    } while (rc == MQTT_CODE_SUCCESS && bench_time_sec() < end);
+    if (rc == MQTT_CODE_SUCCESS) {
+        /* Never found */
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    res->detect_ms = (bench_time_sec() - start) * 1000.0;
+    return client_reconnect(b);
+}
+
+static void print_header(void)
+{
+    if (mFormat == FAULT_FMT_TEXT) {
+        PRINTF("Payload %d bytes, %d messages, keep alive %d s, timeout "
+            "%d ms", mSize, mCount, mKeepAlive, mTimeoutMs);
+        PRINTF("%-8s %9s %8s %10s %8s %6s %10s %10s", "Profile",
+            "Conn ms", "Ping ms", "QoS1 msg/s", "Echoed", "Reconn",
+            "Recover ms", "Detect ms");
+    }
+}
+
+static void print_result(const FaultProfile *p, const FaultResult *res,
+    int rc)
+{
+    if (mFormat == FAULT_FMT_JSON) {
+        PRINTF("{\"profile\":\"%s\",\"latency_ms\":%u,\"jitter_ms\":%u,"
+            "\"rate\":%u,\"max_write\":%u,\"max_read\":%u,"
+            "\"break_bytes\":%u,\"connect_ms\":%.2f,\"ping_ms\":%.2f,"
+            "\"msgs_sec\":%.1f,\"echoed\":%u,\"dup\":%u,\"reconnects\":%u,"
+            "\"recover_ms\":%.2f,\"detect_ms\":%.1f,\"delayed\":%u,"
+            "\"rc\":%d}",
+            p->name, p->latency_ms, p->jitter_ms, p->rate, p->max_write,
+            p->max_read, p->break_bytes, res->connect_ms, res->ping_ms,
+            res->msgs_sec, res->echoed, res->dup, res->reconnects,
+            res->recover_ms, res->detect_ms, res->delayed, rc);
+    }
+    else {
+        PRINTF("%-8s %9.2f %8.2f %10.1f %4u/%-3d %6u %10.2f %10.1f%s",
+            p->name, res->connect_ms, res->ping_ms, res->msgs_sec,
+            res->echoed, mCount, res->reconnects, res->recover_ms,
+            res->detect_ms, (rc == MQTT_CODE_SUCCESS) ? "" : "  FAILED");
+        if (rc != MQTT_CODE_SUCCESS) {
+            PRINTF("  %s (%d)", MqttClient_ReturnCodeToString(rc), rc);
+        }
+    }
+}
+
+static int run_profile(const FaultProfile *p)
+{
+    FaultBench *b = &mBench;
+    FaultResult res;
+    double start;
+    int i, rc;
+
+    XMEMSET(&res, 0, sizeof(res));
+    start = bench_time_sec();
+    rc = client_setup(b, p);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = client_connect(b);
+    }
+    res.connect_ms = (bench_time_sec() - start) * 1000.0;
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        start = bench_time_sec();
+        for (i = 0; i < mPings && rc == MQTT_CODE_SUCCESS; i++) {
+            rc = client_ping(b);
+        }
+        if (i > 0) {
+            res.ping_ms = (bench_time_sec() - start) * 1000.0 / i;
+        }
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_stream(b, &res);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_recover(b, &res);
+    }
+    if (rc == MQTT_CODE_SUCCESS && mKeepAlive > 0) {
+        rc = run_detect(b, &res);
+    }
+    res.delayed = b->fault.stats.delayed;
+
+    client_cleanup(b);
+    print_result(p, &res, rc);
+    return rc;
+}
+
+static void usage(void)
+{
+    int i;
+
+    PRINTF("faultbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-h <host>   Broker host, default localhost");
+    PRINTF("-p <num>    Broker port, default %d (%d with TLS)",
+        MQTT_DEFAULT_PORT, MQTT_SECURE_PORT);
+    PRINTF("-P <name>   Profile, default all:");
+    for (i = 0; i < FAULT_PROFILES; i++) {
+        PRINTF("            %-8s latency %u, jitter %u ms, rate %u B/s, "
+            "write %u, read %u, break %u bytes", mProfiles[i].name,
+            mProfiles[i].latency_ms, mProfiles[i].jitter_ms,
+            mProfiles[i].rate, mProfiles[i].max_write,
+            mProfiles[i].max_read, mProfiles[i].break_bytes);
+    }
+    PRINTF("-L <ms>     Latency, any of -L -J -R -W -X -B runs one custom "
+        "profile");
+    PRINTF("-J <ms>     Jitter, up to");
+    PRINTF("-R <num>    Bytes per second each way");
+    PRINTF("-W <num>    Most bytes per write");
+    PRINTF("-X <num>    Most bytes per read");
+    PRINTF("-B <num>    Break after bytes");
+    PRINTF("-n <num>    QoS 1 messages, default 100");
+    PRINTF("-s <num>    Payload bytes (%d to %d), default 256",
+        (int)sizeof(word32), FAULT_MAX_PAYLOAD);
+    PRINTF("-i <num>    Pings, default 10");
+    PRINTF("-b <num>    Closed connections, default 3");
+    PRINTF("-k <sec>    Keep alive, default 2, 0 skips the silent break");
+    PRINTF("-T <ms>     Command timeout, default 1000");
+#ifdef ENABLE_MQTT_TLS
+    PRINTF("-t          TLS");
+    PRINTF("-A <file>   CA certificate file");
+#endif
+    PRINTF("-f <fmt>    Output text or json, default text");
+}
+
+int main(int argc, char** argv)
+{
+    FaultProfile custom;
+    const char *name = NULL;
+    int i, rc = 0, bad_arg = 0, use_custom = 0, ran = 0;
+
+    XMEMSET(&custom, 0, sizeof(custom));
+    custom.name = "custom";
+    for (i = 1; i < argc && !bad_arg; i++) {
+        if (XSTRNCMP(argv[i], "-t", 3) == 0) {
+        #ifdef ENABLE_MQTT_TLS
+            mTls = 1;
+        #else
+            bad_arg = 1;
+        #endif
+        }
+        else if (i + 1 >= argc) {
+            bad_arg = 1;
+        }
+        else if (XSTRNCMP(argv[i], "-h", 3) == 0) {
+            mHost = argv[++i];
+        }
+        else if (XSTRNCMP(argv[i], "-p", 3) == 0) {
+            mPort = (word16)XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-P", 3) == 0) {
+            name = argv[++i];
+        }
+        else if (XSTRNCMP(argv[i], "-L", 3) == 0) {
+            custom.latency_ms = (word32)XATOI(argv[++i]);
+            use_custom = 1;
+        }
+        else if (XSTRNCMP(argv[i], "-J", 3) == 0) {
+            custom.jitter_ms = (word32)XATOI(argv[++i]);
+            use_custom = 1;
+        }
+        else if (XSTRNCMP(argv[i], "-R", 3) == 0) {
+            custom.rate = (word32)XATOI(argv[++i]);
+            use_custom = 1;
+        }
+        else if (XSTRNCMP(argv[i], "-W", 3) == 0) {
+            custom.max_write = (word32)XATOI(argv[++i]);
+            use_custom = 1;
+        }
+        else if (XSTRNCMP(argv[i], "-X", 3) == 0) {
+            custom.max_read = (word32)XATOI(argv[++i]);
+            use_custom = 1;
+        }
+        else if (XSTRNCMP(argv[i], "-B", 3) == 0) {
+            custom.break_bytes = (word32)XATOI(argv[++i]);
+            use_custom = 1;
+        }
+        else if (XSTRNCMP(argv[i], "-n", 3) == 0) {
+            mCount = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-s", 3) == 0) {
+            mSize = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-i", 3) == 0) {
+            mPings = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-b", 3) == 0) {
+            mBreaks = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-k", 3) == 0) {
+            mKeepAlive = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-T", 3) == 0) {
+            mTimeoutMs = XATOI(argv[++i]);
+        }
+    #ifdef ENABLE_MQTT_TLS
+        else if (XSTRNCMP(argv[i], "-A", 3) == 0) {
+            mCaFile = argv[++i];
+        }
+    #endif
+        else if (XSTRNCMP(argv[i], "-f", 3) == 0) {
+            i++;
+            if (XSTRNCMP(argv[i], "json", 5) == 0) {
+                mFormat = FAULT_FMT_JSON;
+            }
+            else if (XSTRNCMP(argv[i], "text", 5) != 0) {
+                bad_arg = 1;
+            }
+        }
+        else {
+            bad_arg = 1;
+        }
+    }
+    if (bad_arg || mCount < 1 || mSize < (int)sizeof(word32) ||
+            mSize > FAULT_MAX_PAYLOAD || mPings < 0 || mBreaks < 0 ||
+            mKeepAlive < 0 || mKeepAlive > 0xFFFF || mTimeoutMs < 1) {
+        usage();
+        return (argc == 2 && XSTRNCMP(argv[1], "-?", 3) == 0) ? 0 :
+            EXIT_FAILURE;
+    }
+    mBench.seen = (byte*)WOLFMQTT_MALLOC((size_t)mCount);
+    if (mBench.seen == NULL) {
+        PRINTF("Out of memory");
+        return EXIT_FAILURE;
+    }
+#ifndef USE_WINDOWS_API
+    /* A connection closed by the broker is reported, not fatal */
+    (void)signal(SIGPIPE, SIG_IGN);
+#endif
+    /* Topics and client ids differ from other runs on a shared broker */
+    mRunId = (word32)(bench_time_sec() * 1000.0);
+
+    print_header();
+    if (use_custom) {
+        ran = 1;
+        rc = run_profile(&custom);
+    }
+    for (i = 0; !use_custom && i < FAULT_PROFILES; i++) {
+        if (name == NULL ||
+                XSTRNCMP(name, mProfiles[i].name, 16) == 0) {
+            ran = 1;
+            if (run_profile(&mProfiles[i]) != MQTT_CODE_SUCCESS) {
+                rc = -1;
+            }
+        }
+    }
+    WOLFMQTT_FREE(mBench.seen);
+    if (!ran) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
+
+#else
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    PRINTF("Example not compiled in!");
+    return 0;
+}
+
+#endif /* WOLFMQTT_FAULTNET */
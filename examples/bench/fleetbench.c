@@ -0,0 +1,1076 @@
+/* fleetbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Fleet load generator.
+ * Simulates a fleet of devices from one process and one thread: N
+ * non-blocking MqttClient connect to a broker at a set rate, optionally
+ * subscribe, then each publishes at a set interval, all driven by a poll()
+ * event loop. Each client has a small state machine and runs one operation
+ * at a time; it reads only when its socket is readable. Reports the
+ * distribution of the connect times (TCP or TLS connect to CONNACK), the
+ * messages published and received per second once the fleet is connected,
+ * and the memory of a client: its structures and buffers, and the growth of
+ * the resident memory of the process per connected client.
+ * Fails when a client could not connect or was disconnected. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "examples/mqttexample.h"
+#include "benchcommon.h"
+
+#if defined(WOLFMQTT_NONBLOCK) && !defined(USE_WINDOWS_API)
+    #define FLEET_ENABLED
+#endif
+
+#ifdef FLEET_ENABLED
+
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL    0       /* SIGPIPE is ignored */
+#endif
+
+#define FLEET_MAX_CLIENTS   200000
+#define FLEET_MAX_PAYLOAD   (64 * 1024)
+#define FLEET_HDR_SIZE      128         /* topic and header of a publish */
+#define FLEET_TIMEOUT_MS    5000
+#define FLEET_POLL_MS       10
+#define FLEET_STEP_MAX      8           /* operations per client per event */
+#define FLEET_FD_SPARE      32
+#define FLEET_TOPIC_PREFIX  "wolfMQTT/fleet"
+
+enum FleetFormat {
+    FLEET_FMT_TEXT = 0,
+    FLEET_FMT_JSON
+};
+
+/* Life of a client */
+enum FleetState {
+    FLEET_ST_IDLE = 0,          /* connect not started yet */
+    FLEET_ST_NET,               /* TCP and TLS connect */
+    FLEET_ST_CONNECT,           /* MQTT connect, waiting for CONNACK */
+    FLEET_ST_SUBSCRIBE,
+    FLEET_ST_RUN,
+    FLEET_ST_CLOSED             /* failed or done */
+};
+
+/* Operation of a running client */
+enum FleetTask {
+    FLEET_TASK_NONE = 0,
+    FLEET_TASK_WAIT,            /* reading a packet from the broker */
+    FLEET_TASK_PUBLISH,
+    FLEET_TASK_PING
+};
+
+/* Socket readiness a network callback found missing */
+#define FLEET_IO_READ       0x01
+#define FLEET_IO_WRITE      0x02
+
+typedef struct _FleetClient {
+    MqttClient  client;
+    MqttNet     net;
+    union {                     /* one operation at a time */
+        MqttConnect     connect;
+        MqttSubscribe   subscribe;
+        MqttPublish     publish;
+        MqttPing        ping;
+        MqttDisconnect  disconnect;
+    } op;
+    MqttTopic   topic;
+    byte       *tx_buf;         /* in the same allocation */
+    byte       *rx_buf;
+    char       *topic_name;
+    int         fd;
+    int         pfd;            /* index in the poll list, or -1 */
+    word32      idx;
+    word32      published;
+    word32      received;
+    word16      packet_id;
+    byte        state;
+    byte        task;
+    byte        io_wait;
+    byte        retry;          /* continue without waiting for the socket */
+    double      start_at;
+    double      connect_start;
+    double      connect_time;
+    double      next_pub;
+    double      last_tx;
+    char        client_id[24];
+} FleetClient;
+
+static const char* mHost = "localhost";
+static word16 mPort = 0;
+static int mTls = 0;
+#ifdef ENABLE_MQTT_TLS
+static const char* mCaFile = NULL;
+static byte* mCaBuf = NULL;
+static int mCaLen = 0;
+#endif
+static int mClients = 1000;
+static int mConnRate = 500;             /* connects per second */
+static int mInterval = 1000;            /* publish interval in ms, 0 none */
+static int mSize = 64;
+static int mQos = MQTT_QOS_0;
+static const char* mFilter = NULL;
+static const char* mPrefix = FLEET_TOPIC_PREFIX;
+static int mKeepAlive = 60;
+static int mDuration = 10;
+static int mConnTimeout = 30;
+static int mFormat = FLEET_FMT_TEXT;
+static word32 mRunId;
+static byte* mPayload = NULL;
+static struct sockaddr_storage mAddr;
+static socklen_t mAddrLen;
+static int mStopping = 0;
+
+/* Totals */
+static word32 mConnected = 0;
+static word32 mFailed = 0;
+static word32 mDropped = 0;
+static word32 mPublished = 0;
+static word32 mReceived = 0;
+
+
+/* Network callbacks over a non-blocking socket */
+static int fleet_net_connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    FleetClient *c = (FleetClient*)context;
+    struct pollfd pfd;
+    int err = 0, on = 1;
+    socklen_t len = (socklen_t)sizeof(err);
+
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    if (c->fd < 0) {
+        c->fd = socket(mAddr.ss_family, SOCK_STREAM, 0);
+        if (c->fd < 0) {
+            return MQTT_CODE_ERROR_NETWORK;
+        }
+        (void)fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL, 0) | O_NONBLOCK);
+        (void)setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        if (connect(c->fd, (struct sockaddr*)&mAddr, mAddrLen) == 0) {
+            return MQTT_CODE_SUCCESS;
+        }
+        if (errno != EINPROGRESS) {
+            return MQTT_CODE_ERROR_NETWORK;
+        }
+        c->io_wait |= FLEET_IO_WRITE;
+        return MQTT_CODE_CONTINUE;
+    }
+
+    /* Connected once writable */
+    pfd.fd = c->fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) == 0) {
+        c->io_wait |= FLEET_IO_WRITE;
+        return MQTT_CODE_CONTINUE;
+    }
+    if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0 ||
+            err != 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int fleet_net_read(void *context, byte* buf, int buf_len,
+    int timeout_ms)
+{
+    FleetClient *c = (FleetClient*)context;
+    ssize_t rc;
+
+    (void)timeout_ms;
+    rc = recv(c->fd, buf, (size_t)buf_len, 0);
+    if (rc > 0) {
+        return (int)rc;
+    }
+    if (rc < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+            errno == EINTR)) {
+        c->io_wait |= FLEET_IO_READ;
+        return MQTT_CODE_CONTINUE;
+    }
+    /* Closed by the broker */
+    return MQTT_CODE_ERROR_NETWORK;
+}
+
+static int fleet_net_write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    FleetClient *c = (FleetClient*)context;
+    ssize_t rc;
+
+    (void)timeout_ms;
+    rc = send(c->fd, buf, (size_t)buf_len, MSG_NOSIGNAL);
+    if (rc >= 0) {
+        return (int)rc;
+    }
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        c->io_wait |= FLEET_IO_WRITE;
+        return MQTT_CODE_CONTINUE;
+    }
+    return MQTT_CODE_ERROR_NETWORK;
+}
+
+static int fleet_net_disconnect(void *context)
+{
+    FleetClient *c = (FleetClient*)context;
+
+    if (c->fd >= 0) {
+        (void)close(c->fd);
+        c->fd = -1;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+#ifdef ENABLE_MQTT_TLS
+/* Each client owns its WOLFSSL_CTX, as the library frees it on disconnect.
+ * The CA is read from the file once. */
+static int fleet_tls_cb(MqttClient* client)
+{
+    int rc = WOLFSSL_FAILURE;
+
+    client->tls.ctx = wolfSSL_CTX_new(wolfSSLv23_client_method());
+    if (client->tls.ctx != NULL) {
+        if (mCaBuf != NULL) {
+            wolfSSL_CTX_set_verify(client->tls.ctx, WOLFSSL_VERIFY_PEER,
+                NULL);
+            rc = wolfSSL_CTX_load_verify_buffer(client->tls.ctx, mCaBuf,
+                mCaLen, WOLFSSL_FILETYPE_PEM);
+        }
+        else {
+            wolfSSL_CTX_set_verify(client->tls.ctx, WOLFSSL_VERIFY_NONE,
+                NULL);
+            rc = WOLFSSL_SUCCESS;
+        }
+    }
+    return rc;
+}
+#else
+#define fleet_tls_cb    NULL
+#endif
+
+static int msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    FleetClient *c = (FleetClient*)client->ctx;
+
+    (void)msg;
+    (void)msg_new;
+    if (msg_done) {
+        c->received++;
+        mReceived++;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int fleet_buf_len(void)
+{
+    return mSize + FLEET_HDR_SIZE;
+}
+
+static FleetClient* fleet_client_new(word32 idx, double start_at)
+{
+    FleetClient *c;
+    int buf_len = fleet_buf_len(), topic_len, rc;
+
+    topic_len = (int)XSTRLEN(mPrefix) + 24;
+    c = (FleetClient*)WOLFMQTT_MALLOC(sizeof(FleetClient) + 2 * buf_len +
+        topic_len);
+    if (c == NULL) {
+        return NULL;
+    }
+    XMEMSET(c, 0, sizeof(FleetClient));
+    c->tx_buf = (byte*)&c[1];
+    c->rx_buf = c->tx_buf + buf_len;
+    c->topic_name = (char*)(c->rx_buf + buf_len);
+    XSNPRINTF(c->topic_name, topic_len, "%s/%08x/%u", mPrefix, mRunId, idx);
+    XSNPRINTF(c->client_id, sizeof(c->client_id), "fleet%08x-%u", mRunId,
+        idx);
+    c->fd = -1;
+    c->pfd = -1;
+    c->idx = idx;
+    c->start_at = start_at;
+
+    c->net.context = c;
+    c->net.connect = fleet_net_connect;
+    c->net.read = fleet_net_read;
+    c->net.write = fleet_net_write;
+    c->net.disconnect = fleet_net_disconnect;
+    rc = MqttClient_Init(&c->client, &c->net, msg_cb, c->tx_buf, buf_len,
+        c->rx_buf, buf_len, FLEET_TIMEOUT_MS);
+    if (rc != MQTT_CODE_SUCCESS) {
+        WOLFMQTT_FREE(c);
+        return NULL;
+    }
+    c->client.ctx = c;
+    return c;
+}
+
+static void fleet_client_close(FleetClient *c)
+{
+    if (c->state == FLEET_ST_RUN) {
+        mDropped++;
+    }
+    else if (c->state != FLEET_ST_CLOSED) {
+        mFailed++;
+    }
+    (void)MqttClient_NetDisconnect(&c->client);
+    c->state = FLEET_ST_CLOSED;
+    c->task = FLEET_TASK_NONE;
+}
+
+/* Time the client needs to run without an event from its socket */
+static double fleet_due(FleetClient *c)
+{
+    double due = 1e30, ping;
+
+    if (c->retry) {
+        return 0;
+    }
+    switch (c->state) {
+        case FLEET_ST_IDLE:
+            due = c->start_at;
+            break;
+        case FLEET_ST_NET:
+        case FLEET_ST_CONNECT:
+        case FLEET_ST_SUBSCRIBE:
+            due = c->connect_start + mConnTimeout;
+            break;
+        case FLEET_ST_RUN:
+            if (c->task == FLEET_TASK_NONE) {
+                if (mInterval > 0 && !mStopping) {
+                    due = c->next_pub;
+                }
+                if (mKeepAlive > 0) {
+                    ping = c->last_tx + mKeepAlive / 2.0;
+                    if (ping < due) {
+                        due = ping;
+                    }
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    return due;
+}
+
+static void fleet_start_connect(FleetClient *c)
+{
+    XMEMSET(&c->op.connect, 0, sizeof(c->op.connect));
+    c->op.connect.keep_alive_sec = (word16)mKeepAlive;
+    c->op.connect.clean_session = 1;
+    c->op.connect.client_id = c->client_id;
+    c->state = FLEET_ST_CONNECT;
+}
+
+static void fleet_start_subscribe(FleetClient *c)
+{
+    XMEMSET(&c->topic, 0, sizeof(c->topic));
+    c->topic.topic_filter = mFilter;
+    c->topic.qos = (MqttQoS)mQos;
+    XMEMSET(&c->op.subscribe, 0, sizeof(c->op.subscribe));
+    c->op.subscribe.packet_id = ++c->packet_id;
+    c->op.subscribe.topic_count = 1;
+    c->op.subscribe.topics = &c->topic;
+    c->state = FLEET_ST_SUBSCRIBE;
+}
+
+static void fleet_start_run(FleetClient *c, double now)
+{
+    c->state = FLEET_ST_RUN;
+    c->last_tx = now;
+    /* Spread the publishes of the fleet over the interval */
+    c->next_pub = now + (mInterval / 1000.0) *
+        ((c->idx * 0.6180339887) - (word32)(c->idx * 0.6180339887));
+}
+
+static void fleet_start_task(FleetClient *c, byte task)
+{
+    if (task == FLEET_TASK_PUBLISH) {
+        XMEMSET(&c->op.publish, 0, sizeof(c->op.publish));
+        c->op.publish.topic_name = c->topic_name;
+        c->op.publish.qos = (MqttQoS)mQos;
+        c->op.publish.buffer = mPayload;
+        c->op.publish.total_len = (word32)mSize;
+        if (mQos > MQTT_QOS_0) {
+            if (++c->packet_id == 0) {
+                c->packet_id = 1;
+            }
+            c->op.publish.packet_id = c->packet_id;
+        }
+    }
+    else if (task == FLEET_TASK_PING) {
+        XMEMSET(&c->op.ping, 0, sizeof(c->op.ping));
+    }
+    c->task = task;
+}
+
+/* Runs the operations of a connected client, returns MQTT_CODE_CONTINUE
+ * when waiting for its socket or the next publish */
+static int fleet_run_tasks(FleetClient *c, double now, int readable)
+{
+    int rc = MQTT_CODE_CONTINUE, steps;
+    double interval = mInterval / 1000.0;
+
+    for (steps = 0; steps < FLEET_STEP_MAX; steps++) {
+        if (c->task == FLEET_TASK_NONE) {
+            if (mInterval > 0 && !mStopping && now >= c->next_pub) {
+                fleet_start_task(c, FLEET_TASK_PUBLISH);
+            }
+            else if (mKeepAlive > 0 &&
+                    now - c->last_tx >= mKeepAlive / 2.0) {
+                fleet_start_task(c, FLEET_TASK_PING);
+            }
+            else if (readable) {
+                fleet_start_task(c, FLEET_TASK_WAIT);
+            }
+            else {
+                return MQTT_CODE_CONTINUE;
+            }
+        }
+
+        switch (c->task) {
+            case FLEET_TASK_PUBLISH:
+                rc = MqttClient_Publish(&c->client, &c->op.publish);
+                break;
+            case FLEET_TASK_PING:
+                rc = MqttClient_Ping_ex(&c->client, &c->op.ping);
+                break;
+            case FLEET_TASK_WAIT:
+            default:
+                rc = MqttClient_WaitMessage(&c->client, FLEET_TIMEOUT_MS);
+                break;
+        }
+        if (rc == MQTT_CODE_CONTINUE) {
+            if (c->task == FLEET_TASK_WAIT && c->client.read.total == 0 &&
+                    c->client.packet.stat == MQTT_PK_BEGIN) {
+                /* Nothing read: stop waiting, so a publish can start */
+                (void)MqttClient_CancelMessage(&c->client,
+                    (MqttObject*)&c->client.msg);
+                c->task = FLEET_TASK_NONE;
+                readable = 0;
+                continue;
+            }
+            return rc;
+        }
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+
+        if (c->task == FLEET_TASK_PUBLISH) {
+            c->published++;
+            mPublished++;
+            c->next_pub += interval;
+            if (c->next_pub < now) {
+                /* Behind, do not send a burst */
+                c->next_pub = now + interval;
+            }
+        }
+        if (c->task != FLEET_TASK_WAIT) {
+            c->last_tx = now;
+        }
+        /* More may be ready, in the socket or already read by TLS */
+        readable = 1;
+        c->task = FLEET_TASK_NONE;
+    }
+    /* Let the other clients run, then continue */
+    c->retry = 1;
+    return MQTT_CODE_CONTINUE;
+}
+
+/* Advances a client on an event of its socket or a timer */
+static void fleet_step(FleetClient *c, double now, short revents)
+{
+    int rc = MQTT_CODE_SUCCESS;
+
+    c->io_wait = 0;
+    c->retry = 0;
+    if (c->state != FLEET_ST_IDLE && c->state != FLEET_ST_RUN &&
+            now - c->connect_start >= mConnTimeout) {
+        fleet_client_close(c);
+        return;
+    }
+
+    switch (c->state) {
+        case FLEET_ST_IDLE:
+            if (now < c->start_at) {
+                return;
+            }
+            c->connect_start = now;
+            c->state = FLEET_ST_NET;
+            FALL_THROUGH;
+
+        case FLEET_ST_NET:
+            rc = MqttClient_NetConnect(&c->client, mHost, mPort,
+                FLEET_TIMEOUT_MS, mTls, fleet_tls_cb);
+            if (rc != MQTT_CODE_SUCCESS) {
+                break;
+            }
+            fleet_start_connect(c);
+            FALL_THROUGH;
+
+        case FLEET_ST_CONNECT:
+            rc = MqttClient_Connect(&c->client, &c->op.connect);
+            if (rc != MQTT_CODE_SUCCESS) {
+                break;
+            }
+            if (c->op.connect.ack.return_code !=
+                    MQTT_CONNECT_ACK_CODE_ACCEPTED) {
+                rc = MQTT_CODE_ERROR_SERVER_PROP;
+                break;
+            }
+            c->connect_time = bench_time_sec() - c->connect_start;
+            mConnected++;
+            if (mFilter == NULL) {
+                fleet_start_run(c, now);
+                break;
+            }
+            fleet_start_subscribe(c);
+            FALL_THROUGH;
+
+        case FLEET_ST_SUBSCRIBE:
+            rc = MqttClient_Subscribe(&c->client, &c->op.subscribe);
+            if (rc != MQTT_CODE_SUCCESS) {
+                break;
+            }
+            if (c->topic.return_code > MQTT_QOS_2) {
+                rc = MQTT_CODE_ERROR_SERVER_PROP;
+                break;
+            }
+            fleet_start_run(c, now);
+            break;
+
+        case FLEET_ST_RUN:
+            rc = fleet_run_tasks(c, now,
+                (revents & (POLLIN | POLLERR | POLLHUP)) != 0);
+            break;
+
+        default:
+            return;
+    }
+
+    if (rc == MQTT_CODE_CONTINUE) {
+        if (c->io_wait == 0 && (c->state != FLEET_ST_RUN ||
+                c->task != FLEET_TASK_NONE)) {
+            /* Not waiting for the socket */
+            c->retry = 1;
+        }
+    }
+    else if (rc != MQTT_CODE_SUCCESS) {
+        fleet_client_close(c);
+    }
+}
+
+/* Resident memory of the process in bytes, 0 when not known */
+static double fleet_rss(void)
+{
+#ifdef __linux__
+    FILE *f = fopen("/proc/self/statm", "r");
+    unsigned long size = 0, resident = 0;
+    long page = sysconf(_SC_PAGESIZE);
+
+    if (f == NULL) {
+        return 0;
+    }
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(f);
+    return (double)resident * (double)page;
+#else
+    return 0;
+#endif
+}
+
+static int fleet_resolve(void)
+{
+    struct addrinfo hints, *res = NULL;
+    char port[8];
+    int rc;
+
+    if (mPort == 0) {
+        mPort = mTls ? MQTT_SECURE_PORT : MQTT_DEFAULT_PORT;
+    }
+    XMEMSET(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    XSNPRINTF(port, sizeof(port), "%u", mPort);
+    rc = getaddrinfo(mHost, port, &hints, &res);
+    if (rc != 0 || res == NULL) {
+        PRINTF("Host %s not found", mHost);
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    XMEMCPY(&mAddr, res->ai_addr, res->ai_addrlen);
+    mAddrLen = (socklen_t)res->ai_addrlen;
+    freeaddrinfo(res);
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Raises the open file limit for a socket per client */
+static int fleet_fd_limit(void)
+{
+    struct rlimit rl;
+    rlim_t need = (rlim_t)mClients + FLEET_FD_SPARE;
+
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0) {
+        return MQTT_CODE_ERROR_SYSTEM;
+    }
+    if (rl.rlim_cur >= need) {
+        return MQTT_CODE_SUCCESS;
+    }
+    if (rl.rlim_max != RLIM_INFINITY && rl.rlim_max < need) {
+        PRINTF("Open file limit %lu is too low for %d clients",
+            (unsigned long)rl.rlim_max, mClients);
+        return MQTT_CODE_ERROR_SYSTEM;
+    }
+    rl.rlim_cur = need;
+    if (setrlimit(RLIMIT_NOFILE, &rl) != 0) {
+        return MQTT_CODE_ERROR_SYSTEM;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Runs the event loop until the given time, or until every client is
+ * connected or closed when connecting */
+static void fleet_loop(FleetClient **clients, struct pollfd *fds,
+    double until, int connecting)
+{
+    FleetClient *c;
+    double now, next, due;
+    int i, nfds, timeout_ms, pending;
+
+    for (;;) {
+        now = bench_time_sec();
+        if (now >= until) {
+            break;
+        }
+        next = until;
+        nfds = 0;
+        pending = 0;
+        for (i = 0; i < mClients; i++) {
+            c = clients[i];
+            c->pfd = -1;
+            if (c->state == FLEET_ST_CLOSED) {
+                continue;
+            }
+            if (c->state != FLEET_ST_RUN) {
+                pending++;
+            }
+            if (c->fd >= 0) {
+                fds[nfds].fd = c->fd;
+                fds[nfds].events = POLLIN;
+                if (c->io_wait & FLEET_IO_WRITE) {
+                    fds[nfds].events |= POLLOUT;
+                }
+                fds[nfds].revents = 0;
+                c->pfd = nfds++;
+            }
+            due = fleet_due(c);
+            if (due < next) {
+                next = due;
+            }
+        }
+        if (connecting && pending == 0) {
+            break;
+        }
+
+        timeout_ms = (next > now) ? (int)((next - now) * 1000.0) + 1 : 0;
+        if (timeout_ms > FLEET_POLL_MS) {
+            timeout_ms = FLEET_POLL_MS;
+        }
+        if (poll(fds, (nfds_t)nfds, timeout_ms) < 0 && errno != EINTR) {
+            break;
+        }
+
+        now = bench_time_sec();
+        for (i = 0; i < mClients; i++) {
+            short revents = 0;
+
+            c = clients[i];
+            if (c->state == FLEET_ST_CLOSED) {
+                continue;
+            }
+            if (c->pfd >= 0) {
+                revents = fds[c->pfd].revents;
+            }
+            if (revents != 0 || fleet_due(c) <= now) {
+                fleet_step(c, now, revents);
+            }
+        }
+    }
+}
+
+/* Disconnects a running client, waiting briefly for the socket */
+static void fleet_disconnect(FleetClient *c)
+{
+    int rc, tries = 0;
+
+    if (c->state == FLEET_ST_RUN && c->task == FLEET_TASK_NONE) {
+        XMEMSET(&c->op.disconnect, 0, sizeof(c->op.disconnect));
+        do {
+            rc = MqttClient_Disconnect_ex(&c->client, &c->op.disconnect);
+        } while (rc == MQTT_CODE_CONTINUE && ++tries < 100);
+    }
+    if (c->state != FLEET_ST_CLOSED) {
+        (void)MqttClient_NetDisconnect(&c->client);
+        c->state = FLEET_ST_CLOSED;
+    }
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/* Value in milliseconds at the given fraction of the sorted times, by
+ * nearest rank */
+static double percentile_ms(const double *t, word32 count, double p)
+{
+    word32 idx;
+
+    if (count == 0) {
+        return 0;
+    }
+    idx = (word32)(p * (count - 1) + 0.5);
+    return t[idx] * 1000.0;
+}
+
+static int fleet_run(void)
+{
+    FleetClient **clients;
+    struct pollfd *fds;
+    double *times = NULL, t0, start, sec, rss0, rss1;
+    double mean = 0, first = 0, last = 0;
+    word32 n = 0, pub0, rx0, published, received, expected;
+    word32 static_bytes, rss_per_client = 0;
+    int i, rc = MQTT_CODE_SUCCESS;
+
+    rss0 = fleet_rss();
+    clients = (FleetClient**)WOLFMQTT_MALLOC(sizeof(FleetClient*) *
+        mClients);
+    fds = (struct pollfd*)WOLFMQTT_MALLOC(sizeof(struct pollfd) * mClients);
+    mPayload = (byte*)WOLFMQTT_MALLOC(mSize > 0 ? mSize : 1);
+    if (clients == NULL || fds == NULL || mPayload == NULL) {
+        rc = MQTT_CODE_ERROR_MEMORY;
+    }
+    else {
+        XMEMSET(clients, 0, sizeof(FleetClient*) * mClients);
+        XMEMSET(mPayload, 0xA5, mSize > 0 ? mSize : 1);
+    }
+
+    /* Connects are spread at the connect rate */
+    t0 = bench_time_sec();
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < mClients; i++) {
+        clients[i] = fleet_client_new((word32)i,
+            t0 + (double)i / mConnRate);
+        if (clients[i] == NULL) {
+            rc = MQTT_CODE_ERROR_MEMORY;
+        }
+    }
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        fleet_loop(clients, fds,
+            t0 + (double)mClients / mConnRate + mConnTimeout + 1, 1);
+        rss1 = fleet_rss();
+        if (mConnected > 0 && rss1 > rss0) {
+            rss_per_client = (word32)((rss1 - rss0) / mConnected);
+        }
+
+        /* Steady state of the connected fleet */
+        pub0 = mPublished;
+        rx0 = mReceived;
+        start = bench_time_sec();
+        if (mConnected > 0) {
+            fleet_loop(clients, fds, start + mDuration, 0);
+        }
+        sec = bench_time_sec() - start;
+        published = mPublished - pub0;
+        received = mReceived - rx0;
+
+        /* Let the last acknowledgments and messages arrive */
+        mStopping = 1;
+        fleet_loop(clients, fds, bench_time_sec() + 0.5, 0);
+
+        times = (double*)WOLFMQTT_MALLOC(sizeof(double) *
+            (mConnected > 0 ? mConnected : 1));
+        for (i = 0; times != NULL && i < mClients; i++) {
+            if (clients[i]->connect_time > 0 && n < mConnected) {
+                times[n++] = clients[i]->connect_time;
+                mean += clients[i]->connect_time;
+                if (n == 1 || clients[i]->connect_start < first) {
+                    first = clients[i]->connect_start;
+                }
+                if (clients[i]->connect_start +
+                        clients[i]->connect_time > last) {
+                    last = clients[i]->connect_start +
+                        clients[i]->connect_time;
+                }
+            }
+        }
+        if (times != NULL) {
+            qsort(times, n, sizeof(double), cmp_double);
+        }
+        if (n > 0) {
+            mean /= n;
+        }
+
+        static_bytes = (word32)(sizeof(FleetClient) + 2 * fleet_buf_len() +
+            XSTRLEN(mPrefix) + 24);
+        expected = (mInterval > 0) ?
+            (word32)(mConnected * (sec * 1000.0 / mInterval)) : 0;
+
+        if (mFormat == FLEET_FMT_JSON) {
+            PRINTF("{\"clients\":%d,\"tls\":%d,\"qos\":%d,\"payload\":%d,"
+                "\"interval_ms\":%d,\"connected\":%u,\"failed\":%u,"
+                "\"dropped\":%u,\"connects_per_sec\":%.0f,"
+                "\"connect_mean_ms\":%.2f,\"connect_p50_ms\":%.2f,"
+                "\"connect_p90_ms\":%.2f,\"connect_p99_ms\":%.2f,"
+                "\"connect_max_ms\":%.2f,\"seconds\":%.2f,"
+                "\"published\":%u,\"expected\":%u,\"pub_per_sec\":%.0f,"
+                "\"received\":%u,\"rx_per_sec\":%.0f,"
+                "\"client_bytes\":%u,\"rss_per_client\":%u}",
+                mClients, mTls, mQos, mSize, mInterval, mConnected, mFailed,
+                mDropped, (last > first) ? n / (last - first) : 0,
+                mean * 1000.0, percentile_ms(times, n, 0.50),
+                percentile_ms(times, n, 0.90), percentile_ms(times, n, 0.99),
+                percentile_ms(times, n, 1.0), sec, published, expected,
+                (sec > 0) ? published / sec : 0, received,
+                (sec > 0) ? received / sec : 0, static_bytes,
+                rss_per_client);
+        }
+        else {
+            PRINTF("Fleet: %d clients to %s:%u%s, MQTT v%s, QoS %d, "
+                "%d byte payload every %d ms", mClients, mHost, mPort,
+                mTls ? " TLS" : "",
+            #ifdef WOLFMQTT_V5
+                "5",
+            #else
+                "3.1.1",
+            #endif
+                mQos, mSize, mInterval);
+            PRINTF("Connected %u, failed %u, dropped %u, %.0f connects/s",
+                mConnected, mFailed, mDropped,
+                (last > first) ? n / (last - first) : 0);
+            PRINTF("Connect ms: mean %.2f, p50 %.2f, p90 %.2f, p99 %.2f, "
+                "max %.2f", mean * 1000.0, percentile_ms(times, n, 0.50),
+                percentile_ms(times, n, 0.90), percentile_ms(times, n, 0.99),
+                percentile_ms(times, n, 1.0));
+            PRINTF("Steady %.1f s: published %u of %u (%.0f msgs/s), "
+                "received %u (%.0f msgs/s)", sec, published, expected,
+                (sec > 0) ? published / sec : 0, received,
+                (sec > 0) ? received / sec : 0);
+            PRINTF("Memory per client: %u bytes of structures and buffers, "
+                "%u bytes resident", static_bytes, rss_per_client);
+        }
+        if (mConnected != (word32)mClients || mDropped > 0) {
+            rc = -1;
+        }
+    }
+    else {
+        PRINTF("Fleet setup failed: %s (%d)",
+            MqttClient_ReturnCodeToString(rc), rc);
+    }
+
+    for (i = 0; clients != NULL && i < mClients; i++) {
+        if (clients[i] != NULL) {
+            fleet_disconnect(clients[i]);
+            MqttClient_DeInit(&clients[i]->client);
+            WOLFMQTT_FREE(clients[i]);
+        }
+    }
+    if (times != NULL) {
+        WOLFMQTT_FREE(times);
+    }
+    if (mPayload != NULL) {
+        WOLFMQTT_FREE(mPayload);
+    }
+    if (fds != NULL) {
+        WOLFMQTT_FREE(fds);
+    }
+    if (clients != NULL) {
+        WOLFMQTT_FREE(clients);
+    }
+    return (rc == MQTT_CODE_SUCCESS) ? 0 : -1;
+}
+
+static void usage(void)
+{
+    PRINTF("fleetbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-h <host>   Broker host, default localhost");
+    PRINTF("-p <num>    Broker port, default %d (%d with TLS)",
+        MQTT_DEFAULT_PORT, MQTT_SECURE_PORT);
+    PRINTF("-n <num>    Clients, default 1000 (most %d)", FLEET_MAX_CLIENTS);
+    PRINTF("-R <num>    Connects per second, default 500");
+    PRINTF("-i <ms>     Publish interval of each client, default 1000 "
+        "(0 none)");
+    PRINTF("-s <num>    Payload bytes, default 64 (most %d)",
+        FLEET_MAX_PAYLOAD);
+    PRINTF("-q <num>    QoS of publishes and subscriptions, default 0");
+    PRINTF("-S <topic>  Topic filter each client subscribes to, default "
+        "none");
+    PRINTF("-T <topic>  Prefix of the topics published, default %s",
+        FLEET_TOPIC_PREFIX);
+    PRINTF("-k <sec>    Keep alive, default 60 (0 none)");
+    PRINTF("-d <sec>    Seconds of publishing once connected, default 10");
+    PRINTF("-w <sec>    Connect timeout of a client, default 30");
+#ifdef ENABLE_MQTT_TLS
+    PRINTF("-t          Enable TLS");
+    PRINTF("-A <file>   CA certificate file (PEM)");
+#endif
+    PRINTF("-f <fmt>    Output text or json, default text");
+}
+
+#endif /* FLEET_ENABLED */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef FLEET_ENABLED
+    int i, bad_arg = 0;
+
+    for (i = 1; i < argc && !bad_arg; i++) {
+        if (XSTRNCMP(argv[i], "-t", 3) == 0) {
+        #ifdef ENABLE_MQTT_TLS
+            mTls = 1;
+        #else
+            bad_arg = 1;
+        #endif
+        }
+        else if (i + 1 >= argc) {
+            bad_arg = 1;
+        }
+        else if (XSTRNCMP(argv[i], "-h", 3) == 0) {
+            mHost = argv[++i];
+        }
+        else if (XSTRNCMP(argv[i], "-p", 3) == 0) {
+            mPort = (word16)XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-n", 3) == 0) {
+            mClients = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-R", 3) == 0) {
+            mConnRate = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-i", 3) == 0) {
+            mInterval = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-s", 3) == 0) {
+            mSize = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-q", 3) == 0) {
+            mQos = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-S", 3) == 0) {
+            mFilter = argv[++i];
+        }
+        else if (XSTRNCMP(argv[i], "-T", 3) == 0) {
+            mPrefix = argv[++i];
+        }
+        else if (XSTRNCMP(argv[i], "-k", 3) == 0) {
+            mKeepAlive = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-d", 3) == 0) {
+            mDuration = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-w", 3) == 0) {
+            mConnTimeout = XATOI(argv[++i]);
+        }
+    #ifdef ENABLE_MQTT_TLS
+        else if (XSTRNCMP(argv[i], "-A", 3) == 0) {
+            mCaFile = argv[++i];
+        }
+    #endif
+        else if (XSTRNCMP(argv[i], "-f", 3) == 0) {
+            i++;
+            if (XSTRNCMP(argv[i], "json", 5) == 0) {
+                mFormat = FLEET_FMT_JSON;
+            }
+            else if (XSTRNCMP(argv[i], "text", 5) != 0) {
+                bad_arg = 1;
+            }
+        }
+        else {
+            bad_arg = 1;
+        }
+    }
+    if (bad_arg || mClients < 1 || mClients > FLEET_MAX_CLIENTS ||
+            mConnRate < 1 || mInterval < 0 || mSize < 0 ||
+            mSize > FLEET_MAX_PAYLOAD || mQos < 0 ||
+            mQos > MQTT_QOS_2 || mKeepAlive < 0 || mKeepAlive > 65535 ||
+            mDuration < 0 || mConnTimeout < 1) {
+        usage();
+        return (argc == 2 && XSTRNCMP(argv[1], "-?", 3) == 0) ? 0 :
+            EXIT_FAILURE;
+    }
+
+    /* A connection closed by the broker is reported, not fatal */
+    (void)signal(SIGPIPE, SIG_IGN);
+    /* Topics and client ids differ from other runs on a shared broker */
+    mRunId = (word32)(bench_time_sec() * 1000.0);
+
+    rc = fleet_resolve();
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = fleet_fd_limit();
+    }
+#ifdef ENABLE_MQTT_TLS
+    if (rc == MQTT_CODE_SUCCESS && mCaFile != NULL) {
+        rc = mqtt_file_load(mCaFile, &mCaBuf, &mCaLen);
+    }
+#endif
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = fleet_run();
+    }
+#ifdef ENABLE_MQTT_TLS
+    if (mCaBuf != NULL) {
+        WOLFMQTT_FREE(mCaBuf);
+    }
+#endif
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires non-blocking mode and POSIX sockets
+       ./configure --enable-nonblock */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,604 @@
+/* memnetbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* In-memory transport benchmark.
+ * An MqttClient publishes to a minimal responder, which acknowledges like a
+ * broker, over the in-memory transport. With one thread a client wait runs
+ * the responder, with two threads the responder has its own thread. The
+ * same two thread run over a socket pair shows the cost of the kernel.
+ * Reports the publishes per second at QoS 0, 1 and 2, and the waits of the
+ * client (reads and writes that found the ring empty or full) per message.
+ * Fails when the responder did not receive every publish. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_MEMNET
+
+#ifndef USE_WINDOWS_API
+    #include <sys/socket.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #define BENCH_SOCKETPAIR
+#endif
+
+#define BENCH_BUF_SIZE      4096
+#define BENCH_RESP_SIZE     (2 * BENCH_BUF_SIZE)
+#define BENCH_TIMEOUT_MS    5000
+#define BENCH_TOPIC         "bench/1/data"
+
+enum BenchMode {
+    BENCH_MEMNET_1 = 0,     /* responder run by the client waits */
+    BENCH_MEMNET_2,         /* responder in its own thread */
+#ifdef BENCH_SOCKETPAIR
+    BENCH_SOCKET_2,         /* same as above over a socket pair */
+#endif
+    BENCH_MODE_COUNT
+};
+
+static const char* kModeName[] = {
+    "memnet", "memnet",
+#ifdef BENCH_SOCKETPAIR
+    "socketpair"
+#endif
+};
+static const int kModeThreads[] = { 1, 2, 2 };
+
+/* Server side of the connection: answers CONNECT, PUBLISH, PUBREL and
+ * PINGREQ as a broker would, and keeps what is left of a partial packet */
+typedef struct _Responder {
+    MqttNet    *net;
+    byte        buf[BENCH_RESP_SIZE];
+    int         len;
+    byte        level;          /* protocol level of the CONNECT */
+    int         done;           /* DISCONNECT received */
+    word32      publishes;
+} Responder;
+
+#ifdef BENCH_SOCKETPAIR
+typedef struct _SockNet {
+    int         fd;
+} SockNet;
+#endif
+
+static int responder_write(Responder *r, const byte *buf, int len)
+{
+    int rc, pos = 0;
+
+    while (pos < len) {
+        rc = r->net->write(r->net->context, &buf[pos], len - pos,
+            BENCH_TIMEOUT_MS);
+        if (rc == MQTT_CODE_CONTINUE) {
+            continue;
+        }
+        if (rc <= 0) {
+            return (rc == 0) ? MQTT_CODE_ERROR_NETWORK : rc;
+        }
+        pos += rc;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int responder_packet(Responder *r, const byte *pkt, int hdr_len,
+    int remain)
+{
+    const byte *body = &pkt[hdr_len];
+    byte ack[5];
+    int ack_len = 0, pos;
+
+    switch (MQTT_PACKET_TYPE_GET(pkt[0])) {
+        case MQTT_PACKET_TYPE_CONNECT:
+            /* Protocol name "MQTT" then level */
+            r->level = (remain > 6) ? body[6] : MQTT_CONNECT_PROTOCOL_LEVEL_4;
+            ack[0] = MQTT_PACKET_TYPE_SET(MQTT_PACKET_TYPE_CONNECT_ACK);
+            ack[1] = 2;
+            ack[2] = 0;     /* session present */
+            ack[3] = 0;     /* accepted */
+            ack_len = 4;
+            if (r->level >= 5) {
+                ack[1] = 3;
+                ack[4] = 0; /* no properties */
+                ack_len = 5;
+            }
+            break;
+        case MQTT_PACKET_TYPE_PUBLISH:
+            r->publishes++;
+            if (MQTT_PACKET_FLAGS_GET_QOS(pkt[0]) == MQTT_QOS_0) {
+                break;
+            }
+            /* Packet id after the topic name */
+            pos = 2 + (((int)body[0] << 8) | body[1]);
+            if (pos + 2 > remain) {
+                return MQTT_CODE_ERROR_MALFORMED_DATA;
+            }
+            ack[0] = MQTT_PACKET_TYPE_SET(
+                (MQTT_PACKET_FLAGS_GET_QOS(pkt[0]) == MQTT_QOS_1) ?
+                MQTT_PACKET_TYPE_PUBLISH_ACK : MQTT_PACKET_TYPE_PUBLISH_REC);
+            ack[1] = 2;
+            ack[2] = body[pos];
+            ack[3] = body[pos + 1];
+            ack_len = 4;
+            break;
+        case MQTT_PACKET_TYPE_PUBLISH_REL:
+            if (remain < 2) {
+                return MQTT_CODE_ERROR_MALFORMED_DATA;
+            }
+            ack[0] = MQTT_PACKET_TYPE_SET(MQTT_PACKET_TYPE_PUBLISH_COMP);
+            ack[1] = 2;
+            ack[2] = body[0];
+            ack[3] = body[1];
+            ack_len = 4;
+            break;
+        case MQTT_PACKET_TYPE_PING_REQ:
+            ack[0] = MQTT_PACKET_TYPE_SET(MQTT_PACKET_TYPE_PING_RESP);
+            ack[1] = 0;
+            ack_len = 2;
+            break;
+        case MQTT_PACKET_TYPE_DISCONNECT:
+            r->done = 1;
+            break;
+        default:
+            break;
+    }
+    return (ack_len > 0) ? responder_write(r, ack, ack_len) :
+        MQTT_CODE_SUCCESS;
+}
+
+/* Reads what is ready and answers each complete packet. Returns the bytes
+ * read or the code of the read. */
+static int responder_run(Responder *r, int timeout_ms)
+{
+    int rc, got, pos = 0, i, remain, mult;
+    byte b;
+
+    rc = r->net->read(r->net->context, &r->buf[r->len],
+        (int)sizeof(r->buf) - r->len, timeout_ms);
+    if (rc <= 0) {
+        return (rc == 0) ? MQTT_CODE_ERROR_NETWORK : rc;
+    }
+    got = rc;
+    r->len += got;
+
+    while (!r->done) {
+        /* Fixed header and remaining length */
+        remain = 0;
+        mult = 1;
+        i = 1;
+        do {
+            if (pos + i >= r->len) {
+                i = 0;
+                break;
+            }
+            b = r->buf[pos + i];
+            remain += (b & 0x7F) * mult;
+            mult *= 128;
+            i++;
+        } while ((b & 0x80) && i < 5);
+        if (i == 0 || pos + i + remain > r->len) {
+            break;
+        }
+        rc = responder_packet(r, &r->buf[pos], i, remain);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+        pos += i + remain;
+    }
+    XMEMMOVE(r->buf, &r->buf[pos], r->len - pos);
+    r->len -= pos;
+
+    return got;
+}
+
+static BENCH_THREAD_RET responder_thread(void *arg)
+{
+    Responder *r = (Responder*)arg;
+    int rc;
+
+    while (!r->done) {
+        rc = responder_run(r, BENCH_TIMEOUT_MS);
+        if (rc < 0 && rc != MQTT_CODE_ERROR_TIMEOUT &&
+                rc != MQTT_CODE_CONTINUE) {
+            break;
+        }
+    }
+    return BENCH_THREAD_RET_VAL;
+}
+
+/* Wait of the client with one thread: runs the responder */
+static int pump_wait(void *ctx, int timeout_ms, word32 waits)
+{
+    (void)timeout_ms;
+    (void)waits;
+    if (responder_run((Responder*)ctx, 0) > 0) {
+        return MQTT_CODE_SUCCESS;
+    }
+#ifdef WOLFMQTT_NONBLOCK
+    return MQTT_CODE_CONTINUE;
+#else
+    return MQTT_CODE_ERROR_TIMEOUT;
+#endif
+}
+
+/* Wait of the responder with one thread: returns to the client */
+static int peer_wait(void *ctx, int timeout_ms, word32 waits)
+{
+    (void)ctx;
+    (void)timeout_ms;
+    (void)waits;
+    return MQTT_CODE_CONTINUE;
+}
+
+#ifdef WOLFMQTT_NONBLOCK
+/* Wait of an end with two threads: lets the other thread run, as a caller
+ * looping on MQTT_CODE_CONTINUE should */
+static int yield_wait(void *ctx, int timeout_ms, word32 waits)
+{
+    (void)ctx;
+    (void)timeout_ms;
+    (void)waits;
+    BENCH_YIELD();
+    return MQTT_CODE_CONTINUE;
+}
+#endif
+
+#ifdef BENCH_SOCKETPAIR
+static int Sock_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    (void)context;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int Sock_Read(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    SockNet *sock = (SockNet*)context;
+    struct pollfd pfd;
+    int rc;
+
+    pfd.fd = sock->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    rc = poll(&pfd, 1, timeout_ms);
+    if (rc == 0) {
+    #ifdef WOLFMQTT_NONBLOCK
+        return MQTT_CODE_CONTINUE;
+    #else
+        return MQTT_CODE_ERROR_TIMEOUT;
+    #endif
+    }
+    if (rc > 0) {
+        rc = (int)recv(sock->fd, buf, (size_t)buf_len, 0);
+    }
+    return (rc > 0) ? rc : MQTT_CODE_ERROR_NETWORK;
+}
+
+static int Sock_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    SockNet *sock = (SockNet*)context;
+    int flags = 0, rc;
+
+    (void)timeout_ms;
+#ifdef MSG_NOSIGNAL
+    flags = MSG_NOSIGNAL;
+#endif
+    rc = (int)send(sock->fd, buf, (size_t)buf_len, flags);
+    return (rc > 0) ? rc : MQTT_CODE_ERROR_NETWORK;
+}
+
+static int Sock_Disconnect(void *context)
+{
+    SockNet *sock = (SockNet*)context;
+
+    (void)shutdown(sock->fd, SHUT_RDWR);
+    return MQTT_CODE_SUCCESS;
+}
+
+static void sock_net_init(MqttNet *net, SockNet *sock, int fd)
+{
+    XMEMSET(net, 0, sizeof(MqttNet));
+    sock->fd = fd;
+    net->context = sock;
+    net->connect = Sock_Connect;
+    net->read = Sock_Read;
+    net->write = Sock_Write;
+    net->disconnect = Sock_Disconnect;
+}
+#endif /* BENCH_SOCKETPAIR */
+
+static int client_publish(MqttClient *client, byte *payload, word32 len,
+    MqttQoS qos, int count)
+{
+    MqttPublish publish;
+    word16 packet_id = 0;
+    int rc = MQTT_CODE_SUCCESS, n;
+
+    for (n = 0; rc == MQTT_CODE_SUCCESS && n < count; n++) {
+        XMEMSET(&publish, 0, sizeof(publish));
+        publish.topic_name = BENCH_TOPIC;
+        publish.qos = qos;
+        publish.buffer = payload;
+        publish.total_len = len;
+        if (qos > MQTT_QOS_0) {
+            if (++packet_id == 0) {
+                packet_id = 1;
+            }
+            publish.packet_id = packet_id;
+        }
+        do {
+            rc = MqttClient_Publish(client, &publish);
+        } while (rc == MQTT_CODE_CONTINUE);
+    }
+    /* Round trip, so the responder has read every publish */
+    if (rc == MQTT_CODE_SUCCESS) {
+        do {
+            rc = MqttClient_Ping(client);
+        } while (rc == MQTT_CODE_CONTINUE);
+    }
+    return rc;
+}
+
+static int run_mode(int mode, MqttQoS qos, byte *payload, word32 len,
+    int count)
+{
+    MqttClient client;
+    MqttNet net, peer_net;
+    MqttMemPipe pipe;
+    MqttMemNet mem, peer_mem;
+    MqttConnect connect;
+    Responder *resp;
+    BENCH_THREAD_T thread;
+    byte *tx_buf = NULL, *rx_buf = NULL;
+    int rc, threaded = 0, piped = 0, inited = 0, net_connected = 0;
+    double start, total = 0;
+#ifdef BENCH_SOCKETPAIR
+    SockNet sock, peer_sock;
+    int fds[2] = { -1, -1 };
+#endif
+
+    resp = (Responder*)WOLFMQTT_MALLOC(sizeof(Responder));
+    tx_buf = (byte*)WOLFMQTT_MALLOC(BENCH_BUF_SIZE);
+    rx_buf = (byte*)WOLFMQTT_MALLOC(BENCH_BUF_SIZE);
+    if (resp == NULL || tx_buf == NULL || rx_buf == NULL) {
+        rc = MQTT_CODE_ERROR_MEMORY;
+        goto exit;
+    }
+    XMEMSET(resp, 0, sizeof(Responder));
+    resp->net = &peer_net;
+    XMEMSET(&mem, 0, sizeof(mem));
+
+#ifdef BENCH_SOCKETPAIR
+    if (mode == BENCH_SOCKET_2) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            rc = MQTT_CODE_ERROR_NETWORK;
+            goto exit;
+        }
+        sock_net_init(&net, &sock, fds[0]);
+        sock_net_init(&peer_net, &peer_sock, fds[1]);
+        rc = MQTT_CODE_SUCCESS;
+    }
+    else
+#endif
+    {
+        rc = MqttMemNet_PipeInit(&pipe, 0);
+        if (rc == MQTT_CODE_SUCCESS) {
+            piped = 1;
+            if (mode == BENCH_MEMNET_1) {
+                rc = MqttMemNet_Init(&peer_net, &peer_mem, &pipe,
+                    MQTT_MEMNET_SIDE_PEER, peer_wait, NULL);
+                if (rc == MQTT_CODE_SUCCESS) {
+                    rc = MqttMemNet_Init(&net, &mem, &pipe,
+                        MQTT_MEMNET_SIDE_CLIENT, pump_wait, resp);
+                }
+            }
+            else {
+            #ifdef WOLFMQTT_NONBLOCK
+                MqttMemNetWaitCb wait_cb = yield_wait;
+            #else
+                MqttMemNetWaitCb wait_cb = NULL;
+            #endif
+                rc = MqttMemNet_Init(&peer_net, &peer_mem, &pipe,
+                    MQTT_MEMNET_SIDE_PEER, wait_cb, NULL);
+                if (rc == MQTT_CODE_SUCCESS) {
+                    rc = MqttMemNet_Init(&net, &mem, &pipe,
+                        MQTT_MEMNET_SIDE_CLIENT, wait_cb, NULL);
+                }
+            }
+        }
+    }
+    if (rc == MQTT_CODE_SUCCESS && kModeThreads[mode] > 1) {
+        if (BENCH_THREAD_CREATE(&thread, responder_thread, resp) != 0) {
+            rc = MQTT_CODE_ERROR_SYSTEM;
+        }
+        else {
+            threaded = 1;
+        }
+    }
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_Init(&client, &net, NULL, tx_buf, BENCH_BUF_SIZE,
+            rx_buf, BENCH_BUF_SIZE, BENCH_TIMEOUT_MS);
+        inited = (rc == MQTT_CODE_SUCCESS);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        do {
+            rc = MqttClient_NetConnect(&client, "bench", 0,
+                BENCH_TIMEOUT_MS, 0, NULL);
+        } while (rc == MQTT_CODE_CONTINUE);
+        net_connected = (rc == MQTT_CODE_SUCCESS);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&connect, 0, sizeof(connect));
+        connect.keep_alive_sec = 60;
+        connect.clean_session = 1;
+        connect.client_id = "memnetbench";
+        do {
+            rc = MqttClient_Connect(&client, &connect);
+        } while (rc == MQTT_CODE_CONTINUE);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        mem.waits = 0;
+        start = bench_time_sec();
+        rc = client_publish(&client, payload, len, qos, count);
+        total = bench_time_sec() - start;
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        do {
+            rc = MqttClient_Disconnect(&client);
+        } while (rc == MQTT_CODE_CONTINUE);
+    }
+    if (net_connected) {
+        (void)MqttClient_NetDisconnect(&client);
+    }
+    if (threaded) {
+        BENCH_THREAD_JOIN(thread);
+    }
+    if (inited) {
+        MqttClient_DeInit(&client);
+    }
+
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("%s with %d threads, QoS %d failed: %s (%d)", kModeName[mode],
+            kModeThreads[mode], qos, MqttClient_ReturnCodeToString(rc), rc);
+    }
+    else if (resp->publishes != (word32)count) {
+        PRINTF("%s with %d threads, QoS %d: %u publishes received, expected "
+            "%d", kModeName[mode], kModeThreads[mode], qos, resp->publishes,
+            count);
+        rc = -1;
+    }
+    else if (piped) {
+        PRINTF("%-10s %7d %3d %10.0f %9.0f %9.1f %9.2f", kModeName[mode],
+            kModeThreads[mode], qos, count / total,
+            total * 1000000000.0 / count,
+            (double)len * count / total / (1024 * 1024),
+            (double)mem.waits / count);
+    }
+    else {
+        PRINTF("%-10s %7d %3d %10.0f %9.0f %9.1f %9s", kModeName[mode],
+            kModeThreads[mode], qos, count / total,
+            total * 1000000000.0 / count,
+            (double)len * count / total / (1024 * 1024), "-");
+    }
+
+exit:
+    if (piped) {
+        MqttMemNet_PipeFree(&pipe);
+    }
+#ifdef BENCH_SOCKETPAIR
+    if (fds[0] >= 0) {
+        (void)close(fds[0]);
+        (void)close(fds[1]);
+    }
+#endif
+    if (resp != NULL) {
+        WOLFMQTT_FREE(resp);
+    }
+    if (tx_buf != NULL) {
+        WOLFMQTT_FREE(tx_buf);
+    }
+    if (rx_buf != NULL) {
+        WOLFMQTT_FREE(rx_buf);
+    }
+    return (rc == MQTT_CODE_SUCCESS) ? 0 : -1;
+}
+
+static void usage(void)
+{
+    PRINTF("memnetbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Messages per run, default 50000");
+    PRINTF("-p <num>    Payload bytes, default 64");
+    PRINTF("-q <num>    Only this QoS");
+}
+#endif /* WOLFMQTT_MEMNET */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_MEMNET
+    byte *payload = NULL;
+    int i, mode, count = 50000, len = 64, only = -1;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-p", 3) == 0 && i + 1 < argc) {
+            len = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-q", 3) == 0 && i + 1 < argc) {
+            only = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    /* Publish packet fits the client buffer */
+    if (count < 1 || len < 1 || len > BENCH_BUF_SIZE - 64 || only < -1 ||
+            only > 2) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    payload = (byte*)WOLFMQTT_MALLOC(len);
+    if (payload == NULL) {
+        return EXIT_FAILURE;
+    }
+    XMEMSET(payload, 0xA5, len);
+
+    PRINTF("In-memory transport benchmark: MQTT v%s, %d messages, %d byte "
+        "payload",
+    #ifdef WOLFMQTT_V5
+        "5",
+    #else
+        "3.1.1",
+    #endif
+        count, len);
+    PRINTF("Transport  Threads QoS     msgs/s    ns/msg      MB/s waits/msg");
+    for (i = 0; rc == 0 && i <= MQTT_QOS_2; i++) {
+        if (only >= 0 && only != i) {
+            continue;
+        }
+        for (mode = 0; rc == 0 && mode < BENCH_MODE_COUNT; mode++) {
+            rc = run_mode(mode, (MqttQoS)i, payload, (word32)len, count);
+        }
+    }
+    WOLFMQTT_FREE(payload);
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires the in-memory transport to be enabled
+       ./configure --enable-memnet */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
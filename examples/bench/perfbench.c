@@ -0,0 +1,900 @@
+/* perfbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Throughput and latency benchmark.
+ * Pairs of MqttClient, a publisher and a subscriber each with its own
+ * thread, exchange messages through a broker: a local broker over TCP, with
+ * or without TLS, or the in-process broker over the in-memory transport.
+ * Each payload holds a sequence number and the time it was sent, so the
+ * subscriber measures the end-to-end latency of every message. A run is
+ * made for each combination of QoS, payload size, TLS and non-blocking
+ * mode given, and reports the messages and MB received per second and the
+ * latency percentiles, as text, CSV or JSON lines.
+ * Fails when a message is wrong, none arrives, or one is lost at QoS 1
+ * or 2. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "examples/mqttnet.h"
+#include "benchcommon.h"
+
+#if defined(WOLFMQTT_BROKER) && defined(WOLFMQTT_MEMNET)
+    #include "wolfmqtt/mqtt_broker.h"
+    #define PERF_INPROC
+#endif
+
+#include <stdlib.h>
+#ifndef USE_WINDOWS_API
+    #include <signal.h>
+    #include <netinet/tcp.h>
+#endif
+
+#define PERF_BUF_SIZE       4096
+#define PERF_MAX_PAIRS      256
+#define PERF_MAX_LIST       8
+#define PERF_MIN_PAYLOAD    12          /* sequence and send time */
+#define PERF_MAX_PAYLOAD    (1024 * 1024)
+#define PERF_TIMEOUT_MS     5000
+#define PERF_POLL_MS        100
+#define PERF_DRAIN_SEC      2.0         /* wait for late messages */
+#define PERF_TOPIC_PREFIX   "wolfMQTT/bench"
+
+enum PerfFormat {
+    PERF_FMT_TEXT = 0,
+    PERF_FMT_CSV,
+    PERF_FMT_JSON
+};
+
+/* One combination of the matrix */
+typedef struct _PerfCell {
+    MqttQoS     qos;
+    int         size;
+    int         tls;
+    int         nonblock;
+} PerfCell;
+
+#ifdef PERF_INPROC
+/* Wait of an in-memory transport end */
+typedef struct _PerfWait {
+    byte        nonblock;
+    double      start;
+} PerfWait;
+#endif
+
+typedef struct _PerfClient {
+    MQTTCtx     ctx;            /* client, network and TLS settings */
+    byte       *tx_buf;
+    byte       *rx_buf;
+    int         tx_len;
+    char        client_id[32];
+    byte        net_init;
+    byte        inited;
+    byte        connected;
+#ifdef PERF_INPROC
+    MqttMemPipe pipe;
+    MqttMemNet  mem;
+    MqttNet     broker_net;
+    MqttMemNet  broker_mem;
+    PerfWait    wait;
+    PerfWait    broker_wait;
+    int         broker_idx;
+    byte        piped;
+#endif
+} PerfClient;
+
+typedef struct _PerfPair {
+    PerfClient  pub;
+    PerfClient  sub;
+    char        topic[64];
+    byte       *payload;
+    double     *lat;            /* by sequence, negative until received */
+    word32      rx_seq;         /* of the message being received */
+    double      rx_sent;
+    word32      received;
+    word32      dup;
+    word32      bad;
+    double      first_tx;
+    double      last_rx;
+    int         pub_rc;
+    int         sub_rc;
+} PerfPair;
+
+static const char* mHost = "localhost";
+static word16 mPort = 0;         /* zero for the default of the transport */
+#ifdef ENABLE_MQTT_TLS
+static const char* mCaFile = NULL;
+#endif
+static int mPairs = 1;
+static int mCount = 10000;
+static int mRate = 0;
+static int mFormat = PERF_FMT_TEXT;
+static int mInproc = 0;
+static word32 mRunId;
+static PerfCell mCell;
+static volatile int mPubsDone;
+#ifdef PERF_INPROC
+static MqttBroker mBroker;
+static volatile int mBrokerStop;
+#endif
+
+#define PERF_LOOP(rc, call)                 \
+    do {                                    \
+        (rc) = (call);                      \
+        if ((rc) == MQTT_CODE_CONTINUE) {   \
+            BENCH_YIELD();                  \
+        }                                   \
+    } while ((rc) == MQTT_CODE_CONTINUE)
+
+
+#ifdef PERF_INPROC
+/* Waits like a socket: yields to the broker thread and, when blocking,
+ * checks again until the timeout */
+static int perf_wait(void *ctx, int timeout_ms, word32 waits)
+{
+    PerfWait *wait = (PerfWait*)ctx;
+
+    BENCH_YIELD();
+    if (wait->nonblock) {
+        return MQTT_CODE_CONTINUE;
+    }
+    if (waits == 0) {
+        wait->start = bench_time_sec();
+    }
+    else if ((bench_time_sec() - wait->start) * 1000.0 >= timeout_ms) {
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Serves the connections with data ready, as a select loop would */
+static BENCH_THREAD_RET broker_thread(void *arg)
+{
+    PerfPair *pairs = (PerfPair*)arg;
+    PerfClient *c;
+    int i, rc, busy;
+
+    while (!mBrokerStop) {
+        busy = 0;
+        for (i = 0; i < 2 * mPairs; i++) {
+            c = (i & 1) ? &pairs[i / 2].sub : &pairs[i / 2].pub;
+            if (c->broker_idx < 0 ||
+                    MqttMemNet_Pending(&c->broker_mem) == 0) {
+                continue;
+            }
+            rc = MqttBroker_ConnTask(&mBroker, c->broker_idx,
+                PERF_TIMEOUT_MS);
+            if (rc < 0 && rc != MQTT_CODE_ERROR_TIMEOUT &&
+                    rc != MQTT_CODE_CONTINUE) {
+                /* Closed by the broker */
+                c->broker_idx = -1;
+            }
+            busy = 1;
+        }
+        if (!busy) {
+            BENCH_YIELD();
+        }
+    }
+    return BENCH_THREAD_RET_VAL;
+}
+#endif /* PERF_INPROC */
+
+static int msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    MQTTCtx *ctx = (MQTTCtx*)client->ctx;
+    PerfPair *pair = (PerfPair*)ctx->app_ctx;
+    double now;
+
+    if (msg_new) {
+        if (msg->buffer_len >= PERF_MIN_PAYLOAD) {
+            XMEMCPY(&pair->rx_seq, msg->buffer, sizeof(word32));
+            XMEMCPY(&pair->rx_sent, &msg->buffer[4], sizeof(double));
+        }
+        else {
+            pair->rx_seq = (word32)mCount;
+        }
+    }
+    if (msg_done) {
+        now = bench_time_sec();
+        pair->last_rx = now;
+        if (pair->rx_seq >= (word32)mCount ||
+                msg->total_len != (word32)mCell.size) {
+            pair->bad++;
+        }
+        else if (pair->lat[pair->rx_seq] >= 0) {
+            pair->dup++;
+        }
+        else {
+            pair->lat[pair->rx_seq] = now - pair->rx_sent;
+            pair->received++;
+        }
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int client_setup(PerfClient *c, PerfPair *pair, const char *role,
+    int num)
+{
+    MQTTCtx *ctx = &c->ctx;
+    int rc;
+
+    mqtt_init_ctx(ctx);
+    ctx->app_name = "perfbench";
+    ctx->app_ctx = pair;
+    ctx->host = mHost;
+    ctx->port = (mPort != 0) ? mPort :
+        (mCell.tls ? MQTT_SECURE_PORT : MQTT_DEFAULT_PORT);
+    ctx->debug_on = 0;
+    ctx->test_mode = 1;         /* no stdin wake */
+    ctx->cmd_timeout_ms = PERF_TIMEOUT_MS;
+    ctx->use_tls = mCell.tls;
+#ifdef ENABLE_MQTT_TLS
+    ctx->ca_file = mCaFile;
+#endif
+#ifdef WOLFMQTT_NONBLOCK
+    ctx->useNonBlockMode = mCell.nonblock;
+#endif
+    XSNPRINTF(c->client_id, sizeof(c->client_id), "perf%08x-%s%d",
+        mRunId, role, num);
+#ifdef PERF_INPROC
+    c->broker_idx = -1;
+#endif
+
+    /* A publish is written at once: in parts Nagle's algorithm and delayed
+     * acknowledgments would add tens of milliseconds */
+    c->tx_len = mCell.size + PERF_BUF_SIZE;
+    c->tx_buf = (byte*)WOLFMQTT_MALLOC(c->tx_len);
+    c->rx_buf = (byte*)WOLFMQTT_MALLOC(PERF_BUF_SIZE);
+    if (c->tx_buf == NULL || c->rx_buf == NULL) {
+        return MQTT_CODE_ERROR_MEMORY;
+    }
+
+#ifdef PERF_INPROC
+    if (mInproc) {
+        rc = MqttMemNet_PipeInit(&c->pipe, 0);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+        c->piped = 1;
+        c->wait.nonblock = (byte)mCell.nonblock;
+        rc = MqttMemNet_Init(&ctx->net, &c->mem, &c->pipe,
+            MQTT_MEMNET_SIDE_CLIENT, perf_wait, &c->wait);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = MqttMemNet_Init(&c->broker_net, &c->broker_mem, &c->pipe,
+                MQTT_MEMNET_SIDE_PEER, perf_wait, &c->broker_wait);
+        }
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = MqttBroker_Add(&mBroker, &c->broker_net);
+            if (rc >= 0) {
+                c->broker_idx = rc;
+                rc = MQTT_CODE_SUCCESS;
+            }
+        }
+    }
+    else
+#endif
+    {
+        rc = MqttClientNet_Init(&ctx->net, ctx);
+        c->net_init = (rc == MQTT_CODE_SUCCESS);
+    }
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_Init(&ctx->client, &ctx->net, msg_cb, c->tx_buf,
+            c->tx_len, c->rx_buf, PERF_BUF_SIZE, PERF_TIMEOUT_MS);
+        c->inited = (rc == MQTT_CODE_SUCCESS);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        ctx->client.ctx = ctx;
+    }
+    return rc;
+}
+
+static int client_connect(PerfClient *c)
+{
+    MQTTCtx *ctx = &c->ctx;
+    int rc;
+
+    PERF_LOOP(rc, MqttClient_NetConnect(&ctx->client, ctx->host, ctx->port,
+        PERF_TIMEOUT_MS, ctx->use_tls, mqtt_tls_cb));
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    c->connected = 1;
+    if (!mInproc) {
+        /* Small publishes are sent at once, as a broker does */
+        SocketContext *sock = (SocketContext*)ctx->net.context;
+        int on = 1;
+        (void)setsockopt(sock->fd, IPPROTO_TCP, TCP_NODELAY,
+            (const char*)&on, sizeof(on));
+    }
+
+    XMEMSET(&ctx->connect, 0, sizeof(ctx->connect));
+    ctx->connect.keep_alive_sec = 60;
+    ctx->connect.clean_session = 1;
+    ctx->connect.client_id = c->client_id;
+    PERF_LOOP(rc, MqttClient_Connect(&ctx->client, &ctx->connect));
+    if (rc == MQTT_CODE_SUCCESS && ctx->connect.ack.return_code !=
+            MQTT_CONNECT_ACK_CODE_ACCEPTED) {
+        rc = MQTT_CODE_ERROR_SERVER_PROP;
+    }
+    return rc;
+}
+
+static int client_subscribe(PerfClient *c, const char *filter)
+{
+    MQTTCtx *ctx = &c->ctx;
+    int rc;
+
+    XMEMSET(ctx->topics, 0, sizeof(ctx->topics));
+    ctx->topics[0].topic_filter = filter;
+    ctx->topics[0].qos = mCell.qos;
+    XMEMSET(&ctx->subscribe, 0, sizeof(ctx->subscribe));
+    ctx->subscribe.packet_id = 1;
+    ctx->subscribe.topic_count = 1;
+    ctx->subscribe.topics = ctx->topics;
+    PERF_LOOP(rc, MqttClient_Subscribe(&ctx->client, &ctx->subscribe));
+    if (rc == MQTT_CODE_SUCCESS &&
+            ctx->topics[0].return_code > MQTT_QOS_2) {
+        rc = MQTT_CODE_ERROR_SERVER_PROP;
+    }
+    return rc;
+}
+
+static void client_cleanup(PerfClient *c)
+{
+    MQTTCtx *ctx = &c->ctx;
+    int rc;
+
+    if (c->connected) {
+        XMEMSET(&ctx->disconnect, 0, sizeof(ctx->disconnect));
+        PERF_LOOP(rc, MqttClient_Disconnect_ex(&ctx->client,
+            &ctx->disconnect));
+        (void)rc;
+        (void)MqttClient_NetDisconnect(&ctx->client);
+        c->connected = 0;
+    }
+}
+
+static void client_free(PerfClient *c)
+{
+    if (c->inited) {
+        MqttClient_DeInit(&c->ctx.client);
+    }
+    if (c->net_init) {
+        (void)MqttClientNet_DeInit(&c->ctx.net);
+    }
+#ifdef PERF_INPROC
+    if (c->piped) {
+        MqttMemNet_PipeFree(&c->pipe);
+    }
+#endif
+    if (c->tx_buf != NULL) {
+        WOLFMQTT_FREE(c->tx_buf);
+    }
+    if (c->rx_buf != NULL) {
+        WOLFMQTT_FREE(c->rx_buf);
+    }
+}
+
+static BENCH_THREAD_RET pub_thread(void *arg)
+{
+    PerfPair *pair = (PerfPair*)arg;
+    MqttClient *client = &pair->pub.ctx.client;
+    MqttPublish publish;
+    word32 seq;
+    word16 packet_id = 0;
+    double now, target;
+    int rc = MQTT_CODE_SUCCESS;
+
+    pair->first_tx = bench_time_sec();
+    for (seq = 0; rc == MQTT_CODE_SUCCESS && seq < (word32)mCount; seq++) {
+        if (mRate > 0) {
+            target = pair->first_tx + (double)seq / mRate;
+            while (bench_time_sec() < target) {
+                BENCH_YIELD();
+            }
+        }
+        now = bench_time_sec();
+        XMEMCPY(pair->payload, &seq, sizeof(word32));
+        XMEMCPY(&pair->payload[4], &now, sizeof(double));
+
+        XMEMSET(&publish, 0, sizeof(publish));
+        publish.topic_name = pair->topic;
+        publish.qos = mCell.qos;
+        publish.buffer = pair->payload;
+        publish.total_len = (word32)mCell.size;
+        if (mCell.qos > MQTT_QOS_0) {
+            if (++packet_id == 0) {
+                packet_id = 1;
+            }
+            publish.packet_id = packet_id;
+        }
+        PERF_LOOP(rc, MqttClient_Publish(client, &publish));
+    }
+    pair->pub_rc = rc;
+    return BENCH_THREAD_RET_VAL;
+}
+
+static BENCH_THREAD_RET sub_thread(void *arg)
+{
+    PerfPair *pair = (PerfPair*)arg;
+    MqttClient *client = &pair->sub.ctx.client;
+    double now, done_at = 0, idle_from;
+    int rc, done = 0;
+
+    while (pair->received < (word32)mCount) {
+        rc = MqttClient_WaitMessage(client, PERF_POLL_MS);
+        if (rc == MQTT_CODE_SUCCESS) {
+            continue;
+        }
+        if (rc != MQTT_CODE_ERROR_TIMEOUT && rc != MQTT_CODE_CONTINUE) {
+            pair->sub_rc = rc;
+            break;
+        }
+        /* Once published, stop when nothing came for a while */
+        if (mPubsDone) {
+            now = bench_time_sec();
+            if (!done) {
+                done = 1;
+                done_at = now;
+            }
+            idle_from = (pair->last_rx > done_at) ? pair->last_rx : done_at;
+            if (now - idle_from > PERF_DRAIN_SEC) {
+                break;
+            }
+        }
+    }
+    return BENCH_THREAD_RET_VAL;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+/* Latency in microseconds at the given fraction of the sorted latencies,
+ * by nearest rank */
+static double percentile_us(const double *lat, word32 count, double p)
+{
+    word32 idx;
+
+    if (count == 0) {
+        return 0;
+    }
+    idx = (word32)(p * (count - 1) + 0.5);
+    return lat[idx] * 1000000.0;
+}
+
+static const char* transport_name(void)
+{
+    if (mInproc) {
+        return "inproc";
+    }
+    return mCell.tls ? "tls" : "tcp";
+}
+
+static void print_header(void)
+{
+    if (mFormat == PERF_FMT_CSV) {
+        PRINTF("transport,qos,payload,nonblock,pairs,sent,received,lost,"
+            "dup,msgs_per_sec,mb_per_sec,p50_us,p90_us,p99_us,p999_us,"
+            "max_us");
+    }
+    else if (mFormat == PERF_FMT_TEXT) {
+        PRINTF("Throughput and latency benchmark: MQTT v%s, %s, pairs %d, "
+            "messages %d",
+        #ifdef WOLFMQTT_V5
+            "5",
+        #else
+            "3.1.1",
+        #endif
+            mInproc ? "in-process broker" : mHost, mPairs, mCount);
+        PRINTF("Transport QoS Payload NB     msgs/s      MB/s   p50 us   "
+            "p90 us   p99 us p99.9 us  lost");
+    }
+}
+
+static void print_row(word32 sent, word32 received, word32 dup,
+    double sec, const double *lat)
+{
+    double rate = (sec > 0) ? received / sec : 0;
+    double mbs = (sec > 0) ?
+        (double)received * mCell.size / sec / (1024 * 1024) : 0;
+    double p50 = percentile_us(lat, received, 0.50);
+    double p90 = percentile_us(lat, received, 0.90);
+    double p99 = percentile_us(lat, received, 0.99);
+    double p999 = percentile_us(lat, received, 0.999);
+    double max = percentile_us(lat, received, 1.0);
+
+    if (mFormat == PERF_FMT_CSV) {
+        PRINTF("%s,%d,%d,%d,%d,%u,%u,%u,%u,%.0f,%.2f,%.1f,%.1f,%.1f,%.1f,"
+            "%.1f", transport_name(), mCell.qos, mCell.size, mCell.nonblock,
+            mPairs, sent, received, sent - received, dup, rate, mbs, p50,
+            p90, p99, p999, max);
+    }
+    else if (mFormat == PERF_FMT_JSON) {
+        PRINTF("{\"transport\":\"%s\",\"qos\":%d,\"payload\":%d,"
+            "\"nonblock\":%d,\"pairs\":%d,\"sent\":%u,\"received\":%u,"
+            "\"lost\":%u,\"dup\":%u,\"msgs_per_sec\":%.0f,"
+            "\"mb_per_sec\":%.2f,\"p50_us\":%.1f,\"p90_us\":%.1f,"
+            "\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f}",
+            transport_name(), mCell.qos, mCell.size, mCell.nonblock, mPairs,
+            sent, received, sent - received, dup, rate, mbs, p50, p90, p99,
+            p999, max);
+    }
+    else {
+        PRINTF("%-9s %3d %7d %2d %10.0f %9.2f %8.1f %8.1f %8.1f %8.1f %5u",
+            transport_name(), mCell.qos, mCell.size, mCell.nonblock, rate,
+            mbs, p50, p90, p99, p999, sent - received);
+    }
+}
+
+static int run_cell(void)
+{
+    PerfPair *pairs;
+    BENCH_THREAD_T *threads = NULL;
+    double *all = NULL, start = 0, end = 0;
+    word32 sent, received = 0, dup = 0, bad = 0, n = 0;
+    int rc = MQTT_CODE_SUCCESS, i, j, started = 0, subs_started = 0;
+#ifdef PERF_INPROC
+    BENCH_THREAD_T broker;
+    int broker_started = 0;
+#endif
+
+    pairs = (PerfPair*)WOLFMQTT_MALLOC(sizeof(PerfPair) * mPairs);
+    if (pairs == NULL) {
+        return MQTT_CODE_ERROR_MEMORY;
+    }
+    XMEMSET(pairs, 0, sizeof(PerfPair) * mPairs);
+    threads = (BENCH_THREAD_T*)WOLFMQTT_MALLOC(sizeof(BENCH_THREAD_T) *
+        2 * mPairs);
+    if (threads == NULL) {
+        rc = MQTT_CODE_ERROR_MEMORY;
+    }
+
+#ifdef PERF_INPROC
+    if (rc == MQTT_CODE_SUCCESS && mInproc) {
+        /* Whole publish in the broker buffer */
+        rc = MqttBroker_Init(&mBroker, (word16)(2 * mPairs),
+            mCell.size + PERF_BUF_SIZE, PERF_TIMEOUT_MS);
+    }
+#endif
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < mPairs; i++) {
+        XSNPRINTF(pairs[i].topic, sizeof(pairs[i].topic), "%s/%08x/%d",
+            PERF_TOPIC_PREFIX, mRunId, i);
+        pairs[i].payload = (byte*)WOLFMQTT_MALLOC(mCell.size);
+        pairs[i].lat = (double*)WOLFMQTT_MALLOC(sizeof(double) * mCount);
+        if (pairs[i].payload == NULL || pairs[i].lat == NULL) {
+            rc = MQTT_CODE_ERROR_MEMORY;
+            break;
+        }
+        XMEMSET(pairs[i].payload, 0xA5, mCell.size);
+        for (j = 0; j < mCount; j++) {
+            pairs[i].lat[j] = -1;
+        }
+        rc = client_setup(&pairs[i].pub, &pairs[i], "p", i);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = client_setup(&pairs[i].sub, &pairs[i], "s", i);
+        }
+    }
+#ifdef PERF_INPROC
+    /* Connections are all added before the broker thread serves them */
+    if (rc == MQTT_CODE_SUCCESS && mInproc) {
+        mBrokerStop = 0;
+        if (BENCH_THREAD_CREATE(&broker, broker_thread, pairs) != 0) {
+            rc = MQTT_CODE_ERROR_SYSTEM;
+        }
+        else {
+            broker_started = 1;
+        }
+    }
+#endif
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < mPairs; i++) {
+        rc = client_connect(&pairs[i].sub);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = client_subscribe(&pairs[i].sub, pairs[i].topic);
+        }
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = client_connect(&pairs[i].pub);
+        }
+    }
+
+    /* Subscribers first, so they are reading when publishing starts */
+    mPubsDone = 0;
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < mPairs; i++) {
+        if (BENCH_THREAD_CREATE(&threads[mPairs + i], sub_thread,
+                &pairs[i]) != 0) {
+            rc = MQTT_CODE_ERROR_SYSTEM;
+            break;
+        }
+        subs_started++;
+    }
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < mPairs; i++) {
+        if (BENCH_THREAD_CREATE(&threads[i], pub_thread, &pairs[i]) != 0) {
+            rc = MQTT_CODE_ERROR_SYSTEM;
+            break;
+        }
+        started++;
+    }
+    for (i = 0; i < started; i++) {
+        BENCH_THREAD_JOIN(threads[i]);
+    }
+    mPubsDone = 1;
+    for (i = 0; i < subs_started; i++) {
+        BENCH_THREAD_JOIN(threads[mPairs + i]);
+    }
+
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < mPairs; i++) {
+        if (pairs[i].pub_rc != MQTT_CODE_SUCCESS) {
+            rc = pairs[i].pub_rc;
+        }
+        else if (pairs[i].sub_rc != MQTT_CODE_SUCCESS) {
+            rc = pairs[i].sub_rc;
+        }
+        received += pairs[i].received;
+        dup += pairs[i].dup;
+        bad += pairs[i].bad;
+        if (i == 0 || pairs[i].first_tx < start) {
+            start = pairs[i].first_tx;
+        }
+        if (pairs[i].last_rx > end) {
+            end = pairs[i].last_rx;
+        }
+    }
+    if (rc == MQTT_CODE_SUCCESS && received > 0) {
+        all = (double*)WOLFMQTT_MALLOC(sizeof(double) * received);
+        if (all == NULL) {
+            rc = MQTT_CODE_ERROR_MEMORY;
+        }
+    }
+    if (all != NULL) {
+        for (i = 0; i < mPairs; i++) {
+            for (j = 0; j < mCount && n < received; j++) {
+                if (pairs[i].lat[j] >= 0) {
+                    all[n++] = pairs[i].lat[j];
+                }
+            }
+        }
+        qsort(all, n, sizeof(double), cmp_double);
+    }
+
+    for (i = 0; i < mPairs; i++) {
+        client_cleanup(&pairs[i].pub);
+        client_cleanup(&pairs[i].sub);
+    }
+#ifdef PERF_INPROC
+    if (broker_started) {
+        mBrokerStop = 1;
+        BENCH_THREAD_JOIN(broker);
+    }
+    if (mInproc) {
+        MqttBroker_Free(&mBroker);
+    }
+#endif
+
+    sent = (word32)mPairs * (word32)mCount;
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("%s QoS %d, %d byte payload failed: %s (%d)",
+            transport_name(), mCell.qos, mCell.size,
+            MqttClient_ReturnCodeToString(rc), rc);
+    }
+    else {
+        print_row(sent, received, dup, end - start, all);
+        if (bad > 0 || received == 0 ||
+                (mCell.qos > MQTT_QOS_0 && received != sent)) {
+            PRINTF("%s QoS %d, %d byte payload: %u wrong, %u lost",
+                transport_name(), mCell.qos, mCell.size, bad,
+                sent - received);
+            rc = -1;
+        }
+    }
+
+    for (i = 0; i < mPairs; i++) {
+        client_free(&pairs[i].pub);
+        client_free(&pairs[i].sub);
+        if (pairs[i].payload != NULL) {
+            WOLFMQTT_FREE(pairs[i].payload);
+        }
+        if (pairs[i].lat != NULL) {
+            WOLFMQTT_FREE(pairs[i].lat);
+        }
+    }
+    if (all != NULL) {
+        WOLFMQTT_FREE(all);
+    }
+    if (threads != NULL) {
+        WOLFMQTT_FREE(threads);
+    }
+    WOLFMQTT_FREE(pairs);
+
+    return (rc == MQTT_CODE_SUCCESS) ? 0 : -1;
+}
+
+/* Parses a comma separated list of numbers, returns the count or -1 */
+static int parse_list(const char *str, int *vals, int min, int max)
+{
+    int count = 0;
+
+    while (*str != '\0') {
+        if (count == PERF_MAX_LIST) {
+            return -1;
+        }
+        vals[count] = XATOI(str);
+        if (vals[count] < min || vals[count] > max) {
+            return -1;
+        }
+        count++;
+        while (*str != '\0' && *str != ',') {
+            str++;
+        }
+        if (*str == ',') {
+            str++;
+        }
+    }
+    return count;
+}
+
+static void usage(void)
+{
+    PRINTF("perfbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-h <host>   Broker host, default localhost");
+    PRINTF("-p <num>    Broker port, default %d (%d with TLS)",
+        MQTT_DEFAULT_PORT, MQTT_SECURE_PORT);
+#ifdef PERF_INPROC
+    PRINTF("-m          In-process broker over the in-memory transport");
+#endif
+    PRINTF("-c <num>    Publisher / subscriber pairs, default 1 (most %d)",
+        PERF_MAX_PAIRS);
+    PRINTF("-n <num>    Messages per publisher, default 10000");
+    PRINTF("-r <num>    Messages per second per publisher, default 0 "
+        "(unlimited)");
+    PRINTF("-q <list>   QoS levels, default 0,1,2");
+    PRINTF("-s <list>   Payload bytes (%d to %d), default 64,1024",
+        PERF_MIN_PAYLOAD, PERF_MAX_PAYLOAD);
+#ifdef ENABLE_MQTT_TLS
+    PRINTF("-t <list>   TLS off / on, default 0");
+    PRINTF("-A <file>   CA certificate file");
+#endif
+#ifdef WOLFMQTT_NONBLOCK
+    PRINTF("-N <list>   Blocking / non-blocking sockets, default 0");
+#endif
+    PRINTF("-f <fmt>    Output text, csv or json, default text");
+}
+
+int main(int argc, char** argv)
+{
+    int qos[PERF_MAX_LIST] = { 0, 1, 2 }, qos_count = 3;
+    int size[PERF_MAX_LIST] = { 64, 1024 }, size_count = 2;
+    int tls[PERF_MAX_LIST] = { 0 }, tls_count = 1, tls_max = 0;
+    int nb[PERF_MAX_LIST] = { 0 }, nb_count = 1, nb_max = 0;
+    int i, q, s, t, b, rc = 0, bad_arg = 0;
+
+#ifdef ENABLE_MQTT_TLS
+    tls_max = 1;
+#endif
+#ifdef WOLFMQTT_NONBLOCK
+    nb_max = 1;
+#endif
+    for (i = 1; i < argc && !bad_arg; i++) {
+        if (XSTRNCMP(argv[i], "-m", 3) == 0) {
+        #ifdef PERF_INPROC
+            mInproc = 1;
+        #else
+            bad_arg = 1;
+        #endif
+        }
+        else if (i + 1 >= argc) {
+            bad_arg = 1;
+        }
+        else if (XSTRNCMP(argv[i], "-h", 3) == 0) {
+            mHost = argv[++i];
+        }
+        else if (XSTRNCMP(argv[i], "-p", 3) == 0) {
+            mPort = (word16)XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-c", 3) == 0) {
+            mPairs = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-n", 3) == 0) {
+            mCount = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-r", 3) == 0) {
+            mRate = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-q", 3) == 0) {
+            qos_count = parse_list(argv[++i], qos, 0, MQTT_QOS_2);
+        }
+        else if (XSTRNCMP(argv[i], "-s", 3) == 0) {
+            size_count = parse_list(argv[++i], size, PERF_MIN_PAYLOAD,
+                PERF_MAX_PAYLOAD);
+        }
+        else if (XSTRNCMP(argv[i], "-t", 3) == 0) {
+            tls_count = parse_list(argv[++i], tls, 0, tls_max);
+        }
+        else if (XSTRNCMP(argv[i], "-N", 3) == 0) {
+            nb_count = parse_list(argv[++i], nb, 0, nb_max);
+        }
+    #ifdef ENABLE_MQTT_TLS
+        else if (XSTRNCMP(argv[i], "-A", 3) == 0) {
+            mCaFile = argv[++i];
+        }
+    #endif
+        else if (XSTRNCMP(argv[i], "-f", 3) == 0) {
+            i++;
+            if (XSTRNCMP(argv[i], "csv", 4) == 0) {
+                mFormat = PERF_FMT_CSV;
+            }
+            else if (XSTRNCMP(argv[i], "json", 5) == 0) {
+                mFormat = PERF_FMT_JSON;
+            }
+            else if (XSTRNCMP(argv[i], "text", 5) != 0) {
+                bad_arg = 1;
+            }
+        }
+        else {
+            bad_arg = 1;
+        }
+    }
+    if (bad_arg || mPairs < 1 || mPairs > PERF_MAX_PAIRS || mCount < 1 ||
+            mRate < 0 || qos_count < 1 || size_count < 1 || tls_count < 1 ||
+            nb_count < 1) {
+        usage();
+        return (argc == 2 && XSTRNCMP(argv[1], "-?", 3) == 0) ? 0 :
+            EXIT_FAILURE;
+    }
+    for (i = 0; mInproc && i < tls_count; i++) {
+        if (tls[i]) {
+            PRINTF("TLS is not supported by the in-process broker");
+            return EXIT_FAILURE;
+        }
+    }
+#ifndef USE_WINDOWS_API
+    /* A connection closed by the broker is reported, not fatal */
+    (void)signal(SIGPIPE, SIG_IGN);
+#endif
+    /* Topics and client ids differ from other runs on a shared broker */
+    mRunId = (word32)(bench_time_sec() * 1000.0);
+
+    print_header();
+    for (t = 0; t < tls_count; t++) {
+        for (b = 0; b < nb_count; b++) {
+            for (q = 0; q < qos_count; q++) {
+                for (s = 0; s < size_count; s++) {
+                    mCell.qos = (MqttQoS)qos[q];
+                    mCell.size = size[s];
+                    mCell.tls = tls[t];
+                    mCell.nonblock = nb[b];
+                    if (run_cell() != 0) {
+                        rc = -1;
+                    }
+                }
+            }
+        }
+    }
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,424 @@
+/* poolbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Message pool benchmark and lifetime check.
+ * The client reads a stream of numbered publishes into pooled buffers
+ * (MqttClient_SetMsgPool) and retains each message (MqttClient_MsgRetain).
+ * A consumer keeps several retained buffers while the client reads on into
+ * its spare buffers, then checks each one still holds its own message, in
+ * order, before releasing it. With multithreading the consumer is a second
+ * thread, so buffers are released from another thread than the reader.
+ * At the end every buffer must be back in the pool. Build with
+ * -fsanitize=address or thread to check the buffer lifetime. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_MSG_POOL
+
+#define BENCH_BUF_SIZE      1024
+#define BENCH_STREAM_MSGS   64
+#define BENCH_MAX_PAYLOAD   512
+#define BENCH_MAX_BUFS      256
+#define BENCH_RETAIN_TRIES  100
+#define BENCH_TOPIC         "wolfMQTT/bench/pool/%d"
+
+/* Retained message passed to the consumer */
+typedef struct _PoolItem {
+    MqttMsgBuf *buf;
+    word32      seq;        /* receive order, from 1 */
+} PoolItem;
+
+typedef struct _PoolBenchCtx {
+    MqttClient      client;
+    MqttNet         net;
+    BenchNet        bnet;
+    MqttMsgPool     pool;
+    byte            tx_buf[BENCH_BUF_SIZE];
+    byte            rx_buf[BENCH_BUF_SIZE];
+
+    /* Reader to consumer queue, never fuller than the pool */
+    PoolItem        queue[BENCH_MAX_BUFS];
+    volatile int    head;
+    volatile int    tail;
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_Sem          lock;
+    BENCH_THREAD_T  thread;
+#endif
+    volatile int    done;
+
+    /* Consumer hold window */
+    PoolItem        held[BENCH_MAX_BUFS];
+    int             held_count;
+    int             hold;
+    word32          last_seq;
+    word32          checked;
+    word32          corrupt;
+
+    /* Reader counts */
+    word32          recvd;
+    word32          retained;
+    word32          copied;
+    word32          errors;
+} PoolBenchCtx;
+
+static PoolBenchCtx mCtx;
+static byte mStream[BENCH_STREAM_MSGS * (BENCH_MAX_PAYLOAD + 64)];
+static int mStreamLen;
+static word32 mPayloadLen = 64;
+
+/* Payload of message seq: the sequence number then a pattern from it */
+static void bench_payload(byte* out, word32 seq)
+{
+    word32 i;
+
+    out[0] = (byte)(seq >> 24);
+    out[1] = (byte)(seq >> 16);
+    out[2] = (byte)(seq >> 8);
+    out[3] = (byte)seq;
+    for (i = 4; i < mPayloadLen; i++) {
+        out[i] = (byte)(seq * 31 + i);
+    }
+}
+
+static int bench_payload_check(const byte* data, word32 len, word32 seq)
+{
+    byte expect[BENCH_MAX_PAYLOAD];
+
+    bench_payload(expect, seq);
+    return (len == mPayloadLen && XMEMCMP(data, expect, len) == 0);
+}
+
+/* Builds BENCH_STREAM_MSGS QoS 0 publishes, replayed by the bench network.
+ * Message i of the stream carries sequence number i. */
+static void build_stream(void)
+{
+    int i, pos = 0, topic_len;
+    word32 remain;
+    char topic[32];
+
+    for (i = 0; i < BENCH_STREAM_MSGS; i++) {
+        topic_len = XSNPRINTF(topic, sizeof(topic), BENCH_TOPIC, i % 4);
+        remain = MQTT_DATA_LEN_SIZE + (word32)topic_len + mPayloadLen;
+    #ifdef WOLFMQTT_V5
+        remain++; /* property length */
+    #endif
+        mStream[pos++] = MQTT_PACKET_TYPE_SET(MQTT_PACKET_TYPE_PUBLISH);
+        do {
+            mStream[pos] = (byte)(remain & 0x7F);
+            remain >>= 7;
+            if (remain > 0) {
+                mStream[pos] |= 0x80;
+            }
+            pos++;
+        } while (remain > 0);
+        mStream[pos++] = (byte)(topic_len >> 8);
+        mStream[pos++] = (byte)topic_len;
+        XMEMCPY(&mStream[pos], topic, topic_len);
+        pos += topic_len;
+    #ifdef WOLFMQTT_V5
+        mStream[pos++] = 0;
+    #endif
+        bench_payload(&mStream[pos], (word32)i);
+        pos += (int)mPayloadLen;
+    }
+    mStreamLen = pos;
+}
+
+/* Checks the retained buffer still holds its message and that messages
+ * arrive in order, then releases it */
+static void consume_release(PoolBenchCtx* ctx, PoolItem* item)
+{
+    MqttMsgBuf* buf = item->buf;
+    word32 stream_seq = (item->seq - 1) % BENCH_STREAM_MSGS;
+    char topic[32];
+    int topic_len;
+
+    topic_len = XSNPRINTF(topic, sizeof(topic), BENCH_TOPIC,
+        (int)(stream_seq % 4));
+    if (item->seq <= ctx->last_seq ||
+            buf->topic_name_len != (word16)topic_len ||
+            XMEMCMP(buf->topic_name, topic, topic_len) != 0 ||
+            !bench_payload_check(buf->buffer, buf->total_len, stream_seq)) {
+        ctx->corrupt++;
+    }
+    ctx->last_seq = item->seq;
+    ctx->checked++;
+    MqttMsgBuf_Release(buf);
+}
+
+/* Holds up to ctx->hold buffers, releasing the oldest first */
+static void consume(PoolBenchCtx* ctx, PoolItem* item)
+{
+    if (ctx->held_count == ctx->hold) {
+        consume_release(ctx, &ctx->held[0]);
+        XMEMMOVE(&ctx->held[0], &ctx->held[1],
+            sizeof(PoolItem) * (ctx->held_count - 1));
+        ctx->held_count--;
+    }
+    ctx->held[ctx->held_count++] = *item;
+}
+
+static void consume_flush(PoolBenchCtx* ctx)
+{
+    int i;
+
+    for (i = 0; i < ctx->held_count; i++) {
+        consume_release(ctx, &ctx->held[i]);
+    }
+    ctx->held_count = 0;
+}
+
+#ifdef WOLFMQTT_MULTITHREAD
+static int queue_pop(PoolBenchCtx* ctx, PoolItem* item)
+{
+    int found = 0;
+
+    if (wm_SemLock(&ctx->lock) == 0) {
+        if (ctx->tail != ctx->head) {
+            *item = ctx->queue[ctx->tail];
+            ctx->tail = (ctx->tail + 1) % BENCH_MAX_BUFS;
+            found = 1;
+        }
+        (void)wm_SemUnlock(&ctx->lock);
+    }
+    return found;
+}
+
+static BENCH_THREAD_RET consumer_task(void* param)
+{
+    PoolBenchCtx* ctx = (PoolBenchCtx*)param;
+    PoolItem item;
+    int done;
+
+    for (;;) {
+        if (queue_pop(ctx, &item)) {
+            consume(ctx, &item);
+            continue;
+        }
+        (void)wm_SemLock(&ctx->lock);
+        done = ctx->done && ctx->tail == ctx->head;
+        (void)wm_SemUnlock(&ctx->lock);
+        if (done) {
+            break;
+        }
+        BENCH_YIELD();
+    }
+    consume_flush(ctx);
+    return BENCH_THREAD_RET_VAL;
+}
+#endif
+
+static int bench_msg_cb(MqttClient *client, MqttMessage *msg,
+    byte msg_new, byte msg_done)
+{
+    PoolBenchCtx* ctx = (PoolBenchCtx*)client->ctx;
+    PoolItem item;
+#ifdef WOLFMQTT_MULTITHREAD
+    int tries;
+#endif
+
+    if (!msg_new || !msg_done) {
+        /* messages fit the pooled buffer */
+        ctx->errors++;
+        return MQTT_CODE_SUCCESS;
+    }
+
+    item.seq = ++ctx->recvd;
+    if (!bench_payload_check(msg->buffer, msg->buffer_len,
+            (item.seq - 1) % BENCH_STREAM_MSGS)) {
+        ctx->errors++;
+    }
+
+    item.buf = MqttClient_MsgRetain(client, msg);
+#ifdef WOLFMQTT_MULTITHREAD
+    /* Give the consumer a chance to release a buffer */
+    for (tries = 0; item.buf == NULL && tries < BENCH_RETAIN_TRIES; tries++) {
+        BENCH_YIELD();
+        item.buf = MqttClient_MsgRetain(client, msg);
+    }
+#endif
+    if (item.buf == NULL) {
+        /* No spare buffer, the application would copy the message */
+        ctx->copied++;
+        return MQTT_CODE_SUCCESS;
+    }
+    ctx->retained++;
+
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&ctx->lock) == 0) {
+        ctx->queue[ctx->head] = item;
+        ctx->head = (ctx->head + 1) % BENCH_MAX_BUFS;
+        (void)wm_SemUnlock(&ctx->lock);
+    }
+#else
+    consume(ctx, &item);
+#endif
+    return MQTT_CODE_SUCCESS;
+}
+
+static int run_bench(int bufs, int hold, word32 count)
+{
+    int rc;
+    double start, elapsed;
+    PoolBenchCtx* ctx = &mCtx;
+
+    XMEMSET(ctx, 0, sizeof(PoolBenchCtx));
+    ctx->hold = hold;
+    rc = MqttMsgPool_Init(&ctx->pool, bufs, BENCH_BUF_SIZE);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, bench_msg_cb,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_SetMsgPool(&ctx->client, &ctx->pool);
+    }
+    ctx->client.ctx = ctx;
+    ctx->bnet.rx = mStream;
+    ctx->bnet.rx_len = mStreamLen;
+#ifdef WOLFMQTT_MULTITHREAD
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = wm_SemInit(&ctx->lock);
+    }
+    if (rc == MQTT_CODE_SUCCESS &&
+            BENCH_THREAD_CREATE(&ctx->thread, consumer_task, ctx) != 0) {
+        PRINTF("Thread create failed!");
+        (void)wm_SemFree(&ctx->lock);
+        rc = MQTT_CODE_ERROR_SYSTEM;
+    }
+#endif
+    if (rc != MQTT_CODE_SUCCESS) {
+        MqttClient_DeInit(&ctx->client);
+        (void)MqttMsgPool_Free(&ctx->pool);
+        return rc;
+    }
+
+    start = bench_time_sec();
+    while (ctx->recvd < count && rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_WaitMessage(&ctx->client, 1000);
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemLock(&ctx->lock);
+    ctx->done = 1;
+    (void)wm_SemUnlock(&ctx->lock);
+    BENCH_THREAD_JOIN(ctx->thread);
+    (void)wm_SemFree(&ctx->lock);
+#else
+    consume_flush(ctx);
+#endif
+    elapsed = bench_time_sec() - start;
+
+    /* Returns the client buffers, the pool must then be complete */
+    MqttClient_DeInit(&ctx->client);
+    if (ctx->pool.free_count != bufs) {
+        PRINTF("%d of %d buffers not returned to the pool",
+            bufs - ctx->pool.free_count, bufs);
+        ctx->errors++;
+    }
+    if (MqttMsgPool_Free(&ctx->pool) != MQTT_CODE_SUCCESS) {
+        ctx->errors++;
+    }
+
+    if (rc == MQTT_CODE_SUCCESS &&
+            (ctx->errors != 0 || ctx->corrupt != 0 ||
+             ctx->checked != ctx->retained)) {
+        PRINTF("%u errors, %u of %u retained messages checked, %u corrupt",
+            ctx->errors, ctx->checked, ctx->retained, ctx->corrupt);
+        rc = MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        PRINTF("%3d buffers, hold %3d: %10.0f msg/sec, %5.1f%% retained "
+            "(%.3f sec)", bufs, hold, (double)ctx->recvd / elapsed,
+            (100.0 * ctx->retained) / ctx->recvd, elapsed);
+    }
+    else {
+        PRINTF("%3d buffers, hold %3d: failed %d (%s)", bufs, hold, rc,
+            MqttClient_ReturnCodeToString(rc));
+    }
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("poolbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Messages per test, default 1000000");
+    PRINTF("-s <num>    Payload bytes, default 64 (min 4, max %d)",
+        BENCH_MAX_PAYLOAD);
+}
+#endif /* WOLFMQTT_MSG_POOL */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_MSG_POOL
+    int i, count = 1000000;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-s", 3) == 0 && i + 1 < argc) {
+            mPayloadLen = (word32)XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1 || mPayloadLen < 4 || mPayloadLen > BENCH_MAX_PAYLOAD) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("Message pool benchmark: %d messages, %u byte payload%s", count,
+        mPayloadLen,
+    #ifdef WOLFMQTT_MULTITHREAD
+        ", released by a consumer thread"
+    #else
+        ""
+    #endif
+        );
+    build_stream();
+
+    /* Plenty of spare buffers, then just enough for the hold window so
+       every buffer is reused (a lagging consumer makes retain copy) */
+    rc = run_bench(64, 8, (word32)count);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_bench(4, 2, (word32)count);
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires the message pool to be enabled
+       ./configure --enable-msgpool */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
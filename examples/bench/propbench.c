@@ -0,0 +1,311 @@
+/* propbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Property allocation benchmark.
+ * Each thread uses its own client and publishes (or receives) messages with
+ * user properties on every message. Compares the shared property allocator
+ * (MqttClient_PropsAdd) against per thread / per client property arenas. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#if defined(WOLFMQTT_V5) && defined(WOLFMQTT_MULTITHREAD)
+
+#define BENCH_MAX_THREADS   64
+#define BENCH_MAX_PROPS     32
+#define BENCH_BUF_SIZE      1024
+#define BENCH_TOPIC         "wolfMQTT/bench/props"
+
+static const char* kPropKey = "bench-key";
+static const char* kPropVal = "bench-value";
+static const byte  kPayload[16] = { 0 };
+
+typedef struct _PropBenchCtx {
+    MqttClient      client;
+    MqttNet         net;
+    BenchNet        bnet;
+    byte            tx_buf[BENCH_BUF_SIZE];
+    byte            rx_buf[BENCH_BUF_SIZE];
+    MqttProp        props[BENCH_MAX_PROPS];
+    MqttPropArena   arena;
+    BENCH_THREAD_T  thread;
+
+    int             use_arena;
+    int             count;
+    int             num_props;
+    int             rc;
+    int             recvd;
+} PropBenchCtx;
+
+static PropBenchCtx mCtx[BENCH_MAX_THREADS];
+static byte mRxPacket[BENCH_BUF_SIZE];
+static int  mRxPacketLen;
+
+static int add_user_props(PropBenchCtx* ctx, MqttProp** head)
+{
+    int i;
+    MqttProp* prop;
+
+    for (i = 0; i < ctx->num_props; i++) {
+        if (ctx->use_arena) {
+            prop = MqttClient_PropsArenaAdd(&ctx->arena, head);
+        }
+        else {
+            prop = MqttClient_PropsAdd(head);
+        }
+        if (prop == NULL) {
+            return MQTT_CODE_ERROR_MEMORY;
+        }
+        prop->type = MQTT_PROP_USER_PROP;
+        prop->data_str.str = (char*)kPropKey;
+        prop->data_str.len = (word16)XSTRLEN(kPropKey);
+        prop->data_str2.str = (char*)kPropVal;
+        prop->data_str2.len = (word16)XSTRLEN(kPropVal);
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int publish_msg(PropBenchCtx* ctx)
+{
+    int rc;
+    MqttPublish publish;
+
+    XMEMSET(&publish, 0, sizeof(publish));
+    publish.qos = MQTT_QOS_0;
+    publish.topic_name = BENCH_TOPIC;
+    publish.buffer = (byte*)kPayload;
+    publish.total_len = (word32)sizeof(kPayload);
+
+    rc = add_user_props(ctx, &publish.props);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_Publish(&ctx->client, &publish);
+    }
+
+    if (ctx->use_arena) {
+        MqttClient_PropsArenaReset(&ctx->arena);
+    }
+    else {
+        MqttClient_PropsFree(publish.props);
+    }
+    return rc;
+}
+
+static int msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    PropBenchCtx* ctx = (PropBenchCtx*)client->ctx;
+    MqttProp* prop;
+    int count = 0;
+
+    if (msg_new) {
+        for (prop = msg->props; prop != NULL; prop = prop->next) {
+            if (prop->type == MQTT_PROP_USER_PROP) {
+                count++;
+            }
+        }
+        if (count != ctx->num_props) {
+            return MQTT_CODE_ERROR_PROPERTY;
+        }
+    }
+    if (msg_done) {
+        ctx->recvd++;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static BENCH_THREAD_RET tx_task(void* param)
+{
+    PropBenchCtx* ctx = (PropBenchCtx*)param;
+    int i;
+
+    for (i = 0; i < ctx->count && ctx->rc == MQTT_CODE_SUCCESS; i++) {
+        ctx->rc = publish_msg(ctx);
+    }
+    return BENCH_THREAD_RET_VAL;
+}
+
+static BENCH_THREAD_RET rx_task(void* param)
+{
+    PropBenchCtx* ctx = (PropBenchCtx*)param;
+
+    while (ctx->recvd < ctx->count && ctx->rc == MQTT_CODE_SUCCESS) {
+        ctx->rc = MqttClient_WaitMessage(&ctx->client, 1000);
+    }
+    return BENCH_THREAD_RET_VAL;
+}
+
+static int run_bench(int rx, int use_arena, int threads, int count,
+    int num_props)
+{
+    int i, rc = MQTT_CODE_SUCCESS;
+    double start, elapsed;
+
+    for (i = 0; i < threads; i++) {
+        PropBenchCtx* ctx = &mCtx[i];
+        XMEMSET(ctx, 0, sizeof(PropBenchCtx));
+        ctx->use_arena = use_arena;
+        ctx->count = count;
+        ctx->num_props = num_props;
+        rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, msg_cb,
+            ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+        ctx->client.ctx = ctx;
+        if (rx) {
+            ctx->bnet.rx = mRxPacket;
+            ctx->bnet.rx_len = mRxPacketLen;
+            if (use_arena) {
+                rc = MqttClient_SetPropArena(&ctx->client, ctx->props,
+                    BENCH_MAX_PROPS);
+            }
+        }
+        else if (use_arena) {
+            rc = MqttClient_PropsArenaInit(&ctx->arena, ctx->props,
+                BENCH_MAX_PROPS);
+        }
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+    }
+
+    start = bench_time_sec();
+    for (i = 0; i < threads; i++) {
+        if (BENCH_THREAD_CREATE(&mCtx[i].thread, rx ? rx_task : tx_task,
+                &mCtx[i]) != 0) {
+            PRINTF("Thread create failed!");
+            threads = i;
+            rc = MQTT_CODE_ERROR_SYSTEM;
+            break;
+        }
+    }
+    for (i = 0; i < threads; i++) {
+        BENCH_THREAD_JOIN(mCtx[i].thread);
+    }
+    elapsed = bench_time_sec() - start;
+
+    for (i = 0; i < threads; i++) {
+        if (mCtx[i].rc != MQTT_CODE_SUCCESS && rc == MQTT_CODE_SUCCESS) {
+            rc = mCtx[i].rc;
+        }
+        MqttClient_DeInit(&mCtx[i].client);
+    }
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        PRINTF("%s %-7s: %10.0f msg/sec (%.3f sec)",
+            rx ? "RX" : "TX", use_arena ? "arena" : "shared",
+            ((double)count * threads) / elapsed, elapsed);
+    }
+    else {
+        PRINTF("%s %-7s: failed %d (%s)",
+            rx ? "RX" : "TX", use_arena ? "arena" : "shared",
+            rc, MqttClient_ReturnCodeToString(rc));
+    }
+    return rc;
+}
+
+/* Encode a publish with user properties to replay for the RX test */
+static int build_rx_packet(int num_props)
+{
+    int rc;
+    PropBenchCtx* ctx = &mCtx[0];
+
+    XMEMSET(ctx, 0, sizeof(PropBenchCtx));
+    ctx->num_props = num_props;
+    ctx->bnet.cap = mRxPacket;
+    ctx->bnet.cap_size = (int)sizeof(mRxPacket);
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, NULL,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = publish_msg(ctx);
+    }
+    mRxPacketLen = ctx->bnet.cap_len;
+    MqttClient_DeInit(&ctx->client);
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("propbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-t <num>    Number of threads, default 4");
+    PRINTF("-n <num>    Messages per thread, default 100000");
+    PRINTF("-p <num>    User properties per message, default 4 (max %d)",
+        BENCH_MAX_PROPS);
+}
+#endif /* WOLFMQTT_V5 && WOLFMQTT_MULTITHREAD */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#if defined(WOLFMQTT_V5) && defined(WOLFMQTT_MULTITHREAD)
+    int i, threads = 4, count = 100000, num_props = 4;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-t", 3) == 0 && i + 1 < argc) {
+            threads = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-p", 3) == 0 && i + 1 < argc) {
+            num_props = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (threads < 1 || threads > BENCH_MAX_THREADS || count < 1 ||
+            num_props < 0 || num_props > BENCH_MAX_PROPS) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("Property benchmark: %d threads, %d messages per thread, "
+        "%d user properties", threads, count, num_props);
+
+    rc = build_rx_packet(num_props);
+    if (rc == MQTT_CODE_SUCCESS) {
+        /* shared allocator failures are reported, but not fatal */
+        (void)run_bench(0, 0, threads, count, num_props);
+        rc = run_bench(0, 1, threads, count, num_props);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        (void)run_bench(1, 0, threads, count, num_props);
+        rc = run_bench(1, 1, threads, count, num_props);
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires v5 and multithread mode to be enabled
+       ./configure --enable-v5 --enable-mt */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
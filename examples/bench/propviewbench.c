@@ -0,0 +1,248 @@
+/* propviewbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Received property benchmark.
+ * Receives publish messages with user properties and reads every user
+ * property in the message callback. Compares the decoded property list
+ * (msg->props) against the lazy property view (msg->props_view), which reads
+ * the properties directly from the receive buffer. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_V5
+
+#define BENCH_MAX_PROPS     24
+#define BENCH_BUF_SIZE      1024
+#define BENCH_TOPIC         "wolfMQTT/bench/propview"
+
+static const char* kPropKey = "bench-key";
+static const char* kPropVal = "bench-value";
+static const byte  kPayload[16] = { 0 };
+
+typedef struct _PropViewBenchCtx {
+    MqttClient      client;
+    MqttNet         net;
+    BenchNet        bnet;
+    byte            tx_buf[BENCH_BUF_SIZE];
+    byte            rx_buf[BENCH_BUF_SIZE];
+
+    int             lazy;
+    int             num_props;
+    int             recvd;
+    word32          prop_bytes;
+} PropViewBenchCtx;
+
+static PropViewBenchCtx mCtx;
+static byte mRxPacket[BENCH_BUF_SIZE];
+static int  mRxPacketLen;
+
+static int msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    PropViewBenchCtx* ctx = (PropViewBenchCtx*)client->ctx;
+    int count = 0;
+
+    if (msg_new) {
+        if (ctx->lazy) {
+            MqttProp prop;
+            while (MqttClient_PropsViewFind(&msg->props_view,
+                    MQTT_PROP_USER_PROP, &prop) > 0) {
+                ctx->prop_bytes += prop.data_str.len + prop.data_str2.len;
+                count++;
+            }
+        }
+        else {
+            MqttProp* prop;
+            for (prop = msg->props; prop != NULL; prop = prop->next) {
+                if (prop->type == MQTT_PROP_USER_PROP) {
+                    ctx->prop_bytes += prop->data_str.len +
+                        prop->data_str2.len;
+                    count++;
+                }
+            }
+        }
+        if (count != ctx->num_props) {
+            return MQTT_CODE_ERROR_PROPERTY;
+        }
+    }
+    if (msg_done) {
+        ctx->recvd++;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Encode a publish with user properties to replay for the test */
+static int build_rx_packet(int num_props)
+{
+    int rc, i;
+    PropViewBenchCtx* ctx = &mCtx;
+    MqttPublish publish;
+    MqttProp* prop;
+
+    XMEMSET(ctx, 0, sizeof(PropViewBenchCtx));
+    ctx->bnet.cap = mRxPacket;
+    ctx->bnet.cap_size = (int)sizeof(mRxPacket);
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, NULL,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    XMEMSET(&publish, 0, sizeof(publish));
+    publish.qos = MQTT_QOS_0;
+    publish.topic_name = BENCH_TOPIC;
+    publish.buffer = (byte*)kPayload;
+    publish.total_len = (word32)sizeof(kPayload);
+    for (i = 0; i < num_props && rc == MQTT_CODE_SUCCESS; i++) {
+        prop = MqttClient_PropsAdd(&publish.props);
+        if (prop == NULL) {
+            rc = MQTT_CODE_ERROR_MEMORY;
+            break;
+        }
+        prop->type = MQTT_PROP_USER_PROP;
+        prop->data_str.str = (char*)kPropKey;
+        prop->data_str.len = (word16)XSTRLEN(kPropKey);
+        prop->data_str2.str = (char*)kPropVal;
+        prop->data_str2.len = (word16)XSTRLEN(kPropVal);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_Publish(&ctx->client, &publish);
+    }
+    MqttClient_PropsFree(publish.props);
+
+    mRxPacketLen = ctx->bnet.cap_len;
+    MqttClient_DeInit(&ctx->client);
+    return rc;
+}
+
+static int run_bench(int lazy, int count, int num_props)
+{
+    int rc;
+    double start, elapsed;
+    PropViewBenchCtx* ctx = &mCtx;
+
+    XMEMSET(ctx, 0, sizeof(PropViewBenchCtx));
+    ctx->lazy = lazy;
+    ctx->num_props = num_props;
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, msg_cb,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc == MQTT_CODE_SUCCESS) {
+        ctx->client.ctx = ctx;
+        ctx->bnet.rx = mRxPacket;
+        ctx->bnet.rx_len = mRxPacketLen;
+        rc = MqttClient_SetLazyProps(&ctx->client, (byte)lazy);
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    start = bench_time_sec();
+    while (ctx->recvd < count && rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_WaitMessage(&ctx->client, 1000);
+    }
+    elapsed = bench_time_sec() - start;
+
+    MqttClient_DeInit(&ctx->client);
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        PRINTF("%2d props %-5s: %10.0f msg/sec (%.3f sec)", num_props,
+            lazy ? "view" : "list", (double)count / elapsed, elapsed);
+    }
+    else {
+        PRINTF("%2d props %-5s: failed %d (%s)", num_props,
+            lazy ? "view" : "list", rc, MqttClient_ReturnCodeToString(rc));
+    }
+    return rc;
+}
+
+static int run_props(int count, int num_props)
+{
+    int rc = build_rx_packet(num_props);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_bench(0, count, num_props);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_bench(1, count, num_props);
+    }
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("propviewbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Messages per test, default 1000000");
+    PRINTF("-p <num>    User properties per message, default 5 and 20 "
+        "(max %d)", BENCH_MAX_PROPS);
+}
+#endif /* WOLFMQTT_V5 */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_V5
+    int i, count = 1000000, num_props = -1;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-p", 3) == 0 && i + 1 < argc) {
+            num_props = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1 || num_props < -1 || num_props > BENCH_MAX_PROPS) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("Received property benchmark: %d messages", count);
+
+    if (num_props >= 0) {
+        rc = run_props(count, num_props);
+    }
+    else {
+        rc = run_props(count, 5);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = run_props(count, 20);
+        }
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires v5 to be enabled
+       ./configure --enable-v5 */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
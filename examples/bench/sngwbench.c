@@ -0,0 +1,734 @@
+/* sngwbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* MQTT-SN gateway benchmark.
+ * Runs an SN_Gateway on a UDP socket on the loopback interface, with
+ * upstream MQTT clients on an in memory network that acknowledges like a
+ * broker. MQTT-SN clients, each with its own UDP socket, connect to the
+ * gateway, register their topic by name and publish from several threads.
+ * Reports the publishes forwarded upstream per second with QoS 0 and QoS 1,
+ * and the publishes lost. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#if defined(WOLFMQTT_SN_GATEWAY) && !defined(USE_WINDOWS_API)
+
+#include "wolfmqtt/mqtt_sn_client.h"
+#include "wolfmqtt/mqtt_sn_gateway.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define BENCH_BUF_SIZE      512
+#define BENCH_UP_BUF_SIZE   4096
+#define BENCH_MAX_PAYLOAD   256
+#define BENCH_TOPIC_PREFIX  "bench/"
+
+/* Upstream network: parses the packets the upstream client writes and
+ * queues the acknowledgments a broker would send */
+typedef struct _UpNet {
+    byte        acc[BENCH_UP_BUF_SIZE];     /* packets written */
+    int         acc_len;
+    byte        rx[BENCH_UP_BUF_SIZE];      /* acknowledgments to read */
+    int         rx_head;
+    int         rx_tail;
+    byte        level;                      /* protocol level connected */
+} UpNet;
+
+typedef struct _UpClient {
+    MqttClient  client;
+    MqttNet     net;
+    UpNet       unet;
+    byte        tx_buf[BENCH_BUF_SIZE];
+    byte        rx_buf[BENCH_BUF_SIZE];
+} UpClient;
+
+typedef struct _SnClient {
+    MqttClient  client;
+    MqttNet     net;
+    SN_TopicRegistry reg;
+    int         fd;
+    char        topic[24];
+    byte        tx_buf[BENCH_BUF_SIZE];
+    byte        rx_buf[BENCH_BUF_SIZE];
+} SnClient;
+
+typedef struct _SenderCtx {
+    int         index;
+    int         count;          /* publishes to send */
+    MqttQoS     qos;
+    int         errors;
+} SenderCtx;
+
+static SN_Gateway mGw;
+static SN_TopicRegistry mGwReg;
+static SN_GatewayNet mGwNet;
+static int mGwFd = -1;
+static struct sockaddr_in mGwAddr;
+static volatile int mStop;
+
+static UpClient* mUp;
+static SnClient* mSn;
+static int mClients = 32;
+static int mUpstreams = 2;
+static int mThreads = 4;
+static int mPayloadLen = 32;
+static byte mPayload[BENCH_MAX_PAYLOAD];
+
+static pthread_mutex_t mStatLock = PTHREAD_MUTEX_INITIALIZER;
+static word32 mUpPublishes;     /* publishes received upstream */
+static word32 mUpBadTopic;      /* with a topic not published */
+
+
+/* Upstream network */
+
+static void up_queue(UpNet* u, const byte* data, int len)
+{
+    if (u->rx_head == u->rx_tail) {
+        u->rx_head = u->rx_tail = 0;
+    }
+    if (u->rx_tail + len <= (int)sizeof(u->rx)) {
+        XMEMCPY(&u->rx[u->rx_tail], data, len);
+        u->rx_tail += len;
+    }
+}
+
+/* Handles one packet, returning its length or 0 when not complete */
+static int up_packet(UpNet* u, const byte* p, int len)
+{
+    int pos = 1, shift = 0, i;
+    word32 remain = 0;
+    byte ack[6];
+    word16 topic_len;
+
+    do {
+        if (pos >= len) {
+            return 0;
+        }
+        remain |= (word32)(p[pos] & 0x7F) << shift;
+        shift += 7;
+    } while (p[pos++] & 0x80);
+    if (pos + (int)remain > len) {
+        return 0;
+    }
+
+    switch (p[0] >> 4) {
+        case MQTT_PACKET_TYPE_CONNECT:
+            u->level = p[pos + 6];
+            ack[0] = MQTT_PACKET_TYPE_CONNECT_ACK << 4;
+            ack[1] = (u->level >= 5) ? 3 : 2;
+            ack[2] = ack[3] = ack[4] = 0;
+            up_queue(u, ack, ack[1] + 2);
+            break;
+        case MQTT_PACKET_TYPE_PUBLISH:
+            topic_len = (word16)((p[pos] << 8) | p[pos + 1]);
+            i = pos + 2;
+            pthread_mutex_lock(&mStatLock);
+            mUpPublishes++;
+            if (topic_len < sizeof(BENCH_TOPIC_PREFIX) - 1 ||
+                    XMEMCMP(&p[i], BENCH_TOPIC_PREFIX,
+                        sizeof(BENCH_TOPIC_PREFIX) - 1) != 0) {
+                mUpBadTopic++;
+            }
+            pthread_mutex_unlock(&mStatLock);
+            if (((p[0] >> 1) & 3) != MQTT_QOS_0) {
+                ack[0] = MQTT_PACKET_TYPE_PUBLISH_ACK << 4;
+                ack[1] = 2;
+                ack[2] = p[i + topic_len];
+                ack[3] = p[i + topic_len + 1];
+                up_queue(u, ack, 4);
+            }
+            break;
+        case MQTT_PACKET_TYPE_SUBSCRIBE:
+        case MQTT_PACKET_TYPE_UNSUBSCRIBE:
+            i = 0;
+            ack[i++] = (byte)(((p[0] >> 4) + 1) << 4);
+            ack[i++] = 0;
+            ack[i++] = p[pos];
+            ack[i++] = p[pos + 1];
+            if (u->level >= 5) {
+                ack[i++] = 0;   /* properties length */
+            }
+            if ((p[0] >> 4) == MQTT_PACKET_TYPE_SUBSCRIBE ||
+                    u->level >= 5) {
+                ack[i++] = MQTT_QOS_1;  /* granted QoS, or reason code */
+            }
+            ack[1] = (byte)(i - 2);
+            up_queue(u, ack, i);
+            break;
+        case MQTT_PACKET_TYPE_PING_REQ:
+            ack[0] = MQTT_PACKET_TYPE_PING_RESP << 4;
+            ack[1] = 0;
+            up_queue(u, ack, 2);
+            break;
+        default:
+            break;
+    }
+    return pos + (int)remain;
+}
+
+static int UpNet_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    (void)context;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int UpNet_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    UpNet* u = (UpNet*)context;
+    int len;
+    (void)timeout_ms;
+
+    if (u->acc_len + buf_len > (int)sizeof(u->acc)) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    XMEMCPY(&u->acc[u->acc_len], buf, buf_len);
+    u->acc_len += buf_len;
+    while ((len = up_packet(u, u->acc, u->acc_len)) > 0) {
+        u->acc_len -= len;
+        XMEMMOVE(u->acc, &u->acc[len], u->acc_len);
+    }
+    return buf_len;
+}
+
+static int UpNet_Read(void *context, byte* buf, int buf_len,
+    int timeout_ms)
+{
+    UpNet* u = (UpNet*)context;
+    (void)timeout_ms;
+
+    if (u->rx_tail - u->rx_head < buf_len) {
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    XMEMCPY(buf, &u->rx[u->rx_head], buf_len);
+    u->rx_head += buf_len;
+    return buf_len;
+}
+
+static int UpNet_Disconnect(void *context)
+{
+    (void)context;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int up_init(UpClient* up, int index)
+{
+    int rc;
+    MqttConnect connect;
+    char client_id[24];
+
+    XMEMSET(up, 0, sizeof(UpClient));
+    up->net.connect = UpNet_Connect;
+    up->net.read = UpNet_Read;
+    up->net.write = UpNet_Write;
+    up->net.disconnect = UpNet_Disconnect;
+    up->net.context = &up->unet;
+    rc = MqttClient_Init(&up->client, &up->net, NULL, up->tx_buf,
+        BENCH_BUF_SIZE, up->rx_buf, BENCH_BUF_SIZE, 1000);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_NetConnect(&up->client, "broker", 0, 1000, 0, NULL);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&connect, 0, sizeof(connect));
+        XSNPRINTF(client_id, sizeof(client_id), "sngw-up-%d", index);
+        connect.client_id = client_id;
+        connect.keep_alive_sec = 60;
+        connect.clean_session = 1;
+        rc = MqttClient_Connect(&up->client, &connect);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = SN_Gateway_AddUpstream(&mGw, &up->client);
+    }
+    return rc;
+}
+
+
+/* Gateway UDP network */
+
+static int GwNet_Recv(void *context, byte *buf, int buf_len,
+    SN_GatewayAddr *from, int timeout_ms)
+{
+    struct pollfd pfd;
+    socklen_t addr_len = (socklen_t)sizeof(from->addr);
+    int rc;
+    (void)context;
+
+    pfd.fd = mGwFd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    rc = poll(&pfd, 1, timeout_ms);
+    if (rc == 0) {
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    if (rc < 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    rc = (int)recvfrom(mGwFd, buf, (size_t)buf_len, 0,
+        (struct sockaddr*)from->addr, &addr_len);
+    if (rc < 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    from->len = (word16)addr_len;
+    return rc;
+}
+
+static int GwNet_Send(void *context, const byte *buf, int buf_len,
+    const SN_GatewayAddr *to)
+{
+    int rc;
+    (void)context;
+
+    rc = (int)sendto(mGwFd, buf, (size_t)buf_len, 0,
+        (const struct sockaddr*)to->addr, (socklen_t)to->len);
+    return (rc < 0) ? MQTT_CODE_ERROR_NETWORK : rc;
+}
+
+static BENCH_THREAD_RET gw_thread(void* arg)
+{
+    int rc;
+    (void)arg;
+
+    while (!mStop) {
+        rc = SN_Gateway_Task(&mGw, 10);
+        if (rc != MQTT_CODE_SUCCESS && rc != MQTT_CODE_ERROR_TIMEOUT) {
+            PRINTF("Gateway task failed %d (%s)", rc,
+                MqttClient_ReturnCodeToString(rc));
+            break;
+        }
+    }
+    return BENCH_THREAD_RET_VAL;
+}
+
+
+/* MQTT-SN client UDP network */
+
+static int SnNet_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    SnClient* sn = (SnClient*)context;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+
+    sn->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sn->fd < 0 || connect(sn->fd, (struct sockaddr*)&mGwAddr,
+            sizeof(mGwAddr)) != 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int SnNet_Recv(SnClient* sn, byte* buf, int buf_len, int timeout_ms,
+    int flags)
+{
+    struct pollfd pfd;
+    int rc;
+
+    pfd.fd = sn->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    rc = poll(&pfd, 1, timeout_ms);
+    if (rc == 0) {
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    if (rc > 0) {
+        rc = (int)recv(sn->fd, buf, (size_t)buf_len, flags);
+    }
+    return (rc < 0) ? MQTT_CODE_ERROR_NETWORK : rc;
+}
+
+static int SnNet_Read(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    return SnNet_Recv((SnClient*)context, buf, buf_len, timeout_ms, 0);
+}
+
+static int SnNet_Peek(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    return SnNet_Recv((SnClient*)context, buf, buf_len, timeout_ms,
+        MSG_PEEK);
+}
+
+static int SnNet_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    SnClient* sn = (SnClient*)context;
+    int rc;
+    (void)timeout_ms;
+
+    rc = (int)send(sn->fd, buf, (size_t)buf_len, 0);
+    return (rc < 0) ? MQTT_CODE_ERROR_NETWORK : rc;
+}
+
+static int SnNet_Disconnect(void *context)
+{
+    SnClient* sn = (SnClient*)context;
+    if (sn->fd >= 0) {
+        close(sn->fd);
+        sn->fd = -1;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int sn_init(SnClient* sn, int index)
+{
+    int rc;
+    SN_Connect connect;
+    char client_id[24];
+
+    XMEMSET(sn, 0, sizeof(SnClient));
+    sn->fd = -1;
+    sn->net.connect = SnNet_Connect;
+    sn->net.read = SnNet_Read;
+    sn->net.peek = SnNet_Peek;
+    sn->net.write = SnNet_Write;
+    sn->net.disconnect = SnNet_Disconnect;
+    sn->net.context = sn;
+    XSNPRINTF(sn->topic, sizeof(sn->topic), BENCH_TOPIC_PREFIX "%d", index);
+
+    rc = MqttClient_Init(&sn->client, &sn->net, NULL, sn->tx_buf,
+        BENCH_BUF_SIZE, sn->rx_buf, BENCH_BUF_SIZE, 1000);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = SN_TopicRegistry_Init(&sn->reg, 4);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = SN_TopicRegistry_Add(&sn->reg, sn->topic, 0,
+            SN_TOPIC_ID_TYPE_NORMAL);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = SN_Client_SetRegistry(&sn->client, &sn->reg);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_NetConnect(&sn->client, "gateway", 0, 1000, 0,
+            NULL);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        /* Registers the topic of the registry once connected */
+        XMEMSET(&connect, 0, sizeof(connect));
+        XSNPRINTF(client_id, sizeof(client_id), "sngw-%d", index);
+        connect.client_id = client_id;
+        connect.protocol_level = SN_PROTOCOL_ID;
+        connect.keep_alive_sec = 60;
+        connect.clean_session = 1;
+        rc = SN_Client_Connect(&sn->client, &connect);
+        if (rc == MQTT_CODE_SUCCESS &&
+                connect.ack.return_code != SN_RC_ACCEPTED) {
+            PRINTF("Connect refused: %d", connect.ack.return_code);
+            rc = MQTT_CODE_ERROR_NETWORK;
+        }
+    }
+    return rc;
+}
+
+static void sn_free(SnClient* sn)
+{
+    if (sn->fd >= 0) {
+        (void)SN_Client_Disconnect(&sn->client);
+        (void)MqttClient_NetDisconnect(&sn->client);
+    }
+    MqttClient_DeInit(&sn->client);
+    SN_TopicRegistry_Free(&sn->reg);
+}
+
+/* Subscribes through the gateway, which subscribes its upstream client */
+static int sn_subscribe(SnClient* sn, const char* filter)
+{
+    int rc;
+    SN_Subscribe subscribe;
+
+    XMEMSET(&subscribe, 0, sizeof(subscribe));
+    subscribe.qos = MQTT_QOS_1;
+    subscribe.topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+    subscribe.topicNameId = filter;
+    subscribe.packet_id = 1;
+    rc = SN_Client_Subscribe(&sn->client, &subscribe);
+    if (rc == MQTT_CODE_SUCCESS &&
+            subscribe.subAck.return_code != SN_RC_ACCEPTED) {
+        PRINTF("Subscribe refused: %d", subscribe.subAck.return_code);
+        rc = MQTT_CODE_ERROR_NETWORK;
+    }
+    return rc;
+}
+
+/* Publishes round robin over the clients of the thread */
+static BENCH_THREAD_RET sender_thread(void* arg)
+{
+    SenderCtx* ctx = (SenderCtx*)arg;
+    SN_Publish publish;
+    int i, c, rc;
+    word16 packet_id = 0;
+
+    c = ctx->index;
+    for (i = 0; i < ctx->count; i++) {
+        SnClient* sn = &mSn[c];
+
+        XMEMSET(&publish, 0, sizeof(publish));
+        publish.qos = ctx->qos;
+        publish.topic_type = SN_TOPIC_ID_TYPE_NAME;
+        publish.topic_name = sn->topic;
+        publish.buffer = mPayload;
+        publish.total_len = (word16)mPayloadLen;
+        if (ctx->qos != MQTT_QOS_0) {
+            if (++packet_id == 0) {
+                packet_id = 1;
+            }
+            publish.packet_id = packet_id;
+        }
+        rc = SN_Client_Publish(&sn->client, &publish);
+        if (rc != MQTT_CODE_SUCCESS) {
+            ctx->errors++;
+        }
+
+        c += mThreads;
+        if (c >= mClients) {
+            c = ctx->index;
+        }
+    }
+    return BENCH_THREAD_RET_VAL;
+}
+
+static word32 up_publishes(void)
+{
+    word32 count;
+    pthread_mutex_lock(&mStatLock);
+    count = mUpPublishes;
+    pthread_mutex_unlock(&mStatLock);
+    return count;
+}
+
+static int run_case(MqttQoS qos, int count)
+{
+    BENCH_THREAD_T threads[64];
+    SenderCtx ctx[64];
+    word32 start_count, last, now_count;
+    double start, elapsed, idle;
+    int t, errors = 0, sent = 0;
+
+    start_count = up_publishes();
+    start = bench_time_sec();
+    for (t = 0; t < mThreads; t++) {
+        XMEMSET(&ctx[t], 0, sizeof(ctx[t]));
+        ctx[t].index = t;
+        ctx[t].qos = qos;
+        ctx[t].count = count / mThreads + ((t < count % mThreads) ? 1 : 0);
+        sent += ctx[t].count;
+        if (BENCH_THREAD_CREATE(&threads[t], sender_thread, &ctx[t]) != 0) {
+            PRINTF("Thread create failed");
+            return MQTT_CODE_ERROR_SYSTEM;
+        }
+    }
+    for (t = 0; t < mThreads; t++) {
+        BENCH_THREAD_JOIN(threads[t]);
+        errors += ctx[t].errors;
+    }
+
+    /* Wait for the gateway to forward the publishes still queued */
+    last = up_publishes();
+    idle = bench_time_sec();
+    while (last - start_count < (word32)sent &&
+            bench_time_sec() - idle < 0.5) {
+        usleep(1000);
+        now_count = up_publishes();
+        if (now_count != last) {
+            last = now_count;
+            idle = bench_time_sec();
+        }
+    }
+    elapsed = bench_time_sec() - start;
+    if (last - start_count < (word32)sent) {
+        /* Not counting the idle wait */
+        elapsed -= 0.5;
+    }
+    now_count = last - start_count;
+
+    PRINTF("QoS %d: %8d sent, %8u forwarded, %6d lost, %6d errors, "
+        "%10.0f msgs/sec", qos, sent, now_count, sent - (int)now_count,
+        errors, (double)now_count / elapsed);
+
+    /* QoS 1 publishes are acknowledged once forwarded */
+    return (qos != MQTT_QOS_0 && (errors != 0 ||
+        now_count != (word32)sent)) ? MQTT_CODE_ERROR_TIMEOUT : 0;
+}
+
+static int gw_init(void)
+{
+    socklen_t addr_len = (socklen_t)sizeof(mGwAddr);
+    int rcvbuf = 8 * 1024 * 1024;
+    int rc;
+
+    mGwFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (mGwFd < 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    (void)setsockopt(mGwFd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    XMEMSET(&mGwAddr, 0, sizeof(mGwAddr));
+    mGwAddr.sin_family = AF_INET;
+    mGwAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    mGwAddr.sin_port = 0;
+    if (bind(mGwFd, (struct sockaddr*)&mGwAddr, sizeof(mGwAddr)) != 0 ||
+            getsockname(mGwFd, (struct sockaddr*)&mGwAddr,
+                &addr_len) != 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+
+    mGwNet.context = NULL;
+    mGwNet.recv = GwNet_Recv;
+    mGwNet.send = GwNet_Send;
+    rc = SN_TopicRegistry_Init(&mGwReg, (word16)(mClients + 16));
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = SN_Gateway_Init(&mGw, &mGwNet, &mGwReg, (word16)mClients, 1);
+    }
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("sngwbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-c <num>    MQTT-SN clients, default 32");
+    PRINTF("-u <num>    Upstream MQTT connections (max %d), default 2",
+        SN_GATEWAY_MAX_UPSTREAM);
+    PRINTF("-n <num>    Publishes per QoS, default 100000");
+    PRINTF("-s <num>    Payload bytes (max %d), default 32", BENCH_MAX_PAYLOAD);
+    PRINTF("-t <num>    Publishing threads (max 64), default 4");
+}
+#endif /* WOLFMQTT_SN_GATEWAY && !USE_WINDOWS_API */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#if defined(WOLFMQTT_SN_GATEWAY) && !defined(USE_WINDOWS_API)
+    int i, count = 100000, up_init_count = 0, sn_init_count = 0;
+    BENCH_THREAD_T gw;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-c", 3) == 0 && i + 1 < argc) {
+            mClients = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-u", 3) == 0 && i + 1 < argc) {
+            mUpstreams = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-s", 3) == 0 && i + 1 < argc) {
+            mPayloadLen = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-t", 3) == 0 && i + 1 < argc) {
+            mThreads = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (mClients < 1 || mClients > 10000 || mUpstreams < 1 ||
+            mUpstreams > SN_GATEWAY_MAX_UPSTREAM || count < 1 ||
+            mPayloadLen < 1 || mPayloadLen > BENCH_MAX_PAYLOAD ||
+            mThreads < 1 || mThreads > 64) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    if (mThreads > mClients) {
+        mThreads = mClients;
+    }
+    for (i = 0; i < mPayloadLen; i++) {
+        mPayload[i] = (byte)('a' + i % 26);
+    }
+
+    mUp = (UpClient*)WOLFMQTT_MALLOC(sizeof(UpClient) * mUpstreams);
+    mSn = (SnClient*)WOLFMQTT_MALLOC(sizeof(SnClient) * mClients);
+    if (mUp == NULL || mSn == NULL) {
+        rc = MQTT_CODE_ERROR_MEMORY;
+    }
+    if (rc == 0) {
+        rc = gw_init();
+    }
+    for (; rc == 0 && up_init_count < mUpstreams; up_init_count++) {
+        rc = up_init(&mUp[up_init_count], up_init_count);
+    }
+    if (rc == 0 && BENCH_THREAD_CREATE(&gw, gw_thread, NULL) != 0) {
+        rc = MQTT_CODE_ERROR_SYSTEM;
+    }
+    if (rc == 0) {
+        for (; rc == 0 && sn_init_count < mClients; sn_init_count++) {
+            rc = sn_init(&mSn[sn_init_count], sn_init_count);
+        }
+        if (rc == 0) {
+            rc = sn_subscribe(&mSn[0], BENCH_TOPIC_PREFIX "down/#");
+        }
+        if (rc == 0) {
+            PRINTF("MQTT-SN gateway benchmark: %d clients, %d upstream, "
+                "%d threads, %d byte payload", mClients, mUpstreams,
+                mThreads, mPayloadLen);
+            rc = run_case(MQTT_QOS_0, count);
+        }
+        if (rc == 0) {
+            rc = run_case(MQTT_QOS_1, count);
+        }
+        if (rc == 0 && mUpBadTopic != 0) {
+            PRINTF("Publishes with a wrong topic: %u", mUpBadTopic);
+            rc = MQTT_CODE_ERROR_MALFORMED_DATA;
+        }
+        if (rc != 0) {
+            PRINTF("Failed %d (%s)", rc, MqttClient_ReturnCodeToString(rc));
+        }
+
+        for (i = 0; i < sn_init_count; i++) {
+            sn_free(&mSn[i]);
+        }
+        mStop = 1;
+        BENCH_THREAD_JOIN(gw);
+    }
+    for (i = 0; i < up_init_count; i++) {
+        MqttClient_DeInit(&mUp[i].client);
+    }
+    SN_Gateway_Free(&mGw);
+    SN_TopicRegistry_Free(&mGwReg);
+    if (mGwFd >= 0) {
+        close(mGwFd);
+    }
+    if (mUp) WOLFMQTT_FREE(mUp);
+    if (mSn) WOLFMQTT_FREE(mSn);
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires the MQTT-SN gateway to be enabled
+       ./configure --enable-sn --enable-snregistry --enable-sngateway */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,514 @@
+/* snretrybench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* MQTT-SN retransmission benchmark.
+ * An MQTT-SN client with a retransmission timer talks to a minimal gateway
+ * thread over an in memory datagram link that delays each datagram and
+ * drops a share of them in both directions. For each loss rate the client
+ * connects, registers a topic, subscribes and publishes with QoS 1 (or 2),
+ * and the delivery latency of the acknowledged publishes, the
+ * retransmissions, the publishes given up and the estimated round trip time
+ * are reported. Fails when the connect, register or subscribe is given up,
+ * or an acknowledged publish was not received by the gateway. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#if defined(WOLFMQTT_SN_RETRY) && !defined(USE_WINDOWS_API)
+
+#include "wolfmqtt/mqtt_sn_client.h"
+
+#define BENCH_BUF_SIZE      256
+#define BENCH_LINK_SLOTS    64
+#define BENCH_TOPIC         "bench/retry"
+#define BENCH_TOPIC_ID      1
+
+/* One way of the link: datagrams in order, each delivered once due */
+typedef struct _Datagram {
+    double      due;
+    int         len;
+    byte        data[BENCH_BUF_SIZE];
+} Datagram;
+
+typedef struct _Link {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    Datagram    slots[BENCH_LINK_SLOTS];
+    int         head;
+    int         count;
+    word32      seed;
+    word32      sent;
+    word32      dropped;
+} Link;
+
+static Link mToGw;
+static Link mToClient;
+static volatile int mStop;
+static double mDelay = 0.005;       /* one way, seconds */
+static int mLossPct;
+static int mRtoMin = 50;
+static int mMaxRetry;
+
+/* Publishes seen by the gateway */
+static byte* mReceived;             /* per packet ID */
+static word32 mDuplicates;
+
+static MqttClient mClient;
+static MqttNet mNet;
+static SN_Retry mRetry;
+static byte mTxBuf[BENCH_BUF_SIZE];
+static byte mRxBuf[BENCH_BUF_SIZE];
+
+
+/* Simple deterministic generator, so runs drop the same datagrams */
+static word32 bench_rand(word32* state)
+{
+    *state = *state * 1103515245UL + 12345UL;
+    return (*state >> 8) & 0xFFFFFF;
+}
+
+static void link_init(Link* link, word32 seed)
+{
+    pthread_condattr_t attr;
+
+    XMEMSET(link, 0, sizeof(Link));
+    pthread_mutex_init(&link->lock, NULL);
+    /* bench_time_sec is CLOCK_MONOTONIC, so waits use it too */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&link->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    link->seed = seed;
+}
+
+static void link_free(Link* link)
+{
+    pthread_mutex_destroy(&link->lock);
+    pthread_cond_destroy(&link->cond);
+}
+
+static void link_send(Link* link, const byte* buf, int len)
+{
+    pthread_mutex_lock(&link->lock);
+    link->sent++;
+    if ((int)(bench_rand(&link->seed) % 10000) < mLossPct * 100 ||
+            link->count == BENCH_LINK_SLOTS || len > BENCH_BUF_SIZE) {
+        link->dropped++;
+    }
+    else {
+        Datagram* d = &link->slots[(link->head + link->count) %
+            BENCH_LINK_SLOTS];
+        d->due = bench_time_sec() + mDelay;
+        d->len = len;
+        XMEMCPY(d->data, buf, len);
+        link->count++;
+        pthread_cond_signal(&link->cond);
+    }
+    pthread_mutex_unlock(&link->lock);
+}
+
+/* Returns the length of the next due datagram, or MQTT_CODE_ERROR_TIMEOUT */
+static int link_recv(Link* link, byte* buf, int buf_len, int timeout_ms,
+    int peek)
+{
+    double end = bench_time_sec() + timeout_ms / 1000.0, now;
+    int rc = MQTT_CODE_ERROR_TIMEOUT;
+
+    pthread_mutex_lock(&link->lock);
+    while ((now = bench_time_sec()) < end) {
+        double wait = end;
+        if (link->count > 0) {
+            Datagram* d = &link->slots[link->head];
+            if (d->due <= now) {
+                rc = (d->len < buf_len) ? d->len : buf_len;
+                XMEMCPY(buf, d->data, rc);
+                if (!peek) {
+                    link->head = (link->head + 1) % BENCH_LINK_SLOTS;
+                    link->count--;
+                }
+                break;
+            }
+            if (d->due < wait) {
+                wait = d->due;
+            }
+        }
+        {
+            struct timespec ts;
+            ts.tv_sec = (time_t)wait;
+            ts.tv_nsec = (long)((wait - (double)ts.tv_sec) * 1000000000.0);
+            (void)pthread_cond_timedwait(&link->cond, &link->lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&link->lock);
+    return rc;
+}
+
+
+/* Minimal gateway: accepts everything and acknowledges like a gateway */
+
+static void gw_reply(const byte* p, int len)
+{
+    byte ack[8];
+    int ack_len = 0;
+    word16 packet_id;
+
+    if (len < 2 || p[0] != len) {
+        return;
+    }
+    switch (p[1]) {
+        case SN_MSG_TYPE_CONNECT:
+            ack[0] = 3; ack[1] = SN_MSG_TYPE_CONNACK; ack[2] = SN_RC_ACCEPTED;
+            ack_len = 3;
+            break;
+        case SN_MSG_TYPE_REGISTER:
+            if (len < 6) break;
+            ack[0] = 7; ack[1] = SN_MSG_TYPE_REGACK;
+            ack[2] = 0; ack[3] = BENCH_TOPIC_ID;
+            ack[4] = p[4]; ack[5] = p[5];
+            ack[6] = SN_RC_ACCEPTED;
+            ack_len = 7;
+            break;
+        case SN_MSG_TYPE_SUBSCRIBE:
+            if (len < 5) break;
+            ack[0] = 8; ack[1] = SN_MSG_TYPE_SUBACK;
+            ack[2] = p[2] & 0x60;   /* granted QoS */
+            ack[3] = 0; ack[4] = BENCH_TOPIC_ID;
+            ack[5] = p[3]; ack[6] = p[4];
+            ack[7] = SN_RC_ACCEPTED;
+            ack_len = 8;
+            break;
+        case SN_MSG_TYPE_PUBLISH:
+            if (len < 7) break;
+            packet_id = (word16)((p[5] << 8) | p[6]);
+            if (mReceived[packet_id]) {
+                mDuplicates++;
+            }
+            mReceived[packet_id] = 1;
+            if ((p[2] & 0x60) == 0x20) {
+                ack[0] = 7; ack[1] = SN_MSG_TYPE_PUBACK;
+                ack[2] = p[3]; ack[3] = p[4];
+                ack[4] = p[5]; ack[5] = p[6];
+                ack[6] = SN_RC_ACCEPTED;
+                ack_len = 7;
+            }
+            else if ((p[2] & 0x60) == 0x40) {
+                ack[0] = 4; ack[1] = SN_MSG_TYPE_PUBREC;
+                ack[2] = p[5]; ack[3] = p[6];
+                ack_len = 4;
+            }
+            break;
+        case SN_MSG_TYPE_PUBREL:
+            if (len < 4) break;
+            ack[0] = 4; ack[1] = SN_MSG_TYPE_PUBCOMP;
+            ack[2] = p[2]; ack[3] = p[3];
+            ack_len = 4;
+            break;
+        case SN_MSG_TYPE_PING_REQ:
+            ack[0] = 2; ack[1] = SN_MSG_TYPE_PING_RESP;
+            ack_len = 2;
+            break;
+        case SN_MSG_TYPE_DISCONNECT:
+            ack[0] = 2; ack[1] = SN_MSG_TYPE_DISCONNECT;
+            ack_len = 2;
+            break;
+        default:
+            break;
+    }
+    if (ack_len > 0) {
+        link_send(&mToClient, ack, ack_len);
+    }
+}
+
+static BENCH_THREAD_RET gw_thread(void* arg)
+{
+    byte buf[BENCH_BUF_SIZE];
+    int len;
+    (void)arg;
+
+    while (!mStop) {
+        len = link_recv(&mToGw, buf, sizeof(buf), 20, 0);
+        if (len > 0) {
+            gw_reply(buf, len);
+        }
+    }
+    return BENCH_THREAD_RET_VAL;
+}
+
+
+/* MQTT-SN client network */
+
+static int Net_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    (void)context;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int Net_Read(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    (void)context;
+    return link_recv(&mToClient, buf, buf_len, timeout_ms, 0);
+}
+
+static int Net_Peek(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    (void)context;
+    return link_recv(&mToClient, buf, buf_len, timeout_ms, 1);
+}
+
+static int Net_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    (void)context;
+    (void)timeout_ms;
+    link_send(&mToGw, buf, buf_len);
+    return buf_len;
+}
+
+static int Net_Disconnect(void *context)
+{
+    (void)context;
+    return MQTT_CODE_SUCCESS;
+}
+
+static word32 now_ms(void* ctx)
+{
+    (void)ctx;
+    return (word32)(bench_time_sec() * 1000.0);
+}
+
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static int run_case(int loss_pct, int count, MqttQoS qos, double* lat)
+{
+    int rc, i, lost = 0, failed = 0, done = 0;
+    SN_Connect connect;
+    SN_Register regist;
+    SN_Subscribe subscribe;
+    SN_Publish publish;
+    byte payload[16];
+    double start, sum = 0;
+    BENCH_THREAD_T gw;
+
+    mLossPct = loss_pct;
+    mStop = 0;
+    mDuplicates = 0;
+    XMEMSET(mReceived, 0, 65536);
+    link_init(&mToGw, 1);
+    link_init(&mToClient, 2);
+    XMEMSET(payload, 'p', sizeof(payload));
+
+    rc = SN_Retry_Init(&mRetry, now_ms, NULL, (byte)mMaxRetry);
+    if (rc == MQTT_CODE_SUCCESS) {
+        /* Round trips here are milliseconds, allow timeouts below the
+           default minimum */
+        mRetry.rto_min_ms = (word32)mRtoMin;
+        rc = MqttClient_Init(&mClient, &mNet, NULL, mTxBuf, BENCH_BUF_SIZE,
+            mRxBuf, BENCH_BUF_SIZE, 1000);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = SN_Client_SetRetry(&mClient, &mRetry);
+    }
+    if (rc == MQTT_CODE_SUCCESS &&
+            BENCH_THREAD_CREATE(&gw, gw_thread, NULL) != 0) {
+        rc = MQTT_CODE_ERROR_SYSTEM;
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    rc = MqttClient_NetConnect(&mClient, "gateway", 0, 1000, 0, NULL);
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&connect, 0, sizeof(connect));
+        connect.client_id = "snretry";
+        connect.protocol_level = SN_PROTOCOL_ID;
+        connect.keep_alive_sec = 60;
+        connect.clean_session = 1;
+        rc = SN_Client_Connect(&mClient, &connect);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&regist, 0, sizeof(regist));
+        regist.topicName = BENCH_TOPIC;
+        regist.packet_id = 1;
+        rc = SN_Client_Register(&mClient, &regist);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&subscribe, 0, sizeof(subscribe));
+        subscribe.qos = MQTT_QOS_1;
+        subscribe.topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+        subscribe.topicNameId = BENCH_TOPIC;
+        subscribe.packet_id = 2;
+        rc = SN_Client_Subscribe(&mClient, &subscribe);
+    }
+
+    start = bench_time_sec();
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < count; i++) {
+        double t = bench_time_sec();
+        XMEMSET(&publish, 0, sizeof(publish));
+        publish.qos = qos;
+        publish.topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+        publish.topic_name = (const char*)&regist.regack.topicId;
+        publish.packet_id = (word16)(i + 3);
+        publish.buffer = payload;
+        publish.total_len = (word16)sizeof(payload);
+        rc = SN_Client_Publish(&mClient, &publish);
+        if (rc == MQTT_CODE_ERROR_TIMEOUT) {
+            /* Given up after max_retry, the publish may still have arrived */
+            failed++;
+            rc = MQTT_CODE_SUCCESS;
+            continue;
+        }
+        if (rc == MQTT_CODE_SUCCESS && !mReceived[publish.packet_id]) {
+            lost++;
+        }
+        lat[done] = (bench_time_sec() - t) * 1000.0;
+        sum += lat[done++];
+    }
+    if (rc == MQTT_CODE_SUCCESS && done > 0) {
+        qsort(lat, (size_t)done, sizeof(double), cmp_double);
+        PRINTF("%3d%%  %7.2f %7.2f %7.2f %8.2f  %5u %4u %4d  %4u %5u  %5.2fs",
+            loss_pct, sum / done, lat[done / 2], lat[done * 99 / 100],
+            lat[done - 1], mRetry.stats.retransmits, mDuplicates, failed,
+            mRetry.srtt_ms, mRetry.rto_ms, bench_time_sec() - start);
+        if (lost != 0) {
+            PRINTF("Publishes not received: %d", lost);
+            rc = MQTT_CODE_ERROR_TIMEOUT;
+        }
+    }
+    else {
+        PRINTF("%3d%%  failed %d (%s), %u requests given up", loss_pct, rc,
+            MqttClient_ReturnCodeToString(rc), mRetry.stats.failures);
+    }
+
+    mStop = 1;
+    BENCH_THREAD_JOIN(gw);
+    MqttClient_DeInit(&mClient);
+    SN_Retry_Free(&mRetry);
+    link_free(&mToGw);
+    link_free(&mToClient);
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("snretrybench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Publishes per loss rate, default 1000");
+    PRINTF("-d <ms>     One way delay, default 5");
+    PRINTF("-q <num>    QoS 1 or 2, default 1");
+    PRINTF("-l <pct>    Only this loss rate, default 0, 1, 5 and 20");
+    PRINTF("-m <ms>     Lowest retransmission timeout, default 50");
+    PRINTF("-r <num>    Most retransmissions, default %d", SN_RETRY_MAX);
+}
+#endif /* WOLFMQTT_SN_RETRY && !USE_WINDOWS_API */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#if defined(WOLFMQTT_SN_RETRY) && !defined(USE_WINDOWS_API)
+    static const int loss[] = { 0, 1, 5, 20 };
+    int i, count = 1000, qos = 1, only = -1;
+    double* lat;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-d", 3) == 0 && i + 1 < argc) {
+            mDelay = XATOI(argv[++i]) / 1000.0;
+        }
+        else if (XSTRNCMP(argv[i], "-q", 3) == 0 && i + 1 < argc) {
+            qos = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-l", 3) == 0 && i + 1 < argc) {
+            only = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-m", 3) == 0 && i + 1 < argc) {
+            mRtoMin = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-r", 3) == 0 && i + 1 < argc) {
+            mMaxRetry = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1 || count > 60000 || mDelay < 0 || (qos != 1 && qos != 2) ||
+            only > 90 || mRtoMin < 1 || mMaxRetry < 0 || mMaxRetry > 255) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    lat = (double*)WOLFMQTT_MALLOC(sizeof(double) * count);
+    mReceived = (byte*)WOLFMQTT_MALLOC(65536);
+    if (lat == NULL || mReceived == NULL) {
+        rc = MQTT_CODE_ERROR_MEMORY;
+    }
+    if (rc == 0) {
+        mNet.connect = Net_Connect;
+        mNet.read = Net_Read;
+        mNet.peek = Net_Peek;
+        mNet.write = Net_Write;
+        mNet.disconnect = Net_Disconnect;
+
+        PRINTF("MQTT-SN retransmission benchmark: %d QoS %d publishes, "
+            "%.1f ms one way delay", count, qos, mDelay * 1000.0);
+        PRINTF("loss  latency ms: mean     p50     p99      max  "
+            "resent dups fail  srtt   rto  time");
+        if (only >= 0) {
+            rc = run_case(only, count, (MqttQoS)qos, lat);
+        }
+        for (i = 0; only < 0 && rc == 0 &&
+                i < (int)(sizeof(loss) / sizeof(loss[0])); i++) {
+            rc = run_case(loss[i], count, (MqttQoS)qos, lat);
+        }
+    }
+    if (lat != NULL) {
+        WOLFMQTT_FREE(lat);
+    }
+    if (mReceived != NULL) {
+        WOLFMQTT_FREE(mReceived);
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires MQTT-SN retransmission to be enabled
+       ./configure --enable-sn --enable-snretry */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,650 @@
+/* snsleepbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* MQTT-SN sleeping client benchmark.
+ * Simulates a battery device receiving messages from a gateway, a dozen
+ * an hour by default, over a number of hours of simulated time. The
+ * gateway runs in the write callback of the client, so the run takes no
+ * real time. The device either stays connected, sending a keep alive ping
+ * every minute and listening all the time, or sleeps with durations of 1,
+ * 5 and 15 minutes, waking with a ping with its client ID to receive the
+ * messages buffered by the gateway. The wake ups, the packets and bytes
+ * on air, the time the radio is on and the delay of the messages are
+ * reported per hour. The radio time counts the air time of each packet at
+ * the bit rate, and a turnaround for each packet received. Fails when a
+ * message is lost or the client state or counters are wrong. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_SN_SLEEP
+
+#include "wolfmqtt/mqtt_sn_client.h"
+
+#define BENCH_BUF_SIZE      128
+#define BENCH_PAYLOAD_SIZE  16
+#define BENCH_TOPIC_ID      1
+#define BENCH_CLIENT_ID     "sleepy"
+/* Assumed bytes of framing around each datagram on air: IEEE 802.15.4
+   header and compressed IPv6 and UDP headers */
+#define BENCH_FRAME_BYTES   25
+
+/* Datagrams to the client, in order */
+typedef struct _Datagram {
+    int         len;
+    byte        data[BENCH_BUF_SIZE];
+} Datagram;
+
+/* Radio use of the device */
+typedef struct _Radio {
+    word32      tx_packets;
+    word32      rx_packets;
+    word32      tx_bytes;       /* on air, with framing */
+    word32      rx_bytes;
+    double      on_sec;         /* air time and turnarounds */
+} Radio;
+
+static Datagram* mQueue;
+static int mQueueSize;
+static int mHead;
+static int mQueued;
+
+static double mNow;                 /* simulated seconds */
+static double mBitrate = 250000.0;  /* bits per second */
+static double mTurn = 0.010;        /* seconds per packet received */
+static Radio mRadio;
+
+/* Messages for the device, by sequence number */
+static int mMsgCount;
+static double* mArrival;
+static byte* mDelivered;
+static int mNextMsg;            /* next message to arrive */
+static double mDelaySum;
+static double mDelayMax;
+static int mDelivCount;
+static int mDupCount;
+
+/* Gateway view of the client */
+static int mGwState;
+static int mGwLost;             /* forgot the client, as after a restart */
+static int mGwPendFirst;        /* buffered while asleep, in order */
+static int mGwPendCount;
+static word16 mGwMsgId;
+static MqttQoS mQos = MQTT_QOS_1;
+
+static MqttClient mClient;
+static MqttNet mNet;
+static byte mTxBuf[BENCH_BUF_SIZE];
+static byte mRxBuf[BENCH_BUF_SIZE];
+
+
+/* Simple deterministic generator, so runs see the same arrivals */
+static word32 bench_rand(word32* state)
+{
+    *state = *state * 1103515245UL + 12345UL;
+    return (*state >> 8) & 0xFFFFFF;
+}
+
+static double air_time(int len)
+{
+    return (len + BENCH_FRAME_BYTES) * 8.0 / mBitrate;
+}
+
+
+/* Minimal gateway, buffering publishes while the client sleeps */
+
+static void gw_send(const byte* buf, int len)
+{
+    Datagram* d;
+
+    if (mQueued == mQueueSize) {
+        return;
+    }
+    d = &mQueue[(mHead + mQueued) % mQueueSize];
+    d->len = len;
+    XMEMCPY(d->data, buf, len);
+    mQueued++;
+}
+
+static void gw_send_type(byte type)
+{
+    byte pkt[2];
+    pkt[0] = 2;
+    pkt[1] = type;
+    gw_send(pkt, 2);
+}
+
+static void gw_publish(int seq)
+{
+    byte pkt[7 + BENCH_PAYLOAD_SIZE];
+
+    pkt[0] = (byte)sizeof(pkt);
+    pkt[1] = SN_MSG_TYPE_PUBLISH;
+    pkt[2] = (byte)(((mQos & 0x3) << 5) | SN_TOPIC_ID_TYPE_PREDEF);
+    pkt[3] = 0; pkt[4] = BENCH_TOPIC_ID;
+    if (++mGwMsgId == 0) {
+        mGwMsgId = 1;
+    }
+    pkt[5] = (byte)(mGwMsgId >> 8); pkt[6] = (byte)mGwMsgId;
+    XMEMSET(&pkt[7], 'm', BENCH_PAYLOAD_SIZE);
+    pkt[7] = (byte)(seq >> 24); pkt[8] = (byte)(seq >> 16);
+    pkt[9] = (byte)(seq >> 8); pkt[10] = (byte)seq;
+    gw_send(pkt, (int)sizeof(pkt));
+}
+
+/* Sends the next buffered message of an awake client, or the ping response
+   when there are no more */
+static void gw_drain(void)
+{
+    while (mGwPendCount > 0) {
+        gw_publish(mGwPendFirst++);
+        mGwPendCount--;
+        if (mQos > MQTT_QOS_0) {
+            return; /* next one on the PUBACK */
+        }
+    }
+    gw_send_type(SN_MSG_TYPE_PING_RESP);
+    mGwState = SN_CLIENT_STATE_ASLEEP;
+}
+
+/* A message for the device arrives at the gateway */
+static void gw_arrive(int seq)
+{
+    if (mGwState == SN_CLIENT_STATE_ACTIVE) {
+        gw_publish(seq);
+    }
+    else {
+        if (mGwPendCount == 0) {
+            mGwPendFirst = seq;
+        }
+        mGwPendCount++;
+    }
+}
+
+static void gw_recv(const byte* p, int len)
+{
+    byte ack[3];
+
+    if (len < 2 || p[0] != len) {
+        return;
+    }
+    switch (p[1]) {
+        case SN_MSG_TYPE_CONNECT:
+            ack[0] = 3; ack[1] = SN_MSG_TYPE_CONNACK; ack[2] = SN_RC_ACCEPTED;
+            gw_send(ack, 3);
+            mGwState = SN_CLIENT_STATE_ACTIVE;
+            mGwLost = 0;
+            break;
+        case SN_MSG_TYPE_DISCONNECT:
+            gw_send_type(SN_MSG_TYPE_DISCONNECT);
+            /* With a duration the client goes to sleep */
+            mGwState = (len == 4) ? SN_CLIENT_STATE_ASLEEP :
+                SN_CLIENT_STATE_DISCONNECTED;
+            break;
+        case SN_MSG_TYPE_PING_REQ:
+            if (len == 2) {
+                gw_send_type(SN_MSG_TYPE_PING_RESP);
+            }
+            else if (mGwLost || mGwState == SN_CLIENT_STATE_DISCONNECTED) {
+                /* Unknown client */
+                gw_send_type(SN_MSG_TYPE_DISCONNECT);
+                mGwState = SN_CLIENT_STATE_DISCONNECTED;
+            }
+            else {
+                mGwState = SN_CLIENT_STATE_AWAKE;
+                gw_drain();
+            }
+            break;
+        case SN_MSG_TYPE_PUBACK:
+            if (mGwState == SN_CLIENT_STATE_AWAKE) {
+                gw_drain();
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+/* MQTT-SN client network, the radio of the device */
+
+static int Net_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    (void)context;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int Net_Recv(byte* buf, int buf_len, int peek)
+{
+    Datagram* d;
+    int len;
+
+    /* Nothing else arrives in simulated time */
+    if (mQueued == 0) {
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    d = &mQueue[mHead];
+    len = (d->len < buf_len) ? d->len : buf_len;
+    XMEMCPY(buf, d->data, len);
+    if (!peek) {
+        mRadio.rx_packets++;
+        mRadio.rx_bytes += d->len + BENCH_FRAME_BYTES;
+        mRadio.on_sec += mTurn + air_time(d->len);
+        mHead = (mHead + 1) % mQueueSize;
+        mQueued--;
+    }
+    return len;
+}
+
+static int Net_Read(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    (void)context;
+    (void)timeout_ms;
+    return Net_Recv(buf, buf_len, 0);
+}
+
+static int Net_Peek(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    (void)context;
+    (void)timeout_ms;
+    return Net_Recv(buf, buf_len, 1);
+}
+
+static int Net_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    (void)context;
+    (void)timeout_ms;
+    mRadio.tx_packets++;
+    mRadio.tx_bytes += buf_len + BENCH_FRAME_BYTES;
+    mRadio.on_sec += air_time(buf_len);
+    gw_recv(buf, buf_len);
+    return buf_len;
+}
+
+static int Net_Disconnect(void *context)
+{
+    (void)context;
+    return MQTT_CODE_SUCCESS;
+}
+
+
+static int msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    int seq;
+    double delay;
+    (void)client;
+    (void)msg_done;
+
+    if (!msg_new || msg->buffer_len < 4) {
+        return MQTT_CODE_SUCCESS;
+    }
+    seq = ((int)msg->buffer[0] << 24) | ((int)msg->buffer[1] << 16) |
+          ((int)msg->buffer[2] << 8) | msg->buffer[3];
+    if (seq < 0 || seq >= mMsgCount) {
+        return MQTT_CODE_SUCCESS;
+    }
+    if (mDelivered[seq]) {
+        mDupCount++;
+        return MQTT_CODE_SUCCESS;
+    }
+    mDelivered[seq] = 1;
+    mDelivCount++;
+    delay = mNow - mArrival[seq];
+    mDelaySum += delay;
+    if (delay > mDelayMax) {
+        mDelayMax = delay;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Messages arriving at the gateway until the time */
+static void arrive_until(double t)
+{
+    while (mNextMsg < mMsgCount && mArrival[mNextMsg] <= t) {
+        mNow = mArrival[mNextMsg];
+        gw_arrive(mNextMsg++);
+    }
+    mNow = t;
+}
+
+static int client_start(void)
+{
+    int rc;
+    SN_Connect connect;
+
+    mHead = mQueued = 0;
+    mGwState = SN_CLIENT_STATE_DISCONNECTED;
+    mGwLost = 0;
+    mGwPendFirst = mGwPendCount = 0;
+    mNow = 0;
+    mNextMsg = 0;
+    mDelaySum = mDelayMax = 0;
+    mDelivCount = mDupCount = 0;
+    XMEMSET(mDelivered, 0, mMsgCount);
+
+    rc = MqttClient_Init(&mClient, &mNet, msg_cb, mTxBuf, BENCH_BUF_SIZE,
+        mRxBuf, BENCH_BUF_SIZE, 1000);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_NetConnect(&mClient, "gateway", 0, 1000, 0, NULL);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&connect, 0, sizeof(connect));
+        connect.client_id = BENCH_CLIENT_ID;
+        connect.protocol_level = SN_PROTOCOL_ID;
+        connect.keep_alive_sec = 60;
+        connect.clean_session = 1;
+        rc = SN_Client_Connect(&mClient, &connect);
+        if (rc == MQTT_CODE_SUCCESS &&
+                connect.ack.return_code != SN_RC_ACCEPTED) {
+            rc = MQTT_CODE_ERROR_NETWORK;
+        }
+    }
+    if (rc == MQTT_CODE_SUCCESS &&
+            SN_Client_GetState(&mClient) != SN_CLIENT_STATE_ACTIVE) {
+        PRINTF("Not active after connect");
+        rc = MQTT_CODE_ERROR_STAT;
+    }
+    /* Radio use of the connect is not counted */
+    XMEMSET(&mRadio, 0, sizeof(mRadio));
+    return rc;
+}
+
+static void client_stop(void)
+{
+    (void)SN_Client_Disconnect(&mClient);
+    (void)MqttClient_NetDisconnect(&mClient);
+    MqttClient_DeInit(&mClient);
+}
+
+static void report(const char* mode, int period, double hours, double on_sec,
+    word32 wakeups)
+{
+    PRINTF("%-6s %6d  %7.1f  %7.1f %8.1f %8.1f  %8.2f %7.3f%%  %7.1f %7.1f",
+        mode, period, wakeups / hours,
+        (mRadio.tx_packets + mRadio.rx_packets) / hours,
+        mRadio.tx_bytes / hours, mRadio.rx_bytes / hours,
+        on_sec / hours, on_sec * 100.0 / (hours * 3600.0),
+        mDelivCount > 0 ? mDelaySum / mDelivCount : 0.0, mDelayMax);
+}
+
+/* Stays connected, listening all the time and pinging every keep alive */
+static int run_awake(double hours, int keep_alive)
+{
+    int rc;
+    double end = hours * 3600.0, ping = keep_alive;
+
+    rc = client_start();
+    while (rc == MQTT_CODE_SUCCESS &&
+            (mNextMsg < mMsgCount || ping < end)) {
+        if (mNextMsg < mMsgCount && mArrival[mNextMsg] < ping) {
+            arrive_until(mArrival[mNextMsg]);
+            rc = SN_Client_WaitMessage(&mClient, 1000);
+        }
+        else if (ping < end) {
+            mNow = ping;
+            rc = SN_Client_Ping(&mClient, NULL);
+            ping += keep_alive;
+        }
+        else {
+            break;
+        }
+    }
+    if (rc == MQTT_CODE_SUCCESS && mDelivCount != mMsgCount) {
+        PRINTF("awake: %d of %d messages received", mDelivCount, mMsgCount);
+        rc = MQTT_CODE_ERROR_NOT_FOUND;
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        /* The receiver is on all the time to get messages right away */
+        report("awake", keep_alive, hours, end, 0);
+    }
+    client_stop();
+    return rc;
+}
+
+/* Sleeps for the duration between wake ups to receive the messages */
+static int run_sleep(double hours, int duration)
+{
+    int rc, pending;
+    double end = hours * 3600.0, wake;
+    word32 wakeups = 0;
+    SN_Disconnect disconnect;
+    SN_PingReq ping;
+
+    rc = client_start();
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&disconnect, 0, sizeof(disconnect));
+        disconnect.sleepTmr = (word16)duration;
+        rc = SN_Client_Disconnect_ex(&mClient, &disconnect);
+    }
+    XMEMSET(&ping, 0, sizeof(ping));
+    ping.clientId = (char*)BENCH_CLIENT_ID;
+
+    for (wake = duration; rc == MQTT_CODE_SUCCESS && wake <= end;
+            wake += duration) {
+        if (SN_Client_GetState(&mClient) != SN_CLIENT_STATE_ASLEEP) {
+            PRINTF("sleep %d: not asleep at %.0f s", duration, wake);
+            rc = MQTT_CODE_ERROR_STAT;
+            break;
+        }
+        arrive_until(wake);
+        /* Drains the buffered messages until the ping response */
+        rc = SN_Client_Ping(&mClient, &ping);
+        wakeups++;
+    }
+
+    pending = mGwPendCount + (mMsgCount - mNextMsg);
+    if (rc == MQTT_CODE_SUCCESS &&
+            (mDelivCount + pending != mMsgCount || mDupCount != 0 ||
+             SN_Client_GetState(&mClient) != SN_CLIENT_STATE_ASLEEP ||
+             mClient.sn_sleep_stats.wakeups != wakeups ||
+             mClient.sn_sleep_stats.buffered != (word32)mDelivCount ||
+             mClient.sn_sleep_stats.sleeps != 1 ||
+             mClient.sn_sleep_sec != (word16)duration)) {
+        PRINTF("sleep %d: %d of %d messages received, %d pending, "
+            "%d duplicates, state %d, stats %u wake ups %u buffered",
+            duration, mDelivCount, mMsgCount, pending, mDupCount,
+            SN_Client_GetState(&mClient), mClient.sn_sleep_stats.wakeups,
+            mClient.sn_sleep_stats.buffered);
+        rc = MQTT_CODE_ERROR_NOT_FOUND;
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        report("sleep", duration, hours, mRadio.on_sec, wakeups);
+    }
+    client_stop();
+    return rc;
+}
+
+/* A gateway that forgot the client answers the wake up with a disconnect,
+   and the client connects again */
+static int run_lost(void)
+{
+    int rc;
+    SN_Disconnect disconnect;
+    SN_PingReq ping;
+
+    rc = client_start();
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&disconnect, 0, sizeof(disconnect));
+        disconnect.sleepTmr = 60;
+        rc = SN_Client_Disconnect_ex(&mClient, &disconnect);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        mGwLost = 1;
+        XMEMSET(&ping, 0, sizeof(ping));
+        ping.clientId = (char*)BENCH_CLIENT_ID;
+        rc = SN_Client_Ping(&mClient, &ping);
+        if (rc == MQTT_CODE_ERROR_NETWORK &&
+                SN_Client_GetState(&mClient) ==
+                    SN_CLIENT_STATE_DISCONNECTED) {
+            rc = MQTT_CODE_SUCCESS;
+        }
+        else {
+            PRINTF("lost: ping rc %d, state %d", rc,
+                SN_Client_GetState(&mClient));
+            rc = MQTT_CODE_ERROR_STAT;
+        }
+    }
+    client_stop();
+    if (rc == MQTT_CODE_SUCCESS) {
+        /* Connects again */
+        rc = client_start();
+        client_stop();
+    }
+    PRINTF("Wake up with a gateway that forgot the client: %s",
+        rc == MQTT_CODE_SUCCESS ? "disconnected, connected again" :
+        "failed");
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("snsleepbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-m <num>    Messages per hour to the device, default 12");
+    PRINTF("-t <hours>  Simulated hours, default 24");
+    PRINTF("-q <num>    QoS 0 or 1 of the messages, default 1");
+    PRINTF("-k <sec>    Keep alive while awake, default 60");
+    PRINTF("-s <sec>    Only this sleep duration, default 60, 300 and 900");
+    PRINTF("-b <kbps>   Radio bit rate, default 250");
+    PRINTF("-d <ms>     Turnaround per packet received, default 10");
+}
+#endif /* WOLFMQTT_SN_SLEEP */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_SN_SLEEP
+    static const int durations[] = { 60, 300, 900 };
+    int i, rate = 12, hours = 24, qos = 1, keep_alive = 60, only = 0;
+    int kbps = 250, turn_ms = 10;
+    word32 seed = 1;
+    double interval;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-m", 3) == 0 && i + 1 < argc) {
+            rate = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-t", 3) == 0 && i + 1 < argc) {
+            hours = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-q", 3) == 0 && i + 1 < argc) {
+            qos = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-k", 3) == 0 && i + 1 < argc) {
+            keep_alive = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-s", 3) == 0 && i + 1 < argc) {
+            only = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-b", 3) == 0 && i + 1 < argc) {
+            kbps = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-d", 3) == 0 && i + 1 < argc) {
+            turn_ms = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (rate < 1 || rate > 3600 || hours < 1 || hours > 24 * 365 ||
+            (qos != 0 && qos != 1) || keep_alive < 1 || only < 0 ||
+            only > 65535 || kbps < 1 || turn_ms < 0) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    mQos = (MqttQoS)qos;
+    mBitrate = kbps * 1000.0;
+    mTurn = turn_ms / 1000.0;
+
+    /* Evenly spread arrivals with jitter */
+    mMsgCount = rate * hours;
+    mArrival = (double*)WOLFMQTT_MALLOC(sizeof(double) * mMsgCount);
+    mDelivered = (byte*)WOLFMQTT_MALLOC(mMsgCount);
+    /* Room for all messages, QoS 0 ones are drained at once */
+    mQueueSize = mMsgCount + 4;
+    mQueue = (Datagram*)WOLFMQTT_MALLOC(sizeof(Datagram) * mQueueSize);
+    if (mArrival == NULL || mDelivered == NULL || mQueue == NULL) {
+        rc = MQTT_CODE_ERROR_MEMORY;
+    }
+    else {
+        interval = 3600.0 / rate;
+        for (i = 0; i < mMsgCount; i++) {
+            mArrival[i] = (i + (bench_rand(&seed) % 1000) / 1000.0) *
+                interval;
+        }
+
+        mNet.connect = Net_Connect;
+        mNet.read = Net_Read;
+        mNet.peek = Net_Peek;
+        mNet.write = Net_Write;
+        mNet.disconnect = Net_Disconnect;
+
+        PRINTF("MQTT-SN sleeping client benchmark: %d QoS %d messages an "
+            "hour for %d hours, %d kbit/s, %d bytes framing, %d ms "
+            "turnaround", rate, qos, hours, kbps, BENCH_FRAME_BYTES, turn_ms);
+        PRINTF("mode   period   wake/h   pkts/h   tx B/h   rx B/h   "
+            "radio s     duty  delay s   max s");
+        rc = run_awake(hours, keep_alive);
+        if (only > 0) {
+            if (rc == 0) {
+                rc = run_sleep(hours, only);
+            }
+        }
+        for (i = 0; only == 0 && rc == 0 &&
+                i < (int)(sizeof(durations) / sizeof(durations[0])); i++) {
+            rc = run_sleep(hours, durations[i]);
+        }
+        if (rc == 0) {
+            rc = run_lost();
+        }
+    }
+    if (mArrival != NULL) {
+        WOLFMQTT_FREE(mArrival);
+    }
+    if (mDelivered != NULL) {
+        WOLFMQTT_FREE(mDelivered);
+    }
+    if (mQueue != NULL) {
+        WOLFMQTT_FREE(mQueue);
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires the MQTT-SN sleeping client to be enabled
+       ./configure --enable-sn --enable-snsleep */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
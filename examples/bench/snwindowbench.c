@@ -0,0 +1,576 @@
+/* snwindowbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* MQTT-SN publish window benchmark.
+ * An MQTT-SN client publishes with QoS 1 (or 2) to a minimal gateway thread
+ * over an in memory datagram link that delays each datagram by half the
+ * round trip time (200 ms by default). The publishes are sent with
+ * SN_Client_Publish, waiting for each acknowledgment, and with
+ * SN_Client_PublishAsync and windows of several sizes. The throughput and
+ * the latency from the send to the acknowledgment are reported. With
+ * WOLFMQTT_SN_RETRY a share of the datagrams may be dropped, and a
+ * retransmission timer sends the outstanding publishes again. Fails when a publish is not
+ * acknowledged or an acknowledged publish was not received by the
+ * gateway. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#if defined(WOLFMQTT_SN_WINDOW) && !defined(USE_WINDOWS_API)
+
+#include "wolfmqtt/mqtt_sn_client.h"
+
+#define BENCH_BUF_SIZE      256
+#define BENCH_LINK_SLOTS    512
+#define BENCH_TOPIC_ID      1
+#define BENCH_WINDOW_MAX    256
+
+/* One way of the link: datagrams in order, each delivered once due */
+typedef struct _Datagram {
+    double      due;
+    int         len;
+    byte        data[BENCH_BUF_SIZE];
+} Datagram;
+
+typedef struct _Link {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    Datagram    slots[BENCH_LINK_SLOTS];
+    int         head;
+    int         count;
+    word32      seed;
+    word32      dropped;
+} Link;
+
+static Link mToGw;
+static Link mToClient;
+static volatile int mStop;
+static double mDelay = 0.100;       /* one way, seconds */
+static int mLossPct;
+
+/* Publishes seen by the gateway, by sequence number in the payload */
+static byte* mReceived;
+static word32 mCount;
+static word32 mDuplicates;
+
+static MqttClient mClient;
+static MqttNet mNet;
+static byte mTxBuf[BENCH_BUF_SIZE];
+static byte mRxBuf[BENCH_BUF_SIZE];
+static SN_PubWindow mWindow;
+static SN_Publish* mSlots[BENCH_WINDOW_MAX];
+#ifdef WOLFMQTT_SN_RETRY
+static SN_Retry mRetry;
+#endif
+
+/* Publishes of a run and their completion */
+static SN_Publish* mPubs;
+static byte* mPayloads;
+static double* mSent;
+static double* mLat;
+static int mDone;
+static int mFailed;
+
+
+/* Simple deterministic generator, so runs drop the same datagrams */
+static word32 bench_rand(word32* state)
+{
+    *state = *state * 1103515245UL + 12345UL;
+    return (*state >> 8) & 0xFFFFFF;
+}
+
+static void link_init(Link* link, word32 seed)
+{
+    pthread_condattr_t attr;
+
+    XMEMSET(link, 0, sizeof(Link));
+    pthread_mutex_init(&link->lock, NULL);
+    /* bench_time_sec is CLOCK_MONOTONIC, so waits use it too */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&link->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    link->seed = seed;
+}
+
+static void link_free(Link* link)
+{
+    pthread_mutex_destroy(&link->lock);
+    pthread_cond_destroy(&link->cond);
+}
+
+static void link_send(Link* link, const byte* buf, int len)
+{
+    pthread_mutex_lock(&link->lock);
+    if ((int)(bench_rand(&link->seed) % 10000) < mLossPct * 100 ||
+            link->count == BENCH_LINK_SLOTS || len > BENCH_BUF_SIZE) {
+        link->dropped++;
+    }
+    else {
+        Datagram* d = &link->slots[(link->head + link->count) %
+            BENCH_LINK_SLOTS];
+        d->due = bench_time_sec() + mDelay;
+        d->len = len;
+        XMEMCPY(d->data, buf, len);
+        link->count++;
+        pthread_cond_signal(&link->cond);
+    }
+    pthread_mutex_unlock(&link->lock);
+}
+
+/* Returns the length of the next due datagram, or MQTT_CODE_ERROR_TIMEOUT */
+static int link_recv(Link* link, byte* buf, int buf_len, int timeout_ms,
+    int peek)
+{
+    double end = bench_time_sec() + timeout_ms / 1000.0, now;
+    int rc = MQTT_CODE_ERROR_TIMEOUT;
+
+    pthread_mutex_lock(&link->lock);
+    while ((now = bench_time_sec()) < end) {
+        double wait = end;
+        if (link->count > 0) {
+            Datagram* d = &link->slots[link->head];
+            if (d->due <= now) {
+                rc = (d->len < buf_len) ? d->len : buf_len;
+                XMEMCPY(buf, d->data, rc);
+                if (!peek) {
+                    link->head = (link->head + 1) % BENCH_LINK_SLOTS;
+                    link->count--;
+                }
+                break;
+            }
+            if (d->due < wait) {
+                wait = d->due;
+            }
+        }
+        {
+            struct timespec ts;
+            ts.tv_sec = (time_t)wait;
+            ts.tv_nsec = (long)((wait - (double)ts.tv_sec) * 1000000000.0);
+            (void)pthread_cond_timedwait(&link->cond, &link->lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&link->lock);
+    return rc;
+}
+
+
+/* Minimal gateway: accepts everything and acknowledges like a gateway */
+
+static void gw_reply(const byte* p, int len)
+{
+    byte ack[8];
+    int ack_len = 0;
+    word32 seq;
+
+    if (len < 2 || p[0] != len) {
+        return;
+    }
+    switch (p[1]) {
+        case SN_MSG_TYPE_CONNECT:
+            ack[0] = 3; ack[1] = SN_MSG_TYPE_CONNACK; ack[2] = SN_RC_ACCEPTED;
+            ack_len = 3;
+            break;
+        case SN_MSG_TYPE_PUBLISH:
+            if (len < 11) break;
+            /* Payload starts with the sequence number */
+            seq = ((word32)p[7] << 24) | ((word32)p[8] << 16) |
+                  ((word32)p[9] << 8) | p[10];
+            if (seq >= mCount) break;
+            if (mReceived[seq]) {
+                mDuplicates++;
+            }
+            mReceived[seq] = 1;
+            if ((p[2] & 0x60) == 0x20) {
+                ack[0] = 7; ack[1] = SN_MSG_TYPE_PUBACK;
+                ack[2] = p[3]; ack[3] = p[4];
+                ack[4] = p[5]; ack[5] = p[6];
+                ack[6] = SN_RC_ACCEPTED;
+                ack_len = 7;
+            }
+            else if ((p[2] & 0x60) == 0x40) {
+                ack[0] = 4; ack[1] = SN_MSG_TYPE_PUBREC;
+                ack[2] = p[5]; ack[3] = p[6];
+                ack_len = 4;
+            }
+            break;
+        case SN_MSG_TYPE_PUBREL:
+            if (len < 4) break;
+            ack[0] = 4; ack[1] = SN_MSG_TYPE_PUBCOMP;
+            ack[2] = p[2]; ack[3] = p[3];
+            ack_len = 4;
+            break;
+        case SN_MSG_TYPE_DISCONNECT:
+            ack[0] = 2; ack[1] = SN_MSG_TYPE_DISCONNECT;
+            ack_len = 2;
+            break;
+        default:
+            break;
+    }
+    if (ack_len > 0) {
+        link_send(&mToClient, ack, ack_len);
+    }
+}
+
+static BENCH_THREAD_RET gw_thread(void* arg)
+{
+    byte buf[BENCH_BUF_SIZE];
+    int len;
+    (void)arg;
+
+    while (!mStop) {
+        len = link_recv(&mToGw, buf, sizeof(buf), 20, 0);
+        if (len > 0) {
+            gw_reply(buf, len);
+        }
+    }
+    return BENCH_THREAD_RET_VAL;
+}
+
+
+/* MQTT-SN client network */
+
+static int Net_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    (void)context;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int Net_Read(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    (void)context;
+    return link_recv(&mToClient, buf, buf_len, timeout_ms, 0);
+}
+
+static int Net_Peek(void *context, byte* buf, int buf_len, int timeout_ms)
+{
+    (void)context;
+    return link_recv(&mToClient, buf, buf_len, timeout_ms, 1);
+}
+
+static int Net_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    (void)context;
+    (void)timeout_ms;
+    link_send(&mToGw, buf, buf_len);
+    return buf_len;
+}
+
+static int Net_Disconnect(void *context)
+{
+    (void)context;
+    return MQTT_CODE_SUCCESS;
+}
+
+#ifdef WOLFMQTT_SN_RETRY
+static word32 now_ms(void* ctx)
+{
+    (void)ctx;
+    return (word32)(bench_time_sec() * 1000.0);
+}
+#endif
+
+
+static void pub_done(MqttClient *client, SN_Publish *publish, int rc,
+    void *ctx)
+{
+    int seq = (int)(publish - mPubs);
+    (void)client;
+    (void)ctx;
+
+    if (rc == MQTT_CODE_SUCCESS && publish->return_code == SN_RC_ACCEPTED) {
+        mLat[mDone++] = (bench_time_sec() - mSent[seq]) * 1000.0;
+    }
+    else {
+        mFailed++;
+    }
+}
+
+static void pub_init(int seq, MqttQoS qos, int packet_id)
+{
+    SN_Publish* publish = &mPubs[seq];
+    byte* payload = &mPayloads[seq * 16];
+    static word16 topic_id = BENCH_TOPIC_ID;
+
+    XMEMSET(payload, 'p', 16);
+    payload[0] = (byte)(seq >> 24); payload[1] = (byte)(seq >> 16);
+    payload[2] = (byte)(seq >> 8); payload[3] = (byte)seq;
+
+    XMEMSET(publish, 0, sizeof(SN_Publish));
+    publish->qos = qos;
+    publish->topic_type = SN_TOPIC_ID_TYPE_PREDEF;
+    publish->topic_name = (const char*)&topic_id;
+    publish->packet_id = (word16)packet_id;
+    publish->buffer = payload;
+    publish->total_len = 16;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Publishes count messages, waiting for each when window is 0 */
+static int run_case(int window, int count, MqttQoS qos)
+{
+    int rc, i, lost = 0;
+    SN_Connect connect;
+    double start, elapsed, sum = 0;
+    BENCH_THREAD_T gw;
+    word32 resent = 0;
+
+    mStop = 0;
+    mDuplicates = 0;
+    mDone = 0;
+    mFailed = 0;
+    XMEMSET(mReceived, 0, count);
+    link_init(&mToGw, 1);
+    link_init(&mToClient, 2);
+
+    rc = MqttClient_Init(&mClient, &mNet, NULL, mTxBuf, BENCH_BUF_SIZE,
+        mRxBuf, BENCH_BUF_SIZE, 5000);
+    if (rc == MQTT_CODE_SUCCESS && window > 0) {
+        rc = SN_PubWindow_Init(&mWindow, mSlots, (word16)window, pub_done,
+            NULL);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = SN_Client_SetPubWindow(&mClient, &mWindow);
+        }
+    }
+#ifdef WOLFMQTT_SN_RETRY
+    /* Only with loss, the timeout of a link without jitter comes close to
+       the round trip time */
+    if (rc == MQTT_CODE_SUCCESS && mLossPct > 0) {
+        rc = SN_Retry_Init(&mRetry, now_ms, NULL, 0);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = SN_Client_SetRetry(&mClient, &mRetry);
+        }
+    }
+#endif
+    if (rc == MQTT_CODE_SUCCESS &&
+            BENCH_THREAD_CREATE(&gw, gw_thread, NULL) != 0) {
+        rc = MQTT_CODE_ERROR_SYSTEM;
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    rc = MqttClient_NetConnect(&mClient, "gateway", 0, 1000, 0, NULL);
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&connect, 0, sizeof(connect));
+        connect.client_id = "snwindow";
+        connect.protocol_level = SN_PROTOCOL_ID;
+        connect.keep_alive_sec = 60;
+        connect.clean_session = 1;
+        rc = SN_Client_Connect(&mClient, &connect);
+    }
+
+    start = bench_time_sec();
+    for (i = 0; rc == MQTT_CODE_SUCCESS && i < count; i++) {
+        if (window > 0) {
+            /* The window gives the packet ID. The call waits for room in
+               the window and returns once sent, time it from there. */
+            pub_init(i, qos, 0);
+            rc = SN_Client_PublishAsync(&mClient, &mPubs[i]);
+            mSent[i] = bench_time_sec();
+        }
+        else {
+            pub_init(i, qos, i % 65535 + 1);
+            mSent[i] = bench_time_sec();
+            rc = SN_Client_Publish(&mClient, &mPubs[i]);
+            if (rc == MQTT_CODE_SUCCESS) {
+                pub_done(&mClient, &mPubs[i], rc, NULL);
+            }
+        }
+    }
+    if (rc == MQTT_CODE_SUCCESS && window > 0) {
+        rc = SN_Client_PublishFlush(&mClient);
+    }
+    elapsed = bench_time_sec() - start;
+#ifdef WOLFMQTT_SN_RETRY
+    if (mLossPct > 0) {
+        resent = mRetry.stats.retransmits;
+    }
+#endif
+
+    for (i = 0; i < mDone; i++) {
+        sum += mLat[i];
+    }
+    for (i = 0; i < count; i++) {
+        if (!mReceived[i]) {
+            lost++;
+        }
+    }
+    if (rc == MQTT_CODE_SUCCESS && mDone > 0) {
+        qsort(mLat, (size_t)mDone, sizeof(double), cmp_double);
+        PRINTF("%-6s %4d  %8.1f  %8.1f %8.1f %8.1f  %5u %4u %4d %4d  %6.2fs",
+            window > 0 ? "async" : "sync", window, count / elapsed,
+            sum / mDone, mLat[mDone / 2], mLat[mDone * 99 / 100],
+            window > 0 ? mWindow.stats.max_count : 1, resent, mDuplicates,
+            mFailed, elapsed);
+        /* With retransmissions, a publish given up may still arrive */
+        if (lost > mFailed) {
+            PRINTF("Publishes not received: %d", lost);
+            rc = MQTT_CODE_ERROR_TIMEOUT;
+        }
+    }
+    else {
+        PRINTF("%-6s %4d  failed %d (%s), %d completed",
+            window > 0 ? "async" : "sync", window, rc,
+            MqttClient_ReturnCodeToString(rc), mDone);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = MQTT_CODE_ERROR_TIMEOUT;
+        }
+    }
+
+    mStop = 1;
+    BENCH_THREAD_JOIN(gw);
+    MqttClient_DeInit(&mClient);
+    if (window > 0) {
+        SN_PubWindow_Free(&mWindow);
+    }
+#ifdef WOLFMQTT_SN_RETRY
+    if (mLossPct > 0) {
+        SN_Retry_Free(&mRetry);
+    }
+#endif
+    link_free(&mToGw);
+    link_free(&mToClient);
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("snwindowbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Publishes per case, default 100");
+    PRINTF("-d <ms>     Round trip time, default 200");
+    PRINTF("-q <num>    QoS 1 or 2, default 1");
+    PRINTF("-w <num>    Only this window (0 waits for each), default 0, 1, "
+        "4, 16 and 64");
+#ifdef WOLFMQTT_SN_RETRY
+    PRINTF("-l <pct>    Datagrams dropped, default 0");
+#endif
+}
+#endif /* WOLFMQTT_SN_WINDOW && !USE_WINDOWS_API */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#if defined(WOLFMQTT_SN_WINDOW) && !defined(USE_WINDOWS_API)
+    static const int windows[] = { 0, 1, 4, 16, 64 };
+    int i, count = 100, qos = 1, only = -1, rtt = 200;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-d", 3) == 0 && i + 1 < argc) {
+            rtt = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-q", 3) == 0 && i + 1 < argc) {
+            qos = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-w", 3) == 0 && i + 1 < argc) {
+            only = XATOI(argv[++i]);
+        }
+    #ifdef WOLFMQTT_SN_RETRY
+        else if (XSTRNCMP(argv[i], "-l", 3) == 0 && i + 1 < argc) {
+            mLossPct = XATOI(argv[++i]);
+        }
+    #endif
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1 || count > 1000000 || rtt < 0 || (qos != 1 && qos != 2) ||
+            only > BENCH_WINDOW_MAX || mLossPct < 0 || mLossPct > 50) {
+        usage();
+        return EXIT_FAILURE;
+    }
+    mDelay = rtt / 2000.0;
+    mCount = (word32)count;
+
+    mPubs = (SN_Publish*)WOLFMQTT_MALLOC(sizeof(SN_Publish) * count);
+    mPayloads = (byte*)WOLFMQTT_MALLOC(16 * count);
+    mSent = (double*)WOLFMQTT_MALLOC(sizeof(double) * count);
+    mLat = (double*)WOLFMQTT_MALLOC(sizeof(double) * count);
+    mReceived = (byte*)WOLFMQTT_MALLOC(count);
+    if (mPubs == NULL || mPayloads == NULL || mSent == NULL || mLat == NULL ||
+            mReceived == NULL) {
+        rc = MQTT_CODE_ERROR_MEMORY;
+    }
+    if (rc == 0) {
+        mNet.connect = Net_Connect;
+        mNet.read = Net_Read;
+        mNet.peek = Net_Peek;
+        mNet.write = Net_Write;
+        mNet.disconnect = Net_Disconnect;
+
+        PRINTF("MQTT-SN publish window benchmark: %d QoS %d publishes, "
+            "%d ms round trip, %d%% loss", count, qos, rtt, mLossPct);
+        PRINTF("mode   wind     msg/s  latency ms: mean      p50      p99  "
+            "inflt resent dups fail  time");
+        if (only >= 0) {
+            rc = run_case(only, count, (MqttQoS)qos);
+        }
+        for (i = 0; only < 0 && rc == 0 &&
+                i < (int)(sizeof(windows) / sizeof(windows[0])); i++) {
+            rc = run_case(windows[i], count, (MqttQoS)qos);
+        }
+    }
+    if (mPubs != NULL) {
+        WOLFMQTT_FREE(mPubs);
+    }
+    if (mPayloads != NULL) {
+        WOLFMQTT_FREE(mPayloads);
+    }
+    if (mSent != NULL) {
+        WOLFMQTT_FREE(mSent);
+    }
+    if (mLat != NULL) {
+        WOLFMQTT_FREE(mLat);
+    }
+    if (mReceived != NULL) {
+        WOLFMQTT_FREE(mReceived);
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires the MQTT-SN publish window to be enabled
+       ./configure --enable-sn --enable-snwindow */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
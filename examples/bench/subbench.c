@@ -0,0 +1,278 @@
+/* subbench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Subscribe startup benchmark.
+ * Connects to a broker and times subscribing to a large number of topics:
+ * with MqttClient_Subscribe, MAX_MQTT_TOPICS topics per call, waiting for
+ * each ack, and with MqttClient_SubscribeBulk, which fills each packet and
+ * keeps a window of packets in flight. Each run uses a new clean session. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "examples/mqttnet.h"
+#include "benchcommon.h"
+
+#define BENCH_BUF_SIZE      4096
+#define BENCH_TOPIC_LEN     32
+#define BENCH_MAX_WINDOW    64
+
+typedef struct _SubBenchCtx {
+    MQTTCtx         mqttCtx;
+    byte            tx_buf[BENCH_BUF_SIZE];
+    byte            rx_buf[BENCH_BUF_SIZE];
+} SubBenchCtx;
+
+static SubBenchCtx mCtx;
+static MqttTopic* mTopics;
+static char* mTopicNames;
+static MqttBulkPacket mPackets[BENCH_MAX_WINDOW];
+
+static int msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    (void)client;
+    (void)msg;
+    (void)msg_new;
+    (void)msg_done;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int bench_connect(SubBenchCtx* ctx)
+{
+    int rc;
+    MQTTCtx* mqttCtx = &ctx->mqttCtx;
+
+    rc = MqttClientNet_Init(&mqttCtx->net, mqttCtx);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_Init(&mqttCtx->client, &mqttCtx->net, msg_cb,
+            ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE,
+            mqttCtx->cmd_timeout_ms);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        mqttCtx->client.ctx = mqttCtx;
+        do {
+            rc = MqttClient_NetConnect(&mqttCtx->client, mqttCtx->host,
+                mqttCtx->port, DEFAULT_CON_TIMEOUT_MS, mqttCtx->use_tls,
+                mqtt_tls_cb);
+        } while (rc == MQTT_CODE_CONTINUE);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&mqttCtx->connect, 0, sizeof(MqttConnect));
+        mqttCtx->connect.keep_alive_sec = mqttCtx->keep_alive_sec;
+        mqttCtx->connect.clean_session = 1;
+        mqttCtx->connect.client_id = mqttCtx->client_id;
+        do {
+            rc = MqttClient_Connect(&mqttCtx->client, &mqttCtx->connect);
+        } while (rc == MQTT_CODE_CONTINUE);
+        if (rc == MQTT_CODE_SUCCESS &&
+                mqttCtx->connect.ack.return_code != MQTT_CONNECT_ACK_CODE_ACCEPTED) {
+            rc = MQTT_CODE_ERROR_NETWORK;
+        }
+    }
+#ifdef WOLFMQTT_V5
+    if (rc == MQTT_CODE_SUCCESS) {
+        /* Use the broker's maximum packet size */
+        MqttProp prop;
+        if (MqttClient_PropsViewFind(&mqttCtx->connect.ack.props_view,
+                MQTT_PROP_MAX_PACKET_SZ, &prop) > 0) {
+            mqttCtx->client.packet_sz_max = prop.data_int;
+        }
+    }
+#endif
+    return rc;
+}
+
+static void bench_disconnect(SubBenchCtx* ctx)
+{
+    MQTTCtx* mqttCtx = &ctx->mqttCtx;
+
+    (void)MqttClient_Disconnect(&mqttCtx->client);
+    (void)MqttClient_NetDisconnect(&mqttCtx->client);
+    MqttClient_DeInit(&mqttCtx->client);
+    MqttClientNet_DeInit(&mqttCtx->net);
+}
+
+static int check_codes(int count)
+{
+    int i, fail = 0;
+
+    for (i = 0; i < count; i++) {
+        if (mTopics[i].return_code >= MQTT_SUBSCRIBE_ACK_CODE_FAILURE) {
+            fail++;
+        }
+    }
+    return fail;
+}
+
+/* One topic list per MqttClient_Subscribe, each waiting for its ack */
+static int run_serial(SubBenchCtx* ctx, int count)
+{
+    int rc, i;
+    double start, elapsed;
+    MqttSubscribe subscribe;
+
+    rc = bench_connect(ctx);
+    start = bench_time_sec();
+    for (i = 0; i < count && rc == MQTT_CODE_SUCCESS; i += MAX_MQTT_TOPICS) {
+        XMEMSET(&subscribe, 0, sizeof(subscribe));
+        subscribe.packet_id = mqtt_get_packetid();
+        subscribe.topics = &mTopics[i];
+        subscribe.topic_count = (count - i < MAX_MQTT_TOPICS) ?
+            count - i : MAX_MQTT_TOPICS;
+        do {
+            rc = MqttClient_Subscribe(&ctx->mqttCtx.client, &subscribe);
+        } while (rc == MQTT_CODE_CONTINUE);
+    }
+    elapsed = bench_time_sec() - start;
+    bench_disconnect(ctx);
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        PRINTF("Subscribe      %2d topics/call : %8.1f ms, %d packets, "
+            "%d failed", MAX_MQTT_TOPICS, elapsed * 1e3,
+            (count + MAX_MQTT_TOPICS - 1) / MAX_MQTT_TOPICS,
+            check_codes(count));
+    }
+    else {
+        PRINTF("Subscribe: failed %d (%s)", rc,
+            MqttClient_ReturnCodeToString(rc));
+    }
+    return rc;
+}
+
+/* All topics with MqttClient_SubscribeBulk */
+static int run_bulk(SubBenchCtx* ctx, int count, int window)
+{
+    int rc;
+    double start, elapsed;
+    MqttSubscribeBulk bulk;
+
+    rc = bench_connect(ctx);
+    start = bench_time_sec();
+    if (rc == MQTT_CODE_SUCCESS) {
+        XMEMSET(&bulk, 0, sizeof(bulk));
+        bulk.topics = mTopics;
+        bulk.topic_count = count;
+        bulk.packets = mPackets;
+        bulk.packet_max = window;
+        bulk.packet_id = mqtt_get_packetid();
+        do {
+            rc = MqttClient_SubscribeBulk(&ctx->mqttCtx.client, &bulk);
+        } while (rc == MQTT_CODE_CONTINUE);
+    }
+    elapsed = bench_time_sec() - start;
+    bench_disconnect(ctx);
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        PRINTF("SubscribeBulk  window %2d      : %8.1f ms, %d packets, "
+            "%d failed", window, elapsed * 1e3, bulk.packet_count,
+            bulk.fail_count);
+    }
+    else {
+        PRINTF("SubscribeBulk: failed %d (%s)", rc,
+            MqttClient_ReturnCodeToString(rc));
+    }
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("subbench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-h <host>   Host to connect to, default: %s", DEFAULT_MQTT_HOST);
+    PRINTF("-p <num>    Port to connect on, default: %d", MQTT_DEFAULT_PORT);
+    PRINTF("-n <num>    Number of topics, default 5000");
+    PRINTF("-w <num>    Packets in flight for bulk subscribe, default 16 "
+        "(max %d)", BENCH_MAX_WINDOW);
+}
+
+int main(int argc, char** argv)
+{
+    int rc, i, count = 5000, window = 16;
+    SubBenchCtx* ctx = &mCtx;
+    MQTTCtx* mqttCtx = &ctx->mqttCtx;
+
+    mqtt_init_ctx(mqttCtx);
+    mqttCtx->app_name = "subbench";
+    mqttCtx->client_id = "WolfMQTTSubBench";
+    mqttCtx->port = MQTT_DEFAULT_PORT;
+    mqttCtx->debug_on = 0;
+    mqttCtx->test_mode = 1; /* do not wake on stdin */
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-h", 3) == 0 && i + 1 < argc) {
+            mqttCtx->host = argv[++i];
+        }
+        else if (XSTRNCMP(argv[i], "-p", 3) == 0 && i + 1 < argc) {
+            mqttCtx->port = (word16)XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-w", 3) == 0 && i + 1 < argc) {
+            window = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1 || window < 1 || window > BENCH_MAX_WINDOW) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    mTopics = (MqttTopic*)WOLFMQTT_MALLOC(sizeof(MqttTopic) * count);
+    mTopicNames = (char*)WOLFMQTT_MALLOC(BENCH_TOPIC_LEN * count);
+    if (mTopics == NULL || mTopicNames == NULL) {
+        rc = MQTT_CODE_ERROR_MEMORY;
+        goto exit;
+    }
+    XMEMSET(mTopics, 0, sizeof(MqttTopic) * count);
+    for (i = 0; i < count; i++) {
+        XSNPRINTF(&mTopicNames[i * BENCH_TOPIC_LEN], BENCH_TOPIC_LEN,
+            "wolfMQTT/bench/sub/%d", i);
+        mTopics[i].topic_filter = &mTopicNames[i * BENCH_TOPIC_LEN];
+        mTopics[i].qos = MQTT_QOS_1;
+    }
+
+    PRINTF("Subscribe startup benchmark: %d topics, %s:%d", count,
+        mqttCtx->host, mqttCtx->port);
+
+    rc = run_serial(ctx, count);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = run_bulk(ctx, count, 1);
+    }
+    if (rc == MQTT_CODE_SUCCESS && window > 1) {
+        rc = run_bulk(ctx, count, window);
+    }
+
+exit:
+    if (mTopics != NULL) {
+        WOLFMQTT_FREE(mTopics);
+    }
+    if (mTopicNames != NULL) {
+        WOLFMQTT_FREE(mTopicNames);
+    }
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
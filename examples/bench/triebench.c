@@ -0,0 +1,642 @@
+/* triebench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Subscription trie benchmark.
+ * Registers a number of topic filters (exact, '+' and '#') and times
+ * finding the handlers for received topics with a loop over the filter list,
+ * as done in a message callback, and with MqttSubTrie_Match. Every topic is
+ * checked to get the same handlers both ways. Then times receiving publish
+ * messages through the client with each and, with MQTT v5, with each filter
+ * subscribed with a subscription identifier that the publish messages carry,
+ * so handlers are found without matching the topic. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_SUBTRIE
+
+#define BENCH_FILTER_LEN    48
+#define BENCH_TOPICS        256
+#define BENCH_BUF_SIZE      1024
+#define BENCH_RX_SIZE       (BENCH_TOPICS * 64)
+
+typedef struct _BenchFilter {
+    char        filter[BENCH_FILTER_LEN];
+    MqttTopicCb cb;
+    void       *ctx;
+#ifdef WOLFMQTT_V5
+    word32      sub_id;
+#endif
+} BenchFilter;
+
+static BenchFilter* mFilters;
+static int mFilterCount;
+static MqttSubTrie mTrie;
+static char mTopics[BENCH_TOPICS][BENCH_FILTER_LEN];
+static word32 mHandled;
+
+static int topic_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done, void *ctx)
+{
+    (void)client;
+    (void)msg;
+    (void)msg_new;
+    (void)msg_done;
+    (void)ctx;
+    mHandled++;
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Topic filter match, as written in applications */
+static int filter_match(const char* filter, const char* topic, int len)
+{
+    const char* end = topic + len;
+
+    if (*topic == '$' && (*filter == '+' || *filter == '#')) {
+        return 0;
+    }
+    while (*filter != '\0') {
+        if (*filter == '#') {
+            return 1;
+        }
+        if (*filter == '+') {
+            while (topic < end && *topic != '/') {
+                topic++;
+            }
+            filter++;
+        }
+        else {
+            while (*filter != '\0' && *filter != '/') {
+                if (topic >= end || *topic != *filter) {
+                    return 0;
+                }
+                topic++;
+                filter++;
+            }
+            if (topic < end && *topic != '/') {
+                return 0;
+            }
+        }
+        if (*filter == '/') {
+            if (topic >= end) {
+                /* "a/#" also matches "a" */
+                return (XSTRNCMP(filter, "/#", 3) == 0);
+            }
+            filter++;
+            topic++;
+        }
+        else {
+            return (topic >= end);
+        }
+    }
+    return (topic >= end);
+}
+
+/* Loop over all filters, calling the handler of each match */
+static int list_match(const char* topic, int len, MqttClient* client,
+    MqttMessage* msg)
+{
+    int i, count = 0;
+
+    for (i = 0; i < mFilterCount; i++) {
+        if (filter_match(mFilters[i].filter, topic, len)) {
+            mFilters[i].cb(client, msg, 1, 1, mFilters[i].ctx);
+            count++;
+        }
+    }
+    return count;
+}
+
+static int trie_match(const char* topic, int len, MqttClient* client,
+    MqttMessage* msg)
+{
+    MqttSubMatch matches[MQTT_SUBTRIE_MAX_MATCH];
+    int i, count;
+
+    count = MqttSubTrie_Match(&mTrie, topic, (word16)len, matches,
+        MQTT_SUBTRIE_MAX_MATCH);
+    for (i = 0; i < count; i++) {
+        matches[i].cb(client, msg, 1, 1, matches[i].ctx);
+    }
+    return count;
+}
+
+/* Filters for sites, each with exact, '+' and '#' filters */
+static int build_filters(int count)
+{
+    int i, rc = MQTT_CODE_SUCCESS;
+
+    mFilters = (BenchFilter*)WOLFMQTT_MALLOC(sizeof(BenchFilter) * count);
+    if (mFilters == NULL) {
+        return MQTT_CODE_ERROR_MEMORY;
+    }
+    rc = MqttSubTrie_Init(&mTrie);
+    for (i = 0; i < count && rc == MQTT_CODE_SUCCESS; i++) {
+        int site = i / 10, kind = i % 10;
+        if (kind < 7) {
+            XSNPRINTF(mFilters[i].filter, BENCH_FILTER_LEN,
+                "fleet/site%d/dev%d/temp", site, kind);
+        }
+        else if (kind < 9) {
+            XSNPRINTF(mFilters[i].filter, BENCH_FILTER_LEN,
+                "fleet/site%d/+/status%d", site, kind);
+        }
+        else {
+            XSNPRINTF(mFilters[i].filter, BENCH_FILTER_LEN,
+                "fleet/site%d/alarm/#", site);
+        }
+        mFilters[i].cb = topic_cb;
+        mFilters[i].ctx = &mFilters[i];
+        rc = MqttSubTrie_Add(&mTrie, mFilters[i].filter, mFilters[i].cb,
+            mFilters[i].ctx);
+    }
+    mFilterCount = i;
+    return rc;
+}
+
+/* Received topics spread over the sites, some without a match */
+static void build_topics(void)
+{
+    int i, sites = (mFilterCount + 9) / 10;
+
+    for (i = 0; i < BENCH_TOPICS; i++) {
+        int site = (int)(((word32)i * 2654435761UL) % (word32)sites);
+        switch (i % 4) {
+            case 0:
+                XSNPRINTF(mTopics[i], BENCH_FILTER_LEN,
+                    "fleet/site%d/dev%d/temp", site, i % 7);
+                break;
+            case 1:
+                XSNPRINTF(mTopics[i], BENCH_FILTER_LEN,
+                    "fleet/site%d/dev%d/status8", site, i % 7);
+                break;
+            case 2:
+                XSNPRINTF(mTopics[i], BENCH_FILTER_LEN,
+                    "fleet/site%d/alarm/dev%d/high", site, i % 7);
+                break;
+            default:
+                XSNPRINTF(mTopics[i], BENCH_FILTER_LEN,
+                    "fleet/site%d/dev%d/humidity", site, i % 7);
+                break;
+        }
+    }
+}
+
+static int check_topics(void)
+{
+    int i, a, b;
+
+    for (i = 0; i < BENCH_TOPICS; i++) {
+        int len = (int)XSTRLEN(mTopics[i]);
+        a = list_match(mTopics[i], len, NULL, NULL);
+        b = trie_match(mTopics[i], len, NULL, NULL);
+        if (a != b) {
+            PRINTF("Mismatch for %s: list %d, trie %d", mTopics[i], a, b);
+            return MQTT_CODE_ERROR_NOT_FOUND;
+        }
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static void run_match(const char* desc,
+    int (*match)(const char*, int, MqttClient*, MqttMessage*), int count)
+{
+    int i, lens[BENCH_TOPICS];
+    double start, elapsed;
+
+    for (i = 0; i < BENCH_TOPICS; i++) {
+        lens[i] = (int)XSTRLEN(mTopics[i]);
+    }
+    mHandled = 0;
+    start = bench_time_sec();
+    for (i = 0; i < count; i++) {
+        match(mTopics[i % BENCH_TOPICS], lens[i % BENCH_TOPICS], NULL, NULL);
+    }
+    elapsed = bench_time_sec() - start;
+    PRINTF("%-22s: %10.1f ns/topic %12.0f topics/sec (%u handlers)", desc,
+        elapsed * 1e9 / count, (double)count / elapsed, mHandled);
+}
+
+/* Receive path: publish messages replayed through the client */
+#define BENCH_RECV_LIST     0   /* message callback loops over filters */
+#define BENCH_RECV_TRIE     1   /* trie matches the topic */
+#define BENCH_RECV_SUB_ID   2   /* handlers indexed by subscription id */
+
+typedef struct _TrieBenchCtx {
+    MqttClient      client;
+    MqttNet         net;
+    BenchNet        bnet;
+    byte            tx_buf[BENCH_BUF_SIZE];
+    byte            rx_buf[BENCH_BUF_SIZE];
+    word32          recvd;
+} TrieBenchCtx;
+
+static TrieBenchCtx mCtx;
+static TrieBenchCtx mBuildCtx;
+static byte mRxPackets[BENCH_RX_SIZE];
+static int mRxPacketsLen;
+
+static int list_msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    TrieBenchCtx* ctx = (TrieBenchCtx*)client->ctx;
+    if (msg_new) {
+        list_match(msg->topic_name, msg->topic_name_len, client, msg);
+    }
+    if (msg_done) {
+        ctx->recvd++;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int trie_msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    /* Called for messages without a matching filter */
+    TrieBenchCtx* ctx = (TrieBenchCtx*)client->ctx;
+    (void)msg;
+    (void)msg_new;
+    if (msg_done) {
+        ctx->recvd++;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int trie_topic_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done, void *ctx)
+{
+    TrieBenchCtx* bctx = (TrieBenchCtx*)client->ctx;
+    (void)msg;
+    (void)msg_new;
+    (void)ctx;
+    mHandled++;
+    if (msg_done) {
+        bctx->recvd++;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+#ifdef WOLFMQTT_V5
+/* Subscribe ack for packet ID 1, granting QoS 0 to one topic */
+static const byte mSubAck[] = { 0x90, 0x04, 0x00, 0x01, 0x00, 0x00 };
+
+static int decode_vbi(const byte* buf, int len, word32* val)
+{
+    int i = 0;
+    word32 mult = 1;
+
+    *val = 0;
+    do {
+        if (i >= len || i >= 4) {
+            return MQTT_CODE_ERROR_MALFORMED_DATA;
+        }
+        *val += (buf[i] & 0x7F) * mult;
+        mult <<= 7;
+    } while (buf[i++] & 0x80);
+    return i;
+}
+
+/* Subscribes each filter, with its own handler, through the client and
+ * reads the subscription identifier assigned from the packet sent */
+static int subscribe_filters(TrieBenchCtx* ctx)
+{
+    int rc = MQTT_CODE_SUCCESS, i, pos, len;
+    MqttSubscribe subscribe;
+    MqttTopic topic;
+    word32 val;
+    byte cap[BENCH_BUF_SIZE];
+
+    ctx->bnet.rx = mSubAck;
+    ctx->bnet.rx_len = (int)sizeof(mSubAck);
+    ctx->bnet.cap = cap;
+    ctx->bnet.cap_size = (int)sizeof(cap);
+    for (i = 0; i < mFilterCount && rc == MQTT_CODE_SUCCESS; i++) {
+        XMEMSET(&subscribe, 0, sizeof(subscribe));
+        XMEMSET(&topic, 0, sizeof(topic));
+        topic.topic_filter = mFilters[i].filter;
+        topic.qos = MQTT_QOS_0;
+        topic.cb = mFilters[i].cb;
+        topic.cb_ctx = mFilters[i].ctx;
+        subscribe.packet_id = 1;
+        subscribe.topic_count = 1;
+        subscribe.topics = &topic;
+        ctx->bnet.cap_len = 0;
+        rc = MqttClient_Subscribe(&ctx->client, &subscribe);
+        if (rc != MQTT_CODE_SUCCESS) {
+            break;
+        }
+
+        /* Fixed header, packet ID, property length, then the identifier */
+        pos = 1;
+        len = decode_vbi(&cap[pos], ctx->bnet.cap_len - pos, &val);
+        if (len > 0) {
+            pos += len + MQTT_DATA_LEN_SIZE;
+            len = decode_vbi(&cap[pos], ctx->bnet.cap_len - pos, &val);
+        }
+        if (len > 0) {
+            pos += len;
+            len = (pos < ctx->bnet.cap_len &&
+                   cap[pos] == MQTT_PROP_SUBSCRIPTION_ID) ?
+                decode_vbi(&cap[pos + 1], ctx->bnet.cap_len - pos - 1,
+                    &mFilters[i].sub_id) : -1;
+        }
+        if (len <= 0) {
+            PRINTF("No subscription identifier sent for %s",
+                mFilters[i].filter);
+            rc = MQTT_CODE_ERROR_NOT_FOUND;
+        }
+    }
+    ctx->bnet.rx = NULL;
+    ctx->bnet.cap = NULL;
+    return rc;
+}
+#endif
+
+/* Captures publish messages for the topics. With with_ids set each carries
+ * the subscription identifiers of the matching filters, as a broker sends
+ * them. */
+static int build_rx_packets(int with_ids)
+{
+    int rc, i;
+    TrieBenchCtx* ctx = &mBuildCtx;
+    MqttPublish publish;
+    static const byte payload[16] = { 0 };
+#ifdef WOLFMQTT_V5
+    MqttSubMatch matches[MQTT_SUBTRIE_MAX_MATCH];
+    MqttProp props[MQTT_SUBTRIE_MAX_MATCH];
+    int j, count;
+#endif
+
+    XMEMSET(ctx, 0, sizeof(TrieBenchCtx));
+    ctx->bnet.cap = mRxPackets;
+    ctx->bnet.cap_size = (int)sizeof(mRxPackets);
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, NULL,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    for (i = 0; i < BENCH_TOPICS && rc == MQTT_CODE_SUCCESS; i++) {
+        XMEMSET(&publish, 0, sizeof(publish));
+        publish.qos = MQTT_QOS_0;
+        publish.topic_name = mTopics[i];
+        publish.buffer = (byte*)payload;
+        publish.total_len = (word32)sizeof(payload);
+    #ifdef WOLFMQTT_V5
+        if (with_ids) {
+            count = MqttSubTrie_Match(&mTrie, mTopics[i],
+                (word16)XSTRLEN(mTopics[i]), matches, MQTT_SUBTRIE_MAX_MATCH);
+            XMEMSET(props, 0, sizeof(props));
+            for (j = 0; j < count; j++) {
+                props[j].type = MQTT_PROP_SUBSCRIPTION_ID;
+                props[j].data_int = ((BenchFilter*)matches[j].ctx)->sub_id;
+                props[j].next = (j + 1 < count) ? &props[j + 1] : NULL;
+            }
+            publish.props = (count > 0) ? props : NULL;
+        }
+    #else
+        (void)with_ids;
+    #endif
+        rc = MqttClient_Publish(&ctx->client, &publish);
+    }
+    mRxPacketsLen = ctx->bnet.cap_len;
+    MqttClient_DeInit(&ctx->client);
+    return rc;
+}
+
+static int run_recv(const char* desc, int mode, int count)
+{
+    int rc;
+    double start, elapsed;
+    TrieBenchCtx* ctx = &mCtx;
+    int i;
+
+    XMEMSET(ctx, 0, sizeof(TrieBenchCtx));
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet,
+        (mode == BENCH_RECV_LIST) ? list_msg_cb : trie_msg_cb,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc == MQTT_CODE_SUCCESS && mode != BENCH_RECV_LIST) {
+        /* The handlers count received messages */
+        for (i = 0; i < mFilterCount; i++) {
+            mFilters[i].cb = trie_topic_cb;
+        }
+        MqttSubTrie_Free(&mTrie);
+        rc = MqttSubTrie_Init(&mTrie);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = MqttClient_SetSubTrie(&ctx->client, &mTrie);
+        }
+    }
+    ctx->client.ctx = ctx;
+    if (rc == MQTT_CODE_SUCCESS && mode == BENCH_RECV_TRIE) {
+        for (i = 0; i < mFilterCount && rc == MQTT_CODE_SUCCESS; i++) {
+            rc = MqttSubTrie_Add(&mTrie, mFilters[i].filter,
+                mFilters[i].cb, mFilters[i].ctx);
+        }
+    }
+#ifdef WOLFMQTT_V5
+    if (rc == MQTT_CODE_SUCCESS && mode == BENCH_RECV_SUB_ID) {
+        rc = MqttSubTrie_SetSubIds(&mTrie, 1);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = subscribe_filters(ctx);
+        }
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = build_rx_packets(1);
+        }
+    }
+#endif
+    if (rc != MQTT_CODE_SUCCESS) {
+        MqttClient_DeInit(&ctx->client);
+        return rc;
+    }
+    ctx->bnet.rx = mRxPackets;
+    ctx->bnet.rx_len = mRxPacketsLen;
+    ctx->bnet.rx_pos = 0;
+
+    mHandled = 0;
+    start = bench_time_sec();
+    while (ctx->recvd < (word32)count && rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_WaitMessage(&ctx->client, 1000);
+    }
+    elapsed = bench_time_sec() - start;
+    MqttClient_DeInit(&ctx->client);
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        PRINTF("%-22s: %10.0f msg/sec (%.3f sec, %u handlers)", desc,
+            (double)ctx->recvd / elapsed, elapsed, mHandled);
+    }
+    else {
+        PRINTF("%-22s: failed %d (%s)", desc, rc,
+            MqttClient_ReturnCodeToString(rc));
+    }
+    return rc;
+}
+
+/* Subscribes one filter with a handler, answered with the SUBACK code */
+static int subscribe_one(TrieBenchCtx* ctx, const char* filter, byte code)
+{
+    int rc;
+    MqttSubscribe subscribe;
+    MqttTopic topic;
+#ifdef WOLFMQTT_V5
+    byte ack[] = { 0x90, 0x04, 0x00, 0x01, 0x00, 0x00 };
+#else
+    byte ack[] = { 0x90, 0x03, 0x00, 0x01, 0x00 };
+#endif
+
+    ack[sizeof(ack) - 1] = code;
+    ctx->bnet.rx = ack;
+    ctx->bnet.rx_len = (int)sizeof(ack);
+    ctx->bnet.rx_pos = 0;
+    XMEMSET(&subscribe, 0, sizeof(subscribe));
+    XMEMSET(&topic, 0, sizeof(topic));
+    topic.topic_filter = filter;
+    topic.qos = MQTT_QOS_0;
+    topic.cb = topic_cb;
+    subscribe.packet_id = 1;
+    subscribe.topic_count = 1;
+    subscribe.topics = &topic;
+    rc = MqttClient_Subscribe(&ctx->client, &subscribe);
+    ctx->bnet.rx = NULL;
+    if (rc == MQTT_CODE_SUCCESS && topic.return_code != code) {
+        rc = MQTT_CODE_ERROR_MALFORMED_DATA;
+    }
+    return rc;
+}
+
+/* A rejected re-subscribe keeps the existing handler, a rejected new filter
+ * is removed */
+static int check_resubscribe(void)
+{
+    int rc;
+    TrieBenchCtx* ctx = &mCtx;
+
+    XMEMSET(ctx, 0, sizeof(TrieBenchCtx));
+    MqttSubTrie_Free(&mTrie);
+    rc = MqttSubTrie_Init(&mTrie);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, NULL,
+            ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    rc = MqttClient_SetSubTrie(&ctx->client, &mTrie);
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = subscribe_one(ctx, "check/+",
+            MQTT_SUBSCRIBE_ACK_CODE_SUCCESS_MAX_QOS0);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = subscribe_one(ctx, "check/+", MQTT_SUBSCRIBE_ACK_CODE_FAILURE);
+        if (rc == MQTT_CODE_SUCCESS && mTrie.filter_count != 1) {
+            PRINTF("Rejected re-subscribe removed the handler");
+            rc = MQTT_CODE_ERROR_NOT_FOUND;
+        }
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = subscribe_one(ctx, "check/new/#",
+            MQTT_SUBSCRIBE_ACK_CODE_FAILURE);
+        if (rc == MQTT_CODE_SUCCESS && mTrie.filter_count != 1) {
+            PRINTF("Rejected filter handler not removed");
+            rc = MQTT_CODE_ERROR_NOT_FOUND;
+        }
+    }
+    MqttClient_DeInit(&ctx->client);
+
+    PRINTF("%-22s: %s", "Re-subscribe handlers",
+        (rc == MQTT_CODE_SUCCESS) ? "ok" : "failed");
+    return rc;
+}
+
+static void usage(void)
+{
+    PRINTF("triebench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-f <num>    Number of topic filters, default 10000");
+    PRINTF("-n <num>    Topics matched per test, default 200000");
+}
+#endif /* WOLFMQTT_SUBTRIE */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_SUBTRIE
+    int i, filters = 10000, count = 200000;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-f", 3) == 0 && i + 1 < argc) {
+            filters = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (filters < 1 || count < 1) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    rc = build_filters(filters);
+    if (rc == 0) {
+        build_topics();
+        rc = check_topics();
+    }
+    if (rc == 0) {
+        PRINTF("Subscription trie benchmark: %d filters, %d trie nodes",
+            mFilterCount, (int)mTrie.node_count);
+        run_match("Match filter list", list_match, count / 10);
+        run_match("Match trie", trie_match, count);
+        rc = build_rx_packets(0);
+    }
+    if (rc == 0) {
+        rc = run_recv("Receive filter list", BENCH_RECV_LIST, count / 10);
+    }
+    if (rc == 0) {
+        rc = run_recv("Receive trie", BENCH_RECV_TRIE, count);
+    }
+#ifdef WOLFMQTT_V5
+    if (rc == 0) {
+        rc = run_recv("Receive sub id", BENCH_RECV_SUB_ID, count);
+    }
+#endif
+    if (rc == 0) {
+        rc = check_resubscribe();
+    }
+
+    MqttSubTrie_Free(&mTrie);
+    if (mFilters != NULL) {
+        WOLFMQTT_FREE(mFilters);
+    }
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires the subscription trie to be enabled
+       ./configure --enable-subtrie */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,42 @@
+/* user_settings.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Settings for codecbench, which is built with the library sources and
+ * WOLFMQTT_USER_SETTINGS. Properties are allocated with malloc and every
+ * allocation is counted in gBenchAllocs. */
+#ifndef WOLFMQTT_BENCH_USER_SETTINGS_H
+#define WOLFMQTT_BENCH_USER_SETTINGS_H
+
+/* WOLFMQTT_USER_SETTINGS skips the configured options, so include them */
+#include <wolfmqtt/options.h>
+#include <stdlib.h>
+
+extern unsigned long gBenchAllocs;
+
+#ifndef WOLFMQTT_DYN_PROP
+    #define WOLFMQTT_DYN_PROP
+#endif
+
+#define WOLFMQTT_CUSTOM_MALLOC
+#define WOLFMQTT_MALLOC(s)  (gBenchAllocs++, malloc((s)))
+#define WOLFMQTT_FREE(p)    free((p))
+
+#endif /* WOLFMQTT_BENCH_USER_SETTINGS_H */
@@ -0,0 +1,325 @@
+/* utf8bench.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* UTF-8 validation benchmark.
+ * Times MqttUtf8_Validate with each available implementation on long topic
+ * names and on user property values with multi-byte characters. With v5,
+ * also receives publish messages with a long topic and user properties,
+ * which are all read in the message callback, to show the cost of
+ * validation in the decoder. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+#include "benchcommon.h"
+
+#ifdef WOLFMQTT_UTF8
+
+#define BENCH_MAX_STR       4096
+#define BENCH_BUF_SIZE      4096
+#define BENCH_NUM_PROPS     4
+
+static const MqttUtf8Impl kImpls[] = {
+    MQTT_UTF8_IMPL_SCALAR, MQTT_UTF8_IMPL_SSE2, MQTT_UTF8_IMPL_AVX2,
+    MQTT_UTF8_IMPL_NEON
+};
+
+static char mStr[BENCH_MAX_STR + 1];
+static volatile int mSink;
+
+/* Fills mStr with a topic of len bytes: levels of ASCII text */
+static void bench_topic(int len)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        mStr[i] = (i % 16 == 15) ? '/' : (char)('a' + (i % 26));
+    }
+    mStr[len] = '\0';
+}
+
+/* Fills mStr with len bytes of text using the given UTF-8 character,
+ * separated by ASCII spaces */
+static void bench_text(int len, const char* ch)
+{
+    int i = 0, n = (int)XSTRLEN(ch);
+
+    while (i + n + 1 <= len) {
+        XMEMCPY(&mStr[i], ch, n);
+        i += n;
+        mStr[i++] = ' ';
+    }
+    while (i < len) {
+        mStr[i++] = 'x';
+    }
+    mStr[len] = '\0';
+}
+
+static int run_validate(const char* desc, int len, byte flags, int count)
+{
+    int rc = MQTT_CODE_SUCCESS, i, k;
+    double start, elapsed;
+
+    for (k = 0; k < (int)(sizeof(kImpls) / sizeof(kImpls[0])); k++) {
+        if (MqttUtf8_SetImpl(kImpls[k]) != MQTT_CODE_SUCCESS) {
+            continue; /* not available */
+        }
+        start = bench_time_sec();
+        for (i = 0; i < count; i++) {
+            rc = MqttUtf8_Validate(mStr, (word32)len, flags);
+            if (rc != MQTT_CODE_SUCCESS) {
+                break;
+            }
+            mSink += rc;
+        }
+        elapsed = bench_time_sec() - start;
+        if (rc != MQTT_CODE_SUCCESS) {
+            PRINTF("%-24s %-6s: failed %d", desc,
+                MqttUtf8_ImplToString(kImpls[k]), rc);
+            return rc;
+        }
+        PRINTF("%-24s %-6s: %8.1f ns/string %8.0f MB/sec", desc,
+            MqttUtf8_ImplToString(kImpls[k]), elapsed * 1e9 / count,
+            (double)len * count / elapsed / 1e6);
+    }
+    return rc;
+}
+
+#ifdef WOLFMQTT_V5
+typedef struct _Utf8BenchCtx {
+    MqttClient      client;
+    MqttNet         net;
+    BenchNet        bnet;
+    byte            tx_buf[BENCH_BUF_SIZE];
+    byte            rx_buf[BENCH_BUF_SIZE];
+    int             recvd;
+    word32          prop_bytes;
+} Utf8BenchCtx;
+
+static Utf8BenchCtx mCtx;
+static char mTopic[257];
+static char mPropVal[129];
+static byte mRxPacket[BENCH_BUF_SIZE];
+static int  mRxPacketLen;
+static const byte kPayload[16] = { 0 };
+
+static int msg_cb(MqttClient *client, MqttMessage *msg, byte msg_new,
+    byte msg_done)
+{
+    Utf8BenchCtx* ctx = (Utf8BenchCtx*)client->ctx;
+    MqttProp prop;
+    int rc;
+
+    if (msg_new) {
+        while ((rc = MqttClient_PropsViewFind(&msg->props_view,
+                MQTT_PROP_USER_PROP, &prop)) > 0) {
+            ctx->prop_bytes += prop.data_str.len + prop.data_str2.len;
+        }
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    if (msg_done) {
+        ctx->recvd++;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Encode a publish with a long topic and user properties to replay */
+static int build_rx_packet(void)
+{
+    int rc, i;
+    Utf8BenchCtx* ctx = &mCtx;
+    MqttPublish publish;
+    MqttProp* prop;
+
+    bench_topic((int)sizeof(mTopic) - 1);
+    XMEMCPY(mTopic, mStr, sizeof(mTopic));
+    bench_text((int)sizeof(mPropVal) - 1, "\xC3\xA9t\xC3\xA9");
+    XMEMCPY(mPropVal, mStr, sizeof(mPropVal));
+
+    XMEMSET(ctx, 0, sizeof(Utf8BenchCtx));
+    ctx->bnet.cap = mRxPacket;
+    ctx->bnet.cap_size = (int)sizeof(mRxPacket);
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, NULL,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    XMEMSET(&publish, 0, sizeof(publish));
+    publish.qos = MQTT_QOS_0;
+    publish.topic_name = mTopic;
+    publish.buffer = (byte*)kPayload;
+    publish.total_len = (word32)sizeof(kPayload);
+    for (i = 0; i < BENCH_NUM_PROPS; i++) {
+        prop = MqttClient_PropsAdd(&publish.props);
+        if (prop == NULL) {
+            rc = MQTT_CODE_ERROR_MEMORY;
+            break;
+        }
+        prop->type = MQTT_PROP_USER_PROP;
+        prop->data_str.str = (char*)"bench-key";
+        prop->data_str.len = (word16)XSTRLEN(prop->data_str.str);
+        prop->data_str2.str = mPropVal;
+        prop->data_str2.len = (word16)XSTRLEN(mPropVal);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_Publish(&ctx->client, &publish);
+    }
+    MqttClient_PropsFree(publish.props);
+
+    mRxPacketLen = ctx->bnet.cap_len;
+    MqttClient_DeInit(&ctx->client);
+    return rc;
+}
+
+static int run_recv(MqttUtf8Impl impl, int count)
+{
+    int rc;
+    double start, elapsed;
+    Utf8BenchCtx* ctx = &mCtx;
+
+    rc = MqttUtf8_SetImpl(impl);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return MQTT_CODE_SUCCESS; /* not available */
+    }
+
+    XMEMSET(ctx, 0, sizeof(Utf8BenchCtx));
+    rc = bench_client_init(&ctx->client, &ctx->net, &ctx->bnet, msg_cb,
+        ctx->tx_buf, BENCH_BUF_SIZE, ctx->rx_buf, BENCH_BUF_SIZE);
+    if (rc == MQTT_CODE_SUCCESS) {
+        ctx->client.ctx = ctx;
+        ctx->bnet.rx = mRxPacket;
+        ctx->bnet.rx_len = mRxPacketLen;
+        rc = MqttClient_SetLazyProps(&ctx->client, 1);
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    start = bench_time_sec();
+    while (ctx->recvd < count && rc == MQTT_CODE_SUCCESS) {
+        rc = MqttClient_WaitMessage(&ctx->client, 1000);
+    }
+    elapsed = bench_time_sec() - start;
+
+    MqttClient_DeInit(&ctx->client);
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        PRINTF("Receive %-6s: %10.0f msg/sec (%.3f sec)",
+            MqttUtf8_ImplToString(MqttUtf8_GetImpl()),
+            (double)count / elapsed, elapsed);
+    }
+    else {
+        PRINTF("Receive %-6s: failed %d (%s)",
+            MqttUtf8_ImplToString(MqttUtf8_GetImpl()), rc,
+            MqttClient_ReturnCodeToString(rc));
+    }
+    return rc;
+}
+#endif /* WOLFMQTT_V5 */
+
+static void usage(void)
+{
+    PRINTF("utf8bench:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-n <num>    Iterations per test, default 1000000");
+}
+#endif /* WOLFMQTT_UTF8 */
+
+int main(int argc, char** argv)
+{
+    int rc = 0;
+#ifdef WOLFMQTT_UTF8
+    int i, count = 1000000;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-n", 3) == 0 && i + 1 < argc) {
+            count = XATOI(argv[++i]);
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (count < 1) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    PRINTF("UTF-8 validation benchmark: %d iterations", count);
+
+    bench_topic(64);
+    rc = run_validate("Topic 64 B", 64, MQTT_UTF8_TOPIC_NAME, count);
+    if (rc == 0) {
+        bench_topic(256);
+        rc = run_validate("Topic 256 B", 256, MQTT_UTF8_TOPIC_NAME, count);
+    }
+    if (rc == 0) {
+        bench_topic(1024);
+        rc = run_validate("Topic 1024 B", 1024, MQTT_UTF8_TOPIC_NAME, count);
+    }
+    if (rc == 0) {
+        bench_topic(256);
+        rc = run_validate("Filter 256 B", 256, MQTT_UTF8_TOPIC_FILTER,
+            count);
+    }
+    if (rc == 0) {
+        /* Latin text: two byte characters between ASCII */
+        bench_text(256, "\xC3\xA9t\xC3\xA9");
+        rc = run_validate("Property 256 B latin", 256, 0, count);
+    }
+    if (rc == 0) {
+        /* CJK text: runs of three byte characters */
+        bench_text(1024, "\xE6\x95\xB0\xE6\x8D\xAE\xE6\xB5\x81");
+        rc = run_validate("Property 1024 B CJK", 1024, 0, count);
+    }
+#ifdef WOLFMQTT_V5
+    if (rc == 0) {
+        rc = build_rx_packet();
+    }
+    if (rc == 0) {
+        PRINTF("Publish with %d byte topic and %d user properties:",
+            (int)XSTRLEN(mTopic), BENCH_NUM_PROPS);
+        rc = run_recv(MQTT_UTF8_IMPL_NONE, count);
+    }
+    if (rc == 0) {
+        rc = run_recv(MQTT_UTF8_IMPL_SCALAR, count);
+    }
+    if (rc == 0) {
+        rc = run_recv(MQTT_UTF8_IMPL_AUTO, count);
+    }
+#endif
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This benchmark requires UTF-8 validation to be enabled
+       ./configure --enable-utf8 */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
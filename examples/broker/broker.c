@@ -0,0 +1,363 @@
+/* broker.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Loopback MQTT broker, serving the in-process broker over TCP on
+ * 127.0.0.1 so the examples and test scripts run without an external
+ * broker. A single thread waits on the sockets with select and handles a
+ * packet from each readable connection. Plain TCP only. */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+#if defined(WOLFMQTT_BROKER) && !defined(USE_WINDOWS_API)
+
+#include "wolfmqtt/mqtt_broker.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+#endif
+
+#define BROKER_DEFAULT_PORT     1883
+#define BROKER_DEFAULT_CONNS    16
+#define BROKER_DEFAULT_BUF      4096
+#define BROKER_CMD_TIMEOUT_MS   5000
+#define BROKER_READ_TIMEOUT_MS  1000
+
+/* Network of one connection */
+typedef struct _BrokerSock {
+    MqttNet     net;
+    int         fd;
+    int         idx;            /* broker connection, -1 when free */
+} BrokerSock;
+
+static volatile int mStop;
+static int mDebug;
+
+static void sig_handler(int signo)
+{
+    (void)signo;
+    mStop = 1;
+}
+
+/* Accepted sockets are already connected */
+static int BrokerNet_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    (void)context;
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int BrokerNet_Read(void *context, byte* buf, int buf_len,
+    int timeout_ms)
+{
+    BrokerSock *sock = (BrokerSock*)context;
+    struct pollfd pfd;
+    int rc;
+
+    pfd.fd = sock->fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+#ifdef WOLFMQTT_NONBLOCK
+    /* Called again when select reports the socket readable */
+    timeout_ms = 0;
+#endif
+    rc = poll(&pfd, 1, timeout_ms);
+    if (rc == 0) {
+    #ifdef WOLFMQTT_NONBLOCK
+        return MQTT_CODE_CONTINUE;
+    #else
+        return MQTT_CODE_ERROR_TIMEOUT;
+    #endif
+    }
+    if (rc < 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    rc = (int)recv(sock->fd, buf, (size_t)buf_len, 0);
+    if (rc <= 0) {
+        /* Closed by the client */
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    return rc;
+}
+
+static int BrokerNet_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    BrokerSock *sock = (BrokerSock*)context;
+    int rc;
+
+    (void)timeout_ms;
+    rc = (int)send(sock->fd, buf, (size_t)buf_len, MSG_NOSIGNAL);
+    if (rc <= 0) {
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    return rc;
+}
+
+static int BrokerNet_Disconnect(void *context)
+{
+    BrokerSock *sock = (BrokerSock*)context;
+
+    if (sock->fd >= 0) {
+        close(sock->fd);
+        if (mDebug) {
+            PRINTF("Closed connection %d", sock->idx);
+        }
+    }
+    sock->fd = -1;
+    sock->idx = -1;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int broker_listen(word16 port)
+{
+    struct sockaddr_in addr;
+    int fd, on = 1;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    XMEMSET(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+            listen(fd, 16) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void broker_accept(MqttBroker *broker, BrokerSock *socks,
+    int max_conns, int listen_fd)
+{
+    BrokerSock *sock = NULL;
+    int fd, i, on = 1;
+
+    fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    for (i = 0; i < max_conns; i++) {
+        if (socks[i].fd < 0) {
+            sock = &socks[i];
+            break;
+        }
+    }
+    if (sock == NULL) {
+        PRINTF("Connection refused, %d in use", max_conns);
+        close(fd);
+        return;
+    }
+    (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    sock->fd = fd;
+    sock->net.context = sock;
+    sock->net.connect = BrokerNet_Connect;
+    sock->net.read = BrokerNet_Read;
+    sock->net.write = BrokerNet_Write;
+    sock->net.disconnect = BrokerNet_Disconnect;
+    sock->idx = MqttBroker_Add(broker, &sock->net);
+    if (sock->idx < 0) {
+        PRINTF("MqttBroker_Add failed: %s (%d)",
+            MqttClient_ReturnCodeToString(sock->idx), sock->idx);
+        close(fd);
+        sock->fd = -1;
+        sock->idx = -1;
+    }
+    else if (mDebug) {
+        PRINTF("Accepted connection %d", sock->idx);
+    }
+}
+
+static int broker_run(word16 port, int max_conns, int buf_len)
+{
+    MqttBroker broker;
+    BrokerSock *socks;
+    fd_set rfds;
+    int listen_fd, max_fd, i, idx, rc;
+
+    rc = MqttBroker_Init(&broker, (word16)max_conns, buf_len,
+        BROKER_CMD_TIMEOUT_MS);
+    if (rc != MQTT_CODE_SUCCESS) {
+        PRINTF("MqttBroker_Init failed: %s (%d)",
+            MqttClient_ReturnCodeToString(rc), rc);
+        return rc;
+    }
+    socks = (BrokerSock*)WOLFMQTT_MALLOC(sizeof(BrokerSock) * max_conns);
+    if (socks == NULL) {
+        MqttBroker_Free(&broker);
+        return MQTT_CODE_ERROR_MEMORY;
+    }
+    XMEMSET(socks, 0, sizeof(BrokerSock) * max_conns);
+    for (i = 0; i < max_conns; i++) {
+        socks[i].fd = -1;
+        socks[i].idx = -1;
+    }
+
+    listen_fd = broker_listen(port);
+    if (listen_fd < 0) {
+        PRINTF("Cannot listen on 127.0.0.1:%u, errno %d", port, errno);
+        WOLFMQTT_FREE(socks);
+        MqttBroker_Free(&broker);
+        return MQTT_CODE_ERROR_NETWORK;
+    }
+    PRINTF("MQTT broker listening on 127.0.0.1:%u, %d connections, %d byte "
+        "packets", port, max_conns, buf_len);
+
+    while (!mStop) {
+        FD_ZERO(&rfds);
+        FD_SET(listen_fd, &rfds);
+        max_fd = listen_fd;
+        for (i = 0; i < max_conns; i++) {
+            idx = socks[i].idx;
+            if (idx >= 0 &&
+                    broker.conns[idx].state == MQTT_BROKER_CONN_CLOSING) {
+                /* Taken over, or a publish to it failed */
+                (void)MqttBroker_Close(&broker, idx);
+            }
+            if (socks[i].fd >= 0) {
+                FD_SET(socks[i].fd, &rfds);
+                if (socks[i].fd > max_fd) {
+                    max_fd = socks[i].fd;
+                }
+            }
+        }
+        rc = select(max_fd + 1, &rfds, NULL, NULL, NULL);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (i = 0; i < max_conns; i++) {
+            if (socks[i].fd >= 0 && FD_ISSET(socks[i].fd, &rfds)) {
+                idx = socks[i].idx;
+                rc = MqttBroker_ConnTask(&broker, idx,
+                    BROKER_READ_TIMEOUT_MS);
+                if (rc < 0 && rc != MQTT_CODE_ERROR_TIMEOUT &&
+                        rc != MQTT_CODE_ERROR_NETWORK) {
+                    PRINTF("Connection %d closed: %s (%d)", idx,
+                        MqttClient_ReturnCodeToString(rc), rc);
+                }
+            }
+        }
+        if (FD_ISSET(listen_fd, &rfds)) {
+            broker_accept(&broker, socks, max_conns, listen_fd);
+        }
+    }
+
+    PRINTF("Connects %u, publishes received %u, sent %u, dropped %u",
+        broker.stats.connects, broker.stats.publish_in,
+        broker.stats.publish_out, broker.stats.dropped);
+
+    close(listen_fd);
+    MqttBroker_Free(&broker);
+    WOLFMQTT_FREE(socks);
+    return MQTT_CODE_SUCCESS;
+}
+
+static void usage(void)
+{
+    PRINTF("broker:");
+    PRINTF("-?          Help, print this usage");
+    PRINTF("-p <num>    Port to listen on 127.0.0.1, default %d",
+        BROKER_DEFAULT_PORT);
+    PRINTF("-c <num>    Most connections, default %d", BROKER_DEFAULT_CONNS);
+    PRINTF("-b <num>    Largest packet in bytes, default %d",
+        BROKER_DEFAULT_BUF);
+    PRINTF("-d          Print connections");
+}
+#endif /* WOLFMQTT_BROKER && !USE_WINDOWS_API */
+
+#if defined(NO_MAIN_DRIVER)
+int broker_main(int argc, char** argv)
+#else
+int main(int argc, char** argv)
+#endif
+{
+    int rc = 0;
+#if defined(WOLFMQTT_BROKER) && !defined(USE_WINDOWS_API)
+    int i, port = BROKER_DEFAULT_PORT, max_conns = BROKER_DEFAULT_CONNS;
+    int buf_len = BROKER_DEFAULT_BUF;
+
+    for (i = 1; i < argc; i++) {
+        if (XSTRNCMP(argv[i], "-p", 3) == 0 && i + 1 < argc) {
+            port = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-c", 3) == 0 && i + 1 < argc) {
+            max_conns = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-b", 3) == 0 && i + 1 < argc) {
+            buf_len = XATOI(argv[++i]);
+        }
+        else if (XSTRNCMP(argv[i], "-d", 3) == 0) {
+            mDebug = 1;
+        }
+        else {
+            usage();
+            return 0;
+        }
+    }
+    if (port < 1 || port > 65535 || max_conns < 1 || max_conns > 1024 ||
+            buf_len < 64) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    (void)signal(SIGINT, sig_handler);
+    (void)signal(SIGTERM, sig_handler);
+    (void)signal(SIGPIPE, SIG_IGN);
+
+    rc = broker_run((word16)port, max_conns, buf_len);
+#else
+    (void)argc;
+    (void)argv;
+
+    /* This example requires the broker to be enabled
+       ./configure --enable-broker */
+    PRINTF("Example not compiled in!");
+#endif
+
+    return (rc == 0) ? 0 : EXIT_FAILURE;
+}
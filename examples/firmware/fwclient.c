@@ -59,11 +59,26 @@
 #ifndef MAX_BUFFER_SIZE
 #define MAX_BUFFER_SIZE         FIRMWARE_MAX_PACKET
 #endif
+#ifdef WOLFMQTT_ASSEMBLER
+/* Firmware images larger than this are spilled to a temporary file */
+#ifndef FIRMWARE_SPILL_LEN
+    #ifdef WOLFMQTT_ASSEMBLER_SPILL
+        #define FIRMWARE_SPILL_LEN  (64 * 1024)
+    #else
+        #define FIRMWARE_SPILL_LEN  0
+    #endif
+#endif
+#endif
 
 /* Locals */
 static int mStopRead = 0;
 static int mTestDone = 0;
+#ifdef WOLFMQTT_ASSEMBLER
+static MqttAssembler mFwAsm;
+static int mFwTopic;
+#else
 static byte* mFwBuf;
+#endif
 
 
 static int fwfile_save(const char* filePath, byte* fileBuf, int fileLen)
@@ -167,6 +182,45 @@ static int fw_message_process(MQTTCtx *mqttCtx, byte* buffer, word32 len)
     return rc;
 }
 
+#ifdef WOLFMQTT_ASSEMBLER
+static int fw_assembled_cb(MqttClient *client, MqttAssembledMsg *msg,
+    void *ctx)
+{
+    MQTTCtx* mqttCtx = (MQTTCtx*)ctx;
+    (void)client;
+
+    fw_message_process(mqttCtx, msg->buffer, msg->total_len);
+
+    /* for test mode stop client */
+    if (mqttCtx->test_mode) {
+        mTestDone = 1;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int mqtt_message_cb(MqttClient *client, MqttMessage *msg,
+    byte msg_new, byte msg_done)
+{
+    MQTTCtx* mqttCtx = (MQTTCtx*)client->ctx;
+
+    /* Verify this message is for the firmware topic */
+    if (msg_new) {
+        mFwTopic = (XSTRNCMP(msg->topic_name, mqttCtx->topic_name,
+            msg->topic_name_len) == 0);
+        if (mFwTopic) {
+            /* Print incoming message */
+            PRINTF("MQTT Firmware Message: Qos %d, Len %u",
+                msg->qos, msg->total_len);
+        }
+    }
+    if (!mFwTopic) {
+        return MQTT_CODE_SUCCESS;
+    }
+
+    /* Collect the entire firmware image (in memory or a mapped file) */
+    return MqttAssembler_Message(&mFwAsm, client, msg, msg_new, msg_done);
+}
+#else
 static int mqtt_message_cb(MqttClient *client, MqttMessage *msg,
     byte msg_new, byte msg_done)
 {
@@ -213,6 +267,7 @@ static int mqtt_message_cb(MqttClient *client, MqttMessage *msg,
     /* Return negative to terminate publish processing */
     return MQTT_CODE_SUCCESS;
 }
+#endif /* WOLFMQTT_ASSEMBLER */
 
 int fwclient_test(MQTTCtx *mqttCtx)
 {
@@ -265,6 +320,14 @@ int fwclient_test(MQTTCtx *mqttCtx)
                 goto exit;
             }
             mqttCtx->client.ctx = mqttCtx;
+
+        #ifdef WOLFMQTT_ASSEMBLER
+            rc = MqttAssembler_Init(&mFwAsm, FIRMWARE_SPILL_LEN, 0, NULL,
+                fw_assembled_cb, mqttCtx);
+            if (rc != MQTT_CODE_SUCCESS) {
+                goto exit;
+            }
+        #endif
         }
         FALL_THROUGH;
 
@@ -486,6 +549,9 @@ exit:
         /* Free resources */
         if (mqttCtx->tx_buf) WOLFMQTT_FREE(mqttCtx->tx_buf);
         if (mqttCtx->rx_buf) WOLFMQTT_FREE(mqttCtx->rx_buf);
+    #ifdef WOLFMQTT_ASSEMBLER
+        MqttAssembler_Free(&mFwAsm);
+    #endif
 
         /* Cleanup network */
         MqttClientNet_DeInit(&mqttCtx->net);
@@ -766,7 +766,12 @@ int mqtt_dtls_cb(MqttClient* client) {
     int rc = WOLFSSL_FAILURE;
     SocketContext * sock = (SocketContext *)client->net->context;
 
+#ifdef WOLFSSL_DTLS13
+    /* DTLS 1.3, with downgrade to 1.2 */
+    client->tls.ctx = wolfSSL_CTX_new(wolfDTLS_client_method());
+#else
     client->tls.ctx = wolfSSL_CTX_new(wolfDTLSv1_2_client_method());
+#endif
     if (client->tls.ctx) {
         wolfSSL_CTX_set_verify(client->tls.ctx, WOLFSSL_VERIFY_PEER,
                 mqtt_tls_verify_cb);
@@ -814,6 +819,24 @@ int mqtt_dtls_cb(MqttClient* client) {
             rc = WOLFSSL_FAILURE;
             return rc;
         }
+
+        if (MqttClient_Flags(client, 0, 0) & MQTT_CLIENT_FLAG_DTLS_CID) {
+        #ifdef WOLFSSL_DTLS_CID
+            /* Offer connection IDs, so the session survives NAT
+               rebinding */
+            rc = wolfSSL_dtls_cid_use(client->tls.ssl);
+            if (rc != WOLFSSL_SUCCESS) {
+                PRINTF("Error enabling DTLS connection ID: %d", rc);
+                return rc;
+            }
+        #else
+            /* Same as MqttSocket_Connect, do not silently run without */
+            PRINTF("DTLS connection ID requires wolfSSL built with "
+                   "--enable-dtlscid");
+            rc = WOLFSSL_FAILURE;
+            return rc;
+        #endif
+        }
     }
 
     PRINTF("MQTT DTLS Setup (%d)", rc);
@@ -858,7 +858,7 @@ int main(int argc, char** argv)
     }
     #ifdef WOLFMQTT_STRESS
     /* Forbid running stress test against anything but localhost. */
-    if (XSTRCMP(gMqttCtx.host, "localhost") != 0) {
+    if (XSTRNCMP(gMqttCtx.host, "localhost", 10) != 0) {
         PRINTF("error: stress build may only run against localhost: host=%s",
                gMqttCtx.host);
         return -1;
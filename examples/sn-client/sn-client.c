@@ -160,6 +160,10 @@ int sn_test(MQTTCtx *mqttCtx)
     if (mqttCtx->use_tls) {
         /* Set the DTLS flag in the client structure to indicate DTLS usage */
         MqttClient_Flags(&mqttCtx->client, 0, MQTT_CLIENT_FLAG_IS_DTLS);
+    #ifdef WOLFSSL_DTLS_CID
+        /* Offer a connection ID, so the session survives NAT rebinding */
+        MqttClient_Flags(&mqttCtx->client, 0, MQTT_CLIENT_FLAG_DTLS_CID);
+    #endif
     }
 #endif
 
@@ -173,6 +177,14 @@ int sn_test(MQTTCtx *mqttCtx)
     if (rc != MQTT_CODE_SUCCESS) {
         goto exit;
     }
+#if defined(ENABLE_MQTT_TLS) && defined(WOLFSSL_DTLS_CID)
+    if (mqttCtx->use_tls) {
+        PRINTF("MQTT-SN DTLS %s, Connection ID %s",
+            wolfSSL_get_version(mqttCtx->client.tls.ssl),
+            wolfSSL_dtls_cid_is_enabled(mqttCtx->client.tls.ssl) ?
+                "in use" : "not in use");
+    }
+#endif
 
     /* Set the Register callback used when the gateway
        assigns a new topic ID to a topic name. */
@@ -635,6 +647,12 @@ int sn_test(MQTTCtx *mqttCtx)
                     MqttClient_ReturnCodeToString(rc), rc);
                 goto disconn;
             }
+        #ifdef WOLFMQTT_SN_SLEEP
+            PRINTF("MQTT-SN Awake: %u buffered messages, %s",
+                mqttCtx->client.sn_sleep_stats.buffered,
+                SN_Client_GetState(&mqttCtx->client) ==
+                    SN_CLIENT_STATE_ASLEEP ? "asleep again" : "not asleep");
+        #endif
         }
     }
 
@@ -0,0 +1,366 @@
+/* mqtt_alias.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_TOPIC_ALIAS: Enables automatic MQTT v5 topic aliases. With an
+ *  outbound table set (MqttClient_SetTopicAliasOut) the client assigns an
+ *  alias to each published topic, within the Topic Alias Maximum from the
+ *  broker CONNACK. The first publish sends the topic and the alias, later
+ *  publishes only the alias. When all aliases are in use the least recently
+ *  used one is reassigned. The table is cleared on each connect.
+ *
+ *  With an inbound table set (MqttClient_SetTopicAliasIn) the client
+ *  advertises a Topic Alias Maximum in CONNECT and replaces the empty topic
+ *  of an aliased publish with the topic the broker set for the alias, before
+ *  the message callback.
+ *
+ * MQTT_TOPIC_ALIAS_MIN_LEN: Shortest topic given an alias (default 4).
+ */
+
+#ifdef WOLFMQTT_TOPIC_ALIAS
+
+/* Private functions */
+
+/* FNV-1a */
+static word32 MqttAlias_Hash(const char *topic, word16 len)
+{
+    word32 hash = 2166136261UL;
+    word16 i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (byte)topic[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static void MqttAliasOut_Unlink(MqttTopicAliasOut *out, word16 alias)
+{
+    MqttAliasEntry* e = &out->entries[alias - 1];
+
+    if (e->prev != 0) {
+        out->entries[e->prev - 1].next = e->next;
+    }
+    else if (out->head == alias) {
+        out->head = e->next;
+    }
+    if (e->next != 0) {
+        out->entries[e->next - 1].prev = e->prev;
+    }
+    else if (out->tail == alias) {
+        out->tail = e->prev;
+    }
+    e->prev = e->next = 0;
+}
+
+static void MqttAliasOut_PushFront(MqttTopicAliasOut *out, word16 alias)
+{
+    MqttAliasEntry* e = &out->entries[alias - 1];
+
+    e->prev = 0;
+    e->next = out->head;
+    if (out->head != 0) {
+        out->entries[out->head - 1].prev = alias;
+    }
+    out->head = alias;
+    if (out->tail == 0) {
+        out->tail = alias;
+    }
+}
+
+static void MqttAliasOut_PushBack(MqttTopicAliasOut *out, word16 alias)
+{
+    MqttAliasEntry* e = &out->entries[alias - 1];
+
+    e->next = 0;
+    e->prev = out->tail;
+    if (out->tail != 0) {
+        out->entries[out->tail - 1].next = alias;
+    }
+    out->tail = alias;
+    if (out->head == 0) {
+        out->head = alias;
+    }
+}
+
+/* Removes the topic from the hash table and releases it */
+static void MqttAliasOut_Remove(MqttTopicAliasOut *out, word16 alias)
+{
+    MqttAliasEntry* e = &out->entries[alias - 1];
+    word16* link;
+
+    if (e->topic == NULL) {
+        return;
+    }
+    link = &out->buckets[e->hash & out->bucket_mask];
+    while (*link != 0 && *link != alias) {
+        link = &out->entries[*link - 1].chain;
+    }
+    if (*link == alias) {
+        *link = e->chain;
+    }
+    WOLFMQTT_FREE(e->topic);
+    e->topic = NULL;
+    e->topic_len = 0;
+    e->chain = 0;
+}
+
+
+/* Public Functions */
+
+int MqttTopicAliasOut_Init(MqttTopicAliasOut *out, word16 max_aliases)
+{
+    word32 buckets = 16;
+
+    if (out == NULL || max_aliases == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Keep the hash table at most half full */
+    while (buckets < (word32)max_aliases * 2) {
+        buckets <<= 1;
+    }
+
+    XMEMSET(out, 0, sizeof(MqttTopicAliasOut));
+    out->entries = (MqttAliasEntry*)WOLFMQTT_MALLOC(
+        sizeof(MqttAliasEntry) * max_aliases);
+    out->buckets = (word16*)WOLFMQTT_MALLOC(sizeof(word16) * buckets);
+    if (out->entries == NULL || out->buckets == NULL) {
+        if (out->entries) WOLFMQTT_FREE(out->entries);
+        if (out->buckets) WOLFMQTT_FREE(out->buckets);
+        out->entries = NULL;
+        out->buckets = NULL;
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    XMEMSET(out->entries, 0, sizeof(MqttAliasEntry) * max_aliases);
+    XMEMSET(out->buckets, 0, sizeof(word16) * buckets);
+    out->bucket_mask = buckets - 1;
+    out->capacity = max_aliases;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+void MqttTopicAliasOut_Free(MqttTopicAliasOut *out)
+{
+    if (out == NULL || out->entries == NULL) {
+        return;
+    }
+    MqttTopicAliasOut_Reset(out, 0);
+    WOLFMQTT_FREE(out->entries);
+    WOLFMQTT_FREE(out->buckets);
+    XMEMSET(out, 0, sizeof(MqttTopicAliasOut));
+}
+
+void MqttTopicAliasOut_Reset(MqttTopicAliasOut *out, word16 broker_max)
+{
+    word16 alias;
+
+    if (out == NULL || out->entries == NULL) {
+        return;
+    }
+    for (alias = 1; alias <= out->count; alias++) {
+        if (out->entries[alias - 1].topic != NULL) {
+            WOLFMQTT_FREE(out->entries[alias - 1].topic);
+        }
+    }
+    XMEMSET(out->entries, 0, sizeof(MqttAliasEntry) * out->capacity);
+    XMEMSET(out->buckets, 0, sizeof(word16) * (out->bucket_mask + 1));
+    out->count = 0;
+    out->head = out->tail = 0;
+    out->max = (broker_max < out->capacity) ? broker_max : out->capacity;
+}
+
+word16 MqttTopicAliasOut_Get(MqttTopicAliasOut *out, const char *topic,
+    byte *known)
+{
+    size_t len;
+    word32 hash;
+    word16 alias;
+    MqttAliasEntry* e;
+
+    *known = 0;
+    if (out == NULL || out->max == 0 || topic == NULL) {
+        return 0;
+    }
+    len = XSTRLEN(topic);
+    if (len < MQTT_TOPIC_ALIAS_MIN_LEN || len > 0xFFFF) {
+        return 0;
+    }
+    hash = MqttAlias_Hash(topic, (word16)len);
+
+    for (alias = out->buckets[hash & out->bucket_mask]; alias != 0;
+         alias = e->chain) {
+        e = &out->entries[alias - 1];
+        if (e->hash == hash && e->topic_len == len &&
+                XMEMCMP(e->topic, topic, len) == 0) {
+            if (out->head != alias) {
+                MqttAliasOut_Unlink(out, alias);
+                MqttAliasOut_PushFront(out, alias);
+            }
+            *known = 1;
+            return alias;
+        }
+    }
+
+    /* Assign the next unused alias or reuse the least recently used */
+    if (out->count < out->max) {
+        alias = out->count + 1;
+    }
+    else {
+        alias = out->tail;
+        MqttAliasOut_Unlink(out, alias);
+        MqttAliasOut_Remove(out, alias);
+    }
+    e = &out->entries[alias - 1];
+
+    e->topic = (char*)WOLFMQTT_MALLOC(len);
+    if (e->topic == NULL) {
+        if (alias <= out->count) {
+            /* reuse this alias first */
+            MqttAliasOut_PushBack(out, alias);
+        }
+        return 0;
+    }
+    if (alias > out->count) {
+        /* only counted once it holds a topic */
+        out->count = alias;
+    }
+    XMEMCPY(e->topic, topic, len);
+    e->topic_len = (word16)len;
+    e->hash = hash;
+    e->chain = out->buckets[hash & out->bucket_mask];
+    out->buckets[hash & out->bucket_mask] = alias;
+    MqttAliasOut_PushFront(out, alias);
+
+    return alias;
+}
+
+void MqttTopicAliasOut_Forget(MqttTopicAliasOut *out, word16 alias)
+{
+    if (out == NULL || alias == 0 || alias > out->count) {
+        return;
+    }
+    MqttAliasOut_Remove(out, alias);
+    MqttAliasOut_Unlink(out, alias);
+    MqttAliasOut_PushBack(out, alias);
+}
+
+
+int MqttTopicAliasIn_Init(MqttTopicAliasIn *in, word16 max_aliases)
+{
+    if (in == NULL || max_aliases == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(in, 0, sizeof(MqttTopicAliasIn));
+    in->topics = (MqttAliasTopic*)WOLFMQTT_MALLOC(
+        sizeof(MqttAliasTopic) * max_aliases);
+    if (in->topics == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    XMEMSET(in->topics, 0, sizeof(MqttAliasTopic) * max_aliases);
+    in->capacity = max_aliases;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+void MqttTopicAliasIn_Free(MqttTopicAliasIn *in)
+{
+    word16 i;
+
+    if (in == NULL || in->topics == NULL) {
+        return;
+    }
+    for (i = 0; i < in->capacity; i++) {
+        if (in->topics[i].topic != NULL) {
+            WOLFMQTT_FREE(in->topics[i].topic);
+        }
+    }
+    WOLFMQTT_FREE(in->topics);
+    XMEMSET(in, 0, sizeof(MqttTopicAliasIn));
+}
+
+void MqttTopicAliasIn_Reset(MqttTopicAliasIn *in, word16 max)
+{
+    word16 i;
+
+    if (in == NULL || in->topics == NULL) {
+        return;
+    }
+    /* Keep the topic memory for the next connection */
+    for (i = 0; i < in->capacity; i++) {
+        in->topics[i].topic_len = 0;
+    }
+    in->max = (max < in->capacity) ? max : in->capacity;
+}
+
+int MqttTopicAliasIn_Resolve(MqttTopicAliasIn *in, word16 alias,
+    const char **topic, word16 *topic_len)
+{
+    MqttAliasTopic* t;
+
+    if (in == NULL || topic == NULL || topic_len == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    /* Protocol error: alias not in 1 to Topic Alias Maximum */
+    if (alias == 0 || alias > in->max) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+    }
+    t = &in->topics[alias - 1];
+
+    if (*topic_len == 0) {
+        /* Protocol error: alias was not set on this connection */
+        if (t->topic_len == 0) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+        }
+        *topic = t->topic;
+        *topic_len = t->topic_len;
+        return MQTT_CODE_SUCCESS;
+    }
+
+    /* Set or replace the topic for the alias */
+    if (t->topic == NULL || t->size <= *topic_len) {
+        char* mem = (char*)WOLFMQTT_MALLOC((size_t)*topic_len + 1);
+        if (mem == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+        if (t->topic != NULL) {
+            WOLFMQTT_FREE(t->topic);
+        }
+        t->topic = mem;
+        t->size = (word16)(*topic_len + 1);
+    }
+    XMEMCPY(t->topic, *topic, *topic_len);
+    t->topic[*topic_len] = '\0';
+    t->topic_len = *topic_len;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+#endif /* WOLFMQTT_TOPIC_ALIAS */
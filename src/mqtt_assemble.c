@@ -0,0 +1,303 @@
+/* mqtt_assemble.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_ASSEMBLER: Enables the large message assembler, which delivers a
+ *  complete received payload to a handler instead of receive buffer sized
+ *  segments. Payloads above a threshold are written to an unlinked
+ *  temporary file and mapped once complete. The segments are written with
+ *  write() rather than through a writable mapping, so the dirty pages are
+ *  owned by the page cache and not charged to the process until read.
+ *
+ * WOLFMQTT_NO_ASSEMBLER_SPILL: Disables the temporary file support (all
+ *  messages are assembled in memory).
+ *
+ * MQTT_ASSEMBLER_TMP_DIR: Spill directory when TMPDIR is not set
+ *  (default "/tmp").
+ */
+
+#ifdef WOLFMQTT_ASSEMBLER
+
+#ifdef WOLFMQTT_ASSEMBLER_SPILL
+    #include <stdlib.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+
+/* Private functions */
+
+static void MqttAssembler_Release(MqttAssembler *asmb)
+{
+    if (asmb->mem != NULL) {
+        WOLFMQTT_FREE(asmb->mem);
+        asmb->mem = NULL;
+    }
+#ifdef WOLFMQTT_ASSEMBLER_SPILL
+    if (asmb->cur.spilled && asmb->fd >= 0) {
+        (void)close(asmb->fd);
+        asmb->fd = -1;
+    }
+    asmb->written = 0;
+#endif
+    XMEMSET(&asmb->cur, 0, sizeof(asmb->cur));
+    asmb->active = 0;
+}
+
+#ifdef WOLFMQTT_ASSEMBLER_SPILL
+static int MqttAssembler_SpillOpen(MqttAssembler *asmb)
+{
+    char path[MQTT_ASSEMBLER_MAX_PATH];
+    const char* dir = asmb->dir;
+    int len;
+
+    if (dir == NULL) {
+        dir = getenv("TMPDIR");
+        if (dir == NULL || *dir == '\0') {
+            dir = MQTT_ASSEMBLER_TMP_DIR;
+        }
+    }
+    len = XSNPRINTF(path, sizeof(path), "%s/wolfmqtt-XXXXXX", dir);
+    if (len < 0 || len >= (int)sizeof(path)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    asmb->fd = mkstemp(path);
+    if (asmb->fd < 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+    /* Only the descriptor is needed, so the file is removed once closed */
+    (void)unlink(path);
+    asmb->written = 0;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int MqttAssembler_SpillWrite(MqttAssembler *asmb, const byte* buf,
+    word32 len)
+{
+    ssize_t ret;
+
+    while (len > 0) {
+        ret = write(asmb->fd, buf, len);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+        }
+        buf += ret;
+        len -= (word32)ret;
+        asmb->written += (word32)ret;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int MqttAssembler_SpillDeliver(MqttAssembler *asmb,
+    MqttClient *client)
+{
+    int rc;
+    void* map;
+
+    map = mmap(NULL, asmb->cur.total_len, PROT_READ, MAP_SHARED, asmb->fd,
+        0);
+    if (map == MAP_FAILED) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#ifdef POSIX_MADV_SEQUENTIAL
+    (void)posix_madvise(map, asmb->cur.total_len, POSIX_MADV_SEQUENTIAL);
+#endif
+
+    asmb->cur.buffer = (byte*)map;
+    rc = asmb->cb(client, &asmb->cur, asmb->ctx);
+
+    (void)munmap(map, asmb->cur.total_len);
+    return rc;
+}
+#endif /* WOLFMQTT_ASSEMBLER_SPILL */
+
+
+/* Public Functions */
+
+int MqttAssembler_Init(MqttAssembler *asmb, word32 spill_len, word32 max_len,
+    const char *dir, MqttAssemblerCb cb, void *ctx)
+{
+    if (asmb == NULL || cb == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+#ifndef WOLFMQTT_ASSEMBLER_SPILL
+    if (spill_len > 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+#endif
+
+    XMEMSET(asmb, 0, sizeof(MqttAssembler));
+    asmb->cb = cb;
+    asmb->ctx = ctx;
+    asmb->spill_len = spill_len;
+    asmb->max_len = max_len;
+    asmb->dir = dir;
+#ifdef WOLFMQTT_ASSEMBLER_SPILL
+    asmb->fd = -1;
+#endif
+    return MQTT_CODE_SUCCESS;
+}
+
+void MqttAssembler_Free(MqttAssembler *asmb)
+{
+    if (asmb != NULL) {
+        MqttAssembler_Release(asmb);
+    }
+}
+
+int MqttAssembler_Message(MqttAssembler *asmb, MqttClient *client,
+    MqttMessage *msg, byte msg_new, byte msg_done)
+{
+    int rc = MQTT_CODE_SUCCESS;
+    MqttAssembledMsg* amsg;
+
+    if (asmb == NULL || msg == NULL || asmb->cb == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    amsg = &asmb->cur;
+
+    if (msg_new) {
+        word32 alloc_len;
+        byte spill = 0, in_place = 0;
+
+        /* previous message was not completed */
+        MqttAssembler_Release(asmb);
+
+        if (asmb->max_len > 0 && msg->total_len > asmb->max_len) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+        }
+        if (asmb->spill_len > 0 && msg->total_len > asmb->spill_len) {
+            spill = 1;
+        }
+        else if (msg_done && msg->buffer_pos == 0 &&
+                 msg->buffer_len == msg->total_len) {
+            /* Entire payload is in the receive buffer */
+            in_place = 1;
+        }
+
+        /* topic copy, followed by the payload when assembled in memory */
+        alloc_len = (word32)msg->topic_name_len + 1;
+        if (!spill && !in_place) {
+            alloc_len += msg->total_len;
+        }
+        asmb->mem = (byte*)WOLFMQTT_MALLOC(alloc_len);
+        if (asmb->mem == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+        amsg->packet_id = msg->packet_id;
+        amsg->qos = msg->qos;
+        amsg->retain = msg->retain;
+        amsg->duplicate = msg->duplicate;
+        amsg->topic_name = (char*)asmb->mem;
+        amsg->topic_name_len = msg->topic_name_len;
+        if (msg->topic_name_len > 0) {
+            XMEMCPY(amsg->topic_name, msg->topic_name, msg->topic_name_len);
+        }
+        amsg->topic_name[msg->topic_name_len] = '\0';
+        amsg->total_len = msg->total_len;
+        if (in_place) {
+            amsg->buffer = msg->buffer;
+        }
+        else if (!spill) {
+            amsg->buffer = asmb->mem + msg->topic_name_len + 1;
+        }
+        asmb->active = 1;
+
+    #ifdef WOLFMQTT_ASSEMBLER_SPILL
+        if (spill) {
+            amsg->spilled = 1;
+            rc = MqttAssembler_SpillOpen(asmb);
+            if (rc != MQTT_CODE_SUCCESS) {
+                MqttAssembler_Release(asmb);
+                return rc;
+            }
+        }
+    #endif
+    }
+
+    if (!asmb->active) {
+        /* message was not started */
+        return MQTT_CODE_SUCCESS;
+    }
+
+    /* add payload segment */
+    if (msg->buffer_len > 0 && amsg->buffer != msg->buffer) {
+        if (msg->buffer_pos > amsg->total_len ||
+                msg->buffer_len > amsg->total_len - msg->buffer_pos) {
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+        }
+    #ifdef WOLFMQTT_ASSEMBLER_SPILL
+        else if (amsg->spilled) {
+            /* segments are received in order */
+            if (msg->buffer_pos != asmb->written) {
+                rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_STAT);
+            }
+            else {
+                rc = MqttAssembler_SpillWrite(asmb, msg->buffer,
+                    msg->buffer_len);
+            }
+        }
+    #endif
+        else {
+            XMEMCPY(&amsg->buffer[msg->buffer_pos], msg->buffer,
+                msg->buffer_len);
+        }
+    }
+
+    if (rc == MQTT_CODE_SUCCESS && msg_done) {
+    #ifdef WOLFMQTT_ASSEMBLER_SPILL
+        if (amsg->spilled) {
+            if (asmb->written != amsg->total_len) {
+                rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_STAT);
+            }
+            else {
+                rc = MqttAssembler_SpillDeliver(asmb, client);
+            }
+        }
+        else
+    #endif
+        {
+            rc = asmb->cb(client, amsg, asmb->ctx);
+        }
+        MqttAssembler_Release(asmb);
+    }
+    else if (rc != MQTT_CODE_SUCCESS) {
+        MqttAssembler_Release(asmb);
+    }
+
+    return rc;
+}
+
+#endif /* WOLFMQTT_ASSEMBLER */
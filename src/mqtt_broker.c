@@ -0,0 +1,1058 @@
+/* mqtt_broker.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_broker.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_BROKER: Enables the minimal in-process MQTT broker, built from
+ *  the packet encoders and decoders with the broker side codecs added. It
+ *  serves any MqttNet, such as TCP on loopback or an in-memory transport,
+ *  so clients can be tested and measured without an external broker.
+ *
+ * MQTT_BROKER_MAX_SUBS: Most subscriptions of a connection (default 16).
+ *
+ * MQTT_BROKER_MAX_TOPICS: Most topics in one SUBSCRIBE or UNSUBSCRIBE
+ *  (default 32).
+ *
+ * MQTT_BROKER_MAX_RETAINED: Most retained messages (default 64).
+ *
+ * MQTT_BROKER_MAX_QOS2: Most QoS 2 publishes received on a connection and
+ *  not yet released (default 16). Further ones are delivered, without
+ *  detecting a duplicate.
+ *
+ * MQTT_BROKER_CLIENTID_MAX_LEN: Longest client identifier (default 64).
+ */
+
+#ifdef WOLFMQTT_BROKER
+
+/* Prefix of the client identifiers assigned by the broker */
+#define MQTT_BROKER_ID_PREFIX       "wolfMQTT-"
+
+/* Private functions */
+
+static int MqttBroker_Lock(MqttBroker *broker)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&broker->lock) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#else
+    (void)broker;
+#endif
+    return MQTT_CODE_SUCCESS;
+}
+
+static void MqttBroker_Unlock(MqttBroker *broker)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemUnlock(&broker->lock);
+#else
+    (void)broker;
+#endif
+}
+
+/* Matches a topic name against a topic filter */
+static int MqttBroker_TopicMatch(const char *filter, const char *topic,
+    word16 topic_len)
+{
+    word16 pos = 0;
+
+    /* Wildcards do not match topics starting with '$' */
+    if (topic_len > 0 && topic[0] == '$' &&
+            (filter[0] == '+' || filter[0] == '#')) {
+        return 0;
+    }
+    while (*filter != '\0') {
+        if (*filter == '#') {
+            return 1;
+        }
+        if (*filter == '+') {
+            while (pos < topic_len && topic[pos] != '/') {
+                pos++;
+            }
+            filter++;
+            continue;
+        }
+        if (pos >= topic_len || *filter != topic[pos]) {
+            /* "a/#" also matches "a" */
+            return (pos == topic_len && XSTRNCMP(filter, "/#", 3) == 0);
+        }
+        filter++;
+        pos++;
+    }
+    return (pos == topic_len);
+}
+
+/* Wildcards must be a whole level and '#' must be last */
+static int MqttBroker_FilterValid(const char *filter)
+{
+    const char *p;
+
+    if (*filter == '\0') {
+        return 0;
+    }
+    for (p = filter; *p != '\0'; p++) {
+        if (*p != '+' && *p != '#') {
+            continue;
+        }
+        if (p != filter && p[-1] != '/') {
+            return 0;
+        }
+        if (p[1] != '\0' && (*p == '#' || p[1] != '/')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int MqttBroker_TopicValid(const char *topic, word16 topic_len)
+{
+    word16 i;
+
+    if (topic_len == 0) {
+        return 0;
+    }
+    for (i = 0; i < topic_len; i++) {
+        if (topic[i] == '+' || topic[i] == '#') {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Writes a whole packet, waiting for a non-blocking network */
+static int MqttBroker_Write(MqttBrokerConn *conn, byte *buf, int len)
+{
+    int rc;
+
+    do {
+        rc = MqttPacket_Write(&conn->client, buf, len);
+    } while (rc == MQTT_CODE_CONTINUE);
+
+    return (rc < 0) ? rc : MQTT_CODE_SUCCESS;
+}
+
+static void MqttBroker_CloseConn(MqttBroker *broker, MqttBrokerConn *conn)
+{
+    int i;
+
+    if (conn->state == MQTT_BROKER_CONN_FREE) {
+        return;
+    }
+    for (i = 0; i < MQTT_BROKER_MAX_SUBS; i++) {
+        if (conn->subs[i].filter != NULL) {
+            WOLFMQTT_FREE(conn->subs[i].filter);
+            conn->subs[i].filter = NULL;
+        }
+    }
+    /* Network only: MqttSocket_Disconnect would also clean up TLS for the
+       whole process */
+    if (conn->client.net != NULL && conn->client.net->disconnect != NULL) {
+        (void)conn->client.net->disconnect(conn->client.net->context);
+    }
+    MqttClient_DeInit(&conn->client);
+    conn->state = MQTT_BROKER_CONN_FREE;
+    conn->client_id[0] = '\0';
+    broker->count--;
+}
+
+/* Sends a publish to a connection. var holds the encoded topic name,
+   followed by the property length and properties sent to v5 clients. */
+static int MqttBroker_SendPublish(MqttBroker *broker, MqttBrokerConn *conn,
+    byte *var, word32 topic_len, word32 var_len, byte *payload,
+    word32 payload_len, MqttQoS qos, byte retain)
+{
+    MqttPublishTemplate tmpl;
+    MqttPublish publish;
+    int rc, len;
+
+    XMEMSET(&tmpl, 0, sizeof(tmpl));
+    tmpl.buf = var;
+    tmpl.topic_len = topic_len;
+    tmpl.len = (conn->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) ?
+        var_len : topic_len;
+    tmpl.qos = qos;
+    tmpl.retain = retain;
+    tmpl.type_flags = MQTT_PACKET_TYPE_SET(MQTT_PACKET_TYPE_PUBLISH);
+    if (retain) {
+        tmpl.type_flags |= MQTT_PACKET_FLAGS_SET(MQTT_PACKET_FLAG_RETAIN);
+    }
+    if (qos) {
+        tmpl.type_flags |= MQTT_PACKET_FLAGS_SET_QOS(qos);
+    }
+
+    XMEMSET(&publish, 0, sizeof(publish));
+    publish.tmpl = &tmpl;
+    publish.qos = qos;
+    publish.buffer = payload;
+    publish.total_len = payload_len;
+    if (qos > MQTT_QOS_0) {
+        if (++conn->packet_id == 0) {
+            conn->packet_id = 1;
+        }
+        publish.packet_id = conn->packet_id;
+    }
+
+    /* The payload not copied into tx_buf is written from the source */
+    len = MqttEncode_Publish(conn->client.tx_buf, conn->client.tx_buf_len,
+        &publish, 0);
+    if (len < 0) {
+        return len;
+    }
+#ifdef WOLFMQTT_V5
+    if (conn->client.packet_sz_max > 0 && (word32)len + payload_len -
+            publish.buffer_pos > conn->client.packet_sz_max) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SERVER_PROP);
+    }
+#endif
+    rc = MqttBroker_Write(conn, conn->client.tx_buf, len);
+    if (rc == MQTT_CODE_SUCCESS && publish.buffer_pos < payload_len) {
+        rc = MqttBroker_Write(conn, &payload[publish.buffer_pos],
+            (int)(payload_len - publish.buffer_pos));
+    }
+    (void)broker;
+    return rc;
+}
+
+/* Sends a publish to each connection with a matching subscription, once at
+   the highest QoS of its matching subscriptions */
+static void MqttBroker_Route(MqttBroker *broker, MqttBrokerConn *from,
+    const char *topic, word16 topic_name_len, word32 var_len, byte *payload,
+    word32 payload_len, MqttQoS qos, byte retain)
+{
+    MqttBrokerConn *conn;
+    word16 i;
+    int s, rc;
+    int best;
+    MqttQoS sub_qos;
+
+    for (i = 0; i < broker->max_conns; i++) {
+        conn = &broker->conns[i];
+        if (conn->state != MQTT_BROKER_CONN_ACTIVE) {
+            continue;
+        }
+        best = -1;
+        for (s = 0; s < MQTT_BROKER_MAX_SUBS; s++) {
+            MqttBrokerSub *sub = &conn->subs[s];
+            if (sub->filter == NULL ||
+                    ((sub->options & MQTT_BROKER_SUB_NO_LOCAL) &&
+                        conn == from) ||
+                    !MqttBroker_TopicMatch(sub->filter, topic,
+                        topic_name_len)) {
+                continue;
+            }
+            if (best < 0 || (sub->options & MQTT_BROKER_SUB_QOS_MASK) >
+                    (best & MQTT_BROKER_SUB_QOS_MASK)) {
+                best = sub->options;
+            }
+        }
+        if (best < 0) {
+            continue;
+        }
+        sub_qos = (MqttQoS)(best & MQTT_BROKER_SUB_QOS_MASK);
+        rc = MqttBroker_SendPublish(broker, conn, broker->var_buf,
+            MQTT_DATA_LEN_SIZE + topic_name_len, var_len, payload,
+            payload_len, (sub_qos < qos) ? sub_qos : qos,
+            (best & MQTT_BROKER_SUB_RETAIN_AS_PUB) ? retain : 0);
+        if (rc == MQTT_CODE_SUCCESS) {
+            broker->stats.publish_out++;
+        }
+        else {
+            broker->stats.dropped++;
+            if (rc != MQTT_CODE_ERROR_SERVER_PROP) {
+                /* Closed by its own task, which may be reading */
+                conn->state = MQTT_BROKER_CONN_CLOSING;
+            }
+        }
+    }
+}
+
+/* Stores, replaces or (with no payload) removes the retained message of
+   the topic in var_buf */
+static void MqttBroker_Retain(MqttBroker *broker, word32 topic_len,
+    word32 var_len, const byte *payload, word32 payload_len, MqttQoS qos)
+{
+    MqttBrokerRetained *ret = NULL;
+    byte *buf = NULL;
+    word16 i;
+
+    for (i = 0; i < broker->retained_count; i++) {
+        if (broker->retained[i].topic_len == topic_len &&
+                XMEMCMP(broker->retained[i].buf, broker->var_buf,
+                    topic_len) == 0) {
+            ret = &broker->retained[i];
+            break;
+        }
+    }
+    if (payload_len > 0) {
+        buf = (byte*)WOLFMQTT_MALLOC(var_len + payload_len);
+        if (buf == NULL) {
+            return;
+        }
+        XMEMCPY(buf, broker->var_buf, var_len);
+        XMEMCPY(&buf[var_len], payload, payload_len);
+    }
+    if (ret != NULL) {
+        WOLFMQTT_FREE(ret->buf);
+        if (buf == NULL) {
+            /* Move the last one here */
+            *ret = broker->retained[--broker->retained_count];
+            return;
+        }
+    }
+    else if (buf == NULL) {
+        return;
+    }
+    else if (broker->retained_count < MQTT_BROKER_MAX_RETAINED) {
+        ret = &broker->retained[broker->retained_count++];
+    }
+    else {
+        WOLFMQTT_FREE(buf);
+        return;
+    }
+    ret->buf = buf;
+    ret->var_len = var_len;
+    ret->payload_len = payload_len;
+    ret->topic_len = (word16)topic_len;
+    ret->qos = qos;
+}
+
+static int MqttBroker_SendConnAck(MqttBrokerConn *conn, byte level,
+    byte return_code, const char *assigned_id)
+{
+    MqttConnectAck ack;
+    int len;
+#ifdef WOLFMQTT_V5
+    MqttProp props[4];
+    int count = 0;
+#endif
+
+    XMEMSET(&ack, 0, sizeof(ack));
+    ack.return_code = return_code;
+#ifdef WOLFMQTT_V5
+    ack.protocol_level = level;
+    if (level >= MQTT_CONNECT_PROTOCOL_LEVEL_5 &&
+            return_code == MQTT_REASON_SUCCESS) {
+        /* Limits of the broker, as a list built on the stack */
+        XMEMSET(props, 0, sizeof(props));
+        props[count].type = MQTT_PROP_MAX_PACKET_SZ;
+        props[count++].data_int = (word32)conn->client.rx_buf_len;
+        props[count].type = MQTT_PROP_SUBSCRIPTION_ID_AVAIL;
+        props[count++].data_byte = 0;
+        props[count].type = MQTT_PROP_SHARED_SUBSCRIPTION_AVAIL;
+        props[count++].data_byte = 0;
+        if (assigned_id != NULL) {
+            props[count].type = MQTT_PROP_ASSIGNED_CLIENT_ID;
+            props[count].data_str.str = (char*)assigned_id;
+            props[count++].data_str.len = (word16)XSTRLEN(assigned_id);
+        }
+        for (len = 0; len < count - 1; len++) {
+            props[len].next = &props[len + 1];
+        }
+        ack.props = props;
+    }
+#else
+    (void)level;
+#endif
+    (void)assigned_id;
+
+    len = MqttEncode_ConnectAck(conn->client.tx_buf, conn->client.tx_buf_len,
+        &ack);
+    if (len < 0) {
+        return len;
+    }
+    return MqttBroker_Write(conn, conn->client.tx_buf, len);
+}
+
+static int MqttBroker_HandleConnect(MqttBroker *broker, MqttBrokerConn *conn,
+    int len)
+{
+    MqttConnect connect;
+    const char *assigned_id = NULL;
+    word32 id_len;
+    word16 i;
+    int rc;
+    byte level, refuse = 0;
+
+    XMEMSET(&connect, 0, sizeof(connect));
+    rc = MqttDecode_Connect(conn->client.rx_buf, len, &connect);
+    if (rc < 0) {
+        return rc;
+    }
+    level = connect.protocol_level;
+
+    if (level != MQTT_CONNECT_PROTOCOL_LEVEL_4
+    #ifdef WOLFMQTT_V5
+            && level != MQTT_CONNECT_PROTOCOL_LEVEL_5
+    #endif
+            ) {
+        /* Refused with a v3.1.1 CONNACK */
+        (void)MqttBroker_SendConnAck(conn, MQTT_CONNECT_PROTOCOL_LEVEL_4,
+            MQTT_CONNECT_ACK_CODE_REFUSED_PROTO, NULL);
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+
+    id_len = (word32)XSTRLEN(connect.client_id);
+    if (id_len > MQTT_BROKER_CLIENTID_MAX_LEN ||
+            (id_len == 0 && !connect.clean_session &&
+                level == MQTT_CONNECT_PROTOCOL_LEVEL_4)) {
+        refuse = 1;
+    }
+    if (refuse) {
+        (void)MqttBroker_SendConnAck(conn, level,
+        #ifdef WOLFMQTT_V5
+            (level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) ?
+                MQTT_REASON_CLIENT_ID_NOT_VALID :
+        #endif
+                MQTT_CONNECT_ACK_CODE_REFUSED_ID, NULL);
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+
+    if (id_len == 0) {
+        (void)XSNPRINTF(conn->client_id, sizeof(conn->client_id), "%s%lu",
+            MQTT_BROKER_ID_PREFIX, (unsigned long)++broker->next_id);
+        assigned_id = conn->client_id;
+    }
+    else {
+        XMEMCPY(conn->client_id, connect.client_id, id_len + 1);
+        /* Take over the session of another connection with the same ID */
+        for (i = 0; i < broker->max_conns; i++) {
+            MqttBrokerConn *other = &broker->conns[i];
+            if (other != conn &&
+                    other->state == MQTT_BROKER_CONN_ACTIVE &&
+                    XSTRNCMP(other->client_id, conn->client_id,
+                        sizeof(conn->client_id)) == 0) {
+                other->state = MQTT_BROKER_CONN_CLOSING;
+            }
+        }
+    }
+
+    conn->protocol_level = level;
+#ifdef WOLFMQTT_V5
+    conn->client.protocol_level = level;
+    conn->client.packet_sz_max = 0;
+    if (connect.props_view.len > 0) {
+        MqttProp prop;
+        /* Largest packet the client accepts */
+        if (MqttProps_ViewFind(&connect.props_view, MQTT_PROP_MAX_PACKET_SZ,
+                &prop) > 0) {
+            conn->client.packet_sz_max = prop.data_int;
+        }
+    }
+#endif
+
+    rc = MqttBroker_SendConnAck(conn, level, MQTT_CONNECT_ACK_CODE_ACCEPTED,
+        assigned_id);
+    if (rc == MQTT_CODE_SUCCESS) {
+        conn->state = MQTT_BROKER_CONN_ACTIVE;
+        broker->stats.connects++;
+    }
+    return rc;
+}
+
+static int MqttBroker_SendResp(MqttBrokerConn *conn, byte type,
+    word16 packet_id)
+{
+    MqttPublishResp resp;
+    int len;
+
+    XMEMSET(&resp, 0, sizeof(resp));
+    resp.packet_id = packet_id;
+#ifdef WOLFMQTT_V5
+    resp.protocol_level = conn->protocol_level;
+#endif
+    len = MqttEncode_PublishResp(conn->client.tx_buf,
+        conn->client.tx_buf_len, type, &resp);
+    if (len < 0) {
+        return len;
+    }
+    return MqttBroker_Write(conn, conn->client.tx_buf, len);
+}
+
+/* Returns the slot of a QoS 2 packet ID received and not released, or
+   MQTT_BROKER_MAX_QOS2 */
+static int MqttBroker_Qos2Find(MqttBrokerConn *conn, word16 packet_id)
+{
+    int i;
+
+    for (i = 0; i < MQTT_BROKER_MAX_QOS2; i++) {
+        if (conn->qos2_ids[i] == packet_id) {
+            break;
+        }
+    }
+    return i;
+}
+
+static int MqttBroker_HandlePublish(MqttBroker *broker, MqttBrokerConn *conn,
+    int len)
+{
+    MqttPublish publish;
+    word32 topic_len, var_len, props_len = 0;
+    byte *props = NULL;
+    int rc, slot;
+
+    XMEMSET(&publish, 0, sizeof(publish));
+#ifdef WOLFMQTT_V5
+    publish.protocol_level = conn->protocol_level;
+#endif
+    rc = MqttDecode_Publish(conn->client.rx_buf, len, &publish);
+    if (rc < 0) {
+        return rc;
+    }
+    /* Topic aliases are not supported (the CONNACK allows none) */
+    if (publish.qos == MQTT_QOS_3 ||
+            !MqttBroker_TopicValid(publish.topic_name,
+                publish.topic_name_len)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    broker->stats.publish_in++;
+
+    if (publish.qos == MQTT_QOS_2) {
+        slot = MqttBroker_Qos2Find(conn, publish.packet_id);
+        if (slot < MQTT_BROKER_MAX_QOS2) {
+            /* Sent again before PUBREL, already delivered */
+            return MqttBroker_SendResp(conn, MQTT_PACKET_TYPE_PUBLISH_REC,
+                publish.packet_id);
+        }
+        slot = MqttBroker_Qos2Find(conn, 0);
+        if (slot < MQTT_BROKER_MAX_QOS2) {
+            conn->qos2_ids[slot] = publish.packet_id;
+        }
+    }
+
+    /* Encoded topic name as received, then the properties (none for a
+       v3.1.1 publisher) */
+    topic_len = MQTT_DATA_LEN_SIZE + publish.topic_name_len;
+    XMEMCPY(broker->var_buf, publish.topic_name - MQTT_DATA_LEN_SIZE,
+        topic_len);
+#ifdef WOLFMQTT_V5
+    if (publish.props_view.len > 0) {
+        props = publish.props_view.buf;
+        props_len = publish.props_view.len;
+    }
+#endif
+    var_len = topic_len + (word32)MqttEncode_Vbi(&broker->var_buf[topic_len],
+        props_len);
+    if (props_len > 0) {
+        XMEMCPY(&broker->var_buf[var_len], props, props_len);
+        var_len += props_len;
+    }
+
+    if (publish.retain) {
+        MqttBroker_Retain(broker, topic_len, var_len, publish.buffer,
+            publish.total_len, publish.qos);
+    }
+    MqttBroker_Route(broker, conn, publish.topic_name,
+        publish.topic_name_len, var_len, publish.buffer, publish.total_len,
+        publish.qos, publish.retain);
+
+    if (publish.qos == MQTT_QOS_1) {
+        return MqttBroker_SendResp(conn, MQTT_PACKET_TYPE_PUBLISH_ACK,
+            publish.packet_id);
+    }
+    if (publish.qos == MQTT_QOS_2) {
+        return MqttBroker_SendResp(conn, MQTT_PACKET_TYPE_PUBLISH_REC,
+            publish.packet_id);
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int MqttBroker_HandleResp(MqttBrokerConn *conn, byte type, int len)
+{
+    MqttPublishResp resp;
+    int rc, slot;
+
+    XMEMSET(&resp, 0, sizeof(resp));
+#ifdef WOLFMQTT_V5
+    resp.protocol_level = conn->protocol_level;
+#endif
+    rc = MqttDecode_PublishResp(conn->client.rx_buf, len, type, &resp);
+    if (rc < 0) {
+        return rc;
+    }
+    switch (type) {
+        case MQTT_PACKET_TYPE_PUBLISH_REC:
+            /* Subscriber received a QoS 2 publish */
+            return MqttBroker_SendResp(conn, MQTT_PACKET_TYPE_PUBLISH_REL,
+                resp.packet_id);
+        case MQTT_PACKET_TYPE_PUBLISH_REL:
+            /* Publisher releases a QoS 2 publish */
+            slot = MqttBroker_Qos2Find(conn, resp.packet_id);
+            if (slot < MQTT_BROKER_MAX_QOS2) {
+                conn->qos2_ids[slot] = 0;
+            }
+            return MqttBroker_SendResp(conn, MQTT_PACKET_TYPE_PUBLISH_COMP,
+                resp.packet_id);
+        default:
+            /* PUBACK and PUBCOMP end a publish sent to a subscriber */
+            break;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Returns the slot of a subscription, or MQTT_BROKER_MAX_SUBS */
+static int MqttBroker_FindSub(MqttBrokerConn *conn, const char *filter)
+{
+    int i;
+
+    for (i = 0; i < MQTT_BROKER_MAX_SUBS; i++) {
+        if (conn->subs[i].filter != NULL &&
+                XSTRLEN(conn->subs[i].filter) == XSTRLEN(filter) &&
+                XSTRNCMP(conn->subs[i].filter, filter,
+                    XSTRLEN(filter)) == 0) {
+            break;
+        }
+    }
+    return i;
+}
+
+/* Sends the retained messages matching a new subscription */
+static void MqttBroker_SendRetained(MqttBroker *broker, MqttBrokerConn *conn,
+    const char *filter, MqttQoS qos)
+{
+    MqttBrokerRetained *ret;
+    word16 i;
+    int rc;
+
+    for (i = 0; i < broker->retained_count; i++) {
+        ret = &broker->retained[i];
+        if (!MqttBroker_TopicMatch(filter,
+                (const char*)&ret->buf[MQTT_DATA_LEN_SIZE],
+                (word16)(ret->topic_len - MQTT_DATA_LEN_SIZE))) {
+            continue;
+        }
+        rc = MqttBroker_SendPublish(broker, conn, ret->buf, ret->topic_len,
+            ret->var_len, &ret->buf[ret->var_len], ret->payload_len,
+            (ret->qos < qos) ? ret->qos : qos, 1);
+        if (rc == MQTT_CODE_SUCCESS) {
+            broker->stats.publish_out++;
+        }
+        else {
+            broker->stats.dropped++;
+        }
+    }
+}
+
+static int MqttBroker_HandleSubscribe(MqttBroker *broker,
+    MqttBrokerConn *conn, int len)
+{
+    MqttSubscribe subscribe;
+    MqttTopic *topic;
+    byte is_new[MQTT_BROKER_MAX_TOPICS];
+    byte opts, failure, v5 = 0;
+    int i, slot, rc;
+
+    XMEMSET(&subscribe, 0, sizeof(subscribe));
+    subscribe.topics = broker->topics;
+    subscribe.topic_count = MQTT_BROKER_MAX_TOPICS;
+#ifdef WOLFMQTT_V5
+    subscribe.protocol_level = conn->protocol_level;
+    v5 = (conn->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5);
+#endif
+    rc = MqttDecode_Subscribe(conn->client.rx_buf, len, &subscribe);
+    if (rc < 0) {
+        return rc;
+    }
+
+    for (i = 0; i < subscribe.topic_count; i++) {
+        topic = &subscribe.topics[i];
+        opts = (byte)topic->qos;
+        is_new[i] = 0;
+
+        /* Options other than the QoS are v5 only */
+        if ((opts & MQTT_BROKER_SUB_QOS_MASK) == MQTT_QOS_3 ||
+                (opts & (v5 ? MQTT_BROKER_SUB_RESERVED :
+                    (byte)~MQTT_BROKER_SUB_QOS_MASK)) != 0 ||
+                (opts & MQTT_BROKER_SUB_RETAIN_HANDLING) ==
+                    MQTT_BROKER_SUB_RETAIN_HANDLING) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+        }
+
+        failure = 0;
+        if (!MqttBroker_FilterValid(topic->topic_filter)) {
+        #ifdef WOLFMQTT_V5
+            failure = MQTT_REASON_TOPIC_FILTER_INVALID;
+        #endif
+        }
+        else if (XSTRNCMP(topic->topic_filter, "$share/", 7) == 0) {
+        #ifdef WOLFMQTT_V5
+            failure = MQTT_REASON_SS_NOT_SUPPORTED;
+        #endif
+        }
+        else {
+            slot = MqttBroker_FindSub(conn, topic->topic_filter);
+            if (slot == MQTT_BROKER_MAX_SUBS) {
+                is_new[i] = 1;
+                for (slot = 0; slot < MQTT_BROKER_MAX_SUBS; slot++) {
+                    if (conn->subs[slot].filter == NULL) {
+                        break;
+                    }
+                }
+            }
+            if (slot < MQTT_BROKER_MAX_SUBS && is_new[i]) {
+                word32 flen = (word32)XSTRLEN(topic->topic_filter);
+                conn->subs[slot].filter = (char*)WOLFMQTT_MALLOC(flen + 1);
+                if (conn->subs[slot].filter != NULL) {
+                    XMEMCPY(conn->subs[slot].filter, topic->topic_filter,
+                        flen + 1);
+                }
+                else {
+                    slot = MQTT_BROKER_MAX_SUBS;
+                }
+            }
+            if (slot < MQTT_BROKER_MAX_SUBS) {
+                conn->subs[slot].options = opts;
+                topic->return_code = opts & MQTT_BROKER_SUB_QOS_MASK;
+                continue;
+            }
+        #ifdef WOLFMQTT_V5
+            failure = MQTT_REASON_QUOTA_EXCEEDED;
+        #endif
+        }
+        topic->return_code = v5 ? failure :
+            (byte)MQTT_SUBSCRIBE_ACK_CODE_FAILURE;
+        (void)failure;
+    }
+
+    len = MqttEncode_SubscribeAck(conn->client.tx_buf,
+        conn->client.tx_buf_len, &subscribe);
+    if (len < 0) {
+        return len;
+    }
+    rc = MqttBroker_Write(conn, conn->client.tx_buf, len);
+
+    /* Retained messages of the accepted filters, after the SUBACK */
+    for (i = 0; i < subscribe.topic_count && rc == MQTT_CODE_SUCCESS; i++) {
+        topic = &subscribe.topics[i];
+        opts = (byte)topic->qos;
+        if (topic->return_code > MQTT_QOS_2 ||
+                ((opts & MQTT_BROKER_SUB_RETAIN_HANDLING) >> 4) > is_new[i]) {
+            continue;
+        }
+        MqttBroker_SendRetained(broker, conn, topic->topic_filter,
+            (MqttQoS)topic->return_code);
+    }
+    return rc;
+}
+
+static int MqttBroker_HandleUnsubscribe(MqttBroker *broker,
+    MqttBrokerConn *conn, int len)
+{
+    MqttUnsubscribe unsubscribe;
+    MqttTopic *topic;
+    int i, slot, rc;
+
+    XMEMSET(&unsubscribe, 0, sizeof(unsubscribe));
+    unsubscribe.topics = broker->topics;
+    unsubscribe.topic_count = MQTT_BROKER_MAX_TOPICS;
+#ifdef WOLFMQTT_V5
+    unsubscribe.protocol_level = conn->protocol_level;
+#endif
+    rc = MqttDecode_Unsubscribe(conn->client.rx_buf, len, &unsubscribe);
+    if (rc < 0) {
+        return rc;
+    }
+
+    for (i = 0; i < unsubscribe.topic_count; i++) {
+        topic = &unsubscribe.topics[i];
+        slot = MqttBroker_FindSub(conn, topic->topic_filter);
+        if (slot < MQTT_BROKER_MAX_SUBS) {
+            WOLFMQTT_FREE(conn->subs[slot].filter);
+            conn->subs[slot].filter = NULL;
+        }
+    #ifdef WOLFMQTT_V5
+        else {
+            topic->return_code = MQTT_REASON_NO_SUB_EXIST;
+        }
+    #endif
+    }
+
+    len = MqttEncode_UnsubscribeAck(conn->client.tx_buf,
+        conn->client.tx_buf_len, &unsubscribe);
+    if (len < 0) {
+        return len;
+    }
+    return MqttBroker_Write(conn, conn->client.tx_buf, len);
+}
+
+/* Handles a packet read into rx_buf. A negative return closes the
+   connection. */
+static int MqttBroker_HandlePacket(MqttBroker *broker, MqttBrokerConn *conn,
+    int len)
+{
+    byte type = MQTT_PACKET_TYPE_GET(conn->client.rx_buf[0]);
+    int rc;
+
+    if ((conn->state == MQTT_BROKER_CONN_NEW) !=
+            (type == MQTT_PACKET_TYPE_CONNECT)) {
+        /* CONNECT must be the first packet, and only the first */
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_TYPE);
+    }
+
+    switch ((int)type) {
+        case MQTT_PACKET_TYPE_CONNECT:
+            rc = MqttBroker_HandleConnect(broker, conn, len);
+            break;
+        case MQTT_PACKET_TYPE_PUBLISH:
+            rc = MqttBroker_HandlePublish(broker, conn, len);
+            break;
+        case MQTT_PACKET_TYPE_PUBLISH_ACK:
+        case MQTT_PACKET_TYPE_PUBLISH_REC:
+        case MQTT_PACKET_TYPE_PUBLISH_REL:
+        case MQTT_PACKET_TYPE_PUBLISH_COMP:
+            rc = MqttBroker_HandleResp(conn, type, len);
+            break;
+        case MQTT_PACKET_TYPE_SUBSCRIBE:
+            rc = MqttBroker_HandleSubscribe(broker, conn, len);
+            break;
+        case MQTT_PACKET_TYPE_UNSUBSCRIBE:
+            rc = MqttBroker_HandleUnsubscribe(broker, conn, len);
+            break;
+        case MQTT_PACKET_TYPE_PING_REQ:
+            rc = MqttEncode_PingResp(conn->client.tx_buf,
+                conn->client.tx_buf_len);
+            if (rc > 0) {
+                rc = MqttBroker_Write(conn, conn->client.tx_buf, rc);
+            }
+            break;
+        case MQTT_PACKET_TYPE_DISCONNECT:
+            /* Connection ends */
+            rc = MQTT_CODE_ERROR_NETWORK;
+            break;
+        default:
+            /* AUTH and reserved types */
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_TYPE);
+            break;
+    }
+    return rc;
+}
+
+
+/* Public Functions */
+
+int MqttBroker_Init(MqttBroker *broker, word16 max_conns, int buf_len,
+    int cmd_timeout_ms)
+{
+    if (broker == NULL || max_conns == 0 ||
+            buf_len < MQTT_PACKET_MAX_LEN_BYTES + 1) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(broker, 0, sizeof(MqttBroker));
+    broker->conns = (MqttBrokerConn*)WOLFMQTT_MALLOC(
+        sizeof(MqttBrokerConn) * max_conns);
+    broker->bufs = (byte*)WOLFMQTT_MALLOC((size_t)buf_len * 2 * max_conns);
+    broker->var_buf = (byte*)WOLFMQTT_MALLOC(buf_len);
+    if (broker->conns == NULL || broker->bufs == NULL ||
+            broker->var_buf == NULL) {
+        MqttBroker_Free(broker);
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    XMEMSET(broker->conns, 0, sizeof(MqttBrokerConn) * max_conns);
+    broker->max_conns = max_conns;
+    broker->buf_len = buf_len;
+    broker->cmd_timeout_ms = cmd_timeout_ms;
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemInit(&broker->lock) != 0) {
+        MqttBroker_Free(broker);
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+
+    return MQTT_CODE_SUCCESS;
+}
+
+int MqttBroker_Add(MqttBroker *broker, MqttNet *net)
+{
+    MqttBrokerConn *conn = NULL;
+    byte *bufs;
+    int rc, idx;
+
+    if (broker == NULL || broker->conns == NULL || net == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = MqttBroker_Lock(broker);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    for (idx = 0; idx < broker->max_conns; idx++) {
+        if (broker->conns[idx].state == MQTT_BROKER_CONN_FREE) {
+            conn = &broker->conns[idx];
+            break;
+        }
+    }
+    if (conn == NULL) {
+        rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    else {
+        XMEMSET(conn, 0, sizeof(MqttBrokerConn));
+        bufs = &broker->bufs[(size_t)broker->buf_len * 2 * idx];
+        rc = MqttClient_Init(&conn->client, net, NULL, bufs,
+            broker->buf_len, &bufs[broker->buf_len], broker->buf_len,
+            broker->cmd_timeout_ms);
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        conn->state = MQTT_BROKER_CONN_NEW;
+        broker->count++;
+        rc = idx;
+    }
+
+    MqttBroker_Unlock(broker);
+    return rc;
+}
+
+int MqttBroker_ConnTask(MqttBroker *broker, int idx, int timeout_ms)
+{
+    MqttBrokerConn *conn;
+    int rc;
+
+    if (broker == NULL || broker->conns == NULL || idx < 0 ||
+            idx >= broker->max_conns ||
+            broker->conns[idx].state == MQTT_BROKER_CONN_FREE) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    conn = &broker->conns[idx];
+
+    if (conn->state == MQTT_BROKER_CONN_CLOSING) {
+        rc = MQTT_CODE_ERROR_NETWORK;
+    }
+    else {
+        /* Only this task reads the connection */
+        rc = MqttPacket_Read(&conn->client, conn->client.rx_buf,
+            conn->client.rx_buf_len, timeout_ms);
+        if (rc == MQTT_CODE_ERROR_TIMEOUT || rc == MQTT_CODE_CONTINUE) {
+            return rc;
+        }
+        if (rc == 0) {
+            /* Peer closed */
+            rc = MQTT_CODE_ERROR_NETWORK;
+        }
+        else if (rc > 0 && conn->client.packet.header_len +
+                conn->client.packet.remain_len > rc) {
+            /* Read truncated to the buffer */
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+        }
+    }
+
+    if (MqttBroker_Lock(broker) != MQTT_CODE_SUCCESS) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+    if (rc > 0) {
+        rc = MqttBroker_HandlePacket(broker, conn, rc);
+    }
+    if (rc < 0) {
+    #ifdef WOLFMQTT_V5
+        if (rc == MQTT_CODE_ERROR_OUT_OF_BUFFER &&
+                conn->state == MQTT_BROKER_CONN_ACTIVE &&
+                conn->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+            MqttDisconnect disc;
+            int len;
+
+            XMEMSET(&disc, 0, sizeof(disc));
+            disc.reason_code = MQTT_REASON_PACKET_TOO_LARGE;
+            disc.protocol_level = conn->protocol_level;
+            len = MqttEncode_Disconnect(conn->client.tx_buf,
+                conn->client.tx_buf_len, &disc);
+            if (len > 0) {
+                (void)MqttBroker_Write(conn, conn->client.tx_buf, len);
+            }
+        }
+    #endif
+        MqttBroker_CloseConn(broker, conn);
+    }
+    MqttBroker_Unlock(broker);
+
+    return rc;
+}
+
+int MqttBroker_Task(MqttBroker *broker, int timeout_ms)
+{
+    int idx, rc, count = 0;
+
+    if (broker == NULL || broker->conns == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    for (idx = 0; idx < broker->max_conns; idx++) {
+        if (broker->conns[idx].state == MQTT_BROKER_CONN_FREE) {
+            continue;
+        }
+        rc = MqttBroker_ConnTask(broker, idx, timeout_ms);
+        if (rc == MQTT_CODE_SUCCESS) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int MqttBroker_Close(MqttBroker *broker, int idx)
+{
+    int rc;
+
+    if (broker == NULL || broker->conns == NULL || idx < 0 ||
+            idx >= broker->max_conns) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = MqttBroker_Lock(broker);
+    if (rc == MQTT_CODE_SUCCESS) {
+        MqttBroker_CloseConn(broker, &broker->conns[idx]);
+        MqttBroker_Unlock(broker);
+    }
+    return rc;
+}
+
+void MqttBroker_Free(MqttBroker *broker)
+{
+    word16 i;
+
+    if (broker == NULL) {
+        return;
+    }
+    if (broker->conns != NULL) {
+        for (i = 0; i < broker->max_conns; i++) {
+            MqttBroker_CloseConn(broker, &broker->conns[i]);
+        }
+        WOLFMQTT_FREE(broker->conns);
+    }
+    for (i = 0; i < broker->retained_count; i++) {
+        WOLFMQTT_FREE(broker->retained[i].buf);
+    }
+    if (broker->bufs != NULL) {
+        WOLFMQTT_FREE(broker->bufs);
+    }
+    if (broker->var_buf != NULL) {
+        WOLFMQTT_FREE(broker->var_buf);
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    if (broker->max_conns > 0) {
+        (void)wm_SemFree(&broker->lock);
+    }
+#endif
+    XMEMSET(broker, 0, sizeof(MqttBroker));
+}
+
+#endif /* WOLFMQTT_BROKER */
@@ -39,6 +39,10 @@
  *
  * WOLFMQTT_V5: Enables MQTT v5.0 support
  *
+ * WOLFMQTT_LAZY_PROPS: Received publish properties are not decoded into a
+ *  list for the message callback by default (see MqttClient_SetLazyProps).
+ *  Use the MqttClient_PropsView functions to read them from the rx buffer.
+ *
  * WOLFMQTT_ALLOW_NODATA_UNLOCK: Used with multi-threading and non-blocking to
  *   allow unlock if no data was sent/received. Note the TLS stack typically
  *   requires an attempt to write to continue with same write, not different.
@@ -48,6 +52,13 @@
  * WOLFMQTT_USER_THREADING: Allows custom mutex functions to be defined by the
  *  user. Example: wm_SemInit
  *
+ * WOLFMQTT_DISPATCH: Enables MqttClient_SetDispatch, which queues incoming
+ *  publish messages to a pool of worker threads (see mqtt_dispatch.h).
+ *  Requires WOLFMQTT_MULTITHREAD.
+ *
+ * WOLFMQTT_MSG_POOL: Enables MqttClient_SetMsgPool, which reads incoming
+ *  packets into pooled buffers that can be retained (see mqtt_msgpool.h).
+ *
  * WOLFMQTT_DEBUG_CLIENT: Enables verbose PRINTF for the client code.
  */
 
@@ -505,36 +516,168 @@ int MqttClient_RespList_Find(MqttClient *client,
 #endif /* WOLFMQTT_MULTITHREAD */
 
 #ifdef WOLFMQTT_V5
-static int Handle_Props(MqttClient* client, MqttProp* props, byte use_cb,
-                        byte free_props)
+static int Handle_Props(MqttClient* client, MqttProp** props,
+                        MqttPropView* view, byte use_cb, byte free_props)
 {
     int rc = MQTT_CODE_SUCCESS;
+    byte build = 0;
+
+    /* Properties are located in the rx buffer by the packet decode */
+    if (view->len > 0) {
+    #ifdef WOLFMQTT_PROPERTY_CB
+        if ((use_cb == 1) && (client->property_cb != NULL)) {
+            build = 1;
+        }
+    #else
+        (void)use_cb;
+    #endif
+        /* Properties not freed here (publish) are kept for the message
+           callback, unless the application uses the property view */
+        if (!free_props && !client->lazy_props) {
+            build = 1;
+        }
+
+        /* Only allocate a property list if something will use it */
+        if (build) {
+            rc = MqttDecode_Props((MqttPacketType)view->packet,
+                    &client->prop_arena, props, view->buf, view->len,
+                    view->len);
+        }
+        else {
+            rc = MqttProps_ViewValidate(view);
+        }
+        if (rc < 0) {
+            return rc;
+        }
+        rc = MQTT_CODE_SUCCESS;
+    }
 
-    /* If no properties, just return */
-    if (props != NULL) {
+    if (*props != NULL) {
     #ifdef WOLFMQTT_PROPERTY_CB
         /* Check for properties set by the server */
         if ((use_cb == 1) && (client->property_cb != NULL)) {
             /* capture error if returned */
-            int rc_err = client->property_cb(client, props,
+            int rc_err = client->property_cb(client, *props,
                     client->property_ctx);
             if (rc_err < 0) {
                 rc = rc_err;
             }
         }
-    #else
-        (void)client;
-        (void)use_cb;
     #endif
         if (free_props) {
             /* Free the properties */
-            MqttProps_Free(props);
+            MqttProps_ArenaFree(&client->prop_arena, *props);
+            *props = NULL;
         }
     }
     return rc;
 }
 #endif
 
+#ifdef WOLFMQTT_TOPIC_ALIAS
+/* Captures the broker Topic Alias Maximum and clears the outbound aliases,
+   which do not carry over to a new connection */
+static void MqttClient_TopicAliasConnAck(MqttClient* client,
+                                         MqttConnectAck* connect_ack)
+{
+    MqttPropView view = connect_ack->props_view;
+    MqttProp prop;
+
+    client->topic_alias_max = 0;
+    view.pos = 0;
+    if (connect_ack->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5 &&
+        MqttProps_ViewFind(&view, MQTT_PROP_TOPIC_ALIAS_MAX, &prop) > 0) {
+        client->topic_alias_max = prop.data_short;
+    }
+    if (client->alias_out != NULL) {
+        MqttTopicAliasOut_Reset(client->alias_out, client->topic_alias_max);
+    }
+}
+
+/* Adds a topic alias property to the publish and, if the broker already
+   has the alias, sends an empty topic. Returns the alias assigned or zero.
+   The caller restores the topic and properties once encoded. */
+static word16 MqttClient_TopicAliasApply(MqttClient* client,
+    MqttPublish* publish, MqttProp* alias_prop)
+{
+    MqttProp* prop;
+    word16 alias;
+    byte known = 0;
+
+    if (client->alias_out == NULL || publish->tmpl != NULL ||
+        publish->protocol_level < MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        return 0;
+    }
+    /* Alias set by the application */
+    for (prop = publish->props; prop != NULL; prop = prop->next) {
+        if (prop->type == MQTT_PROP_TOPIC_ALIAS) {
+            return 0;
+        }
+    }
+
+    alias = MqttTopicAliasOut_Get(client->alias_out, publish->topic_name,
+        &known);
+    if (alias == 0) {
+        return 0;
+    }
+    XMEMSET(alias_prop, 0, sizeof(MqttProp));
+    alias_prop->type = MQTT_PROP_TOPIC_ALIAS;
+    alias_prop->data_short = alias;
+    alias_prop->next = publish->props;
+    publish->props = alias_prop;
+    if (known) {
+        publish->topic_name = "";
+    }
+    return alias;
+}
+
+/* Clears the inbound aliases for the new connection. A Topic Alias Maximum
+   in the connect properties limits the table, otherwise one is added for
+   the table size. Returns 1 if the property was added, which the caller
+   removes once encoded. */
+static byte MqttClient_TopicAliasConnect(MqttClient* client,
+    MqttConnect* mc_connect, MqttProp* alias_max_prop)
+{
+    MqttProp* prop;
+
+    if (client->alias_in == NULL ||
+        mc_connect->protocol_level < MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        return 0;
+    }
+    for (prop = mc_connect->props; prop != NULL; prop = prop->next) {
+        if (prop->type == MQTT_PROP_TOPIC_ALIAS_MAX) {
+            MqttTopicAliasIn_Reset(client->alias_in, prop->data_short);
+            return 0;
+        }
+    }
+
+    MqttTopicAliasIn_Reset(client->alias_in, client->alias_in->capacity);
+    XMEMSET(alias_max_prop, 0, sizeof(MqttProp));
+    alias_max_prop->type = MQTT_PROP_TOPIC_ALIAS_MAX;
+    alias_max_prop->data_short = client->alias_in->capacity;
+    alias_max_prop->next = mc_connect->props;
+    mc_connect->props = alias_max_prop;
+    return 1;
+}
+
+/* Sets the topic of a received publish that uses a topic alias */
+static int MqttClient_TopicAliasResolve(MqttClient* client,
+    MqttPublish* publish)
+{
+    MqttPropView view = publish->props_view;
+    MqttProp prop;
+
+    view.pos = 0;
+    if (publish->protocol_level < MQTT_CONNECT_PROTOCOL_LEVEL_5 ||
+        view.len == 0 ||
+        MqttProps_ViewFind(&view, MQTT_PROP_TOPIC_ALIAS, &prop) <= 0) {
+        return MQTT_CODE_SUCCESS;
+    }
+    return MqttTopicAliasIn_Resolve(client->alias_in, prop.data_short,
+        &publish->topic_name, &publish->topic_name_len);
+}
+#endif
+
 
 /* Returns length decoded or error (as negative) */
 /*! \brief      Take a received MQTT packet and try and decode it
@@ -592,9 +735,15 @@ static int MqttClient_DecodePacket(MqttClient* client, byte* rx_buf,
             p_connect_ack->protocol_level = client->protocol_level;
         #endif
             rc = MqttDecode_ConnectAck(rx_buf, rx_len, p_connect_ack);
+        #ifdef WOLFMQTT_TOPIC_ALIAS
+            if (rc >= 0) {
+                MqttClient_TopicAliasConnAck(client, p_connect_ack);
+            }
+        #endif
         #ifdef WOLFMQTT_V5
             if (rc >= 0 && doProps) {
-                int tmp = Handle_Props(client, p_connect_ack->props,
+                int tmp = Handle_Props(client, &p_connect_ack->props,
+                                       &p_connect_ack->props_view,
                                        (packet_obj != NULL), 1);
                 p_connect_ack->props = NULL;
                 if (tmp != MQTT_CODE_SUCCESS) {
@@ -621,13 +770,22 @@ static int MqttClient_DecodePacket(MqttClient* client, byte* rx_buf,
                 XMEMSET(p_publish, 0, sizeof(MqttPublish));
             }
             rc = MqttDecode_Publish(rx_buf, rx_len, p_publish);
+        #ifdef WOLFMQTT_TOPIC_ALIAS
+            if (rc >= 0 && client->alias_in != NULL) {
+                int tmp = MqttClient_TopicAliasResolve(client, p_publish);
+                if (tmp != MQTT_CODE_SUCCESS) {
+                    rc = tmp;
+                }
+            }
+        #endif
             if (rc >= 0) {
                 packet_id = p_publish->packet_id;
             #ifdef WOLFMQTT_V5
                 if (doProps) {
                     /* Do not free property list here. It will be freed
                        after the message callback. */
-                    int tmp = Handle_Props(client, p_publish->props,
+                    int tmp = Handle_Props(client, &p_publish->props,
+                                           &p_publish->props_view,
                                            (packet_obj != NULL), 0);
                     if (tmp != MQTT_CODE_SUCCESS) {
                         rc = tmp;
@@ -659,7 +817,8 @@ static int MqttClient_DecodePacket(MqttClient* client, byte* rx_buf,
                 packet_id = p_publish_resp->packet_id;
             #ifdef WOLFMQTT_V5
                 if (doProps) {
-                    int tmp = Handle_Props(client, p_publish_resp->props,
+                    int tmp = Handle_Props(client, &p_publish_resp->props,
+                                           &p_publish_resp->props_view,
                                            (packet_obj != NULL), 1);
                     p_publish_resp->props = NULL;
                     if (tmp != MQTT_CODE_SUCCESS) {
@@ -687,7 +846,8 @@ static int MqttClient_DecodePacket(MqttClient* client, byte* rx_buf,
                 packet_id = p_subscribe_ack->packet_id;
             #ifdef WOLFMQTT_V5
                 if (doProps) {
-                    int tmp = Handle_Props(client, p_subscribe_ack->props,
+                    int tmp = Handle_Props(client, &p_subscribe_ack->props,
+                                           &p_subscribe_ack->props_view,
                                            (packet_obj != NULL), 1);
                     p_subscribe_ack->props = NULL;
                     if (tmp != MQTT_CODE_SUCCESS) {
@@ -716,7 +876,8 @@ static int MqttClient_DecodePacket(MqttClient* client, byte* rx_buf,
                 packet_id = p_unsubscribe_ack->packet_id;
             #ifdef WOLFMQTT_V5
                 if (doProps) {
-                    int tmp = Handle_Props(client, p_unsubscribe_ack->props,
+                    int tmp = Handle_Props(client, &p_unsubscribe_ack->props,
+                                           &p_unsubscribe_ack->props_view,
                                            (packet_obj != NULL), 1);
                     p_unsubscribe_ack->props = NULL;
                     if (tmp != MQTT_CODE_SUCCESS) {
@@ -751,7 +912,8 @@ static int MqttClient_DecodePacket(MqttClient* client, byte* rx_buf,
             }
             rc = MqttDecode_Auth(rx_buf, rx_len, p_auth);
             if (rc >= 0 && doProps) {
-                int tmp = Handle_Props(client, p_auth->props,
+                int tmp = Handle_Props(client, &p_auth->props,
+                                       &p_auth->props_view,
                                        (packet_obj != NULL), 1);
                 p_auth->props = NULL;
                 if (tmp != MQTT_CODE_SUCCESS) {
@@ -775,7 +937,8 @@ static int MqttClient_DecodePacket(MqttClient* client, byte* rx_buf,
             }
             rc = MqttDecode_Disconnect(rx_buf, rx_len, p_disc);
             if (rc >= 0 && doProps) {
-                int tmp = Handle_Props(client, p_disc->props,
+                int tmp = Handle_Props(client, &p_disc->props,
+                                       &p_disc->props_view,
                                        (packet_obj != NULL), 1);
                 p_disc->props = NULL;
                 if (tmp != MQTT_CODE_SUCCESS) {
@@ -874,7 +1037,7 @@ static int MqttClient_HandlePacket(MqttClient* client,
 
         #ifdef WOLFMQTT_V5
             /* Free the properties */
-            MqttProps_Free(publish->props);
+            MqttProps_ArenaFree(&client->prop_arena, publish->props);
             publish->props = NULL;
         #endif
 
@@ -1164,6 +1327,17 @@ wait_again:
                 return rc;
             }
 
+        #ifdef WOLFMQTT_MSG_POOL
+            /* Previous message was retained, read into the spare buffer */
+            if (client->rx_next != NULL) {
+                MqttMsgBuf* retained = client->rx_msgbuf;
+                client->rx_msgbuf = client->rx_next;
+                client->rx_next = NULL;
+                client->rx_buf = client->rx_msgbuf->data;
+                MqttMsgBuf_Release(retained);
+            }
+        #endif
+
             mms_stat->read = MQTT_MSG_WAIT;
         }
         FALL_THROUGH;
@@ -1548,6 +1722,9 @@ int MqttClient_Init(MqttClient *client, MqttNet* net,
     client->max_qos = MQTT_QOS_2;
     client->retain_avail = 1;
     client->protocol_level = MQTT_CONNECT_PROTOCOL_LEVEL;
+#ifdef WOLFMQTT_LAZY_PROPS
+    client->lazy_props = 1;
+#endif
     rc = MqttProps_Init();
 #endif
 
@@ -1584,6 +1761,9 @@ int MqttClient_Init(MqttClient *client, MqttNet* net,
 void MqttClient_DeInit(MqttClient *client)
 {
     if (client != NULL) {
+#ifdef WOLFMQTT_MSG_POOL
+        (void)MqttClient_SetMsgPool(client, NULL);
+#endif
 #ifdef WOLFMQTT_MULTITHREAD
         (void)wm_SemFree(&client->lockSend);
         (void)wm_SemFree(&client->lockRecv);
@@ -1626,9 +1806,224 @@ int MqttClient_SetPropertyCallback(MqttClient *client, MqttPropertyCb propCb,
 }
 #endif
 
+#ifdef WOLFMQTT_DISPATCH
+int MqttClient_SetDispatch(MqttClient *client, MqttDispatch *disp)
+{
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+#ifdef WOLFMQTT_SUBTRIE
+    /* Trie handlers are not called from the workers */
+    if (disp != NULL && client->subtrie != NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+#endif
+
+    client->dispatch = disp;
+
+    return MQTT_CODE_SUCCESS;
+}
+#endif
+
+#ifdef WOLFMQTT_TOPIC_ALIAS
+int MqttClient_SetTopicAliasOut(MqttClient *client, MqttTopicAliasOut *out)
+{
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+    /* Aliases only apply to the current connection */
+    MqttTopicAliasOut_Reset(out, client->topic_alias_max);
+    client->alias_out = out;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+int MqttClient_SetTopicAliasIn(MqttClient *client, MqttTopicAliasIn *in)
+{
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+    /* No aliases are accepted until advertised in the next connect */
+    MqttTopicAliasIn_Reset(in, 0);
+    client->alias_in = in;
+
+    return MQTT_CODE_SUCCESS;
+}
+#endif
+
+#ifdef WOLFMQTT_SUBTRIE
+int MqttClient_SetSubTrie(MqttClient *client, MqttSubTrie *trie)
+{
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+#ifdef WOLFMQTT_DISPATCH
+    /* Trie handlers are not called from the workers */
+    if (trie != NULL && client->dispatch != NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+#endif
+
+    client->subtrie = trie;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+#ifdef WOLFMQTT_V5
+/* Returns 1 when subscribing assigns a subscription identifier: enabled on
+ * the trie and not set by the application in the properties */
+static int MqttClient_SubTrie_UseId(MqttClient *client, MqttProp *props)
+{
+    if (client->subtrie == NULL || !client->subtrie->use_ids ||
+            client->protocol_level < MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        return 0;
+    }
+    for (; props != NULL; props = props->next) {
+        if (props->type == MQTT_PROP_SUBSCRIPTION_ID) {
+            return 0;
+        }
+    }
+    return 1;
+}
+#endif
+
+/* Adds the topic handlers to the subscription trie before subscribing, so
+ * messages sent right after the ack are handled. Sets sub_id to the
+ * subscription identifier to send, or 0 for none. */
+static int MqttClient_SubTrie_Add(MqttClient *client,
+    MqttSubscribe *subscribe, word32 *sub_id)
+{
+    word32* id = NULL;
+
+    *sub_id = 0;
+    if (client->subtrie == NULL) {
+        return MQTT_CODE_SUCCESS;
+    }
+#ifdef WOLFMQTT_V5
+    if (MqttClient_SubTrie_UseId(client, subscribe->props)) {
+        id = sub_id;
+    }
+#endif
+    return MqttSubTrie_AddTopics(client->subtrie, subscribe->topics,
+        subscribe->topic_count, id);
+}
+
+/* Removes the topic handlers added by this subscribe from the subscription
+ * trie. Filters that already had a handler are kept. With rejected set only
+ * the topics the broker did not accept are removed. */
+static void MqttClient_SubTrie_Remove(MqttClient *client, MqttTopic *topics,
+    int topic_count, byte rejected)
+{
+    int i;
+
+    if (client->subtrie == NULL) {
+        return;
+    }
+    for (i = 0; i < topic_count; i++) {
+        if (topics[i].cb != NULL && topics[i].cb_added && (!rejected ||
+                topics[i].return_code >= MQTT_SUBSCRIBE_ACK_CODE_FAILURE)) {
+            (void)MqttSubTrie_Remove(client->subtrie, topics[i].topic_filter);
+        }
+        topics[i].cb_added = 0;
+    }
+}
+#endif
+
+#ifdef WOLFMQTT_COMPRESS
+int MqttClient_SetCompress(MqttClient *client, MqttCompress *comp)
+{
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+    client->compress = comp;
+
+    return MQTT_CODE_SUCCESS;
+}
+#endif
+
+#ifdef WOLFMQTT_MSG_POOL
+int MqttClient_SetMsgPool(MqttClient *client, MqttMsgPool *pool)
+{
+    MqttMsgBuf* buf = NULL;
+
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+    if (pool != NULL) {
+        buf = MqttMsgPool_Get(pool);
+        if (buf == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+    }
+
+    /* Release buffers from the previous pool */
+    if (client->rx_msgbuf != NULL) {
+        MqttMsgBuf_Release(client->rx_msgbuf);
+        MqttMsgBuf_Release(client->rx_next);
+        client->rx_msgbuf = NULL;
+        client->rx_next = NULL;
+        client->rx_buf = client->rx_buf_user;
+        client->rx_buf_len = client->rx_buf_len_user;
+    }
+
+    client->msg_pool = pool;
+    if (buf != NULL) {
+        client->rx_buf_user = client->rx_buf;
+        client->rx_buf_len_user = client->rx_buf_len;
+        client->rx_msgbuf = buf;
+        client->rx_buf = buf->data;
+        client->rx_buf_len = pool->buf_len;
+    }
+
+    return MQTT_CODE_SUCCESS;
+}
+
+MqttMsgBuf* MqttClient_MsgRetain(MqttClient *client, MqttMessage *msg)
+{
+    MqttMsgBuf* buf;
+
+    if (client == NULL || msg == NULL || client->rx_msgbuf == NULL) {
+        return NULL;
+    }
+    buf = client->rx_msgbuf;
+
+    /* Entire message must be in the pooled buffer */
+    if (msg->buffer_pos != 0 || msg->buffer_len != msg->total_len ||
+            msg->topic_name == NULL ||
+            (byte*)msg->topic_name < buf->data ||
+            (byte*)msg->topic_name >= buf->data + client->rx_buf_len ||
+            (msg->total_len > 0 && (msg->buffer < buf->data ||
+             msg->buffer + msg->total_len >
+                buf->data + client->rx_buf_len))) {
+        return NULL;
+    }
+
+    /* Reserve the buffer for the next read */
+    if (client->rx_next == NULL) {
+        client->rx_next = MqttMsgPool_Get(client->msg_pool);
+        if (client->rx_next == NULL) {
+            (void)MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+            return NULL;
+        }
+    }
+
+    buf->packet_id = msg->packet_id;
+    buf->qos = msg->qos;
+    buf->retain = msg->retain;
+    buf->duplicate = msg->duplicate;
+    buf->topic_name = msg->topic_name;
+    buf->topic_name_len = msg->topic_name_len;
+    buf->buffer = msg->buffer;
+    buf->total_len = msg->total_len;
+    MqttMsgBuf_Retain(buf);
+
+    return buf;
+}
+#endif /* WOLFMQTT_MSG_POOL */
+
 int MqttClient_Connect(MqttClient *client, MqttConnect *mc_connect)
 {
     int rc;
+#ifdef WOLFMQTT_TOPIC_ALIAS
+    MqttProp alias_max_prop;
+    byte alias_max_added;
+#endif
 
     /* Validate required arguments */
     if (client == NULL || mc_connect == NULL) {
@@ -1646,8 +2041,19 @@ int MqttClient_Connect(MqttClient *client, MqttConnect *mc_connect)
         mc_connect->protocol_level = client->protocol_level;
     #endif
 
+    #ifdef WOLFMQTT_TOPIC_ALIAS
+        /* Advertise the inbound alias table */
+        alias_max_added = MqttClient_TopicAliasConnect(client, mc_connect,
+            &alias_max_prop);
+    #endif
+
         /* Encode the connect packet */
         rc = MqttEncode_Connect(client->tx_buf, client->tx_buf_len, mc_connect);
+    #ifdef WOLFMQTT_TOPIC_ALIAS
+        if (alias_max_added) {
+            mc_connect->props = alias_max_prop.next;
+        }
+    #endif
     #ifdef WOLFMQTT_DEBUG_CLIENT
         PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d), ID %d, QoS %d",
             rc, MqttPacket_TypeDesc(MQTT_PACKET_TYPE_CONNECT),
@@ -1784,6 +2190,73 @@ int MqttClient_Connect(MqttClient *client, MqttConnect *mc_connect)
     return rc;
 }
 
+/* Returns non-zero if incoming publish messages have a destination */
+static inline int MqttClient_HasMsgCb(MqttClient* client)
+{
+#ifdef WOLFMQTT_DISPATCH
+    if (client->dispatch != NULL) {
+        return 1;
+    }
+#endif
+#ifdef WOLFMQTT_SUBTRIE
+    if (client->subtrie != NULL) {
+        return 1;
+    }
+#endif
+    return (client->msg_cb != NULL);
+}
+
+/* Deliver message to the dispatcher (if set), the handlers of the matching
+ * topic filters or the message callback. A client never has both a
+ * dispatcher and a trie (see MqttClient_SetDispatch). */
+static int MqttClient_MsgDeliver(MqttClient* client, MqttMessage* msg,
+    byte msg_new, byte msg_done)
+{
+#ifdef WOLFMQTT_DISPATCH
+    if (client->dispatch != NULL) {
+        return MqttDispatch_Message(client->dispatch, client, msg, msg_new,
+            msg_done);
+    }
+#endif
+#ifdef WOLFMQTT_SUBTRIE
+    if (client->subtrie != NULL) {
+        int rc = MqttSubTrie_Deliver(client->subtrie, client, msg, msg_new,
+            msg_done);
+        if (rc != MQTT_CODE_ERROR_NOT_FOUND) {
+            return rc;
+        }
+        if (client->msg_cb == NULL) {
+            return MQTT_CODE_SUCCESS; /* no filter matched */
+        }
+    }
+#endif
+    return client->msg_cb(client, msg, msg_new, msg_done);
+}
+
+/* Decompress the payload (if set) and deliver the message */
+static int MqttClient_MsgCb(MqttClient* client, MqttMessage* msg,
+    byte msg_new, byte msg_done)
+{
+#ifdef WOLFMQTT_COMPRESS
+    if (client->compress != NULL) {
+        byte result;
+        int rc = MqttCompress_Message(client->compress, msg, msg_new,
+            msg_done, &result);
+        if (rc != MQTT_CODE_SUCCESS ||
+                result == MQTT_COMPRESS_MSG_SEGMENT) {
+            return rc;
+        }
+        if (result == MQTT_COMPRESS_MSG_DONE) {
+            /* Complete payload in one call */
+            rc = MqttClient_MsgDeliver(client, msg, 1, 1);
+            MqttCompress_MessageDone(client->compress, msg);
+            return rc;
+        }
+    }
+#endif
+    return MqttClient_MsgDeliver(client, msg, msg_new, msg_done);
+}
+
 static int MqttClient_Publish_ReadPayload(MqttClient* client,
     MqttPublish* publish, int timeout_ms)
 {
@@ -1798,13 +2271,13 @@ static int MqttClient_Publish_ReadPayload(MqttClient* client,
 
         if (publish->buffer_new) {
             /* Issue callback for new message (first time only) */
-            if (client->msg_cb) {
+            if (MqttClient_HasMsgCb(client)) {
                 /* if using the temp publish message buffer,
                    then populate message context with client context */
                 if (publish->ctx == NULL && &client->msg.publish == publish) {
                     publish->ctx = client->ctx;
                 }
-                rc = client->msg_cb(client, publish, publish->buffer_new,
+                rc = MqttClient_MsgCb(client, publish, publish->buffer_new,
                                     msg_done);
                 if (rc != MQTT_CODE_SUCCESS) {
                     return rc;
@@ -1851,8 +2324,8 @@ static int MqttClient_Publish_ReadPayload(MqttClient* client,
                     publish->total_len) ? 1 : 0;
 
                 /* Issue callback for additional publish payload */
-                if (client->msg_cb) {
-                    rc = client->msg_cb(client, publish, publish->buffer_new,
+                if (MqttClient_HasMsgCb(client)) {
+                    rc = MqttClient_MsgCb(client, publish, publish->buffer_new,
                                         msg_done);
                     if (rc != MQTT_CODE_SUCCESS) {
                         return rc;
@@ -2012,17 +2485,50 @@ static int MqttClient_Publish_WritePayload(MqttClient *client,
     return rc;
 }
 
+/* Ends writing a publish, restoring the payload if it was compressed */
+static void MqttClient_PublishWriteStop(MqttClient *client,
+    MqttPublish *publish)
+{
+#ifdef WOLFMQTT_COMPRESS
+    if (client->compress != NULL) {
+        MqttCompress_PublishDone(client->compress, publish);
+    }
+#endif
+    MqttWriteStop(client, &publish->stat);
+}
+
 static int MqttPublishMsg(MqttClient *client, MqttPublish *publish,
                           MqttPublishCb pubCb, int writeOnly)
 {
     int rc = MQTT_CODE_SUCCESS;
     MqttPacketType resp_type;
+#ifdef WOLFMQTT_TOPIC_ALIAS
+    MqttProp alias_prop;
+    word16 alias;
+    const char* topic_name;
+#endif
+#ifdef WOLFMQTT_COMPRESS
+    MqttProp comp_prop;
+    int compressed = 0;
+#endif
 
     /* Validate required arguments */
     if (client == NULL || publish == NULL) {
         return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
     }
 
+    if (publish->tmpl != NULL) {
+        /* Topic, QoS and retain are pre-encoded in the template */
+    #ifdef WOLFMQTT_V5
+        if (publish->tmpl->protocol_level != client->protocol_level) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+        }
+    #endif
+        publish->topic_name = publish->tmpl->topic_name;
+        publish->qos = publish->tmpl->qos;
+        publish->retain = publish->tmpl->retain;
+    }
+
 #ifdef WOLFMQTT_V5
     /* Use specified protocol version if set */
     publish->protocol_level = client->protocol_level;
@@ -2044,9 +2550,42 @@ static int MqttPublishMsg(MqttClient *client, MqttPublish *publish,
                 return rc;
             }
 
+        #ifdef WOLFMQTT_COMPRESS
+            /* Send the payload compressed, with the user property */
+            if (client->compress != NULL && pubCb == NULL) {
+                compressed = MqttCompress_Publish(client->compress, publish,
+                    &comp_prop);
+                if (compressed < 0) {
+                    MqttWriteStop(client, &publish->stat);
+                    return compressed;
+                }
+            }
+        #endif
+        #ifdef WOLFMQTT_TOPIC_ALIAS
+            /* Send a topic alias in place of the topic */
+            topic_name = publish->topic_name;
+            alias = MqttClient_TopicAliasApply(client, publish, &alias_prop);
+        #endif
+
             /* Encode the publish packet */
             rc = MqttEncode_Publish(client->tx_buf, client->tx_buf_len,
                     publish, pubCb ? 1 : 0);
+
+        #ifdef WOLFMQTT_TOPIC_ALIAS
+            if (alias != 0) {
+                publish->topic_name = topic_name;
+                publish->props = alias_prop.next;
+                if (rc <= 0) {
+                    /* not sent, so the broker does not know the alias */
+                    MqttTopicAliasOut_Forget(client->alias_out, alias);
+                }
+            }
+        #endif
+        #ifdef WOLFMQTT_COMPRESS
+            if (compressed) {
+                publish->props = comp_prop.next;
+            }
+        #endif
         #ifdef WOLFMQTT_DEBUG_CLIENT
             PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d), ID %d,"
                     " QoS %d",
@@ -2055,7 +2594,7 @@ static int MqttPublishMsg(MqttClient *client, MqttPublish *publish,
                 publish->qos);
         #endif
             if (rc <= 0) {
-                MqttWriteStop(client, &publish->stat);
+                MqttClient_PublishWriteStop(client, publish);
                 return rc;
             }
             client->write.len = rc;
@@ -2074,7 +2613,7 @@ static int MqttPublishMsg(MqttClient *client, MqttPublish *publish,
                     wm_SemUnlock(&client->lockClient);
                 }
                 if (rc != 0) {
-                    MqttWriteStop(client, &publish->stat);
+                    MqttClient_PublishWriteStop(client, publish);
                     return rc; /* Error locking client */
                 }
             }
@@ -2104,7 +2643,7 @@ static int MqttPublishMsg(MqttClient *client, MqttPublish *publish,
 
             /* if failure or no data was written yet */
             if (rc != xfer) {
-                MqttWriteStop(client, &publish->stat);
+                MqttClient_PublishWriteStop(client, publish);
                 MqttClient_CancelMessage(client, (MqttObject*)publish);
                 return rc;
             }
@@ -2121,7 +2660,7 @@ static int MqttPublishMsg(MqttClient *client, MqttPublish *publish,
             if (rc == MQTT_CODE_CONTINUE || rc == MQTT_CODE_PUB_CONTINUE)
                 return rc;
         #endif
-            MqttWriteStop(client, &publish->stat);
+            MqttClient_PublishWriteStop(client, publish);
             if (rc < 0) {
                 MqttClient_CancelMessage(client, (MqttObject*)publish);
                 break;
@@ -2227,11 +2766,68 @@ int MqttClient_Publish_WriteOnly(MqttClient *client, MqttPublish *publish,
 }
 #endif
 
+int MqttClient_PublishTemplate_Init(MqttClient *client,
+    MqttPublishTemplate *tmpl, MqttPublish *publish, byte *buf, int buf_len)
+{
+    int rc;
+
+    /* Validate required arguments */
+    if (client == NULL || tmpl == NULL || publish == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+#ifdef WOLFMQTT_V5
+    /* Properties are encoded for the negotiated protocol version */
+    publish->protocol_level = client->protocol_level;
+#endif
+
+    rc = MqttEncode_PublishTemplate(tmpl, publish, buf, buf_len);
+    if (rc < 0) {
+        return rc;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+
+/* Encodes a subscribe packet, adding the subscription identifier (when not
+ * 0) to the front of the properties while encoding */
+static int MqttClient_EncodeSubscribe(MqttClient *client,
+    MqttSubscribe *subscribe, word32 sub_id)
+{
+    int rc;
+#ifdef WOLFMQTT_V5
+    MqttProp id_prop;
+
+    if (sub_id != 0) {
+        XMEMSET(&id_prop, 0, sizeof(id_prop));
+        id_prop.type = MQTT_PROP_SUBSCRIPTION_ID;
+        id_prop.data_int = sub_id;
+        id_prop.next = subscribe->props;
+        subscribe->props = &id_prop;
+    }
+#else
+    (void)sub_id;
+#endif
+
+    rc = MqttEncode_Subscribe(client->tx_buf, client->tx_buf_len, subscribe);
+#ifdef WOLFMQTT_DEBUG_CLIENT
+    PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d), ID %d",
+        rc, MqttPacket_TypeDesc(MQTT_PACKET_TYPE_SUBSCRIBE),
+        MQTT_PACKET_TYPE_SUBSCRIBE, subscribe->packet_id);
+#endif
+
+#ifdef WOLFMQTT_V5
+    if (sub_id != 0) {
+        subscribe->props = id_prop.next;
+    }
+#endif
+    return rc;
+}
 
 int MqttClient_Subscribe(MqttClient *client, MqttSubscribe *subscribe)
 {
-    int rc, i;
-    MqttTopic* topic;
+    int rc;
+    word32 sub_id = 0;
 
     /* Validate required arguments */
     if (client == NULL || subscribe == NULL) {
@@ -2242,6 +2838,9 @@ int MqttClient_Subscribe(MqttClient *client, MqttSubscribe *subscribe)
     /* Use specified protocol version if set */
     subscribe->protocol_level = client->protocol_level;
 #endif
+    /* Return codes are stored in the topics when the ack is decoded */
+    subscribe->ack.topics = subscribe->topics;
+    subscribe->ack.topic_count = subscribe->topic_count;
 
     if (subscribe->stat.write == MQTT_MSG_BEGIN) {
         /* Flag write active / lock mutex */
@@ -2249,15 +2848,24 @@ int MqttClient_Subscribe(MqttClient *client, MqttSubscribe *subscribe)
             return rc;
         }
 
-        /* Encode the subscribe packet */
-        rc = MqttEncode_Subscribe(client->tx_buf, client->tx_buf_len,
-                subscribe);
-    #ifdef WOLFMQTT_DEBUG_CLIENT
-        PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d), ID %d",
-            rc, MqttPacket_TypeDesc(MQTT_PACKET_TYPE_SUBSCRIBE),
-            MQTT_PACKET_TYPE_SUBSCRIBE, subscribe->packet_id);
+    #ifdef WOLFMQTT_SUBTRIE
+        /* Handlers are added first to get the subscription identifier */
+        rc = MqttClient_SubTrie_Add(client, subscribe, &sub_id);
+        if (rc != MQTT_CODE_SUCCESS) {
+            MqttClient_SubTrie_Remove(client, subscribe->topics,
+                subscribe->topic_count, 0);
+            MqttWriteStop(client, &subscribe->stat);
+            return rc;
+        }
     #endif
+
+        /* Encode the subscribe packet */
+        rc = MqttClient_EncodeSubscribe(client, subscribe, sub_id);
         if (rc <= 0) {
+        #ifdef WOLFMQTT_SUBTRIE
+            MqttClient_SubTrie_Remove(client, subscribe->topics,
+                subscribe->topic_count, 0);
+        #endif
             MqttWriteStop(client, &subscribe->stat);
             return rc;
         }
@@ -2272,6 +2880,10 @@ int MqttClient_Subscribe(MqttClient *client, MqttSubscribe *subscribe)
             wm_SemUnlock(&client->lockClient);
         }
         if (rc != 0) {
+        #ifdef WOLFMQTT_SUBTRIE
+            MqttClient_SubTrie_Remove(client, subscribe->topics,
+                subscribe->topic_count, 0);
+        #endif
             MqttWriteStop(client, &subscribe->stat);
             return rc; /* Error locking client */
         }
@@ -2296,6 +2908,10 @@ int MqttClient_Subscribe(MqttClient *client, MqttSubscribe *subscribe)
     #endif
         MqttWriteStop(client, &subscribe->stat);
         if (rc != xfer) {
+        #ifdef WOLFMQTT_SUBTRIE
+            MqttClient_SubTrie_Remove(client, subscribe->topics,
+                subscribe->topic_count, 0);
+        #endif
             MqttClient_CancelMessage(client, (MqttObject*)subscribe);
             return rc;
         }
@@ -2319,16 +2935,356 @@ int MqttClient_Subscribe(MqttClient *client, MqttSubscribe *subscribe)
     }
 #endif
 
-    /* Populate return codes */
+#ifdef WOLFMQTT_SUBTRIE
+    /* Keep the handlers of accepted topics only */
+    MqttClient_SubTrie_Remove(client, subscribe->topics,
+        subscribe->topic_count, (rc == MQTT_CODE_SUCCESS));
+#endif
+
+    /* reset state */
+    subscribe->stat.write = MQTT_MSG_BEGIN;
+
+    return rc;
+}
+
+/* Returns the number of topics from topic_first that fit in one subscribe
+ * packet and whose subscribe ack fits the read buffer */
+static int MqttClient_SubscribeBulk_Count(MqttClient *client,
+    MqttSubscribeBulk *bulk, int topic_first)
+{
+    int i, size_max, codes_max, len, topic_len;
+    MqttTopic* topic;
+#ifdef WOLFMQTT_SUBTRIE
+    byte same_cb = 0;
+#endif
+
+    /* Fixed header with largest remaining length and packet ID */
+    len = 1 + MQTT_PACKET_MAX_LEN_BYTES + MQTT_DATA_LEN_SIZE;
+    codes_max = client->rx_buf_len - len;
+
+    size_max = client->tx_buf_len;
+    if ((bulk->max_packet_size > 0) &&
+            (bulk->max_packet_size < (word32)size_max)) {
+        size_max = (int)bulk->max_packet_size;
+    }
+#ifdef WOLFMQTT_V5
+    if ((client->packet_sz_max > 0) &&
+            (client->packet_sz_max < (word32)size_max)) {
+        size_max = (int)client->packet_sz_max;
+    }
+    if (client->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        int props_len = MqttEncode_Props(MQTT_PACKET_TYPE_SUBSCRIBE,
+            bulk->props, NULL);
+        if (props_len < 0) {
+            return props_len;
+        }
+        len += props_len + MqttEncode_Vbi(NULL, (word32)props_len);
+        codes_max--; /* Property length of subscribe ack */
+    #ifdef WOLFMQTT_SUBTRIE
+        if (MqttClient_SubTrie_UseId(client, bulk->props)) {
+            /* Subscription identifier, and a longer property length */
+            len += 2 + MQTT_PACKET_MAX_LEN_BYTES;
+            same_cb = 1;
+        }
+    #endif
+    }
+#endif
+
+    for (i = topic_first; (i < bulk->topic_count) &&
+                          (i - topic_first < codes_max); i++) {
+        topic = &bulk->topics[i];
+        if (topic->topic_filter == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+        }
+    #ifdef WOLFMQTT_SUBTRIE
+        /* An identifier selects one handler, so topics with another handler
+         * go in the next packet */
+        if (same_cb && (topic->cb != bulk->topics[topic_first].cb ||
+                topic->cb_ctx != bulk->topics[topic_first].cb_ctx)) {
+            break;
+        }
+    #endif
+        topic_len = (int)XSTRLEN(topic->topic_filter) +
+            MQTT_DATA_LEN_SIZE + 1; /* For QoS */
+        if (len + topic_len > size_max) {
+            break;
+        }
+        len += topic_len;
+    }
+    if (i == topic_first) {
+        /* Topic does not fit in a packet by itself */
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    return i - topic_first;
+}
+
+static int MqttClient_SubscribeBulk_Send(MqttClient *client,
+    MqttSubscribeBulk *bulk)
+{
+    int rc, i, count, xfer;
+    MqttBulkPacket* packet;
+    MqttSubscribe subscribe;
+    word32 sub_id = 0;
+
+    if (bulk->stat.write != MQTT_MSG_HEADER) {
+        count = MqttClient_SubscribeBulk_Count(client, bulk,
+            bulk->topic_next);
+        if (count < 0) {
+            return count;
+        }
+
+        /* Find free slot in window */
+        for (i = 0; i < bulk->packet_max; i++) {
+            if (bulk->packets[i].topic_count == 0) {
+                break;
+            }
+        }
+        if (i >= bulk->packet_max) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_STAT);
+        }
+        packet = &bulk->packets[i];
+
+        /* Flag write active / lock mutex */
+        if ((rc = MqttWriteStart(client, &bulk->stat)) != 0) {
+            return rc;
+        }
+
+        /* Encode the subscribe packet */
+        XMEMSET(&subscribe, 0, sizeof(subscribe));
+        subscribe.packet_id = bulk->packet_id;
+        subscribe.topic_count = count;
+        subscribe.topics = &bulk->topics[bulk->topic_next];
+    #ifdef WOLFMQTT_V5
+        subscribe.props = bulk->props;
+        subscribe.protocol_level = client->protocol_level;
+    #endif
+    #ifdef WOLFMQTT_SUBTRIE
+        rc = MqttClient_SubTrie_Add(client, &subscribe, &sub_id);
+        if (rc != MQTT_CODE_SUCCESS) {
+            MqttClient_SubTrie_Remove(client, subscribe.topics, count, 0);
+            MqttWriteStop(client, &bulk->stat);
+            return rc;
+        }
+    #endif
+        rc = MqttClient_EncodeSubscribe(client, &subscribe, sub_id);
+        if (rc <= 0) {
+        #ifdef WOLFMQTT_SUBTRIE
+            MqttClient_SubTrie_Remove(client, subscribe.topics, count, 0);
+        #endif
+            MqttWriteStop(client, &bulk->stat);
+            return rc;
+        }
+        client->write.len = rc;
+        rc = MQTT_CODE_SUCCESS;
+
+        /* Topics without a return code in the ack are failures */
+        for (i = 0; i < count; i++) {
+            subscribe.topics[i].return_code = MQTT_SUBSCRIBE_ACK_CODE_FAILURE;
+        }
+
+        XMEMSET(packet, 0, sizeof(MqttBulkPacket));
+        packet->packet_id = subscribe.packet_id;
+        packet->topic_first = bulk->topic_next;
+        packet->topic_count = count;
+        packet->ack.topics = subscribe.topics;
+        packet->ack.topic_count = count;
+
+    #ifdef WOLFMQTT_MULTITHREAD
+        rc = wm_SemLock(&client->lockClient);
+        if (rc == 0) {
+            /* inform other threads of expected response */
+            rc = MqttClient_RespList_Add(client,
+                MQTT_PACKET_TYPE_SUBSCRIBE_ACK, packet->packet_id,
+                &packet->pendResp, &packet->ack);
+            wm_SemUnlock(&client->lockClient);
+        }
+    #endif
+        if (rc != 0) {
+        #ifdef WOLFMQTT_SUBTRIE
+            MqttClient_SubTrie_Remove(client, subscribe.topics, count, 0);
+        #endif
+            packet->topic_count = 0;
+            MqttWriteStop(client, &bulk->stat);
+            return rc;
+        }
+
+        bulk->topic_next += count;
+        bulk->pending++;
+        bulk->packet_count++;
+        if (++bulk->packet_id == 0) {
+            bulk->packet_id = 1; /* Packet ID must be non-zero */
+        }
+        bulk->stat.write = MQTT_MSG_HEADER;
+    }
+
+    /* Send subscribe packet */
+    xfer = client->write.len;
+    rc = MqttPacket_Write(client, client->tx_buf, xfer);
+#ifdef WOLFMQTT_NONBLOCK
+    if (rc == MQTT_CODE_CONTINUE
+    #ifdef WOLFMQTT_ALLOW_NODATA_UNLOCK
+        && client->write.total > 0
+    #endif
+    ) {
+        /* keep send locked and return early */
+        return rc;
+    }
+#endif
+    MqttWriteStop(client, &bulk->stat);
+    bulk->stat.write = MQTT_MSG_WAIT;
+    if (rc != xfer) {
+        return (rc < 0) ? rc : MQTT_TRACE_ERROR(MQTT_CODE_ERROR_NETWORK);
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int MqttClient_SubscribeBulk_Wait(MqttClient *client,
+    MqttSubscribeBulk *bulk)
+{
+    int rc, i;
+    MqttBulkPacket* packet = NULL;
+
+#ifdef WOLFMQTT_MULTITHREAD
+    /* Wait for the oldest packet. The acks of the others are decoded into
+     * their packet as they arrive and found by packet ID. */
+    for (i = 0; i < bulk->packet_max; i++) {
+        if ((bulk->packets[i].topic_count > 0) && ((packet == NULL) ||
+                (bulk->packets[i].topic_first < packet->topic_first))) {
+            packet = &bulk->packets[i];
+        }
+    }
+    if (packet == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_STAT);
+    }
+    rc = MqttClient_WaitType(client, &packet->ack,
+        MQTT_PACKET_TYPE_SUBSCRIBE_ACK, packet->packet_id,
+        client->cmd_timeout_ms);
+    if (rc == MQTT_CODE_CONTINUE) {
+        return rc;
+    }
+    if (wm_SemLock(&client->lockClient) == 0) {
+        MqttClient_RespList_Remove(client, &packet->pendResp);
+        wm_SemUnlock(&client->lockClient);
+    }
+#else
+    /* Wait for any subscribe ack */
+    rc = MqttClient_WaitType(client, &bulk->ack,
+        MQTT_PACKET_TYPE_SUBSCRIBE_ACK, 0, client->cmd_timeout_ms);
+    #ifdef WOLFMQTT_NONBLOCK
+    if (rc == MQTT_CODE_CONTINUE) {
+        return rc;
+    }
+    #endif
     if (rc == MQTT_CODE_SUCCESS) {
-        for (i = 0; i < subscribe->topic_count && i < MAX_MQTT_TOPICS; i++) {
-            topic = &subscribe->topics[i];
-            topic->return_code = subscribe->ack.return_codes[i];
+        for (i = 0; i < bulk->packet_max; i++) {
+            if ((bulk->packets[i].topic_count > 0) &&
+                    (bulk->packets[i].packet_id == bulk->ack.packet_id)) {
+                packet = &bulk->packets[i];
+                break;
+            }
+        }
+        if (packet == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_ID);
+        }
+
+        /* Decode the ack again, still in rx_buf, to store the return
+         * codes in the topics of the matching packet */
+    #ifdef WOLFMQTT_V5
+        packet->ack.protocol_level = client->protocol_level;
+    #endif
+        rc = MqttDecode_SubscribeAck(client->rx_buf, client->packet.buf_len,
+            &packet->ack);
+        if (rc >= 0) {
+            rc = MQTT_CODE_SUCCESS;
+        }
+    }
+#endif
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    for (i = 0; i < packet->topic_count; i++) {
+        if (bulk->topics[packet->topic_first + i].return_code >=
+                MQTT_SUBSCRIBE_ACK_CODE_FAILURE) {
+            bulk->fail_count++;
+        }
+    }
+#ifdef WOLFMQTT_SUBTRIE
+    MqttClient_SubTrie_Remove(client, &bulk->topics[packet->topic_first],
+        packet->topic_count, 1);
+#endif
+    packet->topic_count = 0;
+    bulk->pending--;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+int MqttClient_SubscribeBulk(MqttClient *client, MqttSubscribeBulk *bulk)
+{
+    int rc = MQTT_CODE_SUCCESS, i;
+
+    /* Validate required arguments */
+    if (client == NULL || bulk == NULL || bulk->topics == NULL ||
+            bulk->topic_count <= 0 || bulk->packets == NULL ||
+            bulk->packet_max <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    if (bulk->stat.write == MQTT_MSG_BEGIN) {
+        /* Start with an empty window */
+        for (i = 0; i < bulk->packet_max; i++) {
+            bulk->packets[i].topic_count = 0;
+        }
+        bulk->topic_next = 0;
+        bulk->pending = 0;
+        bulk->packet_count = 0;
+        bulk->fail_count = 0;
+        if (bulk->packet_id == 0) {
+            bulk->packet_id = 1;
+        }
+        bulk->stat.write = MQTT_MSG_WAIT;
+    }
+
+    /* Send while the window has room, then wait for an ack */
+    while ((rc == MQTT_CODE_SUCCESS) &&
+           ((bulk->topic_next < bulk->topic_count) || (bulk->pending > 0))) {
+        if ((bulk->stat.write == MQTT_MSG_HEADER) ||
+            ((bulk->topic_next < bulk->topic_count) &&
+             (bulk->pending < bulk->packet_max))) {
+            rc = MqttClient_SubscribeBulk_Send(client, bulk);
+        }
+        else {
+            rc = MqttClient_SubscribeBulk_Wait(client, bulk);
+        }
+    }
+#if defined(WOLFMQTT_NONBLOCK) || defined(WOLFMQTT_MULTITHREAD)
+    if (rc == MQTT_CODE_CONTINUE)
+        return rc;
+#endif
+
+#ifdef WOLFMQTT_MULTITHREAD
+    if ((bulk->pending > 0) && (wm_SemLock(&client->lockClient) == 0)) {
+        for (i = 0; i < bulk->packet_max; i++) {
+            if (bulk->packets[i].topic_count > 0) {
+                MqttClient_RespList_Remove(client, &bulk->packets[i].pendResp);
+            }
+        }
+        wm_SemUnlock(&client->lockClient);
+    }
+#endif
+#ifdef WOLFMQTT_SUBTRIE
+    /* Handlers of topics without an ack are removed */
+    for (i = 0; i < bulk->packet_max && bulk->pending > 0; i++) {
+        if (bulk->packets[i].topic_count > 0) {
+            MqttClient_SubTrie_Remove(client,
+                &bulk->topics[bulk->packets[i].topic_first],
+                bulk->packets[i].topic_count, 0);
         }
     }
+#endif
 
     /* reset state */
-    subscribe->stat.write = MQTT_MSG_BEGIN;
+    bulk->stat.write = MQTT_MSG_BEGIN;
 
     return rc;
 }
@@ -2424,6 +3380,16 @@ int MqttClient_Unsubscribe(MqttClient *client, MqttUnsubscribe *unsubscribe)
     }
 #endif
 
+#ifdef WOLFMQTT_SUBTRIE
+    if (rc == MQTT_CODE_SUCCESS && client->subtrie != NULL) {
+        int i;
+        for (i = 0; i < unsubscribe->topic_count; i++) {
+            (void)MqttSubTrie_Remove(client->subtrie,
+                unsubscribe->topics[i].topic_filter);
+        }
+    }
+#endif
+
 #ifdef WOLFMQTT_V5
     if (unsubscribe->ack.props != NULL) {
         /* Release the allocated properties */
@@ -2718,6 +3684,58 @@ int MqttClient_PropsFree(MqttProp *head)
     return MqttProps_Free(head);
 }
 
+int MqttClient_PropsArenaInit(MqttPropArena *arena, MqttProp *props,
+    int count)
+{
+    return MqttProps_ArenaInit(arena, props, count);
+}
+
+MqttProp* MqttClient_PropsArenaAdd(MqttPropArena *arena, MqttProp **head)
+{
+    return MqttProps_ArenaAdd(arena, head);
+}
+
+void MqttClient_PropsArenaReset(MqttPropArena *arena)
+{
+    MqttProps_ArenaReset(arena);
+}
+
+int MqttClient_SetPropArena(MqttClient *client, MqttProp *props, int count)
+{
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+    return MqttProps_ArenaInit(&client->prop_arena, props, count);
+}
+
+int MqttClient_SetLazyProps(MqttClient *client, byte enable)
+{
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+    client->lazy_props = (enable != 0) ? 1 : 0;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+int MqttClient_PropsViewNext(MqttPropView *view, MqttProp *prop)
+{
+    return MqttProps_ViewNext(view, prop);
+}
+
+int MqttClient_PropsViewFind(MqttPropView *view, MqttPropertyType type,
+    MqttProp *prop)
+{
+    return MqttProps_ViewFind(view, type, prop);
+}
+
+void MqttClient_PropsViewReset(MqttPropView *view)
+{
+    if (view != NULL) {
+        view->pos = 0;
+    }
+}
+
 #endif /* WOLFMQTT_V5 */
 
 int MqttClient_WaitMessage_ex(MqttClient *client, MqttObject* msg,
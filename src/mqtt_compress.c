@@ -0,0 +1,441 @@
+/* mqtt_compress.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_COMPRESS: Enables the payload codec (requires WOLFMQTT_V5 and
+ *  zlib). With a codec set on a client (MqttClient_SetCompress) published
+ *  payloads are deflated, when that makes them shorter, and sent with the
+ *  user property "content-encoding: deflate". Received payloads with the
+ *  property are inflated before the message callback. Other messages are
+ *  passed unchanged, so compressed and plain peers can share topics.
+ *
+ * MQTT_COMPRESS_MIN_LEN: Shortest payload compressed (default 64).
+ * MQTT_COMPRESS_WINDOW_BITS: Deflate window bits, 9 to 15 (default 15).
+ * MQTT_COMPRESS_PROP_KEY: Name of the user property (default
+ *  "content-encoding").
+ */
+
+#ifdef WOLFMQTT_COMPRESS
+
+#include <zlib.h>
+
+#define MQTT_COMPRESS_KEY_LEN       (sizeof(MQTT_COMPRESS_PROP_KEY) - 1)
+#define MQTT_COMPRESS_DEFLATE_LEN   (sizeof(MQTT_COMPRESS_DEFLATE) - 1)
+
+/* Encoded length of the user property: identifier and two strings */
+#define MQTT_COMPRESS_PROP_LEN      (1 + MQTT_DATA_LEN_SIZE * 2 + \
+    MQTT_COMPRESS_KEY_LEN + MQTT_COMPRESS_DEFLATE_LEN)
+
+/* Private functions */
+
+static voidpf MqttCompress_ZAlloc(voidpf opaque, uInt items, uInt size)
+{
+    (void)opaque;
+    if (size != 0 && items > (uInt)-1 / size) {
+        return Z_NULL;
+    }
+    return WOLFMQTT_MALLOC((size_t)items * size);
+}
+
+static void MqttCompress_ZFree(voidpf opaque, voidpf ptr)
+{
+    (void)opaque;
+    WOLFMQTT_FREE(ptr);
+}
+
+static z_stream* MqttCompress_NewStream(void)
+{
+    z_stream* strm = (z_stream*)WOLFMQTT_MALLOC(sizeof(z_stream));
+    if (strm != NULL) {
+        XMEMSET(strm, 0, sizeof(z_stream));
+        strm->zalloc = MqttCompress_ZAlloc;
+        strm->zfree = MqttCompress_ZFree;
+    }
+    return strm;
+}
+
+/* Returns the deflate stream, ready for a new payload */
+static int MqttCompress_Deflater(MqttCompress *comp, z_stream **out)
+{
+    z_stream* strm = (z_stream*)comp->def;
+
+    if (strm == NULL) {
+        strm = MqttCompress_NewStream();
+        if (strm == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+        if (deflateInit2(strm, comp->level, Z_DEFLATED,
+                MQTT_COMPRESS_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            WOLFMQTT_FREE(strm);
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+        comp->def = strm;
+    }
+    else if (deflateReset(strm) != Z_OK) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+    if (comp->dict != NULL && deflateSetDictionary(strm, comp->dict,
+            (uInt)comp->dict_len) != Z_OK) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+    *out = strm;
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Returns the inflate stream, ready for a new payload */
+static int MqttCompress_Inflater(MqttCompress *comp, z_stream **out)
+{
+    z_stream* strm = (z_stream*)comp->inf;
+
+    if (strm == NULL) {
+        strm = MqttCompress_NewStream();
+        if (strm == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+        if (inflateInit2(strm, MAX_WBITS) != Z_OK) {
+            WOLFMQTT_FREE(strm);
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+        comp->inf = strm;
+    }
+    else if (inflateReset(strm) != Z_OK) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+    *out = strm;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int MqttCompress_IsKey(const char *str, word16 len)
+{
+    return (len == MQTT_COMPRESS_KEY_LEN &&
+            XMEMCMP(str, MQTT_COMPRESS_PROP_KEY, MQTT_COMPRESS_KEY_LEN) == 0);
+}
+
+/* Returns 1 when the received properties mark a deflated payload */
+static int MqttCompress_IsDeflated(MqttMessage *msg)
+{
+    MqttPropView view = msg->props_view;
+    MqttProp prop;
+
+    view.pos = 0;
+    while (MqttProps_ViewFind(&view, MQTT_PROP_USER_PROP, &prop) > 0) {
+        if (MqttCompress_IsKey(prop.data_str.str, prop.data_str.len)) {
+            return (prop.data_str2.len == MQTT_COMPRESS_DEFLATE_LEN &&
+                XMEMCMP(prop.data_str2.str, MQTT_COMPRESS_DEFLATE,
+                    MQTT_COMPRESS_DEFLATE_LEN) == 0);
+        }
+    }
+    return 0;
+}
+
+/* Ends the message being decompressed */
+static void MqttCompress_Release(MqttCompress *comp)
+{
+    if (comp->rx_saved != NULL) {
+        WOLFMQTT_FREE(comp->rx_saved);
+        comp->rx_saved = NULL;
+    }
+    comp->rx_active = 0;
+    comp->rx_len = 0;
+}
+
+/* Starts decompressing a message. The topic and properties of a message
+ * received in segments are copied, since the next segment is read over
+ * them. */
+static int MqttCompress_Start(MqttCompress *comp, MqttMessage *msg,
+    byte msg_done)
+{
+    int rc;
+    z_stream* strm;
+
+    rc = MqttCompress_Inflater(comp, &strm);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    comp->rx_topic = msg->topic_name;
+    comp->rx_topic_len = msg->topic_name_len;
+    comp->rx_props = msg->props_view;
+    if (!msg_done) {
+        comp->rx_saved = (byte*)WOLFMQTT_MALLOC(
+            (size_t)msg->topic_name_len + msg->props_view.len + 1);
+        if (comp->rx_saved == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+        if (msg->topic_name_len > 0) {
+            XMEMCPY(comp->rx_saved, msg->topic_name, msg->topic_name_len);
+        }
+        if (msg->props_view.len > 0) {
+            XMEMCPY(comp->rx_saved + msg->topic_name_len,
+                msg->props_view.buf, msg->props_view.len);
+        }
+        comp->rx_topic = (const char*)comp->rx_saved;
+        comp->rx_props.buf = comp->rx_saved + msg->topic_name_len;
+    }
+    comp->rx_props.pos = 0;
+    comp->rx_active = 1;
+    comp->rx_len = 0;
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Inflates a payload segment into the receive buffer */
+static int MqttCompress_Inflate(MqttCompress *comp, MqttMessage *msg,
+    byte msg_done)
+{
+    int ret;
+    z_stream* strm = (z_stream*)comp->inf;
+
+    strm->next_in = msg->buffer;
+    strm->avail_in = (uInt)msg->buffer_len;
+    strm->next_out = comp->rx_buf + comp->rx_len;
+    strm->avail_out = (uInt)(comp->rx_buf_len - comp->rx_len);
+
+    ret = inflate(strm, Z_NO_FLUSH);
+    if (ret == Z_NEED_DICT) {
+        if (comp->dict == NULL || inflateSetDictionary(strm, comp->dict,
+                (uInt)comp->dict_len) != Z_OK) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+        }
+        ret = inflate(strm, Z_NO_FLUSH);
+    }
+    comp->rx_len = comp->rx_buf_len - (word32)strm->avail_out;
+
+    if (ret == Z_STREAM_END) {
+        /* Nothing may follow the compressed data */
+        if (!msg_done || strm->avail_in > 0) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+        }
+        return MQTT_CODE_SUCCESS;
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    if (strm->avail_out == 0 && (strm->avail_in > 0 || msg_done)) {
+        /* Decompressed payload is larger than the receive buffer */
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    if (msg_done) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+
+/* Public Functions */
+
+int MqttCompress_Init(MqttCompress *comp, byte *tx_buf, word32 tx_buf_len,
+    byte *rx_buf, word32 rx_buf_len, int level)
+{
+    if (comp == NULL || (tx_buf == NULL && tx_buf_len > 0) ||
+            (rx_buf == NULL && rx_buf_len > 0) ||
+            level < MQTT_COMPRESS_LEVEL_DEFAULT || level > 9) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(comp, 0, sizeof(MqttCompress));
+    comp->tx_buf = tx_buf;
+    comp->tx_buf_len = tx_buf_len;
+    comp->rx_buf = rx_buf;
+    comp->rx_buf_len = rx_buf_len;
+    comp->level = level;
+    comp->min_len = MQTT_COMPRESS_MIN_LEN;
+    return MQTT_CODE_SUCCESS;
+}
+
+int MqttCompress_SetDict(MqttCompress *comp, const byte *dict,
+    word32 dict_len)
+{
+    if (comp == NULL || (dict == NULL && dict_len > 0)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    comp->dict = (dict_len > 0) ? dict : NULL;
+    comp->dict_len = dict_len;
+    return MQTT_CODE_SUCCESS;
+}
+
+void MqttCompress_Free(MqttCompress *comp)
+{
+    if (comp == NULL) {
+        return;
+    }
+    MqttCompress_Release(comp);
+    if (comp->def != NULL) {
+        (void)deflateEnd((z_stream*)comp->def);
+        WOLFMQTT_FREE(comp->def);
+        comp->def = NULL;
+    }
+    if (comp->inf != NULL) {
+        (void)inflateEnd((z_stream*)comp->inf);
+        WOLFMQTT_FREE(comp->inf);
+        comp->inf = NULL;
+    }
+}
+
+int MqttCompress_Publish(MqttCompress *comp, MqttMessage *msg, MqttProp *prop)
+{
+    int rc;
+    MqttProp* cur;
+    z_stream* strm;
+
+    if (comp->tx_buf == NULL || msg->tmpl != NULL || msg->buffer == NULL ||
+            msg->protocol_level < MQTT_CONNECT_PROTOCOL_LEVEL_5 ||
+            (msg->buffer_len != 0 && msg->buffer_len != msg->total_len) ||
+            msg->total_len < comp->min_len) {
+        return 0;
+    }
+    for (cur = msg->props; cur != NULL; cur = cur->next) {
+        /* A UTF-8 payload must stay readable, and a payload the
+         * application encoded itself is sent as is */
+        if ((cur->type == MQTT_PROP_PAYLOAD_FORMAT_IND &&
+                cur->data_byte != 0) ||
+            (cur->type == MQTT_PROP_USER_PROP &&
+                cur->data_str.str != NULL &&
+                MqttCompress_IsKey(cur->data_str.str, cur->data_str.len))) {
+            return 0;
+        }
+    }
+
+    rc = MqttCompress_Deflater(comp, &strm);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    strm->next_in = msg->buffer;
+    strm->avail_in = (uInt)msg->total_len;
+    strm->next_out = comp->tx_buf;
+    strm->avail_out = (uInt)comp->tx_buf_len;
+    if (deflate(strm, Z_FINISH) != Z_STREAM_END ||
+            strm->total_out + MQTT_COMPRESS_PROP_LEN >= msg->total_len) {
+        /* Did not fit or is not shorter */
+        return 0;
+    }
+
+    comp->tx_msg = msg;
+    comp->tx_raw = msg->buffer;
+    comp->tx_raw_len = msg->total_len;
+    msg->buffer = comp->tx_buf;
+    msg->buffer_len = msg->total_len = (word32)strm->total_out;
+
+    XMEMSET(prop, 0, sizeof(MqttProp));
+    prop->type = MQTT_PROP_USER_PROP;
+    prop->data_str.str = (char*)MQTT_COMPRESS_PROP_KEY;
+    prop->data_str.len = (word16)MQTT_COMPRESS_KEY_LEN;
+    prop->data_str2.str = (char*)MQTT_COMPRESS_DEFLATE;
+    prop->data_str2.len = (word16)MQTT_COMPRESS_DEFLATE_LEN;
+    prop->next = msg->props;
+    msg->props = prop;
+    return 1;
+}
+
+void MqttCompress_PublishDone(MqttCompress *comp, MqttMessage *msg)
+{
+    if (comp->tx_msg != msg) {
+        return;
+    }
+    if (msg->buffer_pos >= msg->total_len) {
+        msg->buffer_pos = comp->tx_raw_len;
+    }
+    msg->buffer = comp->tx_raw;
+    msg->buffer_len = msg->total_len = comp->tx_raw_len;
+    comp->tx_msg = NULL;
+    comp->tx_raw = NULL;
+}
+
+int MqttCompress_Message(MqttCompress *comp, MqttMessage *msg, byte msg_new,
+    byte msg_done, byte *result)
+{
+    int rc = MQTT_CODE_SUCCESS;
+    const char* topic;
+    word16 topic_len;
+    MqttPropView props;
+
+    *result = MQTT_COMPRESS_MSG_PLAIN;
+    if (msg_new) {
+        /* previous message was not completed */
+        MqttCompress_Release(comp);
+
+        if (comp->rx_buf == NULL || !MqttCompress_IsDeflated(msg)) {
+            return MQTT_CODE_SUCCESS;
+        }
+        rc = MqttCompress_Start(comp, msg, msg_done);
+    }
+    if (!comp->rx_active) {
+        return rc;
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+        rc = MqttCompress_Inflate(comp, msg, msg_done);
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        MqttCompress_Release(comp);
+        return rc;
+    }
+    if (!msg_done) {
+        *result = MQTT_COMPRESS_MSG_SEGMENT;
+        return MQTT_CODE_SUCCESS;
+    }
+
+    /* Deliver the decompressed payload with the topic and properties of
+     * the first segment. The received values are kept for restoring. */
+    topic = msg->topic_name;
+    topic_len = msg->topic_name_len;
+    props = msg->props_view;
+    msg->topic_name = comp->rx_topic;
+    msg->topic_name_len = comp->rx_topic_len;
+    msg->props_view = comp->rx_props;
+    comp->rx_topic = topic;
+    comp->rx_topic_len = topic_len;
+    comp->rx_props = props;
+
+    comp->rx_raw = msg->buffer;
+    comp->rx_raw_len = msg->buffer_len;
+    comp->rx_raw_pos = msg->buffer_pos;
+    comp->rx_raw_total = msg->total_len;
+    msg->buffer = comp->rx_buf;
+    msg->buffer_len = msg->total_len = comp->rx_len;
+    msg->buffer_pos = 0;
+
+    *result = MQTT_COMPRESS_MSG_DONE;
+    return MQTT_CODE_SUCCESS;
+}
+
+void MqttCompress_MessageDone(MqttCompress *comp, MqttMessage *msg)
+{
+    if (!comp->rx_active) {
+        return;
+    }
+    msg->topic_name = comp->rx_topic;
+    msg->topic_name_len = comp->rx_topic_len;
+    msg->props_view = comp->rx_props;
+    msg->buffer = comp->rx_raw;
+    msg->buffer_len = comp->rx_raw_len;
+    msg->buffer_pos = comp->rx_raw_pos;
+    msg->total_len = comp->rx_raw_total;
+    MqttCompress_Release(comp);
+}
+
+#endif /* WOLFMQTT_COMPRESS */
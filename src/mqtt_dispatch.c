@@ -0,0 +1,420 @@
+/* mqtt_dispatch.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_DISPATCH: Enables the worker pool dispatcher for incoming publish
+ *  messages. Requires WOLFMQTT_MULTITHREAD. The reading thread copies each
+ *  message out of the receive buffer and queues it on a lock-free single
+ *  producer / single consumer ring owned by one worker. The worker is chosen
+ *  by topic hash, so messages on the same topic are handled in order.
+ *
+ * MQTT_DISPATCH_MAX_WORKERS: Maximum number of worker threads (default 64).
+ *
+ * MQTT_DISPATCH_DEF_DEPTH: Default per worker queue depth (default 256).
+ */
+
+#ifdef WOLFMQTT_DISPATCH
+
+/* Atomic access to the ring indexes and wait flags. The ring only needs
+ * acquire / release ordering. The wait flags need a full barrier between
+ * the index update and the flag check on both sides, so a sleeping side is
+ * never missed. */
+#if defined(__GNUC__) || defined(__clang__)
+    #define DISP_LOAD_ACQ(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define DISP_STORE_REL(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define DISP_LOAD_SEQ(p)     __atomic_load_n((p), __ATOMIC_SEQ_CST)
+    #define DISP_STORE_SEQ(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+    #define DISP_CAS(p, o, n)    __atomic_compare_exchange_n((p), &(o), (n), \
+                                    0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+    #define DISP_FENCE()         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#elif defined(USE_WINDOWS_API)
+    #define DISP_LOAD_ACQ(p)     InterlockedCompareExchange((volatile LONG*)(p), 0, 0)
+    #define DISP_STORE_REL(p, v) InterlockedExchange((volatile LONG*)(p), (LONG)(v))
+    #define DISP_LOAD_SEQ(p)     DISP_LOAD_ACQ(p)
+    #define DISP_STORE_SEQ(p, v) DISP_STORE_REL(p, v)
+    #define DISP_CAS(p, o, n)    (InterlockedCompareExchange((volatile LONG*)(p), \
+                                    (LONG)(n), (LONG)(o)) == (LONG)(o))
+    #define DISP_FENCE()         MemoryBarrier()
+#else
+    #error "WOLFMQTT_DISPATCH requires atomic operations!"
+#endif
+
+
+/* Private functions */
+
+#ifdef WOLFMQTT_USER_THREADING
+    /* User will supply their own thread functions.
+     * int wm_ThreadCreate(wm_Thread *t, void* (*func)(void*), void* arg)
+     * int wm_ThreadJoin(wm_Thread t)
+     */
+    #define DISP_THREAD_RET     void*
+    #define DISP_THREAD_EXIT    return NULL
+#elif defined(USE_WINDOWS_API)
+    #define DISP_THREAD_RET     DWORD WINAPI
+    #define DISP_THREAD_EXIT    return 0
+    typedef DWORD (WINAPI *wm_ThreadFunc)(LPVOID arg);
+    static int wm_ThreadCreate(wm_Thread *t, wm_ThreadFunc func, void* arg)
+    {
+        *t = CreateThread(NULL, 0, func, arg, 0, NULL);
+        return (*t == NULL) ? -1 : 0;
+    }
+    static int wm_ThreadJoin(wm_Thread t)
+    {
+        WaitForSingleObject(t, INFINITE);
+        CloseHandle(t);
+        return 0;
+    }
+#else
+    #define DISP_THREAD_RET     void*
+    #define DISP_THREAD_EXIT    return NULL
+    typedef void* (*wm_ThreadFunc)(void* arg);
+    static int wm_ThreadCreate(wm_Thread *t, wm_ThreadFunc func, void* arg)
+    {
+        return pthread_create(t, NULL, func, arg);
+    }
+    static int wm_ThreadJoin(wm_Thread t)
+    {
+        return pthread_join(t, NULL);
+    }
+#endif
+
+/* FNV-1a hash of topic name to select worker */
+static word32 MqttDispatch_Hash(const char* topic, word16 len)
+{
+    word32 hash = 0x811C9DC5UL;
+    word16 i;
+    for (i = 0; i < len; i++) {
+        hash ^= (byte)topic[i];
+        hash *= 0x01000193UL;
+    }
+    return hash;
+}
+
+/* Returns 0 on success or -1 if ring is full */
+static int MqttDispatch_RingPush(MqttDispatchRing* ring, MqttDispatchMsg* msg)
+{
+    word32 tail = ring->tail; /* only producer writes tail */
+    word32 head = DISP_LOAD_ACQ(&ring->head);
+
+    if ((tail - head) > ring->mask) {
+        return -1;
+    }
+    ring->slots[tail & ring->mask] = msg;
+    DISP_STORE_REL(&ring->tail, tail + 1);
+    return 0;
+}
+
+/* Returns message or NULL if ring is empty */
+static MqttDispatchMsg* MqttDispatch_RingPop(MqttDispatchRing* ring)
+{
+    MqttDispatchMsg* msg;
+    word32 head = ring->head; /* only consumer writes head */
+    word32 tail = DISP_LOAD_ACQ(&ring->tail);
+
+    if (head == tail) {
+        return NULL;
+    }
+    msg = ring->slots[head & ring->mask];
+    DISP_STORE_REL(&ring->head, head + 1);
+    return msg;
+}
+
+static DISP_THREAD_RET MqttDispatch_Worker(void* arg)
+{
+    MqttDispatchWorker* worker = (MqttDispatchWorker*)arg;
+    MqttDispatch* disp = worker->disp;
+    MqttDispatchMsg* msg;
+    int rc;
+
+    for (;;) {
+        msg = MqttDispatch_RingPop(&worker->ring);
+        if (msg == NULL) {
+            /* flag idle, then check again before sleeping so a message
+             * queued in between is not missed */
+            DISP_STORE_SEQ(&worker->idleWait, 1);
+            msg = MqttDispatch_RingPop(&worker->ring);
+            if (msg == NULL) {
+                if (DISP_LOAD_SEQ(&disp->running) == 0) {
+                    DISP_STORE_SEQ(&worker->idleWait, 0);
+                    break;
+                }
+                (void)wm_SemLock(&worker->dataSig);
+                DISP_STORE_SEQ(&worker->idleWait, 0);
+                continue;
+            }
+            DISP_STORE_SEQ(&worker->idleWait, 0);
+        }
+
+        /* wake reader if it is waiting for a free slot */
+        DISP_FENCE();
+        if (DISP_LOAD_SEQ(&worker->fullWait)) {
+            (void)wm_SemUnlock(&worker->spaceSig);
+        }
+
+        /* ownership of message passes to handler */
+        rc = disp->cb(msg, disp->ctx);
+        if (rc != MQTT_CODE_SUCCESS) {
+            int expected = MQTT_CODE_SUCCESS;
+            (void)DISP_CAS(&disp->error, expected, rc);
+        }
+        worker->count++;
+    }
+
+    DISP_THREAD_EXIT;
+}
+
+static int MqttDispatch_Queue(MqttDispatch* disp, MqttDispatchMsg* msg,
+    word32 hash)
+{
+    MqttDispatchWorker* worker = &disp->workers[hash % disp->worker_count];
+
+    while (MqttDispatch_RingPush(&worker->ring, msg) != 0) {
+        /* queue full, wait for worker to free a slot */
+        DISP_STORE_SEQ(&worker->fullWait, 1);
+        if (MqttDispatch_RingPush(&worker->ring, msg) == 0) {
+            DISP_STORE_SEQ(&worker->fullWait, 0);
+            break;
+        }
+        (void)wm_SemLock(&worker->spaceSig);
+        DISP_STORE_SEQ(&worker->fullWait, 0);
+    }
+
+    /* wake worker if it is waiting for data */
+    DISP_FENCE();
+    if (DISP_LOAD_SEQ(&worker->idleWait)) {
+        (void)wm_SemUnlock(&worker->dataSig);
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+
+/* Public Functions */
+int MqttDispatch_Init(MqttDispatch *disp, int worker_count, int depth,
+    MqttDispatchCb cb, void *ctx)
+{
+    int rc = MQTT_CODE_SUCCESS, i;
+
+    if (disp == NULL || cb == NULL || worker_count <= 0 ||
+        worker_count > MQTT_DISPATCH_MAX_WORKERS || depth < 0 ||
+        (depth & (depth - 1)) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (depth == 0) {
+        depth = MQTT_DISPATCH_DEF_DEPTH;
+    }
+
+    XMEMSET(disp, 0, sizeof(MqttDispatch));
+    disp->cb = cb;
+    disp->ctx = ctx;
+    disp->running = 1;
+
+    disp->workers = (MqttDispatchWorker*)WOLFMQTT_MALLOC(
+        sizeof(MqttDispatchWorker) * worker_count);
+    if (disp->workers == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    XMEMSET(disp->workers, 0, sizeof(MqttDispatchWorker) * worker_count);
+
+    for (i = 0; i < worker_count && rc == MQTT_CODE_SUCCESS; i++) {
+        MqttDispatchWorker* worker = &disp->workers[i];
+        worker->disp = disp;
+        worker->ring.mask = (word32)depth - 1;
+        worker->ring.slots = (MqttDispatchMsg**)WOLFMQTT_MALLOC(
+            sizeof(MqttDispatchMsg*) * depth);
+        if (worker->ring.slots == NULL) {
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+            break;
+        }
+        disp->worker_count++;
+
+        /* signals start taken, so a wait blocks until the other side
+         * unlocks them */
+        if (wm_SemInit(&worker->dataSig) != 0 ||
+            wm_SemInit(&worker->spaceSig) != 0) {
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+            break;
+        }
+        (void)wm_SemLock(&worker->dataSig);
+        (void)wm_SemLock(&worker->spaceSig);
+
+        if (wm_ThreadCreate(&worker->thread, MqttDispatch_Worker,
+                worker) != 0) {
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+            break;
+        }
+        worker->started = 1;
+    }
+
+    if (rc != MQTT_CODE_SUCCESS) {
+        MqttDispatch_Free(disp);
+    }
+    return rc;
+}
+
+void MqttDispatch_Free(MqttDispatch *disp)
+{
+    int i;
+
+    if (disp == NULL || disp->workers == NULL) {
+        return;
+    }
+
+    /* workers drain their queue before exiting */
+    DISP_STORE_SEQ(&disp->running, 0);
+    for (i = 0; i < disp->worker_count; i++) {
+        MqttDispatchWorker* worker = &disp->workers[i];
+        if (worker->started) {
+            (void)wm_SemUnlock(&worker->dataSig);
+            (void)wm_ThreadJoin(worker->thread);
+            worker->started = 0;
+        }
+    }
+    for (i = 0; i < disp->worker_count; i++) {
+        MqttDispatchWorker* worker = &disp->workers[i];
+        if (worker->ring.slots != NULL) {
+            (void)wm_SemFree(&worker->dataSig);
+            (void)wm_SemFree(&worker->spaceSig);
+            WOLFMQTT_FREE(worker->ring.slots);
+        }
+    }
+    WOLFMQTT_FREE(disp->workers);
+    disp->workers = NULL;
+    disp->worker_count = 0;
+
+    if (disp->cur != NULL) {
+        MqttDispatch_MsgFree(disp->cur);
+        disp->cur = NULL;
+    }
+}
+
+int MqttDispatch_Message(MqttDispatch *disp, MqttClient *client,
+    MqttMessage *msg, byte msg_new, byte msg_done)
+{
+    int rc;
+    MqttDispatchMsg* dmsg;
+
+    if (disp == NULL || msg == NULL || disp->workers == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* report failure from a handler to the reader */
+    rc = DISP_LOAD_SEQ(&disp->error);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    if (msg_new) {
+        word32 alloc_len;
+    #ifdef WOLFMQTT_MSG_POOL
+        MqttMsgBuf* msg_buf = NULL;
+    #endif
+
+        if (disp->cur != NULL) {
+            /* previous message was not completed */
+            MqttDispatch_MsgFree(disp->cur);
+            disp->cur = NULL;
+        }
+
+        /* single allocation for message, topic and payload */
+        alloc_len = sizeof(MqttDispatchMsg) + msg->topic_name_len + 1;
+    #ifdef WOLFMQTT_MSG_POOL
+        /* keep the payload in the pooled receive buffer */
+        if (msg_done && client != NULL && client->msg_pool != NULL) {
+            msg_buf = MqttClient_MsgRetain(client, msg);
+        }
+        if (msg_buf == NULL)
+    #endif
+        {
+            alloc_len += msg->total_len;
+        }
+        dmsg = (MqttDispatchMsg*)WOLFMQTT_MALLOC(alloc_len);
+        if (dmsg == NULL) {
+        #ifdef WOLFMQTT_MSG_POOL
+            MqttMsgBuf_Release(msg_buf);
+        #endif
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+        dmsg->client = client;
+        dmsg->packet_id = msg->packet_id;
+        dmsg->qos = msg->qos;
+        dmsg->retain = msg->retain;
+        dmsg->duplicate = msg->duplicate;
+        dmsg->topic_name = (char*)dmsg + sizeof(MqttDispatchMsg);
+        dmsg->topic_name_len = msg->topic_name_len;
+        if (msg->topic_name_len > 0) {
+            XMEMCPY(dmsg->topic_name, msg->topic_name, msg->topic_name_len);
+        }
+        dmsg->topic_name[msg->topic_name_len] = '\0';
+        dmsg->buffer = (byte*)dmsg->topic_name + msg->topic_name_len + 1;
+        dmsg->total_len = msg->total_len;
+    #ifdef WOLFMQTT_MSG_POOL
+        dmsg->msg_buf = msg_buf;
+        if (msg_buf != NULL) {
+            dmsg->buffer = msg_buf->buffer;
+        }
+    #endif
+
+        disp->cur = dmsg;
+        disp->cur_hash = MqttDispatch_Hash(msg->topic_name,
+            msg->topic_name_len);
+    }
+
+    dmsg = disp->cur;
+    if (dmsg == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_STAT);
+    }
+
+    /* copy payload segment (unless retained in place) */
+    if (msg->buffer_len > 0 && dmsg->buffer != msg->buffer) {
+        if (msg->buffer_pos + msg->buffer_len > dmsg->total_len) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+        }
+        XMEMCPY(&dmsg->buffer[msg->buffer_pos], msg->buffer,
+            msg->buffer_len);
+    }
+
+    if (msg_done) {
+        disp->cur = NULL;
+        rc = MqttDispatch_Queue(disp, dmsg, disp->cur_hash);
+    }
+
+    return rc;
+}
+
+void MqttDispatch_MsgFree(MqttDispatchMsg *msg)
+{
+    if (msg != NULL) {
+    #ifdef WOLFMQTT_MSG_POOL
+        MqttMsgBuf_Release(msg->msg_buf);
+    #endif
+        WOLFMQTT_FREE(msg);
+    }
+}
+
+#endif /* WOLFMQTT_DISPATCH */
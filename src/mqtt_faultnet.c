@@ -0,0 +1,532 @@
+/* mqtt_faultnet.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_FAULTNET: Enables a network wrapper that injects faults into
+ *  the MqttNet callbacks of another network: latency, jitter, a rate
+ *  limit, partial reads and writes, loss of datagrams and broken
+ *  connections, to measure a client under a bad network.
+ *
+ * MQTT_FAULTNET_STAGE_SIZE: Most bytes of one read held for latency
+ *  (default 2048).
+ */
+
+#ifdef WOLFMQTT_FAULTNET
+
+/* Clock and sleep of the delays */
+#if defined(USE_WINDOWS_API)
+    #include <windows.h>
+    #define FAULTNET_HAVE_CLOCK
+    static word32 MqttFaultNet_NowMs(void)
+    {
+        return (word32)GetTickCount();
+    }
+    static void MqttFaultNet_SleepMs(word32 ms)
+    {
+        Sleep(ms);
+    }
+#elif defined(__linux__) || defined(__MACH__) || defined(__FreeBSD__) || \
+      defined(__QNX__)
+    #include <time.h>
+    #define FAULTNET_HAVE_CLOCK
+    static word32 MqttFaultNet_NowMs(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (word32)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+    }
+    static void MqttFaultNet_SleepMs(word32 ms)
+    {
+        struct timespec ts;
+        ts.tv_sec = (time_t)(ms / 1000);
+        ts.tv_nsec = (long)(ms % 1000) * 1000000;
+        (void)nanosleep(&ts, NULL);
+    }
+#else
+    static word32 MqttFaultNet_NowMs(void)
+    {
+        return 0;
+    }
+    static void MqttFaultNet_SleepMs(word32 ms)
+    {
+        (void)ms;
+    }
+#endif
+
+/* Keeps the product of the bytes and 1000 in range */
+#define FAULTNET_EPOCH_BYTES    0x100000
+
+
+/* Private functions */
+
+static word32 MqttFaultNet_Rand(MqttFaultNet *fault)
+{
+    /* xorshift32 */
+    word32 x = fault->rand;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    fault->rand = x;
+    return x;
+}
+
+static int MqttFaultNet_Lost(MqttFaultNet *fault)
+{
+    return fault->cfg.datagram && fault->cfg.loss_permille > 0 &&
+        (MqttFaultNet_Rand(fault) % 1000) < fault->cfg.loss_permille;
+}
+
+/* Time to send the bytes at the rate */
+static word32 MqttFaultNet_RateMs(word32 rate, word32 bytes)
+{
+    word32 rem = bytes % rate;
+
+    return (bytes / rate) * 1000 +
+        ((rem < 4294967) ? rem * 1000 / rate : rem / (rate / 1000));
+}
+
+/* Adds bytes to one way of the link, returns when the last one is sent */
+static word32 MqttFaultNet_LinkAdd(word32 rate, word32 *epoch,
+    word32 *bytes, word32 now, word32 len)
+{
+    word32 due = *epoch + MqttFaultNet_RateMs(rate, *bytes);
+
+    if ((int)(now - due) > 0) {
+        /* Idle since */
+        *epoch = now;
+        *bytes = 0;
+    }
+    else if (*bytes >= FAULTNET_EPOCH_BYTES) {
+        *epoch = due;
+        *bytes = 0;
+    }
+    *bytes += len;
+    return *epoch + MqttFaultNet_RateMs(rate, *bytes);
+}
+
+/* Returns MQTT_CODE_SUCCESS once due, or the code to return */
+static int MqttFaultNet_Wait(MqttFaultNet *fault, word32 due, int timeout_ms)
+{
+    word32 left = due - MqttFaultNet_NowMs();
+
+    if ((int)left <= 0) {
+        return MQTT_CODE_SUCCESS;
+    }
+    if (fault->nonblock) {
+        return MQTT_CODE_CONTINUE;
+    }
+    if (timeout_ms > 0 && left > (word32)timeout_ms) {
+        MqttFaultNet_SleepMs((word32)timeout_ms);
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    MqttFaultNet_SleepMs(left);
+    return MQTT_CODE_SUCCESS;
+}
+
+static void MqttFaultNet_DoBreak(MqttFaultNet *fault, int silent)
+{
+    if (!fault->broken) {
+        fault->broken = silent ? 2 : 1;
+        fault->stats.breaks++;
+        fault->stats.break_ms = MqttFaultNet_NowMs();
+        fault->stage_len = 0;
+        fault->gated = 0;
+        /* The peer sees the connection close */
+        if (!silent && fault->inner->disconnect != NULL) {
+            (void)fault->inner->disconnect(fault->inner->context);
+        }
+    }
+}
+
+/* Returns MQTT_CODE_SUCCESS while the connection is up */
+static int MqttFaultNet_Check(MqttFaultNet *fault)
+{
+    if (!fault->broken &&
+            ((fault->cfg.break_after_ms > 0 &&
+              MqttFaultNet_NowMs() - fault->connect_ms >=
+                fault->cfg.break_after_ms) ||
+             (fault->cfg.break_after_bytes > 0 &&
+              fault->conn_bytes >= fault->cfg.break_after_bytes))) {
+        MqttFaultNet_DoBreak(fault, fault->cfg.silent_break);
+    }
+    return (fault->broken == 1) ? MQTT_CODE_ERROR_NETWORK :
+        MQTT_CODE_SUCCESS;
+}
+
+/* Read of a silent break, nothing arrives */
+static int MqttFaultNet_Silent(MqttFaultNet *fault, int timeout_ms)
+{
+    if (fault->nonblock) {
+        return MQTT_CODE_CONTINUE;
+    }
+    MqttFaultNet_SleepMs((timeout_ms > 0) ? (word32)timeout_ms : 1);
+    return MQTT_CODE_ERROR_TIMEOUT;
+}
+
+/* Time the data read now from the inner network is returned */
+static word32 MqttFaultNet_Due(MqttFaultNet *fault, word32 now, int len)
+{
+    word32 arrival, due, link;
+
+    if (fault->drained) {
+        arrival = now;
+        due = arrival + fault->cfg.latency_ms;
+        if (fault->cfg.jitter_ms > 0) {
+            due += MqttFaultNet_Rand(fault) % (fault->cfg.jitter_ms + 1);
+        }
+        if ((int)(due - fault->last_due) < 0) {
+            /* In order */
+            due = fault->last_due;
+        }
+    }
+    else {
+        /* Ready at once, so it came with the data before */
+        arrival = fault->last_arrival;
+        due = fault->last_due;
+    }
+    fault->drained = 0;
+    if (fault->cfg.rate > 0) {
+        link = MqttFaultNet_LinkAdd(fault->cfg.rate, &fault->rx_epoch,
+            &fault->rx_epoch_bytes, arrival, (word32)len);
+        if ((int)(link - due) > 0) {
+            due = link;
+        }
+    }
+    if ((int)(due - now) > 0) {
+        fault->stats.delayed++;
+    }
+    fault->last_arrival = arrival;
+    fault->last_due = due;
+    return due;
+}
+
+static int MqttFaultNet_Connect(void *context, const char* host,
+    word16 port, int timeout_ms)
+{
+    MqttFaultNet *fault = (MqttFaultNet*)context;
+    int rc;
+
+    if (fault == NULL || fault->inner->connect == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = fault->inner->connect(fault->inner->context, host, port,
+        timeout_ms);
+    if (rc == MQTT_CODE_SUCCESS) {
+        fault->connect_ms = MqttFaultNet_NowMs();
+        fault->conn_bytes = 0;
+        fault->last_arrival = fault->connect_ms;
+        fault->last_due = fault->connect_ms;
+        fault->rx_epoch = fault->tx_epoch = fault->connect_ms;
+        fault->rx_epoch_bytes = fault->tx_epoch_bytes = 0;
+        fault->stage_len = 0;
+        fault->stage_pos = 0;
+        fault->broken = 0;
+        fault->drained = 1;
+        fault->gated = 0;
+        fault->stats.connects++;
+    }
+    return rc;
+}
+
+static int MqttFaultNet_Read(void *context, byte* buf, int buf_len,
+    int timeout_ms)
+{
+    MqttFaultNet *fault = (MqttFaultNet*)context;
+    word32 start;
+    int rc, len;
+
+    if (fault == NULL || buf == NULL || buf_len <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = MqttFaultNet_Check(fault);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    if (fault->broken) {
+        return MqttFaultNet_Silent(fault, timeout_ms);
+    }
+
+    if (fault->gated) {
+        /* Datagram already delayed by the peek */
+        fault->gated = 0;
+        rc = fault->inner->read(fault->inner->context, buf, buf_len,
+            timeout_ms);
+        if (rc > 0) {
+            fault->stats.rx_bytes += (word32)rc;
+            fault->conn_bytes += (word32)rc;
+        }
+        return rc;
+    }
+
+    while (fault->stage_len == 0) {
+        len = (buf_len < (int)sizeof(fault->stage)) ? buf_len :
+            (int)sizeof(fault->stage);
+        start = MqttFaultNet_NowMs();
+        rc = fault->inner->read(fault->inner->context, fault->stage, len,
+            timeout_ms);
+        if (MqttFaultNet_NowMs() != start) {
+            /* Waited for it */
+            fault->drained = 1;
+        }
+        if (rc <= 0) {
+            if (rc == MQTT_CODE_CONTINUE || rc == MQTT_CODE_ERROR_TIMEOUT) {
+                fault->drained = 1;
+            }
+            return rc;
+        }
+        fault->conn_bytes += (word32)rc;
+        if (MqttFaultNet_Lost(fault)) {
+            fault->stats.dropped++;
+            fault->drained = 1;
+            if (fault->nonblock) {
+                return MQTT_CODE_CONTINUE;
+            }
+            continue;
+        }
+        fault->stage_due = MqttFaultNet_Due(fault, MqttFaultNet_NowMs(),
+            rc);
+        fault->stage_len = rc;
+        fault->stage_pos = 0;
+    }
+
+    rc = MqttFaultNet_Wait(fault, fault->stage_due, timeout_ms);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    len = fault->stage_len - fault->stage_pos;
+    if (len > buf_len) {
+        len = buf_len;
+    }
+    if (!fault->cfg.datagram && fault->cfg.max_read > 0 &&
+            len > (int)fault->cfg.max_read) {
+        len = (int)fault->cfg.max_read;
+    }
+    XMEMCPY(buf, &fault->stage[fault->stage_pos], len);
+    fault->stage_pos += len;
+    if (fault->cfg.datagram || fault->stage_pos == fault->stage_len) {
+        /* The rest of a datagram is discarded, as by a socket */
+        fault->stage_len = 0;
+    }
+    fault->stats.rx_bytes += (word32)len;
+
+    return len;
+}
+
+#ifdef WOLFMQTT_SN
+static int MqttFaultNet_Peek(void *context, byte* buf, int buf_len,
+    int timeout_ms)
+{
+    MqttFaultNet *fault = (MqttFaultNet*)context;
+    word32 start;
+    int rc, len;
+
+    if (fault == NULL || buf == NULL || buf_len <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = MqttFaultNet_Check(fault);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    if (fault->broken) {
+        return MqttFaultNet_Silent(fault, timeout_ms);
+    }
+
+    for (;;) {
+        start = MqttFaultNet_NowMs();
+        len = fault->inner->peek(fault->inner->context, buf, buf_len,
+            timeout_ms);
+        if (MqttFaultNet_NowMs() != start) {
+            fault->drained = 1;
+        }
+        if (len <= 0) {
+            if (len == MQTT_CODE_CONTINUE ||
+                    len == MQTT_CODE_ERROR_TIMEOUT) {
+                fault->drained = 1;
+            }
+            return len;
+        }
+        if (fault->gated != 0) {
+            break;
+        }
+        /* First sight of the datagram */
+        if (MqttFaultNet_Lost(fault)) {
+            (void)fault->inner->read(fault->inner->context, fault->stage,
+                (int)sizeof(fault->stage), timeout_ms);
+            fault->stats.dropped++;
+            fault->drained = 1;
+            if (fault->nonblock) {
+                return MQTT_CODE_CONTINUE;
+            }
+            continue;
+        }
+        fault->stage_due = MqttFaultNet_Due(fault, MqttFaultNet_NowMs(),
+            len);
+        fault->gated = 1;
+        break;
+    }
+
+    if (fault->gated == 1) {
+        rc = MqttFaultNet_Wait(fault, fault->stage_due, timeout_ms);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+        fault->gated = 2;
+    }
+    return len;
+}
+#endif
+
+static int MqttFaultNet_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    MqttFaultNet *fault = (MqttFaultNet*)context;
+    word32 now;
+    int rc, len = buf_len;
+
+    if (fault == NULL || buf == NULL || buf_len <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = MqttFaultNet_Check(fault);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+    if (fault->cfg.rate > 0) {
+        /* Wait for the link to send the previous writes */
+        rc = MqttFaultNet_Wait(fault, fault->tx_epoch +
+            MqttFaultNet_RateMs(fault->cfg.rate, fault->tx_epoch_bytes),
+            timeout_ms);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+    }
+
+    if (fault->broken) {
+        /* Silent break */
+        rc = len;
+    }
+    else if (MqttFaultNet_Lost(fault)) {
+        fault->stats.dropped++;
+        rc = len;
+    }
+    else {
+        if (!fault->cfg.datagram && fault->cfg.max_write > 0 &&
+                len > (int)fault->cfg.max_write) {
+            len = (int)fault->cfg.max_write;
+        }
+        rc = fault->inner->write(fault->inner->context, buf, len,
+            timeout_ms);
+    }
+    if (rc > 0) {
+        now = MqttFaultNet_NowMs();
+        if (fault->cfg.rate > 0) {
+            (void)MqttFaultNet_LinkAdd(fault->cfg.rate, &fault->tx_epoch,
+                &fault->tx_epoch_bytes, now, (word32)rc);
+        }
+        fault->stats.tx_bytes += (word32)rc;
+        fault->conn_bytes += (word32)rc;
+        /* Data read next answers it */
+        fault->drained = 1;
+    }
+    return rc;
+}
+
+static int MqttFaultNet_Disconnect(void *context)
+{
+    MqttFaultNet *fault = (MqttFaultNet*)context;
+
+    if (fault == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    fault->stage_len = 0;
+    fault->gated = 0;
+    if (fault->inner->disconnect == NULL) {
+        return MQTT_CODE_SUCCESS;
+    }
+    return fault->inner->disconnect(fault->inner->context);
+}
+
+
+/* Public Functions */
+
+int MqttFaultNet_Init(MqttNet *net, MqttFaultNet *fault, MqttNet *inner,
+    const MqttFaultCfg *cfg)
+{
+    if (net == NULL || fault == NULL || inner == NULL || cfg == NULL ||
+            net == inner || inner->read == NULL || inner->write == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+#ifndef FAULTNET_HAVE_CLOCK
+    if (cfg->latency_ms > 0 || cfg->jitter_ms > 0 || cfg->rate > 0 ||
+            cfg->break_after_ms > 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+#endif
+    XMEMSET(fault, 0, sizeof(MqttFaultNet));
+    fault->inner = inner;
+    XMEMCPY(&fault->cfg, cfg, sizeof(MqttFaultCfg));
+    fault->rand = (cfg->seed != 0) ? cfg->seed : 0x2545F491;
+    fault->drained = 1;
+#ifdef WOLFMQTT_NONBLOCK
+    fault->nonblock = 1;
+#endif
+
+    XMEMSET(net, 0, sizeof(MqttNet));
+    net->context = fault;
+    net->connect = MqttFaultNet_Connect;
+    net->read = MqttFaultNet_Read;
+    net->write = MqttFaultNet_Write;
+    net->disconnect = MqttFaultNet_Disconnect;
+#ifdef WOLFMQTT_SN
+    if (inner->peek != NULL) {
+        net->peek = MqttFaultNet_Peek;
+    }
+    net->multi_ctx = inner->multi_ctx;
+#endif
+
+    return MQTT_CODE_SUCCESS;
+}
+
+void MqttFaultNet_Break(MqttFaultNet *fault, int silent)
+{
+    if (fault != NULL && fault->inner != NULL) {
+        MqttFaultNet_DoBreak(fault, silent);
+    }
+}
+
+int MqttFaultNet_Held(MqttFaultNet *fault)
+{
+    if (fault == NULL) {
+        return 0;
+    }
+    return fault->stage_len - fault->stage_pos;
+}
+
+#endif /* WOLFMQTT_FAULTNET */
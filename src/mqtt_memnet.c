@@ -0,0 +1,319 @@
+/* mqtt_memnet.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_MEMNET: Enables the in-memory network transport. A pipe holds
+ *  a lock-free single reader / single writer byte ring each way, and each
+ *  end provides the MqttNet callbacks, so a client and a test peer (such
+ *  as the in-process broker) run in the same process, in one thread or
+ *  across threads, without system calls.
+ *
+ * MQTT_MEMNET_DEF_SIZE: Default size of each ring (default 64 KB).
+ *
+ * MQTT_MEMNET_CACHE_LINE: Padding between the ring indexes (default 64).
+ */
+
+#ifdef WOLFMQTT_MEMNET
+
+/* Atomic access to the ring indexes and the closed flag. The ring only
+ * needs acquire / release ordering. Without atomic operations a pipe may
+ * only be used from one thread. */
+#if defined(__GNUC__) || defined(__clang__)
+    #define MEMNET_LOAD_ACQ(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define MEMNET_STORE_REL(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#elif defined(USE_WINDOWS_API)
+    #define MEMNET_LOAD_ACQ(p)      InterlockedCompareExchange((volatile LONG*)(p), 0, 0)
+    #define MEMNET_STORE_REL(p, v)  InterlockedExchange((volatile LONG*)(p), (LONG)(v))
+#else
+    #define MEMNET_LOAD_ACQ(p)      (*(volatile word32*)(p))
+    #define MEMNET_STORE_REL(p, v)  (*(volatile word32*)(p) = (v))
+#endif
+
+/* Default wait of a blocking end: yield to the other threads until the
+ * timeout. Without a clock it times out at once, so a wait callback is
+ * needed to run the peer. */
+#if defined(USE_WINDOWS_API)
+    #include <windows.h>
+    #define MEMNET_HAVE_WAIT
+    #define MEMNET_YIELD()          (void)SwitchToThread()
+    static word32 MqttMemNet_NowMs(void)
+    {
+        return (word32)GetTickCount();
+    }
+#elif defined(__linux__) || defined(__MACH__) || defined(__FreeBSD__) || \
+      defined(__QNX__)
+    #include <sched.h>
+    #include <time.h>
+    #define MEMNET_HAVE_WAIT
+    #define MEMNET_YIELD()          (void)sched_yield()
+    static word32 MqttMemNet_NowMs(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (word32)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+    }
+#endif
+
+
+/* Private functions */
+
+/* Returns MQTT_CODE_SUCCESS to check the ring again, or the code to
+   return */
+static int MqttMemNet_Wait(MqttMemNet *mem, int timeout_ms, word32 waits,
+    word32 *start)
+{
+    if (waits == 0) {
+        mem->waits++;
+    }
+    if (mem->wait_cb != NULL) {
+        return mem->wait_cb(mem->wait_ctx, timeout_ms, waits);
+    }
+    if (mem->nonblock) {
+        return MQTT_CODE_CONTINUE;
+    }
+#ifdef MEMNET_HAVE_WAIT
+    if (waits == 0) {
+        *start = MqttMemNet_NowMs();
+    }
+    else if ((int)(MqttMemNet_NowMs() - *start) >= timeout_ms) {
+        return MQTT_CODE_ERROR_TIMEOUT;
+    }
+    MEMNET_YIELD();
+    return MQTT_CODE_SUCCESS;
+#else
+    (void)timeout_ms;
+    (void)start;
+    return MQTT_CODE_ERROR_TIMEOUT;
+#endif
+}
+
+static int MqttMemNet_Connect(void *context, const char* host, word16 port,
+    int timeout_ms)
+{
+    MqttMemNet *mem = (MqttMemNet*)context;
+
+    (void)host;
+    (void)port;
+    (void)timeout_ms;
+    if (mem == NULL || mem->pipe == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (MEMNET_LOAD_ACQ(&mem->pipe->closed)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_NETWORK);
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+static int MqttMemNet_Read(void *context, byte* buf, int buf_len,
+    int timeout_ms)
+{
+    MqttMemNet *mem = (MqttMemNet*)context;
+    MqttMemRing *ring;
+    word32 head, avail, pos, len, waits = 0, start = 0;
+    int rc;
+
+    if (mem == NULL || buf == NULL || buf_len <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    ring = mem->rx;
+    head = ring->head;
+    for (;;) {
+        avail = MEMNET_LOAD_ACQ(&ring->tail) - head;
+        if (avail > 0) {
+            break;
+        }
+        if (MEMNET_LOAD_ACQ(&mem->pipe->closed)) {
+            /* Checked after the ring, so no data written before the close
+               is lost */
+            if (MEMNET_LOAD_ACQ(&ring->tail) == head) {
+                return MQTT_CODE_ERROR_NETWORK;
+            }
+            continue;
+        }
+        rc = MqttMemNet_Wait(mem, timeout_ms, waits++, &start);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+    }
+
+    len = (avail < (word32)buf_len) ? avail : (word32)buf_len;
+    pos = head & ring->mask;
+    if (pos + len > ring->mask + 1) {
+        /* Wraps around the end of the ring */
+        avail = ring->mask + 1 - pos;
+        XMEMCPY(buf, &ring->buf[pos], avail);
+        XMEMCPY(&buf[avail], ring->buf, len - avail);
+    }
+    else {
+        XMEMCPY(buf, &ring->buf[pos], len);
+    }
+    MEMNET_STORE_REL(&ring->head, head + len);
+    mem->rx_bytes += len;
+
+    return (int)len;
+}
+
+static int MqttMemNet_Write(void *context, const byte* buf, int buf_len,
+    int timeout_ms)
+{
+    MqttMemNet *mem = (MqttMemNet*)context;
+    MqttMemRing *ring;
+    word32 tail, room, pos, len, waits = 0, start = 0;
+    int rc;
+
+    if (mem == NULL || buf == NULL || buf_len <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    ring = mem->tx;
+    tail = ring->tail;
+    for (;;) {
+        if (MEMNET_LOAD_ACQ(&mem->pipe->closed)) {
+            return MQTT_CODE_ERROR_NETWORK;
+        }
+        room = ring->mask + 1 - (tail - MEMNET_LOAD_ACQ(&ring->head));
+        if (room > 0) {
+            break;
+        }
+        rc = MqttMemNet_Wait(mem, timeout_ms, waits++, &start);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+    }
+
+    /* A partial write when the ring is almost full */
+    len = (room < (word32)buf_len) ? room : (word32)buf_len;
+    pos = tail & ring->mask;
+    if (pos + len > ring->mask + 1) {
+        room = ring->mask + 1 - pos;
+        XMEMCPY(&ring->buf[pos], buf, room);
+        XMEMCPY(ring->buf, &buf[room], len - room);
+    }
+    else {
+        XMEMCPY(&ring->buf[pos], buf, len);
+    }
+    MEMNET_STORE_REL(&ring->tail, tail + len);
+    mem->tx_bytes += len;
+
+    return (int)len;
+}
+
+static int MqttMemNet_Disconnect(void *context)
+{
+    MqttMemNet *mem = (MqttMemNet*)context;
+
+    if (mem != NULL && mem->pipe != NULL) {
+        MEMNET_STORE_REL(&mem->pipe->closed, 1);
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+
+/* Public Functions */
+
+int MqttMemNet_PipeInit(MqttMemPipe *pipe, word32 size)
+{
+    int i;
+
+    if (pipe == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (size == 0) {
+        size = MQTT_MEMNET_DEF_SIZE;
+    }
+    if ((size & (size - 1)) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(pipe, 0, sizeof(MqttMemPipe));
+    for (i = 0; i < 2; i++) {
+        pipe->ring[i].buf = (byte*)WOLFMQTT_MALLOC(size);
+        if (pipe->ring[i].buf == NULL) {
+            MqttMemNet_PipeFree(pipe);
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+        }
+        pipe->ring[i].mask = size - 1;
+    }
+
+    return MQTT_CODE_SUCCESS;
+}
+
+void MqttMemNet_PipeFree(MqttMemPipe *pipe)
+{
+    int i;
+
+    if (pipe == NULL) {
+        return;
+    }
+    for (i = 0; i < 2; i++) {
+        if (pipe->ring[i].buf != NULL) {
+            WOLFMQTT_FREE(pipe->ring[i].buf);
+            pipe->ring[i].buf = NULL;
+        }
+    }
+}
+
+int MqttMemNet_Init(MqttNet *net, MqttMemNet *mem, MqttMemPipe *pipe,
+    byte side, MqttMemNetWaitCb wait_cb, void *wait_ctx)
+{
+    if (net == NULL || mem == NULL || pipe == NULL ||
+            pipe->ring[0].buf == NULL ||
+            (side != MQTT_MEMNET_SIDE_CLIENT &&
+             side != MQTT_MEMNET_SIDE_PEER)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(mem, 0, sizeof(MqttMemNet));
+    mem->pipe = pipe;
+    mem->tx = &pipe->ring[side];
+    mem->rx = &pipe->ring[!side];
+    mem->wait_cb = wait_cb;
+    mem->wait_ctx = wait_ctx;
+#ifdef WOLFMQTT_NONBLOCK
+    mem->nonblock = 1;
+#endif
+
+    XMEMSET(net, 0, sizeof(MqttNet));
+    net->context = mem;
+    net->connect = MqttMemNet_Connect;
+    net->read = MqttMemNet_Read;
+    net->write = MqttMemNet_Write;
+    net->disconnect = MqttMemNet_Disconnect;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+word32 MqttMemNet_Pending(MqttMemNet *mem)
+{
+    if (mem == NULL || mem->rx == NULL) {
+        return 0;
+    }
+    return MEMNET_LOAD_ACQ(&mem->rx->tail) - mem->rx->head;
+}
+
+#endif /* WOLFMQTT_MEMNET */
@@ -0,0 +1,163 @@
+/* mqtt_msgpool.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_MSG_POOL: Enables pooled, reference counted receive buffers.
+ *  With a pool set (MqttClient_SetMsgPool) the client reads each packet
+ *  into a pooled buffer, and the message callback can keep the message
+ *  with MqttClient_MsgRetain instead of copying it. The client switches to
+ *  a spare buffer for the next read and the retained buffer returns to the
+ *  pool once released.
+ */
+
+#ifdef WOLFMQTT_MSG_POOL
+
+/* Private functions */
+
+#ifdef WOLFMQTT_MULTITHREAD
+    #define MSGPOOL_LOCK(p)     wm_SemLock(&(p)->lock)
+    #define MSGPOOL_UNLOCK(p)   (void)wm_SemUnlock(&(p)->lock)
+#else
+    #define MSGPOOL_LOCK(p)     0
+    #define MSGPOOL_UNLOCK(p)
+#endif
+
+
+/* Public Functions */
+
+int MqttMsgPool_Init(MqttMsgPool *pool, int count, int buf_len)
+{
+    int i;
+
+    if (pool == NULL || count < 2 || buf_len <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(pool, 0, sizeof(MqttMsgPool));
+    pool->bufs = (MqttMsgBuf*)WOLFMQTT_MALLOC(sizeof(MqttMsgBuf) * count);
+    pool->mem = (byte*)WOLFMQTT_MALLOC((size_t)buf_len * count);
+    if (pool->bufs == NULL || pool->mem == NULL) {
+        if (pool->bufs) WOLFMQTT_FREE(pool->bufs);
+        if (pool->mem) WOLFMQTT_FREE(pool->mem);
+        pool->bufs = NULL;
+        pool->mem = NULL;
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemInit(&pool->lock) != 0) {
+        WOLFMQTT_FREE(pool->bufs);
+        WOLFMQTT_FREE(pool->mem);
+        pool->bufs = NULL;
+        pool->mem = NULL;
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+    XMEMSET(pool->bufs, 0, sizeof(MqttMsgBuf) * count);
+
+    pool->count = count;
+    pool->buf_len = buf_len;
+    for (i = count - 1; i >= 0; i--) {
+        MqttMsgBuf* buf = &pool->bufs[i];
+        buf->pool = pool;
+        buf->data = &pool->mem[(size_t)i * buf_len];
+        buf->next = pool->free_list;
+        pool->free_list = buf;
+    }
+    pool->free_count = count;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+int MqttMsgPool_Free(MqttMsgPool *pool)
+{
+    if (pool == NULL || pool->bufs == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (pool->free_count != pool->count) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_STAT);
+    }
+
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemFree(&pool->lock);
+#endif
+    WOLFMQTT_FREE(pool->bufs);
+    WOLFMQTT_FREE(pool->mem);
+    XMEMSET(pool, 0, sizeof(MqttMsgPool));
+
+    return MQTT_CODE_SUCCESS;
+}
+
+MqttMsgBuf* MqttMsgPool_Get(MqttMsgPool *pool)
+{
+    MqttMsgBuf* buf = NULL;
+
+    if (pool == NULL || MSGPOOL_LOCK(pool) != 0) {
+        return NULL;
+    }
+    if (pool->free_list != NULL) {
+        buf = pool->free_list;
+        pool->free_list = buf->next;
+        pool->free_count--;
+        buf->next = NULL;
+        buf->refs = 1;
+    }
+    MSGPOOL_UNLOCK(pool);
+
+    return buf;
+}
+
+void MqttMsgBuf_Retain(MqttMsgBuf *buf)
+{
+    if (buf != NULL && MSGPOOL_LOCK(buf->pool) == 0) {
+        buf->refs++;
+        MSGPOOL_UNLOCK(buf->pool);
+    }
+}
+
+void MqttMsgBuf_Release(MqttMsgBuf *buf)
+{
+    MqttMsgPool* pool;
+
+    if (buf == NULL) {
+        return;
+    }
+    pool = buf->pool;
+    if (MSGPOOL_LOCK(pool) == 0) {
+        if (buf->refs > 0 && --buf->refs == 0) {
+            buf->topic_name = NULL;
+            buf->buffer = NULL;
+            buf->next = pool->free_list;
+            pool->free_list = buf;
+            pool->free_count++;
+        }
+        MSGPOOL_UNLOCK(pool);
+    }
+}
+
+#endif /* WOLFMQTT_MSG_POOL */
@@ -333,20 +333,40 @@ int MqttDecode_String(byte *buf, const char **pstr, word16 *pstr_len)
     return len + str_len;
 }
 
-/* Returns number of buffer bytes encoded
-   If buf is NULL, return number of bytes that would be encoded. */
-int MqttEncode_String(byte *buf, const char *str)
+/* Returns number of buffer bytes encoded, or a (negative) error code if
+   WOLFMQTT_UTF8 is defined and the string is not valid.
+   If buf is NULL, return number of bytes that would be encoded (the string
+   is not validated). */
+int MqttEncode_Topic(byte *buf, const char *str, byte flags)
 {
     int str_len = (int)XSTRLEN(str);
-    int len = MqttEncode_Num(buf, (word16)str_len);
+    int len;
 
     if (buf != NULL) {
-        buf += len;
-        XMEMCPY(buf, str, str_len);
+    #ifdef WOLFMQTT_UTF8
+        int rc = MqttUtf8_Validate(str, (word32)str_len, flags);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+    #endif
+        len = MqttEncode_Num(buf, (word16)str_len);
+        XMEMCPY(buf + len, str, str_len);
+    }
+    else {
+        len = MQTT_DATA_LEN_SIZE;
     }
+    (void)flags;
     return len + str_len;
 }
 
+/* Returns number of buffer bytes encoded, or a (negative) error code if
+   WOLFMQTT_UTF8 is defined and the string is not valid.
+   If buf is NULL, return number of bytes that would be encoded. */
+int MqttEncode_String(byte *buf, const char *str)
+{
+    return MqttEncode_Topic(buf, str, 0);
+}
+
 /* Returns number of buffer bytes encoded
    If buf is NULL, return number of bytes that would be encoded. */
 int MqttEncode_Data(byte *buf, const byte *data, word16 data_len)
@@ -418,6 +438,10 @@ int MqttEncode_Props(MqttPacketType packet, MqttProp* props, byte* buf)
             {
                 tmp = MqttEncode_String(buf,
                         (const char*)cur_prop->data_str.str);
+                if (tmp < 0) {
+                    rc = tmp;
+                    break;
+                }
                 rc += tmp;
                 if (buf != NULL) {
                     buf += tmp;
@@ -449,6 +473,10 @@ int MqttEncode_Props(MqttPacketType packet, MqttProp* props, byte* buf)
                    gives the number of bytes */
                 tmp = MqttEncode_String(buf,
                         (const char*)cur_prop->data_str.str);
+                if (tmp < 0) {
+                    rc = tmp;
+                    break;
+                }
                 rc += tmp;
                 if (buf != NULL) {
                     buf += tmp;
@@ -456,6 +484,10 @@ int MqttEncode_Props(MqttPacketType packet, MqttProp* props, byte* buf)
 
                 tmp = MqttEncode_String(buf,
                         (const char*)cur_prop->data_str2.str);
+                if (tmp < 0) {
+                    rc = tmp;
+                    break;
+                }
                 rc += tmp;
                 if (buf != NULL) {
                     buf += tmp;
@@ -477,180 +509,214 @@ int MqttEncode_Props(MqttPacketType packet, MqttProp* props, byte* buf)
     return rc;
 }
 
+/* Decodes a single property. Data pointers reference the buffer.
+   Returns the (positive) number of bytes decoded, or a (negative) error code. */
+static int MqttDecode_Prop(MqttProp* prop, byte* pbuf, word32 buf_len)
+{
+    int rc, tmp;
+    byte* buf = pbuf;
+    word32 fixed_len = 0;
+
+    /* Decode the Identifier */
+    rc = MqttDecode_Vbi(buf, (word32*)&prop->type, buf_len);
+    if (rc < 0) {
+        return rc;
+    }
+    buf += rc;
+
+    if (prop->type >= sizeof(gPropMatrix) / sizeof(gPropMatrix[0])) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+    }
+
+    switch (gPropMatrix[prop->type].data)
+    {
+        case MQTT_DATA_TYPE_BYTE:
+            fixed_len = 1;
+            break;
+        case MQTT_DATA_TYPE_SHORT:
+        case MQTT_DATA_TYPE_BINARY:
+        case MQTT_DATA_TYPE_STRING:
+        case MQTT_DATA_TYPE_STRING_PAIR:
+            fixed_len = MQTT_DATA_LEN_SIZE;
+            break;
+        case MQTT_DATA_TYPE_INT:
+            fixed_len = MQTT_DATA_INT_SIZE;
+            break;
+        case MQTT_DATA_TYPE_VAR_INT:
+        case MQTT_DATA_TYPE_NONE:
+        default:
+            break;
+    }
+    if (fixed_len > (buf_len - (buf - pbuf))) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    switch (gPropMatrix[prop->type].data)
+    {
+        case MQTT_DATA_TYPE_BYTE:
+        {
+            prop->data_byte = *buf++;
+            break;
+        }
+        case MQTT_DATA_TYPE_SHORT:
+        {
+            buf += MqttDecode_Num(buf, &prop->data_short);
+            break;
+        }
+        case MQTT_DATA_TYPE_INT:
+        {
+            buf += MqttDecode_Int(buf, &prop->data_int);
+            break;
+        }
+        case MQTT_DATA_TYPE_STRING:
+        {
+            tmp = MqttDecode_String(buf, (const char**)&prop->data_str.str,
+                    &prop->data_str.len);
+            if ((tmp < 0) || ((word32)tmp > (buf_len - (buf - pbuf)))) {
+                /* Invalid length */
+                return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+            }
+            buf += tmp;
+            break;
+        }
+        case MQTT_DATA_TYPE_VAR_INT:
+        {
+            tmp = MqttDecode_Vbi(buf, &prop->data_int,
+                    (word32)(buf_len - (buf - pbuf)));
+            if (tmp < 0) {
+                return tmp;
+            }
+            buf += tmp;
+            break;
+        }
+        case MQTT_DATA_TYPE_BINARY:
+        {
+            /* Binary type is a two byte integer "length"
+               followed by that number of bytes */
+            buf += MqttDecode_Num(buf, &prop->data_bin.len);
+            if (prop->data_bin.len > (buf_len - (buf - pbuf))) {
+                /* Invalid length */
+                return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+            }
+            prop->data_bin.data = buf;
+            buf += prop->data_bin.len;
+            break;
+        }
+        case MQTT_DATA_TYPE_STRING_PAIR:
+        {
+            /* String is prefixed with a Two Byte Integer length
+               field that gives the number of bytes */
+            tmp = MqttDecode_String(buf, (const char**)&prop->data_str.str,
+                    &prop->data_str.len);
+            if ((tmp < 0) || ((word32)tmp > (buf_len - (buf - pbuf)))) {
+                /* Invalid length */
+                return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+            }
+            buf += tmp;
+            if ((buf_len - (buf - pbuf)) < MQTT_DATA_LEN_SIZE) {
+                /* Invalid length */
+                return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+            }
+            tmp = MqttDecode_String(buf, (const char**)&prop->data_str2.str,
+                    &prop->data_str2.len);
+            if ((tmp < 0) || ((word32)tmp > (buf_len - (buf - pbuf)))) {
+                /* Invalid length */
+                return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+            }
+            buf += tmp;
+            break;
+        }
+        case MQTT_DATA_TYPE_NONE:
+        default:
+        {
+            /* Invalid property data type */
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+        }
+    }
+
+    return (int)(buf - pbuf);
+}
+
+#ifdef WOLFMQTT_UTF8
+/* Checks the strings of a decoded property */
+static int MqttDecode_PropStrings(MqttProp* prop)
+{
+    int rc = MQTT_CODE_SUCCESS;
+
+    switch (gPropMatrix[prop->type].data)
+    {
+        case MQTT_DATA_TYPE_STRING_PAIR:
+            rc = MqttUtf8_Validate(prop->data_str2.str, prop->data_str2.len,
+                0);
+            if (rc != MQTT_CODE_SUCCESS) {
+                break;
+            }
+            FALL_THROUGH;
+        case MQTT_DATA_TYPE_STRING:
+            rc = MqttUtf8_Validate(prop->data_str.str, prop->data_str.len, 0);
+            break;
+        case MQTT_DATA_TYPE_BYTE:
+        case MQTT_DATA_TYPE_SHORT:
+        case MQTT_DATA_TYPE_INT:
+        case MQTT_DATA_TYPE_VAR_INT:
+        case MQTT_DATA_TYPE_BINARY:
+        case MQTT_DATA_TYPE_NONE:
+        default:
+            break;
+    }
+    return rc;
+}
+#endif
+
 /* Returns the (positive) number of bytes decoded, or a (negative) error code.
-   Allocates MqttProp structures for all properties.
+   Allocates MqttProp structures for all properties (from arena if not NULL).
    Head of list is stored in props. */
-int MqttDecode_Props(MqttPacketType packet, MqttProp** props, byte* pbuf,
-        word32 buf_len, word32 prop_len)
+int MqttDecode_Props(MqttPacketType packet, MqttPropArena* arena,
+        MqttProp** props, byte* pbuf, word32 buf_len, word32 prop_len)
 {
     int rc = 0;
-    int total, tmp;
+    int total = 0;
+#ifdef WOLFMQTT_UTF8
+    int tmp;
+#endif
     MqttProp* cur_prop;
     byte* buf = pbuf;
 
-    total = 0;
+    /* TODO: Validate property type is allowed for packet type */
+    (void)packet;
 
     while (((int)prop_len > 0) && (rc >= 0))
     {
         /* Allocate a structure and add to head. */
-        cur_prop = MqttProps_Add(props);
+        cur_prop = MqttProps_ArenaAdd(arena, props);
         if (cur_prop == NULL) {
             rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
             break;
         }
 
-        /* Decode the Identifier */
         if (buf_len < (word32)(buf - pbuf)) {
             rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
             break;
         }
-        rc = MqttDecode_Vbi(buf, (word32*)&cur_prop->type,
-                (word32)(buf_len - (buf - pbuf)));
+        rc = MqttDecode_Prop(cur_prop, buf, (word32)(buf_len - (buf - pbuf)));
         if (rc < 0) {
             break;
         }
-        tmp = rc;
-        buf += tmp;
-        total += tmp;
-        prop_len -= tmp;
-
-        /* TODO: Validate property type is allowed for packet type */
-        (void)packet;
-
-        if (cur_prop->type >= sizeof(gPropMatrix) / sizeof(gPropMatrix[0])) {
-            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
+    #ifdef WOLFMQTT_UTF8
+        tmp = MqttDecode_PropStrings(cur_prop);
+        if (tmp < 0) {
+            rc = tmp;
             break;
         }
-
-        switch (gPropMatrix[cur_prop->type].data)
-        {
-            case MQTT_DATA_TYPE_BYTE:
-            {
-                cur_prop->data_byte = *buf++;
-                tmp++;
-                total++;
-                prop_len--;
-                break;
-            }
-            case MQTT_DATA_TYPE_SHORT:
-            {
-                tmp = MqttDecode_Num(buf, &cur_prop->data_short);
-                buf += tmp;
-                total += tmp;
-                prop_len -= (word32)tmp;
-                break;
-            }
-            case MQTT_DATA_TYPE_INT:
-            {
-                tmp = MqttDecode_Int(buf, &cur_prop->data_int);
-                buf += tmp;
-                total += tmp;
-                prop_len -= tmp;
-                break;
-            }
-            case MQTT_DATA_TYPE_STRING:
-            {
-                tmp = MqttDecode_String(buf,
-                        (const char**)&cur_prop->data_str.str,
-                        &cur_prop->data_str.len);
-                if ((tmp >= 0) && ((word32)tmp <= (buf_len - (buf - pbuf)))) {
-                    buf += tmp;
-                    total += tmp;
-                    prop_len -= (word32)tmp;
-                }
-                else {
-                    /* Invalid length */
-                    rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
-                }
-                break;
-            }
-            case MQTT_DATA_TYPE_VAR_INT:
-            {
-                if (buf_len < (word32)(buf - pbuf)) {
-                    rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
-                    break;
-                }
-                tmp = MqttDecode_Vbi(buf, &cur_prop->data_int,
-                        (word32)(buf_len - (buf - pbuf)));
-                if (tmp < 0) {
-                    return tmp;
-                }
-                buf += tmp;
-                total += tmp;
-                prop_len -= (word32)tmp;
-                break;
-            }
-            case MQTT_DATA_TYPE_BINARY:
-            {
-                /* Binary type is a two byte integer "length"
-                   followed by that number of bytes */
-                tmp = MqttDecode_Num(buf, &cur_prop->data_bin.len);
-                buf += tmp;
-                total += tmp;
-                prop_len -= tmp;
-
-                if (cur_prop->data_bin.len <= (buf_len - (buf - pbuf))) {
-                    cur_prop->data_bin.data = buf;
-                    buf += cur_prop->data_bin.len;
-                    total += (int)cur_prop->data_bin.len;
-                    prop_len -= cur_prop->data_bin.len;
-                }
-                else {
-                    /* Invalid length */
-                    rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
-                }
-                break;
-            }
-            case MQTT_DATA_TYPE_STRING_PAIR:
-            {
-                /* String is prefixed with a Two Byte Integer length
-                   field that gives the number of bytes */
-                tmp = MqttDecode_String(buf,
-                        (const char**)&cur_prop->data_str.str,
-                        &cur_prop->data_str.len);
-                if ((tmp >= 0) && ((word32)tmp <= (buf_len - (buf - pbuf)))) {
-                    buf += tmp;
-                    total += tmp;
-                    prop_len -= (word32)tmp;
-                    if ((buf_len - (buf - pbuf)) > 0) {
-                        tmp = MqttDecode_String(buf,
-                                (const char**)&cur_prop->data_str2.str,
-                                &cur_prop->data_str2.len);
-                        if ((tmp >= 0) && ((word32)tmp <=
-                            (buf_len - (buf - pbuf)))) {
-                            buf += tmp;
-                            total += tmp;
-                            prop_len -= (word32)tmp;
-                        }
-                        else {
-                            /* Invalid length */
-                            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
-                        }
-                    }
-                    else {
-                        /* Invalid length */
-                        rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
-                    }
-                }
-                else {
-                    /* Invalid length */
-                    rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
-                }
-                break;
-            }
-            case MQTT_DATA_TYPE_NONE:
-            default:
-            {
-                /* Invalid property data type */
-                rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PROPERTY);
-                break;
-            }
-        }
+    #endif
+        buf += rc;
+        total += rc;
+        prop_len -= (word32)rc;
     };
 
     if (rc < 0) {
         /* Free the property */
-        MqttProps_Free(*props);
+        MqttProps_ArenaFree(arena, *props);
         *props = NULL;
     }
     else {
@@ -659,12 +725,28 @@ int MqttDecode_Props(MqttPacketType packet, MqttProp** props, byte* pbuf,
 
     return rc;
 }
+
+/* Records the location of the properties, which are decoded on demand using
+   MqttProps_ViewNext. Returns the (positive) number of bytes, or a (negative)
+   error code. */
+int MqttDecode_PropsView(MqttPacketType packet, MqttPropView* view,
+        byte* buf, word32 buf_len, word32 prop_len)
+{
+    if (prop_len > buf_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    view->buf = buf;
+    view->len = prop_len;
+    view->pos = 0;
+    view->packet = (byte)packet;
+    return (int)prop_len;
+}
 #endif
 
 /* Packet Type Encoders/Decoders */
 int MqttEncode_Connect(byte *tx_buf, int tx_buf_len, MqttConnect *mc_connect)
 {
-    int header_len, remain_len;
+    int header_len, remain_len, tmp;
 #ifdef WOLFMQTT_V5
     word32 props_len = 0, lwt_props_len = 0;
 #endif
@@ -772,13 +854,21 @@ int MqttEncode_Connect(byte *tx_buf, int tx_buf_len, MqttConnect *mc_connect)
         tx_payload += MqttEncode_Vbi(tx_payload, props_len);
 
         /* Encode properties */
-        tx_payload += MqttEncode_Props(MQTT_PACKET_TYPE_CONNECT, mc_connect->props,
-                        tx_payload);
+        tmp = MqttEncode_Props(MQTT_PACKET_TYPE_CONNECT, mc_connect->props,
+            tx_payload);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
     }
 #endif
 
     /* Encode payload */
-    tx_payload += MqttEncode_String(tx_payload, mc_connect->client_id);
+    tmp = MqttEncode_String(tx_payload, mc_connect->client_id);
+    if (tmp < 0) {
+        return tmp;
+    }
+    tx_payload += tmp;
     if (mc_connect->enable_lwt) {
 #ifdef WOLFMQTT_V5
     if (mc_connect->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
@@ -786,20 +876,35 @@ int MqttEncode_Connect(byte *tx_buf, int tx_buf_len, MqttConnect *mc_connect)
         tx_payload += MqttEncode_Vbi(tx_payload, lwt_props_len);
 
         /* Encode lwt properties */
-        tx_payload += MqttEncode_Props(MQTT_PACKET_TYPE_CONNECT,
-                mc_connect->lwt_msg->props, tx_payload);
+        tmp = MqttEncode_Props(MQTT_PACKET_TYPE_CONNECT,
+            mc_connect->lwt_msg->props, tx_payload);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
     }
 #endif
-        tx_payload += MqttEncode_String(tx_payload,
-            mc_connect->lwt_msg->topic_name);
+        tmp = MqttEncode_Topic(tx_payload, mc_connect->lwt_msg->topic_name,
+            MQTT_UTF8_TOPIC_NAME);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
         tx_payload += MqttEncode_Data(tx_payload,
             mc_connect->lwt_msg->buffer, (word16)mc_connect->lwt_msg->total_len);
     }
     if (mc_connect->username) {
-        tx_payload += MqttEncode_String(tx_payload, mc_connect->username);
+        tmp = MqttEncode_String(tx_payload, mc_connect->username);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
     }
     if (mc_connect->password) {
-        tx_payload += MqttEncode_String(tx_payload, mc_connect->password);
+        /* Password is binary data, so it is not validated */
+        tx_payload += MqttEncode_Data(tx_payload,
+            (const byte*)mc_connect->password,
+            (word16)XSTRLEN(mc_connect->password));
     }
     (void)tx_payload;
 
@@ -833,6 +938,7 @@ int MqttDecode_ConnectAck(byte *rx_buf, int rx_buf_len,
 
 #ifdef WOLFMQTT_V5
         connect_ack->props = NULL;
+        connect_ack->props_view.len = 0;
         if (connect_ack->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
             word32 props_len = 0;
             int tmp;
@@ -848,8 +954,8 @@ int MqttDecode_ConnectAck(byte *rx_buf, int rx_buf_len,
             rx_payload += tmp;
             if (props_len > 0) {
                 /* Decode the Properties */
-                tmp = MqttDecode_Props(MQTT_PACKET_TYPE_CONNECT_ACK,
-                               &connect_ack->props, rx_payload,
+                tmp = MqttDecode_PropsView(MQTT_PACKET_TYPE_CONNECT_ACK,
+                               &connect_ack->props_view, rx_payload,
                                (word32)(rx_buf_len - (rx_payload - rx_buf)),
                                props_len);
                 if (tmp < 0)
@@ -866,55 +972,68 @@ int MqttDecode_ConnectAck(byte *rx_buf, int rx_buf_len,
     return header_len + remain_len;
 }
 
-int MqttEncode_Publish(byte *tx_buf, int tx_buf_len, MqttPublish *publish,
-                        byte use_cb)
+/* Encodes the payload after the variable header and updates the publish
+ * positions. Returns the payload length placed into tx_buf. */
+static int MqttEncode_PublishPayload(byte *tx_payload, int remain,
+    MqttPublish *publish, int payload_len)
+{
+    if (payload_len > 0) {
+        /* Determine max size to copy into tx_payload */
+        if (payload_len > remain) {
+            payload_len = remain;
+        }
+        XMEMCPY(tx_payload, publish->buffer, payload_len);
+        /* mark how much data was sent */
+        publish->buffer_pos = payload_len;
+
+        /* Backwards compatibility for chunk transfers */
+        if (publish->buffer_len == 0) {
+            publish->buffer_len = publish->total_len;
+        }
+    }
+    publish->intBuf_pos = 0;
+    publish->intBuf_len = payload_len;
+
+    return payload_len;
+}
+
+/* Encodes a publish using the pre-encoded template. Only the remaining
+ * length, packet ID and payload are encoded per message. */
+static int MqttEncode_PublishFromTemplate(byte *tx_buf, int tx_buf_len,
+    MqttPublish *publish, byte use_cb)
 {
     int header_len, variable_len, payload_len = 0;
     byte *tx_payload;
-#ifdef WOLFMQTT_V5
-    word32 props_len = 0;
-#endif
+    MqttPublishTemplate* tmpl = publish->tmpl;
 
-    /* Validate required arguments */
-    if (tx_buf == NULL || publish == NULL) {
+    if (tmpl->buf == NULL) {
         return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
     }
 
-    /* Determine packet length */
-    variable_len = (int)XSTRLEN(publish->topic_name) + MQTT_DATA_LEN_SIZE;
-    if (publish->qos > MQTT_QOS_0) {
+    variable_len = (int)tmpl->len;
+    if (tmpl->qos > MQTT_QOS_0) {
         if (publish->packet_id == 0) {
             return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_ID);
         }
         variable_len += MQTT_DATA_LEN_SIZE; /* For packet_id */
     }
 
-#ifdef WOLFMQTT_V5
-    if (publish->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
-        /* Determine length of properties */
-        variable_len += props_len = MqttEncode_Props(MQTT_PACKET_TYPE_PUBLISH,
-                          publish->props, NULL);
-
-        /* Determine the length of the "property length" */
-        variable_len += MqttEncode_Vbi(NULL, props_len);
-    }
-#endif
-
     if (((publish->buffer != NULL) || (use_cb == 1)) &&
         (publish->total_len > 0)) {
         payload_len = publish->total_len;
     }
 
-    /* Encode fixed header */
+    /* Encode fixed header: type and flags are pre-encoded */
+    if (tx_buf_len < MQTT_PACKET_MAX_LEN_BYTES+1) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
     publish->type = MQTT_PACKET_TYPE_PUBLISH;
-    header_len = MqttEncode_FixedHeader(tx_buf, tx_buf_len,
-        variable_len + payload_len, publish->type,
-        publish->retain, publish->qos, publish->duplicate);
-    if (header_len < 0) {
-        return header_len;
+    tx_buf[0] = tmpl->type_flags;
+    if (publish->duplicate) {
+        tx_buf[0] |= MQTT_PACKET_FLAGS_SET(MQTT_PACKET_FLAG_DUPLICATE);
     }
-
-    tx_payload = &tx_buf[header_len];
+    header_len = 1 + MqttEncode_Vbi(&tx_buf[1],
+        (word32)(variable_len + payload_len));
 
     if (use_cb == 1) {
         /* The callback will encode the payload */
@@ -926,56 +1045,200 @@ int MqttEncode_Publish(byte *tx_buf, int tx_buf_len, MqttPublish *publish,
         return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
     }
 
-    /* Encode variable header */
-    tx_payload += MqttEncode_String(tx_payload, publish->topic_name);
-    if (publish->qos > MQTT_QOS_0) {
+    /* Copy variable header, inserting the packet ID after the topic */
+    tx_payload = &tx_buf[header_len];
+    XMEMCPY(tx_payload, tmpl->buf, tmpl->topic_len);
+    tx_payload += tmpl->topic_len;
+    if (tmpl->qos > MQTT_QOS_0) {
         tx_payload += MqttEncode_Num(tx_payload, publish->packet_id);
     }
-
-#ifdef WOLFMQTT_V5
-    if (publish->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
-        /* Encode the property length */
-        tx_payload += MqttEncode_Vbi(tx_payload, props_len);
-
-        /* Encode properties */
-        tx_payload += MqttEncode_Props((MqttPacketType)publish->type,
-            publish->props, tx_payload);
+    if (tmpl->len > tmpl->topic_len) {
+        XMEMCPY(tx_payload, &tmpl->buf[tmpl->topic_len],
+            tmpl->len - tmpl->topic_len);
+        tx_payload += tmpl->len - tmpl->topic_len;
     }
-#endif
-
-    /* Encode payload */
-    if (payload_len > 0) {
-        /* Check for buffer room */
-        if (tx_buf_len < header_len + variable_len) {
-            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
-        }
-        /* Determine max size to copy into tx_payload */
-        if (payload_len > (tx_buf_len - (header_len + variable_len))) {
-            payload_len = (tx_buf_len - (header_len + variable_len));
-        }
-        if (tx_payload != NULL) {
-            XMEMCPY(tx_payload, publish->buffer, payload_len);
-        }
-        /* mark how much data was sent */
-        publish->buffer_pos = payload_len;
 
-        /* Backwards compatibility for chunk transfers */
-        if (publish->buffer_len == 0) {
-            publish->buffer_len = publish->total_len;
-        }
-    }
-    publish->intBuf_pos = 0;
-    publish->intBuf_len = payload_len;
+    payload_len = MqttEncode_PublishPayload(tx_payload,
+        tx_buf_len - (header_len + variable_len), publish, payload_len);
 
     /* Return length of packet placed into tx_buf */
     return header_len + variable_len + payload_len;
 }
 
-int MqttDecode_Publish(byte *rx_buf, int rx_buf_len, MqttPublish *publish)
+int MqttEncode_PublishTemplate(MqttPublishTemplate *tmpl,
+    MqttPublish *publish, byte *buf, int buf_len)
 {
-    int header_len, remain_len, variable_len, payload_len;
-    byte *rx_payload;
-
+    int topic_len, len, tmp;
+    byte *ptr;
+#ifdef WOLFMQTT_V5
+    int props_len = 0;
+#endif
+
+    /* Validate required arguments */
+    if (tmpl == NULL || publish == NULL || publish->topic_name == NULL ||
+        buf == NULL || publish->qos > MQTT_QOS_2) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Determine template length */
+    topic_len = (int)XSTRLEN(publish->topic_name) + MQTT_DATA_LEN_SIZE;
+    len = topic_len;
+#ifdef WOLFMQTT_V5
+    if (publish->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        props_len = MqttEncode_Props(MQTT_PACKET_TYPE_PUBLISH,
+            publish->props, NULL);
+        if (props_len < 0) {
+            return props_len;
+        }
+        len += props_len + MqttEncode_Vbi(NULL, (word32)props_len);
+    }
+#endif
+    if (buf_len < len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    /* Encode topic followed by properties */
+    ptr = buf;
+    tmp = MqttEncode_Topic(ptr, publish->topic_name, MQTT_UTF8_TOPIC_NAME);
+    if (tmp < 0) {
+        return tmp;
+    }
+    ptr += tmp;
+#ifdef WOLFMQTT_V5
+    if (publish->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        ptr += MqttEncode_Vbi(ptr, (word32)props_len);
+        tmp = MqttEncode_Props(MQTT_PACKET_TYPE_PUBLISH, publish->props,
+            ptr);
+        if (tmp < 0) {
+            return tmp;
+        }
+        ptr += tmp;
+    }
+    tmpl->protocol_level = publish->protocol_level;
+#endif
+    (void)ptr;
+
+    tmpl->buf = buf;
+    tmpl->len = (word32)len;
+    tmpl->topic_len = (word32)topic_len;
+    tmpl->topic_name = publish->topic_name;
+    tmpl->qos = publish->qos;
+    tmpl->retain = publish->retain;
+    tmpl->type_flags = MQTT_PACKET_TYPE_SET(MQTT_PACKET_TYPE_PUBLISH);
+    if (publish->retain) {
+        tmpl->type_flags |= MQTT_PACKET_FLAGS_SET(MQTT_PACKET_FLAG_RETAIN);
+    }
+    if (publish->qos) {
+        tmpl->type_flags |= MQTT_PACKET_FLAGS_SET_QOS(publish->qos);
+    }
+
+    return len;
+}
+
+int MqttEncode_Publish(byte *tx_buf, int tx_buf_len, MqttPublish *publish,
+                        byte use_cb)
+{
+    int header_len, variable_len, payload_len = 0, tmp;
+    byte *tx_payload;
+#ifdef WOLFMQTT_V5
+    word32 props_len = 0;
+#endif
+
+    /* Validate required arguments */
+    if (tx_buf == NULL || publish == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    if (publish->tmpl != NULL) {
+        return MqttEncode_PublishFromTemplate(tx_buf, tx_buf_len, publish,
+            use_cb);
+    }
+
+    /* Determine packet length */
+    variable_len = (int)XSTRLEN(publish->topic_name) + MQTT_DATA_LEN_SIZE;
+    if (publish->qos > MQTT_QOS_0) {
+        if (publish->packet_id == 0) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_ID);
+        }
+        variable_len += MQTT_DATA_LEN_SIZE; /* For packet_id */
+    }
+
+#ifdef WOLFMQTT_V5
+    if (publish->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        /* Determine length of properties */
+        variable_len += props_len = MqttEncode_Props(MQTT_PACKET_TYPE_PUBLISH,
+                          publish->props, NULL);
+
+        /* Determine the length of the "property length" */
+        variable_len += MqttEncode_Vbi(NULL, props_len);
+    }
+#endif
+
+    if (((publish->buffer != NULL) || (use_cb == 1)) &&
+        (publish->total_len > 0)) {
+        payload_len = publish->total_len;
+    }
+
+    /* Encode fixed header */
+    publish->type = MQTT_PACKET_TYPE_PUBLISH;
+    header_len = MqttEncode_FixedHeader(tx_buf, tx_buf_len,
+        variable_len + payload_len, publish->type,
+        publish->retain, publish->qos, publish->duplicate);
+    if (header_len < 0) {
+        return header_len;
+    }
+
+    tx_payload = &tx_buf[header_len];
+
+    if (use_cb == 1) {
+        /* The callback will encode the payload */
+        payload_len = 0;
+    }
+
+    /* Check for buffer room */
+    if (tx_buf_len < header_len + variable_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    /* Encode variable header */
+    tmp = MqttEncode_Topic(tx_payload, publish->topic_name,
+        MQTT_UTF8_TOPIC_NAME);
+    if (tmp < 0) {
+        return tmp;
+    }
+    tx_payload += tmp;
+    if (publish->qos > MQTT_QOS_0) {
+        tx_payload += MqttEncode_Num(tx_payload, publish->packet_id);
+    }
+
+#ifdef WOLFMQTT_V5
+    if (publish->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        /* Encode the property length */
+        tx_payload += MqttEncode_Vbi(tx_payload, props_len);
+
+        /* Encode properties */
+        tmp = MqttEncode_Props((MqttPacketType)publish->type,
+            publish->props, tx_payload);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
+    }
+#endif
+
+    /* Encode payload */
+    payload_len = MqttEncode_PublishPayload(tx_payload,
+        tx_buf_len - (header_len + variable_len), publish, payload_len);
+
+    /* Return length of packet placed into tx_buf */
+    return header_len + variable_len + payload_len;
+}
+
+int MqttDecode_Publish(byte *rx_buf, int rx_buf_len, MqttPublish *publish)
+{
+    int header_len, remain_len, variable_len, payload_len;
+    byte *rx_payload;
+
     /* Validate required arguments */
     if (rx_buf == NULL || rx_buf_len <= 0 || publish == NULL) {
         return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
@@ -1000,6 +1263,15 @@ int MqttDecode_Publish(byte *rx_buf, int rx_buf_len, MqttPublish *publish)
     else {
         return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
     }
+#ifdef WOLFMQTT_UTF8
+    {
+        int rc = MqttUtf8_Validate(publish->topic_name,
+            publish->topic_name_len, MQTT_UTF8_TOPIC_NAME);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+    }
+#endif
 
     /* If QoS > 0 then get packet Id */
     if (publish->qos > MQTT_QOS_0) {
@@ -1017,6 +1289,7 @@ int MqttDecode_Publish(byte *rx_buf, int rx_buf_len, MqttPublish *publish)
 
 #ifdef WOLFMQTT_V5
     publish->props = NULL;
+    publish->props_view.len = 0;
     if (publish->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
         word32 props_len = 0;
         int tmp;
@@ -1034,8 +1307,8 @@ int MqttDecode_Publish(byte *rx_buf, int rx_buf_len, MqttPublish *publish)
             rx_payload += tmp;
             if (props_len > 0) {
                 /* Decode the Properties */
-                tmp = MqttDecode_Props((MqttPacketType)publish->type,
-                    &publish->props, rx_payload,
+                tmp = MqttDecode_PropsView((MqttPacketType)publish->type,
+                    &publish->props_view, rx_payload,
                     (word32)(rx_buf_len - (rx_payload - rx_buf)), props_len);
                 if (tmp < 0)
                     return tmp;
@@ -1074,6 +1347,7 @@ int MqttEncode_PublishResp(byte* tx_buf, int tx_buf_len, byte type,
     MqttQoS qos;
 #ifdef WOLFMQTT_V5
     word32 props_len = 0;
+    int tmp;
 #endif
 
     /* Validate required arguments */
@@ -1132,8 +1406,12 @@ int MqttEncode_PublishResp(byte* tx_buf, int tx_buf_len, byte type,
             tx_payload += MqttEncode_Vbi(tx_payload, props_len);
 
             /* Encode properties */
-            tx_payload += MqttEncode_Props((MqttPacketType)type,
-                            publish_resp->props, tx_payload);
+            tmp = MqttEncode_Props((MqttPacketType)type,
+                publish_resp->props, tx_payload);
+            if (tmp < 0) {
+                return tmp;
+            }
+            tx_payload += tmp;
         }
     }
 #endif
@@ -1169,6 +1447,7 @@ int MqttDecode_PublishResp(byte* rx_buf, int rx_buf_len, byte type,
 
 #ifdef WOLFMQTT_V5
         publish_resp->props = NULL;
+        publish_resp->props_view.len = 0;
         if (publish_resp->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
             if (remain_len > MQTT_DATA_LEN_SIZE) {
                 /* Decode the Reason Code */
@@ -1195,8 +1474,8 @@ int MqttDecode_PublishResp(byte* rx_buf, int rx_buf_len, byte type,
                     rx_payload += tmp;
                     if (props_len > 0) {
                         /* Decode the Properties */
-                        tmp = MqttDecode_Props((MqttPacketType)type,
-                                &publish_resp->props, rx_payload,
+                        tmp = MqttDecode_PropsView((MqttPacketType)type,
+                                &publish_resp->props_view, rx_payload,
                                 (word32)(rx_buf_len - (rx_payload - rx_buf)),
                                 props_len);
                         if (tmp < 0)
@@ -1221,7 +1500,7 @@ int MqttDecode_PublishResp(byte* rx_buf, int rx_buf_len, byte type,
 int MqttEncode_Subscribe(byte *tx_buf, int tx_buf_len,
     MqttSubscribe *subscribe)
 {
-    int header_len, remain_len, i;
+    int header_len, remain_len, i, tmp;
     byte *tx_payload;
     MqttTopic *topic;
 #ifdef WOLFMQTT_V5
@@ -1279,15 +1558,24 @@ int MqttEncode_Subscribe(byte *tx_buf, int tx_buf_len,
         tx_payload += MqttEncode_Vbi(tx_payload, props_len);
 
         /* Encode properties */
-        tx_payload += MqttEncode_Props(MQTT_PACKET_TYPE_SUBSCRIBE, subscribe->props,
-                        tx_payload);
+        tmp = MqttEncode_Props(MQTT_PACKET_TYPE_SUBSCRIBE, subscribe->props,
+            tx_payload);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
     }
 #endif
 
     /* Encode payload */
     for (i = 0; i < subscribe->topic_count; i++) {
         topic = &subscribe->topics[i];
-        tx_payload += MqttEncode_String(tx_payload, topic->topic_filter);
+        tmp = MqttEncode_Topic(tx_payload, topic->topic_filter,
+            MQTT_UTF8_TOPIC_FILTER);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
         /* Sanity check for compilers */
         if (tx_payload != NULL) {
             *tx_payload = topic->qos;
@@ -1302,7 +1590,7 @@ int MqttEncode_Subscribe(byte *tx_buf, int tx_buf_len,
 int MqttDecode_SubscribeAck(byte* rx_buf, int rx_buf_len,
     MqttSubscribeAck *subscribe_ack)
 {
-    int header_len, remain_len;
+    int header_len, remain_len, codes_len, i;
     byte *rx_payload;
 
     /* Validate required arguments */
@@ -1324,6 +1612,7 @@ int MqttDecode_SubscribeAck(byte* rx_buf, int rx_buf_len,
 
 #ifdef WOLFMQTT_V5
         subscribe_ack->props = NULL;
+        subscribe_ack->props_view.len = 0;
         if ((subscribe_ack->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) &&
             (remain_len > MQTT_DATA_LEN_SIZE)) {
             word32 props_len = 0;
@@ -1342,8 +1631,8 @@ int MqttDecode_SubscribeAck(byte* rx_buf, int rx_buf_len,
                 rx_payload += tmp;
                 if (props_len > 0) {
                     /* Decode the Properties */
-                    tmp = MqttDecode_Props(MQTT_PACKET_TYPE_SUBSCRIBE_ACK,
-                                &subscribe_ack->props, rx_payload,
+                    tmp = MqttDecode_PropsView(MQTT_PACKET_TYPE_SUBSCRIBE_ACK,
+                                &subscribe_ack->props_view, rx_payload,
                                 (word32)(rx_buf_len - (rx_payload - rx_buf)),
                                 props_len);
                     if (tmp < 0)
@@ -1358,9 +1647,18 @@ int MqttDecode_SubscribeAck(byte* rx_buf, int rx_buf_len,
 #endif
 
         /* payload is list of return codes (MqttSubscribeAckReturnCodes) */
-        if (remain_len > MAX_MQTT_TOPICS)
-            remain_len = MAX_MQTT_TOPICS;
-        XMEMCPY(subscribe_ack->return_codes, rx_payload, remain_len);
+        codes_len = remain_len - (int)(rx_payload - &rx_buf[header_len]);
+        if (codes_len > rx_buf_len - (int)(rx_payload - rx_buf))
+            codes_len = rx_buf_len - (int)(rx_payload - rx_buf);
+        if (subscribe_ack->topics != NULL) {
+            for (i = 0; i < codes_len && i < subscribe_ack->topic_count; i++) {
+                subscribe_ack->topics[i].return_code = rx_payload[i];
+            }
+        }
+        if (codes_len > MAX_MQTT_TOPICS)
+            codes_len = MAX_MQTT_TOPICS;
+        if (codes_len > 0)
+            XMEMCPY(subscribe_ack->return_codes, rx_payload, codes_len);
     }
 
     /* Return total length of packet */
@@ -1370,7 +1668,7 @@ int MqttDecode_SubscribeAck(byte* rx_buf, int rx_buf_len,
 int MqttEncode_Unsubscribe(byte *tx_buf, int tx_buf_len,
     MqttUnsubscribe *unsubscribe)
 {
-    int header_len, remain_len, i;
+    int header_len, remain_len, i, tmp;
     byte *tx_payload;
     MqttTopic *topic;
 #ifdef WOLFMQTT_V5
@@ -1426,8 +1724,12 @@ int MqttEncode_Unsubscribe(byte *tx_buf, int tx_buf_len,
         tx_payload += MqttEncode_Vbi(tx_payload, props_len);
 
         /* Encode properties */
-        tx_payload += MqttEncode_Props(MQTT_PACKET_TYPE_UNSUBSCRIBE,
-                        unsubscribe->props, tx_payload);
+        tmp = MqttEncode_Props(MQTT_PACKET_TYPE_UNSUBSCRIBE,
+            unsubscribe->props, tx_payload);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
     }
 #endif
 
@@ -1435,7 +1737,12 @@ int MqttEncode_Unsubscribe(byte *tx_buf, int tx_buf_len,
     /* Encode payload */
     for (i = 0; i < unsubscribe->topic_count; i++) {
         topic = &unsubscribe->topics[i];
-        tx_payload += MqttEncode_String(tx_payload, topic->topic_filter);
+        tmp = MqttEncode_Topic(tx_payload, topic->topic_filter,
+            MQTT_UTF8_TOPIC_FILTER);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
     }
 
     /* Return total length of packet */
@@ -1466,6 +1773,7 @@ int MqttDecode_UnsubscribeAck(byte *rx_buf, int rx_buf_len,
         rx_payload += MqttDecode_Num(rx_payload, &unsubscribe_ack->packet_id);
 #ifdef WOLFMQTT_V5
         unsubscribe_ack->props = NULL;
+        unsubscribe_ack->props_view.len = 0;
         if (unsubscribe_ack->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
             if (remain_len > MQTT_DATA_LEN_SIZE) {
                 word32 props_len = 0;
@@ -1484,8 +1792,8 @@ int MqttDecode_UnsubscribeAck(byte *rx_buf, int rx_buf_len,
                     rx_payload += tmp;
                     if (props_len > 0) {
                         /* Decode the Properties */
-                        tmp = MqttDecode_Props(MQTT_PACKET_TYPE_UNSUBSCRIBE_ACK,
-                                &unsubscribe_ack->props, rx_payload,
+                        tmp = MqttDecode_PropsView(MQTT_PACKET_TYPE_UNSUBSCRIBE_ACK,
+                                &unsubscribe_ack->props_view, rx_payload,
                                 (word32)(rx_buf_len - (rx_payload - rx_buf)),
                                 props_len);
                         if (tmp < 0)
@@ -1564,6 +1872,7 @@ int MqttEncode_Disconnect(byte *tx_buf, int tx_buf_len,
     int remain_len = 0;
 #ifdef WOLFMQTT_V5
     word32 props_len = 0;
+    int tmp;
 #endif
 
     /* Validate required arguments */
@@ -1618,8 +1927,12 @@ int MqttEncode_Disconnect(byte *tx_buf, int tx_buf_len,
             tx_payload += MqttEncode_Vbi(tx_payload, props_len);
 
             /* Encode properties */
-            tx_payload += MqttEncode_Props(MQTT_PACKET_TYPE_DISCONNECT,
-                            disconnect->props, tx_payload);
+            tmp = MqttEncode_Props(MQTT_PACKET_TYPE_DISCONNECT,
+                disconnect->props, tx_payload);
+            if (tmp < 0) {
+                return tmp;
+            }
+            tx_payload += tmp;
         }
         (void)tx_payload;
     }
@@ -1652,6 +1965,8 @@ int MqttDecode_Disconnect(byte *rx_buf, int rx_buf_len, MqttDisconnect *disc)
     rx_payload = &rx_buf[header_len];
 
     disc->props = NULL;
+    disc->props_view.len = 0;
+
     if (remain_len > 0) {
         /* Decode variable header */
         disc->reason_code = *rx_payload++;
@@ -1670,8 +1985,8 @@ int MqttDecode_Disconnect(byte *rx_buf, int rx_buf_len, MqttDisconnect *disc)
                 rx_payload += tmp;
                 if (props_len > 0) {
                     /* Decode the Properties */
-                    tmp = MqttDecode_Props(MQTT_PACKET_TYPE_DISCONNECT,
-                            &disc->props, rx_payload,
+                    tmp = MqttDecode_PropsView(MQTT_PACKET_TYPE_DISCONNECT,
+                            &disc->props_view, rx_payload,
                             (word32)(rx_buf_len - (rx_payload - rx_buf)),
                             props_len);
                     if (tmp < 0)
@@ -1693,7 +2008,7 @@ int MqttDecode_Disconnect(byte *rx_buf, int rx_buf_len, MqttDisconnect *disc)
 
 int MqttEncode_Auth(byte *tx_buf, int tx_buf_len, MqttAuth *auth)
 {
-    int header_len, remain_len = 0;
+    int header_len, remain_len = 0, tmp;
     byte* tx_payload;
     word32 props_len = 0;
 
@@ -1734,8 +2049,12 @@ int MqttEncode_Auth(byte *tx_buf, int tx_buf_len, MqttAuth *auth)
         tx_payload += MqttEncode_Vbi(tx_payload, props_len);
 
         /* Encode properties */
-        tx_payload += MqttEncode_Props(MQTT_PACKET_TYPE_AUTH, auth->props,
-                        tx_payload);
+        tmp = MqttEncode_Props(MQTT_PACKET_TYPE_AUTH, auth->props,
+            tx_payload);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
     }
     else {
         return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
@@ -1774,6 +2093,7 @@ int MqttDecode_Auth(byte *rx_buf, int rx_buf_len, MqttAuth *auth)
         (auth->reason_code == MQTT_REASON_CONT_AUTH))
     {
         auth->props = NULL;
+        auth->props_view.len = 0;
 
         /* Decode Length of Properties */
         if (rx_buf_len < (rx_payload - rx_buf)) {
@@ -1791,8 +2111,8 @@ int MqttDecode_Auth(byte *rx_buf, int rx_buf_len, MqttAuth *auth)
             }
             if (props_len > 0) {
                 /* Decode the Properties */
-                tmp = MqttDecode_Props(MQTT_PACKET_TYPE_AUTH,
-                        &auth->props, rx_payload,
+                tmp = MqttDecode_PropsView(MQTT_PACKET_TYPE_AUTH,
+                        &auth->props_view, rx_payload,
                         (word32)(rx_buf_len - (rx_payload - rx_buf)),
                         props_len);
                 if (tmp < 0)
@@ -1805,7 +2125,7 @@ int MqttDecode_Auth(byte *rx_buf, int rx_buf_len, MqttAuth *auth)
                    In this case the AUTH has a Remaining Length of 0. */
                 return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
             }
-            if (auth->props != NULL) {
+            if (auth->props_view.len > 0) {
                 /* Must have Authentication Method */
 
                 /* Must have Authentication Data */
@@ -1834,10 +2154,13 @@ int MqttProps_Init(void)
 {
     int ret = MQTT_CODE_SUCCESS;
 #if !defined(WOLFMQTT_DYN_PROP) && defined(WOLFMQTT_MULTITHREAD)
+    /* Reference counted, each client init has a matching shutdown */
     if (clientPropStack_lockInit == 0) {
-        clientPropStack_lockInit++;
         ret = wm_SemInit(&clientPropStack_lock);
     }
+    if (ret == MQTT_CODE_SUCCESS) {
+        clientPropStack_lockInit++;
+    }
 #endif
     return  ret;
 }
@@ -1846,9 +2169,11 @@ int MqttProps_ShutDown(void)
 {
     int ret = MQTT_CODE_SUCCESS;
 #if !defined(WOLFMQTT_DYN_PROP) && defined(WOLFMQTT_MULTITHREAD)
-    clientPropStack_lockInit--;
-    if (clientPropStack_lockInit == 0) {
-        ret = wm_SemFree(&clientPropStack_lock);
+    if (clientPropStack_lockInit > 0) {
+        clientPropStack_lockInit--;
+        if (clientPropStack_lockInit == 0) {
+            ret = wm_SemFree(&clientPropStack_lock);
+        }
     }
 #endif
     return ret;
@@ -1949,8 +2274,756 @@ int MqttProps_Free(MqttProp *head)
     return ret;
 }
 
+int MqttProps_ArenaInit(MqttPropArena *arena, MqttProp *props, int count)
+{
+    if (arena == NULL || count < 0 || count > 0xFFFF ||
+            (props == NULL && count > 0)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(arena, 0, sizeof(MqttPropArena));
+    arena->props = props;
+    arena->count = (word16)count;
+
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Add property from arena. Falls back to MqttProps_Add when arena is NULL or
+ * has no unused elements. */
+MqttProp* MqttProps_ArenaAdd(MqttPropArena *arena, MqttProp **head)
+{
+    MqttProp *new_prop, *cur;
+
+    if (arena == NULL || arena->used >= arena->count) {
+        return MqttProps_Add(head);
+    }
+    if (head == NULL) {
+        return NULL;
+    }
+
+    new_prop = &arena->props[arena->used++];
+    arena->active++;
+    XMEMSET(new_prop, 0, sizeof(MqttProp));
+    /* set placeholder until caller sets it to a real type */
+    new_prop->type = MQTT_PROP_TYPE_MAX;
+
+    if (*head == NULL) {
+        /* Start a new list */
+        *head = new_prop;
+    }
+    else if (*head == arena->head && arena->tail->next == NULL) {
+        /* Add to the list last built from this arena */
+        arena->tail->next = new_prop;
+    }
+    else {
+        /* Find the end of the parameter list */
+        cur = *head;
+        while (cur->next != NULL) {
+            cur = cur->next;
+        }
+        cur->next = new_prop;
+    }
+    arena->head = *head;
+    arena->tail = new_prop;
+
+    return new_prop;
+}
+
+/* Free properties. Arena storage is released once all of its properties are
+ * freed. Any properties in the list not from the arena use MqttProps_Free */
+int MqttProps_ArenaFree(MqttPropArena *arena, MqttProp *head)
+{
+    int ret = MQTT_CODE_SUCCESS;
+    MqttProp *next;
+
+    if (arena == NULL || arena->count == 0) {
+        /* No arena storage, free the whole list at once */
+        return MqttProps_Free(head);
+    }
+
+    while (head != NULL) {
+        next = head->next;
+        if (head >= arena->props && head < &arena->props[arena->count]) {
+            head->type = MQTT_PROP_NONE;
+            if (head == arena->head) {
+                arena->head = arena->tail = NULL;
+            }
+            if (arena->active > 0) {
+                arena->active--;
+            }
+        }
+        else {
+            head->next = NULL;
+            ret = MqttProps_Free(head);
+        }
+        head = next;
+    }
+
+    if (arena->active == 0) {
+        MqttProps_ArenaReset(arena);
+    }
+
+    return ret;
+}
+
+/* Release all properties allocated from the arena */
+void MqttProps_ArenaReset(MqttPropArena *arena)
+{
+    if (arena != NULL) {
+        arena->head = arena->tail = NULL;
+        arena->used = 0;
+        arena->active = 0;
+    }
+}
+
+/* Decode the next property from view into prop. Data pointers reference the
+   packet buffer. Returns the (positive) number of bytes decoded, zero when
+   there are no more properties or a (negative) error code. */
+int MqttProps_ViewNext(MqttPropView *view, MqttProp *prop)
+{
+    int rc;
+
+    if (view == NULL || prop == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (view->pos >= view->len) {
+        return 0;
+    }
+
+    XMEMSET(prop, 0, sizeof(MqttProp));
+    rc = MqttDecode_Prop(prop, &view->buf[view->pos], view->len - view->pos);
+    if (rc > 0) {
+        view->pos += (word32)rc;
+    }
+    return rc;
+}
+
+/* Find the next property of type, starting from the current position */
+int MqttProps_ViewFind(MqttPropView *view, MqttPropertyType type,
+    MqttProp *prop)
+{
+    int rc;
+
+    do {
+        rc = MqttProps_ViewNext(view, prop);
+    } while (rc > 0 && prop->type != type);
+
+    return rc;
+}
+
+/* Check all properties in view can be decoded. With WOLFMQTT_UTF8 the
+   strings are also checked here, once, instead of on each read. */
+int MqttProps_ViewValidate(MqttPropView *view)
+{
+    int rc;
+    MqttProp prop;
+    MqttPropView tmp = *view;
+
+    tmp.pos = 0;
+    do {
+        rc = MqttProps_ViewNext(&tmp, &prop);
+    #ifdef WOLFMQTT_UTF8
+        if (rc > 0) {
+            int ret = MqttDecode_PropStrings(&prop);
+            if (ret < 0) {
+                rc = ret;
+            }
+        }
+    #endif
+    } while (rc > 0);
+
+    return rc;
+}
+
 #endif /* WOLFMQTT_V5 */
 
+#ifdef WOLFMQTT_BROKER
+/* Broker side of the protocol */
+
+/* Decodes a string and terminates it in place. The string is moved over the
+   last byte of its length, so the terminator stays inside its own field.
+   Returns the encoded length or a negative error. */
+static int MqttDecode_StringZ(byte *buf, int buf_len, const char **pstr,
+    word16 *pstr_len)
+{
+    word16 len;
+
+    if (buf_len < MQTT_DATA_LEN_SIZE) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    (void)MqttDecode_Num(buf, &len);
+    if ((int)len > buf_len - MQTT_DATA_LEN_SIZE) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    XMEMMOVE(&buf[1], &buf[MQTT_DATA_LEN_SIZE], len);
+    buf[1 + len] = '\0';
+    *pstr = (const char*)&buf[1];
+    if (pstr_len != NULL) {
+        *pstr_len = len;
+    }
+    return len + MQTT_DATA_LEN_SIZE;
+}
+
+#ifdef WOLFMQTT_V5
+/* Decodes the property length and records the location of the properties.
+   Returns the length of both. */
+static int MqttDecode_PropsAt(MqttPacketType packet, MqttPropView *view,
+    byte *buf, int buf_len)
+{
+    word32 props_len = 0;
+    int tmp;
+
+    view->len = 0;
+    if (buf_len <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    tmp = MqttDecode_Vbi(buf, &props_len, (word32)buf_len);
+    if (tmp < 0) {
+        return tmp;
+    }
+    if (props_len > 0) {
+        int rc = MqttDecode_PropsView(packet, view, &buf[tmp],
+            (word32)(buf_len - tmp), props_len);
+        if (rc < 0) {
+            return rc;
+        }
+    }
+    return tmp + (int)props_len;
+}
+#endif
+
+int MqttDecode_Connect(byte *rx_buf, int rx_buf_len, MqttConnect *mc_connect)
+{
+    int header_len, remain_len, tmp;
+    byte *rx_payload, *rx_end;
+    MqttConnectPacket packet;
+    word16 len;
+
+    /* Validate required arguments */
+    if (rx_buf == NULL || rx_buf_len <= 0 || mc_connect == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Decode fixed header */
+    header_len = MqttDecode_FixedHeader(rx_buf, rx_buf_len, &remain_len,
+        MQTT_PACKET_TYPE_CONNECT, NULL, NULL, NULL);
+    if (header_len < 0) {
+        return header_len;
+    }
+    if (header_len + remain_len > rx_buf_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    rx_payload = &rx_buf[header_len];
+    rx_end = &rx_payload[remain_len];
+
+    /* Decode variable header */
+    if (remain_len < (int)sizeof(MqttConnectPacket)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    XMEMCPY(&packet, rx_payload, sizeof(MqttConnectPacket));
+    rx_payload += sizeof(MqttConnectPacket);
+    (void)MqttDecode_Num(packet.protocol_len, &len);
+    if (len != MQTT_CONNECT_PROTOCOL_NAME_LEN ||
+            XMEMCMP(packet.protocol_name, MQTT_CONNECT_PROTOCOL_NAME,
+                MQTT_CONNECT_PROTOCOL_NAME_LEN) != 0 ||
+            (packet.flags & MQTT_CONNECT_FLAG_RESERVED) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    mc_connect->protocol_level = packet.protocol_level;
+    (void)MqttDecode_Num((byte*)&packet.keep_alive,
+        &mc_connect->keep_alive_sec);
+    mc_connect->clean_session =
+        (packet.flags & MQTT_CONNECT_FLAG_CLEAN_SESSION) ? 1 : 0;
+    mc_connect->enable_lwt =
+        (packet.flags & MQTT_CONNECT_FLAG_WILL_FLAG) ? 1 : 0;
+    mc_connect->username = NULL;
+    mc_connect->password = NULL;
+
+#ifdef WOLFMQTT_V5
+    mc_connect->props = NULL;
+    mc_connect->props_view.len = 0;
+    if (mc_connect->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        tmp = MqttDecode_PropsAt(MQTT_PACKET_TYPE_CONNECT,
+            &mc_connect->props_view, rx_payload, (int)(rx_end - rx_payload));
+        if (tmp < 0) {
+            return tmp;
+        }
+        rx_payload += tmp;
+    }
+#endif
+
+    /* Decode payload */
+    tmp = MqttDecode_StringZ(rx_payload, (int)(rx_end - rx_payload),
+        &mc_connect->client_id, NULL);
+    if (tmp < 0) {
+        return tmp;
+    }
+    rx_payload += tmp;
+
+    if (mc_connect->enable_lwt) {
+        MqttMessage *lwt = mc_connect->lwt_msg; /* fields skipped if NULL */
+        const char *topic_name;
+        word16 topic_name_len;
+
+    #ifdef WOLFMQTT_V5
+        if (mc_connect->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+            MqttPropView view;
+            tmp = MqttDecode_PropsAt(MQTT_PACKET_TYPE_CONNECT, &view,
+                rx_payload, (int)(rx_end - rx_payload));
+            if (tmp < 0) {
+                return tmp;
+            }
+            rx_payload += tmp;
+            if (lwt != NULL) {
+                lwt->props = NULL;
+                lwt->props_view = view;
+                lwt->protocol_level = mc_connect->protocol_level;
+            }
+        }
+    #endif
+        tmp = MqttDecode_StringZ(rx_payload, (int)(rx_end - rx_payload),
+            &topic_name, &topic_name_len);
+        if (tmp < 0) {
+            return tmp;
+        }
+        rx_payload += tmp;
+
+        /* Will payload is binary data */
+        if (rx_end - rx_payload < MQTT_DATA_LEN_SIZE) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+        }
+        rx_payload += MqttDecode_Num(rx_payload, &len);
+        if (len > rx_end - rx_payload) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+        }
+        if (lwt != NULL) {
+            lwt->type = MQTT_PACKET_TYPE_PUBLISH;
+            lwt->topic_name = topic_name;
+            lwt->topic_name_len = topic_name_len;
+            lwt->qos = (MqttQoS)MQTT_CONNECT_FLAG_GET_QOS(packet.flags);
+            lwt->retain =
+                (packet.flags & MQTT_CONNECT_FLAG_WILL_RETAIN) ? 1 : 0;
+            lwt->buffer = rx_payload;
+            lwt->buffer_len = len;
+            lwt->total_len = len;
+        }
+        rx_payload += len;
+    }
+    if (packet.flags & MQTT_CONNECT_FLAG_USERNAME) {
+        tmp = MqttDecode_StringZ(rx_payload, (int)(rx_end - rx_payload),
+            &mc_connect->username, NULL);
+        if (tmp < 0) {
+            return tmp;
+        }
+        rx_payload += tmp;
+    }
+    if (packet.flags & MQTT_CONNECT_FLAG_PASSWORD) {
+        /* Password is binary data, terminated the same way */
+        tmp = MqttDecode_StringZ(rx_payload, (int)(rx_end - rx_payload),
+            &mc_connect->password, NULL);
+        if (tmp < 0) {
+            return tmp;
+        }
+        rx_payload += tmp;
+    }
+    if (rx_payload != rx_end) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+
+    /* Return total length of packet */
+    return header_len + remain_len;
+}
+
+int MqttEncode_ConnectAck(byte *tx_buf, int tx_buf_len,
+    MqttConnectAck *connect_ack)
+{
+    int header_len, remain_len;
+    byte *tx_payload;
+#ifdef WOLFMQTT_V5
+    word32 props_len = 0;
+    int tmp;
+#endif
+
+    /* Validate required arguments */
+    if (tx_buf == NULL || connect_ack == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Determine packet length */
+    remain_len = 2; /* For flags and return code */
+#ifdef WOLFMQTT_V5
+    if (connect_ack->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        /* Determine length of properties */
+        remain_len += props_len = MqttEncode_Props(
+            MQTT_PACKET_TYPE_CONNECT_ACK, connect_ack->props, NULL);
+
+        /* Determine the length of the "property length" */
+        remain_len += MqttEncode_Vbi(NULL, props_len);
+    }
+#endif
+
+    /* Encode fixed header */
+    header_len = MqttEncode_FixedHeader(tx_buf, tx_buf_len, remain_len,
+        MQTT_PACKET_TYPE_CONNECT_ACK, 0, 0, 0);
+    if (header_len < 0) {
+        return header_len;
+    }
+    /* Check for buffer room */
+    if (tx_buf_len < header_len + remain_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    tx_payload = &tx_buf[header_len];
+
+    /* Encode variable header */
+    *tx_payload++ = connect_ack->flags;
+    *tx_payload++ = connect_ack->return_code;
+
+#ifdef WOLFMQTT_V5
+    if (connect_ack->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        /* Encode the property length */
+        tx_payload += MqttEncode_Vbi(tx_payload, props_len);
+
+        /* Encode properties */
+        tmp = MqttEncode_Props(MQTT_PACKET_TYPE_CONNECT_ACK,
+            connect_ack->props, tx_payload);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
+    }
+#endif
+    (void)tx_payload;
+
+    /* Return total length of packet */
+    return header_len + remain_len;
+}
+
+/* Decodes the fixed header of a subscribe or unsubscribe, whose flags are
+   reserved as QoS 1, and the packet ID */
+static int MqttDecode_SubscribeHeader(byte *rx_buf, int rx_buf_len,
+    byte type, int *remain_len, word16 *packet_id)
+{
+    int header_len;
+    MqttQoS qos;
+    byte retain, duplicate;
+
+    header_len = MqttDecode_FixedHeader(rx_buf, rx_buf_len, remain_len,
+        type, &qos, &retain, &duplicate);
+    if (header_len < 0) {
+        return header_len;
+    }
+    if (qos != MQTT_QOS_1 || retain || duplicate ||
+            *remain_len < MQTT_DATA_LEN_SIZE) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    if (header_len + *remain_len > rx_buf_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    (void)MqttDecode_Num(&rx_buf[header_len], packet_id);
+    if (*packet_id == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_ID);
+    }
+    return header_len + MQTT_DATA_LEN_SIZE;
+}
+
+int MqttDecode_Subscribe(byte *rx_buf, int rx_buf_len,
+    MqttSubscribe *subscribe)
+{
+    int header_len, remain_len, tmp, count = 0;
+    byte *rx_payload, *rx_end;
+    MqttTopic *topic;
+
+    /* Validate required arguments */
+    if (rx_buf == NULL || rx_buf_len <= 0 || subscribe == NULL ||
+            (subscribe->topics == NULL && subscribe->topic_count > 0)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Decode fixed header and packet ID */
+    tmp = MqttDecode_SubscribeHeader(rx_buf, rx_buf_len,
+        MQTT_PACKET_TYPE_SUBSCRIBE, &remain_len, &subscribe->packet_id);
+    if (tmp < 0) {
+        return tmp;
+    }
+    header_len = tmp - MQTT_DATA_LEN_SIZE;
+    rx_payload = &rx_buf[tmp];
+    rx_end = &rx_buf[header_len + remain_len];
+
+#ifdef WOLFMQTT_V5
+    subscribe->props = NULL;
+    subscribe->props_view.len = 0;
+    if (subscribe->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        tmp = MqttDecode_PropsAt(MQTT_PACKET_TYPE_SUBSCRIBE,
+            &subscribe->props_view, rx_payload, (int)(rx_end - rx_payload));
+        if (tmp < 0) {
+            return tmp;
+        }
+        rx_payload += tmp;
+    }
+#endif
+
+    /* Decode payload: topic filters, each followed by its options */
+    while (rx_payload < rx_end) {
+        const char *filter;
+        word16 filter_len;
+
+        tmp = MqttDecode_StringZ(rx_payload, (int)(rx_end - rx_payload),
+            &filter, &filter_len);
+        if (tmp < 0) {
+            return tmp;
+        }
+        rx_payload += tmp;
+        if (rx_payload >= rx_end) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+        }
+    #ifdef WOLFMQTT_UTF8
+        tmp = MqttUtf8_Validate(filter, filter_len, 0);
+        if (tmp != MQTT_CODE_SUCCESS) {
+            return tmp;
+        }
+    #endif
+        if (count >= subscribe->topic_count) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+        }
+        topic = &subscribe->topics[count++];
+        topic->topic_filter = filter;
+        /* QoS in bits 0-1, with the v5 subscription options above */
+        topic->qos = (MqttQoS)*rx_payload++;
+        topic->return_code = 0;
+        (void)filter_len;
+    }
+    if (count == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    subscribe->topic_count = count;
+
+    /* Return total length of packet */
+    return header_len + remain_len;
+}
+
+int MqttEncode_SubscribeAck(byte *tx_buf, int tx_buf_len,
+    MqttSubscribe *subscribe)
+{
+    int header_len, remain_len, i;
+    byte *tx_payload;
+#ifdef WOLFMQTT_V5
+    word32 props_len = 0;
+    int tmp;
+#endif
+
+    /* Validate required arguments */
+    if (tx_buf == NULL || subscribe == NULL || subscribe->topics == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Determine packet length */
+    remain_len = MQTT_DATA_LEN_SIZE + subscribe->topic_count;
+#ifdef WOLFMQTT_V5
+    if (subscribe->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        /* Determine length of properties */
+        remain_len += props_len = MqttEncode_Props(
+            MQTT_PACKET_TYPE_SUBSCRIBE_ACK, subscribe->ack.props, NULL);
+
+        /* Determine the length of the "property length" */
+        remain_len += MqttEncode_Vbi(NULL, props_len);
+    }
+#endif
+
+    /* Encode fixed header */
+    header_len = MqttEncode_FixedHeader(tx_buf, tx_buf_len, remain_len,
+        MQTT_PACKET_TYPE_SUBSCRIBE_ACK, 0, 0, 0);
+    if (header_len < 0) {
+        return header_len;
+    }
+    /* Check for buffer room */
+    if (tx_buf_len < header_len + remain_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    tx_payload = &tx_buf[header_len];
+
+    /* Encode variable header */
+    tx_payload += MqttEncode_Num(tx_payload, subscribe->packet_id);
+#ifdef WOLFMQTT_V5
+    if (subscribe->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        /* Encode the property length */
+        tx_payload += MqttEncode_Vbi(tx_payload, props_len);
+
+        /* Encode properties */
+        tmp = MqttEncode_Props(MQTT_PACKET_TYPE_SUBSCRIBE_ACK,
+            subscribe->ack.props, tx_payload);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
+    }
+#endif
+
+    /* Encode payload: return code of each topic */
+    for (i = 0; i < subscribe->topic_count; i++) {
+        *tx_payload++ = subscribe->topics[i].return_code;
+    }
+
+    /* Return total length of packet */
+    return header_len + remain_len;
+}
+
+int MqttDecode_Unsubscribe(byte *rx_buf, int rx_buf_len,
+    MqttUnsubscribe *unsubscribe)
+{
+    int header_len, remain_len, tmp, count = 0;
+    byte *rx_payload, *rx_end;
+    MqttTopic *topic;
+
+    /* Validate required arguments */
+    if (rx_buf == NULL || rx_buf_len <= 0 || unsubscribe == NULL ||
+            (unsubscribe->topics == NULL && unsubscribe->topic_count > 0)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Decode fixed header and packet ID */
+    tmp = MqttDecode_SubscribeHeader(rx_buf, rx_buf_len,
+        MQTT_PACKET_TYPE_UNSUBSCRIBE, &remain_len, &unsubscribe->packet_id);
+    if (tmp < 0) {
+        return tmp;
+    }
+    header_len = tmp - MQTT_DATA_LEN_SIZE;
+    rx_payload = &rx_buf[tmp];
+    rx_end = &rx_buf[header_len + remain_len];
+
+#ifdef WOLFMQTT_V5
+    unsubscribe->props = NULL;
+    unsubscribe->props_view.len = 0;
+    if (unsubscribe->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        tmp = MqttDecode_PropsAt(MQTT_PACKET_TYPE_UNSUBSCRIBE,
+            &unsubscribe->props_view, rx_payload, (int)(rx_end - rx_payload));
+        if (tmp < 0) {
+            return tmp;
+        }
+        rx_payload += tmp;
+    }
+#endif
+
+    /* Decode payload: topic filters */
+    while (rx_payload < rx_end) {
+        const char *filter;
+        word16 filter_len;
+
+        tmp = MqttDecode_StringZ(rx_payload, (int)(rx_end - rx_payload),
+            &filter, &filter_len);
+        if (tmp < 0) {
+            return tmp;
+        }
+        rx_payload += tmp;
+    #ifdef WOLFMQTT_UTF8
+        tmp = MqttUtf8_Validate(filter, filter_len, 0);
+        if (tmp != MQTT_CODE_SUCCESS) {
+            return tmp;
+        }
+    #endif
+        if (count >= unsubscribe->topic_count) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+        }
+        topic = &unsubscribe->topics[count++];
+        topic->topic_filter = filter;
+        topic->qos = MQTT_QOS_0;
+        topic->return_code = 0;
+        (void)filter_len;
+    }
+    if (count == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    unsubscribe->topic_count = count;
+
+    /* Return total length of packet */
+    return header_len + remain_len;
+}
+
+int MqttEncode_UnsubscribeAck(byte *tx_buf, int tx_buf_len,
+    MqttUnsubscribe *unsubscribe)
+{
+    int header_len, remain_len;
+    byte *tx_payload;
+#ifdef WOLFMQTT_V5
+    word32 props_len = 0;
+    int tmp, i;
+#endif
+
+    /* Validate required arguments */
+    if (tx_buf == NULL || unsubscribe == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Determine packet length */
+    remain_len = MQTT_DATA_LEN_SIZE; /* For packet_id */
+#ifdef WOLFMQTT_V5
+    if (unsubscribe->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        if (unsubscribe->topics == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+        }
+        /* Determine length of properties */
+        remain_len += props_len = MqttEncode_Props(
+            MQTT_PACKET_TYPE_UNSUBSCRIBE_ACK, unsubscribe->ack.props, NULL);
+
+        /* Determine the length of the "property length" */
+        remain_len += MqttEncode_Vbi(NULL, props_len);
+
+        /* Reason code of each topic */
+        remain_len += unsubscribe->topic_count;
+    }
+#endif
+
+    /* Encode fixed header */
+    header_len = MqttEncode_FixedHeader(tx_buf, tx_buf_len, remain_len,
+        MQTT_PACKET_TYPE_UNSUBSCRIBE_ACK, 0, 0, 0);
+    if (header_len < 0) {
+        return header_len;
+    }
+    /* Check for buffer room */
+    if (tx_buf_len < header_len + remain_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+    tx_payload = &tx_buf[header_len];
+
+    /* Encode variable header */
+    tx_payload += MqttEncode_Num(tx_payload, unsubscribe->packet_id);
+#ifdef WOLFMQTT_V5
+    if (unsubscribe->protocol_level >= MQTT_CONNECT_PROTOCOL_LEVEL_5) {
+        /* Encode the property length */
+        tx_payload += MqttEncode_Vbi(tx_payload, props_len);
+
+        /* Encode properties */
+        tmp = MqttEncode_Props(MQTT_PACKET_TYPE_UNSUBSCRIBE_ACK,
+            unsubscribe->ack.props, tx_payload);
+        if (tmp < 0) {
+            return tmp;
+        }
+        tx_payload += tmp;
+
+        /* Encode payload: reason code of each topic */
+        for (i = 0; i < unsubscribe->topic_count; i++) {
+            *tx_payload++ = unsubscribe->topics[i].return_code;
+        }
+    }
+#endif
+    (void)tx_payload;
+
+    /* Return total length of packet */
+    return header_len + remain_len;
+}
+
+int MqttEncode_PingResp(byte *tx_buf, int tx_buf_len)
+{
+    /* Validate required arguments */
+    if (tx_buf == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Fixed header only */
+    return MqttEncode_FixedHeader(tx_buf, tx_buf_len, 0,
+        MQTT_PACKET_TYPE_PING_RESP, 0, 0, 0);
+}
+#endif /* WOLFMQTT_BROKER */
+
 int MqttPacket_HandleNetError(MqttClient *client, int rc)
 {
     (void)client;
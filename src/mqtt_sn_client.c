@@ -26,9 +26,88 @@
 
 #include "wolfmqtt/mqtt_sn_client.h"
 
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_SN_SLEEP: Tracks the sleeping client state (SN_Client_GetState).
+ *  A Disconnect with a sleep duration puts the client asleep, a Ping with
+ *  the client ID wakes it to receive the messages the gateway buffered, and
+ *  the Ping Response puts it back to sleep. Wake ups and buffered messages
+ *  are counted in client->sn_sleep_stats.
+ */
+
 #ifdef WOLFMQTT_SN
 
 /* Private functions */
+#ifdef WOLFMQTT_SN_REGISTRY
+/* Replaces the topic ID of a received publish with the topic name */
+static void SN_Client_TopicName(SN_TopicRegistry *reg, SN_Publish *publish)
+{
+    word16 topic_id;
+
+    if (publish->topic_type == SN_TOPIC_ID_TYPE_SHORT) {
+        publish->topic_type = SN_TOPIC_ID_TYPE_NAME;
+        return;
+    }
+    topic_id = (word16)(((byte)publish->topic_name[0] << 8) |
+        (byte)publish->topic_name[1]);
+    publish->resp.topicId = topic_id;
+    if (SN_TopicRegistry_FindId(reg, topic_id,
+                publish->topic_type, &publish->topic_name,
+                &publish->topic_name_len) == MQTT_CODE_SUCCESS) {
+        publish->topic_type = SN_TOPIC_ID_TYPE_NAME;
+    }
+}
+#endif
+
+#ifdef WOLFMQTT_SN_WINDOW
+/* Completes a publish removed from the window */
+static void SN_Client_PubWindowDone(MqttClient *client, SN_PubWindow *win,
+    SN_Publish *publish, int rc)
+{
+#ifdef WOLFMQTT_SN_RETRY
+    if (rc == MQTT_CODE_SUCCESS && client->sn_retry != NULL &&
+            publish->stat.retries == 0) {
+        /* Only round trips of publishes sent once are measured */
+        SN_Retry_Sample(client->sn_retry,
+            SN_Retry_Now(client->sn_retry) - publish->stat.sent_ms);
+    }
+#endif
+    publish->duplicate = 0;
+
+    if (SN_PubWindow_Lock(win) == 0) {
+        if (rc == MQTT_CODE_SUCCESS) {
+            win->stats.acked++;
+        }
+        else {
+            win->stats.failed++;
+        }
+        SN_PubWindow_Unlock(win);
+    }
+    if (win->cb != NULL) {
+        win->cb(client, publish, rc, win->ctx);
+    }
+}
+
+/* Completes the publish of the window acknowledged by a PUBACK or PUBCOMP */
+static void SN_Client_PubWindowAck(MqttClient *client,
+    SN_PublishResp *publish_resp)
+{
+    SN_PubWindow *win = client->sn_window;
+    SN_Publish *publish;
+
+    if (win == NULL) {
+        return;
+    }
+    publish = SN_PubWindow_Remove(win, publish_resp->packet_id);
+    if (publish != NULL) {
+        publish->resp.packet_id = publish_resp->packet_id;
+        publish->resp.return_code = publish_resp->return_code;
+        publish->return_code = publish_resp->return_code;
+        SN_Client_PubWindowDone(client, win, publish, MQTT_CODE_SUCCESS);
+    }
+}
+#endif /* WOLFMQTT_SN_WINDOW */
+
 static int SN_Client_HandlePacket(MqttClient* client, SN_MsgType packet_type,
     void* packet_obj, int timeout)
 {
@@ -68,6 +147,13 @@ static int SN_Client_HandlePacket(MqttClient* client, SN_MsgType packet_type,
             }
             p_connect_ack->return_code =
                     client->rx_buf[client->packet.buf_len-1];
+        #ifdef WOLFMQTT_SN_SLEEP
+            if (p_connect_ack->return_code == SN_RC_ACCEPTED) {
+                /* A connect also ends sleeping */
+                client->sn_state = SN_CLIENT_STATE_ACTIVE;
+                client->sn_sleep_sec = 0;
+            }
+        #endif
 
             break;
         }
@@ -97,9 +183,21 @@ static int SN_Client_HandlePacket(MqttClient* client, SN_MsgType packet_type,
                 reg_s.regack.topicId = reg_s.topicId;
                 reg_s.regack.return_code = SN_RC_NOTSUPPORTED;
 
+            #ifdef WOLFMQTT_SN_REGISTRY
+                /* Record the topic ID the gateway uses */
+                if (client->sn_reg != NULL) {
+                    rc = SN_TopicRegistry_Set(client->sn_reg,
+                        reg_s.topicName, (word16)XSTRLEN(reg_s.topicName),
+                        reg_s.topicId, SN_TOPIC_ID_TYPE_NORMAL);
+                    reg_s.regack.return_code = (rc == MQTT_CODE_SUCCESS) ?
+                        SN_RC_ACCEPTED : SN_RC_CONGESTION;
+                }
+            #endif
+
                 /* Call the register callback to allow app to
                    handle new topic ID assignment. */
-                if (client->reg_cb != NULL) {
+                if (client->reg_cb != NULL &&
+                        reg_s.regack.return_code != SN_RC_CONGESTION) {
                      rc = client->reg_cb(reg_s.topicId,
                             reg_s.topicName, client->reg_ctx);
                      /* Set the regack return code */
@@ -181,6 +279,17 @@ static int SN_Client_HandlePacket(MqttClient* client, SN_MsgType packet_type,
             if (rc <= 0) {
                 return rc;
             }
+        #ifdef WOLFMQTT_SN_REGISTRY
+            if (client->sn_reg != NULL) {
+                SN_Client_TopicName(client->sn_reg, p_pub);
+            }
+        #endif
+        #ifdef WOLFMQTT_SN_SLEEP
+            if (client->sn_state == SN_CLIENT_STATE_AWAKE) {
+                /* Buffered by the gateway while asleep */
+                client->sn_sleep_stats.buffered++;
+            }
+        #endif
 
             /* Issue callback for new message */
             if (client->msg_cb) {
@@ -260,6 +369,13 @@ static int SN_Client_HandlePacket(MqttClient* client, SN_MsgType packet_type,
             }
             packet_id = p_publish_resp->packet_id;
 
+        #ifdef WOLFMQTT_SN_WINDOW
+            if (packet_type == SN_MSG_TYPE_PUBACK ||
+                packet_type == SN_MSG_TYPE_PUBCOMP) {
+                SN_Client_PubWindowAck(client, p_publish_resp);
+            }
+        #endif
+
             /* If Qos then send response */
             if (packet_type == SN_MSG_TYPE_PUBREC ||
                 packet_type == SN_MSG_TYPE_PUBREL) {
@@ -343,6 +459,12 @@ static int SN_Client_HandlePacket(MqttClient* client, SN_MsgType packet_type,
         {
             /* Decode ping */
             rc = SN_Decode_Ping(client->rx_buf, client->packet.buf_len);
+        #ifdef WOLFMQTT_SN_SLEEP
+            if (rc > 0 && client->sn_state == SN_CLIENT_STATE_AWAKE) {
+                /* All buffered messages sent, back to sleep */
+                client->sn_state = SN_CLIENT_STATE_ASLEEP;
+            }
+        #endif
             break;
         }
         case SN_MSG_TYPE_PING_REQ:
@@ -428,6 +550,16 @@ static int SN_Client_HandlePacket(MqttClient* client, SN_MsgType packet_type,
             }
             /* Decode Disconnect */
             rc = SN_Decode_Disconnect(client->rx_buf, client->packet.buf_len);
+        #ifdef WOLFMQTT_SN_SLEEP
+            if (rc > 0 && !client->sn_sleep_req) {
+                /* Not the ack of a sleep request, the gateway closed the
+                   connection. A wake up ping gets no response then. */
+                if (client->sn_state == SN_CLIENT_STATE_AWAKE) {
+                    rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_NETWORK);
+                }
+                client->sn_state = SN_CLIENT_STATE_DISCONNECTED;
+            }
+        #endif
 
 #ifdef WOLFMQTT_DISCONNECT_CB
             /* Call disconnect callback to allow handling broker disconnect */
@@ -808,215 +940,771 @@ wait_again:
     return rc;
 }
 
-/* Public Functions */
-
-int SN_Client_SetRegisterCallback(MqttClient *client,
-        SN_ClientRegisterCb regCb,
-        void* ctx)
+#ifdef WOLFMQTT_SN_RETRY
+/* Starts the retransmission timer of a request just sent */
+static void SN_Client_RetryStart(MqttClient *client, void *packet_obj)
 {
-    int rc = MQTT_CODE_SUCCESS;
-
-    if (client == NULL)
-        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
-
-#ifdef WOLFMQTT_MULTITHREAD
-    rc = wm_SemLock(&client->lockClient);
-    if (rc == 0) {
-#endif
-
-        client->reg_cb = regCb;
-        client->reg_ctx = ctx;
+    MqttMsgStat *stat = (MqttMsgStat*)packet_obj;
 
-#ifdef WOLFMQTT_MULTITHREAD
-        wm_SemUnlock(&client->lockClient);
+    if (client->sn_retry != NULL) {
+        stat->sent_ms = SN_Retry_Now(client->sn_retry);
     }
-#endif
-
-    return rc;
+    stat->retries = 0;
 }
+#endif
 
-int SN_Client_SearchGW(MqttClient *client, SN_SearchGw *search)
+/* Encodes and sends a register packet */
+static int SN_Client_RegisterSend(MqttClient *client, SN_Register *regist)
 {
     int rc;
 
-    /* Validate required arguments */
-    if (client == NULL || search == NULL) {
-        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+#ifdef WOLFMQTT_MULTITHREAD
+    /* Lock send socket mutex */
+    rc = wm_SemLock(&client->lockSend);
+    if (rc != 0) {
+        return rc;
     }
+#endif
 
-    if (search->stat.write == MQTT_MSG_BEGIN) {
+    /* Encode the register packet */
+    rc = SN_Encode_Register(client->tx_buf, client->tx_buf_len, regist);
+#ifdef WOLFMQTT_DEBUG_CLIENT
+    PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d)",
+        rc, SN_Packet_TypeDesc(SN_MSG_TYPE_REGISTER),
+        SN_MSG_TYPE_REGISTER);
+#endif
+    if (rc <= 0) {
     #ifdef WOLFMQTT_MULTITHREAD
-        /* Lock send socket mutex */
-        rc = wm_SemLock(&client->lockSend);
-        if (rc != 0) {
-            return rc;
-        }
+        wm_SemUnlock(&client->lockSend);
     #endif
+        return rc;
+    }
+    client->write.len = rc;
 
-        /* Encode the search packet */
-        rc = SN_Encode_SearchGW(client->tx_buf, client->tx_buf_len,
-                search->radius);
-    #ifdef WOLFMQTT_DEBUG_CLIENT
-        PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d)",
-            rc, SN_Packet_TypeDesc(SN_MSG_TYPE_SEARCHGW),
-            SN_MSG_TYPE_SEARCHGW);
-    #endif
-        if (rc <= 0) {
-        #ifdef WOLFMQTT_MULTITHREAD
-            wm_SemUnlock(&client->lockSend);
-        #endif
-            return rc;
-        }
-        client->write.len = rc;
+#ifdef WOLFMQTT_MULTITHREAD
+    rc = wm_SemLock(&client->lockClient);
+    if (rc == 0) {
+        /* inform other threads of expected response */
+        rc = MqttClient_RespList_Add(client,
+                (MqttPacketType)SN_MSG_TYPE_REGACK,
+                regist->packet_id, &regist->pendResp, &regist->regack);
+        wm_SemUnlock(&client->lockClient);
+    }
+    if (rc != 0) {
+        wm_SemUnlock(&client->lockSend);
+        return rc; /* Error locking client */
+    }
+#endif
 
+    /* Send register packet */
+    rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
+    if (rc != client->write.len) {
     #ifdef WOLFMQTT_MULTITHREAD
-        rc = wm_SemLock(&client->lockClient);
-        if (rc == 0) {
-            /* inform other threads of expected response */
-            rc = MqttClient_RespList_Add(client,
-                    (MqttPacketType)SN_MSG_TYPE_GWINFO, 0,
-                    &search->pendResp, &search->gwInfo);
+        wm_SemUnlock(&client->lockSend);
+        if (wm_SemLock(&client->lockClient) == 0) {
+            MqttClient_RespList_Remove(client, &regist->pendResp);
             wm_SemUnlock(&client->lockClient);
         }
-        if (rc != 0) {
-            wm_SemUnlock(&client->lockSend);
-            return rc; /* Error locking client */
-        }
     #endif
+        return rc;
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_SemUnlock(&client->lockSend);
+#endif
+#ifdef WOLFMQTT_SN_RETRY
+    SN_Client_RetryStart(client, regist);
+#endif
 
-        /* Send search for gateway packet */
-        rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
-        if (rc != client->write.len) {
-        #ifdef WOLFMQTT_MULTITHREAD
-            wm_SemUnlock(&client->lockSend);
-            if (wm_SemLock(&client->lockClient) == 0) {
-                MqttClient_RespList_Remove(client, &search->pendResp);
-                wm_SemUnlock(&client->lockClient);
-            }
-        #endif
-            return rc;
-        }
-    #ifdef WOLFMQTT_MULTITHREAD
-        wm_SemUnlock(&client->lockSend);
-    #endif
+    regist->stat.write = MQTT_MSG_WAIT;
+    return MQTT_CODE_SUCCESS;
+}
 
-        search->stat.write = MQTT_MSG_WAIT;
-    }
+#if (defined(WOLFMQTT_SN_RETRY) || defined(WOLFMQTT_SN_WINDOW)) && \
+    defined(WOLFMQTT_SN_REGISTRY)
+static int SN_Client_PublishTopic(MqttClient *client, const char *name,
+    byte *topic_type, word16 *topic);
+#endif
 
-    /* Wait for gateway info packet */
-    rc = SN_Client_WaitType(client, &search->gwInfo, SN_MSG_TYPE_GWINFO, 0,
-        client->cmd_timeout_ms);
-#ifdef WOLFMQTT_NONBLOCK
-    if (rc == MQTT_CODE_CONTINUE)
+/* Encodes a publish packet. With a topic name (SN_TOPIC_ID_TYPE_NAME) the
+   topic found for it is given (see SN_Client_PublishTopic). */
+static int SN_Client_EncodePublish(MqttClient *client, SN_Publish *publish,
+    byte topic_type, const char *topic_name)
+{
+    int rc;
+
+#ifdef WOLFMQTT_SN_REGISTRY
+    if (publish->topic_type == SN_TOPIC_ID_TYPE_NAME) {
+        /* Encode with the topic found, keeping the name */
+        const char *name = publish->topic_name;
+        publish->topic_type = topic_type;
+        publish->topic_name = topic_name;
+        rc = SN_Encode_Publish(client->tx_buf, client->tx_buf_len, publish);
+        publish->topic_type = SN_TOPIC_ID_TYPE_NAME;
+        publish->topic_name = name;
         return rc;
-#endif
-#ifdef WOLFMQTT_MULTITHREAD
-    if (wm_SemLock(&client->lockClient) == 0) {
-        MqttClient_RespList_Remove(client, &search->pendResp);
-        wm_SemUnlock(&client->lockClient);
     }
 #endif
+    (void)topic_type;
+    (void)topic_name;
 
-    /* reset state */
-    search->stat.write = MQTT_MSG_BEGIN;
-
+    rc = SN_Encode_Publish(client->tx_buf, client->tx_buf_len, publish);
     return rc;
 }
 
-static int SN_WillTopic(MqttClient *client, SN_Will *will)
+#if defined(WOLFMQTT_SN_RETRY) || defined(WOLFMQTT_SN_WINDOW)
+/* Encodes and sends a publish, without a state kept between calls */
+static int SN_Client_PublishWrite(MqttClient *client, SN_Publish *publish)
 {
     int rc;
-
-    /* Validate required arguments */
-    if (client == NULL) {
-        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    byte topic_type = publish->topic_type;
+    const char *topic_name = publish->topic_name;
+#ifdef WOLFMQTT_SN_REGISTRY
+    word16 topic = 0;
+
+    if (topic_type == SN_TOPIC_ID_TYPE_NAME) {
+        rc = SN_Client_PublishTopic(client, topic_name, &topic_type, &topic);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+        topic_name = (const char*)&topic;
     }
+#endif
 
 #ifdef WOLFMQTT_MULTITHREAD
-    rc = wm_SemLock(&client->lockClient);
-    if (rc == 0) {
-        /* inform other threads of expected response */
-        rc = MqttClient_RespList_Add(client,
-                (MqttPacketType)SN_MSG_TYPE_WILLTOPICREQ, 0,
-                &will->pendResp, &will->resp.topicResp);
-        wm_SemUnlock(&client->lockClient);
-    }
+    /* Lock send socket mutex */
+    rc = wm_SemLock(&client->lockSend);
     if (rc != 0) {
-        return rc; /* Error locking client */
-    }
-#endif
-
-    /* Wait for Will Topic Request packet */
-    rc = SN_Client_WaitType(client, will,
-            SN_MSG_TYPE_WILLTOPICREQ, 0, client->cmd_timeout_ms);
-#ifdef WOLFMQTT_NONBLOCK
-    if (rc == MQTT_CODE_CONTINUE)
         return rc;
-#endif
-
-#ifdef WOLFMQTT_MULTITHREAD
-    if (wm_SemLock(&client->lockClient) == 0) {
-        MqttClient_RespList_Remove(client, &will->pendResp);
-        wm_SemUnlock(&client->lockClient);
     }
 #endif
-    if (rc == 0) {
-    #ifdef WOLFMQTT_MULTITHREAD
-        /* Lock send socket mutex */
-        rc = wm_SemLock(&client->lockSend);
-        if (rc != 0) {
-            return rc;
-        }
-    #endif
 
-        /* Encode Will Topic */
-        rc = SN_Encode_WillTopic(client->tx_buf, client->tx_buf_len,
-                will);
-    #ifdef WOLFMQTT_DEBUG_CLIENT
-        PRINTF("EncodePacket: Len %d, Type %s (%d)",
-            rc, SN_Packet_TypeDesc(SN_MSG_TYPE_WILLTOPIC),
-            SN_MSG_TYPE_WILLTOPIC);
-    #endif
-        if (rc > 0) {
-            /* Send Will Topic packet */
-            client->write.len = rc;
+    rc = SN_Client_EncodePublish(client, publish, topic_type, topic_name);
+#ifdef WOLFMQTT_DEBUG_CLIENT
+    PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d), ID %d, QoS %d,"
+            " Dup %d",
+        rc, SN_Packet_TypeDesc(SN_MSG_TYPE_PUBLISH), SN_MSG_TYPE_PUBLISH,
+        publish->packet_id, publish->qos, publish->duplicate);
+#endif
+    if (rc > 0) {
+        client->write.len = rc;
+        do {
             rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
-            if (rc == client->write.len) {
-                rc = 0;
-            }
+        } while (rc == MQTT_CODE_CONTINUE);
+        if (rc == client->write.len) {
+            rc = MQTT_CODE_SUCCESS;
+        }
+        else if (rc >= 0) {
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_NETWORK);
         }
-    #ifdef WOLFMQTT_MULTITHREAD
-        wm_SemUnlock(&client->lockSend);
-    #endif
     }
 
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_SemUnlock(&client->lockSend);
+#endif
+
     return rc;
 }
+#endif /* WOLFMQTT_SN_RETRY || WOLFMQTT_SN_WINDOW */
 
-static int SN_WillMessage(MqttClient *client, SN_Will *will)
+#ifdef WOLFMQTT_SN_RETRY
+/* Sends a request again, with the DUP flag on SUBSCRIBE and PUBLISH */
+static int SN_Client_Resend(MqttClient *client, byte type, void *packet_obj)
 {
     int rc;
 
-    /* Validate required arguments */
-    if (client == NULL) {
-        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    if (type == SN_MSG_TYPE_PUBLISH) {
+        ((SN_Publish*)packet_obj)->duplicate = 1;
+        return SN_Client_PublishWrite(client, (SN_Publish*)packet_obj);
     }
 
 #ifdef WOLFMQTT_MULTITHREAD
-    rc = wm_SemLock(&client->lockClient);
-    if (rc == 0) {
-        /* inform other threads of expected response */
-        rc = MqttClient_RespList_Add(client,
-                (MqttPacketType)SN_MSG_TYPE_WILLMSGREQ, 0,
-                &will->pendResp, &will->resp.msgResp);
-        wm_SemUnlock(&client->lockClient);
-    }
+    /* Lock send socket mutex */
+    rc = wm_SemLock(&client->lockSend);
     if (rc != 0) {
-        return rc; /* Error locking client */
+        return rc;
     }
 #endif
 
-    /* Wait for Will Message Request */
+    switch (type) {
+        case SN_MSG_TYPE_CONNECT:
+            rc = SN_Encode_Connect(client->tx_buf, client->tx_buf_len,
+                    (SN_Connect*)packet_obj);
+            break;
+        case SN_MSG_TYPE_REGISTER:
+            rc = SN_Encode_Register(client->tx_buf, client->tx_buf_len,
+                    (SN_Register*)packet_obj);
+            break;
+        case SN_MSG_TYPE_SUBSCRIBE:
+            ((SN_Subscribe*)packet_obj)->duplicate = 1;
+            rc = SN_Encode_Subscribe(client->tx_buf, client->tx_buf_len,
+                    (SN_Subscribe*)packet_obj);
+            break;
+        default:
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_TYPE);
+            break;
+    }
+#ifdef WOLFMQTT_DEBUG_CLIENT
+    PRINTF("SN_Client_Resend: Len %d, Type %s (%d)",
+        rc, SN_Packet_TypeDesc((SN_MsgType)type), type);
+#endif
+    if (rc > 0) {
+        client->write.len = rc;
+        do {
+            rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
+        } while (rc == MQTT_CODE_CONTINUE);
+        if (rc == client->write.len) {
+            rc = MQTT_CODE_SUCCESS;
+        }
+        else if (rc >= 0) {
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_NETWORK);
+        }
+    }
+
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_SemUnlock(&client->lockSend);
+#endif
+
+    return rc;
+}
+#endif /* WOLFMQTT_SN_RETRY */
+
+/* Waits for the response to a request. With a retransmission timer set, the
+   request (when not NULL) is sent again each time the timeout expires. */
+static int SN_Client_WaitResp(MqttClient *client, byte req_type, void *req,
+    void *resp, byte wait_type, word16 wait_packet_id)
+{
+    int rc;
+#ifdef WOLFMQTT_SN_RETRY
+    SN_Retry *retry = client->sn_retry;
+    MqttMsgStat *req_stat = (MqttMsgStat*)req;
+
+    if (retry != NULL && req != NULL) {
+        for (;;) {
+            word32 elapsed = SN_Retry_Now(retry) - req_stat->sent_ms;
+            word32 rto = SN_Retry_Timeout(retry, req_stat->retries);
+
+            /* Wait for the remaining time, or check for a late response */
+            rc = SN_Client_WaitType(client, resp, wait_type, wait_packet_id,
+                    (elapsed < rto) ? (int)(rto - elapsed) : 1);
+        #ifdef WOLFMQTT_NONBLOCK
+            if (rc == MQTT_CODE_CONTINUE) {
+                if (((MqttMsgStat*)resp)->read != MQTT_MSG_BEGIN) {
+                    return rc;
+                }
+                rc = MQTT_CODE_ERROR_TIMEOUT;
+            }
+        #endif
+            if (rc != MQTT_CODE_ERROR_TIMEOUT) {
+                if (rc == MQTT_CODE_SUCCESS && req_stat->retries == 0) {
+                    /* Only round trips of requests sent once are measured */
+                    SN_Retry_Sample(retry,
+                        SN_Retry_Now(retry) - req_stat->sent_ms);
+                }
+                break;
+            }
+            if (SN_Retry_Now(retry) - req_stat->sent_ms <
+                    SN_Retry_Timeout(retry, req_stat->retries)) {
+            #ifdef WOLFMQTT_NONBLOCK
+                return MQTT_CODE_CONTINUE;
+            #else
+                continue; /* read timed out early */
+            #endif
+            }
+            if (!SN_Retry_Expired(retry, req_stat->retries)) {
+                break; /* retries used up */
+            }
+            req_stat->retries++;
+            rc = SN_Client_Resend(client, req_type, req);
+            req_stat->sent_ms = SN_Retry_Now(retry);
+            if (rc != MQTT_CODE_SUCCESS) {
+                break;
+            }
+        }
+
+        if (req_stat->retries > 0) {
+            /* Clear the DUP flag set for the retransmissions */
+            if (req_type == SN_MSG_TYPE_SUBSCRIBE) {
+                ((SN_Subscribe*)req)->duplicate = 0;
+            }
+            else if (req_type == SN_MSG_TYPE_PUBLISH) {
+                ((SN_Publish*)req)->duplicate = 0;
+            }
+        }
+        return rc;
+    }
+#endif
+    (void)req_type;
+    (void)req;
+
+    rc = SN_Client_WaitType(client, resp, wait_type, wait_packet_id,
+            client->cmd_timeout_ms);
+    return rc;
+}
+
+#ifdef WOLFMQTT_SN_REGISTRY
+/* Gives up the registrations in flight, the topics are registered again
+   later */
+static void SN_Client_RegisterAbort(MqttClient *client, SN_TopicRegistry *reg)
+{
+    int i;
+
+    for (i = 0; i < SN_REGISTRY_WINDOW; i++) {
+        if (reg->reg_entry[i] == 0) {
+            continue;
+        }
+    #ifdef WOLFMQTT_MULTITHREAD
+        if (reg->regs[i].stat.write == MQTT_MSG_WAIT &&
+                wm_SemLock(&client->lockClient) == 0) {
+            MqttClient_RespList_Remove(client, &reg->regs[i].pendResp);
+            wm_SemUnlock(&client->lockClient);
+        }
+    #endif
+        SN_TopicRegistry_Registered(reg, reg->reg_entry[i], 0,
+            SN_TOPIC_STATE_NEW);
+        reg->reg_entry[i] = 0;
+        reg->regs[i].stat.write = MQTT_MSG_BEGIN;
+    }
+    (void)client;
+}
+
+/* Registers all new topics of the registry, with up to SN_REGISTRY_WINDOW
+   REGISTER packets sent before waiting for the REGACKs */
+static int SN_Client_RegisterNew(MqttClient *client)
+{
+    int rc, i, inflight;
+    word16 pos = 1, idx;
+    SN_TopicRegistry *reg = client->sn_reg;
+    SN_RegAck *regack;
+
+#ifdef WOLFMQTT_MULTITHREAD
+    rc = wm_SemLock(&reg->reg_lock);
+    if (rc != 0) {
+        return rc;
+    }
+#endif
+
+    do {
+        /* Fill the window */
+        rc = MQTT_CODE_SUCCESS;
+        inflight = -1;
+        for (i = 0; i < SN_REGISTRY_WINDOW; i++) {
+            SN_Register *regist = &reg->regs[i];
+
+            if (reg->reg_entry[i] == 0 && pos != 0) {
+                idx = SN_TopicRegistry_NextNew(reg, pos);
+                pos = (idx != 0) ? (word16)(idx + 1) : 0;
+                if (idx != 0) {
+                    XMEMSET(regist, 0, sizeof(SN_Register));
+                    regist->topicName = reg->entries[idx - 1].name;
+                    if (++reg->packet_id == 0) {
+                        reg->packet_id = 1;
+                    }
+                    regist->packet_id = reg->packet_id;
+                    reg->reg_entry[i] = idx;
+                }
+            }
+            if (reg->reg_entry[i] == 0) {
+                continue;
+            }
+            if (regist->stat.write == MQTT_MSG_BEGIN) {
+                rc = SN_Client_RegisterSend(client, regist);
+                if (rc != MQTT_CODE_SUCCESS) {
+                    break;
+                }
+            }
+            if (inflight < 0) {
+                inflight = i;
+            }
+        #ifdef WOLFMQTT_SN_RETRY
+            else if ((int)(regist->stat.sent_ms -
+                    reg->regs[inflight].stat.sent_ms) < 0) {
+                /* Time the oldest registration */
+                inflight = i;
+            }
+        #endif
+        }
+        if (rc != MQTT_CODE_SUCCESS || inflight < 0) {
+            break;
+        }
+
+        /* Wait for a register acknowledge packet */
+    #ifdef WOLFMQTT_MULTITHREAD
+        regack = &reg->regs[inflight].regack;
+        rc = SN_Client_WaitResp(client, SN_MSG_TYPE_REGISTER,
+                &reg->regs[inflight], regack, SN_MSG_TYPE_REGACK,
+                reg->regs[inflight].packet_id);
+    #else
+        /* REGACKs may come in any order, so take the first one */
+        regack = &reg->regack;
+        rc = SN_Client_WaitResp(client, SN_MSG_TYPE_REGISTER,
+                &reg->regs[inflight], regack, SN_MSG_TYPE_REGACK, 0);
+    #endif
+        if (rc != MQTT_CODE_SUCCESS) {
+            break;
+        }
+        for (i = 0; i < SN_REGISTRY_WINDOW; i++) {
+            if (reg->reg_entry[i] != 0 &&
+                    reg->regs[i].stat.write == MQTT_MSG_WAIT &&
+                    reg->regs[i].packet_id == regack->packet_id) {
+            #ifdef WOLFMQTT_MULTITHREAD
+                if (wm_SemLock(&client->lockClient) == 0) {
+                    MqttClient_RespList_Remove(client, &reg->regs[i].pendResp);
+                    wm_SemUnlock(&client->lockClient);
+                }
+            #endif
+                SN_TopicRegistry_Registered(reg, reg->reg_entry[i],
+                    regack->topicId,
+                    (regack->return_code == SN_RC_ACCEPTED) ?
+                        SN_TOPIC_STATE_REGISTERED : SN_TOPIC_STATE_REJECTED);
+                reg->reg_entry[i] = 0;
+                reg->regs[i].stat.write = MQTT_MSG_BEGIN;
+                break;
+            }
+        }
+    } while (1);
+
+#ifdef WOLFMQTT_NONBLOCK
+    if (rc == MQTT_CODE_CONTINUE) {
+    #ifdef WOLFMQTT_MULTITHREAD
+        wm_SemUnlock(&reg->reg_lock);
+    #endif
+        return rc;
+    }
+#endif
+    if (rc != MQTT_CODE_SUCCESS) {
+        SN_Client_RegisterAbort(client, reg);
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_SemUnlock(&reg->reg_lock);
+#endif
+    return rc;
+}
+
+/* Finds the topic to publish a topic name with, registering it first when
+   new. Two character names are sent as short topics. topic is set to the
+   encoded topic (see SN_Publish topic_name). */
+static int SN_Client_PublishTopic(MqttClient *client, const char *name,
+    byte *topic_type, word16 *topic)
+{
+    int rc;
+    word16 name_len, topic_id = 0;
+
+    if (client->sn_reg == NULL || name == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    name_len = (word16)XSTRLEN(name);
+    if (name_len == 2) {
+        *topic_type = SN_TOPIC_ID_TYPE_SHORT;
+        XMEMCPY(topic, name, 2);
+        return MQTT_CODE_SUCCESS;
+    }
+
+    rc = SN_TopicRegistry_Lookup(client->sn_reg, name, name_len, &topic_id,
+            topic_type);
+    if (rc == SN_TOPIC_STATE_NEW || rc == SN_TOPIC_STATE_PENDING) {
+        rc = SN_Client_RegisterNew(client);
+        if (rc == MQTT_CODE_SUCCESS) {
+            rc = SN_TopicRegistry_Lookup(client->sn_reg, name, name_len,
+                    &topic_id, topic_type);
+        }
+    }
+    if (rc < 0) {
+        return rc;
+    }
+    if (rc != SN_TOPIC_STATE_REGISTERED) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_NOT_FOUND);
+    }
+
+    if (*topic_type == SN_TOPIC_ID_TYPE_PREDEF) {
+        ((byte*)topic)[0] = (byte)(topic_id >> 8);
+        ((byte*)topic)[1] = (byte)topic_id;
+    }
+    else {
+        *topic = topic_id;
+    }
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Registers the new topics of the registry once connected */
+static int SN_Client_ConnectRegister(MqttClient *client,
+    SN_Connect *mc_connect)
+{
+    int rc;
+
+    if (mc_connect->stat.write != MQTT_MSG_PAYLOAD) {
+        SN_TopicRegistry_Reset(client->sn_reg, mc_connect->clean_session);
+        mc_connect->stat.write = MQTT_MSG_PAYLOAD;
+    }
+    rc = SN_Client_RegisterNew(client);
+#ifdef WOLFMQTT_NONBLOCK
+    if (rc == MQTT_CODE_CONTINUE)
+        return rc;
+#endif
+
+    /* reset state */
+    mc_connect->stat.write = MQTT_MSG_BEGIN;
+
+    return rc;
+}
+#endif /* WOLFMQTT_SN_REGISTRY */
+
+/* Public Functions */
+
+int SN_Client_SetRegisterCallback(MqttClient *client,
+        SN_ClientRegisterCb regCb,
+        void* ctx)
+{
+    int rc = MQTT_CODE_SUCCESS;
+
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+#ifdef WOLFMQTT_MULTITHREAD
+    rc = wm_SemLock(&client->lockClient);
+    if (rc == 0) {
+#endif
+
+        client->reg_cb = regCb;
+        client->reg_ctx = ctx;
+
+#ifdef WOLFMQTT_MULTITHREAD
+        wm_SemUnlock(&client->lockClient);
+    }
+#endif
+
+    return rc;
+}
+
+#ifdef WOLFMQTT_SN_REGISTRY
+int SN_Client_SetRegistry(MqttClient *client, SN_TopicRegistry *reg)
+{
+    int rc = MQTT_CODE_SUCCESS;
+
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+#ifdef WOLFMQTT_MULTITHREAD
+    rc = wm_SemLock(&client->lockClient);
+    if (rc == 0) {
+#endif
+
+        client->sn_reg = reg;
+
+#ifdef WOLFMQTT_MULTITHREAD
+        wm_SemUnlock(&client->lockClient);
+    }
+#endif
+
+    return rc;
+}
+#endif
+
+#ifdef WOLFMQTT_SN_RETRY
+int SN_Client_SetRetry(MqttClient *client, SN_Retry *retry)
+{
+    int rc = MQTT_CODE_SUCCESS;
+
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+#ifdef WOLFMQTT_MULTITHREAD
+    rc = wm_SemLock(&client->lockClient);
+    if (rc == 0) {
+#endif
+
+        client->sn_retry = retry;
+
+#ifdef WOLFMQTT_MULTITHREAD
+        wm_SemUnlock(&client->lockClient);
+    }
+#endif
+
+    return rc;
+}
+#endif
+
+int SN_Client_SearchGW(MqttClient *client, SN_SearchGw *search)
+{
+    int rc;
+
+    /* Validate required arguments */
+    if (client == NULL || search == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    if (search->stat.write == MQTT_MSG_BEGIN) {
+    #ifdef WOLFMQTT_MULTITHREAD
+        /* Lock send socket mutex */
+        rc = wm_SemLock(&client->lockSend);
+        if (rc != 0) {
+            return rc;
+        }
+    #endif
+
+        /* Encode the search packet */
+        rc = SN_Encode_SearchGW(client->tx_buf, client->tx_buf_len,
+                search->radius);
+    #ifdef WOLFMQTT_DEBUG_CLIENT
+        PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d)",
+            rc, SN_Packet_TypeDesc(SN_MSG_TYPE_SEARCHGW),
+            SN_MSG_TYPE_SEARCHGW);
+    #endif
+        if (rc <= 0) {
+        #ifdef WOLFMQTT_MULTITHREAD
+            wm_SemUnlock(&client->lockSend);
+        #endif
+            return rc;
+        }
+        client->write.len = rc;
+
+    #ifdef WOLFMQTT_MULTITHREAD
+        rc = wm_SemLock(&client->lockClient);
+        if (rc == 0) {
+            /* inform other threads of expected response */
+            rc = MqttClient_RespList_Add(client,
+                    (MqttPacketType)SN_MSG_TYPE_GWINFO, 0,
+                    &search->pendResp, &search->gwInfo);
+            wm_SemUnlock(&client->lockClient);
+        }
+        if (rc != 0) {
+            wm_SemUnlock(&client->lockSend);
+            return rc; /* Error locking client */
+        }
+    #endif
+
+        /* Send search for gateway packet */
+        rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
+        if (rc != client->write.len) {
+        #ifdef WOLFMQTT_MULTITHREAD
+            wm_SemUnlock(&client->lockSend);
+            if (wm_SemLock(&client->lockClient) == 0) {
+                MqttClient_RespList_Remove(client, &search->pendResp);
+                wm_SemUnlock(&client->lockClient);
+            }
+        #endif
+            return rc;
+        }
+    #ifdef WOLFMQTT_MULTITHREAD
+        wm_SemUnlock(&client->lockSend);
+    #endif
+
+        search->stat.write = MQTT_MSG_WAIT;
+    }
+
+    /* Wait for gateway info packet */
+    rc = SN_Client_WaitType(client, &search->gwInfo, SN_MSG_TYPE_GWINFO, 0,
+        client->cmd_timeout_ms);
+#ifdef WOLFMQTT_NONBLOCK
+    if (rc == MQTT_CODE_CONTINUE)
+        return rc;
+#endif
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&client->lockClient) == 0) {
+        MqttClient_RespList_Remove(client, &search->pendResp);
+        wm_SemUnlock(&client->lockClient);
+    }
+#endif
+
+    /* reset state */
+    search->stat.write = MQTT_MSG_BEGIN;
+
+    return rc;
+}
+
+static int SN_WillTopic(MqttClient *client, SN_Will *will)
+{
+    int rc;
+
+    /* Validate required arguments */
+    if (client == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+#ifdef WOLFMQTT_MULTITHREAD
+    rc = wm_SemLock(&client->lockClient);
+    if (rc == 0) {
+        /* inform other threads of expected response */
+        rc = MqttClient_RespList_Add(client,
+                (MqttPacketType)SN_MSG_TYPE_WILLTOPICREQ, 0,
+                &will->pendResp, &will->resp.topicResp);
+        wm_SemUnlock(&client->lockClient);
+    }
+    if (rc != 0) {
+        return rc; /* Error locking client */
+    }
+#endif
+
+    /* Wait for Will Topic Request packet */
+    rc = SN_Client_WaitType(client, will,
+            SN_MSG_TYPE_WILLTOPICREQ, 0, client->cmd_timeout_ms);
+#ifdef WOLFMQTT_NONBLOCK
+    if (rc == MQTT_CODE_CONTINUE)
+        return rc;
+#endif
+
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&client->lockClient) == 0) {
+        MqttClient_RespList_Remove(client, &will->pendResp);
+        wm_SemUnlock(&client->lockClient);
+    }
+#endif
+    if (rc == 0) {
+    #ifdef WOLFMQTT_MULTITHREAD
+        /* Lock send socket mutex */
+        rc = wm_SemLock(&client->lockSend);
+        if (rc != 0) {
+            return rc;
+        }
+    #endif
+
+        /* Encode Will Topic */
+        rc = SN_Encode_WillTopic(client->tx_buf, client->tx_buf_len,
+                will);
+    #ifdef WOLFMQTT_DEBUG_CLIENT
+        PRINTF("EncodePacket: Len %d, Type %s (%d)",
+            rc, SN_Packet_TypeDesc(SN_MSG_TYPE_WILLTOPIC),
+            SN_MSG_TYPE_WILLTOPIC);
+    #endif
+        if (rc > 0) {
+            /* Send Will Topic packet */
+            client->write.len = rc;
+            rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
+            if (rc == client->write.len) {
+                rc = 0;
+            }
+        }
+    #ifdef WOLFMQTT_MULTITHREAD
+        wm_SemUnlock(&client->lockSend);
+    #endif
+    }
+
+    return rc;
+}
+
+static int SN_WillMessage(MqttClient *client, SN_Will *will)
+{
+    int rc;
+
+    /* Validate required arguments */
+    if (client == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+#ifdef WOLFMQTT_MULTITHREAD
+    rc = wm_SemLock(&client->lockClient);
+    if (rc == 0) {
+        /* inform other threads of expected response */
+        rc = MqttClient_RespList_Add(client,
+                (MqttPacketType)SN_MSG_TYPE_WILLMSGREQ, 0,
+                &will->pendResp, &will->resp.msgResp);
+        wm_SemUnlock(&client->lockClient);
+    }
+    if (rc != 0) {
+        return rc; /* Error locking client */
+    }
+#endif
+
+    /* Wait for Will Message Request */
     rc = SN_Client_WaitType(client, &will->resp.msgResp,
             SN_MSG_TYPE_WILLMSGREQ, 0, client->cmd_timeout_ms);
 
@@ -1074,6 +1762,13 @@ int SN_Client_Connect(MqttClient *client, SN_Connect *mc_connect)
         return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
     }
 
+#ifdef WOLFMQTT_SN_REGISTRY
+    if (mc_connect->stat.write == MQTT_MSG_PAYLOAD) {
+        /* Connected, registering the topics */
+        return SN_Client_ConnectRegister(client, mc_connect);
+    }
+#endif
+
     if (mc_connect->stat.write == MQTT_MSG_BEGIN) {
 
         will_done = 0;
@@ -1127,6 +1822,9 @@ int SN_Client_Connect(MqttClient *client, SN_Connect *mc_connect)
     #ifdef WOLFMQTT_MULTITHREAD
         wm_SemUnlock(&client->lockSend);
     #endif
+    #ifdef WOLFMQTT_SN_RETRY
+        SN_Client_RetryStart(client, mc_connect);
+    #endif
 
         mc_connect->stat.write = MQTT_MSG_WAIT;
     }
@@ -1146,9 +1844,11 @@ int SN_Client_Connect(MqttClient *client, SN_Connect *mc_connect)
         will_done = 1;
     }
 
-    /* Wait for connect ack packet */
-    rc = SN_Client_WaitType(client, &mc_connect->ack,
-            SN_MSG_TYPE_CONNACK, 0, client->cmd_timeout_ms);
+    /* Wait for connect ack packet. With a will the CONNECT is not sent
+       again, as the gateway may be in the will handshake. */
+    rc = SN_Client_WaitResp(client, SN_MSG_TYPE_CONNECT,
+            mc_connect->enable_lwt ? NULL : mc_connect, &mc_connect->ack,
+            SN_MSG_TYPE_CONNACK, 0);
 #ifdef WOLFMQTT_NONBLOCK
     if (rc == MQTT_CODE_CONTINUE)
         return rc;
@@ -1161,6 +1861,13 @@ int SN_Client_Connect(MqttClient *client, SN_Connect *mc_connect)
     }
 #endif
 
+#ifdef WOLFMQTT_SN_REGISTRY
+    if (rc == MQTT_CODE_SUCCESS && client->sn_reg != NULL &&
+            mc_connect->ack.return_code == SN_RC_ACCEPTED) {
+        return SN_Client_ConnectRegister(client, mc_connect);
+    }
+#endif
+
     /* reset state */
     mc_connect->stat.write = MQTT_MSG_BEGIN;
 
@@ -1405,13 +2112,16 @@ int SN_Client_Subscribe(MqttClient *client, SN_Subscribe *subscribe)
     #ifdef WOLFMQTT_MULTITHREAD
         wm_SemUnlock(&client->lockSend);
     #endif
+    #ifdef WOLFMQTT_SN_RETRY
+        SN_Client_RetryStart(client, subscribe);
+    #endif
 
         subscribe->stat.write = MQTT_MSG_WAIT;
     }
 
     /* Wait for subscribe ack packet */
-    rc = SN_Client_WaitType(client, &subscribe->subAck,
-            SN_MSG_TYPE_SUBACK, subscribe->packet_id, client->cmd_timeout_ms);
+    rc = SN_Client_WaitResp(client, SN_MSG_TYPE_SUBSCRIBE, subscribe,
+            &subscribe->subAck, SN_MSG_TYPE_SUBACK, subscribe->packet_id);
 
 #ifdef WOLFMQTT_NONBLOCK
     if (rc == MQTT_CODE_CONTINUE)
@@ -1424,6 +2134,20 @@ int SN_Client_Subscribe(MqttClient *client, SN_Subscribe *subscribe)
     }
 #endif
 
+#ifdef WOLFMQTT_SN_REGISTRY
+    /* Record the topic ID of a topic name without wildcards */
+    if (rc == MQTT_CODE_SUCCESS && client->sn_reg != NULL &&
+            subscribe->topic_type == SN_TOPIC_ID_TYPE_NORMAL &&
+            subscribe->subAck.return_code == SN_RC_ACCEPTED &&
+            subscribe->subAck.topicId != 0 &&
+            XSTRCHR(subscribe->topicNameId, '+') == NULL &&
+            XSTRCHR(subscribe->topicNameId, '#') == NULL) {
+        (void)SN_TopicRegistry_Set(client->sn_reg, subscribe->topicNameId,
+                (word16)XSTRLEN(subscribe->topicNameId),
+                subscribe->subAck.topicId, SN_TOPIC_ID_TYPE_NORMAL);
+    }
+#endif
+
     /* reset state */
     subscribe->stat.write = MQTT_MSG_BEGIN;
 
@@ -1444,6 +2168,20 @@ int SN_Client_Publish(MqttClient *client, SN_Publish *publish)
     {
         case MQTT_MSG_BEGIN:
         {
+        #ifdef WOLFMQTT_SN_REGISTRY
+            byte topic_type = publish->topic_type;
+            const char *topic_name = publish->topic_name;
+            word16 topic = 0;
+
+            if (topic_type == SN_TOPIC_ID_TYPE_NAME) {
+                rc = SN_Client_PublishTopic(client, topic_name,
+                        &topic_type, &topic);
+                if (rc != MQTT_CODE_SUCCESS) {
+                    return rc;
+                }
+                topic_name = (const char*)&topic;
+            }
+        #endif
         #ifdef WOLFMQTT_MULTITHREAD
             /* Lock send socket mutex */
             rc = wm_SemLock(&client->lockSend);
@@ -1453,8 +2191,13 @@ int SN_Client_Publish(MqttClient *client, SN_Publish *publish)
         #endif
 
             /* Encode the publish packet */
-            rc = SN_Encode_Publish(client->tx_buf, client->tx_buf_len,
-                    publish);
+        #ifdef WOLFMQTT_SN_REGISTRY
+            rc = SN_Client_EncodePublish(client, publish, topic_type,
+                    topic_name);
+        #else
+            rc = SN_Client_EncodePublish(client, publish,
+                    publish->topic_type, publish->topic_name);
+        #endif
         #ifdef WOLFMQTT_DEBUG_CLIENT
             PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d), ID %d,"
                     " QoS %d",
@@ -1534,66 +2277,291 @@ int SN_Client_Publish(MqttClient *client, SN_Publish *publish)
                 (publish->qos == MQTT_QOS_3)) {
                 break;
             }
+        #ifdef WOLFMQTT_SN_RETRY
+            SN_Client_RetryStart(client, publish);
+        #endif
+
+            publish->stat.write = MQTT_MSG_WAIT;
+        }
+        FALL_THROUGH;
+
+        case MQTT_MSG_WAIT:
+        {
+            /* Handle QoS */
+            if ((publish->qos == MQTT_QOS_1) ||
+                (publish->qos == MQTT_QOS_2)) {
+
+                /* Determine packet type to wait for */
+                resp_type = (publish->qos == MQTT_QOS_1) ?
+                        SN_MSG_TYPE_PUBACK :
+                        SN_MSG_TYPE_PUBCOMP;
+
+                /* Wait for publish response packet */
+                rc = SN_Client_WaitResp(client, SN_MSG_TYPE_PUBLISH, publish,
+                    &publish->resp, resp_type, publish->packet_id);
+            #ifdef WOLFMQTT_NONBLOCK
+                if (rc == MQTT_CODE_CONTINUE)
+                    break;
+            #endif
+            #ifdef WOLFMQTT_MULTITHREAD
+                if (wm_SemLock(&client->lockClient) == 0) {
+                    MqttClient_RespList_Remove(client, &publish->pendResp);
+                    wm_SemUnlock(&client->lockClient);
+                }
+            #endif
+
+                publish->return_code = publish->resp.return_code;
+            }
+
+            break;
+        }
+
+        case MQTT_MSG_ACK:
+        case MQTT_MSG_AUTH:
+        default:
+        #ifdef WOLFMQTT_DEBUG_CLIENT
+            PRINTF("SN_Client_Publish: Invalid state %d!",
+                publish->stat.write);
+        #endif
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_STAT);
+            break;
+    } /* switch (publish->stat) */
+
+    /* reset state */
+#ifdef WOLFMQTT_NONBLOCK
+    if (rc != MQTT_CODE_CONTINUE)
+#endif
+    {
+        publish->stat.write = MQTT_MSG_BEGIN;
+    }
+    if (rc > 0) {
+        rc = MQTT_CODE_SUCCESS;
+    }
+
+    return rc;
+}
+
+#ifdef WOLFMQTT_SN_WINDOW
+/* Gives up all outstanding publishes */
+static void SN_Client_PubWindowFail(MqttClient *client, SN_PubWindow *win,
+    int rc)
+{
+    SN_Publish *publish;
+
+    while ((publish = SN_PubWindow_RemoveAny(win)) != NULL) {
+        SN_Client_PubWindowDone(client, win, publish, rc);
+    }
+}
+
+#ifdef WOLFMQTT_SN_RETRY
+/* Returns the time in milliseconds until the first retransmission timeout
+   of the outstanding publishes, at most cmd_timeout_ms */
+static int SN_Client_PubWindowNext(MqttClient *client, SN_PubWindow *win)
+{
+    SN_Retry *retry = client->sn_retry;
+    word32 now = SN_Retry_Now(retry), next = (word32)client->cmd_timeout_ms;
+    word16 i;
+
+    if (SN_PubWindow_Lock(win) == 0) {
+        for (i = 0; i < win->count; i++) {
+            MqttMsgStat *stat = &win->slots[i]->stat;
+            word32 elapsed = now - stat->sent_ms;
+            word32 rto = SN_Retry_Timeout(retry, stat->retries);
+            word32 left = (elapsed < rto) ? rto - elapsed : 0;
+            if (left < next) {
+                next = left;
+            }
+        }
+        SN_PubWindow_Unlock(win);
+    }
+    return (next > 0) ? (int)next : 1;
+}
+
+/* Sends the publishes whose retransmission timeout expired again, or gives
+   them up once their retries are used up */
+static int SN_Client_PubWindowExpire(MqttClient *client, SN_PubWindow *win)
+{
+    int rc = MQTT_CODE_SUCCESS;
+    SN_Retry *retry = client->sn_retry;
+
+#ifdef WOLFMQTT_MULTITHREAD
+    /* Keep acknowledgments, read under the lock, from completing a publish
+       while it is sent again */
+    rc = wm_SemLock(&client->lockRecv);
+    if (rc != 0) {
+        return rc;
+    }
+#endif
+
+    while (rc == MQTT_CODE_SUCCESS) {
+        SN_Publish *publish = NULL;
+        int resend = 0;
+        word32 now = SN_Retry_Now(retry);
+        word16 i;
+
+        if (SN_PubWindow_Lock(win) != 0) {
+            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+            break;
+        }
+        for (i = 0; i < win->count; i++) {
+            MqttMsgStat *stat = &win->slots[i]->stat;
+            if (now - stat->sent_ms >= SN_Retry_Timeout(retry, stat->retries)) {
+                publish = win->slots[i];
+                resend = SN_Retry_Expired(retry, stat->retries);
+                if (resend) {
+                    stat->retries++;
+                    stat->sent_ms = now;
+                }
+                else {
+                    SN_PubWindow_RemoveAt(win, i);
+                }
+                break;
+            }
+        }
+        SN_PubWindow_Unlock(win);
 
-            publish->stat.write = MQTT_MSG_WAIT;
+        if (publish == NULL) {
+            break; /* none expired */
         }
-        FALL_THROUGH;
+        if (resend) {
+            rc = SN_Client_Resend(client, SN_MSG_TYPE_PUBLISH, publish);
+        }
+        else {
+            SN_Client_PubWindowDone(client, win, publish,
+                MQTT_TRACE_ERROR(MQTT_CODE_ERROR_TIMEOUT));
+        }
+    }
 
-        case MQTT_MSG_WAIT:
-        {
-            /* Handle QoS */
-            if ((publish->qos == MQTT_QOS_1) ||
-                (publish->qos == MQTT_QOS_2)) {
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_SemUnlock(&client->lockRecv);
+#endif
+    return rc;
+}
+#endif /* WOLFMQTT_SN_RETRY */
 
-                /* Determine packet type to wait for */
-                resp_type = (publish->qos == MQTT_QOS_1) ?
-                        SN_MSG_TYPE_PUBACK :
-                        SN_MSG_TYPE_PUBCOMP;
+/* Handles one incoming packet, or the timeout of the outstanding
+   publishes */
+static int SN_Client_PubWindowWait(MqttClient *client, SN_PubWindow *win)
+{
+    int rc, timeout_ms = client->cmd_timeout_ms;
 
-                /* Wait for publish response packet */
-                rc = SN_Client_WaitType(client, &publish->resp,
-                    resp_type, publish->packet_id, client->cmd_timeout_ms);
-            #ifdef WOLFMQTT_NONBLOCK
-                if (rc == MQTT_CODE_CONTINUE)
-                    break;
-            #endif
-            #ifdef WOLFMQTT_MULTITHREAD
-                if (wm_SemLock(&client->lockClient) == 0) {
-                    MqttClient_RespList_Remove(client, &publish->pendResp);
-                    wm_SemUnlock(&client->lockClient);
-                }
-            #endif
+#ifdef WOLFMQTT_SN_RETRY
+    if (client->sn_retry != NULL) {
+        timeout_ms = SN_Client_PubWindowNext(client, win);
+    }
+#endif
 
-                publish->return_code = publish->resp.return_code;
+    rc = SN_Client_WaitType(client, &client->msgSN, SN_MSG_TYPE_ANY, 0,
+            timeout_ms);
+#ifdef WOLFMQTT_NONBLOCK
+    if (rc == MQTT_CODE_CONTINUE) {
+    #ifdef WOLFMQTT_SN_RETRY
+        if (client->sn_retry != NULL &&
+                ((MqttMsgStat*)&client->msgSN)->read == MQTT_MSG_BEGIN) {
+            rc = SN_Client_PubWindowExpire(client, win);
+            if (rc == MQTT_CODE_SUCCESS) {
+                rc = MQTT_CODE_CONTINUE;
             }
-
-            break;
         }
+    #endif
+        return rc;
+    }
+#endif
+    if (rc == MQTT_CODE_ERROR_TIMEOUT) {
+    #ifdef WOLFMQTT_SN_RETRY
+        if (client->sn_retry != NULL) {
+            return SN_Client_PubWindowExpire(client, win);
+        }
+    #endif
+        /* Nothing received within cmd_timeout_ms */
+        SN_Client_PubWindowFail(client, win, rc);
+    }
+    return rc;
+}
 
-        case MQTT_MSG_ACK:
-        case MQTT_MSG_AUTH:
-        default:
-        #ifdef WOLFMQTT_DEBUG_CLIENT
-            PRINTF("SN_Client_Publish: Invalid state %d!",
-                publish->stat.write);
-        #endif
-            rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_STAT);
-            break;
-    } /* switch (publish->stat) */
+int SN_Client_SetPubWindow(MqttClient *client, SN_PubWindow *win)
+{
+    int rc = MQTT_CODE_SUCCESS;
 
-    /* reset state */
-#ifdef WOLFMQTT_NONBLOCK
-    if (rc != MQTT_CODE_CONTINUE)
+    if (client == NULL)
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+
+#ifdef WOLFMQTT_MULTITHREAD
+    rc = wm_SemLock(&client->lockClient);
+    if (rc == 0) {
 #endif
-    {
-        publish->stat.write = MQTT_MSG_BEGIN;
+
+        client->sn_window = win;
+
+#ifdef WOLFMQTT_MULTITHREAD
+        wm_SemUnlock(&client->lockClient);
     }
-    if (rc > 0) {
-        rc = MQTT_CODE_SUCCESS;
+#endif
+
+    return rc;
+}
+
+int SN_Client_PublishAsync(MqttClient *client, SN_Publish *publish)
+{
+    int rc;
+    SN_PubWindow *win;
+
+    /* Validate required arguments */
+    if (client == NULL || publish == NULL || client->sn_window == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    win = client->sn_window;
+
+    /* Without an acknowledgment there is nothing to wait for */
+    if (publish->qos != MQTT_QOS_1 && publish->qos != MQTT_QOS_2) {
+        return SN_Client_Publish(client, publish);
+    }
+
+    /* Make room in the window */
+    while ((rc = SN_PubWindow_Add(win, publish)) ==
+            MQTT_CODE_ERROR_OUT_OF_BUFFER) {
+        rc = SN_Client_PubWindowWait(client, win);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+    }
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+
+#ifdef WOLFMQTT_SN_RETRY
+    /* Started before the send, a fast acknowledgment may complete it */
+    SN_Client_RetryStart(client, publish);
+#endif
+    rc = SN_Client_PublishWrite(client, publish);
+    if (rc != MQTT_CODE_SUCCESS) {
+        /* Not sent, the caller gets the error instead of the callback */
+        (void)SN_PubWindow_Remove(win, publish->packet_id);
+    }
+    else if (SN_PubWindow_Lock(win) == 0) {
+        win->stats.sent++;
+        SN_PubWindow_Unlock(win);
+    }
+    return rc;
+}
+
+int SN_Client_PublishFlush(MqttClient *client)
+{
+    int rc = MQTT_CODE_SUCCESS;
+    SN_PubWindow *win;
+
+    /* Validate required arguments */
+    if (client == NULL || client->sn_window == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
     }
+    win = client->sn_window;
 
+    while (rc == MQTT_CODE_SUCCESS && SN_PubWindow_Count(win) > 0) {
+        rc = SN_Client_PubWindowWait(client, win);
+    }
     return rc;
 }
+#endif /* WOLFMQTT_SN_WINDOW */
 
 int SN_Client_Unsubscribe(MqttClient *client, SN_Unsubscribe *unsubscribe)
 {
@@ -1693,66 +2661,15 @@ int SN_Client_Register(MqttClient *client, SN_Register *regist)
     }
 
     if (regist->stat.write == MQTT_MSG_BEGIN) {
-    #ifdef WOLFMQTT_MULTITHREAD
-        /* Lock send socket mutex */
-        rc = wm_SemLock(&client->lockSend);
-        if (rc != 0) {
-            return rc;
-        }
-    #endif
-
-        /* Encode the register packet */
-        rc = SN_Encode_Register(client->tx_buf, client->tx_buf_len, regist);
-    #ifdef WOLFMQTT_DEBUG_CLIENT
-        PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d)",
-            rc, SN_Packet_TypeDesc(SN_MSG_TYPE_REGISTER),
-            SN_MSG_TYPE_REGISTER);
-    #endif
-        if (rc <= 0) {
-        #ifdef WOLFMQTT_MULTITHREAD
-            wm_SemUnlock(&client->lockSend);
-        #endif
-            return rc;
-        }
-        client->write.len = rc;
-
-    #ifdef WOLFMQTT_MULTITHREAD
-        rc = wm_SemLock(&client->lockClient);
-        if (rc == 0) {
-            /* inform other threads of expected response */
-            rc = MqttClient_RespList_Add(client,
-                    (MqttPacketType)SN_MSG_TYPE_REGACK,
-                    regist->packet_id, &regist->pendResp, &regist->regack);
-            wm_SemUnlock(&client->lockClient);
-        }
-        if (rc != 0) {
-            wm_SemUnlock(&client->lockSend);
-            return rc; /* Error locking client */
-        }
-    #endif
-
-        /* Send register packet */
-        rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
-        if (rc != client->write.len) {
-        #ifdef WOLFMQTT_MULTITHREAD
-            wm_SemUnlock(&client->lockSend);
-            if (wm_SemLock(&client->lockClient) == 0) {
-                MqttClient_RespList_Remove(client, &regist->pendResp);
-                wm_SemUnlock(&client->lockClient);
-            }
-        #endif
+        rc = SN_Client_RegisterSend(client, regist);
+        if (rc != MQTT_CODE_SUCCESS) {
             return rc;
         }
-    #ifdef WOLFMQTT_MULTITHREAD
-        wm_SemUnlock(&client->lockSend);
-    #endif
-
-        regist->stat.write = MQTT_MSG_WAIT;
     }
 
     /* Wait for register acknowledge packet */
-    rc = SN_Client_WaitType(client, &regist->regack,
-            SN_MSG_TYPE_REGACK, regist->packet_id, client->cmd_timeout_ms);
+    rc = SN_Client_WaitResp(client, SN_MSG_TYPE_REGISTER, regist,
+            &regist->regack, SN_MSG_TYPE_REGACK, regist->packet_id);
 #ifdef WOLFMQTT_NONBLOCK
     if (rc == MQTT_CODE_CONTINUE)
         return rc;
@@ -1825,9 +2742,24 @@ int SN_Client_Ping(MqttClient *client, SN_PingReq *ping)
         }
     #endif
 
+    #ifdef WOLFMQTT_SN_SLEEP
+        if (ping->clientId != NULL &&
+                client->sn_state == SN_CLIENT_STATE_ASLEEP) {
+            /* Set before the write, the gateway sends the buffered
+               messages right away */
+            client->sn_state = SN_CLIENT_STATE_AWAKE;
+            client->sn_sleep_stats.wakeups++;
+        }
+    #endif
+
         /* Send ping req packet */
         rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
         if (rc != client->write.len) {
+        #ifdef WOLFMQTT_SN_SLEEP
+            if (client->sn_state == SN_CLIENT_STATE_AWAKE) {
+                client->sn_state = SN_CLIENT_STATE_ASLEEP;
+            }
+        #endif
         #ifdef WOLFMQTT_MULTITHREAD
             wm_SemUnlock(&client->lockSend);
             if (wm_SemLock(&client->lockClient) == 0) {
@@ -1872,89 +2804,126 @@ int SN_Client_Disconnect(MqttClient *client)
 int SN_Client_Disconnect_ex(MqttClient *client, SN_Disconnect *disconnect)
 {
     int rc;
+    int is_sleep;
 
     /* Validate required arguments */
     if (client == NULL) {
         return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
     }
+    is_sleep = (disconnect != NULL) && (disconnect->sleepTmr != 0);
 
-#ifdef WOLFMQTT_MULTITHREAD
-    /* Lock send socket mutex */
-    rc = wm_SemLock(&client->lockSend);
-    if (rc != 0) {
-        return rc;
-    }
-#endif
-
-    /* Encode the disconnect packet */
-    rc = SN_Encode_Disconnect(client->tx_buf, client->tx_buf_len, disconnect);
-#ifdef WOLFMQTT_DEBUG_CLIENT
-    PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d)",
-        rc, SN_Packet_TypeDesc(SN_MSG_TYPE_DISCONNECT),
-        SN_MSG_TYPE_DISCONNECT);
-#endif
-    if (rc <= 0) {
+    if (!is_sleep || disconnect->stat.write == MQTT_MSG_BEGIN) {
     #ifdef WOLFMQTT_MULTITHREAD
-        wm_SemUnlock(&client->lockSend);
+        /* Lock send socket mutex */
+        rc = wm_SemLock(&client->lockSend);
+        if (rc != 0) {
+            return rc;
+        }
     #endif
-        return rc;
-    }
-    client->write.len = rc;
 
-#ifdef WOLFMQTT_MULTITHREAD
-    if ((disconnect != NULL) && (disconnect->sleepTmr != 0)) {
-        rc = wm_SemLock(&client->lockClient);
-        if (rc == 0) {
-            /* inform other threads of expected response */
-            rc = MqttClient_RespList_Add(client,
-                    (MqttPacketType)SN_MSG_TYPE_DISCONNECT, 0,
-                    &disconnect->pendResp, NULL);
-            wm_SemUnlock(&client->lockClient);
-        }
-        if (rc != 0) {
+        /* Encode the disconnect packet */
+        rc = SN_Encode_Disconnect(client->tx_buf, client->tx_buf_len,
+                disconnect);
+    #ifdef WOLFMQTT_DEBUG_CLIENT
+        PRINTF("MqttClient_EncodePacket: Len %d, Type %s (%d)",
+            rc, SN_Packet_TypeDesc(SN_MSG_TYPE_DISCONNECT),
+            SN_MSG_TYPE_DISCONNECT);
+    #endif
+        if (rc <= 0) {
+        #ifdef WOLFMQTT_MULTITHREAD
             wm_SemUnlock(&client->lockSend);
-            return rc; /* Error locking client */
+        #endif
+            return rc;
         }
-    }
-#endif
+        client->write.len = rc;
 
-    /* Send disconnect packet */
-    rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
-    if (rc != client->write.len) {
     #ifdef WOLFMQTT_MULTITHREAD
-        wm_SemUnlock(&client->lockSend);
-        if (wm_SemLock(&client->lockClient) == 0) {
-            MqttClient_RespList_Remove(client, &disconnect->pendResp);
-            wm_SemUnlock(&client->lockClient);
+        if (is_sleep) {
+            rc = wm_SemLock(&client->lockClient);
+            if (rc == 0) {
+                /* inform other threads of expected response */
+                rc = MqttClient_RespList_Add(client,
+                        (MqttPacketType)SN_MSG_TYPE_DISCONNECT, 0,
+                        &disconnect->pendResp, NULL);
+                wm_SemUnlock(&client->lockClient);
+            }
+            if (rc != 0) {
+                wm_SemUnlock(&client->lockSend);
+                return rc; /* Error locking client */
+            }
         }
     #endif
-        return rc;
-    }
-#ifdef WOLFMQTT_MULTITHREAD
-    wm_SemUnlock(&client->lockSend);
-#endif
-
-    rc = MQTT_CODE_SUCCESS;
+    #ifdef WOLFMQTT_SN_SLEEP
+        /* The DISCONNECT of the gateway is then the ack */
+        client->sn_sleep_req = (byte)is_sleep;
+    #endif
 
-    /* If sleep was set, wait for response disconnect packet */
-    if ((disconnect != NULL) && (disconnect->sleepTmr != 0)) {
-        rc = SN_Client_WaitType(client, disconnect,
-                SN_MSG_TYPE_DISCONNECT, 0, client->cmd_timeout_ms);
-    #ifdef WOLFMQTT_NONBLOCK
-        if (rc == MQTT_CODE_CONTINUE)
+        /* Send disconnect packet */
+        rc = MqttPacket_Write(client, client->tx_buf, client->write.len);
+        if (rc != client->write.len) {
+        #ifdef WOLFMQTT_SN_SLEEP
+            client->sn_sleep_req = 0;
+        #endif
+        #ifdef WOLFMQTT_MULTITHREAD
+            wm_SemUnlock(&client->lockSend);
+            if (is_sleep && wm_SemLock(&client->lockClient) == 0) {
+                MqttClient_RespList_Remove(client, &disconnect->pendResp);
+                wm_SemUnlock(&client->lockClient);
+            }
+        #endif
             return rc;
-    #endif
-    #ifdef WOLFMQTT_MULTITHREAD
-        if (wm_SemLock(&client->lockClient) == 0) {
-            MqttClient_RespList_Remove(client, &disconnect->pendResp);
-            wm_SemUnlock(&client->lockClient);
         }
+    #ifdef WOLFMQTT_MULTITHREAD
+        wm_SemUnlock(&client->lockSend);
     #endif
+
+        if (!is_sleep) {
+        #ifdef WOLFMQTT_SN_SLEEP
+            client->sn_state = SN_CLIENT_STATE_DISCONNECTED;
+        #endif
+            return MQTT_CODE_SUCCESS;
+        }
+        disconnect->stat.write = MQTT_MSG_WAIT;
+    }
+
+    /* Sleep was set, wait for response disconnect packet */
+    rc = SN_Client_WaitType(client, disconnect,
+            SN_MSG_TYPE_DISCONNECT, 0, client->cmd_timeout_ms);
+#ifdef WOLFMQTT_NONBLOCK
+    if (rc == MQTT_CODE_CONTINUE)
+        return rc;
+#endif
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&client->lockClient) == 0) {
+        MqttClient_RespList_Remove(client, &disconnect->pendResp);
+        wm_SemUnlock(&client->lockClient);
+    }
+#endif
+#ifdef WOLFMQTT_SN_SLEEP
+    client->sn_sleep_req = 0;
+    if (rc == MQTT_CODE_SUCCESS) {
+        client->sn_state = SN_CLIENT_STATE_ASLEEP;
+        client->sn_sleep_sec = disconnect->sleepTmr;
+        client->sn_sleep_stats.sleeps++;
     }
+#endif
+
+    /* reset state */
+    disconnect->stat.write = MQTT_MSG_BEGIN;
 
     return rc;
 }
 
+#ifdef WOLFMQTT_SN_SLEEP
+int SN_Client_GetState(MqttClient *client)
+{
+    if (client == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    return client->sn_state;
+}
+#endif /* WOLFMQTT_SN_SLEEP */
+
 int SN_Client_WaitMessage_ex(MqttClient *client, SN_Object* packet_obj,
         int timeout_ms)
 {
@@ -0,0 +1,1080 @@
+/* mqtt_sn_gateway.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_sn_gateway.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_SN_GATEWAY: Enables the aggregating MQTT-SN gateway, which
+ *  terminates many MQTT-SN clients on one datagram socket and forwards
+ *  their publishes and subscriptions over a few upstream MQTT client
+ *  connections. Requires WOLFMQTT_SN_REGISTRY: the topic registry given to
+ *  the gateway holds the predefined topics and the topic IDs the gateway
+ *  assigns, the same for all the clients.
+ *
+ * SN_GATEWAY_ADDR_MAX_LEN: Largest client network address (default 28).
+ *
+ * SN_GATEWAY_MAX_SUBS: Most subscriptions of a client (default 8).
+ *
+ * SN_GATEWAY_MAX_UPSTREAM: Most upstream connections (default 4).
+ */
+
+#ifdef WOLFMQTT_SN_GATEWAY
+
+/* Filters no client of an upstream connection uses anymore, unsubscribed
+   after the gateway lock is released. A connect may end two sessions. */
+typedef struct _SN_GatewayUnsub {
+    char   *filter[SN_GATEWAY_MAX_SUBS * 2];
+    byte    up[SN_GATEWAY_MAX_SUBS * 2];
+    word16  packet_id[SN_GATEWAY_MAX_SUBS * 2];
+    int     count;
+} SN_GatewayUnsub;
+
+/* Private functions */
+
+static int SN_Gateway_Lock(SN_Gateway *gw)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&gw->lock) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#else
+    (void)gw;
+#endif
+    return MQTT_CODE_SUCCESS;
+}
+
+static void SN_Gateway_Unlock(SN_Gateway *gw)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemUnlock(&gw->lock);
+#else
+    (void)gw;
+#endif
+}
+
+/* FNV-1a */
+static word32 SN_Gateway_AddrHash(const SN_GatewayAddr *addr)
+{
+    word32 h = 2166136261UL;
+    word16 i;
+    for (i = 0; i < addr->len; i++) {
+        h ^= addr->addr[i];
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+static SN_GatewayClient* SN_Gateway_FindAddr(SN_Gateway *gw,
+    const SN_GatewayAddr *addr)
+{
+    word16 idx = gw->addr_buckets[SN_Gateway_AddrHash(addr) &
+        gw->bucket_mask];
+    while (idx != 0) {
+        SN_GatewayClient *c = &gw->clients[idx - 1];
+        if (c->addr.len == addr->len &&
+                XMEMCMP(c->addr.addr, addr->addr, addr->len) == 0) {
+            return c;
+        }
+        idx = c->addr_chain;
+    }
+    return NULL;
+}
+
+static void SN_Gateway_LinkAddr(SN_Gateway *gw, SN_GatewayClient *c)
+{
+    word32 b = SN_Gateway_AddrHash(&c->addr) & gw->bucket_mask;
+    c->addr_chain = gw->addr_buckets[b];
+    gw->addr_buckets[b] = (word16)(c - gw->clients + 1);
+}
+
+static void SN_Gateway_UnlinkAddr(SN_Gateway *gw, SN_GatewayClient *c)
+{
+    word16 idx = (word16)(c - gw->clients + 1);
+    word16 *link = &gw->addr_buckets[SN_Gateway_AddrHash(&c->addr) &
+        gw->bucket_mask];
+    while (*link != 0) {
+        if (*link == idx) {
+            *link = c->addr_chain;
+            break;
+        }
+        link = &gw->clients[*link - 1].addr_chain;
+    }
+    c->addr_chain = 0;
+}
+
+static int SN_Gateway_StrEq(const char *a, const char *b)
+{
+    word32 len = (word32)XSTRLEN(a);
+    return (len == (word32)XSTRLEN(b) && XMEMCMP(a, b, len) == 0);
+}
+
+/* Matches a topic name against a topic filter */
+static int SN_Gateway_TopicMatch(const char *filter, const char *topic,
+    word16 topic_len)
+{
+    word16 pos = 0;
+
+    /* Wildcards do not match topics starting with '$' */
+    if (topic_len > 0 && topic[0] == '$' &&
+            (filter[0] == '+' || filter[0] == '#')) {
+        return 0;
+    }
+    while (*filter != '\0') {
+        if (*filter == '#') {
+            return 1;
+        }
+        if (*filter == '+') {
+            while (pos < topic_len && topic[pos] != '/') {
+                pos++;
+            }
+            filter++;
+            continue;
+        }
+        if (pos >= topic_len || *filter != topic[pos]) {
+            /* "a/#" also matches "a" */
+            return (pos == topic_len && XSTRNCMP(filter, "/#", 3) == 0);
+        }
+        filter++;
+        pos++;
+    }
+    return (pos == topic_len);
+}
+
+static int SN_Gateway_IsWildcard(const char *filter)
+{
+    return (XSTRCHR(filter, '+') != NULL || XSTRCHR(filter, '#') != NULL);
+}
+
+/* Finds the topic ID of a topic name, assigning a normal topic ID when the
+   name has none. Returns 0 when the registry is full. */
+static word16 SN_Gateway_TopicId(SN_Gateway *gw, const char *name,
+    word16 name_len, byte *topic_type)
+{
+    word16 topic_id = 0;
+
+    if (SN_TopicRegistry_FindName(gw->reg, name, name_len, &topic_id,
+                topic_type) == MQTT_CODE_SUCCESS && topic_id != 0) {
+        return topic_id;
+    }
+    *topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+    if (gw->next_topic_id >= gw->reg->capacity) {
+        return 0;
+    }
+    topic_id = (word16)(gw->next_topic_id + 1);
+    if (SN_TopicRegistry_Set(gw->reg, name, name_len, topic_id,
+                SN_TOPIC_ID_TYPE_NORMAL) != MQTT_CODE_SUCCESS) {
+        return 0;
+    }
+    gw->next_topic_id = topic_id;
+    return topic_id;
+}
+
+static int SN_Gateway_Known(SN_GatewayClient *c, word16 topic_id)
+{
+    return (c->known[topic_id >> 3] >> (topic_id & 7)) & 1;
+}
+
+static void SN_Gateway_SetKnown(SN_GatewayClient *c, word16 topic_id)
+{
+    c->known[topic_id >> 3] |= (byte)(1 << (topic_id & 7));
+}
+
+static word16 SN_Gateway_NextPacketId(word16 *packet_id)
+{
+    if (++(*packet_id) == 0) {
+        *packet_id = 1;
+    }
+    return *packet_id;
+}
+
+static int SN_Gateway_Send(SN_Gateway *gw, const SN_GatewayAddr *to,
+    int len)
+{
+    if (len <= 0) {
+        return len;
+    }
+    len = gw->net->send(gw->net->context, gw->tx_buf, len, to);
+    return (len < 0) ? len : MQTT_CODE_SUCCESS;
+}
+
+/* Returns non-zero when another client on the same upstream connection is
+   subscribed to the filter */
+static int SN_Gateway_FilterShared(SN_Gateway *gw, SN_GatewayClient *self,
+    const char *filter)
+{
+    word16 i;
+    int s;
+
+    for (i = 0; i < gw->max_clients; i++) {
+        SN_GatewayClient *c = &gw->clients[i];
+        if (c == self || c->state == SN_GW_CLIENT_FREE ||
+                c->upstream != self->upstream) {
+            continue;
+        }
+        for (s = 0; s < SN_GATEWAY_MAX_SUBS; s++) {
+            if (c->subs[s].filter != NULL &&
+                    SN_Gateway_StrEq(c->subs[s].filter, filter)) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Removes a subscription, adding the filter to unsub when no other client
+   of the upstream connection uses it */
+static void SN_Gateway_SubRemove(SN_Gateway *gw, SN_GatewayClient *c,
+    SN_GatewaySub *sub, SN_GatewayUnsub *unsub)
+{
+    char *filter = sub->filter;
+
+    XMEMSET(sub, 0, sizeof(SN_GatewaySub));
+    if (filter == NULL) {
+        return;
+    }
+    if (SN_Gateway_FilterShared(gw, c, filter)) {
+        WOLFMQTT_FREE(filter);
+    }
+    else {
+        unsub->filter[unsub->count] = filter;
+        unsub->up[unsub->count] = c->upstream;
+        unsub->packet_id[unsub->count++] = SN_Gateway_NextPacketId(
+            &gw->upstream_packet_id[c->upstream]);
+    }
+}
+
+/* Unsubscribes the upstream connections, called without the gateway lock */
+static void SN_Gateway_UpstreamUnsub(SN_Gateway *gw, SN_GatewayUnsub *unsub)
+{
+    MqttUnsubscribe unsubscribe;
+    MqttTopic topic;
+    int i, rc;
+
+    for (i = 0; i < unsub->count; i++) {
+        byte up = unsub->up[i];
+
+        XMEMSET(&unsubscribe, 0, sizeof(unsubscribe));
+        XMEMSET(&topic, 0, sizeof(topic));
+        topic.topic_filter = unsub->filter[i];
+        unsubscribe.packet_id = unsub->packet_id[i];
+        unsubscribe.topic_count = 1;
+        unsubscribe.topics = &topic;
+        do {
+            rc = MqttClient_Unsubscribe(gw->upstream[up], &unsubscribe);
+        } while (rc == MQTT_CODE_CONTINUE);
+        WOLFMQTT_FREE(unsub->filter[i]);
+    }
+    unsub->count = 0;
+}
+
+/* Ends the session of a client */
+static void SN_Gateway_ClientFree(SN_Gateway *gw, SN_GatewayClient *c,
+    SN_GatewayUnsub *unsub)
+{
+    int s;
+
+    for (s = 0; s < SN_GATEWAY_MAX_SUBS; s++) {
+        SN_Gateway_SubRemove(gw, c, &c->subs[s], unsub);
+    }
+    if (c->state != SN_GW_CLIENT_FREE) {
+        SN_Gateway_UnlinkAddr(gw, c);
+        gw->count--;
+    }
+    XMEMSET(c->known, 0, gw->known_len);
+    c->state = SN_GW_CLIENT_FREE;
+    c->addr.len = 0;
+    c->client_id[0] = '\0';
+}
+
+/* Client disconnected or lost: ends a clean session, else keeps it */
+static void SN_Gateway_ClientDrop(SN_Gateway *gw, SN_GatewayClient *c,
+    SN_GatewayUnsub *unsub)
+{
+    if (c->clean_session) {
+        SN_Gateway_ClientFree(gw, c, unsub);
+    }
+    else {
+        c->state = SN_GW_CLIENT_LOST;
+    }
+}
+
+static int SN_Gateway_HandleConnect(SN_Gateway *gw, SN_GatewayClient *c,
+    const SN_GatewayAddr *from, int len, SN_GatewayUnsub *unsub)
+{
+    SN_Connect mc_connect;
+    byte return_code = SN_RC_ACCEPTED;
+    word16 i;
+    int rc;
+
+    XMEMSET(&mc_connect, 0, sizeof(mc_connect));
+    rc = SN_Decode_Connect(gw->rx_buf, len + 1, &mc_connect);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    if (mc_connect.enable_lwt) {
+        /* Will topic and message are not supported */
+        return_code = SN_RC_NOTSUPPORTED;
+    }
+    else {
+        if (c != NULL && !SN_Gateway_StrEq(c->client_id, mc_connect.client_id)) {
+            /* Another client now at the address */
+            SN_Gateway_ClientFree(gw, c, unsub);
+            c = NULL;
+        }
+        if (c == NULL) {
+            /* Resume the session of the client ID */
+            for (i = 0; i < gw->max_clients; i++) {
+                if (gw->clients[i].state != SN_GW_CLIENT_FREE &&
+                        SN_Gateway_StrEq(gw->clients[i].client_id,
+                            mc_connect.client_id)) {
+                    c = &gw->clients[i];
+                    break;
+                }
+            }
+        }
+        if (c != NULL) {
+            if (mc_connect.clean_session) {
+                SN_Gateway_ClientFree(gw, c, unsub);
+            }
+            else {
+                SN_Gateway_UnlinkAddr(gw, c);
+                gw->count--;
+            }
+        }
+        else {
+            for (i = 0; i < gw->max_clients; i++) {
+                if (gw->clients[i].state == SN_GW_CLIENT_FREE) {
+                    c = &gw->clients[i];
+                    c->upstream = (byte)(i % gw->upstream_count);
+                    break;
+                }
+            }
+        }
+
+        if (c == NULL) {
+            return_code = SN_RC_CONGESTION;
+        }
+        else {
+            c->addr = *from;
+            SN_Gateway_LinkAddr(gw, c);
+            gw->count++;
+            c->state = SN_GW_CLIENT_ACTIVE;
+            c->clean_session = mc_connect.clean_session;
+            c->keep_alive_sec = mc_connect.keep_alive_sec;
+            c->last_seen = gw->now;
+            XSTRNCPY(c->client_id, mc_connect.client_id,
+                sizeof(c->client_id) - 1);
+            c->client_id[sizeof(c->client_id) - 1] = '\0';
+        }
+    }
+
+    return SN_Gateway_Send(gw, from, SN_Encode_ConnectAck(gw->tx_buf,
+        (int)sizeof(gw->tx_buf), return_code));
+}
+
+static int SN_Gateway_HandleRegister(SN_Gateway *gw, SN_GatewayClient *c,
+    const SN_GatewayAddr *from, int len)
+{
+    SN_Register regist;
+    byte topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+    int rc;
+
+    XMEMSET(&regist, 0, sizeof(regist));
+    rc = SN_Decode_Register(gw->rx_buf, len + 1, &regist);
+    if (rc <= 0) {
+        return rc;
+    }
+    regist.regack.packet_id = regist.packet_id;
+    regist.regack.topicId = SN_Gateway_TopicId(gw, regist.topicName,
+        (word16)XSTRLEN(regist.topicName), &topic_type);
+    if (regist.regack.topicId == 0) {
+        regist.regack.return_code = SN_RC_CONGESTION;
+    }
+    else if (topic_type != SN_TOPIC_ID_TYPE_NORMAL) {
+        /* Predefined topics are published with their predefined ID */
+        regist.regack.topicId = 0;
+        regist.regack.return_code = SN_RC_INVTOPICNAME;
+    }
+    else {
+        regist.regack.return_code = SN_RC_ACCEPTED;
+        SN_Gateway_SetKnown(c, regist.regack.topicId);
+    }
+
+    return SN_Gateway_Send(gw, from, SN_Encode_RegAck(gw->tx_buf,
+        (int)sizeof(gw->tx_buf), &regist.regack));
+}
+
+/* Forwards a publish upstream, called with the gateway lock held. The lock
+   is released while publishing. */
+static int SN_Gateway_HandlePublish(SN_Gateway *gw, SN_GatewayClient *c,
+    const SN_GatewayAddr *from, int len)
+{
+    SN_Publish pub;
+    SN_PublishResp resp;
+    MqttPublish publish;
+    const char *name = NULL;
+    char short_name[3];
+    word16 topic_id;
+    byte up;
+    int rc;
+
+    XMEMSET(&pub, 0, sizeof(pub));
+    rc = SN_Decode_Publish(gw->rx_buf, len, &pub);
+    if (rc <= 0) {
+        return rc;
+    }
+    topic_id = (word16)(((byte)pub.topic_name[0] << 8) |
+        (byte)pub.topic_name[1]);
+
+    /* QoS -1 publishes need no connection, but a predefined or short
+       topic */
+    if (c == NULL || c->state != SN_GW_CLIENT_ACTIVE) {
+        if (pub.qos != MQTT_QOS_3 ||
+                pub.topic_type == SN_TOPIC_ID_TYPE_NORMAL) {
+            gw->stats.dropped++;
+            return MQTT_CODE_SUCCESS;
+        }
+        up = 0;
+    }
+    else {
+        up = c->upstream;
+    }
+
+    if (pub.topic_type == SN_TOPIC_ID_TYPE_SHORT) {
+        short_name[0] = pub.topic_name[0];
+        short_name[1] = pub.topic_name[1];
+        short_name[2] = '\0';
+        name = short_name;
+    }
+    else if (SN_TopicRegistry_FindId(gw->reg, topic_id, pub.topic_type,
+                &name, NULL) != MQTT_CODE_SUCCESS) {
+        name = NULL;
+    }
+
+    XMEMSET(&resp, 0, sizeof(resp));
+    resp.topicId = topic_id;
+    resp.packet_id = pub.packet_id;
+    if (name == NULL) {
+        resp.return_code = SN_RC_INVTOPICNAME;
+        gw->stats.dropped++;
+    }
+    else {
+        XMEMSET(&publish, 0, sizeof(publish));
+        publish.topic_name = name;
+        publish.qos = (pub.qos == MQTT_QOS_3) ? MQTT_QOS_0 : pub.qos;
+        publish.retain = pub.retain ? 1 : 0;
+        publish.buffer = pub.buffer;
+        publish.total_len = pub.total_len;
+        if (publish.qos != MQTT_QOS_0) {
+            publish.packet_id = SN_Gateway_NextPacketId(
+                &gw->upstream_packet_id[up]);
+        }
+
+        /* The upstream client may call back the gateway for a message
+           received while waiting for the publish response */
+        SN_Gateway_Unlock(gw);
+        do {
+            rc = MqttClient_Publish(gw->upstream[up], &publish);
+        } while (rc == MQTT_CODE_CONTINUE);
+        if (SN_Gateway_Lock(gw) != MQTT_CODE_SUCCESS) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+        }
+        if (rc == MQTT_CODE_SUCCESS) {
+            gw->stats.publish_up++;
+            resp.return_code = SN_RC_ACCEPTED;
+        }
+        else {
+            resp.return_code = SN_RC_CONGESTION;
+            gw->stats.dropped++;
+        }
+    }
+
+    if (pub.qos == MQTT_QOS_1 || (pub.qos == MQTT_QOS_2 && name == NULL)) {
+        rc = SN_Encode_PublishResp(gw->tx_buf, (int)sizeof(gw->tx_buf),
+            SN_MSG_TYPE_PUBACK, &resp);
+    }
+    else if (pub.qos == MQTT_QOS_2) {
+        rc = SN_Encode_PublishResp(gw->tx_buf, (int)sizeof(gw->tx_buf),
+            SN_MSG_TYPE_PUBREC, &resp);
+    }
+    else {
+        rc = 0;
+    }
+    return SN_Gateway_Send(gw, from, rc);
+}
+
+/* Subscribes a client, called with the gateway lock held. The lock is
+   released while subscribing upstream. */
+static int SN_Gateway_HandleSubscribe(SN_Gateway *gw, SN_GatewayClient *c,
+    const SN_GatewayAddr *from, int len)
+{
+    SN_Subscribe subscribe;
+    SN_SubAck ack;
+    SN_GatewaySub *sub = NULL;
+    const char *filter = NULL;
+    char short_name[3];
+    word16 predef_id = 0;
+    byte topic_type;
+    int rc, s, upstream = 0;
+
+    XMEMSET(&subscribe, 0, sizeof(subscribe));
+    rc = SN_Decode_Subscribe(gw->rx_buf, len + 1, &subscribe);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    XMEMSET(&ack, 0, sizeof(ack));
+    ack.packet_id = subscribe.packet_id;
+    if (subscribe.qos > MQTT_QOS_1) {
+        /* Delivered to clients at most with QoS 1 */
+        subscribe.qos = MQTT_QOS_1;
+    }
+    ack.flags = (byte)(subscribe.qos << SN_PACKET_FLAG_QOS_SHIFT);
+
+    if (subscribe.topic_type == SN_TOPIC_ID_TYPE_NORMAL) {
+        filter = subscribe.topicNameId;
+    }
+    else if (subscribe.topic_type == SN_TOPIC_ID_TYPE_SHORT) {
+        short_name[0] = subscribe.topicNameId[0];
+        short_name[1] = subscribe.topicNameId[1];
+        short_name[2] = '\0';
+        filter = short_name;
+    }
+    else if (subscribe.topic_type == SN_TOPIC_ID_TYPE_PREDEF) {
+        predef_id = (word16)(((byte)subscribe.topicNameId[0] << 8) |
+            (byte)subscribe.topicNameId[1]);
+        if (SN_TopicRegistry_FindId(gw->reg, predef_id,
+                    SN_TOPIC_ID_TYPE_PREDEF, &filter, NULL) !=
+                MQTT_CODE_SUCCESS) {
+            filter = NULL;
+        }
+        ack.topicId = predef_id;
+    }
+    if (filter == NULL) {
+        ack.return_code = SN_RC_INVTOPICNAME;
+    }
+    else {
+        /* Update a subscription to the same filter, else add one */
+        for (s = 0; s < SN_GATEWAY_MAX_SUBS; s++) {
+            if (c->subs[s].filter != NULL &&
+                    SN_Gateway_StrEq(c->subs[s].filter, filter)) {
+                sub = &c->subs[s];
+                break;
+            }
+        }
+        for (s = 0; sub == NULL && s < SN_GATEWAY_MAX_SUBS; s++) {
+            if (c->subs[s].filter == NULL) {
+                int filter_len = (int)XSTRLEN(filter);
+                sub = &c->subs[s];
+                sub->filter = (char*)WOLFMQTT_MALLOC(filter_len + 1);
+                if (sub->filter == NULL) {
+                    sub = NULL;
+                    break;
+                }
+                XMEMCPY(sub->filter, filter, filter_len + 1);
+                upstream = !SN_Gateway_FilterShared(gw, c, filter);
+            }
+        }
+        if (sub == NULL) {
+            ack.return_code = SN_RC_CONGESTION;
+        }
+        else {
+            sub->qos = subscribe.qos;
+            sub->topic_type = subscribe.topic_type;
+            sub->topic_id = predef_id;
+            ack.return_code = SN_RC_ACCEPTED;
+
+            /* A topic name gets its topic ID */
+            if (subscribe.topic_type == SN_TOPIC_ID_TYPE_NORMAL &&
+                    !SN_Gateway_IsWildcard(filter)) {
+                topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+                ack.topicId = SN_Gateway_TopicId(gw, filter,
+                    (word16)XSTRLEN(filter), &topic_type);
+                if (topic_type != SN_TOPIC_ID_TYPE_NORMAL) {
+                    /* Predefined, received with the predefined ID */
+                    sub->topic_type = SN_TOPIC_ID_TYPE_PREDEF;
+                    sub->topic_id = ack.topicId;
+                    ack.topicId = 0;
+                }
+                else if (ack.topicId != 0) {
+                    SN_Gateway_SetKnown(c, ack.topicId);
+                }
+            }
+        }
+    }
+
+    if (upstream) {
+        MqttSubscribe up_sub;
+        MqttTopic topic;
+        byte up = c->upstream;
+
+        XMEMSET(&up_sub, 0, sizeof(up_sub));
+        XMEMSET(&topic, 0, sizeof(topic));
+        topic.topic_filter = sub->filter;
+        topic.qos = MQTT_QOS_1;
+        up_sub.packet_id = SN_Gateway_NextPacketId(
+            &gw->upstream_packet_id[up]);
+        up_sub.topic_count = 1;
+        up_sub.topics = &topic;
+
+        SN_Gateway_Unlock(gw);
+        do {
+            rc = MqttClient_Subscribe(gw->upstream[up], &up_sub);
+        } while (rc == MQTT_CODE_CONTINUE);
+        if (SN_Gateway_Lock(gw) != MQTT_CODE_SUCCESS) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+        }
+        if (rc != MQTT_CODE_SUCCESS ||
+                topic.return_code == MQTT_SUBSCRIBE_ACK_CODE_FAILURE) {
+            /* Unless the client has gone while unlocked */
+            if (sub->filter != NULL) {
+                WOLFMQTT_FREE(sub->filter);
+                XMEMSET(sub, 0, sizeof(SN_GatewaySub));
+            }
+            ack.topicId = 0;
+            ack.return_code = SN_RC_CONGESTION;
+        }
+    }
+
+    return SN_Gateway_Send(gw, from, SN_Encode_SubscribeAck(gw->tx_buf,
+        (int)sizeof(gw->tx_buf), &ack));
+}
+
+static int SN_Gateway_HandleUnsubscribe(SN_Gateway *gw, SN_GatewayClient *c,
+    const SN_GatewayAddr *from, int len, SN_GatewayUnsub *unsub)
+{
+    SN_Unsubscribe unsubscribe;
+    const char *filter = NULL;
+    char short_name[3];
+    int rc, s;
+
+    XMEMSET(&unsubscribe, 0, sizeof(unsubscribe));
+    rc = SN_Decode_Unsubscribe(gw->rx_buf, len + 1, &unsubscribe);
+    if (rc <= 0) {
+        return rc;
+    }
+
+    if (unsubscribe.topic_type == SN_TOPIC_ID_TYPE_NORMAL) {
+        filter = unsubscribe.topicNameId;
+    }
+    else if (unsubscribe.topic_type == SN_TOPIC_ID_TYPE_SHORT) {
+        short_name[0] = unsubscribe.topicNameId[0];
+        short_name[1] = unsubscribe.topicNameId[1];
+        short_name[2] = '\0';
+        filter = short_name;
+    }
+    else {
+        word16 topic_id = (word16)(((byte)unsubscribe.topicNameId[0] << 8) |
+            (byte)unsubscribe.topicNameId[1]);
+        if (SN_TopicRegistry_FindId(gw->reg, topic_id,
+                    SN_TOPIC_ID_TYPE_PREDEF, &filter, NULL) !=
+                MQTT_CODE_SUCCESS) {
+            filter = NULL;
+        }
+    }
+    for (s = 0; filter != NULL && s < SN_GATEWAY_MAX_SUBS; s++) {
+        if (c->subs[s].filter != NULL &&
+                SN_Gateway_StrEq(c->subs[s].filter, filter)) {
+            SN_Gateway_SubRemove(gw, c, &c->subs[s], unsub);
+            break;
+        }
+    }
+
+    return SN_Gateway_Send(gw, from, SN_Encode_UnsubscribeAck(gw->tx_buf,
+        (int)sizeof(gw->tx_buf), unsubscribe.packet_id));
+}
+
+/* Sends a message from upstream to a subscribed client */
+static void SN_Gateway_Deliver(SN_Gateway *gw, SN_GatewayClient *c,
+    SN_GatewaySub *sub, MqttMessage *msg)
+{
+    SN_Publish pub;
+    word16 topic = 0, topic_id;
+    byte topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+    int rc;
+
+    XMEMSET(&pub, 0, sizeof(pub));
+    if (sub->topic_type == SN_TOPIC_ID_TYPE_PREDEF) {
+        topic_type = SN_TOPIC_ID_TYPE_PREDEF;
+        topic_id = sub->topic_id;
+    }
+    else if (msg->topic_name_len == 2) {
+        topic_type = SN_TOPIC_ID_TYPE_SHORT;
+        topic_id = 0;
+        XMEMCPY(&topic, msg->topic_name, 2);
+    }
+    else {
+        topic_id = SN_Gateway_TopicId(gw, msg->topic_name,
+            msg->topic_name_len, &topic_type);
+        if (topic_id == 0) {
+            gw->stats.dropped++;
+            return;
+        }
+    }
+
+    if (topic_type == SN_TOPIC_ID_TYPE_NORMAL &&
+            !SN_Gateway_Known(c, topic_id)) {
+        /* Tell the client the topic name of the ID first */
+        SN_Register regist;
+        const char *name = NULL;
+
+        XMEMSET(&regist, 0, sizeof(regist));
+        (void)SN_TopicRegistry_FindId(gw->reg, topic_id,
+            SN_TOPIC_ID_TYPE_NORMAL, &name, NULL);
+        regist.topicName = name;
+        regist.topicId = topic_id;
+        regist.packet_id = SN_Gateway_NextPacketId(&c->packet_id);
+        rc = (name != NULL) ? SN_Encode_Register(gw->tx_buf,
+            (int)sizeof(gw->tx_buf), &regist) : 0;
+        if (rc <= 0 ||
+                SN_Gateway_Send(gw, &c->addr, rc) != MQTT_CODE_SUCCESS) {
+            gw->stats.dropped++;
+            return;
+        }
+        SN_Gateway_SetKnown(c, topic_id);
+    }
+    if (topic_type == SN_TOPIC_ID_TYPE_PREDEF) {
+        ((byte*)&topic)[0] = (byte)(topic_id >> 8);
+        ((byte*)&topic)[1] = (byte)topic_id;
+    }
+    else if (topic_type == SN_TOPIC_ID_TYPE_NORMAL) {
+        topic = topic_id;
+    }
+
+    pub.topic_type = topic_type;
+    pub.topic_name = (const char*)&topic;
+    pub.qos = (msg->qos < (MqttQoS)sub->qos) ? msg->qos : (MqttQoS)sub->qos;
+    if (pub.qos != MQTT_QOS_0) {
+        pub.packet_id = SN_Gateway_NextPacketId(&c->packet_id);
+    }
+    pub.retain = msg->retain;
+    pub.buffer = msg->buffer;
+    pub.total_len = msg->total_len;
+    rc = SN_Encode_Publish(gw->tx_buf, (int)sizeof(gw->tx_buf), &pub);
+    if (rc > 0 && SN_Gateway_Send(gw, &c->addr, rc) == MQTT_CODE_SUCCESS) {
+        gw->stats.publish_down++;
+    }
+    else {
+        gw->stats.dropped++;
+    }
+}
+
+/* Message callback of the upstream clients */
+static int SN_Gateway_UpstreamMsg(MqttClient *client, MqttMessage *msg,
+    byte msg_new, byte msg_done)
+{
+    SN_Gateway *gw = (SN_Gateway*)client->ctx;
+    word16 i;
+    byte up;
+    int s;
+
+    if (!msg_new || !msg_done) {
+        /* Larger than the upstream read buffer, too large for MQTT-SN */
+        if (msg_new) {
+            gw->stats.dropped++;
+        }
+        return MQTT_CODE_SUCCESS;
+    }
+    for (up = 0; up < gw->upstream_count; up++) {
+        if (gw->upstream[up] == client) {
+            break;
+        }
+    }
+    if (SN_Gateway_Lock(gw) != MQTT_CODE_SUCCESS) {
+        return MQTT_CODE_SUCCESS;
+    }
+    for (i = 0; i < gw->max_clients; i++) {
+        SN_GatewayClient *c = &gw->clients[i];
+        if (c->state != SN_GW_CLIENT_ACTIVE || c->upstream != up) {
+            continue;
+        }
+        for (s = 0; s < SN_GATEWAY_MAX_SUBS; s++) {
+            if (c->subs[s].filter != NULL &&
+                    SN_Gateway_TopicMatch(c->subs[s].filter,
+                        msg->topic_name, msg->topic_name_len)) {
+                SN_Gateway_Deliver(gw, c, &c->subs[s], msg);
+                break;
+            }
+        }
+    }
+    SN_Gateway_Unlock(gw);
+
+    return MQTT_CODE_SUCCESS;
+}
+
+
+/* Public Functions */
+
+int SN_Gateway_Init(SN_Gateway *gw, SN_GatewayNet *net,
+    SN_TopicRegistry *reg, word16 max_clients, byte gw_id)
+{
+    word32 buckets = 16, i;
+
+    if (gw == NULL || net == NULL || net->recv == NULL || net->send == NULL ||
+            reg == NULL || reg->entries == NULL || max_clients == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Keep the address table at most half full */
+    while (buckets < (word32)max_clients * 2) {
+        buckets <<= 1;
+    }
+
+    XMEMSET(gw, 0, sizeof(SN_Gateway));
+    gw->net = net;
+    gw->reg = reg;
+    gw->gw_id = gw_id;
+    gw->max_clients = max_clients;
+    gw->bucket_mask = buckets - 1;
+    gw->known_len = ((word32)reg->capacity + 8) / 8;
+    gw->clients = (SN_GatewayClient*)WOLFMQTT_MALLOC(
+        sizeof(SN_GatewayClient) * max_clients);
+    gw->addr_buckets = (word16*)WOLFMQTT_MALLOC(sizeof(word16) * buckets);
+    gw->known = (byte*)WOLFMQTT_MALLOC(gw->known_len * max_clients);
+    if (gw->clients == NULL || gw->addr_buckets == NULL ||
+            gw->known == NULL) {
+        if (gw->clients) WOLFMQTT_FREE(gw->clients);
+        if (gw->addr_buckets) WOLFMQTT_FREE(gw->addr_buckets);
+        if (gw->known) WOLFMQTT_FREE(gw->known);
+        XMEMSET(gw, 0, sizeof(SN_Gateway));
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    XMEMSET(gw->clients, 0, sizeof(SN_GatewayClient) * max_clients);
+    XMEMSET(gw->addr_buckets, 0, sizeof(word16) * buckets);
+    XMEMSET(gw->known, 0, gw->known_len * max_clients);
+    for (i = 0; i < max_clients; i++) {
+        gw->clients[i].known = &gw->known[gw->known_len * i];
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemInit(&gw->lock) != 0) {
+        WOLFMQTT_FREE(gw->clients);
+        WOLFMQTT_FREE(gw->addr_buckets);
+        WOLFMQTT_FREE(gw->known);
+        XMEMSET(gw, 0, sizeof(SN_Gateway));
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+
+    return MQTT_CODE_SUCCESS;
+}
+
+int SN_Gateway_AddUpstream(SN_Gateway *gw, MqttClient *client)
+{
+    int rc;
+
+    if (gw == NULL || gw->clients == NULL || client == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = SN_Gateway_Lock(gw);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    if (gw->upstream_count >= SN_GATEWAY_MAX_UPSTREAM) {
+        rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    else {
+        client->msg_cb = SN_Gateway_UpstreamMsg;
+        client->ctx = gw;
+        gw->upstream[gw->upstream_count++] = client;
+    }
+    SN_Gateway_Unlock(gw);
+    return rc;
+}
+
+int SN_Gateway_Task(SN_Gateway *gw, int timeout_ms)
+{
+    int rc, len;
+    SN_GatewayAddr from;
+    SN_GatewayClient *c;
+    SN_MsgType type;
+    SN_GatewayUnsub unsub;
+
+    if (gw == NULL || gw->clients == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (gw->upstream_count == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_NETWORK);
+    }
+
+    /* One byte is kept to terminate the names in the packet */
+    XMEMSET(&from, 0, sizeof(from));
+    len = gw->net->recv(gw->net->context, gw->rx_buf,
+        (int)sizeof(gw->rx_buf) - 1, &from, timeout_ms);
+    if (len < 0) {
+        return len;
+    }
+    rc = SN_Decode_Header(gw->rx_buf, len, &type, NULL);
+    if (rc < 0) {
+        gw->stats.dropped++;
+        return MQTT_CODE_SUCCESS;
+    }
+
+    rc = SN_Gateway_Lock(gw);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    unsub.count = 0;
+    c = SN_Gateway_FindAddr(gw, &from);
+    if (c != NULL && c->state == SN_GW_CLIENT_ACTIVE) {
+        c->last_seen = gw->now;
+    }
+
+    switch ((int)type)
+    {
+        case SN_MSG_TYPE_SEARCHGW:
+            rc = SN_Gateway_Send(gw, &from, SN_Encode_GWInfo(gw->tx_buf,
+                (int)sizeof(gw->tx_buf), gw->gw_id));
+            break;
+        case SN_MSG_TYPE_CONNECT:
+            rc = SN_Gateway_HandleConnect(gw, c, &from, len, &unsub);
+            break;
+        case SN_MSG_TYPE_PUBLISH:
+            rc = SN_Gateway_HandlePublish(gw, c, &from, len);
+            break;
+        default:
+            if (c == NULL || c->state != SN_GW_CLIENT_ACTIVE) {
+                /* Not connected */
+                rc = SN_Gateway_Send(gw, &from, SN_Encode_Disconnect(
+                    gw->tx_buf, (int)sizeof(gw->tx_buf), NULL));
+                break;
+            }
+            switch ((int)type)
+            {
+                case SN_MSG_TYPE_REGISTER:
+                    rc = SN_Gateway_HandleRegister(gw, c, &from, len);
+                    break;
+                case SN_MSG_TYPE_SUBSCRIBE:
+                    rc = SN_Gateway_HandleSubscribe(gw, c, &from, len);
+                    break;
+                case SN_MSG_TYPE_UNSUBSCRIBE:
+                    rc = SN_Gateway_HandleUnsubscribe(gw, c, &from, len,
+                        &unsub);
+                    break;
+                case SN_MSG_TYPE_PUBREL:
+                {
+                    SN_PublishResp resp;
+                    XMEMSET(&resp, 0, sizeof(resp));
+                    rc = SN_Decode_PublishResp(gw->rx_buf, len,
+                        SN_MSG_TYPE_PUBREL, &resp);
+                    if (rc > 0) {
+                        rc = SN_Gateway_Send(gw, &from,
+                            SN_Encode_PublishResp(gw->tx_buf,
+                                (int)sizeof(gw->tx_buf), SN_MSG_TYPE_PUBCOMP,
+                                &resp));
+                    }
+                    break;
+                }
+                case SN_MSG_TYPE_PING_REQ:
+                    rc = SN_Gateway_Send(gw, &from, SN_Encode_Ping(
+                        gw->tx_buf, (int)sizeof(gw->tx_buf), NULL,
+                        SN_MSG_TYPE_PING_RESP));
+                    break;
+                case SN_MSG_TYPE_DISCONNECT:
+                    rc = SN_Gateway_Send(gw, &from, SN_Encode_Disconnect(
+                        gw->tx_buf, (int)sizeof(gw->tx_buf), NULL));
+                    SN_Gateway_ClientDrop(gw, c, &unsub);
+                    break;
+                case SN_MSG_TYPE_PUBACK:
+                case SN_MSG_TYPE_PUBCOMP:
+                case SN_MSG_TYPE_REGACK:
+                    /* Deliveries are not sent again */
+                    break;
+                default:
+                    gw->stats.dropped++;
+                    break;
+            }
+            break;
+    }
+    SN_Gateway_Unlock(gw);
+
+    /* Unsubscribe upstream from the filters no client uses anymore */
+    SN_Gateway_UpstreamUnsub(gw, &unsub);
+
+    if (rc == MQTT_CODE_ERROR_MALFORMED_DATA ||
+            rc == MQTT_CODE_ERROR_OUT_OF_BUFFER ||
+            rc == MQTT_CODE_ERROR_PACKET_TYPE) {
+        /* Bad packet from a client */
+        gw->stats.dropped++;
+        rc = MQTT_CODE_SUCCESS;
+    }
+    return rc;
+}
+
+void SN_Gateway_Tick(SN_Gateway *gw, word32 now_sec)
+{
+    word16 i;
+    SN_GatewayUnsub unsub;
+
+    if (gw == NULL || gw->clients == NULL) {
+        return;
+    }
+    unsub.count = 0;
+    for (i = 0; i < gw->max_clients; i++) {
+        SN_GatewayClient *c;
+
+        if (SN_Gateway_Lock(gw) != MQTT_CODE_SUCCESS) {
+            return;
+        }
+        gw->now = now_sec;
+        c = &gw->clients[i];
+        if (c->state == SN_GW_CLIENT_ACTIVE && c->keep_alive_sec > 0 &&
+                now_sec - c->last_seen >
+                    (word32)c->keep_alive_sec + c->keep_alive_sec / 2) {
+            SN_Gateway_ClientDrop(gw, c, &unsub);
+        }
+        SN_Gateway_Unlock(gw);
+
+        SN_Gateway_UpstreamUnsub(gw, &unsub);
+    }
+}
+
+void SN_Gateway_Free(SN_Gateway *gw)
+{
+    word16 i;
+    int s;
+
+    if (gw == NULL || gw->clients == NULL) {
+        return;
+    }
+    for (i = 0; i < gw->max_clients; i++) {
+        for (s = 0; s < SN_GATEWAY_MAX_SUBS; s++) {
+            if (gw->clients[i].subs[s].filter != NULL) {
+                WOLFMQTT_FREE(gw->clients[i].subs[s].filter);
+            }
+        }
+    }
+    WOLFMQTT_FREE(gw->clients);
+    WOLFMQTT_FREE(gw->addr_buckets);
+    WOLFMQTT_FREE(gw->known);
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemFree(&gw->lock);
+#endif
+    XMEMSET(gw, 0, sizeof(SN_Gateway));
+}
+
+#endif /* WOLFMQTT_SN_GATEWAY */
@@ -806,7 +806,7 @@ int SN_Decode_Register(byte *rx_buf, int rx_buf_len, SN_Register *regist)
         regist->topicName = (char*)rx_payload;
 
         /* Terminate the string */
-        rx_payload[total_len-6] = '\0';
+        rx_buf[total_len] = '\0';
     }
     (void)rx_payload;
 
@@ -848,7 +848,7 @@ int SN_Encode_RegAck(byte *tx_buf, int tx_buf_len, SN_RegAck *regack)
     tx_payload += MqttEncode_Num(tx_payload, regack->packet_id);
 
     /* Encode Return Code */
-    *tx_payload += regack->return_code;
+    *tx_payload++ = regack->return_code;
 
     (void)tx_payload;
 
@@ -1126,7 +1126,7 @@ int SN_Decode_Publish(byte *rx_buf, int rx_buf_len, SN_Publish *publish)
 
     /* Decode payload */
 
-    publish->total_len = total_len - 7;
+    publish->total_len = total_len - (word32)(rx_payload - rx_buf);
     publish->buffer = rx_payload;
     publish->buffer_pos = 0;
     publish->buffer_len = publish->total_len;
@@ -1563,4 +1563,235 @@ int SN_Packet_Read(MqttClient *client, byte* rx_buf, int rx_buf_len,
     return remain_read;
 }
 
+#ifdef WOLFMQTT_SN_GATEWAY
+/* Gateway side of the protocol */
+
+int SN_Encode_GWInfo(byte *tx_buf, int tx_buf_len, byte gw_id)
+{
+    int total_len = 3; /* Length, MsgType and GwId */
+    byte *tx_payload = tx_buf;
+
+    /* Validate required arguments */
+    if (tx_buf == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (total_len > tx_buf_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    *tx_payload++ = (byte)total_len;
+    *tx_payload++ = SN_MSG_TYPE_GWINFO;
+    *tx_payload++ = gw_id;
+    (void)tx_payload;
+
+    /* Return total length of packet */
+    return total_len;
+}
+
+int SN_Decode_Connect(byte *rx_buf, int rx_buf_len, SN_Connect *mc_connect)
+{
+    word16 total_len;
+    int id_len;
+    byte *rx_payload = rx_buf, type, flags;
+
+    /* Validate required arguments */
+    if (rx_buf == NULL || rx_buf_len <= 0 || mc_connect == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Decode fixed header */
+    total_len = *rx_payload++;
+    if (total_len == SN_PACKET_LEN_IND) {
+        /* The length is stored in the next two bytes */
+        rx_payload += MqttDecode_Num(rx_payload, &total_len);
+    }
+    /* The client ID is terminated after the packet */
+    if (total_len >= rx_buf_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    type = *rx_payload++;
+    if (type != SN_MSG_TYPE_CONNECT) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_TYPE);
+    }
+    id_len = (int)total_len - (int)(rx_payload - rx_buf) - 4;
+    if (id_len < 1 || id_len > SN_CLIENTID_MAX_LEN) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+
+    /* Decode flags, protocol ID and duration */
+    flags = *rx_payload++;
+    mc_connect->clean_session =
+        (flags & SN_PACKET_FLAG_CLEANSESSION) ? 1 : 0;
+    mc_connect->enable_lwt = (flags & SN_PACKET_FLAG_WILL) ? 1 : 0;
+    mc_connect->protocol_level = *rx_payload++;
+    rx_payload += MqttDecode_Num(rx_payload, &mc_connect->keep_alive_sec);
+
+    /* Decode client ID */
+    mc_connect->client_id = (char*)rx_payload;
+    rx_payload[id_len] = '\0';
+
+    /* Return total length of packet */
+    return total_len;
+}
+
+int SN_Encode_ConnectAck(byte *tx_buf, int tx_buf_len, byte return_code)
+{
+    int total_len = 3; /* Length, MsgType and ReturnCode */
+    byte *tx_payload = tx_buf;
+
+    /* Validate required arguments */
+    if (tx_buf == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (total_len > tx_buf_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    *tx_payload++ = (byte)total_len;
+    *tx_payload++ = SN_MSG_TYPE_CONNACK;
+    *tx_payload++ = return_code;
+    (void)tx_payload;
+
+    /* Return total length of packet */
+    return total_len;
+}
+
+/* Decodes a subscribe or unsubscribe, which have the same format. A topic
+   name is terminated after the packet. */
+static int SN_Decode_SubscribeTopic(byte *rx_buf, int rx_buf_len, byte type,
+    byte *flags, word16 *packet_id, const char **topicNameId)
+{
+    word16 total_len;
+    int topic_len;
+    byte *rx_payload = rx_buf;
+
+    /* Validate required arguments */
+    if (rx_buf == NULL || rx_buf_len <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Decode fixed header */
+    total_len = *rx_payload++;
+    if (total_len == SN_PACKET_LEN_IND) {
+        /* The length is stored in the next two bytes */
+        rx_payload += MqttDecode_Num(rx_payload, &total_len);
+    }
+    if (total_len >= rx_buf_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    if (*rx_payload++ != type) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_TYPE);
+    }
+    topic_len = (int)total_len - (int)(rx_payload - rx_buf) - 3;
+
+    *flags = *rx_payload++;
+    rx_payload += MqttDecode_Num(rx_payload, packet_id);
+
+    /* Topic name, or topic ID or short name (2) */
+    if ((*flags & SN_PACKET_FLAG_TOPICIDTYPE_MASK) ==
+            SN_TOPIC_ID_TYPE_NORMAL) {
+        if (topic_len < 1) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+        }
+        rx_payload[topic_len] = '\0';
+    }
+    else if (topic_len != 2) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    *topicNameId = (const char*)rx_payload;
+
+    /* Return total length of packet */
+    return total_len;
+}
+
+int SN_Decode_Subscribe(byte *rx_buf, int rx_buf_len,
+        SN_Subscribe *subscribe)
+{
+    int rc;
+    byte flags = 0;
+
+    if (subscribe == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = SN_Decode_SubscribeTopic(rx_buf, rx_buf_len, SN_MSG_TYPE_SUBSCRIBE,
+            &flags, &subscribe->packet_id, &subscribe->topicNameId);
+    if (rc > 0) {
+        subscribe->duplicate = (flags & SN_PACKET_FLAG_DUPLICATE) ? 1 : 0;
+        subscribe->qos = (byte)((flags & SN_PACKET_FLAG_QOS_MASK) >>
+                SN_PACKET_FLAG_QOS_SHIFT);
+        subscribe->topic_type = flags & SN_PACKET_FLAG_TOPICIDTYPE_MASK;
+    }
+    return rc;
+}
+
+int SN_Encode_SubscribeAck(byte *tx_buf, int tx_buf_len,
+        SN_SubAck *subscribe_ack)
+{
+    int total_len = 8; /* Length, MsgType, Flags, TopicId (2), MsgId (2)
+                          and ReturnCode */
+    byte *tx_payload = tx_buf;
+
+    /* Validate required arguments */
+    if (tx_buf == NULL || subscribe_ack == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (total_len > tx_buf_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    *tx_payload++ = (byte)total_len;
+    *tx_payload++ = SN_MSG_TYPE_SUBACK;
+    *tx_payload++ = subscribe_ack->flags;
+    tx_payload += MqttEncode_Num(tx_payload, subscribe_ack->topicId);
+    tx_payload += MqttEncode_Num(tx_payload, subscribe_ack->packet_id);
+    *tx_payload++ = subscribe_ack->return_code;
+    (void)tx_payload;
+
+    /* Return total length of packet */
+    return total_len;
+}
+
+int SN_Decode_Unsubscribe(byte *rx_buf, int rx_buf_len,
+        SN_Unsubscribe *unsubscribe)
+{
+    int rc;
+    byte flags = 0;
+
+    if (unsubscribe == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = SN_Decode_SubscribeTopic(rx_buf, rx_buf_len,
+            SN_MSG_TYPE_UNSUBSCRIBE, &flags, &unsubscribe->packet_id,
+            &unsubscribe->topicNameId);
+    if (rc > 0) {
+        unsubscribe->topic_type = flags & SN_PACKET_FLAG_TOPICIDTYPE_MASK;
+    }
+    return rc;
+}
+
+int SN_Encode_UnsubscribeAck(byte *tx_buf, int tx_buf_len, word16 packet_id)
+{
+    int total_len = 4; /* Length, MsgType and MsgId (2) */
+    byte *tx_payload = tx_buf;
+
+    /* Validate required arguments */
+    if (tx_buf == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (total_len > tx_buf_len) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_OUT_OF_BUFFER);
+    }
+
+    *tx_payload++ = (byte)total_len;
+    *tx_payload++ = SN_MSG_TYPE_UNSUBACK;
+    tx_payload += MqttEncode_Num(tx_payload, packet_id);
+    (void)tx_payload;
+
+    /* Return total length of packet */
+    return total_len;
+}
+#endif /* WOLFMQTT_SN_GATEWAY */
+
 #endif /* WOLFMQTT_SN */
@@ -0,0 +1,550 @@
+/* mqtt_sn_registry.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_sn_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_SN_REGISTRY: Enables the MQTT-SN topic registry, which maps
+ *  topic names to topic IDs and back. With a registry set on a client
+ *  (SN_Client_SetRegistry) a publish can give the topic name
+ *  (SN_TOPIC_ID_TYPE_NAME): two character names are sent as short topics,
+ *  others with the registered or predefined ID, registering unknown names
+ *  with the gateway first. Topics added before connecting are registered
+ *  together after the CONNACK. Topic IDs from REGACK, SUBACK and gateway
+ *  REGISTER packets are recorded, and received publishes are given the
+ *  topic name before the message callback.
+ *
+ * SN_REGISTRY_WINDOW: Most REGISTER packets sent before waiting for a
+ *  REGACK (default 8).
+ */
+
+#ifdef WOLFMQTT_SN_REGISTRY
+
+/* Private functions */
+
+/* FNV-1a */
+static word32 SN_Registry_Hash(const char *name, word16 len)
+{
+    word32 hash = 2166136261UL;
+    word16 i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (byte)name[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static word32 SN_Registry_IdBucket(SN_TopicRegistry *reg, word16 topic_id,
+    byte topic_type)
+{
+    word32 key = ((word32)topic_type << 16) | topic_id;
+    return (key * 2654435761UL >> 8) & reg->bucket_mask;
+}
+
+/* Returns the index of the topic name, or 0 */
+static word16 SN_Registry_FindName(SN_TopicRegistry *reg, const char *name,
+    word16 name_len, word32 hash)
+{
+    word16 idx = reg->name_buckets[hash & reg->bucket_mask];
+
+    while (idx != 0) {
+        SN_TopicEntry* e = &reg->entries[idx - 1];
+        if (e->hash == hash && e->name_len == name_len &&
+                XMEMCMP(e->name, name, name_len) == 0) {
+            break;
+        }
+        idx = e->name_chain;
+    }
+    return idx;
+}
+
+/* Returns the index of the topic ID, or 0 */
+static word16 SN_Registry_FindId(SN_TopicRegistry *reg, word16 topic_id,
+    byte topic_type)
+{
+    word16 idx = reg->id_buckets[SN_Registry_IdBucket(reg, topic_id,
+        topic_type)];
+
+    while (idx != 0) {
+        SN_TopicEntry* e = &reg->entries[idx - 1];
+        if (e->topic_id == topic_id && e->topic_type == topic_type &&
+                e->state == SN_TOPIC_STATE_REGISTERED) {
+            break;
+        }
+        idx = e->id_chain;
+    }
+    return idx;
+}
+
+static void SN_Registry_UnlinkId(SN_TopicRegistry *reg, word16 idx)
+{
+    SN_TopicEntry* e = &reg->entries[idx - 1];
+    word16* link;
+
+    if (e->state != SN_TOPIC_STATE_REGISTERED) {
+        return; /* not in the ID table */
+    }
+    link = &reg->id_buckets[SN_Registry_IdBucket(reg, e->topic_id,
+        e->topic_type)];
+    while (*link != 0 && *link != idx) {
+        link = &reg->entries[*link - 1].id_chain;
+    }
+    if (*link == idx) {
+        *link = e->id_chain;
+    }
+    e->id_chain = 0;
+}
+
+/* Sets the ID of an entry and adds it to the ID table. An entry that had
+ * the same ID is no longer registered. */
+static void SN_Registry_SetId(SN_TopicRegistry *reg, word16 idx,
+    word16 topic_id, byte topic_type)
+{
+    SN_TopicEntry* e = &reg->entries[idx - 1];
+    word16 old;
+    word32 bucket;
+
+    SN_Registry_UnlinkId(reg, idx);
+    old = SN_Registry_FindId(reg, topic_id, topic_type);
+    if (old != 0 && old != idx) {
+        SN_Registry_UnlinkId(reg, old);
+        reg->entries[old - 1].state = SN_TOPIC_STATE_NEW;
+        reg->entries[old - 1].topic_id = 0;
+    }
+    e->topic_id = topic_id;
+    e->topic_type = topic_type;
+    e->state = SN_TOPIC_STATE_REGISTERED;
+    bucket = SN_Registry_IdBucket(reg, topic_id, topic_type);
+    e->id_chain = reg->id_buckets[bucket];
+    reg->id_buckets[bucket] = idx;
+}
+
+/* Adds a topic name as new. Returns the index, or 0 when full or out of
+ * memory. */
+static word16 SN_Registry_AddName(SN_TopicRegistry *reg, const char *name,
+    word16 name_len, word32 hash)
+{
+    word16 idx;
+    SN_TopicEntry* e;
+    char* copy;
+
+    if (reg->free_head != 0) {
+        idx = reg->free_head;
+    }
+    else if (reg->used < reg->capacity) {
+        idx = (word16)(reg->used + 1);
+    }
+    else {
+        return 0;
+    }
+    copy = (char*)WOLFMQTT_MALLOC(name_len + 1);
+    if (copy == NULL) {
+        return 0;
+    }
+    XMEMCPY(copy, name, name_len);
+    copy[name_len] = '\0';
+
+    e = &reg->entries[idx - 1];
+    if (idx == reg->free_head) {
+        reg->free_head = e->name_chain;
+    }
+    else {
+        reg->used++;
+    }
+    XMEMSET(e, 0, sizeof(SN_TopicEntry));
+    e->name = copy;
+    e->name_len = name_len;
+    e->hash = hash;
+    e->topic_type = SN_TOPIC_ID_TYPE_NORMAL;
+    e->name_chain = reg->name_buckets[hash & reg->bucket_mask];
+    reg->name_buckets[hash & reg->bucket_mask] = idx;
+    reg->count++;
+    return idx;
+}
+
+static int SN_Registry_Lock(SN_TopicRegistry *reg)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&reg->lock) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#else
+    (void)reg;
+#endif
+    return MQTT_CODE_SUCCESS;
+}
+
+static void SN_Registry_Unlock(SN_TopicRegistry *reg)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemUnlock(&reg->lock);
+#else
+    (void)reg;
+#endif
+}
+
+
+/* Public Functions */
+
+int SN_TopicRegistry_Init(SN_TopicRegistry *reg, word16 max_topics)
+{
+    word32 buckets = 16;
+
+    if (reg == NULL || max_topics == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    /* Keep the hash tables at most half full */
+    while (buckets < (word32)max_topics * 2) {
+        buckets <<= 1;
+    }
+
+    XMEMSET(reg, 0, sizeof(SN_TopicRegistry));
+    reg->entries = (SN_TopicEntry*)WOLFMQTT_MALLOC(
+        sizeof(SN_TopicEntry) * max_topics);
+    reg->name_buckets = (word16*)WOLFMQTT_MALLOC(sizeof(word16) * buckets);
+    reg->id_buckets = (word16*)WOLFMQTT_MALLOC(sizeof(word16) * buckets);
+    if (reg->entries == NULL || reg->name_buckets == NULL ||
+            reg->id_buckets == NULL) {
+        if (reg->entries) WOLFMQTT_FREE(reg->entries);
+        if (reg->name_buckets) WOLFMQTT_FREE(reg->name_buckets);
+        if (reg->id_buckets) WOLFMQTT_FREE(reg->id_buckets);
+        XMEMSET(reg, 0, sizeof(SN_TopicRegistry));
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    XMEMSET(reg->entries, 0, sizeof(SN_TopicEntry) * max_topics);
+    XMEMSET(reg->name_buckets, 0, sizeof(word16) * buckets);
+    XMEMSET(reg->id_buckets, 0, sizeof(word16) * buckets);
+    reg->bucket_mask = buckets - 1;
+    reg->capacity = max_topics;
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemInit(&reg->lock) != 0) {
+        WOLFMQTT_FREE(reg->entries);
+        WOLFMQTT_FREE(reg->name_buckets);
+        WOLFMQTT_FREE(reg->id_buckets);
+        XMEMSET(reg, 0, sizeof(SN_TopicRegistry));
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+    if (wm_SemInit(&reg->reg_lock) != 0) {
+        (void)wm_SemFree(&reg->lock);
+        WOLFMQTT_FREE(reg->entries);
+        WOLFMQTT_FREE(reg->name_buckets);
+        WOLFMQTT_FREE(reg->id_buckets);
+        XMEMSET(reg, 0, sizeof(SN_TopicRegistry));
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+
+    return MQTT_CODE_SUCCESS;
+}
+
+void SN_TopicRegistry_Free(SN_TopicRegistry *reg)
+{
+    word16 i;
+
+    if (reg == NULL || reg->entries == NULL) {
+        return;
+    }
+    for (i = 0; i < reg->used; i++) {
+        if (reg->entries[i].name != NULL) {
+            WOLFMQTT_FREE(reg->entries[i].name);
+        }
+    }
+    WOLFMQTT_FREE(reg->entries);
+    WOLFMQTT_FREE(reg->name_buckets);
+    WOLFMQTT_FREE(reg->id_buckets);
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemFree(&reg->lock);
+    (void)wm_SemFree(&reg->reg_lock);
+#endif
+    XMEMSET(reg, 0, sizeof(SN_TopicRegistry));
+}
+
+int SN_TopicRegistry_Add(SN_TopicRegistry *reg, const char *name,
+    word16 topic_id, byte topic_type)
+{
+    int rc;
+    word16 idx, name_len;
+    word32 hash;
+    size_t len;
+
+    if (reg == NULL || reg->entries == NULL || name == NULL ||
+            (topic_type != SN_TOPIC_ID_TYPE_NORMAL &&
+             topic_type != SN_TOPIC_ID_TYPE_PREDEF)) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    len = XSTRLEN(name);
+    if (len == 0 || len > 0xFFFF) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    name_len = (word16)len;
+    hash = SN_Registry_Hash(name, name_len);
+
+    rc = SN_Registry_Lock(reg);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    idx = SN_Registry_FindName(reg, name, name_len, hash);
+    if (idx == 0) {
+        idx = SN_Registry_AddName(reg, name, name_len, hash);
+    }
+    if (idx == 0) {
+        rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    else if (topic_type == SN_TOPIC_ID_TYPE_PREDEF) {
+        SN_Registry_SetId(reg, idx, topic_id, topic_type);
+    }
+    SN_Registry_Unlock(reg);
+    return rc;
+}
+
+int SN_TopicRegistry_Remove(SN_TopicRegistry *reg, const char *name)
+{
+    int rc;
+    word16 idx, name_len, *link;
+    word32 hash;
+    SN_TopicEntry* e;
+
+    if (reg == NULL || reg->entries == NULL || name == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    name_len = (word16)XSTRLEN(name);
+    hash = SN_Registry_Hash(name, name_len);
+
+    rc = SN_Registry_Lock(reg);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    idx = SN_Registry_FindName(reg, name, name_len, hash);
+    if (idx == 0) {
+        SN_Registry_Unlock(reg);
+        return MQTT_CODE_ERROR_NOT_FOUND;
+    }
+    e = &reg->entries[idx - 1];
+    SN_Registry_UnlinkId(reg, idx);
+    link = &reg->name_buckets[hash & reg->bucket_mask];
+    while (*link != idx) {
+        link = &reg->entries[*link - 1].name_chain;
+    }
+    *link = e->name_chain;
+    WOLFMQTT_FREE(e->name);
+    XMEMSET(e, 0, sizeof(SN_TopicEntry));
+    e->name_chain = reg->free_head;
+    reg->free_head = idx;
+    reg->count--;
+    SN_Registry_Unlock(reg);
+    return MQTT_CODE_SUCCESS;
+}
+
+int SN_TopicRegistry_FindName(SN_TopicRegistry *reg, const char *name,
+    word16 name_len, word16 *topic_id, byte *topic_type)
+{
+    int rc;
+    word16 idx;
+
+    if (reg == NULL || reg->entries == NULL || name == NULL ||
+            topic_id == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = SN_Registry_Lock(reg);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    idx = SN_Registry_FindName(reg, name, name_len,
+        SN_Registry_Hash(name, name_len));
+    if (idx == 0) {
+        rc = MQTT_CODE_ERROR_NOT_FOUND;
+    }
+    else {
+        SN_TopicEntry* e = &reg->entries[idx - 1];
+        *topic_id = (e->state == SN_TOPIC_STATE_REGISTERED) ?
+            e->topic_id : 0;
+        if (topic_type != NULL) {
+            *topic_type = e->topic_type;
+        }
+    }
+    SN_Registry_Unlock(reg);
+    return rc;
+}
+
+int SN_TopicRegistry_FindId(SN_TopicRegistry *reg, word16 topic_id,
+    byte topic_type, const char **name, word16 *name_len)
+{
+    int rc;
+    word16 idx;
+
+    if (reg == NULL || reg->entries == NULL || name == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    rc = SN_Registry_Lock(reg);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    idx = SN_Registry_FindId(reg, topic_id, topic_type);
+    if (idx == 0) {
+        rc = MQTT_CODE_ERROR_NOT_FOUND;
+    }
+    else {
+        *name = reg->entries[idx - 1].name;
+        if (name_len != NULL) {
+            *name_len = reg->entries[idx - 1].name_len;
+        }
+    }
+    SN_Registry_Unlock(reg);
+    return rc;
+}
+
+int SN_TopicRegistry_Set(SN_TopicRegistry *reg, const char *name,
+    word16 name_len, word16 topic_id, byte topic_type)
+{
+    int rc;
+    word16 idx;
+    word32 hash;
+
+    if (reg == NULL || reg->entries == NULL || name == NULL ||
+            name_len == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    hash = SN_Registry_Hash(name, name_len);
+
+    rc = SN_Registry_Lock(reg);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    idx = SN_Registry_FindName(reg, name, name_len, hash);
+    if (idx == 0) {
+        idx = SN_Registry_AddName(reg, name, name_len, hash);
+    }
+    if (idx == 0) {
+        rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    else {
+        SN_Registry_SetId(reg, idx, topic_id, topic_type);
+    }
+    SN_Registry_Unlock(reg);
+    return rc;
+}
+
+void SN_TopicRegistry_Reset(SN_TopicRegistry *reg, byte clean_session)
+{
+    word16 i;
+
+    if (reg == NULL || reg->entries == NULL ||
+            SN_Registry_Lock(reg) != MQTT_CODE_SUCCESS) {
+        return;
+    }
+    for (i = 1; i <= reg->used; i++) {
+        SN_TopicEntry* e = &reg->entries[i - 1];
+        if (e->name == NULL || e->topic_type != SN_TOPIC_ID_TYPE_NORMAL) {
+            continue;
+        }
+        if (e->state != SN_TOPIC_STATE_REGISTERED || clean_session) {
+            SN_Registry_UnlinkId(reg, i);
+            e->state = SN_TOPIC_STATE_NEW;
+            e->topic_id = 0;
+        }
+    }
+    XMEMSET(reg->reg_entry, 0, sizeof(reg->reg_entry));
+    SN_Registry_Unlock(reg);
+}
+
+word16 SN_TopicRegistry_NextNew(SN_TopicRegistry *reg, word16 pos)
+{
+    word16 i, idx = 0;
+
+    if (SN_Registry_Lock(reg) != MQTT_CODE_SUCCESS) {
+        return 0;
+    }
+    for (i = (pos > 0) ? pos : 1; i <= reg->used; i++) {
+        SN_TopicEntry* e = &reg->entries[i - 1];
+        if (e->name != NULL && e->state == SN_TOPIC_STATE_NEW &&
+                e->topic_type == SN_TOPIC_ID_TYPE_NORMAL) {
+            e->state = SN_TOPIC_STATE_PENDING;
+            idx = i;
+            break;
+        }
+    }
+    SN_Registry_Unlock(reg);
+    return idx;
+}
+
+void SN_TopicRegistry_Registered(SN_TopicRegistry *reg, word16 index,
+    word16 topic_id, byte state)
+{
+    SN_TopicEntry* e;
+
+    if (index == 0 || index > reg->used ||
+            SN_Registry_Lock(reg) != MQTT_CODE_SUCCESS) {
+        return;
+    }
+    e = &reg->entries[index - 1];
+    if (e->name != NULL && e->state == SN_TOPIC_STATE_PENDING) {
+        if (state == SN_TOPIC_STATE_REGISTERED) {
+            SN_Registry_SetId(reg, index, topic_id, SN_TOPIC_ID_TYPE_NORMAL);
+        }
+        else {
+            e->state = state;
+        }
+    }
+    SN_Registry_Unlock(reg);
+}
+
+int SN_TopicRegistry_Lookup(SN_TopicRegistry *reg, const char *name,
+    word16 name_len, word16 *topic_id, byte *topic_type)
+{
+    int rc;
+    word16 idx;
+    word32 hash;
+
+    if (name_len == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    hash = SN_Registry_Hash(name, name_len);
+
+    rc = SN_Registry_Lock(reg);
+    if (rc != MQTT_CODE_SUCCESS) {
+        return rc;
+    }
+    idx = SN_Registry_FindName(reg, name, name_len, hash);
+    if (idx == 0) {
+        idx = SN_Registry_AddName(reg, name, name_len, hash);
+    }
+    if (idx == 0) {
+        rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    else {
+        SN_TopicEntry* e = &reg->entries[idx - 1];
+        *topic_id = e->topic_id;
+        *topic_type = e->topic_type;
+        rc = e->state;
+    }
+    SN_Registry_Unlock(reg);
+    return rc;
+}
+
+#endif /* WOLFMQTT_SN_REGISTRY */
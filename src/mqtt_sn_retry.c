@@ -0,0 +1,191 @@
+/* mqtt_sn_retry.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_sn_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_SN_RETRY: Enables MQTT-SN retransmission. With a timer set on a
+ *  client (SN_Client_SetRetry) CONNECT (without a will), REGISTER,
+ *  SUBSCRIBE and QoS 1 and 2 PUBLISH packets not answered within the
+ *  retransmission timeout (Tretry) are sent again, up to max_retry times
+ *  (Nretry), with the DUP flag set on SUBSCRIBE and PUBLISH. The timeout
+ *  follows the smoothed round trip time and its variation as in TCP
+ *  (RFC 6298) and doubles with each retransmission of a request. Round
+ *  trips of retransmitted requests are not measured (Karn).
+ *
+ * SN_RETRY_RTO_INIT_MS: Timeout before the first measurement (default 1000).
+ * SN_RETRY_RTO_MIN_MS: Lowest timeout (default 100).
+ * SN_RETRY_RTO_MAX_MS: Highest timeout, also when backed off
+ *  (default 60000).
+ * SN_RETRY_MAX: Default most retransmissions of a request (default 5).
+ */
+
+#ifdef WOLFMQTT_SN_RETRY
+
+/* Private functions */
+
+static int SN_Retry_Lock(SN_Retry *retry)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    return wm_SemLock(&retry->lock);
+#else
+    (void)retry;
+    return 0;
+#endif
+}
+
+static void SN_Retry_Unlock(SN_Retry *retry)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemUnlock(&retry->lock);
+#else
+    (void)retry;
+#endif
+}
+
+static word32 SN_Retry_Clamp(SN_Retry *retry, word32 rto_ms)
+{
+    if (rto_ms < retry->rto_min_ms) {
+        rto_ms = retry->rto_min_ms;
+    }
+    if (rto_ms > retry->rto_max_ms) {
+        rto_ms = retry->rto_max_ms;
+    }
+    return rto_ms;
+}
+
+
+/* Public Functions */
+
+int SN_Retry_Init(SN_Retry *retry, SN_RetryTimeCb now_ms, void *ctx,
+    byte max_retry)
+{
+    if (retry == NULL || now_ms == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(retry, 0, sizeof(SN_Retry));
+    retry->now_ms = now_ms;
+    retry->ctx = ctx;
+    retry->rto_min_ms = SN_RETRY_RTO_MIN_MS;
+    retry->rto_max_ms = SN_RETRY_RTO_MAX_MS;
+    retry->rto_ms = SN_Retry_Clamp(retry, SN_RETRY_RTO_INIT_MS);
+    retry->max_retry = (max_retry != 0) ? max_retry : SN_RETRY_MAX;
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemInit(&retry->lock) != 0) {
+        XMEMSET(retry, 0, sizeof(SN_Retry));
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+
+    return MQTT_CODE_SUCCESS;
+}
+
+void SN_Retry_Free(SN_Retry *retry)
+{
+    if (retry == NULL || retry->now_ms == NULL) {
+        return;
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemFree(&retry->lock);
+#endif
+    XMEMSET(retry, 0, sizeof(SN_Retry));
+}
+
+word32 SN_Retry_Now(SN_Retry *retry)
+{
+    return retry->now_ms(retry->ctx);
+}
+
+word32 SN_Retry_Timeout(SN_Retry *retry, byte retries)
+{
+    word32 rto_ms = SN_RETRY_RTO_INIT_MS;
+
+    if (SN_Retry_Lock(retry) == 0) {
+        rto_ms = retry->rto_ms;
+        /* Back off exponentially */
+        while (retries-- > 0 && rto_ms < retry->rto_max_ms) {
+            rto_ms *= 2;
+        }
+        rto_ms = SN_Retry_Clamp(retry, rto_ms);
+        SN_Retry_Unlock(retry);
+    }
+    return rto_ms;
+}
+
+void SN_Retry_Sample(SN_Retry *retry, word32 rtt_ms)
+{
+    word32 var_ms;
+
+    if (SN_Retry_Lock(retry) != 0) {
+        return;
+    }
+
+    if (!retry->has_rtt) {
+        retry->srtt_ms = rtt_ms;
+        retry->rttvar_ms = rtt_ms / 2;
+        retry->has_rtt = 1;
+    }
+    else {
+        word32 delta = (retry->srtt_ms > rtt_ms) ?
+            retry->srtt_ms - rtt_ms : rtt_ms - retry->srtt_ms;
+        /* RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R */
+        retry->rttvar_ms = (3 * retry->rttvar_ms + delta) / 4;
+        retry->srtt_ms = (7 * retry->srtt_ms + rtt_ms) / 8;
+    }
+
+    /* RTO = SRTT + max(G, 4 RTTVAR), with a clock granularity of 1ms */
+    var_ms = 4 * retry->rttvar_ms;
+    if (var_ms < 1) {
+        var_ms = 1;
+    }
+    retry->rto_ms = SN_Retry_Clamp(retry, retry->srtt_ms + var_ms);
+    retry->stats.samples++;
+
+    SN_Retry_Unlock(retry);
+}
+
+int SN_Retry_Expired(SN_Retry *retry, byte retries)
+{
+    int resend = (retries < retry->max_retry);
+
+    if (SN_Retry_Lock(retry) != 0) {
+        return 0;
+    }
+
+    if (resend) {
+        retry->stats.retransmits++;
+    }
+    else {
+        retry->stats.failures++;
+    }
+
+    SN_Retry_Unlock(retry);
+    return resend;
+}
+
+#endif /* WOLFMQTT_SN_RETRY */
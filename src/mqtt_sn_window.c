@@ -0,0 +1,200 @@
+/* mqtt_sn_window.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_sn_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_SN_WINDOW: Enables the MQTT-SN publish window. With a window set
+ *  on a client (SN_Client_SetPubWindow) SN_Client_PublishAsync sends QoS 1
+ *  and 2 publishes without waiting for their PUBACK or PUBCOMP, up to the
+ *  size of the window, and a callback reports each completion. Packet IDs
+ *  of outstanding publishes are tracked and free ones given. With
+ *  WOLFMQTT_SN_RETRY the outstanding publishes are sent again as requests
+ *  are.
+ */
+
+#ifdef WOLFMQTT_SN_WINDOW
+
+/* Public Functions */
+
+int SN_PubWindow_Init(SN_PubWindow *win, SN_Publish **slots, word16 size,
+    SN_PubWindowCb cb, void *ctx)
+{
+    if (win == NULL || slots == NULL || size == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(win, 0, sizeof(SN_PubWindow));
+    XMEMSET(slots, 0, sizeof(SN_Publish*) * size);
+    win->slots = slots;
+    win->size = size;
+    win->cb = cb;
+    win->ctx = ctx;
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemInit(&win->lock) != 0) {
+        XMEMSET(win, 0, sizeof(SN_PubWindow));
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+
+    return MQTT_CODE_SUCCESS;
+}
+
+void SN_PubWindow_Free(SN_PubWindow *win)
+{
+    if (win == NULL || win->slots == NULL) {
+        return;
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemFree(&win->lock);
+#endif
+    XMEMSET(win, 0, sizeof(SN_PubWindow));
+}
+
+int SN_PubWindow_Count(SN_PubWindow *win)
+{
+    int count;
+
+    if (win == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (SN_PubWindow_Lock(win) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+    count = win->count;
+    SN_PubWindow_Unlock(win);
+    return count;
+}
+
+int SN_PubWindow_Lock(SN_PubWindow *win)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    return wm_SemLock(&win->lock);
+#else
+    (void)win;
+    return 0;
+#endif
+}
+
+void SN_PubWindow_Unlock(SN_PubWindow *win)
+{
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemUnlock(&win->lock);
+#else
+    (void)win;
+#endif
+}
+
+/* Returns the slot of the packet ID, or count when not outstanding */
+static word16 SN_PubWindow_Find(SN_PubWindow *win, word16 packet_id)
+{
+    word16 i;
+
+    for (i = 0; i < win->count; i++) {
+        if (win->slots[i]->packet_id == packet_id) {
+            break;
+        }
+    }
+    return i;
+}
+
+int SN_PubWindow_Add(SN_PubWindow *win, SN_Publish *publish)
+{
+    int rc = MQTT_CODE_SUCCESS;
+
+    if (SN_PubWindow_Lock(win) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+
+    if (win->count >= win->size) {
+        rc = MQTT_CODE_ERROR_OUT_OF_BUFFER;
+    }
+    else if (publish->packet_id == 0) {
+        /* Next ID not outstanding, there are at most size of them */
+        do {
+            if (++win->last_id == 0) {
+                win->last_id = 1;
+            }
+        } while (SN_PubWindow_Find(win, win->last_id) < win->count);
+        publish->packet_id = win->last_id;
+    }
+    else if (SN_PubWindow_Find(win, publish->packet_id) < win->count) {
+        rc = MQTT_TRACE_ERROR(MQTT_CODE_ERROR_PACKET_ID);
+    }
+
+    if (rc == MQTT_CODE_SUCCESS) {
+        win->slots[win->count++] = publish;
+        if (win->count > win->stats.max_count) {
+            win->stats.max_count = win->count;
+        }
+    }
+
+    SN_PubWindow_Unlock(win);
+    return rc;
+}
+
+void SN_PubWindow_RemoveAt(SN_PubWindow *win, word16 idx)
+{
+    /* Order of the slots does not matter, move the last one here */
+    win->count--;
+    win->slots[idx] = win->slots[win->count];
+    win->slots[win->count] = NULL;
+}
+
+SN_Publish* SN_PubWindow_Remove(SN_PubWindow *win, word16 packet_id)
+{
+    SN_Publish *publish = NULL;
+    word16 idx;
+
+    if (SN_PubWindow_Lock(win) != 0) {
+        return NULL;
+    }
+    idx = SN_PubWindow_Find(win, packet_id);
+    if (idx < win->count) {
+        publish = win->slots[idx];
+        SN_PubWindow_RemoveAt(win, idx);
+    }
+    SN_PubWindow_Unlock(win);
+    return publish;
+}
+
+SN_Publish* SN_PubWindow_RemoveAny(SN_PubWindow *win)
+{
+    SN_Publish *publish = NULL;
+
+    if (SN_PubWindow_Lock(win) != 0) {
+        return NULL;
+    }
+    if (win->count > 0) {
+        publish = win->slots[win->count - 1];
+        SN_PubWindow_RemoveAt(win, win->count - 1);
+    }
+    SN_PubWindow_Unlock(win);
+    return publish;
+}
+
+#endif /* WOLFMQTT_SN_WINDOW */
@@ -434,7 +434,12 @@ int MqttSocket_Connect(MqttClient *client, const char* host, word16 port,
             }
     #ifdef WOLFSSL_DTLS
             else {
+            #ifdef WOLFSSL_DTLS13
+                /* DTLS 1.3, or 1.2 with a gateway without it */
+                client->tls.ctx = wolfSSL_CTX_new(wolfDTLS_client_method());
+            #else
                 client->tls.ctx = wolfSSL_CTX_new(wolfDTLSv1_2_client_method());
+            #endif
             }
     #endif
             if (client->tls.ctx == NULL) {
@@ -459,6 +464,25 @@ int MqttSocket_Connect(MqttClient *client, const char* host, word16 port,
                 rc = MQTT_CODE_ERROR_TLS_CONNECT;
                 goto exit;
             }
+
+            if ((MqttClient_Flags(client,0,0) &
+                    (MQTT_CLIENT_FLAG_IS_DTLS | MQTT_CLIENT_FLAG_DTLS_CID)) ==
+                    (MQTT_CLIENT_FLAG_IS_DTLS | MQTT_CLIENT_FLAG_DTLS_CID)) {
+            #ifdef WOLFSSL_DTLS_CID
+                /* Offer connection IDs (RFC 9146). The client asks for no
+                   ID of its own, it only places the one of the gateway in
+                   its records, so the gateway finds the session when a NAT
+                   changes the address of the client. */
+                if (wolfSSL_dtls_cid_use(client->tls.ssl) != WOLFSSL_SUCCESS) {
+                    rc = MQTT_CODE_ERROR_TLS_CONNECT;
+                    goto exit;
+                }
+            #else
+                /* wolfSSL is built without WOLFSSL_DTLS_CID */
+                rc = MQTT_CODE_ERROR_TLS_CONNECT;
+                goto exit;
+            #endif
+            }
         } else {
             /* Since the user setup client->tls.ssl the IO callbacks didn't get
              * associated with this wolfSSL struct */
@@ -543,8 +567,8 @@ int MqttSocket_Disconnect(MqttClient *client)
         }
         wolfSSL_Cleanup();
         #endif
-        MqttClient_Flags(client,
-                (MQTT_CLIENT_FLAG_IS_TLS | MQTT_CLIENT_FLAG_IS_DTLS), 0);
+        MqttClient_Flags(client, (MQTT_CLIENT_FLAG_IS_TLS |
+                MQTT_CLIENT_FLAG_IS_DTLS | MQTT_CLIENT_FLAG_DTLS_CID), 0);
     #endif
 
         /* Make sure socket is closed */
@@ -0,0 +1,661 @@
+/* mqtt_subtrie.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_SUBTRIE: Enables the subscription trie. Topic filters, with the
+ *  '+' and '#' wildcards, each have a handler. With a trie set on a client
+ *  (MqttClient_SetSubTrie) each received publish is passed to the handlers
+ *  of all matching filters, found in time depending on the number of topic
+ *  levels only. A message without a matching filter goes to the message
+ *  callback. Topics subscribed with a handler (MqttTopic.cb) are added to
+ *  the trie when subscribing, and removed if the broker rejects them or on
+ *  unsubscribe. With WOLFMQTT_V5 and MqttSubTrie_SetSubIds the client also
+ *  assigns subscription identifiers, and a publish carrying identifiers is
+ *  dispatched by indexing the handler table with them.
+ *
+ * MQTT_SUBTRIE_MAX_MATCH: Most handlers called for one message (default 8).
+ * MQTT_SUBTRIE_DEF_BUCKETS: Initial number of hash buckets (default 64).
+ * MQTT_SUBTRIE_DEF_IDS: Initial number of subscription identifiers
+ *  (default 16).
+ */
+
+#ifdef WOLFMQTT_SUBTRIE
+
+#define MQTT_SUBTRIE_SHARE_PREFIX       "$share/"
+#define MQTT_SUBTRIE_SHARE_PREFIX_LEN   7
+#define MQTT_SUBTRIE_MAX_ID             268435455UL /* largest VBI */
+
+/* Private functions */
+
+static char* MqttSubNode_Name(MqttSubNode *node)
+{
+    return (char*)(node + 1);
+}
+
+/* FNV-1a of the level name, seeded with the parent node */
+static word32 MqttSubTrie_Key(const MqttSubNode *parent, const char *name,
+    word16 len)
+{
+    word32 hash = 2166136261UL;
+    size_t p = (size_t)parent;
+    word16 i;
+
+    hash ^= (word32)p ^ (word32)((p >> 16) >> 16);
+    hash *= 16777619UL;
+    for (i = 0; i < len; i++) {
+        hash ^= (byte)name[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static MqttSubNode* MqttSubTrie_Child(MqttSubTrie *trie, MqttSubNode *parent,
+    const char *name, word16 len)
+{
+    word32 key = MqttSubTrie_Key(parent, name, len);
+    MqttSubNode* node;
+
+    for (node = trie->buckets[key & trie->bucket_mask]; node != NULL;
+         node = node->chain) {
+        if (node->key == key && node->parent == parent &&
+                node->name_len == len &&
+                XMEMCMP(MqttSubNode_Name(node), name, len) == 0) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+/* Doubles the number of hash buckets */
+static int MqttSubTrie_Grow(MqttSubTrie *trie)
+{
+    word32 i, count = (trie->bucket_mask + 1) * 2;
+    MqttSubNode **buckets, *node, *next;
+
+    buckets = (MqttSubNode**)WOLFMQTT_MALLOC(sizeof(MqttSubNode*) * count);
+    if (buckets == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    XMEMSET(buckets, 0, sizeof(MqttSubNode*) * count);
+    for (i = 0; i <= trie->bucket_mask; i++) {
+        for (node = trie->buckets[i]; node != NULL; node = next) {
+            next = node->chain;
+            node->chain = buckets[node->key & (count - 1)];
+            buckets[node->key & (count - 1)] = node;
+        }
+    }
+    WOLFMQTT_FREE(trie->buckets);
+    trie->buckets = buckets;
+    trie->bucket_mask = count - 1;
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Returns the child for a level, adding it when not found */
+static MqttSubNode* MqttSubTrie_AddChild(MqttSubTrie *trie,
+    MqttSubNode *parent, const char *name, word16 len)
+{
+    MqttSubNode* node = MqttSubTrie_Child(trie, parent, name, len);
+    word32 bucket;
+
+    if (node != NULL) {
+        return node;
+    }
+    if (trie->node_count > trie->bucket_mask &&
+            MqttSubTrie_Grow(trie) != MQTT_CODE_SUCCESS) {
+        return NULL;
+    }
+    node = (MqttSubNode*)WOLFMQTT_MALLOC(sizeof(MqttSubNode) + len + 1);
+    if (node == NULL) {
+        return NULL;
+    }
+    XMEMSET(node, 0, sizeof(MqttSubNode));
+    XMEMCPY(MqttSubNode_Name(node), name, len);
+    MqttSubNode_Name(node)[len] = '\0';
+    node->name_len = len;
+    node->parent = parent;
+    node->key = MqttSubTrie_Key(parent, name, len);
+    bucket = node->key & trie->bucket_mask;
+    node->chain = trie->buckets[bucket];
+    trie->buckets[bucket] = node;
+    trie->node_count++;
+    parent->children++;
+
+    /* Wildcards are also linked from the parent for matching */
+    if (len == 1 && name[0] == TOPIC_LEVEL_SINGLE) {
+        parent->plus = node;
+    }
+    else if (len == 1 && name[0] == TOPIC_LEVEL_MULTI) {
+        parent->hash = node;
+    }
+    return node;
+}
+
+/* Frees nodes without a handler or children, from node up to the root */
+static void MqttSubTrie_Prune(MqttSubTrie *trie, MqttSubNode *node)
+{
+    MqttSubNode *parent, **prev;
+
+    while (node != &trie->root && node->cb == NULL && node->children == 0) {
+        parent = node->parent;
+        for (prev = &trie->buckets[node->key & trie->bucket_mask];
+             *prev != node; prev = &(*prev)->chain) {
+        }
+        *prev = node->chain;
+        if (parent->plus == node) {
+            parent->plus = NULL;
+        }
+        if (parent->hash == node) {
+            parent->hash = NULL;
+        }
+        parent->children--;
+        trie->node_count--;
+        WOLFMQTT_FREE(node);
+        node = parent;
+    }
+}
+
+/* Walks the levels of a filter. With add set, missing levels are added.
+ * Sets found to the node of the last level. */
+static int MqttSubTrie_Walk(MqttSubTrie *trie, const char *filter, byte add,
+    MqttSubNode **found)
+{
+    MqttSubNode *node = &trie->root, *child;
+    const char *end;
+    word32 len;
+
+    *found = NULL;
+
+    /* A shared subscription delivers messages with the topic of the filter
+     * after the group name */
+    if (XSTRNCMP(filter, MQTT_SUBTRIE_SHARE_PREFIX,
+            MQTT_SUBTRIE_SHARE_PREFIX_LEN) == 0) {
+        filter = XSTRCHR(filter + MQTT_SUBTRIE_SHARE_PREFIX_LEN,
+            TOPIC_LEVEL_SEPERATOR);
+        if (filter == NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+        }
+        filter++;
+    }
+    if (*filter == '\0') {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    for (;;) {
+        end = XSTRCHR(filter, TOPIC_LEVEL_SEPERATOR);
+        len = (end != NULL) ? (word32)(end - filter) :
+            (word32)XSTRLEN(filter);
+        if (len > 0xFFFF) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+        }
+        /* Wildcards must be a whole level, with '#' last */
+        if ((len > 1 || end != NULL) &&
+                XMEMCHR(filter, TOPIC_LEVEL_MULTI, len) != NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+        }
+        if (len > 1 && XMEMCHR(filter, TOPIC_LEVEL_SINGLE, len) != NULL) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+        }
+
+        if (add) {
+            child = MqttSubTrie_AddChild(trie, node, filter, (word16)len);
+            if (child == NULL) {
+                MqttSubTrie_Prune(trie, node);
+                return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+            }
+        }
+        else {
+            child = MqttSubTrie_Child(trie, node, filter, (word16)len);
+            if (child == NULL) {
+                return MQTT_CODE_ERROR_NOT_FOUND;
+            }
+        }
+        node = child;
+        if (end == NULL) {
+            break;
+        }
+        filter = end + 1;
+    }
+
+    *found = node;
+    return MQTT_CODE_SUCCESS;
+}
+
+#ifdef WOLFMQTT_V5
+/* Moves a filter to another subscription identifier (0 for none) */
+static void MqttSubTrie_SetNodeId(MqttSubTrie *trie, MqttSubNode *node,
+    word32 sub_id)
+{
+    if (node->sub_id != 0) {
+        trie->ids[node->sub_id].refs--;
+        trie->id_filter_count--;
+    }
+    node->sub_id = sub_id;
+    if (sub_id != 0) {
+        trie->ids[sub_id].refs++;
+        trie->id_filter_count++;
+    }
+}
+
+/* Returns a free subscription identifier for a handler, or 0 on memory
+ * failure. Identifiers are taken in turn so one just released is not
+ * reused while publish messages for it may still arrive. */
+static word32 MqttSubTrie_NewId(MqttSubTrie *trie, MqttTopicCb cb, void *ctx)
+{
+    word32 i, id = 0, count;
+    MqttSubId* ids;
+
+    for (i = 1; i < trie->id_max; i++) {
+        word32 next = trie->id_next + i - 1;
+        if (next >= trie->id_max) {
+            next -= trie->id_max - 1;
+        }
+        if (trie->ids[next].refs == 0) {
+            id = next;
+            break;
+        }
+    }
+    if (id == 0) {
+        /* All in use, double the table */
+        count = (trie->id_max == 0) ? MQTT_SUBTRIE_DEF_IDS : trie->id_max * 2;
+        if (count - 1 > MQTT_SUBTRIE_MAX_ID) {
+            return 0;
+        }
+        ids = (MqttSubId*)WOLFMQTT_MALLOC(sizeof(MqttSubId) * count);
+        if (ids == NULL) {
+            return 0;
+        }
+        XMEMSET(ids, 0, sizeof(MqttSubId) * count);
+        if (trie->ids != NULL) {
+            XMEMCPY(ids, trie->ids, sizeof(MqttSubId) * trie->id_max);
+            WOLFMQTT_FREE(trie->ids);
+        }
+        id = (trie->id_max == 0) ? 1 : trie->id_max;
+        trie->ids = ids;
+        trie->id_max = count;
+    }
+
+    trie->ids[id].cb = cb;
+    trie->ids[id].ctx = ctx;
+    trie->id_next = (id + 1 < trie->id_max) ? id + 1 : 1;
+    return id;
+}
+
+/* Finds the handlers of the subscription identifiers in the message.
+ * Returns MQTT_CODE_ERROR_NOT_FOUND when the topic must be matched instead,
+ * because a filter has no identifier or an identifier is not known. */
+static int MqttSubTrie_MatchIds(MqttSubTrie *trie, MqttMessage *msg,
+    MqttSubMatch *matches, int max_matches)
+{
+    int rc, count = 0;
+    MqttPropView view;
+    MqttProp prop;
+    MqttSubId* entry;
+
+    if (trie->id_filter_count == 0 ||
+            trie->id_filter_count != trie->filter_count) {
+        return MQTT_CODE_ERROR_NOT_FOUND;
+    }
+
+    /* Without an identifier no filter with a handler matched */
+    view = msg->props_view;
+    view.pos = 0;
+    while ((rc = MqttProps_ViewFind(&view, MQTT_PROP_SUBSCRIPTION_ID,
+            &prop)) > 0) {
+        if (prop.data_int == 0 || prop.data_int >= trie->id_max ||
+                trie->ids[prop.data_int].refs == 0) {
+            return MQTT_CODE_ERROR_NOT_FOUND;
+        }
+        entry = &trie->ids[prop.data_int];
+        if (count < max_matches) {
+            matches[count].cb = entry->cb;
+            matches[count].ctx = entry->ctx;
+            count++;
+        }
+    }
+    return (rc < 0) ? rc : count;
+}
+#endif /* WOLFMQTT_V5 */
+
+/* Adds or updates a filter. The trie must be locked. */
+static int MqttSubTrie_AddFilter(MqttSubTrie *trie, const char *filter,
+    MqttTopicCb cb, void *ctx, word32 sub_id, byte *added)
+{
+    int rc;
+    MqttSubNode* node;
+
+    rc = MqttSubTrie_Walk(trie, filter, 1, &node);
+    if (rc == MQTT_CODE_SUCCESS) {
+        if (node->cb == NULL) {
+            trie->filter_count++;
+            if (added != NULL) {
+                *added = 1;
+            }
+        }
+        node->cb = cb;
+        node->ctx = ctx;
+    #ifdef WOLFMQTT_V5
+        MqttSubTrie_SetNodeId(trie, node, sub_id);
+    #else
+        (void)sub_id;
+    #endif
+    }
+    return rc;
+}
+
+static void MqttSubTrie_AddMatch(MqttSubNode *node, MqttSubMatch *matches,
+    int max_matches, int *count)
+{
+    if (node->cb != NULL && *count < max_matches) {
+        matches[*count].cb = node->cb;
+        matches[*count].ctx = node->ctx;
+        (*count)++;
+    }
+}
+
+/* Matches the remaining topic levels, from topic (NULL once all levels are
+ * matched) to end, below node */
+static void MqttSubTrie_MatchNode(MqttSubTrie *trie, MqttSubNode *node,
+    const char *topic, const char *end, byte wildcards, MqttSubMatch *matches,
+    int max_matches, int *count)
+{
+    const char *level_end, *next;
+    MqttSubNode *child;
+
+    /* '#' matches this level and all below, including none */
+    if (wildcards && node->hash != NULL) {
+        MqttSubTrie_AddMatch(node->hash, matches, max_matches, count);
+    }
+    if (topic == NULL) {
+        MqttSubTrie_AddMatch(node, matches, max_matches, count);
+        return;
+    }
+
+    level_end = (const char*)XMEMCHR(topic, TOPIC_LEVEL_SEPERATOR,
+        (size_t)(end - topic));
+    if (level_end != NULL) {
+        next = level_end + 1;
+    }
+    else {
+        level_end = end;
+        next = NULL;
+    }
+
+    child = MqttSubTrie_Child(trie, node, topic,
+        (word16)(level_end - topic));
+    if (child != NULL) {
+        MqttSubTrie_MatchNode(trie, child, next, end, 1, matches,
+            max_matches, count);
+    }
+    if (wildcards && node->plus != NULL) {
+        MqttSubTrie_MatchNode(trie, node->plus, next, end, 1, matches,
+            max_matches, count);
+    }
+}
+
+/* Matches a topic from the root. The trie must be locked. */
+static void MqttSubTrie_MatchTopic(MqttSubTrie *trie, const char *topic,
+    word16 topic_len, MqttSubMatch *matches, int max_matches, int *count)
+{
+    /* Wildcards in the first level do not match topics starting with '$' */
+    MqttSubTrie_MatchNode(trie, &trie->root, topic, topic + topic_len,
+        (topic_len == 0 || topic[0] != '$'), matches, max_matches, count);
+}
+
+
+/* Public Functions */
+
+int MqttSubTrie_Init(MqttSubTrie *trie)
+{
+    if (trie == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+    XMEMSET(trie, 0, sizeof(MqttSubTrie));
+    trie->buckets = (MqttSubNode**)WOLFMQTT_MALLOC(
+        sizeof(MqttSubNode*) * MQTT_SUBTRIE_DEF_BUCKETS);
+    if (trie->buckets == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MEMORY);
+    }
+    XMEMSET(trie->buckets, 0, sizeof(MqttSubNode*) * MQTT_SUBTRIE_DEF_BUCKETS);
+    trie->bucket_mask = MQTT_SUBTRIE_DEF_BUCKETS - 1;
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemInit(&trie->lock) != 0) {
+        WOLFMQTT_FREE(trie->buckets);
+        trie->buckets = NULL;
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+    return MQTT_CODE_SUCCESS;
+}
+
+void MqttSubTrie_Free(MqttSubTrie *trie)
+{
+    word32 i;
+    MqttSubNode *node, *next;
+
+    if (trie == NULL || trie->buckets == NULL) {
+        return;
+    }
+    for (i = 0; i <= trie->bucket_mask; i++) {
+        for (node = trie->buckets[i]; node != NULL; node = next) {
+            next = node->chain;
+            WOLFMQTT_FREE(node);
+        }
+    }
+    WOLFMQTT_FREE(trie->buckets);
+#ifdef WOLFMQTT_V5
+    if (trie->ids != NULL) {
+        WOLFMQTT_FREE(trie->ids);
+    }
+#endif
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemFree(&trie->lock);
+#endif
+    XMEMSET(trie, 0, sizeof(MqttSubTrie));
+}
+
+int MqttSubTrie_Add(MqttSubTrie *trie, const char *filter, MqttTopicCb cb,
+    void *ctx)
+{
+    int rc;
+
+    if (trie == NULL || trie->buckets == NULL || filter == NULL ||
+            cb == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&trie->lock) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+    rc = MqttSubTrie_AddFilter(trie, filter, cb, ctx, 0, NULL);
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemUnlock(&trie->lock);
+#endif
+    return rc;
+}
+
+int MqttSubTrie_Remove(MqttSubTrie *trie, const char *filter)
+{
+    int rc;
+    MqttSubNode* node;
+
+    if (trie == NULL || trie->buckets == NULL || filter == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&trie->lock) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+    rc = MqttSubTrie_Walk(trie, filter, 0, &node);
+    if (rc == MQTT_CODE_SUCCESS && node->cb == NULL) {
+        rc = MQTT_CODE_ERROR_NOT_FOUND;
+    }
+    if (rc == MQTT_CODE_SUCCESS) {
+    #ifdef WOLFMQTT_V5
+        MqttSubTrie_SetNodeId(trie, node, 0);
+    #endif
+        node->cb = NULL;
+        node->ctx = NULL;
+        trie->filter_count--;
+        MqttSubTrie_Prune(trie, node);
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemUnlock(&trie->lock);
+#endif
+    return rc;
+}
+
+#ifdef WOLFMQTT_V5
+int MqttSubTrie_SetSubIds(MqttSubTrie *trie, byte enable)
+{
+    if (trie == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    trie->use_ids = enable;
+    return MQTT_CODE_SUCCESS;
+}
+#endif
+
+int MqttSubTrie_Match(MqttSubTrie *trie, const char *topic, word16 topic_len,
+    MqttSubMatch *matches, int max_matches)
+{
+    int count = 0;
+
+    if (trie == NULL || trie->buckets == NULL || topic == NULL ||
+            matches == NULL || max_matches <= 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&trie->lock) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+    MqttSubTrie_MatchTopic(trie, topic, topic_len, matches, max_matches,
+        &count);
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemUnlock(&trie->lock);
+#endif
+    return count;
+}
+
+int MqttSubTrie_AddTopics(MqttSubTrie *trie, MqttTopic *topics,
+    int topic_count, word32 *sub_id)
+{
+    int rc = MQTT_CODE_SUCCESS, i;
+    word32 id = 0;
+
+#ifdef WOLFMQTT_MULTITHREAD
+    if (wm_SemLock(&trie->lock) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+    }
+#endif
+#ifdef WOLFMQTT_V5
+    /* A message only carries the identifier of the subscribe, so it can
+     * select the handler only when all topics have the same one */
+    if (sub_id != NULL && trie->use_ids && topic_count > 0) {
+        for (i = 0; i < topic_count; i++) {
+            if (topics[i].cb == NULL || topics[i].cb != topics[0].cb ||
+                    topics[i].cb_ctx != topics[0].cb_ctx) {
+                break;
+            }
+        }
+        if (i == topic_count) {
+            id = MqttSubTrie_NewId(trie, topics[0].cb, topics[0].cb_ctx);
+        }
+    }
+#endif
+    for (i = 0; i < topic_count; i++) {
+        topics[i].cb_added = 0;
+    }
+    for (i = 0; i < topic_count && rc == MQTT_CODE_SUCCESS; i++) {
+        if (topics[i].cb != NULL) {
+            rc = MqttSubTrie_AddFilter(trie, topics[i].topic_filter,
+                topics[i].cb, topics[i].cb_ctx, id, &topics[i].cb_added);
+        }
+    }
+#ifdef WOLFMQTT_MULTITHREAD
+    (void)wm_SemUnlock(&trie->lock);
+#endif
+    if (sub_id != NULL) {
+        *sub_id = id;
+    }
+    return rc;
+}
+
+int MqttSubTrie_Deliver(MqttSubTrie *trie, MqttClient *client,
+    MqttMessage *msg, byte msg_new, byte msg_done)
+{
+    int rc = MQTT_CODE_SUCCESS, i;
+
+    if (msg_new) {
+    #ifdef WOLFMQTT_MULTITHREAD
+        if (wm_SemLock(&trie->lock) != 0) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_SYSTEM);
+        }
+    #endif
+        trie->match_count = 0;
+    #ifdef WOLFMQTT_V5
+        rc = MqttSubTrie_MatchIds(trie, msg, trie->match,
+            MQTT_SUBTRIE_MAX_MATCH);
+        if (rc >= 0) {
+            trie->match_count = rc;
+        }
+    #else
+        rc = MQTT_CODE_ERROR_NOT_FOUND;
+    #endif
+        if (rc == MQTT_CODE_ERROR_NOT_FOUND && msg->topic_name != NULL) {
+            MqttSubTrie_MatchTopic(trie, msg->topic_name, msg->topic_name_len,
+                trie->match, MQTT_SUBTRIE_MAX_MATCH, &trie->match_count);
+        }
+    #ifdef WOLFMQTT_MULTITHREAD
+        (void)wm_SemUnlock(&trie->lock);
+    #endif
+        if (rc < 0 && rc != MQTT_CODE_ERROR_NOT_FOUND) {
+            return rc;
+        }
+        rc = MQTT_CODE_SUCCESS;
+    }
+    if (trie->match_count == 0) {
+        return MQTT_CODE_ERROR_NOT_FOUND;
+    }
+
+    /* Handlers were copied, so filters may change while they run */
+    for (i = 0; i < trie->match_count && rc == MQTT_CODE_SUCCESS; i++) {
+        rc = trie->match[i].cb(client, msg, msg_new, msg_done,
+            trie->match[i].ctx);
+    }
+    return rc;
+}
+
+#endif /* WOLFMQTT_SUBTRIE */
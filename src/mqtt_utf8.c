@@ -0,0 +1,571 @@
+/* mqtt_utf8.c
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+/* Include the autoconf generated config.h */
+#ifdef HAVE_CONFIG_H
+    #include <config.h>
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+/* DOCUMENTED BUILD OPTIONS:
+ *
+ * WOLFMQTT_UTF8: Enables validation of MQTT strings. Decoded topic names
+ *  and string properties, and encoded strings, must be well-formed UTF-8
+ *  without U+0000. Topic names must not contain wildcards and topic filters
+ *  must use them correctly. Invalid strings return
+ *  MQTT_CODE_ERROR_MALFORMED_DATA. The validator is selected at runtime
+ *  with MqttUtf8_SetImpl.
+ *
+ * WOLFMQTT_NO_UTF8_SIMD: Builds only the scalar validator. Otherwise SSE2
+ *  and AVX2 (x86, GCC or Clang for AVX2) or NEON (AArch64) validators are
+ *  built. AVX2 and NEON check all bytes with the lookup table method of
+ *  Keiser and Lemire. SSE2 skips blocks of plain ASCII and checks other
+ *  blocks with the scalar code.
+ */
+
+#ifdef WOLFMQTT_UTF8
+
+#ifndef WOLFMQTT_NO_UTF8_SIMD
+    #if defined(__SSE2__) || defined(_M_X64) || \
+        (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define WOLFMQTT_UTF8_SSE2
+        #include <emmintrin.h>
+        #ifdef _MSC_VER
+            #include <intrin.h>
+        #endif
+    #endif
+    #if defined(WOLFMQTT_UTF8_SSE2) && defined(__GNUC__) && \
+        (defined(__x86_64__) || defined(__i386__))
+        #define WOLFMQTT_UTF8_AVX2
+        #include <immintrin.h>
+    #endif
+    #if defined(__aarch64__) && defined(__ARM_NEON) && defined(__GNUC__)
+        #define WOLFMQTT_UTF8_NEON
+        #include <arm_neon.h>
+    #endif
+#endif
+
+typedef int (*MqttUtf8Func)(const byte *s, word32 len, byte flags);
+
+static MqttUtf8Func gUtf8Func = NULL;
+static MqttUtf8Impl gUtf8Impl = MQTT_UTF8_IMPL_AUTO;
+
+/* Private functions */
+
+/* Checks the character at s[*pos], which is not plain ASCII, and moves pos
+ * past it */
+static int MqttUtf8_Char(const byte *s, word32 len, word32 *pos, byte flags)
+{
+    word32 i = *pos, n, k;
+    byte c = s[i];
+    byte lo = 0x80, hi = 0xBF;
+
+    if (c < 0x80) {
+        if (c == 0) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+        }
+        if ((c == '+' || c == '#') && flags != 0) {
+            if (flags & MQTT_UTF8_TOPIC_NAME) {
+                return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+            }
+            /* Wildcard must be a whole level and '#' must be the last */
+            if ((i > 0 && s[i - 1] != '/') ||
+                (c == '#' && i + 1 != len) ||
+                (c == '+' && i + 1 != len && s[i + 1] != '/')) {
+                return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+            }
+        }
+        *pos = i + 1;
+        return MQTT_CODE_SUCCESS;
+    }
+
+    /* Reject overlong forms, surrogates and code points over U+10FFFF */
+    if (c >= 0xC2 && c <= 0xDF) {
+        n = 1;
+    }
+    else if (c >= 0xE0 && c <= 0xEF) {
+        n = 2;
+        if (c == 0xE0) {
+            lo = 0xA0;
+        }
+        else if (c == 0xED) {
+            hi = 0x9F;
+        }
+    }
+    else if (c >= 0xF0 && c <= 0xF4) {
+        n = 3;
+        if (c == 0xF0) {
+            lo = 0x90;
+        }
+        else if (c == 0xF4) {
+            hi = 0x8F;
+        }
+    }
+    else {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    if (len - i <= n || s[i + 1] < lo || s[i + 1] > hi) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    for (k = 2; k <= n; k++) {
+        if ((s[i + k] & 0xC0) != 0x80) {
+            return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+        }
+    }
+    *pos = i + 1 + n;
+    return MQTT_CODE_SUCCESS;
+}
+
+/* Checks the characters from pos up to end, which may be passed by the last
+ * character. Moves pos past the last character checked. */
+static int MqttUtf8_Block(const byte *s, word32 len, word32 *pos, word32 end,
+    byte flags)
+{
+    int rc;
+    word32 i = *pos;
+    byte c;
+
+    while (i < end) {
+        c = s[i];
+        if (c != 0 && c < 0x80 && c != '+' && c != '#') {
+            i++;
+            continue;
+        }
+        rc = MqttUtf8_Char(s, len, &i, flags);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+    }
+    *pos = i;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int MqttUtf8_None(const byte *s, word32 len, byte flags)
+{
+    (void)s;
+    (void)len;
+    (void)flags;
+    return MQTT_CODE_SUCCESS;
+}
+
+static int MqttUtf8_Scalar(const byte *s, word32 len, byte flags)
+{
+    word32 pos = 0;
+    return MqttUtf8_Block(s, len, &pos, len, flags);
+}
+
+#if defined(WOLFMQTT_UTF8_AVX2) || defined(WOLFMQTT_UTF8_NEON)
+/* Checks the end of the string after the vector loop. The vector loop does
+ * not check the last character is complete, so back up to its lead byte. */
+static int MqttUtf8_Finish(const byte *s, word32 len, word32 pos, byte flags)
+{
+    word32 back = pos;
+
+    while (back > 0 && pos - back < 3 && (s[back - 1] & 0xC0) == 0x80) {
+        back--;
+    }
+    if (back > 0 && s[back - 1] >= 0xC0) {
+        back--;
+    }
+    else {
+        back = pos;
+    }
+    return MqttUtf8_Block(s, len, &back, len, flags);
+}
+
+/* Lookup tables from "Validating UTF-8 In Less Than One Instruction Per
+ * Byte" (Keiser and Lemire). Each error is a bit that is set in all three
+ * tables for the first and second byte of an invalid pair. */
+#define UTF8_TOO_SHORT      0x01 /* lead byte not followed by continuation */
+#define UTF8_TOO_LONG       0x02 /* ASCII followed by continuation */
+#define UTF8_OVERLONG_3     0x04
+#define UTF8_TOO_LARGE      0x08 /* over U+10FFFF */
+#define UTF8_SURROGATE      0x10
+#define UTF8_OVERLONG_2     0x20
+#define UTF8_TOO_LARGE_1000 0x40
+#define UTF8_OVERLONG_4     0x40
+#define UTF8_TWO_CONTS      0x80 /* checked against the lead byte position */
+#define UTF8_CARRY          (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+/* High nibble of first byte */
+static const byte kUtf8Byte1High[16] = {
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+/* Low nibble of first byte */
+static const byte kUtf8Byte1Low[16] = {
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    UTF8_CARRY,
+    UTF8_CARRY,
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+};
+/* High nibble of second byte */
+static const byte kUtf8Byte2High[16] = {
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+        UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |
+        UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+        UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE |
+        UTF8_TOO_LARGE,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+#endif
+
+#if defined(WOLFMQTT_UTF8_SSE2) || defined(WOLFMQTT_UTF8_AVX2)
+static word32 MqttUtf8_Ctz(word32 mask)
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (word32)idx;
+#else
+    return (word32)__builtin_ctz(mask);
+#endif
+}
+
+/* Checks the wildcards at the positions in mask from base */
+static int MqttUtf8_Wildcards(const byte *s, word32 len, word32 base,
+    word32 mask, byte flags)
+{
+    int rc = MQTT_CODE_SUCCESS;
+    word32 i;
+
+    while (mask != 0 && rc == MQTT_CODE_SUCCESS) {
+        i = base + MqttUtf8_Ctz(mask);
+        rc = MqttUtf8_Char(s, len, &i, flags);
+        mask &= mask - 1;
+    }
+    return rc;
+}
+#endif
+
+#ifdef WOLFMQTT_UTF8_SSE2
+/* SSE2 has no byte shuffle for the lookup tables, so blocks that are not all
+ * plain ASCII are checked with the scalar code */
+static int MqttUtf8_Sse2(const byte *s, word32 len, byte flags)
+{
+    int rc;
+    word32 pos = 0, end, mask;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i plus = _mm_set1_epi8('+');
+    const __m128i hash = _mm_set1_epi8('#');
+    __m128i v, m;
+
+    while (len - pos >= 16) {
+        v = _mm_loadu_si128((const __m128i*)&s[pos]);
+        /* High bit is set for non-ASCII, zero and wildcard bytes */
+        m = _mm_or_si128(v, _mm_cmpeq_epi8(v, zero));
+        if (flags != 0) {
+            m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, plus),
+                                             _mm_cmpeq_epi8(v, hash)));
+        }
+        mask = (word32)_mm_movemask_epi8(m);
+        if (mask == 0) {
+            pos += 16;
+            continue;
+        }
+        end = pos + 16;
+        pos += MqttUtf8_Ctz(mask);
+        rc = MqttUtf8_Block(s, len, &pos, end, flags);
+        if (rc != MQTT_CODE_SUCCESS) {
+            return rc;
+        }
+    }
+    return MqttUtf8_Block(s, len, &pos, len, flags);
+}
+#endif /* WOLFMQTT_UTF8_SSE2 */
+
+#ifdef WOLFMQTT_UTF8_AVX2
+__attribute__((target("avx2")))
+static int MqttUtf8_Avx2(const byte *s, word32 len, byte flags)
+{
+    int rc;
+    word32 pos = 0, wild;
+    const __m256i t1h = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)kUtf8Byte1High));
+    const __m256i t1l = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)kUtf8Byte1Low));
+    const __m256i t2h = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)kUtf8Byte2High));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i high = _mm256_set1_epi8((char)0x80);
+    const __m256i third = _mm256_set1_epi8((char)(0xE0 - 0x80));
+    const __m256i fourth = _mm256_set1_epi8((char)(0xF0 - 0x80));
+    /* Bytes that start a sequence too long for the block */
+    const __m256i last = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i plus = _mm256_set1_epi8('+');
+    const __m256i hash = _mm256_set1_epi8('#');
+    __m256i v, prev = zero, incomplete = zero, err = zero;
+    __m256i shifted, prev1, prev2, prev3, sc, must23;
+
+    while (len - pos >= 32) {
+        v = _mm256_loadu_si256((const __m256i*)&s[pos]);
+        err = _mm256_or_si256(err, _mm256_cmpeq_epi8(v, zero));
+        if (flags != 0) {
+            wild = (word32)_mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, plus), _mm256_cmpeq_epi8(v, hash)));
+            if (wild != 0) {
+                _mm256_zeroupper();
+                rc = MqttUtf8_Wildcards(s, len, pos, wild, flags);
+                if (rc != MQTT_CODE_SUCCESS) {
+                    return rc;
+                }
+            }
+        }
+        if (_mm256_movemask_epi8(v) == 0) {
+            /* Plain ASCII, so the previous block must have ended with a
+             * complete character */
+            err = _mm256_or_si256(err, incomplete);
+            incomplete = zero;
+        }
+        else {
+            shifted = _mm256_permute2x128_si256(prev, v, 0x21);
+            prev1 = _mm256_alignr_epi8(v, shifted, 15);
+            prev2 = _mm256_alignr_epi8(v, shifted, 14);
+            prev3 = _mm256_alignr_epi8(v, shifted, 13);
+            sc = _mm256_and_si256(_mm256_and_si256(
+                _mm256_shuffle_epi8(t1h,
+                    _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                _mm256_shuffle_epi8(t1l, _mm256_and_si256(prev1, nibble))),
+                _mm256_shuffle_epi8(t2h,
+                    _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+            /* Third and fourth bytes must be continuations */
+            must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, third),
+                                     _mm256_subs_epu8(prev3, fourth));
+            err = _mm256_or_si256(err, _mm256_xor_si256(
+                _mm256_and_si256(must23, high), sc));
+            incomplete = _mm256_subs_epu8(v, last);
+        }
+        prev = v;
+        pos += 32;
+    }
+    rc = _mm256_testz_si256(err, err);
+    /* Avoid the penalty for SSE code using upper halves left dirty */
+    _mm256_zeroupper();
+    if (rc == 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    return MqttUtf8_Finish(s, len, pos, flags);
+}
+#endif /* WOLFMQTT_UTF8_AVX2 */
+
+#ifdef WOLFMQTT_UTF8_NEON
+static int MqttUtf8_Neon(const byte *s, word32 len, byte flags)
+{
+    int rc;
+    word32 pos = 0, i;
+    const uint8x16_t t1h = vld1q_u8(kUtf8Byte1High);
+    const uint8x16_t t1l = vld1q_u8(kUtf8Byte1Low);
+    const uint8x16_t t2h = vld1q_u8(kUtf8Byte2High);
+    const uint8x16_t nibble = vdupq_n_u8(0x0F);
+    const uint8x16_t high = vdupq_n_u8(0x80);
+    const uint8x16_t third = vdupq_n_u8(0xE0 - 0x80);
+    const uint8x16_t fourth = vdupq_n_u8(0xF0 - 0x80);
+    /* Bytes that start a sequence too long for the block */
+    static const byte kLast[16] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+    };
+    const uint8x16_t last = vld1q_u8(kLast);
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t plus = vdupq_n_u8('+');
+    const uint8x16_t hash = vdupq_n_u8('#');
+    uint8x16_t v, prev = zero, incomplete = zero, err = zero;
+    uint8x16_t prev1, prev2, prev3, sc, must23, wild;
+
+    while (len - pos >= 16) {
+        v = vld1q_u8(&s[pos]);
+        err = vorrq_u8(err, vceqq_u8(v, zero));
+        if (flags != 0) {
+            wild = vorrq_u8(vceqq_u8(v, plus), vceqq_u8(v, hash));
+            if (vmaxvq_u8(wild) != 0) {
+                for (i = pos; i < pos + 16; i++) {
+                    if (s[i] == '+' || s[i] == '#') {
+                        word32 k = i;
+                        rc = MqttUtf8_Char(s, len, &k, flags);
+                        if (rc != MQTT_CODE_SUCCESS) {
+                            return rc;
+                        }
+                    }
+                }
+            }
+        }
+        if (vmaxvq_u8(v) < 0x80) {
+            /* Plain ASCII, so the previous block must have ended with a
+             * complete character */
+            err = vorrq_u8(err, incomplete);
+            incomplete = zero;
+        }
+        else {
+            prev1 = vextq_u8(prev, v, 15);
+            prev2 = vextq_u8(prev, v, 14);
+            prev3 = vextq_u8(prev, v, 13);
+            sc = vandq_u8(vandq_u8(
+                vqtbl1q_u8(t1h, vshrq_n_u8(prev1, 4)),
+                vqtbl1q_u8(t1l, vandq_u8(prev1, nibble))),
+                vqtbl1q_u8(t2h, vshrq_n_u8(v, 4)));
+            /* Third and fourth bytes must be continuations */
+            must23 = vorrq_u8(vqsubq_u8(prev2, third),
+                              vqsubq_u8(prev3, fourth));
+            err = vorrq_u8(err, veorq_u8(vandq_u8(must23, high), sc));
+            incomplete = vqsubq_u8(v, last);
+        }
+        prev = v;
+        pos += 16;
+    }
+    if (vmaxvq_u8(err) != 0) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_MALFORMED_DATA);
+    }
+    return MqttUtf8_Finish(s, len, pos, flags);
+}
+#endif /* WOLFMQTT_UTF8_NEON */
+
+static MqttUtf8Func MqttUtf8_GetFunc(MqttUtf8Impl impl)
+{
+    switch (impl) {
+        case MQTT_UTF8_IMPL_NONE:
+            return MqttUtf8_None;
+        case MQTT_UTF8_IMPL_SCALAR:
+            return MqttUtf8_Scalar;
+        case MQTT_UTF8_IMPL_SSE2:
+        #ifdef WOLFMQTT_UTF8_SSE2
+            return MqttUtf8_Sse2;
+        #else
+            break;
+        #endif
+        case MQTT_UTF8_IMPL_AVX2:
+        #ifdef WOLFMQTT_UTF8_AVX2
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                return MqttUtf8_Avx2;
+            }
+        #endif
+            break;
+        case MQTT_UTF8_IMPL_NEON:
+        #ifdef WOLFMQTT_UTF8_NEON
+            return MqttUtf8_Neon;
+        #else
+            break;
+        #endif
+        case MQTT_UTF8_IMPL_AUTO:
+        default:
+            break;
+    }
+    return NULL;
+}
+
+
+/* Public Functions */
+
+int MqttUtf8_SetImpl(MqttUtf8Impl impl)
+{
+    static const MqttUtf8Impl best[] = {
+        MQTT_UTF8_IMPL_AVX2, MQTT_UTF8_IMPL_NEON, MQTT_UTF8_IMPL_SSE2,
+        MQTT_UTF8_IMPL_SCALAR
+    };
+    MqttUtf8Func func = NULL;
+    word32 i;
+
+    if (impl == MQTT_UTF8_IMPL_AUTO) {
+        for (i = 0; i < sizeof(best) / sizeof(best[0]) && func == NULL; i++) {
+            impl = best[i];
+            func = MqttUtf8_GetFunc(impl);
+        }
+    }
+    else {
+        func = MqttUtf8_GetFunc(impl);
+    }
+    if (func == NULL) {
+        return MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    gUtf8Impl = impl;
+    gUtf8Func = func;
+    return MQTT_CODE_SUCCESS;
+}
+
+MqttUtf8Impl MqttUtf8_GetImpl(void)
+{
+    if (gUtf8Func == NULL) {
+        (void)MqttUtf8_SetImpl(MQTT_UTF8_IMPL_AUTO);
+    }
+    return gUtf8Impl;
+}
+
+const char* MqttUtf8_ImplToString(MqttUtf8Impl impl)
+{
+    switch (impl) {
+        case MQTT_UTF8_IMPL_AUTO:
+            return "Auto";
+        case MQTT_UTF8_IMPL_NONE:
+            return "None";
+        case MQTT_UTF8_IMPL_SCALAR:
+            return "Scalar";
+        case MQTT_UTF8_IMPL_SSE2:
+            return "SSE2";
+        case MQTT_UTF8_IMPL_AVX2:
+            return "AVX2";
+        case MQTT_UTF8_IMPL_NEON:
+            return "NEON";
+        default:
+            break;
+    }
+    return "Unknown";
+}
+
+int MqttUtf8_Validate(const char *str, word32 len, byte flags)
+{
+    if (str == NULL) {
+        return (len == 0) ? MQTT_CODE_SUCCESS :
+            MQTT_TRACE_ERROR(MQTT_CODE_ERROR_BAD_ARG);
+    }
+    if (gUtf8Func == NULL) {
+        (void)MqttUtf8_SetImpl(MQTT_UTF8_IMPL_AUTO);
+    }
+    return gUtf8Func((const byte*)str, len, flags);
+}
+
+#endif /* WOLFMQTT_UTF8 */
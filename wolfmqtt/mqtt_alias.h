@@ -0,0 +1,150 @@
+/* mqtt_alias.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_ALIAS_H
+#define WOLFMQTT_ALIAS_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_packet.h"
+
+#ifdef WOLFMQTT_TOPIC_ALIAS
+
+#ifndef WOLFMQTT_V5
+    #error "WOLFMQTT_TOPIC_ALIAS requires WOLFMQTT_V5"
+#endif
+
+/* Topics shorter than this are always sent in full, since the alias
+ * property is 3 bytes */
+#ifndef MQTT_TOPIC_ALIAS_MIN_LEN
+#define MQTT_TOPIC_ALIAS_MIN_LEN    4
+#endif
+
+/* Topic assigned to an alias. Entries are linked by alias number, where
+ * zero is the end of a list. */
+typedef struct _MqttAliasEntry {
+    char       *topic;
+    word32      hash;
+    word16      topic_len;
+    word16      chain;      /* next entry in hash bucket */
+    word16      prev;       /* more recently used */
+    word16      next;       /* less recently used */
+} MqttAliasEntry;
+
+/* Outbound topic aliases. The least recently used alias is reassigned when
+ * all aliases allowed by the broker are in use. */
+typedef struct _MqttTopicAliasOut {
+    MqttAliasEntry *entries;    /* alias N is entries[N-1] */
+    word16     *buckets;
+    word32      bucket_mask;
+    word16      capacity;       /* number of entries */
+    word16      max;            /* limited by broker Topic Alias Maximum */
+    word16      count;          /* aliases assigned */
+    word16      head;           /* most recently used */
+    word16      tail;           /* least recently used */
+} MqttTopicAliasOut;
+
+/* Topic received for an inbound alias */
+typedef struct _MqttAliasTopic {
+    char       *topic;      /* null terminated */
+    word16      topic_len;
+    word16      size;       /* allocated */
+} MqttAliasTopic;
+
+/* Inbound topic aliases, set by the broker */
+typedef struct _MqttTopicAliasIn {
+    MqttAliasTopic *topics;     /* alias N is topics[N-1] */
+    word16      capacity;       /* number of entries */
+    word16      max;            /* Topic Alias Maximum sent in CONNECT */
+} MqttTopicAliasIn;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes an outbound topic alias table. Set it on a client
+                with MqttClient_SetTopicAliasOut.
+ *  \param      out         Pointer to MqttTopicAliasOut structure
+                            (uninitialized is okay)
+ *  \param      max_aliases Most aliases to use. The broker Topic Alias
+                            Maximum from CONNACK further limits this.
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttTopicAliasOut_Init(
+    MqttTopicAliasOut *out,
+    word16 max_aliases);
+
+/*! \brief      Releases the outbound topic alias table memory
+ *  \param      out         Pointer to MqttTopicAliasOut structure
+ */
+WOLFMQTT_API void MqttTopicAliasOut_Free(MqttTopicAliasOut *out);
+
+/*! \brief      Initializes an inbound topic alias table. Set it on a client
+                with MqttClient_SetTopicAliasIn.
+ *  \param      in          Pointer to MqttTopicAliasIn structure
+                            (uninitialized is okay)
+ *  \param      max_aliases Most aliases accepted from the broker. This is
+                            sent as the Topic Alias Maximum in CONNECT,
+                            unless the connect properties set a lower one.
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttTopicAliasIn_Init(
+    MqttTopicAliasIn *in,
+    word16 max_aliases);
+
+/*! \brief      Releases the inbound topic alias table memory
+ *  \param      in          Pointer to MqttTopicAliasIn structure
+ */
+WOLFMQTT_API void MqttTopicAliasIn_Free(MqttTopicAliasIn *in);
+
+
+/* Internal Interfaces */
+
+/* Clears all aliases and sets the broker limit (on connect) */
+WOLFMQTT_LOCAL void MqttTopicAliasOut_Reset(MqttTopicAliasOut *out,
+    word16 broker_max);
+/* Returns the alias for a topic (or zero to send it without one). Known
+   is set when the broker already has the topic for the alias. */
+WOLFMQTT_LOCAL word16 MqttTopicAliasOut_Get(MqttTopicAliasOut *out,
+    const char *topic, byte *known);
+/* Drops an alias that was assigned, but not sent */
+WOLFMQTT_LOCAL void MqttTopicAliasOut_Forget(MqttTopicAliasOut *out,
+    word16 alias);
+
+/* Clears all aliases and sets the advertised limit (on connect) */
+WOLFMQTT_LOCAL void MqttTopicAliasIn_Reset(MqttTopicAliasIn *in,
+    word16 max);
+/* Records the topic for an alias or, for an empty topic, sets the topic
+   from the alias */
+WOLFMQTT_LOCAL int MqttTopicAliasIn_Resolve(MqttTopicAliasIn *in,
+    word16 alias, const char **topic, word16 *topic_len);
+
+#endif /* WOLFMQTT_TOPIC_ALIAS */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_ALIAS_H */
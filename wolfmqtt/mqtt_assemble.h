@@ -0,0 +1,153 @@
+/* mqtt_assemble.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_ASSEMBLE_H
+#define WOLFMQTT_ASSEMBLE_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_packet.h"
+
+#ifdef WOLFMQTT_ASSEMBLER
+
+/* Spilling large messages to a memory mapped temporary file requires POSIX
+ * file and mmap support */
+#if !defined(WOLFMQTT_NO_ASSEMBLER_SPILL) && !defined(USE_WINDOWS_API) && \
+    !defined(WOLFMQTT_NO_STDIO)
+    #define WOLFMQTT_ASSEMBLER_SPILL
+#endif
+
+/* Default directory for spill files, when TMPDIR is not set */
+#ifndef MQTT_ASSEMBLER_TMP_DIR
+#define MQTT_ASSEMBLER_TMP_DIR      "/tmp"
+#endif
+
+/* Maximum length of the spill file path */
+#ifndef MQTT_ASSEMBLER_MAX_PATH
+#define MQTT_ASSEMBLER_MAX_PATH     256
+#endif
+
+struct _MqttClient;
+
+/* Complete message. Only valid during the assembled message callback. */
+typedef struct _MqttAssembledMsg {
+    word16      packet_id;
+    MqttQoS     qos;
+    byte        retain;
+    byte        duplicate;
+    byte        spilled;        /* payload is a mapped temporary file */
+
+    char       *topic_name;     /* null terminated */
+    word16      topic_name_len;
+    byte       *buffer;         /* Complete payload */
+    word32      total_len;      /* Payload length */
+} MqttAssembledMsg;
+
+/*! \brief      Assembled message handler. Called once the complete payload
+                has been received, from the message callback with msg_done.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      msg         Pointer to complete message. The payload buffer
+                            is released once the handler returns.
+ *  \param      ctx         Pointer to user context
+ *  \return     MQTT_CODE_SUCCESS or error, which is returned from the
+                message callback.
+ */
+typedef int (*MqttAssemblerCb)(struct _MqttClient *client,
+    MqttAssembledMsg *msg, void *ctx);
+
+typedef struct _MqttAssembler {
+    MqttAssemblerCb cb;
+    void       *ctx;
+    word32      spill_len;      /* payloads larger than this are spilled */
+    word32      max_len;        /* largest payload accepted, 0 = no limit */
+    const char *dir;            /* spill file directory */
+
+    MqttAssembledMsg cur;       /* message being assembled */
+    byte        active;
+    byte       *mem;            /* in memory payload */
+#ifdef WOLFMQTT_ASSEMBLER_SPILL
+    int         fd;             /* spill file */
+    word32      written;
+#endif
+} MqttAssembler;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes the large message assembler. Received payloads
+                up to spill_len are assembled in memory. Larger payloads are
+                written to an unlinked temporary file as they arrive and
+                mapped when complete, so their size does not add to the
+                process memory.
+ *  \param      asmb        Pointer to MqttAssembler structure
+                            (uninitialized is okay)
+ *  \param      spill_len   Payload length above which the message is spilled
+                            to a file. Zero assembles all messages in memory.
+ *  \param      max_len     Largest payload accepted, zero for no limit
+ *  \param      dir         Directory for spill files. NULL uses TMPDIR or
+                            MQTT_ASSEMBLER_TMP_DIR.
+ *  \param      cb          Complete message handler
+ *  \param      ctx         Pointer to user context for the handler
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG (also if
+                spilling is not supported on this platform)
+ */
+WOLFMQTT_API int MqttAssembler_Init(
+    MqttAssembler *asmb,
+    word32 spill_len,
+    word32 max_len,
+    const char *dir,
+    MqttAssemblerCb cb,
+    void *ctx);
+
+/*! \brief      Releases any partially assembled message
+ *  \param      asmb        Pointer to MqttAssembler structure
+ */
+WOLFMQTT_API void MqttAssembler_Free(MqttAssembler *asmb);
+
+/*! \brief      Adds a received message segment. Call this from the message
+                callback. Segments of a message that was not started (the
+                application did not pass msg_new) are ignored, so messages
+                can be filtered on msg_new.
+ *  \param      asmb        Pointer to MqttAssembler structure
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      msg         Pointer to received message
+ *  \param      msg_new     If non-zero value then message is new
+ *  \param      msg_done    If non-zero value then message is complete
+ *  \return     MQTT_CODE_SUCCESS, the handler return code or
+                MQTT_CODE_ERROR_* (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttAssembler_Message(
+    MqttAssembler *asmb,
+    struct _MqttClient *client,
+    MqttMessage *msg,
+    byte msg_new,
+    byte msg_done);
+
+#endif /* WOLFMQTT_ASSEMBLER */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_ASSEMBLE_H */
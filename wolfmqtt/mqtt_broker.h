@@ -0,0 +1,222 @@
+/* mqtt_broker.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_BROKER_H
+#define WOLFMQTT_BROKER_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+#ifdef WOLFMQTT_BROKER
+
+/* Most subscriptions of a connection */
+#ifndef MQTT_BROKER_MAX_SUBS
+#define MQTT_BROKER_MAX_SUBS        16
+#endif
+
+/* Most topics in one SUBSCRIBE or UNSUBSCRIBE */
+#ifndef MQTT_BROKER_MAX_TOPICS
+#define MQTT_BROKER_MAX_TOPICS      32
+#endif
+
+/* Most retained messages */
+#ifndef MQTT_BROKER_MAX_RETAINED
+#define MQTT_BROKER_MAX_RETAINED    64
+#endif
+
+/* Most QoS 2 publishes received on a connection and not yet released */
+#ifndef MQTT_BROKER_MAX_QOS2
+#define MQTT_BROKER_MAX_QOS2        16
+#endif
+
+/* Longest client identifier */
+#ifndef MQTT_BROKER_CLIENTID_MAX_LEN
+#define MQTT_BROKER_CLIENTID_MAX_LEN 64
+#endif
+
+/* Subscription options byte (v5), the QoS is in bits 0-1 */
+enum MqttBrokerSubOptions {
+    MQTT_BROKER_SUB_QOS_MASK        = 0x03,
+    MQTT_BROKER_SUB_NO_LOCAL        = 0x04,
+    MQTT_BROKER_SUB_RETAIN_AS_PUB   = 0x08,
+    MQTT_BROKER_SUB_RETAIN_HANDLING = 0x30, /* 0 = send retained, 1 = send
+                                               if new, 2 = do not send */
+    MQTT_BROKER_SUB_RESERVED        = 0xC0
+};
+
+enum MqttBrokerConnState {
+    MQTT_BROKER_CONN_FREE = 0,
+    MQTT_BROKER_CONN_NEW,       /* waiting for CONNECT */
+    MQTT_BROKER_CONN_ACTIVE,
+    MQTT_BROKER_CONN_CLOSING    /* session taken over or write failed */
+};
+
+/* Subscription of a connection */
+typedef struct _MqttBrokerSub {
+    char       *filter;         /* topic filter, NULL when free */
+    byte        options;        /* QoS and v5 subscription options */
+} MqttBrokerSub;
+
+/* Retained message. The buffer holds the encoded topic name, the property
+   length and properties, then the payload. */
+typedef struct _MqttBrokerRetained {
+    byte       *buf;
+    word32      var_len;        /* encoded topic and properties */
+    word32      payload_len;
+    word16      topic_len;      /* encoded topic, with its length */
+    MqttQoS     qos;
+} MqttBrokerRetained;
+
+typedef struct _MqttBrokerConn {
+    MqttClient  client;         /* network, buffers and packet reads */
+    byte        state;          /* MqttBrokerConnState */
+    byte        protocol_level;
+    word16      packet_id;      /* last packet ID sent */
+    word16      qos2_ids[MQTT_BROKER_MAX_QOS2]; /* received, not released */
+    char        client_id[MQTT_BROKER_CLIENTID_MAX_LEN + 1];
+    MqttBrokerSub subs[MQTT_BROKER_MAX_SUBS];
+} MqttBrokerConn;
+
+typedef struct _MqttBrokerStats {
+    word32      connects;       /* sessions accepted */
+    word32      publish_in;     /* publishes received */
+    word32      publish_out;    /* publishes sent to subscribers */
+    word32      dropped;        /* publishes not sent to a subscriber */
+} MqttBrokerStats;
+
+typedef struct _MqttBroker {
+    MqttBrokerConn *conns;
+    byte           *bufs;       /* tx and rx buffers of the connections */
+    byte           *var_buf;    /* topic and properties being routed */
+    int             buf_len;
+    int             cmd_timeout_ms;
+    word16          max_conns;
+    word16          count;      /* connections in use */
+    word32          next_id;    /* for assigned client identifiers */
+
+    MqttBrokerRetained retained[MQTT_BROKER_MAX_RETAINED];
+    word16          retained_count;
+
+    MqttTopic       topics[MQTT_BROKER_MAX_TOPICS];
+
+    MqttBrokerStats stats;
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_Sem          lock;       /* everything but the packet reads */
+#endif
+} MqttBroker;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes a minimal MQTT broker for tests and benchmarks.
+                It handles CONNECT, SUBSCRIBE and UNSUBSCRIBE with the '+'
+                and '#' wildcards, routes QoS 0-2 publishes and keeps
+                retained messages. v5 publish properties are forwarded as
+                received.
+ *  \note       Sessions end with their connection (session present is
+                always 0), will messages are not sent, any user name and
+                password is accepted, and keep alive is not enforced. v5
+                topic aliases, subscription identifiers, shared
+                subscriptions and AUTH are not supported.
+ *  \param      broker      Pointer to MqttBroker structure
+                            (uninitialized is okay)
+ *  \param      max_conns   Most connections
+ *  \param      buf_len     Size of the tx and rx buffers of each
+                            connection. Larger packets close the connection
+                            and are not sent to subscribers.
+ *  \param      cmd_timeout_ms  Milliseconds to wait for a write
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttBroker_Init(
+    MqttBroker *broker,
+    word16 max_conns,
+    int buf_len,
+    int cmd_timeout_ms);
+
+/*! \brief      Adds an accepted network connection. The client is expected
+                to send CONNECT first.
+ *  \note       The network callbacks are those of a client: read, write and
+                disconnect are used, connect is not called but must be set.
+                Connections are plain: TLS is not terminated.
+ *  \param      broker      Pointer to MqttBroker structure
+ *  \param      net         Network callbacks and context of the
+                            connection, kept until it is closed
+ *  \return     Index of the connection or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttBroker_Add(
+    MqttBroker *broker,
+    MqttNet *net);
+
+/*! \brief      Reads one packet from a connection and handles it. Each
+                connection may be served by its own thread in a
+                multithreaded build.
+ *  \param      broker      Pointer to MqttBroker structure
+ *  \param      idx         Index of the connection
+ *  \param      timeout_ms  Milliseconds to wait for a packet
+ *  \return     MQTT_CODE_SUCCESS, MQTT_CODE_ERROR_TIMEOUT or
+                MQTT_CODE_CONTINUE when no complete packet was read, or
+                MQTT_CODE_ERROR_* when the connection was closed (after a
+                DISCONNECT, MQTT_CODE_ERROR_NETWORK). The index may then be
+                given to a new connection.
+ */
+WOLFMQTT_API int MqttBroker_ConnTask(
+    MqttBroker *broker,
+    int idx,
+    int timeout_ms);
+
+/*! \brief      Reads and handles at most one packet from each connection,
+                and closes the connections in MQTT_BROKER_CONN_CLOSING
+ *  \param      broker      Pointer to MqttBroker structure
+ *  \param      timeout_ms  Milliseconds to wait on each connection
+ *  \return     Number of packets handled or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttBroker_Task(
+    MqttBroker *broker,
+    int timeout_ms);
+
+/*! \brief      Closes a connection and ends its session
+ *  \param      broker      Pointer to MqttBroker structure
+ *  \param      idx         Index of the connection
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttBroker_Close(
+    MqttBroker *broker,
+    int idx);
+
+/*! \brief      Closes all the connections and releases the retained
+                messages and the broker memory
+ *  \param      broker      Pointer to MqttBroker structure
+ */
+WOLFMQTT_API void MqttBroker_Free(MqttBroker *broker);
+
+#endif /* WOLFMQTT_BROKER */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_BROKER_H */
@@ -45,6 +45,39 @@
 #ifdef WOLFMQTT_SN
 #include "wolfmqtt/mqtt_sn_packet.h"
 #endif
+#ifdef WOLFMQTT_SN_REGISTRY
+#include "wolfmqtt/mqtt_sn_registry.h"
+#endif
+#ifdef WOLFMQTT_SN_RETRY
+#include "wolfmqtt/mqtt_sn_retry.h"
+#endif
+#ifdef WOLFMQTT_SN_WINDOW
+#include "wolfmqtt/mqtt_sn_window.h"
+#endif
+#ifdef WOLFMQTT_DISPATCH
+#include "wolfmqtt/mqtt_dispatch.h"
+#endif
+#ifdef WOLFMQTT_ASSEMBLER
+#include "wolfmqtt/mqtt_assemble.h"
+#endif
+#ifdef WOLFMQTT_MSG_POOL
+#include "wolfmqtt/mqtt_msgpool.h"
+#endif
+#ifdef WOLFMQTT_TOPIC_ALIAS
+#include "wolfmqtt/mqtt_alias.h"
+#endif
+#ifdef WOLFMQTT_SUBTRIE
+#include "wolfmqtt/mqtt_subtrie.h"
+#endif
+#ifdef WOLFMQTT_COMPRESS
+#include "wolfmqtt/mqtt_compress.h"
+#endif
+#ifdef WOLFMQTT_MEMNET
+#include "wolfmqtt/mqtt_memnet.h"
+#endif
+#ifdef WOLFMQTT_FAULTNET
+#include "wolfmqtt/mqtt_faultnet.h"
+#endif
 
 
 /* This macro allows the disconnect callback to be triggered when
@@ -103,7 +136,10 @@ typedef int (*MqttPublishCb)(MqttPublish* publish);
 enum MqttClientFlags {
     MQTT_CLIENT_FLAG_IS_CONNECTED = 0x01 << 0,
     MQTT_CLIENT_FLAG_IS_TLS       = 0x01 << 1,
-    MQTT_CLIENT_FLAG_IS_DTLS      = 0x01 << 2
+    MQTT_CLIENT_FLAG_IS_DTLS      = 0x01 << 2,
+    MQTT_CLIENT_FLAG_DTLS_CID     = 0x01 << 3  /* with IS_DTLS, offer a DTLS
+                                                  connection ID
+                                                  (WOLFSSL_DTLS_CID) */
 };
 /*! \brief      Sets flags in the MqttClient structure. To be used from
                 the application before calling MqttClient_NetConnect.
@@ -160,6 +196,26 @@ typedef struct _MqttSk {
     typedef int (*SN_ClientRegisterCb)(word16 topicId, const char* topicName, void *reg_ctx);
 #endif
 
+#ifdef WOLFMQTT_SN_SLEEP
+    #ifndef WOLFMQTT_SN
+        #error "WOLFMQTT_SN_SLEEP requires WOLFMQTT_SN"
+    #endif
+
+    /* MQTT-SN client states, as seen by the gateway (6.14) */
+    typedef enum _SN_ClientState {
+        SN_CLIENT_STATE_DISCONNECTED = 0,
+        SN_CLIENT_STATE_ACTIVE,     /* connected */
+        SN_CLIENT_STATE_ASLEEP,     /* gateway buffers messages */
+        SN_CLIENT_STATE_AWAKE       /* gateway sends buffered messages */
+    } SN_ClientState;
+
+    typedef struct _SN_SleepStats {
+        word32 sleeps;      /* sleep requests acknowledged */
+        word32 wakeups;     /* wake up pings sent */
+        word32 buffered;    /* publishes received while awake */
+    } SN_SleepStats;
+#endif
+
 /* Client structure */
 typedef struct _MqttClient {
     word32       flags; /* MqttClientFlags */
@@ -186,6 +242,21 @@ typedef struct _MqttClient {
     SN_Object    msgSN;
     SN_ClientRegisterCb reg_cb;
     void               *reg_ctx;
+#ifdef WOLFMQTT_SN_REGISTRY
+    SN_TopicRegistry   *sn_reg; /* topic names and IDs */
+#endif
+#ifdef WOLFMQTT_SN_RETRY
+    SN_Retry           *sn_retry; /* retransmission timer */
+#endif
+#ifdef WOLFMQTT_SN_WINDOW
+    SN_PubWindow       *sn_window; /* outstanding publishes */
+#endif
+#ifdef WOLFMQTT_SN_SLEEP
+    byte                sn_state;      /* SN_ClientState */
+    byte                sn_sleep_req;  /* sleep DISCONNECT sent */
+    word16              sn_sleep_sec;  /* sleep duration */
+    SN_SleepStats       sn_sleep_stats;
+#endif
 #endif
     void*        ctx;   /* user supplied context for publish callbacks */
 
@@ -195,6 +266,8 @@ typedef struct _MqttClient {
     byte   retain_avail;  /* Server property */
     byte   enable_eauth;  /* Enhanced authentication */
     byte   protocol_level;
+    MqttPropArena prop_arena; /* Received properties */
+    byte   lazy_props;    /* Do not build received publish property list */
 #endif
 
 #ifdef WOLFMQTT_DISCONNECT_CB
@@ -205,6 +278,27 @@ typedef struct _MqttClient {
     MqttPropertyCb property_cb;
     void          *property_ctx;
 #endif
+#ifdef WOLFMQTT_DISPATCH
+    MqttDispatch  *dispatch; /* worker pool for incoming publish */
+#endif
+#ifdef WOLFMQTT_MSG_POOL
+    MqttMsgPool   *msg_pool;
+    MqttMsgBuf    *rx_msgbuf;   /* pooled buffer used as rx_buf */
+    MqttMsgBuf    *rx_next;     /* reserved for next read when retained */
+    byte          *rx_buf_user; /* rx_buf given to MqttClient_Init */
+    int            rx_buf_len_user;
+#endif
+#ifdef WOLFMQTT_TOPIC_ALIAS
+    MqttTopicAliasOut *alias_out; /* outbound topic aliases */
+    MqttTopicAliasIn  *alias_in;  /* inbound topic aliases */
+    word16         topic_alias_max; /* Server property */
+#endif
+#ifdef WOLFMQTT_SUBTRIE
+    MqttSubTrie   *subtrie; /* handlers per topic filter */
+#endif
+#ifdef WOLFMQTT_COMPRESS
+    MqttCompress  *compress; /* payload codec */
+#endif
 #ifdef WOLFMQTT_MULTITHREAD
     wm_Sem lockSend;
     wm_Sem lockRecv;
@@ -284,6 +378,136 @@ WOLFMQTT_API int MqttClient_SetPropertyCallback(
     void* ctx);
 #endif
 
+#ifdef WOLFMQTT_DISPATCH
+/*! \brief      Sets a worker pool dispatcher for incoming publish messages.
+                When set, received messages are copied and queued to the
+                dispatcher workers instead of calling the message callback,
+                so the reading thread does not wait on message processing.
+ *  \note       A client can not have both a dispatcher and a subscription
+                trie (MqttClient_SetSubTrie), since the trie handlers would
+                not run on the workers. Setting one while the other is set
+                fails with MQTT_CODE_ERROR_BAD_ARG.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      disp        Pointer to MqttDispatch structure initialized
+                            with MqttDispatch_Init or NULL to use the
+                            message callback again
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttClient_SetDispatch(
+    MqttClient *client,
+    MqttDispatch *disp);
+#endif
+
+#ifdef WOLFMQTT_MSG_POOL
+/*! \brief      Sets a pool of receive buffers. The client reads each packet
+                into a pooled buffer (replacing the rx_buf given to
+                MqttClient_Init), so received messages can be retained
+                using MqttClient_MsgRetain. Must not be called while a read
+                is in progress.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      pool        Pointer to MqttMsgPool structure initialized
+                            with MqttMsgPool_Init or NULL to release the
+                            pooled buffer and use rx_buf again
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttClient_SetMsgPool(
+    MqttClient *client,
+    MqttMsgPool *pool);
+
+/*! \brief      Keeps a received message without copying it. Call from the
+                message callback. The buffer the message was read into is
+                handed to the application and the client reads the next
+                packet into a spare pooled buffer. Only messages received in
+                a single callback (msg_new and msg_done) can be retained.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      msg         Pointer to message passed to the message
+                            callback
+ *  \return     Pointer to the buffer holding the message, which must be
+                released with MqttMsgBuf_Release, or NULL if the message
+                cannot be retained (no spare buffer or a partial message),
+                in which case the message must be copied.
+ */
+WOLFMQTT_API MqttMsgBuf* MqttClient_MsgRetain(
+    MqttClient *client,
+    MqttMessage *msg);
+#endif
+
+#ifdef WOLFMQTT_TOPIC_ALIAS
+/*! \brief      Sets an outbound topic alias table. Publishes then send a
+                topic alias (assigned least recently used first, within the
+                broker Topic Alias Maximum) and only send the topic the first
+                time. Publishes that set a MQTT_PROP_TOPIC_ALIAS property
+                or use a template are sent as given. The table is cleared
+                on each connect.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      out         Pointer to MqttTopicAliasOut structure
+                            initialized with MqttTopicAliasOut_Init or NULL
+                            to disable
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttClient_SetTopicAliasOut(
+    MqttClient *client,
+    MqttTopicAliasOut *out);
+
+/*! \brief      Sets an inbound topic alias table. The next connect
+                advertises the table size as the Topic Alias Maximum (unless
+                the connect properties already set one, which then limits
+                the table). Publishes received with a topic alias are given
+                to the message callback with the topic the broker set for
+                the alias. A publish using an alias that is out of range or
+                was not set fails with MQTT_CODE_ERROR_PROPERTY.
+ *  \note       The topic of an aliased message points into the table, so
+                MqttClient_MsgRetain does not retain it (copy it instead).
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      in          Pointer to MqttTopicAliasIn structure
+                            initialized with MqttTopicAliasIn_Init or NULL
+                            to disable
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttClient_SetTopicAliasIn(
+    MqttClient *client,
+    MqttTopicAliasIn *in);
+#endif
+
+#ifdef WOLFMQTT_SUBTRIE
+/*! \brief      Sets a subscription trie. Each received publish is passed to
+                the handlers of the matching filters in the trie, and to the
+                message callback when no filter matches. Topics subscribed
+                with a handler (MqttTopic.cb) are added to the trie when
+                subscribing, and removed on unsubscribe. When the subscribe
+                fails or the broker rejects a topic, only the filters it
+                added are removed, so a re-subscribe keeps the handler.
+ *  \note       Fails with MQTT_CODE_ERROR_BAD_ARG while a dispatcher is set
+                (MqttClient_SetDispatch).
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      trie        Pointer to MqttSubTrie structure initialized
+                            with MqttSubTrie_Init or NULL to disable
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttClient_SetSubTrie(
+    MqttClient *client,
+    MqttSubTrie *trie);
+#endif
+
+#ifdef WOLFMQTT_COMPRESS
+/*! \brief      Sets a payload codec. Publish payloads are compressed when
+                sent, and received compressed payloads are decompressed
+                before the message callback, which gets the complete payload
+                in one call.
+ *  \note       The decompressed payload is in the codec buffer, so it can
+                not be kept with MqttClient_MsgRetain.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      comp        Pointer to MqttCompress structure initialized
+                            with MqttCompress_Init or NULL to disable
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttClient_SetCompress(
+    MqttClient *client,
+    MqttCompress *comp);
+#endif
+
 /*! \brief      Encodes and sends the MQTT Connect packet and waits for the
                 Connect Acknowledgment packet
  *  \note This is a blocking function that will wait for MqttNet.read
@@ -372,6 +596,33 @@ WOLFMQTT_API int MqttClient_Publish_WriteOnly(
     MqttPublishCb pubCb);
 #endif
 
+/*! \brief      Pre-encodes the topic, QoS, retain flag and properties of a
+                publish into a template. Set MqttPublish.tmpl to the template
+                and each publish then only encodes the remaining length,
+                packet ID and payload. The topic_name, qos, retain and props
+                of the publish are taken from the template.
+ *  \note       The template is encoded for the protocol version of the
+                client, so it must be initialized after MqttClient_Connect.
+                The topic string must remain valid while the template is
+                used. Properties are copied and can be freed after this call.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      tmpl        Pointer to MqttPublishTemplate structure
+ *  \param      publish     Pointer to MqttPublish structure with the
+                            topic_name, qos, retain and props to encode
+ *  \param      buf         Buffer for the encoded template, which must
+                            remain valid while the template is used
+ *  \param      buf_len     Length of buffer
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+    \sa         MqttClient_Publish
+ */
+WOLFMQTT_API int MqttClient_PublishTemplate_Init(
+    MqttClient *client,
+    MqttPublishTemplate *tmpl,
+    MqttPublish *publish,
+    byte *buf,
+    int buf_len);
+
 /*! \brief      Encodes and sends the MQTT Subscribe packet and waits for the
                 Subscribe Acknowledgment packet
  *  \note This is a blocking function that will wait for MqttNet.read
@@ -385,6 +636,31 @@ WOLFMQTT_API int MqttClient_Subscribe(
     MqttClient *client,
     MqttSubscribe *subscribe);
 
+/*! \brief      Subscribes to a topic list of any length. The topics are split
+                into SUBSCRIBE packets that fit the send buffer, the
+                max_packet_size and the broker's Maximum Packet Size (v5).
+                Up to packet_max packets are sent before waiting, and the
+                Subscribe Acknowledgments are matched by packet ID in any
+                order.
+ *  \note This is a blocking function that will wait for MqttNet.read
+ *  \note       Packet IDs packet_id to packet_id + packet_count - 1 (skipping
+                zero) are used and must not be in use by other requests.
+                The number of topics per packet is also limited so the
+                Subscribe Acknowledgment fits the read buffer.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      bulk        Pointer to MqttSubscribeBulk structure initialized
+                            with the topic list, the packets window and the
+                            first packet ID. The return code of each topic is
+                            stored in topics[i].return_code.
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes). Topics rejected by the
+                broker are counted in fail_count.
+    \sa         MqttClient_Subscribe
+ */
+WOLFMQTT_API int MqttClient_SubscribeBulk(
+    MqttClient *client,
+    MqttSubscribeBulk *bulk);
+
 /*! \brief      Encodes and sends the MQTT Unsubscribe packet and waits for the
                 Unsubscribe Acknowledgment packet
  *  \note This is a blocking function that will wait for MqttNet.read
@@ -450,6 +726,101 @@ WOLFMQTT_API MqttProp* MqttClient_PropsAdd(
  */
 WOLFMQTT_API int MqttClient_PropsFree(
     MqttProp *head);
+
+/*! \brief      Initialize a property arena.
+ *  Properties added from an arena use the supplied storage with no locking
+    or allocation and are appended in constant time. Use one arena per thread
+    (for example per publisher) and release all properties at once using
+    MqttClient_PropsArenaReset after the packet command.
+ *  \param      arena       Pointer to MqttPropArena structure
+ *  \param      props       Pointer to array of property structures
+ *  \param      count       Number of elements in props
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttClient_PropsArenaInit(
+    MqttPropArena *arena,
+    MqttProp *props,
+    int count);
+
+/*! \brief      Add a new property from an arena.
+ *  Same as MqttClient_PropsAdd, but uses the arena storage. When the arena
+    is full the property is allocated using MqttClient_PropsAdd.
+ *  \param      arena       Pointer to MqttPropArena structure
+ *  \param      head        Pointer-pointer to a property structure
+ *  \return     Pointer to new property or NULL on error
+ */
+WOLFMQTT_API MqttProp* MqttClient_PropsArenaAdd(
+    MqttPropArena *arena,
+    MqttProp **head);
+
+/*! \brief      Release all properties allocated from an arena.
+ *  Any lists built using the arena must no longer be used.
+ *  \param      arena       Pointer to MqttPropArena structure
+ */
+WOLFMQTT_API void MqttClient_PropsArenaReset(
+    MqttPropArena *arena);
+
+/*! \brief      Sets storage used for received properties.
+ *  Properties decoded by this client are allocated from this storage instead
+    of the shared property allocator, so receiving clients do not contend
+    for a global lock. The properties are released once handled.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      props       Pointer to array of property structures
+ *  \param      count       Number of elements in props (0 to disable)
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttClient_SetPropArena(
+    MqttClient *client,
+    MqttProp *props,
+    int count);
+
+/*! \brief      Sets if received publish properties are decoded lazily.
+ *  When enabled msg->props is not populated for the message callback (no
+    property allocation). Use the MqttClient_PropsView functions with
+    msg->props_view instead. Default is disabled, unless built with
+    WOLFMQTT_LAZY_PROPS.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      enable      Non-zero to enable lazy properties
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttClient_SetLazyProps(
+    MqttClient *client,
+    byte enable);
+
+/*! \brief      Decodes the next property from a received packet.
+ *  The property is decoded directly from the receive buffer into prop. String
+    and binary data pointers reference the receive buffer, so are only valid
+    until the next packet is read (for publish only when msg_new is set).
+ *  \param      view        Pointer to property view of received packet
+                            (for example msg->props_view)
+ *  \param      prop        Pointer to property structure to populate
+ *  \return     Positive value if a property was decoded, zero if there are
+                no more properties or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttClient_PropsViewNext(
+    MqttPropView *view,
+    MqttProp *prop);
+
+/*! \brief      Finds the next property of a type in a received packet.
+ *  Searches from the current view position, so repeated calls return each
+    property of that type (for example user properties).
+ *  \param      view        Pointer to property view of received packet
+ *  \param      type        Property type to find
+ *  \param      prop        Pointer to property structure to populate
+ *  \return     Positive value if found, zero if not found or
+                MQTT_CODE_ERROR_* (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttClient_PropsViewFind(
+    MqttPropView *view,
+    MqttPropertyType type,
+    MqttProp *prop);
+
+/*! \brief      Restarts property view iteration from the first property.
+ *  \param      view        Pointer to property view of received packet
+ */
+WOLFMQTT_API void MqttClient_PropsViewReset(
+    MqttPropView *view);
 #endif
 
 
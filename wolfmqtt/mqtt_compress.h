@@ -0,0 +1,180 @@
+/* mqtt_compress.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_COMPRESS_H
+#define WOLFMQTT_COMPRESS_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_packet.h"
+
+#ifdef WOLFMQTT_COMPRESS
+
+#ifndef WOLFMQTT_V5
+    #error "WOLFMQTT_COMPRESS requires WOLFMQTT_V5"
+#endif
+
+/* User property marking a compressed payload, so receivers without the
+ * codec (or not expecting it) can tell */
+#ifndef MQTT_COMPRESS_PROP_KEY
+#define MQTT_COMPRESS_PROP_KEY      "content-encoding"
+#endif
+#define MQTT_COMPRESS_DEFLATE       "deflate"
+
+/* Payloads shorter than this are sent as is */
+#ifndef MQTT_COMPRESS_MIN_LEN
+#define MQTT_COMPRESS_MIN_LEN       64
+#endif
+
+/* Deflate window (9 to 15), memory used is about (1 << (bits + 2)) for
+ * compressing. Inflate always accepts the largest window. */
+#ifndef MQTT_COMPRESS_WINDOW_BITS
+#define MQTT_COMPRESS_WINDOW_BITS   15
+#endif
+
+/* Compression level: 0 (none) to 9 (best), or the zlib default */
+#define MQTT_COMPRESS_LEVEL_DEFAULT (-1)
+
+/* Result of MqttCompress_Message */
+enum MqttCompressMsg {
+    MQTT_COMPRESS_MSG_PLAIN = 0,    /* deliver message as received */
+    MQTT_COMPRESS_MSG_SEGMENT,      /* segment taken, nothing to deliver */
+    MQTT_COMPRESS_MSG_DONE          /* deliver decompressed message */
+};
+
+typedef struct _MqttCompress {
+    byte       *tx_buf;         /* compressed publish payload */
+    word32      tx_buf_len;
+    byte       *rx_buf;         /* decompressed received payload */
+    word32      rx_buf_len;
+    word32      min_len;        /* shortest payload compressed */
+    int         level;
+    const byte *dict;           /* preset dictionary (both peers) */
+    word32      dict_len;
+
+    /* zlib streams, allocated on first use */
+    void       *def;
+    void       *inf;
+
+    /* Publish being sent with the compressed payload */
+    MqttMessage *tx_msg;
+    byte       *tx_raw;
+    word32      tx_raw_len;
+
+    /* Message being decompressed */
+    byte        rx_active;
+    word32      rx_len;         /* decompressed length so far */
+    byte       *rx_saved;       /* topic and properties of a segmented
+                                   message */
+    const char *rx_topic;
+    word16      rx_topic_len;
+    MqttPropView rx_props;
+
+    /* Received payload, while the decompressed one is delivered */
+    byte       *rx_raw;
+    word32      rx_raw_len;
+    word32      rx_raw_pos;
+    word32      rx_raw_total;
+} MqttCompress;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes the payload codec. Set it on a client with
+                MqttClient_SetCompress. Published payloads are deflated into
+                tx_buf and sent with the user property
+                "content-encoding: deflate" when that makes them shorter.
+                Received payloads with the property are inflated into rx_buf
+                before the message callback, others are passed as is, so
+                peers without the codec interoperate as long as they do not
+                receive compressed payloads.
+ *  \note       Requires MQTT v5. Payloads from a publish callback or sent in
+                chunks (buffer_len less than total_len), and payloads with a
+                UTF-8 payload format indicator, are not compressed.
+ *  \param      comp        Pointer to MqttCompress structure
+                            (uninitialized is okay)
+ *  \param      tx_buf      Buffer for compressed payloads, NULL to send all
+                            payloads uncompressed
+ *  \param      tx_buf_len  Length of tx_buf
+ *  \param      rx_buf      Buffer for decompressed payloads, NULL to
+                            deliver compressed payloads as received
+ *  \param      rx_buf_len  Length of rx_buf, the largest decompressed
+                            payload accepted
+ *  \param      level       Compression level 0 to 9 or
+                            MQTT_COMPRESS_LEVEL_DEFAULT
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttCompress_Init(
+    MqttCompress *comp,
+    byte *tx_buf,
+    word32 tx_buf_len,
+    byte *rx_buf,
+    word32 rx_buf_len,
+    int level);
+
+/*! \brief      Sets a preset dictionary, such as the common keys and values
+                of the JSON messages, which makes short payloads compress
+                much better. All peers must use the same dictionary.
+ *  \param      comp        Pointer to MqttCompress structure
+ *  \param      dict        Dictionary, must remain valid while used
+ *  \param      dict_len    Length of dict
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttCompress_SetDict(
+    MqttCompress *comp,
+    const byte *dict,
+    word32 dict_len);
+
+/*! \brief      Releases the compression streams
+ *  \param      comp        Pointer to MqttCompress structure
+ */
+WOLFMQTT_API void MqttCompress_Free(MqttCompress *comp);
+
+
+/* Internal Interfaces */
+
+/* Compresses the payload of a publish about to be encoded. Returns 1 when
+   shorter: the publish then has the compressed payload until
+   MqttCompress_PublishDone, and prop is added to the front of its
+   properties (to be removed once encoded). Returns 0 when sent as is. */
+WOLFMQTT_LOCAL int MqttCompress_Publish(MqttCompress *comp,
+    MqttMessage *msg, MqttProp *prop);
+WOLFMQTT_LOCAL void MqttCompress_PublishDone(MqttCompress *comp,
+    MqttMessage *msg);
+
+/* Adds a received message segment. Sets result to a MqttCompressMsg. For
+   MQTT_COMPRESS_MSG_DONE the message has the decompressed payload until
+   MqttCompress_MessageDone. */
+WOLFMQTT_LOCAL int MqttCompress_Message(MqttCompress *comp, MqttMessage *msg,
+    byte msg_new, byte msg_done, byte *result);
+WOLFMQTT_LOCAL void MqttCompress_MessageDone(MqttCompress *comp,
+    MqttMessage *msg);
+
+#endif /* WOLFMQTT_COMPRESS */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_COMPRESS_H */
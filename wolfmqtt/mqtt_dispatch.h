@@ -0,0 +1,203 @@
+/* mqtt_dispatch.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_DISPATCH_H
+#define WOLFMQTT_DISPATCH_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_packet.h"
+
+#ifdef WOLFMQTT_DISPATCH
+
+#ifndef WOLFMQTT_MULTITHREAD
+    #error "WOLFMQTT_MULTITHREAD must be defined to use WOLFMQTT_DISPATCH"
+#endif
+#if defined(WOLFMQTT_POSIX_SEMAPHORES) && defined(WOLFMQTT_NO_COND_SIGNAL)
+    /* worker signals are released from a different thread */
+    #error "WOLFMQTT_DISPATCH is not supported with WOLFMQTT_NO_COND_SIGNAL"
+#endif
+
+/* Thread handle used for the dispatch workers */
+#if defined(WOLFMQTT_USER_THREADING)
+    /* User provides wm_Thread type, wm_ThreadCreate and wm_ThreadJoin.
+     * Add them into user_settings.h */
+#elif defined(USE_WINDOWS_API)
+    typedef HANDLE wm_Thread;
+#elif defined(__MACH__) || defined(WOLFMQTT_POSIX_SEMAPHORES)
+    #include <pthread.h>
+    typedef pthread_t wm_Thread;
+#else
+    #error "WOLFMQTT_DISPATCH requires a thread implementation!"
+#endif
+
+/* Maximum number of dispatch worker threads */
+#ifndef MQTT_DISPATCH_MAX_WORKERS
+#define MQTT_DISPATCH_MAX_WORKERS   64
+#endif
+
+/* Default per worker queue depth (must be power of two) */
+#ifndef MQTT_DISPATCH_DEF_DEPTH
+#define MQTT_DISPATCH_DEF_DEPTH     256
+#endif
+
+/* Used to keep the ring producer and consumer indexes on separate lines */
+#ifndef MQTT_DISPATCH_CACHE_LINE
+#define MQTT_DISPATCH_CACHE_LINE    64
+#endif
+
+struct _MqttClient;
+struct _MqttDispatch;
+
+/* Dispatched message. The topic and payload are stored in the same
+ * allocation directly after this structure and are owned by the handler
+ * once it is called. With a client message pool the payload is not copied,
+ * it stays in the retained pooled receive buffer. The v5 properties of the
+ * publish are not carried, they are freed once the packet is read. */
+typedef struct _MqttDispatchMsg {
+    struct _MqttClient *client;
+    word16      packet_id;
+    MqttQoS     qos;
+    byte        retain;
+    byte        duplicate;
+
+    char       *topic_name;     /* null terminated */
+    word16      topic_name_len;
+    byte       *buffer;         /* Complete payload */
+    word32      total_len;      /* Payload length */
+#ifdef WOLFMQTT_MSG_POOL
+    struct _MqttMsgBuf *msg_buf; /* pooled buffer holding payload */
+#endif
+} MqttDispatchMsg;
+
+/*! \brief      Dispatch message handler. Called from a worker thread.
+    Messages with the same topic are always handled by the same worker, in
+    the order they were received. The handler owns the message and must
+    release it using MqttDispatch_MsgFree once done (it may be kept after
+    returning).
+ *  \param      msg         Pointer to dispatched message
+ *  \param      ctx         Pointer to user context
+ *  \return     MQTT_CODE_SUCCESS or error. An error is returned to the
+                reading thread on the next received message, which causes a
+                net disconnect.
+ */
+typedef int (*MqttDispatchCb)(MqttDispatchMsg* msg, void* ctx);
+
+/* Single producer / single consumer lock-free message ring */
+typedef struct _MqttDispatchRing {
+    MqttDispatchMsg **slots;
+    word32      mask;
+    byte        pad0[MQTT_DISPATCH_CACHE_LINE];
+    word32      head;           /* next read slot, set by consumer only */
+    byte        pad1[MQTT_DISPATCH_CACHE_LINE];
+    word32      tail;           /* next write slot, set by producer only */
+    byte        pad2[MQTT_DISPATCH_CACHE_LINE];
+} MqttDispatchRing;
+
+typedef struct _MqttDispatchWorker {
+    struct _MqttDispatch *disp;
+    MqttDispatchRing ring;
+    wm_Sem      dataSig;        /* signaled when a message is queued */
+    wm_Sem      spaceSig;       /* signaled when a queue slot is freed */
+    int         idleWait;       /* worker is waiting for data */
+    int         fullWait;       /* producer is waiting for space */
+    word32      count;          /* number of messages handled */
+    wm_Thread   thread;
+    byte        started;
+} MqttDispatchWorker;
+
+typedef struct _MqttDispatch {
+    MqttDispatchWorker *workers;
+    int         worker_count;
+    MqttDispatchCb cb;
+    void       *ctx;
+
+    MqttDispatchMsg *cur;       /* message being assembled by reader */
+    word32      cur_hash;
+    int         running;
+    int         error;          /* first error returned by a handler */
+} MqttDispatch;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes the dispatcher and starts the worker threads
+ *  \param      disp        Pointer to MqttDispatch structure
+                            (uninitialized is okay)
+ *  \param      worker_count
+                            Number of worker threads
+                            (1 - MQTT_DISPATCH_MAX_WORKERS)
+ *  \param      depth       Per worker queue depth (power of two). Zero uses
+                            MQTT_DISPATCH_DEF_DEPTH. The reading thread
+                            waits when the queue of a worker is full.
+ *  \param      cb          Message handler
+ *  \param      ctx         Pointer to user context for the handler
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttDispatch_Init(
+    MqttDispatch *disp,
+    int worker_count,
+    int depth,
+    MqttDispatchCb cb,
+    void *ctx);
+
+/*! \brief      Stops the worker threads after all queued messages have been
+                handled and releases the dispatcher resources. The client
+                must no longer be reading when this is called.
+ *  \param      disp        Pointer to MqttDispatch structure
+ */
+WOLFMQTT_API void MqttDispatch_Free(MqttDispatch *disp);
+
+/*! \brief      Queues an incoming publish to a worker. This is called by
+                the client for each message callback once a dispatcher is
+                set using MqttClient_SetDispatch. The payload is copied out
+                of the receive buffer so the reader can continue.
+ *  \param      disp        Pointer to MqttDispatch structure
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      msg         Pointer to received message
+ *  \param      msg_new     If non-zero value then message is new
+ *  \param      msg_done    If non-zero value then message is complete
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttDispatch_Message(
+    MqttDispatch *disp,
+    struct _MqttClient *client,
+    MqttMessage *msg,
+    byte msg_new,
+    byte msg_done);
+
+/*! \brief      Releases a dispatched message
+ *  \param      msg         Pointer to dispatched message
+ */
+WOLFMQTT_API void MqttDispatch_MsgFree(MqttDispatchMsg *msg);
+
+#endif /* WOLFMQTT_DISPATCH */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_DISPATCH_H */
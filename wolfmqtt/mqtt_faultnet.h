@@ -0,0 +1,144 @@
+/* mqtt_faultnet.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_FAULTNET_H
+#define WOLFMQTT_FAULTNET_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_socket.h"
+
+#ifdef WOLFMQTT_FAULTNET
+
+/* Received data held until it is due, at most one read of the inner
+ * network (a datagram must fit) */
+#ifndef MQTT_FAULTNET_STAGE_SIZE
+#define MQTT_FAULTNET_STAGE_SIZE    2048
+#endif
+
+/* Faults to inject, zero for none */
+typedef struct _MqttFaultCfg {
+    word32      latency_ms;     /* delay of received data */
+    word32      jitter_ms;      /* random extra delay, up to */
+    word32      rate;           /* bytes per second each way */
+    word32      max_write;      /* most bytes per write (partial writes) */
+    word32      max_read;       /* most bytes per read */
+    word16      loss_permille;  /* datagrams dropped each way */
+    byte        datagram;       /* inner network is datagrams (MQTT-SN) */
+    word32      break_after_ms;     /* connection breaks after, each time */
+    word32      break_after_bytes;  /* read and written */
+    byte        silent_break;   /* a break drops the data, no close seen */
+    word32      seed;           /* of the random faults */
+} MqttFaultCfg;
+
+/* Counters of the wrapper */
+typedef struct _MqttFaultStats {
+    word32      rx_bytes;
+    word32      tx_bytes;
+    word32      delayed;        /* reads held for latency or rate */
+    word32      dropped;        /* datagrams lost */
+    word32      connects;
+    word32      breaks;
+    word32      break_ms;       /* time of the last break */
+} MqttFaultStats;
+
+/* Wrapper of a network, the context of its network callbacks */
+typedef struct _MqttFaultNet {
+    MqttNet    *inner;
+    MqttFaultCfg cfg;
+    MqttFaultStats stats;
+    word32      rand;
+    word32      connect_ms;
+    word32      conn_bytes;     /* since the connect */
+    word32      last_arrival;
+    word32      last_due;
+    word32      rx_epoch;       /* rate limit of each way */
+    word32      rx_epoch_bytes;
+    word32      tx_epoch;
+    word32      tx_epoch_bytes;
+    word32      stage_due;
+    int         stage_len;
+    int         stage_pos;
+    byte        nonblock;       /* return MQTT_CODE_CONTINUE, not sleep */
+    byte        broken;         /* 1 closed, 2 silent */
+    byte        drained;        /* data read next from the inner network is
+                                   new, not queued behind the last */
+    byte        gated;          /* peeked datagram: 1 waits for stage_due,
+                                   2 is due */
+    byte        stage[MQTT_FAULTNET_STAGE_SIZE];
+} MqttFaultNet;
+
+
+/* Application Interfaces */
+
+/*! \brief      Sets network callbacks that inject faults into another
+                network: a socket, the in-memory transport or another
+                wrapper.
+ *  \note       Latency, jitter and the rate limit delay the data read, so
+                they add to the round trip. The rate limit also spaces the
+                writes. A read or write waiting for them sleeps until the
+                timeout, or returns MQTT_CODE_CONTINUE in a non-blocking
+                build: held data does not make the socket readable again,
+                so an event loop checks MqttFaultNet_Held. Partial reads and
+                writes apply to streams, loss to datagrams. On a break the
+                inner network is disconnected and reads and writes return
+                MQTT_CODE_ERROR_NETWORK until the next connect. On a silent
+                break writes are dropped and reads time out, so only the
+                keep alive finds it.
+ *  \param      net         Pointer to MqttNet structure to set
+ *  \param      fault       Pointer to MqttFaultNet structure, the context of
+                            the callbacks
+ *  \param      inner       Pointer to initialized MqttNet structure of the
+                            network to wrap, kept until the wrapper is unused
+ *  \param      cfg         Faults to inject, copied
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG (a delay on a
+                platform with no clock)
+ */
+WOLFMQTT_API int MqttFaultNet_Init(
+    MqttNet *net,
+    MqttFaultNet *fault,
+    MqttNet *inner,
+    const MqttFaultCfg *cfg);
+
+/*! \brief      Breaks the connection now, as a failure of the network
+ *  \param      fault       Pointer to MqttFaultNet structure
+ *  \param      silent      1 drops the data with no close seen, as a lost
+                            route, 0 closes the connection
+ */
+WOLFMQTT_API void MqttFaultNet_Break(MqttFaultNet *fault, int silent);
+
+/*! \brief      Returns the number of bytes read from the inner network and
+                held for latency or rate
+ *  \param      fault       Pointer to MqttFaultNet structure
+ *  \return     Bytes held, returned by the next reads once due
+ */
+WOLFMQTT_API int MqttFaultNet_Held(MqttFaultNet *fault);
+
+#endif /* WOLFMQTT_FAULTNET */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_FAULTNET_H */
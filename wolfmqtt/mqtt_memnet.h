@@ -0,0 +1,153 @@
+/* mqtt_memnet.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_MEMNET_H
+#define WOLFMQTT_MEMNET_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_socket.h"
+
+#ifdef WOLFMQTT_MEMNET
+
+/* Default size of each ring of a pipe (must be power of two) */
+#ifndef MQTT_MEMNET_DEF_SIZE
+#define MQTT_MEMNET_DEF_SIZE        (64 * 1024)
+#endif
+
+/* Used to keep the ring reader and writer indexes on separate lines */
+#ifndef MQTT_MEMNET_CACHE_LINE
+#define MQTT_MEMNET_CACHE_LINE      64
+#endif
+
+/* Ends of a pipe */
+enum MqttMemNetSide {
+    MQTT_MEMNET_SIDE_CLIENT = 0,
+    MQTT_MEMNET_SIDE_PEER = 1
+};
+
+/* Single reader / single writer lock-free byte ring */
+typedef struct _MqttMemRing {
+    byte       *buf;
+    word32      mask;
+    byte        pad0[MQTT_MEMNET_CACHE_LINE];
+    word32      head;           /* next read position, set by reader only */
+    byte        pad1[MQTT_MEMNET_CACHE_LINE];
+    word32      tail;           /* next write position, set by writer only */
+    byte        pad2[MQTT_MEMNET_CACHE_LINE];
+} MqttMemRing;
+
+/* Connection between a client and a peer, one ring each way */
+typedef struct _MqttMemPipe {
+    MqttMemRing ring[2];        /* indexed by the writing side */
+    int         closed;         /* set by a disconnect of either side */
+} MqttMemPipe;
+
+/*! \brief      Called when a read finds no data or a write finds no room.
+                It may run the peer, in a single thread, or yield to it.
+ *  \param      ctx         Context given to MqttMemNet_Init
+ *  \param      timeout_ms  Timeout of the read or write
+ *  \param      waits       Number of calls before this one for the same
+                            read or write
+ *  \return     MQTT_CODE_SUCCESS to check the ring again, or the code to
+                return from the read or write (for example
+                MQTT_CODE_ERROR_TIMEOUT or MQTT_CODE_CONTINUE)
+ */
+typedef int (*MqttMemNetWaitCb)(void *ctx, int timeout_ms, word32 waits);
+
+/* One end of a pipe, the context of its network callbacks */
+typedef struct _MqttMemNet {
+    MqttMemPipe *pipe;
+    MqttMemRing *rx;
+    MqttMemRing *tx;
+    MqttMemNetWaitCb wait_cb;
+    void       *wait_ctx;
+    byte        nonblock;       /* return MQTT_CODE_CONTINUE, not wait */
+
+    word32      rx_bytes;
+    word32      tx_bytes;
+    word32      waits;          /* reads and writes that found the ring
+                                   empty or full */
+} MqttMemNet;
+
+
+/* Application Interfaces */
+
+/*! \brief      Allocates the rings of a pipe
+ *  \param      pipe        Pointer to MqttMemPipe structure
+                            (uninitialized is okay)
+ *  \param      size        Bytes of each ring, power of two. Zero uses
+                            MQTT_MEMNET_DEF_SIZE.
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttMemNet_PipeInit(
+    MqttMemPipe *pipe,
+    word32 size);
+
+/*! \brief      Releases the rings of a pipe. Neither side may use it after.
+ *  \param      pipe        Pointer to MqttMemPipe structure
+ */
+WOLFMQTT_API void MqttMemNet_PipeFree(MqttMemPipe *pipe);
+
+/*! \brief      Sets the network callbacks of one end of a pipe, in place of
+                a socket. Each end may be used by one reading and one
+                writing thread, the other end by other threads.
+ *  \note       When a read finds no data (or a write no room) wait_cb is
+                called. Without it a non-blocking end returns
+                MQTT_CODE_CONTINUE and a blocking one yields to the other
+                threads until timeout_ms, then returns
+                MQTT_CODE_ERROR_TIMEOUT. Once either end disconnects, reads
+                return the data left then MQTT_CODE_ERROR_NETWORK. The pipe
+                is a byte stream: the peek callback for MQTT-SN is not set.
+ *  \param      net         Pointer to MqttNet structure to set
+ *  \param      mem         Pointer to MqttMemNet structure, the context of
+                            the callbacks
+ *  \param      pipe        Pointer to initialized MqttMemPipe structure
+ *  \param      side        MQTT_MEMNET_SIDE_CLIENT or MQTT_MEMNET_SIDE_PEER
+ *  \param      wait_cb     Optional wait callback
+ *  \param      wait_ctx    Context passed to wait_cb
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttMemNet_Init(
+    MqttNet *net,
+    MqttMemNet *mem,
+    MqttMemPipe *pipe,
+    byte side,
+    MqttMemNetWaitCb wait_cb,
+    void *wait_ctx);
+
+/*! \brief      Returns the number of bytes ready to read
+ *  \param      mem         Pointer to MqttMemNet structure
+ *  \return     Bytes written by the other end and not read yet
+ */
+WOLFMQTT_API word32 MqttMemNet_Pending(MqttMemNet *mem);
+
+#endif /* WOLFMQTT_MEMNET */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_MEMNET_H */
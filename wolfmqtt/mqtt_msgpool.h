@@ -0,0 +1,120 @@
+/* mqtt_msgpool.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_MSGPOOL_H
+#define WOLFMQTT_MSGPOOL_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_packet.h"
+
+#ifdef WOLFMQTT_MSG_POOL
+
+struct _MqttMsgPool;
+
+/* Pooled receive buffer. When retained it describes the message that was
+ * received into it. The topic and payload reference the buffer data and
+ * are valid until the last reference is released. */
+typedef struct _MqttMsgBuf {
+    struct _MqttMsgPool *pool;
+    struct _MqttMsgBuf  *next;  /* free list */
+    int         refs;
+    byte       *data;
+
+    word16      packet_id;
+    MqttQoS     qos;
+    byte        retain;
+    byte        duplicate;
+    const char *topic_name;     /* not null terminated */
+    word16      topic_name_len;
+    byte       *buffer;         /* Complete payload */
+    word32      total_len;      /* Payload length */
+} MqttMsgBuf;
+
+typedef struct _MqttMsgPool {
+    MqttMsgBuf *bufs;
+    byte       *mem;
+    int         count;
+    int         buf_len;
+    MqttMsgBuf *free_list;
+    int         free_count;
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_Sem      lock;
+#endif
+} MqttMsgPool;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes a pool of receive buffers. All memory is
+                allocated here, buffers are recycled after that.
+ *  \param      pool        Pointer to MqttMsgPool structure
+                            (uninitialized is okay)
+ *  \param      count       Number of buffers (minimum 2). One is used by
+                            the client for reading, the rest can be retained
+                            by the application.
+ *  \param      buf_len     Size of each buffer, which is the client receive
+                            buffer size
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttMsgPool_Init(
+    MqttMsgPool *pool,
+    int count,
+    int buf_len);
+
+/*! \brief      Releases the pool memory. The pool must no longer be set on
+                a client and all retained buffers must be released.
+ *  \param      pool        Pointer to MqttMsgPool structure
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_STAT if buffers are
+                still in use
+ */
+WOLFMQTT_API int MqttMsgPool_Free(MqttMsgPool *pool);
+
+/*! \brief      Gets a free buffer with a single reference
+ *  \param      pool        Pointer to MqttMsgPool structure
+ *  \return     Pointer to buffer or NULL if none are free
+ */
+WOLFMQTT_API MqttMsgBuf* MqttMsgPool_Get(MqttMsgPool *pool);
+
+/*! \brief      Adds a reference to a buffer, for example when the message is
+                passed to more than one consumer
+ *  \param      buf         Pointer to MqttMsgBuf
+ */
+WOLFMQTT_API void MqttMsgBuf_Retain(MqttMsgBuf *buf);
+
+/*! \brief      Releases a reference to a buffer. The buffer is returned to
+                the pool when the last reference is released. Safe to call
+                from any thread.
+ *  \param      buf         Pointer to MqttMsgBuf
+ */
+WOLFMQTT_API void MqttMsgBuf_Release(MqttMsgBuf *buf);
+
+#endif /* WOLFMQTT_MSG_POOL */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_MSGPOOL_H */
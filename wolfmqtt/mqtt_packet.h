@@ -33,6 +33,7 @@
 
 #include "wolfmqtt/mqtt_types.h"
 #include "wolfmqtt/mqtt_socket.h"
+#include "wolfmqtt/mqtt_utf8.h"
 
 
 /* Size of a data length elements in protocol */
@@ -122,6 +123,29 @@ typedef struct _MqttProp {
     struct _MqttProp_Str data_str2;
 } MqttProp;
 
+/* Property view. Location of received properties in the packet buffer,
+ * which are decoded one at a time on demand (no allocation). Only valid
+ * until the client reads the next packet. */
+typedef struct _MqttPropView {
+    byte       *buf;        /* first property */
+    word32      len;        /* length of all properties */
+    word32      pos;        /* iterator position */
+    byte        packet;     /* MqttPacketType */
+} MqttPropView;
+
+/* Property arena. Allocates properties from caller supplied storage with no
+ * locking. Properties are added in O(1) to the end of the list being built
+ * and all are released together once every list taken from it is freed (or
+ * the arena is reset). Not thread safe, use one arena per thread or client. */
+typedef struct _MqttPropArena {
+    MqttProp   *props;      /* storage */
+    MqttProp   *head;       /* list currently being built */
+    MqttProp   *tail;       /* last property added to head */
+    word16      count;      /* number of elements in storage */
+    word16      used;       /* next unused element */
+    word16      active;     /* elements allocated and not yet freed */
+} MqttPropArena;
+
 /* REASON CODES */
 enum MqttReasonCodes {
     MQTT_REASON_SUCCESS = 0x00,
@@ -186,6 +210,25 @@ typedef enum _MqttQoS {
 } MqttQoS;
 
 
+#ifdef WOLFMQTT_SUBTRIE
+struct _MqttClient;
+struct _MqttMessage;
+
+/*! \brief      Topic filter handler, called for each received publish
+                message that matches the filter (see MqttClient_SetSubTrie).
+                The arguments are those of MqttMsgCb, with the handler
+                context.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      msg         Pointer to received message
+ *  \param      msg_new     If non-zero value then message is new
+ *  \param      msg_done    If non-zero value then message is complete
+ *  \param      ctx         Pointer to handler context
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+ */
+typedef int (*MqttTopicCb)(struct _MqttClient *client,
+    struct _MqttMessage *msg, byte msg_new, byte msg_done, void *ctx);
+#endif
+
 /* Topic */
 typedef struct _MqttTopic {
     const char* topic_filter;
@@ -196,6 +239,13 @@ typedef struct _MqttTopic {
 #ifdef WOLFMQTT_V5
     word16      alias;
 #endif
+#ifdef WOLFMQTT_SUBTRIE
+    /* Optional handler registered in the client subscription trie once
+       the subscribe is accepted, and removed on unsubscribe */
+    MqttTopicCb cb;
+    void       *cb_ctx;
+    byte        cb_added; /* Internal: filter was new to the trie */
+#endif
 } MqttTopic;
 
 /* Topic naming */
@@ -295,6 +345,10 @@ typedef struct _MqttMsgStat {
 
     byte isReadActive:1;
     byte isWriteActive:1;
+#ifdef WOLFMQTT_SN_RETRY
+    byte retries;       /* times the request was sent again */
+    word32 sent_ms;     /* time the request was last sent */
+#endif
 } MqttMsgStat;
 
 #ifdef WOLFMQTT_MULTITHREAD
@@ -319,7 +373,7 @@ typedef struct _MqttPendResp {
 /* CONNECT PACKET */
 /* Connect flag bit-mask: Located in byte 8 of the MqttConnect packet */
 #define MQTT_CONNECT_FLAG_GET_QOS(flags) \
-    (((flags) MQTT_CONNECT_FLAG_WILL_QOS_MASK) >> \
+    (((flags) & MQTT_CONNECT_FLAG_WILL_QOS_MASK) >> \
         MQTT_CONNECT_FLAG_WILL_QOS_SHIFT)
 #define MQTT_CONNECT_FLAG_SET_QOS(qos) \
     (((qos) << MQTT_CONNECT_FLAG_WILL_QOS_SHIFT) & \
@@ -401,6 +455,7 @@ typedef struct _MqttConnectAck {
 #ifdef WOLFMQTT_V5
     MqttProp* props;
     byte protocol_level;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 #endif
 } MqttConnectAck;
 /* Connect Ack has no payload */
@@ -435,6 +490,7 @@ typedef struct _MqttConnect {
 
 #ifdef WOLFMQTT_V5
     MqttProp* props;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 #endif
 } MqttConnect;
 
@@ -463,9 +519,27 @@ typedef struct _MqttPublishResp {
     byte reason_code;
     MqttProp* props;
     byte protocol_level;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 #endif
 } MqttPublishResp;
 
+/* PUBLISH TEMPLATE */
+/* Pre-encoded variable header for a topic that is published repeatedly. The
+ * buffer holds the encoded topic followed by the property length and
+ * properties (v5). The packet ID is inserted between them when sending. */
+typedef struct _MqttPublishTemplate {
+    byte       *buf;          /* Encoded variable header (without packet ID) */
+    word32      len;          /* Length of encoded variable header */
+    word32      topic_len;    /* Length of encoded topic (including length) */
+    const char *topic_name;
+    MqttQoS     qos;
+    byte        retain;
+    byte        type_flags;   /* Encoded fixed header type and flags */
+#ifdef WOLFMQTT_V5
+    byte        protocol_level;
+#endif
+} MqttPublishTemplate;
+
 /* PUBLISH */
 /* PacketId sent only if QoS > 0 */
 typedef struct _MqttMessage {
@@ -499,11 +573,15 @@ typedef struct _MqttMessage {
 
     void*       ctx;          /* user supplied context for publish callbacks */
 
+    /* Optional pre-encoded topic, QoS and properties (publish only) */
+    MqttPublishTemplate *tmpl;
+
     MqttPublishResp resp;
 
 #ifdef WOLFMQTT_V5
     MqttProp* props;
     byte protocol_level;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 #endif
 } MqttMessage;
 typedef MqttMessage MqttPublish; /* Publish is message */
@@ -523,9 +601,16 @@ typedef struct _MqttSubscribeAck {
 
     word16      packet_id;
     byte        return_codes[MAX_MQTT_TOPICS];
+
+    /* Optional: also stores the return code for each topic in
+       topics[i].return_code, without the MAX_MQTT_TOPICS limit. Must be
+       NULL or point to topic_count topics (zero the struct before decode) */
+    MqttTopic  *topics;
+    int         topic_count;
 #ifdef WOLFMQTT_V5
     MqttProp* props;
     byte protocol_level;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 #endif
 } MqttSubscribeAck;
 
@@ -547,9 +632,47 @@ typedef struct _MqttSubscribe {
 #ifdef WOLFMQTT_V5
     MqttProp* props;
     byte protocol_level;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 #endif
 } MqttSubscribe;
 
+/* Subscribe packet in flight for MqttClient_SubscribeBulk */
+typedef struct _MqttBulkPacket {
+    MqttSubscribeAck ack;
+#ifdef WOLFMQTT_MULTITHREAD
+    MqttPendResp pendResp;
+#endif
+    word16      packet_id;
+    int         topic_first; /* Index of first topic in this packet */
+    int         topic_count; /* 0 = slot is free */
+} MqttBulkPacket;
+
+/* Bulk subscribe: topic list split into as many SUBSCRIBE packets as needed,
+    with up to packet_max packets in flight. Zero the structure (and packets)
+    before setting the inputs, the internal state must start cleared. */
+typedef struct _MqttSubscribeBulk {
+    MqttMsgStat stat; /* must be first member at top */
+
+    MqttTopic  *topics;      /* Return codes are stored in each topic */
+    int         topic_count;
+    MqttBulkPacket *packets; /* Window of packets in flight */
+    int         packet_max;
+    word16      packet_id;   /* First packet ID, incremented per packet */
+    word32      max_packet_size; /* 0 = limited by tx_buf_len only */
+#ifdef WOLFMQTT_V5
+    MqttProp* props;         /* Properties sent with each packet */
+#endif
+
+    /* Results */
+    int         packet_count; /* Number of SUBSCRIBE packets sent */
+    int         fail_count;   /* Number of topics rejected by broker */
+
+    /* Internal state */
+    int         topic_next;
+    int         pending;
+    MqttSubscribeAck ack;
+} MqttSubscribeBulk;
+
 
 /* UNSUBSCRIBE RESPONSE ACK */
 /* No response payload (besides packet Id) */
@@ -561,6 +684,7 @@ typedef struct _MqttUnsubscribeAck {
     MqttProp* props;
     byte*     reason_codes;
     byte protocol_level;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 #endif
 } MqttUnsubscribeAck;
 
@@ -582,6 +706,7 @@ typedef struct _MqttUnsubscribe {
 #ifdef WOLFMQTT_V5
     MqttProp* props;
     byte protocol_level;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 #endif
 } MqttUnsubscribe;
 
@@ -605,6 +730,7 @@ typedef struct _MqttDisconnect {
     byte reason_code;
     MqttProp* props;
     byte protocol_level;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 #endif
 } MqttDisconnect;
 
@@ -620,6 +746,7 @@ typedef struct _MqttAuth {
 
     byte        reason_code;
     MqttProp*   props;
+    MqttPropView props_view; /* Received properties (in rx_buf) */
 } MqttAuth;
 #endif
 
@@ -661,6 +788,7 @@ WOLFMQTT_LOCAL int MqttEncode_Int(byte* buf, word32 len);
 WOLFMQTT_LOCAL int MqttDecode_String(byte *buf, const char **pstr,
     word16 *pstr_len);
 WOLFMQTT_LOCAL int MqttEncode_String(byte *buf, const char *str);
+WOLFMQTT_LOCAL int MqttEncode_Topic(byte *buf, const char *str, byte flags);
 
 WOLFMQTT_LOCAL int MqttEncode_Data(byte *buf, const byte *data,
     word16 data_len);
@@ -675,6 +803,8 @@ WOLFMQTT_LOCAL int MqttDecode_ConnectAck(byte *rx_buf, int rx_buf_len,
     MqttConnectAck *connect_ack);
 WOLFMQTT_LOCAL int MqttEncode_Publish(byte *tx_buf, int tx_buf_len,
     MqttPublish *publish, byte use_cb);
+WOLFMQTT_LOCAL int MqttEncode_PublishTemplate(MqttPublishTemplate *tmpl,
+    MqttPublish *publish, byte *buf, int buf_len);
 WOLFMQTT_LOCAL int MqttDecode_Publish(byte *rx_buf, int rx_buf_len,
     MqttPublish *publish);
 WOLFMQTT_LOCAL int MqttEncode_PublishResp(byte* tx_buf, int tx_buf_len,
@@ -694,6 +824,24 @@ WOLFMQTT_LOCAL int MqttDecode_Ping(byte *rx_buf, int rx_buf_len, MqttPing* ping)
 WOLFMQTT_LOCAL int MqttEncode_Disconnect(byte *tx_buf, int tx_buf_len,
     MqttDisconnect* disc);
 
+#ifdef WOLFMQTT_BROKER
+/* Broker side of the protocol. The decoders terminate the strings they
+   return in place in rx_buf, so a packet is decoded only once. */
+WOLFMQTT_LOCAL int MqttDecode_Connect(byte *rx_buf, int rx_buf_len,
+    MqttConnect *mc_connect);
+WOLFMQTT_LOCAL int MqttEncode_ConnectAck(byte *tx_buf, int tx_buf_len,
+    MqttConnectAck *connect_ack);
+WOLFMQTT_LOCAL int MqttDecode_Subscribe(byte *rx_buf, int rx_buf_len,
+    MqttSubscribe *subscribe);
+WOLFMQTT_LOCAL int MqttEncode_SubscribeAck(byte *tx_buf, int tx_buf_len,
+    MqttSubscribe *subscribe);
+WOLFMQTT_LOCAL int MqttDecode_Unsubscribe(byte *rx_buf, int rx_buf_len,
+    MqttUnsubscribe *unsubscribe);
+WOLFMQTT_LOCAL int MqttEncode_UnsubscribeAck(byte *tx_buf, int tx_buf_len,
+    MqttUnsubscribe *unsubscribe);
+WOLFMQTT_LOCAL int MqttEncode_PingResp(byte *tx_buf, int tx_buf_len);
+#endif
+
 #ifdef WOLFMQTT_V5
 WOLFMQTT_LOCAL int MqttDecode_Disconnect(byte *rx_buf, int rx_buf_len,
     MqttDisconnect *disc);
@@ -703,12 +851,25 @@ WOLFMQTT_LOCAL int MqttEncode_Auth(byte *tx_buf, int tx_buf_len,
     MqttAuth *auth);
 WOLFMQTT_LOCAL int MqttEncode_Props(MqttPacketType packet, MqttProp* props,
     byte* buf);
-WOLFMQTT_LOCAL int MqttDecode_Props(MqttPacketType packet, MqttProp** props,
-    byte* buf, word32 buf_len, word32 prop_len);
+WOLFMQTT_LOCAL int MqttDecode_Props(MqttPacketType packet,
+    MqttPropArena* arena, MqttProp** props, byte* buf, word32 buf_len,
+    word32 prop_len);
+WOLFMQTT_LOCAL int MqttDecode_PropsView(MqttPacketType packet,
+    MqttPropView* view, byte* buf, word32 buf_len, word32 prop_len);
+WOLFMQTT_LOCAL int MqttProps_ViewNext(MqttPropView *view, MqttProp *prop);
+WOLFMQTT_LOCAL int MqttProps_ViewFind(MqttPropView *view,
+    MqttPropertyType type, MqttProp *prop);
+WOLFMQTT_LOCAL int MqttProps_ViewValidate(MqttPropView *view);
 WOLFMQTT_LOCAL int MqttProps_Init(void);
 WOLFMQTT_LOCAL int MqttProps_ShutDown(void);
 WOLFMQTT_LOCAL MqttProp* MqttProps_Add(MqttProp **head);
 WOLFMQTT_LOCAL int MqttProps_Free(MqttProp *head);
+WOLFMQTT_LOCAL int MqttProps_ArenaInit(MqttPropArena *arena, MqttProp *props,
+    int count);
+WOLFMQTT_LOCAL MqttProp* MqttProps_ArenaAdd(MqttPropArena *arena,
+    MqttProp **head);
+WOLFMQTT_LOCAL int MqttProps_ArenaFree(MqttPropArena *arena, MqttProp *head);
+WOLFMQTT_LOCAL void MqttProps_ArenaReset(MqttPropArena *arena);
 WOLFMQTT_LOCAL MqttProp* MqttProps_FindType(MqttProp *head,
     MqttPropertyType type);
 #endif
@@ -123,6 +123,46 @@ WOLFMQTT_API int SN_Client_SetRegisterCallback(
     SN_ClientRegisterCb regCb,
     void* ctx);
 
+#ifdef WOLFMQTT_SN_REGISTRY
+/*! \brief      Sets a topic registry. A publish may then give the topic
+                name, with topic_type SN_TOPIC_ID_TYPE_NAME: a two character
+                name is sent as a short topic, others with the registered or
+                predefined topic ID. A name without an ID is registered with
+                the gateway first. After a connect is accepted the topics
+                without an ID are registered together, several REGISTER
+                packets at a time. The topic IDs from REGACK, SUBACK and
+                gateway REGISTER packets are recorded, and a received publish
+                with a known topic ID is given to the message callback with
+                the topic name (topic_type SN_TOPIC_ID_TYPE_NAME, the name is
+                not null terminated for short topics).
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      reg         Pointer to initialized SN_TopicRegistry, or NULL
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int SN_Client_SetRegistry(
+    MqttClient *client,
+    SN_TopicRegistry *reg);
+#endif
+
+#ifdef WOLFMQTT_SN_RETRY
+/*! \brief      Sets a retransmission timer. CONNECT (without a will),
+                REGISTER, SUBSCRIBE and QoS 1 and 2 PUBLISH packets not
+                answered within the retransmission timeout are then sent
+                again, with the DUP flag on SUBSCRIBE and PUBLISH, until
+                max_retry of the timer is reached and the request returns
+                MQTT_CODE_ERROR_TIMEOUT. The timeout is estimated from the
+                round trip times of the requests, replacing cmd_timeout_ms
+                for them.
+ *  \note       A lost PUBREL is recovered by sending the PUBLISH again,
+                so the gateway answers it with PUBREC.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      retry       Pointer to initialized SN_Retry, or NULL
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int SN_Client_SetRetry(
+    MqttClient *client,
+    SN_Retry *retry);
+#endif
 
 /*! \brief      Encodes and sends the MQTT-SN Publish packet and waits for the
                 Publish response (if QoS > 0).
@@ -136,12 +176,66 @@ WOLFMQTT_API int SN_Client_SetRegisterCallback(
  *                          Note: SN_Publish and MqttMessage are same
                             structure.
  *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
-                (see enum MqttPacketResponseCodes)
+                (see enum MqttPacketResponseCodes). With a topic registry,
+                MQTT_CODE_ERROR_NOT_FOUND when the gateway did not register
+                the topic name.
  */
 WOLFMQTT_API int SN_Client_Publish(
     MqttClient *client,
     SN_Publish *publish);
 
+#ifdef WOLFMQTT_SN_WINDOW
+/*! \brief      Sets a publish window, used by SN_Client_PublishAsync. Replace
+                a window only when it has no outstanding publishes.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      win         Pointer to initialized SN_PubWindow, or NULL
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int SN_Client_SetPubWindow(
+    MqttClient *client,
+    SN_PubWindow *win);
+
+/*! \brief      Encodes and sends the MQTT-SN Publish packet without waiting
+                for the Publish response. A QoS 1 or 2 publish is kept in the
+                window until its PUBACK or PUBCOMP, or until given up, and
+                then passed to the window callback. When the window is full,
+                packets are read (as in SN_Client_WaitMessage) until one
+                completes. QoS 0 and -1 publishes are sent as with
+                SN_Client_Publish.
+ *  \note       Acknowledgments are handled by any call reading packets,
+                such as SN_Client_WaitMessage. The window callback is called
+                from it and must not wait for packets. With a retransmission
+                timer (SN_Client_SetRetry), publishes are sent again while
+                SN_Client_PublishAsync or SN_Client_PublishFlush wait.
+                Without one, all outstanding publishes are given up when
+                nothing is received for cmd_timeout_ms while waiting.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      publish     Pointer to SN_Publish structure initialized
+                            with message data, which must stay valid until
+                            its callback. A packet_id of 0 is given a free
+                            packet ID.
+ *  \return     MQTT_CODE_SUCCESS once sent or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes). MQTT_CODE_ERROR_PACKET_ID
+                when the packet ID is outstanding. On an error the publish
+                is not in the window.
+ */
+WOLFMQTT_API int SN_Client_PublishAsync(
+    MqttClient *client,
+    SN_Publish *publish);
+
+/*! \brief      Reads packets until all publishes of the window are
+                completed.
+ *  \param      client      Pointer to MqttClient structure
+ *  \return     MQTT_CODE_SUCCESS when none is outstanding (those given up
+                are reported to the callback) or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes). Without a retransmission
+                timer, MQTT_CODE_ERROR_TIMEOUT when nothing was received for
+                cmd_timeout_ms.
+ */
+WOLFMQTT_API int SN_Client_PublishFlush(
+    MqttClient *client);
+#endif
+
 /*! \brief      Encodes and sends the MQTT-SN Subscribe packet and waits for the
                 Subscribe Acknowledgment packet containing the assigned
                 topic ID.
@@ -185,7 +279,9 @@ WOLFMQTT_API int SN_Client_Disconnect(
                 send the disconnect with a duration to indicate the client is
                 entering the "asleep" state.
  *  \note This is a non-blocking function that will try and send using
-                MqttNet.write
+                MqttNet.write. With a sleep duration it waits for the
+                Disconnect of the gateway, and with WOLFMQTT_SN_SLEEP the
+                client is then SN_CLIENT_STATE_ASLEEP.
  *  \param      client      Pointer to MqttClient structure
  *  \param      disconnect  Pointer to SN_Disconnect structure. NULL is valid.
  *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
@@ -201,16 +297,36 @@ WOLFMQTT_API int SN_Client_Disconnect_ex(
                 state and wants to notify the gateway that it is entering the
                 "awake" state, it should add it's client ID to the ping
                 request.
+                The gateway then sends the messages buffered while asleep,
+                which arrive via the callback provided in MqttClient_Init
+                before the Ping Response. With WOLFMQTT_SN_SLEEP the client
+                is SN_CLIENT_STATE_AWAKE until then, and back to
+                SN_CLIENT_STATE_ASLEEP after.
  *  \note This is a blocking function that will wait for MqttNet.read
  *  \param      client      Pointer to MqttClient structure
  *  \param      ping        Pointer to SN_PingReq structure. NULL is valid.
  *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
-                (see enum MqttPacketResponseCodes)
+                (see enum MqttPacketResponseCodes).
+                MQTT_CODE_ERROR_NETWORK when awake and the gateway sends a
+                Disconnect instead.
  */
 WOLFMQTT_API int SN_Client_Ping(
     MqttClient *client,
     SN_PingReq *ping);
 
+#ifdef WOLFMQTT_SN_SLEEP
+/*! \brief      Returns the state of the client: active after a connect,
+                asleep after a Disconnect with a sleep duration, awake
+                from a Ping with the client ID until its response, and
+                disconnected after a Disconnect of either side.
+                client->sn_sleep_stats counts the sleeps and wake ups.
+ *  \param      client      Pointer to MqttClient structure
+ *  \return     SN_ClientState or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int SN_Client_GetState(
+    MqttClient *client);
+#endif
+
 /*! \brief      Waits for packets to arrive. Incoming publish messages
                 will arrive via callback provided in MqttClient_Init.
  *  \note This is a blocking function that will wait for MqttNet.read
@@ -0,0 +1,207 @@
+/* mqtt_sn_gateway.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_SN_GATEWAY_H
+#define WOLFMQTT_SN_GATEWAY_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_client.h"
+
+#ifdef WOLFMQTT_SN_GATEWAY
+
+#ifndef WOLFMQTT_SN_REGISTRY
+    #error "WOLFMQTT_SN_GATEWAY requires WOLFMQTT_SN_REGISTRY"
+#endif
+
+/* Largest client network address, such as a struct sockaddr_in6 */
+#ifndef SN_GATEWAY_ADDR_MAX_LEN
+#define SN_GATEWAY_ADDR_MAX_LEN     28
+#endif
+
+/* Most subscriptions of a client */
+#ifndef SN_GATEWAY_MAX_SUBS
+#define SN_GATEWAY_MAX_SUBS         8
+#endif
+
+/* Most upstream MQTT connections */
+#ifndef SN_GATEWAY_MAX_UPSTREAM
+#define SN_GATEWAY_MAX_UPSTREAM     4
+#endif
+
+/* Network address of a client, compared byte for byte */
+typedef struct _SN_GatewayAddr {
+    word16      len;
+    byte        addr[SN_GATEWAY_ADDR_MAX_LEN];
+} SN_GatewayAddr;
+
+/* Receives one datagram and its source address. Returns the length, or
+   MQTT_CODE_ERROR_TIMEOUT when nothing arrived before timeout_ms. */
+typedef int (*SN_GatewayRecvCb)(void *context, byte *buf, int buf_len,
+    SN_GatewayAddr *from, int timeout_ms);
+/* Sends one datagram. Returns the length or a negative error. */
+typedef int (*SN_GatewaySendCb)(void *context, const byte *buf, int buf_len,
+    const SN_GatewayAddr *to);
+
+/* Datagram network of the gateway, one socket for all the clients */
+typedef struct _SN_GatewayNet {
+    void               *context;
+    SN_GatewayRecvCb    recv;
+    SN_GatewaySendCb    send;
+} SN_GatewayNet;
+
+enum SN_GatewayClientState {
+    SN_GW_CLIENT_FREE = 0,
+    SN_GW_CLIENT_ACTIVE,
+    SN_GW_CLIENT_LOST           /* disconnected, session kept */
+};
+
+/* Subscription of a client */
+typedef struct _SN_GatewaySub {
+    char       *filter;         /* topic filter, NULL when free */
+    word16      topic_id;       /* predefined topic ID */
+    byte        topic_type;     /* as subscribed */
+    byte        qos;
+} SN_GatewaySub;
+
+typedef struct _SN_GatewayClient {
+    SN_GatewayAddr addr;
+    word16      addr_chain;     /* next client in address bucket */
+    byte        state;          /* SN_GatewayClientState */
+    byte        clean_session;
+    byte        upstream;       /* index of the upstream connection */
+    word16      keep_alive_sec;
+    word32      last_seen;      /* time of the last packet received */
+    word16      packet_id;      /* last packet ID sent to the client */
+    byte       *known;          /* bit per topic ID given to the client */
+    char        client_id[SN_CLIENTID_MAX_LEN + 1];
+    SN_GatewaySub subs[SN_GATEWAY_MAX_SUBS];
+} SN_GatewayClient;
+
+typedef struct _SN_GatewayStats {
+    word32      publish_up;     /* publishes forwarded upstream */
+    word32      publish_down;   /* publishes forwarded to clients */
+    word32      dropped;        /* packets not handled */
+} SN_GatewayStats;
+
+typedef struct _SN_Gateway {
+    SN_GatewayNet    *net;
+    SN_TopicRegistry *reg;          /* shared by all the clients */
+    SN_GatewayClient *clients;      /* client N is clients[N-1] */
+    word16           *addr_buckets;
+    word32            bucket_mask;
+    word16            max_clients;
+    word16            count;        /* clients with a session */
+    word16            next_topic_id;
+    word32            known_len;    /* bytes of a client topic bitmap */
+    byte             *known;
+    word32            now;          /* seconds, from SN_Gateway_Tick */
+    byte              gw_id;
+
+    MqttClient       *upstream[SN_GATEWAY_MAX_UPSTREAM];
+    word16            upstream_packet_id[SN_GATEWAY_MAX_UPSTREAM];
+    byte              upstream_count;
+
+    SN_GatewayStats   stats;
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_Sem            lock;         /* clients and tx_buf */
+#endif
+    byte              rx_buf[WOLFMQTT_SN_MAXPACKET_SIZE + 1];
+    byte              tx_buf[WOLFMQTT_SN_MAXPACKET_SIZE];
+} SN_Gateway;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes an MQTT-SN gateway. The gateway terminates the
+                SN clients on one datagram network and forwards their
+                packets over the upstream MQTT connections added with
+                SN_Gateway_AddUpstream.
+ *  \param      gw          Pointer to SN_Gateway structure
+                            (uninitialized is okay)
+ *  \param      net         Datagram network callbacks
+ *  \param      reg         Initialized topic registry shared by the
+                            clients. Predefined topics added to it are
+                            known to all the clients. The gateway assigns
+                            the topic IDs of the other topic names.
+ *  \param      max_clients Most clients with a session
+ *  \param      gw_id       Gateway ID sent in GWINFO
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_Gateway_Init(
+    SN_Gateway *gw,
+    SN_GatewayNet *net,
+    SN_TopicRegistry *reg,
+    word16 max_clients,
+    byte gw_id);
+
+/*! \brief      Adds an upstream MQTT connection. Clients are spread over
+                the upstream connections as they connect, and the
+                subscriptions of the clients of a connection are made once
+                on it.
+ *  \note       The gateway sets the message callback and context of the
+                client. The application connects the client to the broker
+                before adding it, and keeps it alive by calling
+                MqttClient_WaitMessage (or MqttClient_Ping) on it.
+ *  \param      gw          Pointer to SN_Gateway structure
+ *  \param      client      Connected MqttClient
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_Gateway_AddUpstream(
+    SN_Gateway *gw,
+    MqttClient *client);
+
+/*! \brief      Waits for one packet from a client and handles it
+ *  \param      gw          Pointer to SN_Gateway structure
+ *  \param      timeout_ms  Milliseconds to wait for a packet
+ *  \return     MQTT_CODE_SUCCESS, MQTT_CODE_ERROR_TIMEOUT or
+                MQTT_CODE_ERROR_* (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_Gateway_Task(
+    SN_Gateway *gw,
+    int timeout_ms);
+
+/*! \brief      Sets the current time, and disconnects the clients not heard
+                from for one and a half keep alive periods
+ *  \param      gw          Pointer to SN_Gateway structure
+ *  \param      now_sec     Current time in seconds, from any start
+ */
+WOLFMQTT_API void SN_Gateway_Tick(
+    SN_Gateway *gw,
+    word32 now_sec);
+
+/*! \brief      Releases the clients, their upstream subscriptions and the
+                gateway memory
+ *  \param      gw          Pointer to SN_Gateway structure
+ */
+WOLFMQTT_API void SN_Gateway_Free(SN_Gateway *gw);
+
+#endif /* WOLFMQTT_SN_GATEWAY */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_SN_GATEWAY_H */
@@ -103,7 +103,10 @@ typedef enum _SN_MsgType {
 enum SN_TopicId_Types {
     SN_TOPIC_ID_TYPE_NORMAL = 0x0,
     SN_TOPIC_ID_TYPE_PREDEF = 0x1,
-    SN_TOPIC_ID_TYPE_SHORT  = 0x2
+    SN_TOPIC_ID_TYPE_SHORT  = 0x2,
+    /* Not sent: topic_name is the topic name, resolved with the topic
+     * registry (WOLFMQTT_SN_REGISTRY) */
+    SN_TOPIC_ID_TYPE_NAME   = 0x3
 };
 
 enum SN_PacketFlags {
@@ -483,6 +486,23 @@ WOLFMQTT_LOCAL int SN_Decode_Ping(byte *rx_buf, int rx_buf_len);
 WOLFMQTT_LOCAL int SN_Packet_Read(struct _MqttClient *client, byte* rx_buf,
         int rx_buf_len, int timeout_ms);
 
+#ifdef WOLFMQTT_SN_GATEWAY
+/* Gateway side */
+WOLFMQTT_LOCAL int SN_Encode_GWInfo(byte *tx_buf, int tx_buf_len, byte gw_id);
+WOLFMQTT_LOCAL int SN_Decode_Connect(byte *rx_buf, int rx_buf_len,
+        SN_Connect *connect);
+WOLFMQTT_LOCAL int SN_Encode_ConnectAck(byte *tx_buf, int tx_buf_len,
+        byte return_code);
+WOLFMQTT_LOCAL int SN_Decode_Subscribe(byte *rx_buf, int rx_buf_len,
+        SN_Subscribe *subscribe);
+WOLFMQTT_LOCAL int SN_Encode_SubscribeAck(byte *tx_buf, int tx_buf_len,
+        SN_SubAck *subscribe_ack);
+WOLFMQTT_LOCAL int SN_Decode_Unsubscribe(byte *rx_buf, int rx_buf_len,
+        SN_Unsubscribe *unsubscribe);
+WOLFMQTT_LOCAL int SN_Encode_UnsubscribeAck(byte *tx_buf, int tx_buf_len,
+        word16 packet_id);
+#endif
+
 #ifndef WOLFMQTT_NO_ERROR_STRINGS
     WOLFMQTT_LOCAL const char* SN_Packet_TypeDesc(SN_MsgType packet_type);
 #else
@@ -0,0 +1,201 @@
+/* mqtt_sn_registry.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_SN_REGISTRY_H
+#define WOLFMQTT_SN_REGISTRY_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_sn_packet.h"
+
+#ifdef WOLFMQTT_SN_REGISTRY
+
+#ifndef WOLFMQTT_SN
+    #error "WOLFMQTT_SN_REGISTRY requires WOLFMQTT_SN"
+#endif
+
+/* Most REGISTER packets sent before waiting for a REGACK */
+#ifndef SN_REGISTRY_WINDOW
+#define SN_REGISTRY_WINDOW      8
+#endif
+
+/* State of a registry topic */
+enum SN_TopicState {
+    SN_TOPIC_STATE_NEW = 0,     /* to be registered with the gateway */
+    SN_TOPIC_STATE_PENDING,     /* REGISTER sent */
+    SN_TOPIC_STATE_REGISTERED,  /* topic ID known */
+    SN_TOPIC_STATE_REJECTED     /* gateway refused, not tried again until
+                                   the next connect */
+};
+
+/* Topic name and ID. Entries are linked by index, where zero is the end of
+ * a list. */
+typedef struct _SN_TopicEntry {
+    char       *name;           /* null terminated, NULL when free */
+    word32      hash;
+    word16      name_len;
+    word16      topic_id;
+    byte        topic_type;     /* SN_TOPIC_ID_TYPE_NORMAL or _PREDEF */
+    byte        state;          /* SN_TopicState */
+    word16      name_chain;     /* next entry in name bucket, or free list */
+    word16      id_chain;       /* next entry in ID bucket */
+} SN_TopicEntry;
+
+/* Topic names and IDs, looked up in both directions */
+typedef struct _SN_TopicRegistry {
+    SN_TopicEntry *entries;     /* entry N is entries[N-1] */
+    word16     *name_buckets;
+    word16     *id_buckets;
+    word32      bucket_mask;
+    word16      capacity;       /* number of entries */
+    word16      used;           /* entries ever used */
+    word16      count;          /* topics in the registry */
+    word16      free_head;      /* removed entries */
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_Sem      lock;           /* topics */
+    wm_Sem      reg_lock;       /* registrations in flight */
+#endif
+
+    /* Registrations in flight */
+    SN_Register regs[SN_REGISTRY_WINDOW];
+    word16      reg_entry[SN_REGISTRY_WINDOW];  /* 0 = slot free */
+    SN_RegAck   regack;         /* any REGACK, when not multithreaded */
+    word16      packet_id;      /* last REGISTER packet ID */
+} SN_TopicRegistry;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes a topic registry. Set it on a client with
+                SN_Client_SetRegistry.
+ *  \param      reg         Pointer to SN_TopicRegistry structure
+                            (uninitialized is okay)
+ *  \param      max_topics  Most topics held
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_TopicRegistry_Init(
+    SN_TopicRegistry *reg,
+    word16 max_topics);
+
+/*! \brief      Releases all topics and the registry memory
+ *  \param      reg         Pointer to SN_TopicRegistry structure
+ */
+WOLFMQTT_API void SN_TopicRegistry_Free(SN_TopicRegistry *reg);
+
+/*! \brief      Adds a topic name. With SN_TOPIC_ID_TYPE_NORMAL the ID is
+                assigned by the gateway: the client registers the topic
+                at the next connect (all new topics together) or before the
+                first publish to it. With SN_TOPIC_ID_TYPE_PREDEF the topic
+                ID is the one predefined with the gateway.
+ *  \param      reg         Pointer to SN_TopicRegistry structure
+ *  \param      name        Topic name (null terminated)
+ *  \param      topic_id    Predefined topic ID (ignored for normal topics)
+ *  \param      topic_type  SN_TOPIC_ID_TYPE_NORMAL or
+                            SN_TOPIC_ID_TYPE_PREDEF
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_TopicRegistry_Add(
+    SN_TopicRegistry *reg,
+    const char *name,
+    word16 topic_id,
+    byte topic_type);
+
+/*! \brief      Removes a topic name
+ *  \param      reg         Pointer to SN_TopicRegistry structure
+ *  \param      name        Topic name (null terminated)
+ *  \return     MQTT_CODE_SUCCESS, MQTT_CODE_ERROR_NOT_FOUND or
+                MQTT_CODE_ERROR_* (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_TopicRegistry_Remove(
+    SN_TopicRegistry *reg,
+    const char *name);
+
+/*! \brief      Finds the topic ID of a topic name
+ *  \param      reg         Pointer to SN_TopicRegistry structure
+ *  \param      name        Topic name
+ *  \param      name_len    Length of name
+ *  \param      topic_id    Set to the topic ID, or 0 when not registered
+ *  \param      topic_type  Set to the topic ID type (may be NULL)
+ *  \return     MQTT_CODE_SUCCESS, MQTT_CODE_ERROR_NOT_FOUND or
+                MQTT_CODE_ERROR_* (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_TopicRegistry_FindName(
+    SN_TopicRegistry *reg,
+    const char *name,
+    word16 name_len,
+    word16 *topic_id,
+    byte *topic_type);
+
+/*! \brief      Finds the topic name of a topic ID
+ *  \param      reg         Pointer to SN_TopicRegistry structure
+ *  \param      topic_id    Topic ID
+ *  \param      topic_type  SN_TOPIC_ID_TYPE_NORMAL or
+                            SN_TOPIC_ID_TYPE_PREDEF
+ *  \param      name        Set to the topic name, valid until the topic is
+                            removed
+ *  \param      name_len    Set to the length of name (may be NULL)
+ *  \return     MQTT_CODE_SUCCESS, MQTT_CODE_ERROR_NOT_FOUND or
+                MQTT_CODE_ERROR_* (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_TopicRegistry_FindId(
+    SN_TopicRegistry *reg,
+    word16 topic_id,
+    byte topic_type,
+    const char **name,
+    word16 *name_len);
+
+
+/* Internal Interfaces */
+
+/* Records the topic ID of a topic name, adding the name if needed (for a
+   REGACK, a REGISTER from the gateway or a SUBACK) */
+WOLFMQTT_LOCAL int SN_TopicRegistry_Set(SN_TopicRegistry *reg,
+    const char *name, word16 name_len, word16 topic_id, byte topic_type);
+/* On connect, marks the normal topics to be registered again: all of them
+   for a clean session (the gateway IDs only last for the session), else
+   those not registered. */
+WOLFMQTT_LOCAL void SN_TopicRegistry_Reset(SN_TopicRegistry *reg,
+    byte clean_session);
+/* Returns the index of the next new topic from index pos (1 based) and
+   marks it pending, or 0 when there is none */
+WOLFMQTT_LOCAL word16 SN_TopicRegistry_NextNew(SN_TopicRegistry *reg,
+    word16 pos);
+/* Sets the result of registering the topic at index: the topic ID when
+   state is SN_TOPIC_STATE_REGISTERED, or SN_TOPIC_STATE_REJECTED, or
+   SN_TOPIC_STATE_NEW to try again */
+WOLFMQTT_LOCAL void SN_TopicRegistry_Registered(SN_TopicRegistry *reg,
+    word16 index, word16 topic_id, byte state);
+/* Returns the state of the topic, adding it as new if not found */
+WOLFMQTT_LOCAL int SN_TopicRegistry_Lookup(SN_TopicRegistry *reg,
+    const char *name, word16 name_len, word16 *topic_id, byte *topic_type);
+
+#endif /* WOLFMQTT_SN_REGISTRY */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_SN_REGISTRY_H */
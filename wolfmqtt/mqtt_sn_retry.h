@@ -0,0 +1,134 @@
+/* mqtt_sn_retry.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_SN_RETRY_H
+#define WOLFMQTT_SN_RETRY_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+
+#ifdef WOLFMQTT_SN_RETRY
+
+#ifndef WOLFMQTT_SN
+    #error "WOLFMQTT_SN_RETRY requires WOLFMQTT_SN"
+#endif
+
+/* Retransmission timeout before the first round trip is measured */
+#ifndef SN_RETRY_RTO_INIT_MS
+#define SN_RETRY_RTO_INIT_MS    1000
+#endif
+
+/* Lowest retransmission timeout */
+#ifndef SN_RETRY_RTO_MIN_MS
+#define SN_RETRY_RTO_MIN_MS     100
+#endif
+
+/* Highest retransmission timeout, also when backed off */
+#ifndef SN_RETRY_RTO_MAX_MS
+#define SN_RETRY_RTO_MAX_MS     60000
+#endif
+
+/* Most retransmissions of a request (Nretry) */
+#ifndef SN_RETRY_MAX
+#define SN_RETRY_MAX            5
+#endif
+
+/* Returns the current time in milliseconds, from any start */
+typedef word32 (*SN_RetryTimeCb)(void *ctx);
+
+typedef struct _SN_RetryStats {
+    word32      samples;        /* round trips measured */
+    word32      retransmits;    /* requests sent again */
+    word32      failures;       /* requests given up after max_retry */
+} SN_RetryStats;
+
+/* Retransmission timer of a client, with the round trip time estimated as
+ * in TCP (RFC 6298) */
+typedef struct _SN_Retry {
+    SN_RetryTimeCb now_ms;
+    void       *ctx;
+    word32      srtt_ms;        /* smoothed round trip time */
+    word32      rttvar_ms;      /* round trip time variation */
+    word32      rto_ms;         /* retransmission timeout (Tretry) */
+    word32      rto_min_ms;
+    word32      rto_max_ms;
+    byte        max_retry;      /* Nretry */
+    byte        has_rtt;        /* srtt_ms and rttvar_ms are set */
+    SN_RetryStats stats;
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_Sem      lock;
+#endif
+} SN_Retry;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes a retransmission timer. Set it on a client with
+                SN_Client_SetRetry. The timeout starts at
+                SN_RETRY_RTO_INIT_MS and follows the measured round trip
+                times, between rto_min_ms and rto_max_ms (which may be
+                changed after init).
+ *  \param      retry       Pointer to SN_Retry structure
+                            (uninitialized is okay)
+ *  \param      now_ms      Callback returning the current time in
+                            milliseconds
+ *  \param      ctx         Context passed to now_ms
+ *  \param      max_retry   Most retransmissions of a request, or 0 for
+                            SN_RETRY_MAX
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_Retry_Init(
+    SN_Retry *retry,
+    SN_RetryTimeCb now_ms,
+    void *ctx,
+    byte max_retry);
+
+/*! \brief      Releases the retransmission timer
+ *  \param      retry       Pointer to SN_Retry structure
+ */
+WOLFMQTT_API void SN_Retry_Free(SN_Retry *retry);
+
+
+/* Internal Interfaces */
+
+/* Returns the current time in milliseconds */
+WOLFMQTT_LOCAL word32 SN_Retry_Now(SN_Retry *retry);
+/* Returns the retransmission timeout in milliseconds of a request sent again
+   retries times */
+WOLFMQTT_LOCAL word32 SN_Retry_Timeout(SN_Retry *retry, byte retries);
+/* Updates the estimate with the round trip time of a request answered
+   without being sent again */
+WOLFMQTT_LOCAL void SN_Retry_Sample(SN_Retry *retry, word32 rtt_ms);
+/* Counts a request not answered in time. Returns 1 when the request is to
+   be sent again, or 0 when retries are used up. */
+WOLFMQTT_LOCAL int SN_Retry_Expired(SN_Retry *retry, byte retries);
+
+#endif /* WOLFMQTT_SN_RETRY */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_SN_RETRY_H */
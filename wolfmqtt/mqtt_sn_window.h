@@ -0,0 +1,132 @@
+/* mqtt_sn_window.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_SN_WINDOW_H
+#define WOLFMQTT_SN_WINDOW_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_sn_packet.h"
+
+#ifdef WOLFMQTT_SN_WINDOW
+
+#ifndef WOLFMQTT_SN
+    #error "WOLFMQTT_SN_WINDOW requires WOLFMQTT_SN"
+#endif
+
+struct _MqttClient;
+
+/*! \brief      Called when a publish of the window completes. The publish
+                is no longer used by the client after the call.
+ *  \param      client      Pointer to MqttClient structure
+ *  \param      publish     Pointer to the publish given to
+                            SN_Client_PublishAsync. Its return_code is the
+                            one of the PUBACK, or SN_RC_ACCEPTED for a
+                            PUBCOMP.
+ *  \param      rc          MQTT_CODE_SUCCESS when acknowledged, or
+                            MQTT_CODE_ERROR_TIMEOUT when given up
+ *  \param      ctx         Context given to SN_PubWindow_Init
+ */
+typedef void (*SN_PubWindowCb)(struct _MqttClient *client,
+    SN_Publish *publish, int rc, void *ctx);
+
+typedef struct _SN_PubWindowStats {
+    word32      sent;           /* publishes sent */
+    word32      acked;          /* publishes acknowledged */
+    word32      failed;         /* publishes given up */
+    word16      max_count;      /* most outstanding at once */
+} SN_PubWindowStats;
+
+/* QoS 1 and 2 publishes sent and not yet acknowledged */
+typedef struct _SN_PubWindow {
+    SN_Publish **slots;         /* outstanding publishes, size entries */
+    word16      size;           /* most outstanding publishes */
+    word16      count;          /* outstanding publishes */
+    word16      last_id;        /* last packet ID given */
+    SN_PubWindowCb cb;
+    void       *ctx;
+    SN_PubWindowStats stats;
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_Sem      lock;
+#endif
+} SN_PubWindow;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes a publish window. Set it on a client with
+                SN_Client_SetPubWindow.
+ *  \param      win         Pointer to SN_PubWindow structure
+                            (uninitialized is okay)
+ *  \param      slots       Array of size publish pointers
+ *  \param      size        Most outstanding publishes
+ *  \param      cb          Completion callback, may be NULL
+ *  \param      ctx         Context passed to cb
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int SN_PubWindow_Init(
+    SN_PubWindow *win,
+    SN_Publish **slots,
+    word16 size,
+    SN_PubWindowCb cb,
+    void *ctx);
+
+/*! \brief      Releases the publish window. Outstanding publishes are
+                dropped without a callback.
+ *  \param      win         Pointer to SN_PubWindow structure
+ */
+WOLFMQTT_API void SN_PubWindow_Free(SN_PubWindow *win);
+
+/*! \brief      Returns the number of outstanding publishes
+ *  \param      win         Pointer to SN_PubWindow structure
+ *  \return     Outstanding publishes
+ */
+WOLFMQTT_API int SN_PubWindow_Count(SN_PubWindow *win);
+
+
+/* Internal Interfaces */
+
+/* Adds a publish, giving it a free packet ID when its packet_id is 0.
+   Returns MQTT_CODE_ERROR_OUT_OF_BUFFER when the window is full, or
+   MQTT_CODE_ERROR_PACKET_ID when the packet ID is outstanding. */
+WOLFMQTT_LOCAL int SN_PubWindow_Add(SN_PubWindow *win, SN_Publish *publish);
+/* Removes and returns the publish with the packet ID, or NULL */
+WOLFMQTT_LOCAL SN_Publish* SN_PubWindow_Remove(SN_PubWindow *win,
+    word16 packet_id);
+/* Removes and returns any publish, or NULL when empty */
+WOLFMQTT_LOCAL SN_Publish* SN_PubWindow_RemoveAny(SN_PubWindow *win);
+/* Locks the slots, for walking them by index */
+WOLFMQTT_LOCAL int SN_PubWindow_Lock(SN_PubWindow *win);
+WOLFMQTT_LOCAL void SN_PubWindow_Unlock(SN_PubWindow *win);
+/* Removes the slot at index, with the lock held */
+WOLFMQTT_LOCAL void SN_PubWindow_RemoveAt(SN_PubWindow *win, word16 idx);
+
+#endif /* WOLFMQTT_SN_WINDOW */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_SN_WINDOW_H */
@@ -0,0 +1,210 @@
+/* mqtt_subtrie.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_SUBTRIE_H
+#define WOLFMQTT_SUBTRIE_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+#include "wolfmqtt/mqtt_packet.h"
+
+#ifdef WOLFMQTT_SUBTRIE
+
+/* Most handlers called for one message, when filters overlap */
+#ifndef MQTT_SUBTRIE_MAX_MATCH
+#define MQTT_SUBTRIE_MAX_MATCH      8
+#endif
+
+/* Initial number of hash buckets for the topic levels (power of two) */
+#ifndef MQTT_SUBTRIE_DEF_BUCKETS
+#define MQTT_SUBTRIE_DEF_BUCKETS    64
+#endif
+
+/* Initial number of subscription identifiers (grows as needed) */
+#ifndef MQTT_SUBTRIE_DEF_IDS
+#define MQTT_SUBTRIE_DEF_IDS        16
+#endif
+
+/* Topic level of a filter. The level name is stored directly after the
+ * node. Children named by a level are found in the trie hash table by
+ * parent and name, the wildcard children are linked directly. */
+typedef struct _MqttSubNode {
+    struct _MqttSubNode *parent;
+    struct _MqttSubNode *chain;     /* next node in hash bucket */
+    struct _MqttSubNode *plus;      /* '+' child */
+    struct _MqttSubNode *hash;      /* '#' child */
+    MqttTopicCb cb;                 /* handler, if a filter ends here */
+    void       *ctx;
+    word32      key;                /* hash of parent and name */
+    word32      children;           /* number of child nodes */
+#ifdef WOLFMQTT_V5
+    word32      sub_id;             /* subscription identifier, 0 = none */
+#endif
+    word16      name_len;
+} MqttSubNode;
+
+/* Handler found for a topic */
+typedef struct _MqttSubMatch {
+    MqttTopicCb cb;
+    void       *ctx;
+} MqttSubMatch;
+
+#ifdef WOLFMQTT_V5
+/* Handler of the topic filters subscribed with a subscription identifier */
+typedef struct _MqttSubId {
+    MqttTopicCb cb;
+    void       *ctx;
+    word32      refs;               /* filters using the identifier, 0 = free */
+} MqttSubId;
+#endif
+
+/* Subscription trie: topic filters with a handler each */
+typedef struct _MqttSubTrie {
+    MqttSubNode  root;
+    MqttSubNode **buckets;
+    word32      bucket_mask;
+    word32      node_count;
+    word32      filter_count;
+#ifdef WOLFMQTT_MULTITHREAD
+    wm_Sem      lock;               /* filters change while reading */
+#endif
+#ifdef WOLFMQTT_V5
+    MqttSubId  *ids;                /* handlers indexed by identifier */
+    word32      id_max;             /* entries in ids (0 is not used) */
+    word32      id_next;            /* next identifier to try */
+    word32      id_filter_count;    /* filters with an identifier */
+    byte        use_ids;            /* assign identifiers when subscribing */
+#endif
+
+    /* Handlers for the message being received, kept for the remaining
+     * payload callbacks */
+    MqttSubMatch match[MQTT_SUBTRIE_MAX_MATCH];
+    int         match_count;
+} MqttSubTrie;
+
+
+/* Application Interfaces */
+
+/*! \brief      Initializes an empty subscription trie. Set it on a client
+                with MqttClient_SetSubTrie.
+ *  \param      trie        Pointer to MqttSubTrie structure
+                            (uninitialized is okay)
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttSubTrie_Init(MqttSubTrie *trie);
+
+/*! \brief      Releases all filters and the trie memory
+ *  \param      trie        Pointer to MqttSubTrie structure
+ */
+WOLFMQTT_API void MqttSubTrie_Free(MqttSubTrie *trie);
+
+/*! \brief      Adds a topic filter, or replaces the handler of a filter
+                that was already added. Filters may use the '+' and '#'
+                wildcards. For a shared subscription ("$share/group/filter")
+                the filter after the group is added.
+ *  \param      trie        Pointer to MqttSubTrie structure
+ *  \param      filter      Topic filter (null terminated)
+ *  \param      cb          Handler for matching messages
+ *  \param      ctx         Pointer to handler context
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_*
+                (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttSubTrie_Add(
+    MqttSubTrie *trie,
+    const char *filter,
+    MqttTopicCb cb,
+    void *ctx);
+
+/*! \brief      Removes a topic filter
+ *  \param      trie        Pointer to MqttSubTrie structure
+ *  \param      filter      Topic filter (null terminated)
+ *  \return     MQTT_CODE_SUCCESS, MQTT_CODE_ERROR_NOT_FOUND or
+                MQTT_CODE_ERROR_* (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttSubTrie_Remove(
+    MqttSubTrie *trie,
+    const char *filter);
+
+/*! \brief      Finds the handlers of all filters matching a topic name.
+                The time taken depends on the number of topic levels, not
+                on the number of filters. Topics starting with '$' do not
+                match a wildcard in the first level.
+ *  \param      trie        Pointer to MqttSubTrie structure
+ *  \param      topic       Topic name
+ *  \param      topic_len   Length of topic name
+ *  \param      matches     Array for the handlers found
+ *  \param      max_matches Number of entries in matches
+ *  \return     Number of handlers found (at most max_matches) or
+                MQTT_CODE_ERROR_* (see enum MqttPacketResponseCodes)
+ */
+WOLFMQTT_API int MqttSubTrie_Match(
+    MqttSubTrie *trie,
+    const char *topic,
+    word16 topic_len,
+    MqttSubMatch *matches,
+    int max_matches);
+
+#ifdef WOLFMQTT_V5
+/*! \brief      Enables assigning MQTT v5 subscription identifiers. Each
+                MqttClient_Subscribe (or packet of MqttClient_SubscribeBulk)
+                whose topics all have the same handler is sent with a new
+                identifier. The broker returns the identifiers of the
+                matching subscriptions with each publish, which index the
+                handler table directly with no topic matching. Only enable
+                when the broker supports subscription identifiers (CONNACK
+                property MQTT_PROP_SUBSCRIPTION_ID_AVAIL is not 0).
+ *  \param      trie        Pointer to MqttSubTrie structure
+ *  \param      enable      1 to assign identifiers, 0 to stop
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG
+ */
+WOLFMQTT_API int MqttSubTrie_SetSubIds(MqttSubTrie *trie, byte enable);
+#endif
+
+
+/* Internal Interfaces */
+
+/* Adds the topics that have a handler. With sub_id set and identifiers
+   enabled, a new identifier is assigned when all the topics have the same
+   handler, else sub_id is set to 0. Sets cb_added in each topic whose filter
+   was not already in the trie. */
+WOLFMQTT_LOCAL int MqttSubTrie_AddTopics(MqttSubTrie *trie, MqttTopic *topics,
+    int topic_count, word32 *sub_id);
+
+/* Calls the handlers matching the message topic, or those of the
+   subscription identifiers in the message when every filter has one. The
+   handlers found for a new message are also used for its remaining
+   payload. Returns
+   MQTT_CODE_ERROR_NOT_FOUND when no filter matches. */
+WOLFMQTT_LOCAL int MqttSubTrie_Deliver(MqttSubTrie *trie,
+    struct _MqttClient *client, struct _MqttMessage *msg, byte msg_new,
+    byte msg_done);
+
+#endif /* WOLFMQTT_SUBTRIE */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_SUBTRIE_H */
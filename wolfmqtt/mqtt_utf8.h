@@ -0,0 +1,89 @@
+/* mqtt_utf8.h
+ *
+ * Copyright (C) 2006-2025 wolfSSL Inc.
+ *
+ * This file is part of wolfMQTT.
+ *
+ * wolfMQTT is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * wolfMQTT is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1335, USA
+ */
+
+#ifndef WOLFMQTT_UTF8_H
+#define WOLFMQTT_UTF8_H
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "wolfmqtt/mqtt_types.h"
+
+/* Validation flags */
+#define MQTT_UTF8_TOPIC_NAME    0x01 /* wildcards are not allowed */
+#define MQTT_UTF8_TOPIC_FILTER  0x02 /* wildcards must be a whole level and
+                                        '#' must be last */
+
+#ifdef WOLFMQTT_UTF8
+
+/* Validator implementations */
+typedef enum _MqttUtf8Impl {
+    MQTT_UTF8_IMPL_AUTO = 0,    /* fastest supported by this CPU */
+    MQTT_UTF8_IMPL_NONE,        /* validation disabled */
+    MQTT_UTF8_IMPL_SCALAR,
+    MQTT_UTF8_IMPL_SSE2,
+    MQTT_UTF8_IMPL_AVX2,
+    MQTT_UTF8_IMPL_NEON
+} MqttUtf8Impl;
+
+
+/* Application Interfaces */
+
+/*! \brief      Selects the implementation used to validate strings. Set it
+                before any client is in use, since the selection is shared by
+                all clients.
+ *  \param      impl        MQTT_UTF8_IMPL_AUTO for the fastest available,
+                            MQTT_UTF8_IMPL_NONE to disable validation, or a
+                            specific implementation
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_BAD_ARG if the
+                implementation is not built in or not supported by the CPU
+ */
+WOLFMQTT_API int MqttUtf8_SetImpl(MqttUtf8Impl impl);
+
+/*! \brief      Returns the implementation used to validate strings
+ *  \return     MqttUtf8Impl (never MQTT_UTF8_IMPL_AUTO)
+ */
+WOLFMQTT_API MqttUtf8Impl MqttUtf8_GetImpl(void);
+
+/*! \brief      Returns the name of a validator implementation
+ *  \param      impl        MqttUtf8Impl value
+ *  \return     String name
+ */
+WOLFMQTT_API const char* MqttUtf8_ImplToString(MqttUtf8Impl impl);
+
+/*! \brief      Checks a string is well-formed UTF-8 without U+0000, as
+                required for MQTT strings. Topic flags also check the use of
+                the '+' and '#' wildcards.
+ *  \param      str         String data (does not need to be null terminated)
+ *  \param      len         Length of string data in bytes
+ *  \param      flags       0, MQTT_UTF8_TOPIC_NAME or MQTT_UTF8_TOPIC_FILTER
+ *  \return     MQTT_CODE_SUCCESS or MQTT_CODE_ERROR_MALFORMED_DATA
+ */
+WOLFMQTT_API int MqttUtf8_Validate(const char *str, word32 len, byte flags);
+
+#endif /* WOLFMQTT_UTF8 */
+
+#ifdef __cplusplus
+    } /* extern "C" */
+#endif
+
+#endif /* WOLFMQTT_UTF8_H */